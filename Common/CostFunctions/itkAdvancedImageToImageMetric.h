@@ -21,6 +21,8 @@
 #include "itkImageToImageMetric.h"
 
 #include "itkImageSamplerBase.h"
+#include "itkImageGridSampler.h"
+#include "itkImageFullSampler.h"
 #include "itkGradientImageFilter.h"
 #include "itkBSplineInterpolateImageFunction.h"
 #include "itkReducedDimensionBSplineInterpolateImageFunction.h"
@@ -29,6 +31,7 @@
 #include "itkFixedArray.h"
 #include "itkAdvancedTransform.h"
 #include "vnl/vnl_sparse_matrix.h"
+#include "itkCompressedRowSymmetricMatrix.h"
 
 #include "itkImageMaskSpatialObject2.h"
 
@@ -171,6 +174,8 @@ public:
   /** Hessian type; for SelfHessian (experimental feature) */
   typedef typename DerivativeType::ValueType    HessianValueType;
   typedef vnl_sparse_matrix< HessianValueType > HessianType;
+  typedef CompressedRowSymmetricMatrix<
+    HessianValueType >                          CompressedHessianType;
 
   /** Typedefs for multi-threading. */
   typedef itk::MultiThreader                      ThreaderType;
@@ -269,6 +274,12 @@ public:
    */
   virtual void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const;
 
+  /** Experimental feature: compute SelfHessian, in compressed row format.
+   * This base class converts the result of GetSelfHessian().
+   */
+  virtual void GetCompressedSelfHessian( const TransformParametersType & parameters,
+    CompressedHessianType & H ) const;
+
   /** Set number of threads to use for computations. */
   virtual void SetNumberOfThreads( ThreadIdType numberOfThreads );
 
@@ -521,6 +532,14 @@ protected:
   /** Check if the transform is a B-spline. Called by Initialize. */
   virtual void CheckForBSplineTransform( void ) const;
 
+  /** Check if the samples lie on the voxel lattice of the fixed image, i.e.
+   * if a grid or full sampler is used, and if the B-spline transform is
+   * evaluated directly in the sample positions. If so, the transform is asked
+   * to precompute its 1D B-spline weights for this lattice. Otherwise any
+   * previously precomputed weights are discarded. Called by Initialize.
+   */
+  virtual void CheckForGridAlignedSamples( void );
+
   /** Transform a point from FixedImage domain to MovingImage domain.
    * This function also checks if mapped point is within support region of
    * the transform. It returns true if so, and false otherwise.
@@ -181,6 +181,9 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   /** Check if the transform is a B-spline transform. */
   this->CheckForBSplineTransform();
 
+  /** Check if the B-spline weights can be precomputed for the samples. */
+  this->CheckForGridAlignedSamples();
+
   /** Initialize some threading related parameters. */
   if( this->m_UseMultiThread )
   {
@@ -585,6 +588,72 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end CheckForBSplineTransform()
 
 
+/**
+ * ****************** CheckForGridAlignedSamples **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::CheckForGridAlignedSamples( void )
+{
+  typedef AdvancedBSplineDeformableTransformBase<
+    ScalarType, FixedImageDimension >                    BSplineBaseTransformType;
+  typedef ImageGridSampler< FixedImageType > ImageGridSamplerType;
+  typedef ImageFullSampler< FixedImageType > ImageFullSamplerType;
+
+  /** Find the B-spline transform. In a combination transform it is only
+   * evaluated in the sample positions themselves, when it is not composed
+   * with an initial transform.
+   */
+  BSplineBaseTransformType * bsplineTransform = dynamic_cast< BSplineBaseTransformType * >(
+    this->m_AdvancedTransform.GetPointer() );
+  bool evaluatedInSamples = true;
+
+  CombinationTransformType * testPtr_combo
+    = dynamic_cast< CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
+  if( testPtr_combo )
+  {
+    bsplineTransform = dynamic_cast< BSplineBaseTransformType * >(
+      testPtr_combo->GetModifiableCurrentTransform() );
+    evaluatedInSamples = testPtr_combo->GetInitialTransform() == nullptr
+      || testPtr_combo->GetUseAddition();
+  }
+
+  if( !bsplineTransform )
+  {
+    return;
+  }
+
+  /** Check if the samples lie on the voxel lattice of the fixed image. */
+  const bool samplesOnLattice = this->m_UseImageSampler
+    && ( dynamic_cast< ImageGridSamplerType * >( this->m_ImageSampler.GetPointer() )
+    || dynamic_cast< ImageFullSamplerType * >( this->m_ImageSampler.GetPointer() ) );
+
+  if( samplesOnLattice && evaluatedInSamples && this->m_FixedImage.IsNotNull() )
+  {
+    /** The lattice starts at the first voxel of the buffered region. */
+    const typename FixedImageType::RegionType & region = this->m_FixedImage->GetBufferedRegion();
+    FixedImagePointType latticeOrigin;
+    this->m_FixedImage->TransformIndexToPhysicalPoint( region.GetIndex(), latticeOrigin );
+    typename BSplineBaseTransformType::OriginType latticeOriginArray;
+    typename BSplineBaseTransformType::SizeType   latticeSize;
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      latticeOriginArray[ i ] = latticeOrigin[ i ];
+      latticeSize[ i ]        = region.GetSize()[ i ];
+    }
+    bsplineTransform->SetGridAlignedSampleLattice( latticeOriginArray,
+      this->m_FixedImage->GetSpacing(), this->m_FixedImage->GetDirection(), latticeSize );
+  }
+  else
+  {
+    bsplineTransform->ClearGridAlignedSampleLattice();
+  }
+
+} // end CheckForGridAlignedSamples()
+
+
 /**
  * ******************* EvaluateMovingImageValueAndDerivative ******************
  */
@@ -850,6 +919,24 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetSelfHessian()
 
 
+/**
+ * *********************** GetCompressedSelfHessian ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetCompressedSelfHessian(
+  const TransformParametersType & parameters,
+  CompressedHessianType & H ) const
+{
+  HessianType sparseH;
+  this->GetSelfHessian( parameters, sparseH );
+  H.CopyFromAndRelease( sparseH );
+
+} // end GetCompressedSelfHessian()
+
+
 /**
  * *********************** BeforeThreadedGetValueAndDerivative ***********************
  */
@@ -0,0 +1,163 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkCompressedRowSymmetricMatrix_h
+#define __itkCompressedRowSymmetricMatrix_h
+
+#include "vnl/vnl_sparse_matrix.h"
+#include <cstddef>
+#include <vector>
+
+namespace itk
+{
+
+/** \class CompressedRowSymmetricMatrix
+ * \brief A sparse symmetric matrix, of which the upper triangular part is
+ * stored in compressed row format.
+ *
+ * Row r has the column indices and values at positions RowPointers[ r ]
+ * up to RowPointers[ r + 1 ] of ColumnIndices and Values. The column indices
+ * of a row are sorted ascending and are not smaller than r. The arrays can
+ * be handed to a sparse solver without conversion: read as a compressed
+ * column matrix they give the lower triangular part of the same matrix.
+ *
+ * This class is used for the SelfHessian, see
+ * AdvancedImageToImageMetric::GetCompressedSelfHessian().
+ *
+ * \ingroup Metrics
+ */
+
+template< class TValue >
+class CompressedRowSymmetricMatrix
+{
+public:
+
+  /** Typedefs. The index type matches the one of cholmod_sparse. */
+  typedef TValue                         ValueType;
+  typedef int                            IndexType;
+  typedef std::vector< IndexType >       IndexContainerType;
+  typedef std::vector< ValueType >       ValueContainerType;
+  typedef vnl_sparse_matrix< ValueType > SparseMatrixType;
+
+  /** Set the number of rows and columns, and remove all elements. */
+  void SetSize( const IndexType numberOfRows )
+  {
+    this->m_RowPointers.assign( numberOfRows + 1, 0 );
+    this->m_ColumnIndices.clear();
+    this->m_Values.clear();
+  }
+
+
+  /** Get the number of rows, which equals the number of columns. */
+  IndexType GetNumberOfRows( void ) const
+  {
+    return this->m_RowPointers.empty() ? 0
+           : static_cast< IndexType >( this->m_RowPointers.size() - 1 );
+  }
+
+
+  /** Get the number of stored elements. */
+  std::size_t GetNumberOfNonZeros( void ) const
+  {
+    return this->m_Values.size();
+  }
+
+
+  /** Access to the arrays. */
+  IndexContainerType & GetRowPointers( void ) { return this->m_RowPointers; }
+  const IndexContainerType & GetRowPointers( void ) const { return this->m_RowPointers; }
+  IndexContainerType & GetColumnIndices( void ) { return this->m_ColumnIndices; }
+  const IndexContainerType & GetColumnIndices( void ) const { return this->m_ColumnIndices; }
+  ValueContainerType & GetValues( void ) { return this->m_Values; }
+  const ValueContainerType & GetValues( void ) const { return this->m_Values; }
+
+  /** Make this the identity matrix of the given size. */
+  void SetIdentity( const IndexType numberOfRows )
+  {
+    this->m_RowPointers.resize( numberOfRows + 1 );
+    this->m_ColumnIndices.resize( numberOfRows );
+    this->m_Values.assign( numberOfRows, 1.0 );
+    for( IndexType r = 0; r < numberOfRows; ++r )
+    {
+      this->m_RowPointers[ r ]   = r;
+      this->m_ColumnIndices[ r ] = r;
+    }
+    this->m_RowPointers[ numberOfRows ] = numberOfRows;
+  }
+
+
+  /** Copy the upper triangular part of a square vnl sparse matrix. The rows
+   * of the input matrix are released on the way, to save memory.
+   */
+  void CopyFromAndRelease( SparseMatrixType & matrix )
+  {
+    typedef typename SparseMatrixType::row RowType;
+    typedef typename RowType::const_iterator RowIteratorType;
+
+    const IndexType numberOfRows = static_cast< IndexType >( matrix.rows() );
+    this->SetSize( numberOfRows );
+    for( IndexType r = 0; r < numberOfRows; ++r )
+    {
+      RowType & rowVector = matrix.get_row( r );
+      for( RowIteratorType rowIt = rowVector.begin(); rowIt != rowVector.end(); ++rowIt )
+      {
+        if( static_cast< IndexType >( rowIt->first ) >= r )
+        {
+          this->m_ColumnIndices.push_back( static_cast< IndexType >( rowIt->first ) );
+          this->m_Values.push_back( rowIt->second );
+        }
+      }
+      this->m_RowPointers[ r + 1 ] = static_cast< IndexType >( this->m_Values.size() );
+      RowType().swap( rowVector );
+    }
+    matrix.set_size( 0, 0 );
+  }
+
+
+  /** Copy to a vnl sparse matrix, which then holds the upper triangular part. */
+  void CopyTo( SparseMatrixType & matrix ) const
+  {
+    const IndexType numberOfRows = this->GetNumberOfRows();
+    matrix.set_size( numberOfRows, numberOfRows );
+    std::vector< int >       cols;
+    std::vector< ValueType > vals;
+    for( IndexType r = 0; r < numberOfRows; ++r )
+    {
+      const IndexType begin = this->m_RowPointers[ r ];
+      const IndexType end   = this->m_RowPointers[ r + 1 ];
+      if( begin == end )
+      {
+        continue;
+      }
+      cols.assign( this->m_ColumnIndices.begin() + begin, this->m_ColumnIndices.begin() + end );
+      vals.assign( this->m_Values.begin() + begin, this->m_Values.begin() + end );
+      matrix.set_row( r, cols, vals );
+    }
+  }
+
+
+private:
+
+  IndexContainerType m_RowPointers;
+  IndexContainerType m_ColumnIndices;
+  ValueContainerType m_Values;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkCompressedRowSymmetricMatrix_h
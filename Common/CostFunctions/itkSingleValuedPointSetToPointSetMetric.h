@@ -40,6 +40,9 @@
 #include "itkExceptionObject.h"
 #include "itkSpatialObject.h"
 #include "itkPointSet.h"
+#include "itkMultiThreader.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -54,6 +57,13 @@ namespace itk
  * This class computes a value that measures the similarity between the fixed point-set
  * and the transformed moving point-set.
  *
+ * Subclasses can evaluate their points multi-threaded by implementing
+ * ThreadedGetValueAndDerivativeOfPoints() for a range of points and calling
+ * LaunchGetValueAndDerivativeOfPoints(). The points are split in one contiguous
+ * chunk per thread. Each thread accumulates its value and a sparse derivative
+ * (only the touched parameters are recorded), which are reduced in thread
+ * order, so the result is deterministic for a given number of threads.
+ *
  * \ingroup RegistrationMetrics
  *
  */
@@ -101,6 +111,7 @@ public:
   typedef typename TransformType::OutputPointType OutputPointType;
   typedef typename TransformType::ParametersType  TransformParametersType;
   typedef typename TransformType::JacobianType    TransformJacobianType;
+  typedef typename TransformType::OutputVectorType OutputVectorType;
 
   typedef SpatialObject<
     itkGetStaticConstMacro( FixedPointSetDimension ) > FixedImageMaskType;
@@ -120,6 +131,10 @@ public:
   /** Typedefs for support of sparse Jacobians and compact support of transformations. */
   typedef typename TransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
 
+  /** Typedefs for multi-threading. */
+  typedef itk::MultiThreader             ThreaderType;
+  typedef ThreaderType::ThreadInfoStruct ThreadInfoType;
+
   /** Connect the fixed pointset.  */
   itkSetConstObjectMacro( FixedPointSet, FixedPointSetType );
 
@@ -171,10 +186,64 @@ public:
   itkGetConstReferenceMacro( UseMetricSingleThreaded, bool );
   itkBooleanMacro( UseMetricSingleThreaded );
 
+  /** Evaluate the points multi-threaded, for subclasses that support it. Default: false. */
+  itkSetMacro( UseMultiThread, bool );
+  itkGetConstReferenceMacro( UseMultiThread, bool );
+  itkBooleanMacro( UseMultiThread );
+
+  /** Set the number of threads. */
+  virtual void SetNumberOfThreads( ThreadIdType numberOfThreads )
+  {
+    this->m_Threader->SetNumberOfThreads( numberOfThreads );
+  }
+
+  /** Get the number of threads. */
+  ThreadIdType GetNumberOfThreads( void ) const
+  {
+    return this->m_Threader->GetNumberOfThreads();
+  }
+
 protected:
 
   SingleValuedPointSetToPointSetMetric();
-  ~SingleValuedPointSetToPointSetMetric() override {}
+  ~SingleValuedPointSetToPointSetMetric() override;
+
+  /** Transform a contiguous array of points. This is the single place where
+   * the point-set metrics map their points. The points are copied to a
+   * structure-of-arrays buffer in chunks and mapped with the batched
+   * AdvancedTransform::TransformPoints().
+   */
+  void TransformPoints( const InputPointType * fixedPoints,
+    OutputPointType * mappedPoints, const unsigned int numberOfPoints ) const;
+
+  /** Compute the contribution of the points [ begin, end [ to the value and,
+   * when requested, the derivative, for thread threadId. Implementations add
+   * to m_GetValueAndDerivativePerThreadVariables[ threadId ] directly or via
+   * AccumulateDerivativeOfPoint(). The default does nothing.
+   */
+  virtual void ThreadedGetValueAndDerivativeOfPoints( const unsigned int begin,
+    const unsigned int end, const ThreadIdType threadId,
+    const bool computeDerivative ) const {}
+
+  /** Split numberOfPoints over the threads, call ThreadedGetValueAndDerivativeOfPoints()
+   * and reduce the per-thread results into value, m_NumberOfPointsCounted and,
+   * if not NULL, derivative. The derivative is added to, not overwritten.
+   * Runs on the calling thread when m_UseMultiThread is false.
+   */
+  void LaunchGetValueAndDerivativeOfPoints( const unsigned int numberOfPoints,
+    MeasureType & value, DerivativeType * derivative ) const;
+
+  /** Add pointGradient^T * jacobian to the derivative of thread threadId. */
+  void AccumulateDerivativeOfPoint( const ThreadIdType threadId,
+    const TransformJacobianType & jacobian,
+    const NonZeroJacobianIndicesType & nzji,
+    const OutputVectorType & pointGradient ) const;
+
+  /** Threader callback for LaunchGetValueAndDerivativeOfPoints(). */
+  static ITK_THREAD_RETURN_TYPE GetValueAndDerivativeOfPointsThreaderCallback( void * arg );
+
+  /** Make sure the per-thread variables fit the number of threads and parameters. */
+  void InitializeThreadingParameters( void ) const;
 
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
@@ -189,7 +258,35 @@ protected:
   mutable unsigned int m_NumberOfPointsCounted;
 
   /** Variables for multi-threading. */
-  bool m_UseMetricSingleThreaded;
+  bool                  m_UseMetricSingleThreaded;
+  bool                  m_UseMultiThread;
+  ThreaderType::Pointer m_Threader;
+
+  struct MultiThreaderParameterType
+  {
+    const Self * st_Metric;
+    unsigned int st_NumberOfPoints;
+    bool         st_ComputeDerivative;
+  };
+  mutable MultiThreaderParameterType m_ThreaderParameters;
+
+  /** The per-thread results. The derivative is dense, but only the entries in
+   * st_TouchedIndices are non-zero, so the reduction and reset are sparse.
+   */
+  struct GetValueAndDerivativePerThreadStruct
+  {
+    SizeValueType                st_NumberOfPointsCounted;
+    MeasureType                  st_Value;
+    DerivativeType               st_Derivative;
+    std::vector< unsigned char > st_IsTouched;
+    NonZeroJacobianIndicesType   st_TouchedIndices;
+  };
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, GetValueAndDerivativePerThreadStruct,
+    PaddedGetValueAndDerivativePerThreadStruct );
+  itkAlignedTypedef( ITK_CACHE_LINE_ALIGNMENT, PaddedGetValueAndDerivativePerThreadStruct,
+    AlignedGetValueAndDerivativePerThreadStruct );
+  mutable AlignedGetValueAndDerivativePerThreadStruct * m_GetValueAndDerivativePerThreadVariables;
+  mutable ThreadIdType                                  m_GetValueAndDerivativePerThreadVariablesSize;
 
 private:
 
@@ -35,6 +35,8 @@
 #define __itkSingleValuedPointSetToPointSetMetric_hxx
 
 #include "itkSingleValuedPointSetToPointSetMetric.h"
+#include <algorithm> // std::min
+#include <cmath>
 
 namespace itk
 {
@@ -56,10 +58,40 @@ SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
   this->m_NumberOfPointsCounted = 0;
 
   this->m_UseMetricSingleThreaded = true;
+  this->m_UseMultiThread          = false;
+  this->m_Threader                = ThreaderType::New();
+
+#if ITK_VERSION_MAJOR < 5
+  // Note: This `#if` is a workaround for ITK5, which no longer supports calling
+  // `threader->SetUseThreadPool(false)`. ITK5 does not use thread pools by default.
+  this->m_Threader->SetUseThreadPool( false );
+#endif
+
+  /** Initialize the m_ThreaderParameters. */
+  this->m_ThreaderParameters.st_Metric            = this;
+  this->m_ThreaderParameters.st_NumberOfPoints    = 0;
+  this->m_ThreaderParameters.st_ComputeDerivative = false;
+
+  // Multi-threading structs
+  this->m_GetValueAndDerivativePerThreadVariables     = NULL;
+  this->m_GetValueAndDerivativePerThreadVariablesSize = 0;
 
 } // end Constructor
 
 
+/**
+ * ******************* Destructor ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::~SingleValuedPointSetToPointSetMetric()
+{
+  delete[] this->m_GetValueAndDerivativePerThreadVariables;
+
+} // end Destructor
+
+
 /**
  * ******************* SetTransformParameters ***********************
  */
@@ -135,6 +167,234 @@ SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
 } // end BeforeThreadedGetValueAndDerivative()
 
 
+/**
+ * ******************* TransformPoints ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::TransformPoints( const InputPointType * fixedPoints,
+  OutputPointType * mappedPoints, const unsigned int numberOfPoints ) const
+{
+  typedef typename TransformType::InputCoordinateArraysType  InputCoordinateArraysType;
+  typedef typename TransformType::OutputCoordinateArraysType OutputCoordinateArraysType;
+  typedef typename TransformType::ScalarType                 ScalarType;
+
+  /** Structure-of-arrays buffers for one chunk of points. */
+  const unsigned int chunkSize = 256;
+  ScalarType         inputBuffer[ FixedPointSetDimension ][ chunkSize ];
+  ScalarType         outputBuffer[ MovingPointSetDimension ][ chunkSize ];
+
+  InputCoordinateArraysType  inputCoordinates;
+  OutputCoordinateArraysType outputCoordinates;
+  for( unsigned int d = 0; d < FixedPointSetDimension; ++d )
+  {
+    inputCoordinates[ d ] = inputBuffer[ d ];
+  }
+  for( unsigned int d = 0; d < MovingPointSetDimension; ++d )
+  {
+    outputCoordinates[ d ] = outputBuffer[ d ];
+  }
+
+  for( unsigned int begin = 0; begin < numberOfPoints; begin += chunkSize )
+  {
+    const unsigned int size = std::min( chunkSize, numberOfPoints - begin );
+    for( unsigned int i = 0; i < size; ++i )
+    {
+      for( unsigned int d = 0; d < FixedPointSetDimension; ++d )
+      {
+        inputBuffer[ d ][ i ] = fixedPoints[ begin + i ][ d ];
+      }
+    }
+
+    this->m_Transform->TransformPoints( inputCoordinates, outputCoordinates, size, nullptr );
+
+    for( unsigned int i = 0; i < size; ++i )
+    {
+      for( unsigned int d = 0; d < MovingPointSetDimension; ++d )
+      {
+        mappedPoints[ begin + i ][ d ] = outputBuffer[ d ][ i ];
+      }
+    }
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ******************* InitializeThreadingParameters ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::InitializeThreadingParameters( void ) const
+{
+  /** The per-thread derivatives are only (re)allocated when the number of
+   * threads or parameters changes. Otherwise they are all zero here, because
+   * LaunchGetValueAndDerivativeOfPoints() resets the touched entries.
+   */
+  const ThreadIdType numberOfThreads = this->m_Threader->GetNumberOfThreads();
+
+  /** Only resize the array of structs when needed. */
+  if( this->m_GetValueAndDerivativePerThreadVariablesSize != numberOfThreads )
+  {
+    delete[] this->m_GetValueAndDerivativePerThreadVariables;
+    this->m_GetValueAndDerivativePerThreadVariables     = new AlignedGetValueAndDerivativePerThreadStruct[ numberOfThreads ];
+    this->m_GetValueAndDerivativePerThreadVariablesSize = numberOfThreads;
+  }
+
+  /** Some initialization. */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    AlignedGetValueAndDerivativePerThreadStruct & threadVariables
+      = this->m_GetValueAndDerivativePerThreadVariables[ i ];
+    threadVariables.st_NumberOfPointsCounted = NumericTraits< SizeValueType >::Zero;
+    threadVariables.st_Value                 = NumericTraits< MeasureType >::Zero;
+
+    if( threadVariables.st_Derivative.GetSize() != numberOfParameters )
+    {
+      threadVariables.st_Derivative.SetSize( numberOfParameters );
+      threadVariables.st_Derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+      threadVariables.st_IsTouched.assign( numberOfParameters, 0 );
+      threadVariables.st_TouchedIndices.clear();
+    }
+  }
+
+} // end InitializeThreadingParameters()
+
+
+/**
+ * ******************* LaunchGetValueAndDerivativeOfPoints ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::LaunchGetValueAndDerivativeOfPoints( const unsigned int numberOfPoints,
+  MeasureType & value, DerivativeType * derivative ) const
+{
+  this->InitializeThreadingParameters();
+  const bool computeDerivative = ( derivative != NULL );
+
+  if( !this->m_UseMultiThread )
+  {
+    this->ThreadedGetValueAndDerivativeOfPoints( 0, numberOfPoints, 0, computeDerivative );
+  }
+  else
+  {
+    /** Setup threader and launch. */
+    this->m_ThreaderParameters.st_NumberOfPoints    = numberOfPoints;
+    this->m_ThreaderParameters.st_ComputeDerivative = computeDerivative;
+    this->m_Threader->SetSingleMethod( this->GetValueAndDerivativeOfPointsThreaderCallback,
+      const_cast< void * >( static_cast< const void * >( &this->m_ThreaderParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
+  }
+
+  /** Reduce the per-thread results in thread order, and reset them. */
+  value = NumericTraits< MeasureType >::Zero;
+  SizeValueType numberOfPointsCounted = NumericTraits< SizeValueType >::Zero;
+  for( ThreadIdType i = 0; i < this->m_GetValueAndDerivativePerThreadVariablesSize; ++i )
+  {
+    AlignedGetValueAndDerivativePerThreadStruct & threadVariables
+      = this->m_GetValueAndDerivativePerThreadVariables[ i ];
+    value                                   += threadVariables.st_Value;
+    numberOfPointsCounted                   += threadVariables.st_NumberOfPointsCounted;
+    threadVariables.st_Value                 = NumericTraits< MeasureType >::Zero;
+    threadVariables.st_NumberOfPointsCounted = NumericTraits< SizeValueType >::Zero;
+
+    const std::size_t numberOfTouched = threadVariables.st_TouchedIndices.size();
+    for( std::size_t j = 0; j < numberOfTouched; ++j )
+    {
+      const unsigned long index = threadVariables.st_TouchedIndices[ j ];
+      if( computeDerivative )
+      {
+        ( *derivative )[ index ] += threadVariables.st_Derivative[ index ];
+      }
+      threadVariables.st_Derivative[ index ] = NumericTraits< DerivativeValueType >::ZeroValue();
+      threadVariables.st_IsTouched[ index ]  = 0;
+    }
+    threadVariables.st_TouchedIndices.clear();
+  }
+  this->m_NumberOfPointsCounted = static_cast< unsigned int >( numberOfPointsCounted );
+
+} // end LaunchGetValueAndDerivativeOfPoints()
+
+
+/**
+ * ************ GetValueAndDerivativeOfPointsThreaderCallback ****************************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+ITK_THREAD_RETURN_TYPE
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::GetValueAndDerivativeOfPointsThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType                 threadID    = infoStruct->ThreadID;
+  ThreadIdType                 nrOfThreads = infoStruct->NumberOfThreads;
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  /** Get the chunk of points for this thread. */
+  const unsigned int numberOfPoints      = temp->st_NumberOfPoints;
+  const unsigned int nrOfPointsPerThread = static_cast< unsigned int >( std::ceil(
+    static_cast< double >( numberOfPoints ) / static_cast< double >( nrOfThreads ) ) );
+  unsigned int pos_begin = nrOfPointsPerThread * threadID;
+  unsigned int pos_end   = nrOfPointsPerThread * ( threadID + 1 );
+  pos_begin = ( pos_begin > numberOfPoints ) ? numberOfPoints : pos_begin;
+  pos_end   = ( pos_end > numberOfPoints ) ? numberOfPoints : pos_end;
+
+  temp->st_Metric->ThreadedGetValueAndDerivativeOfPoints(
+    pos_begin, pos_end, threadID, temp->st_ComputeDerivative );
+
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end GetValueAndDerivativeOfPointsThreaderCallback()
+
+
+/**
+ * ******************* AccumulateDerivativeOfPoint ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::AccumulateDerivativeOfPoint( const ThreadIdType threadId,
+  const TransformJacobianType & jacobian,
+  const NonZeroJacobianIndicesType & nzji,
+  const OutputVectorType & pointGradient ) const
+{
+  AlignedGetValueAndDerivativePerThreadStruct & threadVariables
+    = this->m_GetValueAndDerivativePerThreadVariables[ threadId ];
+
+  for( unsigned int i = 0; i < nzji.size(); ++i )
+  {
+    const unsigned long index = nzji[ i ];
+    DerivativeValueType sum   = NumericTraits< DerivativeValueType >::ZeroValue();
+    for( unsigned int d = 0; d < MovingPointSetDimension; ++d )
+    {
+      sum += pointGradient[ d ] * jacobian( d, i );
+    }
+
+    if( !threadVariables.st_IsTouched[ index ] )
+    {
+      threadVariables.st_IsTouched[ index ] = 1;
+      threadVariables.st_TouchedIndices.push_back( index );
+    }
+    threadVariables.st_Derivative[ index ] += sum;
+  }
+
+} // end AccumulateDerivativeOfPoint()
+
+
 /**
  * ******************* PrintSelf ***********************
  */
@@ -151,6 +411,7 @@ SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
   os << "Fixed mask: " << this->m_FixedImageMask.GetPointer() << std::endl;
   os << "Moving mask: " << this->m_MovingImageMask.GetPointer() << std::endl;
   os << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << "UseMultiThread: " << this->m_UseMultiThread << std::endl;
 
 } // end PrintSelf()
 
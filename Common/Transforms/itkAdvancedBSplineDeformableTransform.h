@@ -224,6 +224,9 @@ public:
     itkGetStaticConstMacro( SplineOrder ) >                 SODerivativeWeightsFunctionType;
   typedef typename SODerivativeWeightsFunctionType::Pointer SODerivativeWeightsFunctionPointer;
 
+  /** Table of precomputed 1D weights for points on a lattice. */
+  typedef typename WeightsFunctionType::GridAlignedWeightsTableType GridAlignedWeightsTableType;
+
   /** Parameter index array type. */
   typedef typename Superclass::ParameterIndexArrayType ParameterIndexArrayType;
 
@@ -267,6 +270,11 @@ public:
     DerivativeType & imageJacobian,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const override;
 
+  /** Get the nonzero Jacobian indices, from the support region of the point. */
+  void GetNonZeroJacobianIndices(
+    const InputPointType & ipp,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const override;
+
   /** Compute the spatial Jacobian of the transformation. */
   void GetSpatialJacobian(
     const InputPointType & ipp,
@@ -307,6 +315,19 @@ public:
     JacobianOfSpatialHessianType & jsh,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const override;
 
+  /** Precompute the 1D weights for points on a lattice, see the superclass. */
+  bool SetGridAlignedSampleLattice( const OriginType & origin,
+    const SpacingType & spacing, const DirectionType & direction,
+    const SizeType & size ) override;
+
+  /** Discard the precomputed weights. */
+  void ClearGridAlignedSampleLattice( void ) override;
+
+  /** Compute the displacements along a row parallel to a grid axis, see the superclass. */
+  bool ComputeDisplacementsAlongRow( const InputPointType & rowStart,
+    const InputVectorType & rowStep, const SizeValueType numberOfPoints,
+    ScalarType * displacements ) const override;
+
 protected:
 
   /** Print contents of an AdvancedBSplineDeformableTransform. */
@@ -338,6 +359,9 @@ protected:
   std::vector< DerivativeWeightsFunctionPointer >                  m_DerivativeWeightsFunctions;
   std::vector< std::vector< SODerivativeWeightsFunctionPointer > > m_SODerivativeWeightsFunctions;
 
+  /** The 1D weights for points on a lattice, shared by the weights functions. */
+  GridAlignedWeightsTableType m_GridAlignedWeightsTable;
+
 private:
 
   AdvancedBSplineDeformableTransform( const Self & ); // purposely not implemented
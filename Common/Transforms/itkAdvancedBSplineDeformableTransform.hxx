@@ -40,6 +40,7 @@
 #include "itkContinuousIndex.h"
 #include "itkImageScanlineConstIterator.h"
 #include "itkIdentityTransform.h"
+#include "itkBSplineKernelFunction2.h"
 #include "vnl/vnl_math.h"
 #include <vector>
 #include <algorithm> // std::copy
@@ -52,19 +53,22 @@ template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder
 AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 ::AdvancedBSplineDeformableTransform() : Superclass()
 {
-  // Instantiate weights functions
+  // Instantiate weights functions, which all share the grid aligned weights
   this->m_WeightsFunction = WeightsFunctionType::New();
+  this->m_WeightsFunction->SetGridAlignedWeightsTable( &this->m_GridAlignedWeightsTable );
   this->m_DerivativeWeightsFunctions.resize( SpaceDimension );
   this->m_SODerivativeWeightsFunctions.resize( SpaceDimension );
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
     this->m_DerivativeWeightsFunctions[ i ] = DerivativeWeightsFunctionType::New();
     this->m_DerivativeWeightsFunctions[ i ]->SetDerivativeDirection( i );
+    this->m_DerivativeWeightsFunctions[ i ]->SetGridAlignedWeightsTable( &this->m_GridAlignedWeightsTable );
     this->m_SODerivativeWeightsFunctions[ i ].resize( SpaceDimension );
     for( unsigned int j = 0; j < SpaceDimension; ++j )
     {
       this->m_SODerivativeWeightsFunctions[ i ][ j ] = SODerivativeWeightsFunctionType::New();
       this->m_SODerivativeWeightsFunctions[ i ][ j ]->SetDerivativeDirections( i, j );
+      this->m_SODerivativeWeightsFunctions[ i ][ j ]->SetGridAlignedWeightsTable( &this->m_GridAlignedWeightsTable );
     }
   }
   this->m_SupportSize = this->m_WeightsFunction->GetSupportSize();
@@ -517,6 +521,44 @@ AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 } // end EvaluateJacobianWithImageGradientProduct()
 
 
+/**
+ * ********************* GetNonZeroJacobianIndices ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::GetNonZeroJacobianIndices(
+  const InputPointType & ipp,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** Convert the physical point to a continuous index. */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( ipp, cindex );
+
+  /** Outside the valid region the same indices are returned as by GetJacobian(). */
+  if( !this->InsideValidRegion( cindex ) )
+  {
+    const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+    nonZeroJacobianIndices.resize( nnzji );
+    for( NumberOfParametersType i = 0; i < nnzji; ++i )
+    {
+      nonZeroJacobianIndices[ i ] = i;
+    }
+    return;
+  }
+
+  /** The indices of the support region, no weights are needed. */
+  IndexType supportIndex;
+  this->m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
+  RegionType supportRegion;
+  supportRegion.SetSize( this->m_SupportSize );
+  supportRegion.SetIndex( supportIndex );
+  this->ComputeNonZeroJacobianIndices( nonZeroJacobianIndices, supportRegion );
+
+} // end GetNonZeroJacobianIndices()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -1327,6 +1369,207 @@ AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 } // end GetJacobianOfSpatialHessian()
 
 
+/**
+ * ********************* SetGridAlignedSampleLattice ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+bool
+AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::SetGridAlignedSampleLattice( const OriginType & origin,
+  const SpacingType & spacing, const DirectionType & direction,
+  const SizeType & size )
+{
+  double latticeOrigin[ SpaceDimension ];
+  double latticeStep[ SpaceDimension ];
+  if( !this->ComputeSampleLatticeInGridIndices( origin, spacing, direction, latticeOrigin, latticeStep ) )
+  {
+    this->m_GridAlignedWeightsTable.Clear();
+    return false;
+  }
+
+  return this->m_GridAlignedWeightsTable.Initialize( latticeOrigin, latticeStep, size.GetSize() );
+
+} // end SetGridAlignedSampleLattice()
+
+
+/**
+ * ********************* ClearGridAlignedSampleLattice ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::ClearGridAlignedSampleLattice( void )
+{
+  this->m_GridAlignedWeightsTable.Clear();
+
+} // end ClearGridAlignedSampleLattice()
+
+
+/**
+ * ********************* ComputeDisplacementsAlongRow ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+bool
+AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::ComputeDisplacementsAlongRow( const InputPointType & rowStart,
+  const InputVectorType & rowStep, const SizeValueType numberOfPoints,
+  ScalarType * displacements ) const
+{
+  if( !this->m_CoefficientImages[ 0 ] )
+  {
+    return false;
+  }
+
+  /** Express the row in continuous grid indices, and find the grid axis
+   * along which it runs. The other grid indices may not drift along the row.
+   */
+  ContinuousIndexType rowStartIndex;
+  this->TransformPointToContinuousGridIndex( rowStart, rowStartIndex );
+  double       rowStepIndex[ SpaceDimension ];
+  unsigned int axis = 0;
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    rowStepIndex[ i ] = 0.0;
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      rowStepIndex[ i ] += this->m_PointToIndexMatrix[ i ][ j ] * rowStep[ j ];
+    }
+    if( std::abs( rowStepIndex[ i ] ) > std::abs( rowStepIndex[ axis ] ) )
+    {
+      axis = i;
+    }
+  }
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    if( i != axis && std::abs( rowStepIndex[ i ] ) * numberOfPoints > 1e-6 )
+    {
+      return false;
+    }
+  }
+
+  std::fill( displacements, displacements + numberOfPoints * SpaceDimension,
+    NumericTraits< ScalarType >::ZeroValue() );
+
+  /** Compute the start index and the 1D weights of the other axes. The
+   * whole row lies outside the valid region, if one of them does.
+   */
+  const unsigned int SupportSize = VSplineOrder + 1;
+  typedef BSplineKernelFunction2< VSplineOrder > KernelType;
+  typename KernelType::Pointer kernel = KernelType::New();
+
+  const IndexType & gridIndex = this->m_GridRegion.GetIndex();
+  const SizeType &  gridSize  = this->m_GridRegion.GetSize();
+  double            weights[ SpaceDimension ][ SupportSize ];
+  OffsetValueType   baseOffset = 0;
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    if( i == axis )
+    {
+      continue;
+    }
+    const double cindex = rowStartIndex[ i ];
+    if( cindex < this->m_ValidRegionBegin[ i ] || cindex >= this->m_ValidRegionEnd[ i ] )
+    {
+      return true;
+    }
+    const double start = std::floor( cindex - static_cast< double >( SupportSize - 2.0 ) / 2.0 );
+    kernel->Evaluate( cindex - start, weights[ i ] );
+    baseOffset += ( static_cast< OffsetValueType >( start ) - gridIndex[ i ] )
+      * this->m_GridOffsetTable[ i ];
+  }
+
+  /** Sum the coefficients over the support of the other axes, for all grid
+   * positions along the row axis.
+   */
+  const SizeValueType   gridLength = gridSize[ axis ];
+  const OffsetValueType axisStride = this->m_GridOffsetTable[ axis ];
+  std::vector< double > partialSums( SpaceDimension * gridLength, 0.0 );
+  const PixelType *     coefficients[ SpaceDimension ];
+  for( unsigned int d = 0; d < SpaceDimension; ++d )
+  {
+    coefficients[ d ] = this->m_CoefficientImages[ d ]->GetBufferPointer();
+  }
+
+  unsigned int supportIndex[ SpaceDimension ];
+  std::fill( supportIndex, supportIndex + SpaceDimension, 0u );
+  while( true )
+  {
+    /** The weight and the offset of this combination of support nodes. */
+    double          weight = 1.0;
+    OffsetValueType offset = baseOffset;
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      if( i != axis )
+      {
+        weight *= weights[ i ][ supportIndex[ i ] ];
+        offset += supportIndex[ i ] * this->m_GridOffsetTable[ i ];
+      }
+    }
+
+    for( unsigned int d = 0; d < SpaceDimension; ++d )
+    {
+      const PixelType * coefficient = coefficients[ d ] + offset;
+      double *          sums        = &partialSums[ d * gridLength ];
+      for( SizeValueType g = 0; g < gridLength; ++g )
+      {
+        sums[ g ] += weight * coefficient[ g * axisStride ];
+      }
+    }
+
+    /** Go to the next combination of support nodes. */
+    unsigned int i = 0;
+    for( ; i < SpaceDimension; ++i )
+    {
+      if( i == axis )
+      {
+        continue;
+      }
+      if( ++supportIndex[ i ] < SupportSize )
+      {
+        break;
+      }
+      supportIndex[ i ] = 0;
+    }
+    if( i == SpaceDimension )
+    {
+      break;
+    }
+  }
+
+  /** Each point now only needs the weights along the row axis. */
+  double axisWeights[ SupportSize ];
+  for( SizeValueType n = 0; n < numberOfPoints; ++n )
+  {
+    const double cindex = rowStartIndex[ axis ] + n * rowStepIndex[ axis ];
+    if( cindex < this->m_ValidRegionBegin[ axis ] || cindex >= this->m_ValidRegionEnd[ axis ] )
+    {
+      continue;
+    }
+    const double start = std::floor( cindex - static_cast< double >( SupportSize - 2.0 ) / 2.0 );
+    kernel->Evaluate( cindex - start, axisWeights );
+    const OffsetValueType first = static_cast< OffsetValueType >( start ) - gridIndex[ axis ];
+
+    ScalarType * displacement = displacements + n * SpaceDimension;
+    for( unsigned int d = 0; d < SpaceDimension; ++d )
+    {
+      const double * sums = &partialSums[ d * gridLength + first ];
+      double         sum  = 0.0;
+      for( unsigned int k = 0; k < SupportSize; ++k )
+      {
+        sum += axisWeights[ k ] * sums[ k ];
+      }
+      displacement[ d ] = static_cast< ScalarType >( sum );
+    }
+  }
+
+  return true;
+
+} // end ComputeDisplacementsAlongRow()
+
+
 /**
  * ********************* ComputeNonZeroJacobianIndices ****************************
  */
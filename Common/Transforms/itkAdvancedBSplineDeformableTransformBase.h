@@ -217,6 +217,45 @@ public:
   //itkGetMacro( GridOrigin, OriginType );
   itkGetConstMacro( GridOrigin, OriginType );
 
+  /** Announce that the transform will mostly be evaluated at the points of
+   * the regular lattice origin + direction * diag( spacing ) * k, with
+   * 0 <= k < size, e.g. the voxel centres of the fixed image. When this lattice is aligned with the
+   * control point grid and its spacing is a rational multiple of the grid
+   * spacing, subclasses precompute the 1D B-spline weights per axis, see
+   * GridAlignedBSplineWeightsTable. Points off the lattice are still handled
+   * correctly. Call this function again after changing the grid.
+   * Returns true when the weights are precomputed for at least one axis.
+   * The default implementation does nothing and returns false.
+   */
+  virtual bool SetGridAlignedSampleLattice( const OriginType & itkNotUsed( origin ),
+    const SpacingType & itkNotUsed( spacing ), const DirectionType & itkNotUsed( direction ),
+    const SizeType & itkNotUsed( size ) )
+  {
+    return false;
+  }
+
+
+  /** Discard the precomputed weights of SetGridAlignedSampleLattice(). */
+  virtual void ClearGridAlignedSampleLattice( void ) {}
+
+  /** Compute the displacements of the points rowStart + n * rowStep, for
+   * n = 0, ..., numberOfPoints - 1, on a row that is parallel to an axis of
+   * the control point grid. Along such a row the 1D weights of the other axes
+   * are constant, so subclasses sum the coefficients over these axes once per
+   * row, after which each point only needs the weights of the row axis.
+   * The displacements are stored as SpaceDimension values per point. Points
+   * outside the valid region get a zero displacement, as in TransformPoint().
+   * Returns false, without computing anything, when the row is not parallel
+   * to a grid axis. The default implementation returns false.
+   */
+  virtual bool ComputeDisplacementsAlongRow( const InputPointType & itkNotUsed( rowStart ),
+    const InputVectorType & itkNotUsed( rowStep ), const SizeValueType itkNotUsed( numberOfPoints ),
+    ScalarType * itkNotUsed( displacements ) ) const
+  {
+    return false;
+  }
+
+
   /** Parameter index array type. */
   typedef Array< unsigned long > ParameterIndexArrayType;
 
@@ -275,6 +314,11 @@ public:
     return Self::BSpline;
   }
 
+  /** Return whether the support region of the point lies inside the grid.
+   * Outside, TransformPoint() returns the point itself.
+   */
+  bool IsDefinedAt( const InputPointType & point ) const override;
+
 
   virtual unsigned int GetNumberOfAffectedWeights( void ) const = 0;
 
@@ -302,6 +346,14 @@ protected:
 
   void UpdatePointIndexConversions( void );
 
+  /** Express the lattice origin + direction * diag( spacing ) * k in
+   * continuous grid indices: latticeOrigin[ i ] + k[ i ] * latticeStep[ i ].
+   * Returns false when the lattice axes are not aligned with the grid axes.
+   */
+  bool ComputeSampleLatticeInGridIndices(
+    const OriginType & origin, const SpacingType & spacing, const DirectionType & direction,
+    double latticeOrigin[], double latticeStep[] ) const;
+
   virtual void ComputeNonZeroJacobianIndices(
     NonZeroJacobianIndicesType & nonZeroJacobianIndices,
     const RegionType & supportRegion ) const = 0;
@@ -22,6 +22,7 @@
 #include "itkContinuousIndex.h"
 #include "itkIdentityTransform.h"
 #include "vnl/vnl_math.h"
+#include <cmath>
 
 namespace itk
 {
@@ -605,6 +606,27 @@ AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
 }
 
 
+/**
+ * ********************* IsDefinedAt ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+bool
+AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
+::IsDefinedAt( const InputPointType & point ) const
+{
+  if( !this->m_CoefficientImages[ 0 ] )
+  {
+    return false;
+  }
+
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( point, cindex );
+  return this->InsideValidRegion( cindex );
+
+} // end IsDefinedAt()
+
+
 template< class TScalarType, unsigned int NDimensions >
 void
 AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
@@ -630,6 +652,58 @@ AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
 }
 
 
+
+/**
+ * ********************* ComputeSampleLatticeInGridIndices ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+bool
+AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
+::ComputeSampleLatticeInGridIndices(
+  const OriginType & origin, const SpacingType & spacing, const DirectionType & direction,
+  double latticeOrigin[], double latticeStep[] ) const
+{
+  /** The continuous grid index of the lattice origin. */
+  InputPointType point;
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    point[ i ] = origin[ i ];
+  }
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( point, cindex );
+
+  /** Map the lattice steps to grid indices. The lattice is aligned with the
+   * grid, when this mapping is diagonal.
+   */
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    latticeOrigin[ i ] = cindex[ i ];
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      double m = 0.0;
+      for( unsigned int k = 0; k < SpaceDimension; ++k )
+      {
+        m += this->m_PointToIndexMatrix[ i ][ k ] * direction[ k ][ j ];
+      }
+      m *= spacing[ j ];
+
+      if( i == j )
+      {
+        latticeStep[ i ] = m;
+      }
+      else if( std::abs( m ) > 1e-9 )
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+
+} // end ComputeSampleLatticeInGridIndices()
+
+
 } // namespace
 
 #endif
@@ -19,7 +19,9 @@
 #define __itkAdvancedCombinationTransform_h
 
 #include "itkAdvancedTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
 #include "itkExceptionObject.h"
+#include "itkImageBase.h"
 
 namespace itk
 {
@@ -49,6 +51,18 @@ namespace itk
  * Note: It is mandatory to set a current transform. An initial transform
  * is not mandatory.
  *
+ * When the initial transform is itself a (nested) chain of linear transforms,
+ * for example resulting from multiple parameter files or an initial transform
+ * file, CollapseLinearInitialTransform() may be called to fold this chain into
+ * a single matrix-offset transform, which is then used when evaluating this
+ * transform. The chain itself remains the initial transform, and the current
+ * transform is never folded, so the parameters and the Jacobians of this
+ * transform are unaffected.
+ *
+ * Similarly, SetBakedInitialTransform() may be used to evaluate this transform
+ * with an approximation of a nonlinear initial transform, for example a
+ * B-spline transform computed by the BakedBSplineTransformComputer.
+ *
  * \ingroup Transforms
  */
 
@@ -101,6 +115,9 @@ public:
   typedef typename Superclass::TransformCategoryType         TransformCategoryType;
   typedef typename Superclass::MovingImageGradientType       MovingImageGradientType;
   typedef typename Superclass::MovingImageGradientValueType  MovingImageGradientValueType;
+  typedef typename Superclass::InputCoordinateArraysType     InputCoordinateArraysType;
+  typedef typename Superclass::OutputCoordinateArraysType    OutputCoordinateArraysType;
+  typedef typename Superclass::ValidMaskValueType            ValidMaskValueType;
 
   /** Transform typedefs for the from Superclass. */
   typedef typename Superclass::TransformType   TransformType;
@@ -125,6 +142,15 @@ public:
   typedef typename CurrentTransformType::InverseTransformBasePointer
     CurrentTransformInverseTransformBasePointer;
 
+  /** Typedefs for the collapsed initial transform. */
+  typedef AdvancedMatrixOffsetTransformBase<
+    ScalarType, NDimensions, NDimensions >                 CollapsedInitialTransformType;
+  typedef typename CollapsedInitialTransformType::Pointer CollapsedInitialTransformPointer;
+
+  /** Typedefs for the domain of the baked initial transform. */
+  typedef ImageBase< NDimensions >                          BakedInitialTransformDomainType;
+  typedef typename BakedInitialTransformDomainType::ConstPointer BakedInitialTransformDomainConstPointer;
+
   /** Set/Get a pointer to the InitialTransform. */
   virtual void SetInitialTransform( InitialTransformType * _arg );
 
@@ -138,6 +164,39 @@ public:
 
   itkGetModifiableObjectMacro( CurrentTransform, CurrentTransformType );
 
+  /** Fold the initial transform into a single matrix-offset transform, if it
+   * is a linear AdvancedCombinationTransform. If the initial transform is a
+   * nonlinear AdvancedCombinationTransform, the call is forwarded to it, such
+   * that linear chains further down are folded. Returns true if this transform
+   * itself uses a collapsed initial transform.
+   * The folded transform is a snapshot: call this method again after the
+   * initial transform chain has changed. Setting a new initial transform
+   * discards the collapsed transform.
+   */
+  virtual bool CollapseLinearInitialTransform( void );
+
+  /** Get the collapsed initial transform, or null if not collapsed. */
+  itkGetConstObjectMacro( CollapsedInitialTransform, CollapsedInitialTransformType );
+
+  /** Set an approximation of the initial transform, that is used instead of
+   * the initial transform (and the collapsed initial transform) to evaluate
+   * this transform. Setting a null pointer, or a new initial transform,
+   * restores the exact evaluation.
+   *
+   * The approximation is only used inside the given domain, i.e. the physical
+   * extent of its largest possible region, including the half voxel border.
+   * Outside the domain the exact initial transform is used. Without a domain
+   * the approximation is used everywhere.
+   */
+  virtual void SetBakedInitialTransform( InitialTransformType * _arg,
+    const BakedInitialTransformDomainType * domain = nullptr );
+
+  /** Get the baked initial transform, or null if not set. */
+  itkGetModifiableObjectMacro( BakedInitialTransform, InitialTransformType );
+
+  /** Get the domain of the baked initial transform, or null if not set. */
+  itkGetConstObjectMacro( BakedInitialTransformDomain, BakedInitialTransformDomainType );
+
   /** Return the number of sub-transforms. */
   virtual SizeValueType GetNumberOfTransforms( void ) const;
 
@@ -160,6 +219,21 @@ public:
   /**  Method to transform a point. */
   OutputPointType TransformPoint( const InputPointType  & point ) const override;
 
+  /** Method to transform a batch of points. The batch is processed in chunks
+   * of at most NumberOfPointsPerChunk points. For each chunk the initial and
+   * the current transform each transform the whole chunk with their own
+   * (possibly specialized) TransformPoints(), using a small intermediate
+   * buffer on the stack. A point is valid when it is valid for both transforms.
+   */
+  void TransformPoints(
+    const InputCoordinateArraysType & inputCoordinates,
+    const OutputCoordinateArraysType & outputCoordinates,
+    const SizeValueType numberOfPoints,
+    ValidMaskValueType * validMask ) const override;
+
+  /** The maximum number of points of the intermediate buffer of TransformPoints(). */
+  itkStaticConstMacro( NumberOfPointsPerChunk, unsigned int, 256 );
+
   /** ITK4 change:
    * The following pure virtual functions must be overloaded.
    * For now just throw an exception, since these are not used in elastix.
@@ -233,6 +307,12 @@ public:
    * return DisplacementField category. */
   TransformCategoryType GetTransformCategory() const override;
 
+  /** Return whether both the initial and the current transform are defined
+   * in the point, i.e. in the point and, with composition, in its image under
+   * the initial transform.
+   */
+  bool IsDefinedAt( const InputPointType & point ) const override;
+
   /** Whether the advanced transform has nonzero matrices. */
   bool GetHasNonZeroSpatialHessian( void ) const override;
 
@@ -251,6 +331,11 @@ public:
     DerivativeType & imageJacobian,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const override;
 
+  /** Get the nonzero Jacobian indices of the current transform. */
+  void GetNonZeroJacobianIndices(
+    const InputPointType & ipp,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const override;
+
   /** Compute the spatial Jacobian of the transformation. */
   void GetSpatialJacobian(
     const InputPointType & ipp,
@@ -339,6 +424,27 @@ protected:
   InitialTransformPointer m_InitialTransform;
   CurrentTransformPointer m_CurrentTransform;
 
+  /** The initial transform folded into a single matrix and offset, an
+   * approximation of the initial transform, and the initial transform that is
+   * actually used to evaluate this transform: m_BakedInitialTransform if set,
+   * otherwise m_CollapsedInitialTransform if set, otherwise m_InitialTransform.
+   */
+  CollapsedInitialTransformPointer m_CollapsedInitialTransform;
+  InitialTransformPointer          m_BakedInitialTransform;
+  const InitialTransformType *     m_SelectedInitialTransform;
+
+  /** The domain of m_BakedInitialTransform, and the initial transform that is
+   * used outside that domain.
+   */
+  BakedInitialTransformDomainConstPointer m_BakedInitialTransformDomain;
+  const InitialTransformType *            m_ExactInitialTransform;
+
+  /** Update m_SelectedInitialTransform and m_ExactInitialTransform. */
+  virtual void UpdateSelectedInitialTransform( void );
+
+  /** Return the initial transform to be used at the given point. */
+  const InitialTransformType * GetInitialTransformAt( const InputPointType & ipp ) const;
+
   /** Set the SelectedTransformPointFunction and the
    * SelectedGetJacobianFunction.
    */
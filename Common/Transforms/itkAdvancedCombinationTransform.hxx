@@ -32,8 +32,12 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 ::AdvancedCombinationTransform() : Superclass( NDimensions )
 {
   /** Initialize. */
-  this->m_InitialTransform = 0;
-  this->m_CurrentTransform = 0;
+  this->m_InitialTransform          = 0;
+  this->m_CurrentTransform          = 0;
+  this->m_CollapsedInitialTransform = 0;
+  this->m_BakedInitialTransform     = 0;
+  this->m_SelectedInitialTransform  = 0;
+  this->m_ExactInitialTransform     = 0;
 
   /** Set composition by default. */
   this->m_UseAddition    = false;
@@ -240,6 +244,39 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end IsLinear()
 
 
+/**
+ * ***************** IsDefinedAt **************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+bool
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::IsDefinedAt( const InputPointType & point ) const
+{
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+    return false;
+  }
+  if( this->m_InitialTransform.IsNull() )
+  {
+    return this->m_CurrentTransform->IsDefinedAt( point );
+  }
+
+  const InitialTransformType * initialTransform = this->GetInitialTransformAt( point );
+  if( !initialTransform->IsDefinedAt( point ) )
+  {
+    return false;
+  }
+  if( this->m_UseAddition )
+  {
+    return this->m_CurrentTransform->IsDefinedAt( point );
+  }
+  return this->m_CurrentTransform->IsDefinedAt( initialTransform->TransformPoint( point ) );
+
+} // end IsDefinedAt()
+
+
 /**
  * ***************** GetTransformCategory **************************
  */
@@ -547,7 +584,11 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   /** Set the the initial transform and call the UpdateCombinationMethod. */
   if( this->m_InitialTransform != _arg )
   {
-    this->m_InitialTransform = _arg;
+    this->m_InitialTransform          = _arg;
+    this->m_CollapsedInitialTransform = 0;
+    this->m_BakedInitialTransform     = 0;
+    this->m_BakedInitialTransformDomain = 0;
+    this->UpdateSelectedInitialTransform();
     this->Modified();
     this->UpdateCombinationMethod();
   }
@@ -555,6 +596,159 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end SetInitialTransform()
 
 
+/**
+ * ******************* CollapseLinearInitialTransform **********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+bool
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::CollapseLinearInitialTransform( void )
+{
+  /** Discard a previously collapsed initial transform. */
+  this->m_CollapsedInitialTransform = 0;
+  this->UpdateSelectedInitialTransform();
+
+  /** Only chains of transforms are collapsed. A single initial
+   * transform is already evaluated directly.
+   */
+  Self * initialAsCombination
+    = dynamic_cast< Self * >( this->m_InitialTransform.GetPointer() );
+  if( initialAsCombination == 0 )
+  {
+    return false;
+  }
+
+  /** If the chain is not linear as a whole, it may still contain
+   * linear sub-chains further down.
+   */
+  if( !initialAsCombination->IsLinear() )
+  {
+    initialAsCombination->CollapseLinearInitialTransform();
+    return false;
+  }
+
+  /** The chain is an affine map T0(x) = A x + t. So t = T0(0), and
+   * the j-th column of A equals T0(e_j) - T0(0).
+   */
+  InputPointType point;
+  point.Fill( NumericTraits< ScalarType >::ZeroValue() );
+  const OutputPointType origin = initialAsCombination->TransformPoint( point );
+
+  typename CollapsedInitialTransformType::MatrixType matrix;
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    point[ j ] = NumericTraits< ScalarType >::OneValue();
+    const OutputPointType column = initialAsCombination->TransformPoint( point );
+    point[ j ] = NumericTraits< ScalarType >::ZeroValue();
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      matrix[ i ][ j ] = column[ i ] - origin[ i ];
+    }
+  }
+
+  OutputVectorType offset;
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    offset[ i ] = origin[ i ];
+  }
+
+  this->m_CollapsedInitialTransform = CollapsedInitialTransformType::New();
+  this->m_CollapsedInitialTransform->SetMatrix( matrix );
+  this->m_CollapsedInitialTransform->SetOffset( offset );
+  this->UpdateSelectedInitialTransform();
+
+  return true;
+
+} // end CollapseLinearInitialTransform()
+
+
+/**
+ * ******************* SetBakedInitialTransform **********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::SetBakedInitialTransform( InitialTransformType * _arg,
+  const BakedInitialTransformDomainType * domain )
+{
+  if( this->m_BakedInitialTransform != _arg
+    || this->m_BakedInitialTransformDomain != domain )
+  {
+    this->m_BakedInitialTransform       = _arg;
+    this->m_BakedInitialTransformDomain = domain;
+    this->UpdateSelectedInitialTransform();
+    this->Modified();
+  }
+
+} // end SetBakedInitialTransform()
+
+
+/**
+ * ******************* UpdateSelectedInitialTransform **********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::UpdateSelectedInitialTransform( void )
+{
+  if( this->m_CollapsedInitialTransform.IsNotNull() )
+  {
+    this->m_ExactInitialTransform = this->m_CollapsedInitialTransform.GetPointer();
+  }
+  else
+  {
+    this->m_ExactInitialTransform = this->m_InitialTransform.GetPointer();
+  }
+
+  if( this->m_BakedInitialTransform.IsNotNull() )
+  {
+    this->m_SelectedInitialTransform = this->m_BakedInitialTransform.GetPointer();
+  }
+  else
+  {
+    this->m_SelectedInitialTransform = this->m_ExactInitialTransform;
+  }
+
+} // end UpdateSelectedInitialTransform()
+
+
+/**
+ * ******************* GetInitialTransformAt **********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+const typename AdvancedCombinationTransform< TScalarType, NDimensions >::InitialTransformType *
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::GetInitialTransformAt( const InputPointType & ipp ) const
+{
+  /** The baked initial transform is only valid inside its domain. */
+  if( this->m_BakedInitialTransformDomain.IsNull()
+    || this->m_SelectedInitialTransform != this->m_BakedInitialTransform.GetPointer() )
+  {
+    return this->m_SelectedInitialTransform;
+  }
+
+  ContinuousIndex< ScalarType, NDimensions > cindex;
+  this->m_BakedInitialTransformDomain->TransformPhysicalPointToContinuousIndex( ipp, cindex );
+  const typename BakedInitialTransformDomainType::RegionType & region
+    = this->m_BakedInitialTransformDomain->GetLargestPossibleRegion();
+  for( unsigned int d = 0; d < SpaceDimension; ++d )
+  {
+    const double first = static_cast< double >( region.GetIndex()[ d ] ) - 0.5;
+    const double last  = first + static_cast< double >( region.GetSize()[ d ] );
+    if( cindex[ d ] < first || cindex[ d ] > last )
+    {
+      return this->m_ExactInitialTransform;
+    }
+  }
+  return this->m_SelectedInitialTransform;
+
+} // end GetInitialTransformAt()
+
+
 /**
  * ******************* SetCurrentTransform **********************
  */
@@ -771,7 +965,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 {
   /** The Initial transform. */
   OutputPointType out0
-    = this->m_InitialTransform->TransformPoint( point );
+    = this->GetInitialTransformAt( point )->TransformPoint( point );
 
   /** The Current transform. */
   OutputPointType out
@@ -798,7 +992,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 ::TransformPointUseComposition( const InputPointType & point ) const
 {
   return this->m_CurrentTransform->TransformPoint(
-    this->m_InitialTransform->TransformPoint( point ) );
+    this->GetInitialTransformAt( point )->TransformPoint( point ) );
 
 } // end TransformPointUseComposition()
 
@@ -865,7 +1059,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
 {
   this->m_CurrentTransform->GetJacobian(
-    this->m_InitialTransform->TransformPoint( ipp ),
+    this->GetInitialTransformAt( ipp )->TransformPoint( ipp ),
     j, nonZeroJacobianIndices );
 
 } // end GetJacobianUseComposition()
@@ -939,7 +1133,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
 {
   this->m_CurrentTransform->EvaluateJacobianWithImageGradientProduct(
-    this->m_InitialTransform->TransformPoint( ipp ),
+    this->GetInitialTransformAt( ipp )->TransformPoint( ipp ),
     movingImageGradient, imageJacobian, nonZeroJacobianIndices );
 
 } // end EvaluateJacobianWithImageGradientProductUseComposition()
@@ -995,7 +1189,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   SpatialJacobianType & sj ) const
 {
   SpatialJacobianType sj0, sj1, identity;
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
+  this->GetInitialTransformAt( ipp )->GetSpatialJacobian( ipp, sj0 );
   this->m_CurrentTransform->GetSpatialJacobian( ipp, sj1 );
   identity.SetIdentity();
   sj = sj0 + sj1 - identity;
@@ -1015,9 +1209,9 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   SpatialJacobianType & sj ) const
 {
   SpatialJacobianType sj0, sj1;
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
+  this->GetInitialTransformAt( ipp )->GetSpatialJacobian( ipp, sj0 );
   this->m_CurrentTransform->GetSpatialJacobian(
-    this->m_InitialTransform->TransformPoint( ipp ), sj1 );
+    this->GetInitialTransformAt( ipp )->TransformPoint( ipp ), sj1 );
 
   sj = sj1 * sj0;
 
@@ -1069,7 +1263,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   SpatialHessianType & sh ) const
 {
   SpatialHessianType sh0, sh1;
-  this->m_InitialTransform->GetSpatialHessian( ipp, sh0 );
+  this->GetInitialTransformAt( ipp )->GetSpatialHessian( ipp, sh0 );
   this->m_CurrentTransform->GetSpatialHessian( ipp, sh1 );
 
   for( unsigned int i = 0; i < SpaceDimension; ++i )
@@ -1098,14 +1292,14 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   /** Transform the input point. */
   // \todo this has already been computed and it is expensive.
   InputPointType transformedPoint
-    = this->m_InitialTransform->TransformPoint( ipp );
+    = this->GetInitialTransformAt( ipp )->TransformPoint( ipp );
 
   /** Compute the (Jacobian of the) spatial Jacobian / Hessian of the
    * internal transforms.
    */
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
+  this->GetInitialTransformAt( ipp )->GetSpatialJacobian( ipp, sj0 );
   this->m_CurrentTransform->GetSpatialJacobian( transformedPoint, sj1 );
-  this->m_InitialTransform->GetSpatialHessian( ipp, sh0 );
+  this->GetInitialTransformAt( ipp )->GetSpatialHessian( ipp, sh0 );
   this->m_CurrentTransform->GetSpatialHessian( transformedPoint, sh1 );
 
   typename SpatialJacobianType::InternalMatrixType sj0tvnl = sj0.GetTranspose();
@@ -1209,9 +1403,9 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 {
   SpatialJacobianType           sj0;
   JacobianOfSpatialJacobianType jsj1;
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
+  this->GetInitialTransformAt( ipp )->GetSpatialJacobian( ipp, sj0 );
   this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
-    this->m_InitialTransform->TransformPoint( ipp ),
+    this->GetInitialTransformAt( ipp )->TransformPoint( ipp ),
     jsj1, nonZeroJacobianIndices );
 
   jsj.resize( nonZeroJacobianIndices.size() );
@@ -1238,9 +1432,9 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 {
   SpatialJacobianType           sj0, sj1;
   JacobianOfSpatialJacobianType jsj1;
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
+  this->GetInitialTransformAt( ipp )->GetSpatialJacobian( ipp, sj0 );
   this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
-    this->m_InitialTransform->TransformPoint( ipp ),
+    this->GetInitialTransformAt( ipp )->TransformPoint( ipp ),
     sj1, jsj1, nonZeroJacobianIndices );
 
   sj = sj1 * sj0;
@@ -1385,12 +1579,12 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   /** Transform the input point. */
   // \todo: this has already been computed and it is expensive.
   InputPointType transformedPoint
-    = this->m_InitialTransform->TransformPoint( ipp );
+    = this->GetInitialTransformAt( ipp )->TransformPoint( ipp );
 
   /** Compute the (Jacobian of the) spatial Jacobian / Hessian of the
    * internal transforms. */
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
-  this->m_InitialTransform->GetSpatialHessian( ipp, sh0 );
+  this->GetInitialTransformAt( ipp )->GetSpatialJacobian( ipp, sj0 );
+  this->GetInitialTransformAt( ipp )->GetSpatialHessian( ipp, sh0 );
 
   /** Assume/demand that GetJacobianOfSpatialJacobian returns
    * the same nonZeroJacobianIndices as the GetJacobianOfSpatialHessian. */
@@ -1413,7 +1607,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
     }
   }
 
-  if( this->m_InitialTransform->GetHasNonZeroSpatialHessian() )
+  if( this->GetInitialTransformAt( ipp )->GetHasNonZeroSpatialHessian() )
   {
     for( unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu )
     {
@@ -1452,13 +1646,13 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   /** Transform the input point. */
   // \todo this has already been computed and it is expensive.
   InputPointType transformedPoint
-    = this->m_InitialTransform->TransformPoint( ipp );
+    = this->GetInitialTransformAt( ipp )->TransformPoint( ipp );
 
   /** Compute the (Jacobian of the) spatial Jacobian / Hessian of the
    * internal transforms.
    */
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
-  this->m_InitialTransform->GetSpatialHessian( ipp, sh0 );
+  this->GetInitialTransformAt( ipp )->GetSpatialJacobian( ipp, sj0 );
+  this->GetInitialTransformAt( ipp )->GetSpatialHessian( ipp, sh0 );
 
   /** Assume/demand that GetJacobianOfSpatialJacobian returns the same
    * nonZeroJacobianIndices as the GetJacobianOfSpatialHessian.
@@ -1481,7 +1675,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
     }
   }
 
-  if( this->m_InitialTransform->GetHasNonZeroSpatialHessian() )
+  if( this->GetInitialTransformAt( ipp )->GetHasNonZeroSpatialHessian() )
   {
     for( unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu )
     {
@@ -1501,7 +1695,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
     sh[ dim ] = sj0t * ( sh1[ dim ] * sj0 );
   }
 
-  if( this->m_InitialTransform->GetHasNonZeroSpatialHessian() )
+  if( this->GetInitialTransformAt( ipp )->GetHasNonZeroSpatialHessian() )
   {
     for( unsigned int dim = 0; dim < SpaceDimension; ++dim )
     {
@@ -1613,6 +1807,117 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end TransformPoint()
 
 
+/**
+ * ****************** TransformPoints ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::TransformPoints(
+  const InputCoordinateArraysType & inputCoordinates,
+  const OutputCoordinateArraysType & outputCoordinates,
+  const SizeValueType numberOfPoints,
+  ValidMaskValueType * validMask ) const
+{
+  /** Handle the cases that need no intermediate buffer. */
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+    return;
+  }
+  if( this->m_InitialTransform.IsNull() )
+  {
+    this->m_CurrentTransform->TransformPoints(
+      inputCoordinates, outputCoordinates, numberOfPoints, validMask );
+    return;
+  }
+
+  /** The intermediate results of the initial transform, per chunk. */
+  const unsigned int chunkSize = Self::NumberOfPointsPerChunk;
+  ScalarType         buffer[ SpaceDimension ][ chunkSize ];
+  ValidMaskValueType initialMask[ chunkSize ];
+  ValidMaskValueType currentMask[ chunkSize ];
+
+  InputCoordinateArraysType  chunkInput;
+  OutputCoordinateArraysType chunkOutput;
+  InputCoordinateArraysType  chunkBufferInput;
+  OutputCoordinateArraysType chunkBufferOutput;
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    chunkBufferInput[ j ]  = buffer[ j ];
+    chunkBufferOutput[ j ] = buffer[ j ];
+  }
+
+  for( SizeValueType begin = 0; begin < numberOfPoints; begin += chunkSize )
+  {
+    const SizeValueType size = std::min< SizeValueType >( chunkSize, numberOfPoints - begin );
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      chunkInput[ j ]  = inputCoordinates[ j ] + begin;
+      chunkOutput[ j ] = outputCoordinates[ j ] + begin;
+    }
+
+    /** The initial transform always goes first, into the buffer. */
+    this->m_SelectedInitialTransform->TransformPoints( chunkInput, chunkBufferOutput, size, initialMask );
+
+    /** Outside its domain, the baked initial transform is replaced by the exact one. */
+    if( this->m_BakedInitialTransformDomain.IsNotNull()
+      && this->m_SelectedInitialTransform == this->m_BakedInitialTransform.GetPointer() )
+    {
+      InputPointType ipp;
+      for( SizeValueType n = 0; n < size; ++n )
+      {
+        for( unsigned int j = 0; j < SpaceDimension; ++j )
+        {
+          ipp[ j ] = chunkInput[ j ][ n ];
+        }
+        const InitialTransformType * initialTransform = this->GetInitialTransformAt( ipp );
+        if( initialTransform != this->m_SelectedInitialTransform )
+        {
+          const OutputPointType opp = initialTransform->TransformPoint( ipp );
+          for( unsigned int j = 0; j < SpaceDimension; ++j )
+          {
+            buffer[ j ][ n ] = opp[ j ];
+          }
+          initialMask[ n ] = initialTransform->IsDefinedAt( ipp ) ? 1 : 0;
+        }
+      }
+    }
+
+    if( this->m_UseAddition )
+    {
+      /** ADDITION: T(x) = T_0(x) + T_1(x) - x */
+      this->m_CurrentTransform->TransformPoints( chunkInput, chunkOutput, size, currentMask );
+      for( unsigned int j = 0; j < SpaceDimension; ++j )
+      {
+        const ScalarType * in  = chunkInput[ j ];
+        const ScalarType * b   = buffer[ j ];
+        ScalarType *       out = chunkOutput[ j ];
+        for( SizeValueType n = 0; n < size; ++n )
+        {
+          out[ n ] += b[ n ] - in[ n ];
+        }
+      }
+    }
+    else
+    {
+      /** COMPOSITION: T(x) = T_1( T_0(x) ) */
+      this->m_CurrentTransform->TransformPoints( chunkBufferInput, chunkOutput, size, currentMask );
+    }
+
+    if( validMask != nullptr )
+    {
+      for( SizeValueType n = 0; n < size; ++n )
+      {
+        validMask[ begin + n ] = initialMask[ n ] & currentMask[ n ];
+      }
+    }
+  }
+
+} // end TransformPoints()
+
+
 /**
  * ****************** GetJacobian ****************************
  */
@@ -1652,6 +1957,40 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end EvaluateJacobianWithImageGradientProduct()
 
 
+/**
+ * ********************* GetNonZeroJacobianIndices ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::GetNonZeroJacobianIndices(
+  const InputPointType & ipp,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    /** Throw an exception. */
+    this->NoCurrentTransformSet();
+  }
+
+  /** With composition the current transform is evaluated in the
+   * initially transformed point, as in GetJacobianUseComposition().
+   * The baked initial transform is used inside its domain, like there.
+   */
+  if( this->m_InitialTransform.IsNotNull() && !this->m_UseAddition )
+  {
+    this->m_CurrentTransform->GetNonZeroJacobianIndices(
+      this->GetInitialTransformAt( ipp )->TransformPoint( ipp ), nonZeroJacobianIndices );
+  }
+  else
+  {
+    this->m_CurrentTransform->GetNonZeroJacobianIndices( ipp, nonZeroJacobianIndices );
+  }
+
+} // end GetNonZeroJacobianIndices()
+
+
 /**
  * ****************** GetSpatialJacobian ****************************
  */
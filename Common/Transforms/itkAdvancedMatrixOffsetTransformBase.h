@@ -146,6 +146,9 @@ public:
   typedef typename Superclass
     ::JacobianOfSpatialHessianType JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType InternalMatrixType;
+  typedef typename Superclass::InputCoordinateArraysType  InputCoordinateArraysType;
+  typedef typename Superclass::OutputCoordinateArraysType OutputCoordinateArraysType;
+  typedef typename Superclass::ValidMaskValueType         ValidMaskValueType;
 
   /** Standard matrix type for this class. */
   typedef Matrix< TScalarType,
@@ -343,6 +346,16 @@ public:
    */
   OutputPointType     TransformPoint( const InputPointType & point ) const override;
 
+  /** Transform a batch of points. The matrix and offset are copied to local
+   * variables once, after which each output coordinate is a plain
+   * multiply-add loop over all points, which the compiler vectorizes.
+   */
+  void TransformPoints(
+    const InputCoordinateArraysType & inputCoordinates,
+    const OutputCoordinateArraysType & outputCoordinates,
+    const SizeValueType numberOfPoints,
+    ValidMaskValueType * validMask ) const override;
+
   OutputVectorType    TransformVector( const InputVectorType & vector ) const override;
 
   OutputVnlVectorType TransformVector( const InputVnlVectorType & vector ) const override;
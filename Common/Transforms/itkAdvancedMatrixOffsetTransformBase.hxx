@@ -264,6 +264,62 @@ AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensi
 }
 
 
+// Transform a batch of points
+template< class TScalarType, unsigned int NInputDimensions,
+unsigned int NOutputDimensions >
+void
+AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensions >
+::TransformPoints(
+  const InputCoordinateArraysType & inputCoordinates,
+  const OutputCoordinateArraysType & outputCoordinates,
+  const SizeValueType numberOfPoints,
+  ValidMaskValueType * validMask ) const
+{
+  /** Copy the matrix and offset to local variables, so that the compiler
+   * knows they do not alias the output arrays.
+   */
+  ScalarType matrix[ OutputSpaceDimension ][ InputSpaceDimension ];
+  for( unsigned int i = 0; i < OutputSpaceDimension; ++i )
+  {
+    for( unsigned int j = 0; j < InputSpaceDimension; ++j )
+    {
+      matrix[ i ][ j ] = this->m_Matrix[ i ][ j ];
+    }
+  }
+
+  /** Compute the output coordinates one dimension at a time. The inner loop
+   * over the points has unit stride and no dependencies between iterations.
+   */
+  for( unsigned int i = 0; i < OutputSpaceDimension; ++i )
+  {
+    const ScalarType offset = this->m_Offset[ i ];
+    ScalarType *     out    = outputCoordinates[ i ];
+
+    for( SizeValueType n = 0; n < numberOfPoints; ++n )
+    {
+      out[ n ] = offset;
+    }
+
+    for( unsigned int j = 0; j < InputSpaceDimension; ++j )
+    {
+      const ScalarType   mij = matrix[ i ][ j ];
+      const ScalarType * in  = inputCoordinates[ j ];
+      for( SizeValueType n = 0; n < numberOfPoints; ++n )
+      {
+        out[ n ] += mij * in[ n ];
+      }
+    }
+  }
+
+  /** An affine transformation is defined everywhere. */
+  if( validMask != nullptr )
+  {
+    std::fill( validMask, validMask + numberOfPoints, ValidMaskValueType( 1 ) );
+  }
+
+} // end TransformPoints()
+
+
 // Transform a vector
 template< class TScalarType, unsigned int NInputDimensions,
 unsigned int NOutputDimensions >
@@ -158,9 +158,49 @@ public:
   typedef OutputCovariantVectorType                   MovingImageGradientType;
   typedef typename MovingImageGradientType::ValueType MovingImageGradientValueType;
 
+  /** Types for the batched TransformPoints(). The points are stored in a
+   * structure-of-arrays layout: coordinates[ d ][ i ] is the d-th coordinate
+   * of point i. The valid mask stores one byte per point.
+   */
+  typedef FixedArray< const ScalarType *, InputSpaceDimension > InputCoordinateArraysType;
+  typedef FixedArray< ScalarType *, OutputSpaceDimension >      OutputCoordinateArraysType;
+  typedef unsigned char                                         ValidMaskValueType;
+
+  /** Transform a batch of numberOfPoints points, given in structure-of-arrays
+   * layout. The output arrays must not overlap with the input arrays.
+   * If validMask is not a null pointer, validMask[ i ] is set to 1 when the
+   * transformation is defined in point i, and to 0 otherwise (e.g. when the
+   * B-spline support region falls outside the control point grid), see
+   * IsDefinedAt(). As in TransformPoint(), such points are mapped anyway,
+   * typically onto themselves.
+   *
+   * The default implementation simply calls TransformPoint(), and for the
+   * valid mask IsDefinedAt(), for each point. Transforms that can evaluate
+   * many points at once more efficiently, should override this function.
+   */
+  virtual void TransformPoints(
+    const InputCoordinateArraysType & inputCoordinates,
+    const OutputCoordinateArraysType & outputCoordinates,
+    const SizeValueType numberOfPoints,
+    ValidMaskValueType * validMask ) const;
+
+  /** Return whether the transformation is defined in the given point. By
+   * default it is defined everywhere; transforms with a bounded support,
+   * such as B-spline transforms, override this function.
+   */
+  virtual bool IsDefinedAt( const InputPointType & ) const { return true; }
+
   /** Get the number of nonzero Jacobian indices. By default all. */
   virtual NumberOfParametersType GetNumberOfNonZeroJacobianIndices( void ) const;
 
+  /** Get the nonzero Jacobian indices in the given point, without computing
+   * the Jacobian itself. By default they are obtained from GetJacobian();
+   * transforms with a local support override this with a cheaper version.
+   */
+  virtual void GetNonZeroJacobianIndices(
+    const InputPointType & ipp,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
   /** Whether the advanced transform has nonzero matrices. */
   itkGetConstMacro( HasNonZeroSpatialHessian, bool );
   itkGetConstMacro( HasNonZeroJacobianOfSpatialHessian, bool );
@@ -67,6 +67,43 @@ AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
 } // end Constructor
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::TransformPoints(
+  const InputCoordinateArraysType & inputCoordinates,
+  const OutputCoordinateArraysType & outputCoordinates,
+  const SizeValueType numberOfPoints,
+  ValidMaskValueType * validMask ) const
+{
+  InputPointType inputPoint;
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    for( unsigned int d = 0; d < InputSpaceDimension; ++d )
+    {
+      inputPoint[ d ] = inputCoordinates[ d ][ i ];
+    }
+
+    const OutputPointType outputPoint = this->TransformPoint( inputPoint );
+
+    for( unsigned int d = 0; d < OutputSpaceDimension; ++d )
+    {
+      outputCoordinates[ d ][ i ] = outputPoint[ d ];
+    }
+
+    if( validMask != nullptr )
+    {
+      validMask[ i ] = this->IsDefinedAt( inputPoint ) ? 1 : 0;
+    }
+  }
+
+} // end TransformPoints()
+
+
 /**
  * ********************* EvaluateJacobianWithImageGradientProduct ****************************
  */
@@ -121,6 +158,23 @@ AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
 } // end GetNumberOfNonZeroJacobianIndices()
 
 
+/**
+ * ********************* GetNonZeroJacobianIndices ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::GetNonZeroJacobianIndices(
+  const InputPointType & ipp,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  JacobianType jacobian;
+  this->GetJacobian( ipp, jacobian, nonZeroJacobianIndices );
+
+} // end GetNonZeroJacobianIndices()
+
+
 } // end namespace itk
 
 #endif
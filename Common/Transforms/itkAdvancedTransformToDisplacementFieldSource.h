@@ -0,0 +1,213 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkAdvancedTransformToDisplacementFieldSource_h
+#define __itkAdvancedTransformToDisplacementFieldSource_h
+
+#include "itkAdvancedTransform.h"
+#include "itkImageSource.h"
+#include "itkAdvancedBSplineDeformableTransformBase.h"
+#include "itkArray.h"
+
+namespace itk
+{
+
+/** \class AdvancedTransformToDisplacementFieldSource
+ * \brief Generate the displacement field T(x) - x of a coordinate transform.
+ *
+ * This filter produces the same output as the TransformToDisplacementFieldFilter,
+ * but evaluates B-spline transforms row by row. When the transform is an
+ * AdvancedBSplineDeformableTransform (or a RecursiveBSplineTransform), possibly
+ * combined with a linear initial transform, and the rows of the output grid are
+ * parallel to an axis of the control point grid, the 1D weights of the other
+ * axes are constant along each row. The coefficients are then summed over these
+ * axes once per row, see AdvancedBSplineDeformableTransformBase::ComputeDisplacementsAlongRow(),
+ * after which each voxel only needs the weights of the row axis. Other
+ * transforms, and rows that are not aligned, are evaluated voxel by voxel.
+ *
+ * Output information (spacing, size and direction) for the output
+ * image should be set, as for the TransformToDeterminantOfSpatialJacobianSource.
+ *
+ * This filter is implemented as a multithreaded filter. It provides a
+ * ThreadedGenerateData() method for its implementation.
+ *
+ * \ingroup GeometricTransforms
+ */
+template< class TOutputImage,
+class TTransformPrecisionType = double >
+class AdvancedTransformToDisplacementFieldSource :
+  public ImageSource< TOutputImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef AdvancedTransformToDisplacementFieldSource Self;
+  typedef ImageSource< TOutputImage >                Superclass;
+  typedef SmartPointer< Self >                       Pointer;
+  typedef SmartPointer< const Self >                 ConstPointer;
+
+  typedef TOutputImage                           OutputImageType;
+  typedef typename OutputImageType::Pointer      OutputImagePointer;
+  typedef typename OutputImageType::ConstPointer OutputImageConstPointer;
+  typedef typename OutputImageType::RegionType   OutputImageRegionType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( AdvancedTransformToDisplacementFieldSource, ImageSource );
+
+  /** Number of dimensions. */
+  itkStaticConstMacro( ImageDimension, unsigned int,
+    TOutputImage::ImageDimension );
+
+  /** Typedefs for transform. */
+  typedef AdvancedTransform< TTransformPrecisionType,
+    itkGetStaticConstMacro( ImageDimension ),
+    itkGetStaticConstMacro( ImageDimension ) >     TransformType;
+  typedef typename TransformType::ConstPointer        TransformPointerType;
+  typedef AdvancedBSplineDeformableTransformBase< TTransformPrecisionType,
+    itkGetStaticConstMacro( ImageDimension ) >     BSplineTransformType;
+  typedef typename TransformType::SpatialJacobianType SpatialJacobianType;
+  typedef typename TransformType::InputPointType      InputPointType;
+  typedef typename TransformType::InputVectorType     InputVectorType;
+
+  /** Typedefs for output image. */
+  typedef typename OutputImageType::PixelType     PixelType;
+  typedef typename PixelType::ValueType           PixelValueType;
+  typedef typename OutputImageType::RegionType    RegionType;
+  typedef typename RegionType::SizeType           SizeType;
+  typedef typename OutputImageType::IndexType     IndexType;
+  typedef typename OutputImageType::PointType     PointType;
+  typedef typename OutputImageType::SpacingType   SpacingType;
+  typedef typename OutputImageType::PointType     OriginType;
+  typedef typename OutputImageType::DirectionType DirectionType;
+
+  /** Typedefs for base image. */
+  typedef ImageBase< itkGetStaticConstMacro( ImageDimension ) > ImageBaseType;
+
+  /** Set the coordinate transformation. */
+  itkSetConstObjectMacro( Transform, TransformType );
+
+  /** Get a pointer to the coordinate transform. */
+  itkGetConstObjectMacro( Transform, TransformType );
+
+  /** Set the size of the output image. */
+  virtual void SetOutputSize( const SizeType & size );
+
+  /** Get the size of the output image. */
+  virtual const SizeType & GetOutputSize();
+
+  /** Set the start index of the output largest possible region.
+  * The default is an index of all zeros. */
+  virtual void SetOutputIndex( const IndexType & index );
+
+  /** Get the start index of the output largest possible region. */
+  virtual const IndexType & GetOutputIndex();
+
+  /** Set the region of the output image. */
+  itkSetMacro( OutputRegion, OutputImageRegionType );
+
+  /** Get the region of the output image. */
+  itkGetConstReferenceMacro( OutputRegion, OutputImageRegionType );
+
+  /** Set the output image spacing. */
+  itkSetMacro( OutputSpacing, SpacingType );
+  virtual void SetOutputSpacing( const double * values );
+
+  /** Get the output image spacing. */
+  itkGetConstReferenceMacro( OutputSpacing, SpacingType );
+
+  /** Set the output image origin. */
+  itkSetMacro( OutputOrigin, OriginType );
+  virtual void SetOutputOrigin( const double * values );
+
+  /** Get the output image origin. */
+  itkGetConstReferenceMacro( OutputOrigin, OriginType );
+
+  /** Set the output direction cosine matrix. */
+  itkSetMacro( OutputDirection, DirectionType );
+  itkGetConstReferenceMacro( OutputDirection, DirectionType );
+
+  /** Helper method to set the output parameters based on this image */
+  void SetOutputParametersFromImage( const ImageBaseType * image );
+
+  /** Get the number of rows that were evaluated along the B-spline grid,
+   * instead of voxel by voxel, available after the update.
+   */
+  itkGetConstMacro( NumberOfRowsAlongGrid, SizeValueType );
+
+  /** AdvancedTransformToDisplacementFieldSource produces a vector image. */
+  void GenerateOutputInformation( void ) override;
+
+  /** Checking if transform is set, and finding the B-spline transform. */
+  void BeforeThreadedGenerateData( void ) override;
+
+  /** Gather the number of rows evaluated along the grid by the threads. */
+  void AfterThreadedGenerateData( void ) override;
+
+  /** Compute the Modified Time based on changes to the components. */
+  ModifiedTimeType GetMTime( void ) const override;
+
+protected:
+
+  AdvancedTransformToDisplacementFieldSource();
+  ~AdvancedTransformToDisplacementFieldSource() override {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+  /** AdvancedTransformToDisplacementFieldSource is implemented as a
+   * multithreaded filter.
+   */
+  void ThreadedGenerateData(
+    const OutputImageRegionType & outputRegionForThread,
+    ThreadIdType threadId ) override;
+
+private:
+
+  AdvancedTransformToDisplacementFieldSource( const Self & ); // purposely not implemented
+  void operator=( const Self & );                             // purposely not implemented
+
+  /** Member variables. */
+  RegionType           m_OutputRegion;         // region of the output image
+  TransformPointerType m_Transform;            // Coordinate transform to use
+  SpacingType          m_OutputSpacing;        // output image spacing
+  OriginType           m_OutputOrigin;         // output image origin
+  DirectionType        m_OutputDirection;      // output image direction cosines
+
+  /** The B-spline transform that is evaluated row by row, if any, and the
+   * linear initial transform A x + b that is combined with it.
+   */
+  const BSplineTransformType * m_BSplineTransform;
+  bool                         m_HasLinearInitialTransform;
+  bool                         m_UseComposition;
+  SpatialJacobianType          m_InitialMatrix;
+  InputVectorType              m_InitialOffset;
+
+  /** The number of rows evaluated along the grid, in total and per thread. */
+  SizeValueType          m_NumberOfRowsAlongGrid;
+  Array< SizeValueType > m_ThreadNumberOfRowsAlongGrid;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkAdvancedTransformToDisplacementFieldSource.hxx"
+#endif
+
+#endif // end #ifndef __itkAdvancedTransformToDisplacementFieldSource_h
@@ -0,0 +1,422 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkAdvancedTransformToDisplacementFieldSource_hxx
+#define __itkAdvancedTransformToDisplacementFieldSource_hxx
+
+#include "itkAdvancedTransformToDisplacementFieldSource.h"
+
+#include "itkAdvancedIdentityTransform.h"
+#include "itkProgressReporter.h"
+#include "itkImageScanlineIterator.h"
+#include "itkAdvancedCombinationTransform.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::AdvancedTransformToDisplacementFieldSource()
+{
+  this->m_OutputSpacing.Fill( 1.0 );
+  this->m_OutputOrigin.Fill( 0.0 );
+  this->m_OutputDirection.SetIdentity();
+
+  SizeType size;
+  size.Fill( 0 );
+  this->m_OutputRegion.SetSize( size );
+
+  IndexType index;
+  index.Fill( 0 );
+  this->m_OutputRegion.SetIndex( index );
+
+  this->m_Transform = AdvancedIdentityTransform< TTransformPrecisionType, ImageDimension >::New();
+
+  this->m_BSplineTransform          = 0;
+  this->m_HasLinearInitialTransform = false;
+  this->m_UseComposition            = true;
+  this->m_InitialMatrix.SetIdentity();
+  this->m_InitialOffset.Fill( 0.0 );
+  this->m_NumberOfRowsAlongGrid = 0;
+
+#if ITK_VERSION_MAJOR >= 5
+  // Use the classic (ITK4) threading model, to ensure ThreadedGenerateData is being called.
+  this->itk::ImageSource<TOutputImage>::DynamicMultiThreadingOff();
+#endif
+
+} // end Constructor
+
+
+/**
+ * Print out a description of self
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "OutputRegion: " << this->m_OutputRegion << std::endl;
+  os << indent << "OutputSpacing: " << this->m_OutputSpacing << std::endl;
+  os << indent << "OutputOrigin: " << this->m_OutputOrigin << std::endl;
+  os << indent << "OutputDirection: " << this->m_OutputDirection << std::endl;
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << indent << "NumberOfRowsAlongGrid: " << this->m_NumberOfRowsAlongGrid << std::endl;
+} // end PrintSelf()
+
+
+/**
+ * Set the output image size.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SetOutputSize( const SizeType & size )
+{
+  this->m_OutputRegion.SetSize( size );
+}
+
+
+/**
+ * Get the output image size.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+const typename AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SizeType
+& AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GetOutputSize()
+{
+  return this->m_OutputRegion.GetSize();
+}
+
+/**
+ * Set the output image index.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SetOutputIndex( const IndexType & index )
+{
+  this->m_OutputRegion.SetIndex( index );
+}
+
+
+/**
+ * Get the output image index.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+const typename AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::IndexType
+& AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GetOutputIndex()
+{
+  return this->m_OutputRegion.GetIndex();
+}
+
+/**
+ * Set the output image spacing.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SetOutputSpacing( const double * spacing )
+{
+  SpacingType s( spacing );
+  this->SetOutputSpacing( s );
+
+} // end SetOutputSpacing()
+
+
+/**
+ * Set the output image origin.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SetOutputOrigin( const double * origin )
+{
+  OriginType p( origin );
+  this->SetOutputOrigin( p );
+
+}
+
+
+/** Helper method to set the output parameters based on this image */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SetOutputParametersFromImage( const ImageBaseType * image )
+{
+  if( !image )
+  {
+    itkExceptionMacro( << "Cannot use a null image reference" );
+  }
+
+  this->SetOutputOrigin( image->GetOrigin() );
+  this->SetOutputSpacing( image->GetSpacing() );
+  this->SetOutputDirection( image->GetDirection() );
+  this->SetOutputRegion( image->GetLargestPossibleRegion() );
+
+} // end SetOutputParametersFromImage()
+
+
+/**
+ * Set up state of filter before multi-threading.
+ * Find the B-spline transform that can be evaluated row by row.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::BeforeThreadedGenerateData( void )
+{
+  if( !this->m_Transform )
+  {
+    itkExceptionMacro( << "Transform not set" );
+  }
+
+#if ITK_VERSION_MAJOR >= 5
+  const ThreadIdType numberOfThreads = this->GetNumberOfWorkUnits();
+#else
+  const ThreadIdType numberOfThreads = this->GetNumberOfThreads();
+#endif
+  this->m_ThreadNumberOfRowsAlongGrid.SetSize( numberOfThreads );
+  this->m_ThreadNumberOfRowsAlongGrid.Fill( 0 );
+  this->m_NumberOfRowsAlongGrid = 0;
+
+  typedef AdvancedCombinationTransform< TTransformPrecisionType, ImageDimension > CombinationTransformType;
+
+  this->m_BSplineTransform          = 0;
+  this->m_HasLinearInitialTransform = false;
+  this->m_UseComposition            = true;
+
+  /** A combination with a linear initial transform A x + b is supported,
+   * both when it composes and when it adds the transforms.
+   */
+  const TransformType *            transform   = this->m_Transform.GetPointer();
+  const CombinationTransformType * combination
+    = dynamic_cast< const CombinationTransformType * >( transform );
+  if( combination )
+  {
+    const TransformType * initialTransform = combination->GetInitialTransform();
+    if( initialTransform )
+    {
+      if( !initialTransform->IsLinear() )
+      {
+        return;
+      }
+      InputPointType zero;
+      zero.Fill( 0.0 );
+      initialTransform->GetSpatialJacobian( zero, this->m_InitialMatrix );
+      const typename TransformType::OutputPointType offset = initialTransform->TransformPoint( zero );
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+        this->m_InitialOffset[ i ] = offset[ i ];
+      }
+      this->m_HasLinearInitialTransform = true;
+      this->m_UseComposition            = combination->GetUseComposition();
+    }
+    transform = combination->GetCurrentTransform();
+  }
+
+  this->m_BSplineTransform = dynamic_cast< const BSplineTransformType * >( transform );
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * Gather the number of rows evaluated along the grid by the threads.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::AfterThreadedGenerateData( void )
+{
+  this->m_NumberOfRowsAlongGrid = 0;
+  for( unsigned int i = 0; i < this->m_ThreadNumberOfRowsAlongGrid.GetSize(); ++i )
+  {
+    this->m_NumberOfRowsAlongGrid += this->m_ThreadNumberOfRowsAlongGrid[ i ];
+  }
+
+} // end AfterThreadedGenerateData()
+
+
+/**
+ * ThreadedGenerateData
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::ThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread,
+  ThreadIdType threadId )
+{
+  // Get the output pointer
+  OutputImagePointer outputPtr = this->GetOutput();
+
+  // Create an iterator that will walk the output region for this thread.
+  typedef ImageScanlineIterator< TOutputImage > OutputIteratorType;
+  OutputIteratorType it( outputPtr, outputRegionForThread );
+  it.GoToBegin();
+
+  // The step between two voxels of a row, in physical space
+  const SizeValueType lineLength = outputRegionForThread.GetSize( 0 );
+  InputVectorType     rowStep;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    rowStep[ i ] = this->m_OutputDirection[ i ][ 0 ] * this->m_OutputSpacing[ 0 ];
+  }
+
+  // The row as seen by the B-spline transform
+  InputVectorType bsplineRowStep = rowStep;
+  if( this->m_HasLinearInitialTransform && this->m_UseComposition )
+  {
+    bsplineRowStep = this->m_InitialMatrix * rowStep;
+  }
+
+  std::vector< TTransformPrecisionType > bsplineDisplacements( lineLength * ImageDimension );
+
+  // Support for progress methods/callbacks
+  const SizeValueType numberOfLines = lineLength > 0
+    ? outputRegionForThread.GetNumberOfPixels() / lineLength : 0;
+  ProgressReporter progress( this, threadId, numberOfLines );
+
+  // Walk the output region line by line
+  InputPointType rowStart;
+  InputPointType point;
+  PixelType      displacement;
+  while( !it.IsAtEnd() )
+  {
+    // Determine the coordinates of the first voxel of the line
+    outputPtr->TransformIndexToPhysicalPoint( it.GetIndex(), rowStart );
+
+    // Evaluate the B-spline along the row, if possible
+    bool rowDone = false;
+    if( this->m_BSplineTransform )
+    {
+      InputPointType bsplineRowStart = rowStart;
+      if( this->m_HasLinearInitialTransform && this->m_UseComposition )
+      {
+        bsplineRowStart = this->m_InitialMatrix * rowStart + this->m_InitialOffset;
+      }
+      rowDone = this->m_BSplineTransform->ComputeDisplacementsAlongRow(
+        bsplineRowStart, bsplineRowStep, lineLength, &bsplineDisplacements[ 0 ] );
+    }
+
+    if( rowDone )
+    {
+      ++this->m_ThreadNumberOfRowsAlongGrid[ threadId ];
+
+      // T(x) = T0(x) + u(.), with T0 the linear initial transform, if any
+      const TTransformPrecisionType * u = &bsplineDisplacements[ 0 ];
+      for( SizeValueType n = 0; n < lineLength; ++n, u += ImageDimension )
+      {
+        point = rowStart + rowStep * static_cast< TTransformPrecisionType >( n );
+        InputPointType initialPoint = point;
+        if( this->m_HasLinearInitialTransform )
+        {
+          initialPoint = this->m_InitialMatrix * point + this->m_InitialOffset;
+        }
+        for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+          displacement[ i ] = static_cast< PixelValueType >( initialPoint[ i ] + u[ i ] - point[ i ] );
+        }
+        it.Set( displacement );
+        ++it;
+      }
+    }
+    else
+    {
+      // Otherwise, the transform is called for every voxel.
+      while( !it.IsAtEndOfLine() )
+      {
+        outputPtr->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+        const typename TransformType::OutputPointType transformedPoint
+          = this->m_Transform->TransformPoint( point );
+        for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+          displacement[ i ] = static_cast< PixelValueType >( transformedPoint[ i ] - point[ i ] );
+        }
+        it.Set( displacement );
+        ++it;
+      }
+    }
+
+    // Update progress and iterator
+    it.NextLine();
+    progress.CompletedPixel();
+  }
+
+} // end ThreadedGenerateData()
+
+
+/**
+ * Inform pipeline of required output region
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GenerateOutputInformation( void )
+{
+  // call the superclass' implementation of this method
+  Superclass::GenerateOutputInformation();
+
+  // get pointer to the output
+  OutputImagePointer outputPtr = this->GetOutput();
+  if( !outputPtr )
+  {
+    return;
+  }
+
+  outputPtr->SetLargestPossibleRegion( m_OutputRegion );
+  outputPtr->SetSpacing( m_OutputSpacing );
+  outputPtr->SetOrigin( m_OutputOrigin );
+  outputPtr->SetDirection( m_OutputDirection );
+
+} // end GenerateOutputInformation()
+
+
+/**
+ * Verify if any of the components has been modified.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+ModifiedTimeType
+AdvancedTransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GetMTime( void ) const
+{
+  ModifiedTimeType latestTime = Object::GetMTime();
+
+  if( this->m_Transform )
+  {
+    if( latestTime < this->m_Transform->GetMTime() )
+    {
+      latestTime = this->m_Transform->GetMTime();
+    }
+  }
+
+  return latestTime;
+} // end GetMTime()
+
+
+} // end namespace itk
+
+#endif // end #ifndef _itkAdvancedTransformToDisplacementFieldSource_hxx
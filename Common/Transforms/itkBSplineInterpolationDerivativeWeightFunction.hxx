@@ -95,6 +95,15 @@ BSplineInterpolationDerivativeWeightFunction< TCoordRep, VSpaceDimension, VSplin
   /** Compute the 1D weights. */
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    // Use the precomputed weights for points on the sample lattice
+    if( this->LookUp1DWeights( i, cindex, startIndex,
+      i != this->m_DerivativeDirection
+      ? GridAlignedWeightsTableType::Weights
+      : GridAlignedWeightsTableType::DerivativeWeights, weights1D ) )
+    {
+      continue;
+    }
+
     double x = cindex[ i ] - static_cast< double >( startIndex[ i ] );
 
     if( i != this->m_DerivativeDirection )
@@ -91,6 +91,7 @@ protected:
     ::SecondOrderDerivativeKernelType SecondOrderDerivativeKernelType;
   typedef typename Superclass::TableType       TableType;
   typedef typename Superclass::OneDWeightsType OneDWeightsType;
+  typedef typename Superclass::GridAlignedWeightsTableType GridAlignedWeightsTableType;
 
   /** Compute the 1D weights, which are:
    * \f[ \beta( x[i] - startIndex[i] ), \beta( x[i] - startIndex[i] - 1 ),
@@ -111,6 +111,19 @@ BSplineInterpolationSecondOrderDerivativeWeightFunction< TCoordRep, VSpaceDimens
   /** Compute the 1D weights. */
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    // Use the precomputed weights for points on the sample lattice
+    typename GridAlignedWeightsTableType::WeightsKindType kind = GridAlignedWeightsTableType::Weights;
+    if( i == this->m_DerivativeDirections[ 0 ] || i == this->m_DerivativeDirections[ 1 ] )
+    {
+      kind = this->m_EqualDerivativeDirections
+        ? GridAlignedWeightsTableType::SecondOrderDerivativeWeights
+        : GridAlignedWeightsTableType::DerivativeWeights;
+    }
+    if( this->LookUp1DWeights( i, index, startIndex, kind, weights1D ) )
+    {
+      continue;
+    }
+
     double x = index[ i ] - static_cast< double >( startIndex[ i ] );
 
     if( i != this->m_DerivativeDirections[ 0 ]
@@ -86,6 +86,7 @@ protected:
     ::SecondOrderDerivativeKernelType SecondOrderDerivativeKernelType;
   typedef typename Superclass::TableType       TableType;
   typedef typename Superclass::OneDWeightsType OneDWeightsType;
+  typedef typename Superclass::GridAlignedWeightsTableType GridAlignedWeightsTableType;
   typedef typename Superclass::WeightArrayType WeightArrayType;
 
   /* Compute the 1D weights, which are:
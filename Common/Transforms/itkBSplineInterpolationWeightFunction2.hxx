@@ -52,6 +52,13 @@ BSplineInterpolationWeightFunction2< TCoordRep, VSpaceDimension, VSplineOrder >
   /** Compute the 1D weights. */
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    // Use the precomputed weights for points on the sample lattice
+    if( this->LookUp1DWeights( i, index, startIndex,
+      GridAlignedWeightsTableType::Weights, weights1D ) )
+    {
+      continue;
+    }
+
     double x = index[ i ] - static_cast< double >( startIndex[ i ] );
 
     // Compute weights
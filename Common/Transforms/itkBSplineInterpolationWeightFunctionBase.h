@@ -26,6 +26,7 @@
 #include "itkBSplineKernelFunction2.h"
 #include "itkBSplineDerivativeKernelFunction.h"
 #include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
+#include "itkGridAlignedBSplineWeightsTable.h"
 
 namespace itk
 {
@@ -129,6 +130,18 @@ public:
   /** Get number of weights. */
   itkGetConstMacro( NumberOfWeights, unsigned long );
 
+  /** Table of precomputed 1D weights for points on a lattice. */
+  typedef GridAlignedBSplineWeightsTable<
+    VSpaceDimension, VSplineOrder >                 GridAlignedWeightsTableType;
+
+  /** Set the table of precomputed 1D weights, which is owned by the caller.
+   * A null pointer (the default) means that the weights are always computed.
+   */
+  void SetGridAlignedWeightsTable( const GridAlignedWeightsTableType * table )
+  {
+    this->m_GridAlignedWeightsTable = table;
+  }
+
 protected:
 
   BSplineInterpolationWeightFunctionBase();
@@ -163,11 +176,27 @@ protected:
   /** Print the member variables. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Look up the 1D weights of the given kind along axis i in the grid
+   * aligned weights table, if any. Returns false when they must be computed.
+   */
+  bool LookUp1DWeights( const unsigned int i,
+    const ContinuousIndexType & index, const IndexType & startIndex,
+    const typename GridAlignedWeightsTableType::WeightsKindType kind,
+    OneDWeightsType & weights1D ) const
+  {
+    return this->m_GridAlignedWeightsTable != nullptr
+           && this->m_GridAlignedWeightsTable->Lookup( i, index[ i ],
+      startIndex[ i ], kind, weights1D[ i ] );
+  }
+
+
   /** Member variables. */
   unsigned long m_NumberOfWeights;
   SizeType      m_SupportSize;
   TableType     m_OffsetToIndexTable;
 
+  const GridAlignedWeightsTableType * m_GridAlignedWeightsTable;
+
   /** Interpolation kernels. */
   typename KernelType::Pointer m_Kernel;
   typename DerivativeKernelType::Pointer m_DerivativeKernel;
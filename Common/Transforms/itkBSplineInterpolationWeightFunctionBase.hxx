@@ -37,6 +37,7 @@ BSplineInterpolationWeightFunctionBase< TCoordRep, VSpaceDimension, VSplineOrder
   /** Initialize members. */
   this->InitializeSupport();
   this->InitializeOffsetToIndexTable();
+  this->m_GridAlignedWeightsTable = nullptr;
 
 } // end Constructor
 
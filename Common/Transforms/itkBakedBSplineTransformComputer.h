@@ -0,0 +1,219 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBakedBSplineTransformComputer_h
+#define __itkBakedBSplineTransformComputer_h
+
+#include "itkObject.h"
+#include "itkTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+#include "itkMultiThreader.h"
+#include "itkImageBase.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class BakedBSplineTransformComputer
+ * \brief This class approximates ('bakes') an arbitrary transform on an
+ * image domain by a single B-spline transform.
+ *
+ * The displacement \f$T(x) - x\f$ of the input transform is sampled on the
+ * nodes of a B-spline grid with the given spacing, which covers the image
+ * domain in the same way as the grids of the GridScheduleComputer. The
+ * samples are then converted to B-spline coefficients, such that the output
+ * transform interpolates the input transform at the grid nodes.
+ *
+ * This is useful to replace an expensive transform, such as a chain of
+ * B-spline transforms, that has to be evaluated very often, by a transform
+ * with the cost of a single B-spline evaluation. The interpolation error
+ * is controlled by the grid spacing. After baking, the error is measured at
+ * the centres of the grid cells inside the image domain, which are the
+ * points furthest from the grid nodes; see GetMaximumError() and
+ * GetRMSError(). Outside the image domain the output transform does not
+ * approximate the input transform: it falls back to the identity beyond
+ * the support of the grid. Use GetImageDomain() to restrict its use.
+ *
+ * Sampling the input transform and measuring the error are done with
+ * multiple threads, so the input transform must support concurrent calls
+ * to TransformPoint(), as all elastix transforms do.
+ *
+ * \ingroup Transforms
+ */
+
+template< typename TScalarType, unsigned int NDimensions, unsigned int VSplineOrder = 3 >
+class BakedBSplineTransformComputer :
+  public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef BakedBSplineTransformComputer Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( BakedBSplineTransformComputer, Object );
+
+  /** Dimension of the domain space. */
+  itkStaticConstMacro( SpaceDimension, unsigned int, NDimensions );
+
+  /** The B-spline order of the output transform. */
+  itkStaticConstMacro( SplineOrder, unsigned int, VSplineOrder );
+
+  /** Typedefs for the input transform. */
+  typedef Transform< TScalarType, NDimensions, NDimensions > TransformType;
+  typedef typename TransformType::ConstPointer               TransformConstPointer;
+
+  /** Typedefs for the output transform. */
+  typedef RecursiveBSplineTransform<
+    TScalarType, NDimensions, VSplineOrder >                BSplineTransformType;
+  typedef typename BSplineTransformType::Pointer           BSplineTransformPointer;
+  typedef typename BSplineTransformType::ParametersType    ParametersType;
+  typedef typename BSplineTransformType::ImageType         CoefficientImageType;
+  typedef typename CoefficientImageType::Pointer           CoefficientImagePointer;
+  typedef typename BSplineTransformType::RegionType        RegionType;
+  typedef typename BSplineTransformType::SizeType          SizeType;
+  typedef typename BSplineTransformType::IndexType         IndexType;
+  typedef typename BSplineTransformType::SpacingType       SpacingType;
+  typedef typename BSplineTransformType::OriginType        OriginType;
+  typedef typename BSplineTransformType::DirectionType     DirectionType;
+
+  /** Typedef for the image domain. */
+  typedef ImageBase< NDimensions >          ImageDomainType;
+  typedef typename ImageDomainType::Pointer ImageDomainPointer;
+
+  /** Set the transform to be baked. */
+  itkSetConstObjectMacro( Transform, TransformType );
+
+  /** Set the origin of the image domain. */
+  itkSetMacro( ImageOrigin, OriginType );
+
+  /** Set the spacing of the image domain. */
+  itkSetMacro( ImageSpacing, SpacingType );
+
+  /** Set the direction cosines of the image domain. */
+  itkSetMacro( ImageDirection, DirectionType );
+
+  /** Set the region of the image domain. */
+  itkSetMacro( ImageRegion, RegionType );
+
+  /** Set the spacing of the B-spline grid, in physical units. */
+  itkSetMacro( GridSpacing, SpacingType );
+
+  /** Set the number of threads. */
+  void SetNumberOfThreads( ThreadIdType numberOfThreads )
+  {
+    this->m_Threader->SetNumberOfThreads( numberOfThreads );
+  }
+
+  /** Sample the transform and compute the B-spline transform. */
+  virtual void Compute( void );
+
+  /** Get the computed B-spline transform. */
+  itkGetModifiableObjectMacro( Output, BSplineTransformType );
+
+  /** Get the image domain on which the output approximates the transform. */
+  itkGetModifiableObjectMacro( ImageDomain, ImageDomainType );
+
+  /** Get the maximum and root mean square of the distance between the
+   * input and the output transform, at the grid cell centres inside the
+   * image domain.
+   */
+  itkGetConstMacro( MaximumError, double );
+  itkGetConstMacro( RMSError, double );
+
+  /** Get the number of points at which the error was measured. */
+  itkGetConstMacro( NumberOfErrorSamples, SizeValueType );
+
+protected:
+
+  /** The constructor. */
+  BakedBSplineTransformComputer();
+
+  /** The destructor. */
+  ~BakedBSplineTransformComputer() override {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+  /** Typedefs for multi-threading. */
+  typedef itk::MultiThreader             ThreaderType;
+  typedef ThreaderType::ThreadInfoStruct ThreadInfoType;
+
+  /** The callback function. */
+  static ITK_THREAD_RETURN_TYPE SampleTransformThreaderCallback( void * arg );
+
+  /** Sample the displacements of a contiguous part of the grid nodes. */
+  void ThreadedSampleTransform( ThreadIdType threadId, ThreadIdType numberOfThreads );
+
+  /** The callback function for the error measurement. */
+  static ITK_THREAD_RETURN_TYPE ComputeErrorThreaderCallback( void * arg );
+
+  /** Measure the error at a contiguous part of the grid cell centres. */
+  void ThreadedComputeError( ThreadIdType threadId, ThreadIdType numberOfThreads );
+
+  /** To give the threads access to all member variables and functions. */
+  struct MultiThreaderParameterType
+  {
+    Self * st_Self;
+  };
+
+private:
+
+  BakedBSplineTransformComputer( const Self & ); // purposely not implemented
+  void operator=( const Self & );                // purposely not implemented
+
+  /** Member variables. */
+  TransformConstPointer      m_Transform;
+  OriginType                 m_ImageOrigin;
+  SpacingType                m_ImageSpacing;
+  DirectionType              m_ImageDirection;
+  RegionType                 m_ImageRegion;
+  SpacingType                m_GridSpacing;
+  BSplineTransformPointer    m_Output;
+  ThreaderType::Pointer      m_Threader;
+  MultiThreaderParameterType m_ThreaderParameters;
+  ImageDomainPointer         m_ImageDomain;
+  ImageDomainPointer         m_GridDomain;
+
+  /** The error measures, and the error per grid cell, which is negative
+   * for cells outside the image domain.
+   */
+  double                m_MaximumError;
+  double                m_RMSError;
+  SizeValueType         m_NumberOfErrorSamples;
+  std::vector< double > m_CellErrors;
+
+  /** The sampled displacements, one image per dimension. */
+  CoefficientImagePointer m_SampledImages[ NDimensions ];
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBakedBSplineTransformComputer.hxx"
+#endif
+
+#endif // end #ifndef __itkBakedBSplineTransformComputer_h
@@ -0,0 +1,374 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBakedBSplineTransformComputer_hxx
+#define __itkBakedBSplineTransformComputer_hxx
+
+#include "itkBakedBSplineTransformComputer.h"
+
+#include "itkGridScheduleComputer.h"
+#include "itkBSplineDecompositionImageFilter.h"
+
+#include <algorithm> // std::min, std::max, std::copy
+#include <cmath>     // std::sqrt
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+BakedBSplineTransformComputer< TScalarType, NDimensions, VSplineOrder >
+::BakedBSplineTransformComputer()
+{
+  this->m_ImageOrigin.Fill( 0.0 );
+  this->m_ImageSpacing.Fill( 1.0 );
+  this->m_ImageDirection.SetIdentity();
+  this->m_GridSpacing.Fill( 1.0 );
+
+  this->m_MaximumError         = 0.0;
+  this->m_RMSError             = 0.0;
+  this->m_NumberOfErrorSamples = 0;
+
+  this->m_Threader = ThreaderType::New();
+#if ITK_VERSION_MAJOR < 5
+  // Note: This `#if` is a workaround for ITK5, which no longer supports calling
+  // `threader->SetUseThreadPool(false)`. ITK5 does not use thread pools by default.
+  this->m_Threader->SetUseThreadPool( false );
+#endif
+  this->m_ThreaderParameters.st_Self = this;
+
+} // end Constructor
+
+
+/**
+ * ********************* Compute ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+BakedBSplineTransformComputer< TScalarType, NDimensions, VSplineOrder >
+::Compute( void )
+{
+  if( this->m_Transform.IsNull() )
+  {
+    itkExceptionMacro( << "No transform has been set." );
+  }
+
+  /** Compute a B-spline grid that covers the image domain. */
+  typedef GridScheduleComputer< TScalarType, NDimensions > GridScheduleComputerType;
+  typename GridScheduleComputerType::Pointer gridScheduleComputer
+    = GridScheduleComputerType::New();
+  gridScheduleComputer->SetImageOrigin( this->m_ImageOrigin );
+  gridScheduleComputer->SetImageSpacing( this->m_ImageSpacing );
+  gridScheduleComputer->SetImageDirection( this->m_ImageDirection );
+  gridScheduleComputer->SetImageRegion( this->m_ImageRegion );
+  gridScheduleComputer->SetBSplineOrder( VSplineOrder );
+  gridScheduleComputer->SetFinalGridSpacing( this->m_GridSpacing );
+  gridScheduleComputer->SetDefaultSchedule( 1, 2.0 );
+  gridScheduleComputer->ComputeBSplineGrid();
+
+  RegionType    gridRegion;
+  SpacingType   gridSpacing;
+  OriginType    gridOrigin;
+  DirectionType gridDirection;
+  gridScheduleComputer->GetBSplineGrid( 0, gridRegion, gridSpacing, gridOrigin, gridDirection );
+
+  /** Remember the image domain and the grid domain. */
+  this->m_ImageDomain = ImageDomainType::New();
+  this->m_ImageDomain->SetOrigin( this->m_ImageOrigin );
+  this->m_ImageDomain->SetSpacing( this->m_ImageSpacing );
+  this->m_ImageDomain->SetDirection( this->m_ImageDirection );
+  this->m_ImageDomain->SetLargestPossibleRegion( this->m_ImageRegion );
+  this->m_GridDomain = ImageDomainType::New();
+  this->m_GridDomain->SetOrigin( gridOrigin );
+  this->m_GridDomain->SetSpacing( gridSpacing );
+  this->m_GridDomain->SetDirection( gridDirection );
+  this->m_GridDomain->SetLargestPossibleRegion( gridRegion );
+
+  /** Allocate the images of sampled displacements. */
+  for( unsigned int d = 0; d < SpaceDimension; ++d )
+  {
+    this->m_SampledImages[ d ] = CoefficientImageType::New();
+    this->m_SampledImages[ d ]->SetRegions( gridRegion );
+    this->m_SampledImages[ d ]->SetOrigin( gridOrigin );
+    this->m_SampledImages[ d ]->SetSpacing( gridSpacing );
+    this->m_SampledImages[ d ]->SetDirection( gridDirection );
+    this->m_SampledImages[ d ]->Allocate();
+  }
+
+  /** Sample the displacements of the transform at the grid nodes. */
+  this->m_Threader->SetSingleMethod( Self::SampleTransformThreaderCallback,
+    &this->m_ThreaderParameters );
+  this->m_Threader->SingleMethodExecute();
+
+  /** Convert the samples to interpolating B-spline coefficients,
+   * and copy them into one parameter vector.
+   */
+  typedef BSplineDecompositionImageFilter<
+    CoefficientImageType, CoefficientImageType > DecompositionFilterType;
+  const SizeValueType numberOfNodes = gridRegion.GetNumberOfPixels();
+  ParametersType      parameters( numberOfNodes * SpaceDimension );
+  for( unsigned int d = 0; d < SpaceDimension; ++d )
+  {
+    typename DecompositionFilterType::Pointer decompositionFilter
+      = DecompositionFilterType::New();
+    decompositionFilter->SetSplineOrder( VSplineOrder );
+    decompositionFilter->SetInput( this->m_SampledImages[ d ] );
+    decompositionFilter->Update();
+
+    const typename CoefficientImageType::PixelType * coefficients
+      = decompositionFilter->GetOutput()->GetBufferPointer();
+    std::copy( coefficients, coefficients + numberOfNodes,
+      parameters.data_block() + d * numberOfNodes );
+
+    /** The samples are not needed anymore. */
+    this->m_SampledImages[ d ] = 0;
+  }
+
+  /** Create the B-spline transform. */
+  this->m_Output = BSplineTransformType::New();
+  this->m_Output->SetGridRegion( gridRegion );
+  this->m_Output->SetGridSpacing( gridSpacing );
+  this->m_Output->SetGridOrigin( gridOrigin );
+  this->m_Output->SetGridDirection( gridDirection );
+  this->m_Output->SetParametersByValue( parameters );
+
+  /** Measure the approximation error at the grid cell centres. */
+  SizeValueType numberOfCells = 1;
+  for( unsigned int d = 0; d < SpaceDimension; ++d )
+  {
+    numberOfCells *= std::max< SizeValueType >( gridRegion.GetSize()[ d ], 2 ) - 1;
+  }
+  this->m_CellErrors.assign( numberOfCells, -1.0 );
+  this->m_Threader->SetSingleMethod( Self::ComputeErrorThreaderCallback,
+    &this->m_ThreaderParameters );
+  this->m_Threader->SingleMethodExecute();
+
+  double sumOfSquaredErrors = 0.0;
+  this->m_MaximumError         = 0.0;
+  this->m_NumberOfErrorSamples = 0;
+  for( SizeValueType n = 0; n < numberOfCells; ++n )
+  {
+    const double error = this->m_CellErrors[ n ];
+    if( error < 0.0 ) { continue; }
+    this->m_MaximumError = std::max( this->m_MaximumError, error );
+    sumOfSquaredErrors  += error * error;
+    ++this->m_NumberOfErrorSamples;
+  }
+  this->m_RMSError = this->m_NumberOfErrorSamples > 0
+    ? std::sqrt( sumOfSquaredErrors / this->m_NumberOfErrorSamples ) : 0.0;
+  this->m_CellErrors.clear();
+
+} // end Compute()
+
+
+/**
+ * ************ SampleTransformThreaderCallback ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+ITK_THREAD_RETURN_TYPE
+BakedBSplineTransformComputer< TScalarType, NDimensions, VSplineOrder >
+::SampleTransformThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
+
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Self->ThreadedSampleTransform( threadId, nrOfThreads );
+
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end SampleTransformThreaderCallback()
+
+
+/**
+ * ********************* ThreadedSampleTransform ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+BakedBSplineTransformComputer< TScalarType, NDimensions, VSplineOrder >
+::ThreadedSampleTransform( ThreadIdType threadId, ThreadIdType numberOfThreads )
+{
+  /** Each thread samples a contiguous range of grid nodes. */
+  const RegionType &  gridRegion    = this->m_SampledImages[ 0 ]->GetBufferedRegion();
+  const SizeType &    gridSize      = gridRegion.GetSize();
+  const SizeValueType numberOfNodes = gridRegion.GetNumberOfPixels();
+  const SizeValueType nodesPerThread
+    = ( numberOfNodes + numberOfThreads - 1 ) / numberOfThreads;
+  const SizeValueType begin = std::min( numberOfNodes, threadId * nodesPerThread );
+  const SizeValueType end   = std::min( numberOfNodes, begin + nodesPerThread );
+
+  typename CoefficientImageType::PixelType * sampled[ NDimensions ];
+  for( unsigned int d = 0; d < SpaceDimension; ++d )
+  {
+    sampled[ d ] = this->m_SampledImages[ d ]->GetBufferPointer();
+  }
+
+  typedef typename TransformType::InputPointType  InputPointType;
+  typedef typename TransformType::OutputPointType OutputPointType;
+  IndexType      index;
+  InputPointType point;
+  for( SizeValueType n = begin; n < end; ++n )
+  {
+    /** Convert the buffer offset to a grid index. */
+    SizeValueType remainder = n;
+    for( unsigned int d = 0; d < SpaceDimension; ++d )
+    {
+      index[ d ]  = gridRegion.GetIndex()[ d ] + static_cast< IndexValueType >( remainder % gridSize[ d ] );
+      remainder  /= gridSize[ d ];
+    }
+
+    this->m_SampledImages[ 0 ]->TransformIndexToPhysicalPoint( index, point );
+    const OutputPointType mapped = this->m_Transform->TransformPoint( point );
+    for( unsigned int d = 0; d < SpaceDimension; ++d )
+    {
+      sampled[ d ][ n ] = mapped[ d ] - point[ d ];
+    }
+  }
+
+} // end ThreadedSampleTransform()
+
+
+/**
+ * ************ ComputeErrorThreaderCallback ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+ITK_THREAD_RETURN_TYPE
+BakedBSplineTransformComputer< TScalarType, NDimensions, VSplineOrder >
+::ComputeErrorThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
+
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Self->ThreadedComputeError( threadId, nrOfThreads );
+
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end ComputeErrorThreaderCallback()
+
+
+/**
+ * ********************* ThreadedComputeError ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+BakedBSplineTransformComputer< TScalarType, NDimensions, VSplineOrder >
+::ThreadedComputeError( ThreadIdType threadId, ThreadIdType numberOfThreads )
+{
+  /** The cells lie between the grid nodes. */
+  const RegionType &  gridRegion    = this->m_GridDomain->GetLargestPossibleRegion();
+  const SizeValueType numberOfCells = this->m_CellErrors.size();
+  SizeType            cellSize;
+  for( unsigned int d = 0; d < SpaceDimension; ++d )
+  {
+    cellSize[ d ] = std::max< SizeValueType >( gridRegion.GetSize()[ d ], 2 ) - 1;
+  }
+  const SizeValueType cellsPerThread
+    = ( numberOfCells + numberOfThreads - 1 ) / numberOfThreads;
+  const SizeValueType begin = std::min( numberOfCells, threadId * cellsPerThread );
+  const SizeValueType end   = std::min( numberOfCells, begin + cellsPerThread );
+
+  /** The image domain, in continuous index coordinates, including its border. */
+  const RegionType & imageRegion = this->m_ImageDomain->GetLargestPossibleRegion();
+
+  typedef typename TransformType::InputPointType    InputPointType;
+  typedef typename TransformType::OutputPointType   OutputPointType;
+  typedef ContinuousIndex< TScalarType, NDimensions > ContinuousIndexType;
+  ContinuousIndexType cellCentre;
+  ContinuousIndexType imageIndex;
+  InputPointType      point;
+  for( SizeValueType n = begin; n < end; ++n )
+  {
+    /** Convert the cell number to the continuous grid index of its centre. */
+    SizeValueType remainder = n;
+    for( unsigned int d = 0; d < SpaceDimension; ++d )
+    {
+      const double centre = gridRegion.GetSize()[ d ] > 1 ? 0.5 : 0.0;
+      cellCentre[ d ] = gridRegion.GetIndex()[ d ] + static_cast< double >( remainder % cellSize[ d ] ) + centre;
+      remainder      /= cellSize[ d ];
+    }
+    this->m_GridDomain->TransformContinuousIndexToPhysicalPoint( cellCentre, point );
+
+    /** Only the image domain is approximated. */
+    this->m_ImageDomain->TransformPhysicalPointToContinuousIndex( point, imageIndex );
+    bool inside = true;
+    for( unsigned int d = 0; d < SpaceDimension; ++d )
+    {
+      inside &= imageIndex[ d ] >= imageRegion.GetIndex()[ d ] - 0.5
+        && imageIndex[ d ] <= imageRegion.GetIndex()[ d ] + static_cast< double >( imageRegion.GetSize()[ d ] ) - 0.5;
+    }
+    if( !inside ) { continue; }
+
+    const OutputPointType exact  = this->m_Transform->TransformPoint( point );
+    const OutputPointType approx = this->m_Output->TransformPoint( point );
+    this->m_CellErrors[ n ] = exact.EuclideanDistanceTo( approx );
+  }
+
+} // end ThreadedComputeError()
+
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+BakedBSplineTransformComputer< TScalarType, NDimensions, VSplineOrder >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << indent << "ImageSpacing: " << this->m_ImageSpacing << std::endl;
+  os << indent << "ImageOrigin: " << this->m_ImageOrigin << std::endl;
+  os << indent << "ImageDirection: " << this->m_ImageDirection << std::endl;
+  os << indent << "ImageRegion: " << std::endl;
+  this->m_ImageRegion.Print( os, indent.GetNextIndent() );
+  os << indent << "GridSpacing: " << this->m_GridSpacing << std::endl;
+  os << indent << "Output: " << this->m_Output.GetPointer() << std::endl;
+  os << indent << "MaximumError: " << this->m_MaximumError << std::endl;
+  os << indent << "RMSError: " << this->m_RMSError << std::endl;
+  os << indent << "NumberOfErrorSamples: " << this->m_NumberOfErrorSamples << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBakedBSplineTransformComputer_hxx
@@ -0,0 +1,267 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGridAlignedBSplineWeightsTable_h
+#define __itkGridAlignedBSplineWeightsTable_h
+
+#include "itkBSplineKernelFunction2.h"
+#include "itkBSplineDerivativeKernelFunction2.h"
+#include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
+#include "itkIntTypes.h"
+#include "itkNumericTraits.h"
+
+#include <cmath>
+#include <vector>
+
+namespace itk
+{
+
+/** \class GridAlignedBSplineWeightsTable
+ *
+ * \brief Lookup table of 1D B-spline weights for points on a regular lattice.
+ *
+ * When the points at which a B-spline transform is evaluated lie on a regular
+ * lattice, e.g. the voxel centres of the fixed image visited by a grid or full
+ * sampler, and the lattice is aligned with the control point grid, then along
+ * each axis the continuous grid index of the points is
+ * \f$c_0 + k \cdot p / q\f$. The fractional offset with respect to the start
+ * of the support region therefore only takes q different values, and so do
+ * the 1D weights, derivative weights and second order derivative weights.
+ *
+ * Initialize() detects the period q per axis, up to MaximumPeriod, and
+ * precomputes the 1D weights of all q offsets. It also stores, per axis and
+ * per sample index k of the lattice, the continuous index and the start of
+ * the support region of the k-th sample, and the table entry it uses. A point
+ * is looked up by its sample index along the axis, which follows from a
+ * single multiplication; there is no rounding to the period, no modulo and
+ * no search. A lookup only succeeds when the point is the k-th sample up to a
+ * tiny tolerance and has the same support region, so the result is always
+ * the same as evaluating the kernels; for points off the lattice the lookup
+ * simply fails and the caller evaluates the kernels as usual.
+ *
+ * The table is owned by the B-spline transform and shared by its weight
+ * functions. It is only modified in Initialize() and Clear(), which should
+ * not be called while the transform is being evaluated.
+ *
+ * \ingroup Transforms
+ */
+
+template< unsigned int VSpaceDimension, unsigned int VSplineOrder >
+class GridAlignedBSplineWeightsTable
+{
+public:
+
+  /** Space dimension and spline order. */
+  itkStaticConstMacro( SpaceDimension, unsigned int, VSpaceDimension );
+  itkStaticConstMacro( SplineOrder, unsigned int, VSplineOrder );
+  itkStaticConstMacro( SupportSize, unsigned int, VSplineOrder + 1 );
+
+  /** The largest period that is stored. */
+  itkStaticConstMacro( MaximumPeriod, unsigned int, 256 );
+
+  /** The kinds of weights that are stored per table entry. */
+  typedef enum {
+    Weights                      = 0,
+    DerivativeWeights            = 1,
+    SecondOrderDerivativeWeights = 2
+  } WeightsKindType;
+
+  GridAlignedBSplineWeightsTable()
+  {
+    this->Clear();
+  }
+
+
+  /** Disable all axes. */
+  void Clear( void )
+  {
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      this->m_Origin[ i ]      = 0.0;
+      this->m_InverseStep[ i ] = 0.0;
+      this->m_Entries[ i ].clear();
+      this->m_Samples[ i ].clear();
+    }
+  } // end Clear()
+
+
+  /** Initialize the table for the lattice with continuous grid index
+   * origin[ i ] + k * step[ i ] along axis i, for k = 0, ..., size[ i ] - 1.
+   * Axes whose step is not a rational number with a denominator of at most
+   * MaximumPeriod are disabled. Returns true when at least one axis is enabled.
+   */
+  bool Initialize( const double origin[], const double step[], const SizeValueType size[] )
+  {
+    this->Clear();
+
+    typename BSplineKernelFunction2< SplineOrder >::Pointer kernel
+      = BSplineKernelFunction2< SplineOrder >::New();
+    typename BSplineDerivativeKernelFunction2< SplineOrder >::Pointer derivativeKernel
+      = BSplineDerivativeKernelFunction2< SplineOrder >::New();
+    typename BSplineSecondOrderDerivativeKernelFunction2< SplineOrder >::Pointer secondOrderDerivativeKernel
+      = BSplineSecondOrderDerivativeKernelFunction2< SplineOrder >::New();
+
+    bool enabled = false;
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      /** Find the smallest q such that q * step is an integer. */
+      const double absStep = std::abs( step[ i ] );
+      unsigned int period  = 0;
+      for( unsigned int q = 1; q <= MaximumPeriod && absStep > 0.0; ++q )
+      {
+        const double qs = q * absStep;
+        if( std::abs( qs - std::floor( qs + 0.5 ) ) < 1e-9 )
+        {
+          period = q;
+          break;
+        }
+      }
+      if( period == 0 || size[ i ] == 0 )
+      {
+        continue;
+      }
+
+      /** The distinct offsets are origin + m / q, for m = 0, ..., q - 1. */
+      this->m_Entries[ i ].resize( period );
+      for( unsigned int m = 0; m < period; ++m )
+      {
+        const double cindex = origin[ i ] + static_cast< double >( m ) / period;
+        const double start  = std::floor( cindex + 0.5 - SplineOrder / 2.0 );
+        EntryType &  entry  = this->m_Entries[ i ][ m ];
+        entry.m_Offset = cindex - start;
+        kernel->Evaluate( entry.m_Offset, entry.m_Weights[ Weights ] );
+        derivativeKernel->Evaluate( entry.m_Offset, entry.m_Weights[ DerivativeWeights ] );
+        if( SplineOrder >= 2 )
+        {
+          secondOrderDerivativeKernel->Evaluate( entry.m_Offset, entry.m_Weights[ SecondOrderDerivativeWeights ] );
+        }
+      }
+
+      /** Assign an entry to every sample. A sample whose support region
+       * starts differently from that of its entry, because it lies within
+       * rounding distance of a knot, gets a start index that never matches.
+       */
+      this->m_Origin[ i ]      = origin[ i ];
+      this->m_InverseStep[ i ] = 1.0 / step[ i ];
+      this->m_Samples[ i ].resize( size[ i ] );
+      for( SizeValueType k = 0; k < size[ i ]; ++k )
+      {
+        SampleType & sample = this->m_Samples[ i ][ k ];
+        sample.m_ContinuousIndex = origin[ i ] + static_cast< double >( k ) * step[ i ];
+        sample.m_StartIndex      = static_cast< IndexValueType >(
+          std::floor( sample.m_ContinuousIndex + 0.5 - SplineOrder / 2.0 ) );
+
+        long m = static_cast< long >( std::floor(
+          ( sample.m_ContinuousIndex - origin[ i ] ) * period + 0.5 ) ) % static_cast< long >( period );
+        if( m < 0 )
+        {
+          m += period;
+        }
+        const double offset = sample.m_ContinuousIndex - static_cast< double >( sample.m_StartIndex );
+        sample.m_Entry = static_cast< unsigned int >( m );
+        if( std::abs( offset - this->m_Entries[ i ][ m ].m_Offset ) > 1e-9 )
+        {
+          sample.m_StartIndex = NumericTraits< IndexValueType >::max();
+        }
+      }
+      enabled = true;
+    }
+
+    return enabled;
+
+  } // end Initialize()
+
+
+  /** Whether the table is enabled for an axis. */
+  bool IsEnabled( const unsigned int axis ) const
+  {
+    return !this->m_Samples[ axis ].empty();
+  }
+
+
+  /** Look up the 1D weights along axis for a point with continuous index
+   * cindex along that axis, whose support region starts at startIndex.
+   * Copies SupportSize weights of the requested kind and returns true on
+   * success; returns false, leaving weights untouched, when the point is not
+   * a sample of the lattice.
+   */
+  inline bool Lookup( const unsigned int axis, const double cindex,
+    const IndexValueType startIndex, const WeightsKindType kind, double * weights ) const
+  {
+    /** The second order derivative kernel is not defined for lower orders. */
+    if( kind == SecondOrderDerivativeWeights && SplineOrder < 2 )
+    {
+      return false;
+    }
+
+    /** Find the sample. The negated comparison also rejects NaN, and a
+     * disabled axis, which has no samples.
+     */
+    const std::vector< SampleType > & samples = this->m_Samples[ axis ];
+    const double k = ( cindex - this->m_Origin[ axis ] ) * this->m_InverseStep[ axis ] + 0.5;
+    if( !( k >= 0.0 && k < static_cast< double >( samples.size() ) ) )
+    {
+      return false;
+    }
+    const SampleType & sample = samples[ static_cast< std::size_t >( k ) ];
+
+    /** Check that the point is that sample. */
+    if( sample.m_StartIndex != startIndex
+      || std::abs( cindex - sample.m_ContinuousIndex ) > 1e-9 )
+    {
+      return false;
+    }
+
+    const double * entryWeights = this->m_Entries[ axis ][ sample.m_Entry ].m_Weights[ kind ];
+    for( unsigned int j = 0; j < SupportSize; ++j )
+    {
+      weights[ j ] = entryWeights[ j ];
+    }
+    return true;
+
+  } // end Lookup()
+
+
+private:
+
+  /** The offset and the weights of one table entry. */
+  struct EntryType
+  {
+    double m_Offset;
+    double m_Weights[ 3 ][ VSplineOrder + 1 ];
+  };
+
+  /** The continuous index, the start of the support region and the table
+   * entry of one sample.
+   */
+  struct SampleType
+  {
+    double         m_ContinuousIndex;
+    IndexValueType m_StartIndex;
+    unsigned int   m_Entry;
+  };
+
+  double                    m_Origin[ VSpaceDimension ];
+  double                    m_InverseStep[ VSpaceDimension ];
+  std::vector< EntryType >  m_Entries[ VSpaceDimension ];
+  std::vector< SampleType > m_Samples[ VSpaceDimension ];
+
+};
+
+} // end namespace itk
+
+#endif /* __itkGridAlignedBSplineWeightsTable_h */
@@ -131,6 +131,15 @@ public:
   /** Get the grid spacing schedule. */
   virtual void GetSchedule( VectorGridSpacingFactorType & schedule ) const;
 
+  /** Set whether a grid with half the grid spacing of the previous level
+   * should get a node at every node of that level, by adding one node when
+   * needed. This allows an exact upsampling of the B-spline parameters, but
+   * changes the grid of some levels. Default: false.
+   */
+  itkSetMacro( UseNestedGrids, bool );
+  itkGetConstMacro( UseNestedGrids, bool );
+  itkBooleanMacro( UseNestedGrids );
+
   /** Set an initial Transform. Only set one if composition is used. */
   itkSetConstObjectMacro( InitialTransform, TransformType );
 
@@ -186,6 +195,7 @@ private:
   unsigned int  m_BSplineOrder;
   unsigned int  m_NumberOfLevels;
   SpacingType   m_FinalGridSpacing;
+  bool          m_UseNestedGrids;
 
   /** Clamp the upsampling factor. */
   itkSetClampMacro( UpsamplingFactor, float, 1.0, NumericTraits< float >::max() );
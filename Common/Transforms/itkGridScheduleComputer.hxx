@@ -44,6 +44,7 @@ GridScheduleComputer< TTransformScalarType, VImageDimension >
   this->m_GridRegions.clear();
   this->m_GridSpacingFactors.clear();
   this->m_UpsamplingFactor = 2.0;
+  this->m_UseNestedGrids   = false;
 
   this->m_ImageOrigin.Fill( 0.0 );
   this->m_ImageSpacing.Fill( 1.0 );
@@ -150,9 +151,22 @@ GridScheduleComputer< TTransformScalarType, VImageDimension >
       this->m_GridSpacings[ res ][ dim ] = gridSpacing;
 
       /** Compute the grid size without the extra grid points at the edges. */
-      const unsigned int bareGridSize = static_cast< unsigned int >(
+      unsigned int bareGridSize = static_cast< unsigned int >(
         std::ceil( size[ dim ] * imageSpacing[ dim ] / gridSpacing ) );
 
+      /** All grids are centred on the image. If the grid spacing is half the
+       * grid spacing of the previous level, an even bareGridSize places a node
+       * at every node of the previous grid and halfway between them, so that
+       * the UpsampleBSplineParametersFilter can refine the parameters exactly.
+       * This changes the grid, so it is only done on request.
+       */
+      if( this->m_UseNestedGrids && res > 0 && bareGridSize % 2 == 1
+        && std::abs( 2.0 * gridSpacing - this->m_GridSpacings[ res - 1 ][ dim ] )
+        < 1e-4 * gridSpacing )
+      {
+        ++bareGridSize;
+      }
+
       /** The number of B-spline grid nodes is the bareGridSize plus the
        * B-spline order more grid nodes. */
       gridsize[ dim ] = static_cast< SizeValueType >(
@@ -391,6 +405,7 @@ GridScheduleComputer< TTransformScalarType, VImageDimension >
   this->m_ImageRegion.Print( os, indent.GetNextIndent() );
 
   os << indent << "FinalGridSpacing: " << this->m_FinalGridSpacing << std::endl;
+  os << indent << "UseNestedGrids: " << this->m_UseNestedGrids << std::endl;
   os << indent << "GridSpacingFactors: " << std::endl;
   for( unsigned int i = 0; i < this->m_NumberOfLevels; ++i )
   {
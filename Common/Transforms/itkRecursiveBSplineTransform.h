@@ -100,6 +100,9 @@ public:
   typedef typename Superclass::InternalMatrixType            InternalMatrixType;
   typedef typename Superclass::MovingImageGradientType       MovingImageGradientType;
   typedef typename Superclass::MovingImageGradientValueType  MovingImageGradientValueType;
+  typedef typename Superclass::InputCoordinateArraysType     InputCoordinateArraysType;
+  typedef typename Superclass::OutputCoordinateArraysType    OutputCoordinateArraysType;
+  typedef typename Superclass::ValidMaskValueType            ValidMaskValueType;
 
   /** Interpolation weights function type. */
   typedef typename Superclass::WeightsFunctionType                WeightsFunctionType;
@@ -133,6 +136,21 @@ public:
    */
   OutputPointType TransformPoint( const InputPointType & point ) const override;
 
+  /** Transform a batch of points. The points inside the valid region are
+   * gathered in groups of NumberOfLanes, whose B-spline weights are stored
+   * interleaved, after which RecursiveBSplineTransformImplementation::TransformPoints
+   * evaluates the whole group at once. Points outside the valid region are
+   * mapped onto themselves and get a zero in the valid mask.
+   */
+  void TransformPoints(
+    const InputCoordinateArraysType & inputCoordinates,
+    const OutputCoordinateArraysType & outputCoordinates,
+    const SizeValueType numberOfPoints,
+    ValidMaskValueType * validMask ) const override;
+
+  /** The number of points that TransformPoints() evaluates at once. */
+  itkStaticConstMacro( NumberOfLanes, unsigned int, 4 );
+
   /** Compute the Jacobian of the transformation. */
   void GetJacobian(
     const InputPointType & ipp,
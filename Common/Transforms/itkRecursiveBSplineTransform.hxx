@@ -35,6 +35,7 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
 ::RecursiveBSplineTransform() : Superclass()
 {
   this->m_RecursiveBSplineWeightFunction = RecursiveBSplineWeightFunctionType::New();
+  this->m_RecursiveBSplineWeightFunction->SetGridAlignedWeightsTable( &this->m_GridAlignedWeightsTable );
   this->m_Kernel                         = KernelType::New();
   this->m_DerivativeKernel               = DerivativeKernelType::New();
   this->m_SecondOrderDerivativeKernel    = SecondOrderDerivativeKernelType::New();
@@ -115,6 +116,142 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
 } // end TransformPoint()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::TransformPoints(
+  const InputCoordinateArraysType & inputCoordinates,
+  const OutputCoordinateArraysType & outputCoordinates,
+  const SizeValueType numberOfPoints,
+  ValidMaskValueType * validMask ) const
+{
+  /** Define some constants. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  const unsigned int numberOfLanes   = Self::NumberOfLanes;
+
+  /** Check if the coefficient image has been set. */
+  if( !this->m_CoefficientImages[ 0 ] )
+  {
+    itkWarningMacro( << "B-spline coefficients have not been set" );
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      std::copy( inputCoordinates[ j ], inputCoordinates[ j ] + numberOfPoints, outputCoordinates[ j ] );
+    }
+    if( validMask != nullptr )
+    {
+      std::fill( validMask, validMask + numberOfPoints, ValidMaskValueType( 0 ) );
+    }
+    return;
+  }
+
+  /** Allocate weights on the stack: */
+  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+
+  /** Per lane: the interleaved weights, the offset of the support index,
+   * the index of the point in the batch and the resulting displacement.
+   */
+  double          laneWeights[ numberOfWeights * numberOfLanes ];
+  OffsetValueType laneOffsets[ numberOfLanes ];
+  SizeValueType   lanePoints[ numberOfLanes ];
+  double          laneDisplacements[ SpaceDimension * numberOfLanes ];
+
+  /** Initialize (helper) variables. */
+  const OffsetValueType * bsplineOffsetTable = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+  ScalarType *            mu[ SpaceDimension ];
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer();
+  }
+
+  InputPointType      point;
+  ContinuousIndexType cindex;
+  IndexType           supportIndex;
+  SizeValueType       i = 0;
+  while( i < numberOfPoints )
+  {
+    /** Fill the lanes with the next points that lie inside the valid region. */
+    unsigned int filledLanes = 0;
+    for( ; i < numberOfPoints && filledLanes < numberOfLanes; ++i )
+    {
+      for( unsigned int j = 0; j < SpaceDimension; ++j )
+      {
+        point[ j ] = inputCoordinates[ j ][ i ];
+      }
+
+      // NOTE: if the support region does not lie totally within the grid
+      // we assume zero displacement and return the input point
+      this->TransformPointToContinuousGridIndex( point, cindex );
+      const bool inside = this->InsideValidRegion( cindex );
+      if( validMask != nullptr )
+      {
+        validMask[ i ] = inside ? 1 : 0;
+      }
+      if( !inside )
+      {
+        for( unsigned int j = 0; j < SpaceDimension; ++j )
+        {
+          outputCoordinates[ j ][ i ] = point[ j ];
+        }
+        continue;
+      }
+
+      /** Compute interpolation weighs and store them interleaved. */
+      this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+      for( unsigned int w = 0; w < numberOfWeights; ++w )
+      {
+        laneWeights[ w * numberOfLanes + filledLanes ] = weightsArray1D[ w ];
+      }
+
+      OffsetValueType totalOffsetToSupportIndex = 0;
+      for( unsigned int j = 0; j < SpaceDimension; ++j )
+      {
+        totalOffsetToSupportIndex += supportIndex[ j ] * bsplineOffsetTable[ j ];
+      }
+      laneOffsets[ filledLanes ] = totalOffsetToSupportIndex;
+      lanePoints[ filledLanes ]  = i;
+      ++filledLanes;
+    }
+
+    if( filledLanes == 0 )
+    {
+      break;
+    }
+
+    /** Pad the remaining lanes of the last group with a copy of the first lane. */
+    for( unsigned int l = filledLanes; l < numberOfLanes; ++l )
+    {
+      for( unsigned int w = 0; w < numberOfWeights; ++w )
+      {
+        laneWeights[ w * numberOfLanes + l ] = laneWeights[ w * numberOfLanes ];
+      }
+      laneOffsets[ l ] = laneOffsets[ 0 ];
+    }
+
+    /** Call the recursive TransformPoints function. */
+    RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+      ::template TransformPoints< numberOfLanes >(
+      laneDisplacements, mu, laneOffsets, bsplineOffsetTable, laneWeights );
+
+    // The output point is the start point + displacement.
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      for( unsigned int l = 0; l < filledLanes; ++l )
+      {
+        const SizeValueType n = lanePoints[ l ];
+        outputCoordinates[ j ][ n ] = inputCoordinates[ j ][ n ]
+          + static_cast< ScalarType >( laneDisplacements[ j * numberOfLanes + l ] );
+      }
+    }
+  }
+
+} // end TransformPoints()
+
+
 /**
  * ********************* GetJacobian ****************************
  */
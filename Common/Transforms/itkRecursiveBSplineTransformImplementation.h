@@ -100,6 +100,61 @@ public:
   } // end TransformPoint()
 
 
+  /** TransformPoints recursive implementation, which evaluates NumberOfLanes
+   * points at once. All arrays are interleaved over the lanes:
+   * opp[ j * NumberOfLanes + l ] is output dimension j of lane l,
+   * offsets[ l ] is the offset of the current support point of lane l with
+   * respect to the coefficient buffers mu[ j ], and
+   * weights1D[ w * NumberOfLanes + l ] is 1D weight w of lane l.
+   * The innermost loops run over the lanes, so that they can be vectorized.
+   */
+  template< unsigned int NumberOfLanes >
+  static inline void TransformPoints(
+    InternalFloatType * opp, const CoefficientPointerVectorType mu,
+    const OffsetValueType * offsets,
+    const OffsetValueType * gridOffsetTable,
+    const double * weights1D )
+  {
+    /** Make a copy of the offsets. They will move later. */
+    OffsetValueType tmp_offsets[ NumberOfLanes ];
+    for( unsigned int l = 0; l < NumberOfLanes; ++l )
+    {
+      tmp_offsets[ l ] = offsets[ l ];
+    }
+
+    /** Create a temporary opp and initialize the original. */
+    InternalFloatType tmp_opp[ OutputDimension * NumberOfLanes ];
+    for( unsigned int n = 0; n < OutputDimension * NumberOfLanes; ++n )
+    {
+      opp[ n ] = 0.0;
+    }
+
+    const OffsetValueType bot = gridOffsetTable[ SpaceDimension - 1 ];
+    for( unsigned int k = 0; k <= SplineOrder; ++k )
+    {
+      /** Recurse. */
+      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar >
+        ::template TransformPoints< NumberOfLanes >( tmp_opp, mu, tmp_offsets, gridOffsetTable, weights1D );
+
+      /** Accumulate the weights. */
+      const double * w = weights1D + ( k + HelperConstVariable ) * NumberOfLanes;
+      for( unsigned int j = 0; j < OutputDimension; ++j )
+      {
+        for( unsigned int l = 0; l < NumberOfLanes; ++l )
+        {
+          opp[ j * NumberOfLanes + l ] += tmp_opp[ j * NumberOfLanes + l ] * w[ l ];
+        }
+      }
+
+      /** Move to the next mu. */
+      for( unsigned int l = 0; l < NumberOfLanes; ++l )
+      {
+        tmp_offsets[ l ] += bot;
+      }
+    }
+  } // end TransformPoints()
+
+
   /** GetJacobian recursive implementation. */
   static inline void GetJacobian(
     ScalarType * & jacobians, const double * weights1D, double value )
@@ -403,6 +458,24 @@ public:
   } // end TransformPoint()
 
 
+  /** TransformPoints recursive implementation. */
+  template< unsigned int NumberOfLanes >
+  static inline void TransformPoints(
+    InternalFloatType * opp, const CoefficientPointerVectorType mu,
+    const OffsetValueType * offsets,
+    const OffsetValueType * gridOffsetTable,
+    const double * weights1D )
+  {
+    for( unsigned int j = 0; j < OutputDimension; ++j )
+    {
+      for( unsigned int l = 0; l < NumberOfLanes; ++l )
+      {
+        opp[ j * NumberOfLanes + l ] = mu[ j ][ offsets[ l ] ];
+      }
+    }
+  } // end TransformPoints()
+
+
   /** GetJacobian recursive implementation. */
   static inline void GetJacobian(
     ScalarType * & jacobians, const double * weights1D, double value )
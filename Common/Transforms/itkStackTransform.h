@@ -31,6 +31,16 @@ namespace itk
  * one for every last dimension index. This transform selects the right
  * transform based on the last dimension index of the input point.
  *
+ * The parameters of all sub transforms are stored in one buffer owned by
+ * this class. SetParameters() copies the parameters once into this buffer,
+ * and passes each sub transform a view on its slice. Sub transforms that
+ * keep a reference to their parameters (like the B-spline transforms) then
+ * share the buffer, and GetParameters() returns it without copying.
+ *
+ * TransformPoint() and GetJacobian() only read the sub transforms, so
+ * multiple threads may evaluate (different time points of) the stack
+ * concurrently.
+ *
  * \ingroup Transforms
  *
  */
@@ -144,11 +154,13 @@ public:
     NonZeroJacobianIndicesType & nzji ) const override;
 
   /** Set the parameters. Checks if the number of parameters
-   * is correct and sets parameters of sub transforms. */
+   * is correct and sets parameters of sub transforms. The sub
+   * transforms get views on slices of an internal buffer. */
   void SetParameters( const ParametersType & param ) override;
 
-  /** Get the parameters. Concatenates the parameters of the
-   * sub transforms. */
+  /** Get the parameters. Returns the internal buffer if all sub
+   * transforms still use their view on it, otherwise concatenates
+   * the parameters of the sub transforms. */
   const ParametersType & GetParameters( void ) const override;
 
   /** Set the fixed parameters. */
@@ -288,6 +300,15 @@ protected:
   StackTransform();
   ~StackTransform() override {}
 
+  /** Return the index of the sub transform for the given point. */
+  unsigned int GetSubTransformIndex( const InputPointType & ipp ) const
+  {
+    return vnl_math_min( this->m_NumberOfSubTransforms - 1, static_cast< unsigned int >(
+      vnl_math_max( 0,
+      vnl_math_rnd( ( ipp[ ReducedInputSpaceDimension ] - this->m_StackOrigin ) / this->m_StackSpacing ) ) ) );
+  }
+
+
 private:
 
   StackTransform( const Self & );  // purposely not implemented
@@ -300,6 +321,12 @@ private:
   // Stack spacing and origin of last dimension
   TScalarType m_StackSpacing, m_StackOrigin;
 
+  // The parameters of all sub transforms, and a view on the slice of
+  // each sub transform. The views are only (re)allocated together with
+  // the buffer, because sub transforms may keep a pointer to them.
+  ParametersType                m_SubTransformParametersBuffer;
+  std::vector< ParametersType > m_SubTransformParameters;
+
 };
 
 } // end namespace itk
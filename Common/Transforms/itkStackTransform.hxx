@@ -19,6 +19,7 @@
 #define _itkStackTransform_hxx
 
 #include "itkStackTransform.h"
+#include <algorithm>
 
 namespace itk
 {
@@ -47,22 +48,38 @@ StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
 {
   // All subtransforms should be the same and should have the same number of parameters.
   // Here we check if the number of parameters is #subtransforms * #parameters per subtransform.
-  if( param.GetSize() != this->GetNumberOfParameters() )
+  const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
+  if( param.GetSize() != numberOfParameters )
   {
     itkExceptionMacro( << "Number of parameters does not match the number of subtransforms * the number of parameters per subtransform." );
   }
 
-  // Set separate subtransform parameters
+  // (Re)allocate the buffer and the views on it, if the size changed
   const NumberOfParametersType numSubTransformParameters = this->m_SubTransformContainer[ 0 ]->GetNumberOfParameters();
+  if( this->m_SubTransformParametersBuffer.GetSize() != numberOfParameters
+    || this->m_SubTransformParameters.size() != this->m_NumberOfSubTransforms )
+  {
+    this->m_SubTransformParametersBuffer.SetSize( numberOfParameters );
+    this->m_SubTransformParameters.clear();
+    this->m_SubTransformParameters.resize( this->m_NumberOfSubTransforms );
+    for( unsigned int t = 0; t < this->m_NumberOfSubTransforms; ++t )
+    {
+      this->m_SubTransformParameters[ t ].SetData(
+        this->m_SubTransformParametersBuffer.data_block() + t * numSubTransformParameters,
+        numSubTransformParameters, false );
+    }
+  }
+
+  // Copy the parameters once, unless they are the buffer itself
+  if( param.data_block() != this->m_SubTransformParametersBuffer.data_block() )
+  {
+    std::copy( param.begin(), param.end(), this->m_SubTransformParametersBuffer.begin() );
+  }
+
+  // Pass each subtransform a view on its slice
   for( unsigned int t = 0; t < this->m_NumberOfSubTransforms; ++t )
   {
-    // MS, \todo: the new itk::TransformParameters only have constructors taking 1 argument
-    //ParametersType subparams ( ParametersArrayType( &( param.data_block()[ t * numSubTransformParameters ] ), numSubTransformParameters, false ) );
-    //ParametersType subparams ( &( param.data_block()[ t * numSubTransformParameters ] ), numSubTransformParameters, false );
-    // NTA, split the parameter by number of subparameters
-    const Array< double > subarray( &( param.data_block()[ t * numSubTransformParameters ] ), numSubTransformParameters );
-    ParametersType        subparams( subarray );
-    this->m_SubTransformContainer[ t ]->SetParametersByValue( subparams );
+    this->m_SubTransformContainer[ t ]->SetParameters( this->m_SubTransformParameters[ t ] );
   }
 
   this->Modified();
@@ -78,17 +95,26 @@ const typename StackTransform< TScalarType, NInputDimensions, NOutputDimensions
 & StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
 ::GetParameters( void ) const
 {
-  this->m_Parameters.SetSize( this->GetNumberOfParameters() );
+  // Return the buffer if all subtransforms still refer to their view on it
+  bool buffersInUse = this->m_SubTransformParameters.size() == this->m_NumberOfSubTransforms
+    && this->m_SubTransformParametersBuffer.GetSize() == this->GetNumberOfParameters();
+  for( unsigned int t = 0; t < this->m_NumberOfSubTransforms && buffersInUse; ++t )
+  {
+    buffersInUse = &( this->m_SubTransformContainer[ t ]->GetParameters() )
+      == &( this->m_SubTransformParameters[ t ] );
+  }
+  if( buffersInUse )
+  {
+    return this->m_SubTransformParametersBuffer;
+  }
 
   // Fill params with parameters of subtransforms
-  unsigned int i = 0;
+  this->m_Parameters.SetSize( this->GetNumberOfParameters() );
+  typename ParametersType::iterator it = this->m_Parameters.begin();
   for( unsigned int t = 0; t < this->m_NumberOfSubTransforms; ++t )
   {
     const ParametersType & subparams = this->m_SubTransformContainer[ t ]->GetParameters();
-    for( unsigned int p = 0; p < this->m_SubTransformContainer[ 0 ]->GetNumberOfParameters(); ++p, ++i )
-    {
-      this->m_Parameters[ i ] = subparams[ p ];
-    }
+    it = std::copy( subparams.begin(), subparams.end(), it );
   }
 
   return this->m_Parameters;
@@ -113,12 +139,8 @@ StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
   }
 
   /** Transform point using right subtransform. */
-  SubTransformOutputPointType oppr;
-  const unsigned int          subt
-    = vnl_math_min( this->m_NumberOfSubTransforms - 1, static_cast< unsigned int >(
-      vnl_math_max( 0,
-      vnl_math_rnd( ( ipp[ ReducedInputSpaceDimension ] - m_StackOrigin ) / m_StackSpacing ) ) ) );
-  oppr = this->m_SubTransformContainer[ subt ]->TransformPoint( ippr );
+  const SubTransformOutputPointType oppr
+    = this->m_SubTransformContainer[ this->GetSubTransformIndex( ipp ) ]->TransformPoint( ippr );
 
   /** Increase dimension of input point. */
   OutputPointType opp;
@@ -153,28 +175,25 @@ StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
   }
 
   /** Get Jacobian from right subtransform. */
-  const unsigned int subt
-    = vnl_math_min( this->m_NumberOfSubTransforms - 1, static_cast< unsigned int >(
-      vnl_math_max( 0,
-      vnl_math_rnd( ( ipp[ ReducedInputSpaceDimension ] - m_StackOrigin ) / m_StackSpacing ) ) ) );
+  const unsigned int       subt = this->GetSubTransformIndex( ipp );
   SubTransformJacobianType subjac;
   this->m_SubTransformContainer[ subt ]->GetJacobian( ippr, subjac, nzji );
 
-  /** Fill output Jacobian. */
-  jac.set_size( InputSpaceDimension, nzji.size() );
-  jac.Fill( 0.0 );
-  for( unsigned int d = 0; d < ReducedInputSpaceDimension; ++d )
-  {
-    for( unsigned int n = 0; n < nzji.size(); ++n )
-    {
-      jac[ d ][ n ] = subjac[ d ][ n ];
-    }
-  }
+  /** Fill output Jacobian. Both are stored row by row, so the rows of
+   * the sub Jacobian are copied at once, and only the last row is zeroed.
+   */
+  const unsigned int numberOfIndices = nzji.size();
+  jac.set_size( InputSpaceDimension, numberOfIndices );
+  typename JacobianType::element_type * jacIt = std::copy( subjac.data_block(),
+    subjac.data_block() + ReducedInputSpaceDimension * numberOfIndices, jac.data_block() );
+  std::fill( jacIt, jacIt + numberOfIndices, 0.0 );
 
   /** Update non zero Jacobian indices. */
-  for( unsigned int i = 0; i < nzji.size(); ++i )
+  const NumberOfParametersType offset
+    = subt * this->m_SubTransformContainer[ 0 ]->GetNumberOfParameters();
+  for( unsigned int i = 0; i < numberOfIndices; ++i )
   {
-    nzji[ i ] += subt * this->m_SubTransformContainer[ 0 ]->GetNumberOfParameters();
+    nzji[ i ] += offset;
   }
 
 } // end GetJacobian()
@@ -328,7 +328,9 @@ TransformToDeterminantOfSpatialJacobianSource< TOutputImage, TTransformPrecision
   outputPtr->SetSpacing( m_OutputSpacing );
   outputPtr->SetOrigin( m_OutputOrigin );
   outputPtr->SetDirection( m_OutputDirection );
-  outputPtr->Allocate();
+
+  // The output is allocated by the superclass, for the requested region
+  // only, so that the output can be generated in streamed pieces.
 
 } // end GenerateOutputInformation()
 
@@ -0,0 +1,270 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkTransformToInverseDisplacementFieldSource_h
+#define __itkTransformToInverseDisplacementFieldSource_h
+
+#include "itkAdvancedTransform.h"
+#include "itkImageSource.h"
+#include "itkArray.h"
+#include "vnl/vnl_matrix_fixed.h"
+#include "vnl/vnl_vector_fixed.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class TransformToInverseDisplacementFieldSource
+ * \brief Generate the displacement field of the inverse of a coordinate transform.
+ *
+ * For every point y of the output grid, the point x with T(x) = y is found,
+ * and the displacement x - y is stored.
+ *
+ * If the transform is linear, x is computed exactly, by inverting the
+ * matrix of the transform. Otherwise x is found by a damped Newton iteration
+ * x <- x - lambda J(x)^{-1} ( T(x) - y ), with J the spatial Jacobian of the
+ * transform. The step lambda is halved, starting from the best point found
+ * so far, whenever the residual |T(x) - y| does not decrease, and is doubled
+ * again (up to 1) after a successful step. Where the spatial Jacobian is
+ * singular, or if the transform does not provide it, the Newton direction is
+ * replaced by the residual itself, i.e. a damped fixed-point iteration.
+ *
+ * The iteration is seeded from the inverse computed on a grid that is
+ * CoarseningFactor times coarser, which is interpolated linearly. This
+ * coarse solve is itself computed by this filter, without seeding.
+ *
+ * After the update, the mean and maximum inverse-consistency error
+ * |T(x) - y| over the grid are available, as well as the indices of the
+ * voxels for which the Tolerance was not reached. There the displacement of
+ * the best point found is stored.
+ *
+ * Output information (spacing, size and direction) for the output
+ * image should be set, as for the TransformToDeterminantOfSpatialJacobianSource.
+ *
+ * This filter is implemented as a multithreaded filter. It provides a
+ * ThreadedGenerateData() method for its implementation.
+ *
+ * \ingroup GeometricTransforms
+ */
+template< class TOutputImage,
+class TTransformPrecisionType = double >
+class TransformToInverseDisplacementFieldSource :
+  public ImageSource< TOutputImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef TransformToInverseDisplacementFieldSource Self;
+  typedef ImageSource< TOutputImage >               Superclass;
+  typedef SmartPointer< Self >                      Pointer;
+  typedef SmartPointer< const Self >                ConstPointer;
+
+  typedef TOutputImage                           OutputImageType;
+  typedef typename OutputImageType::Pointer      OutputImagePointer;
+  typedef typename OutputImageType::ConstPointer OutputImageConstPointer;
+  typedef typename OutputImageType::RegionType   OutputImageRegionType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( TransformToInverseDisplacementFieldSource, ImageSource );
+
+  /** Number of dimensions. */
+  itkStaticConstMacro( ImageDimension, unsigned int,
+    TOutputImage::ImageDimension );
+
+  /** Typedefs for transform. */
+  typedef AdvancedTransform< TTransformPrecisionType,
+    itkGetStaticConstMacro( ImageDimension ),
+    itkGetStaticConstMacro( ImageDimension ) >     TransformType;
+  typedef typename TransformType::ConstPointer    TransformPointerType;
+  typedef typename TransformType::InputPointType  InputPointType;
+  typedef typename TransformType::OutputPointType OutputPointType;
+
+  /** Typedefs for output image. */
+  typedef typename OutputImageType::PixelType     PixelType;
+  typedef typename PixelType::ValueType           PixelValueType;
+  typedef typename OutputImageType::RegionType    RegionType;
+  typedef typename RegionType::SizeType           SizeType;
+  typedef typename OutputImageType::IndexType     IndexType;
+  typedef typename OutputImageType::PointType     PointType;
+  typedef typename OutputImageType::SpacingType   SpacingType;
+  typedef typename OutputImageType::PointType     OriginType;
+  typedef typename OutputImageType::DirectionType DirectionType;
+
+  /** Typedefs for base image. */
+  typedef ImageBase< itkGetStaticConstMacro( ImageDimension ) > ImageBaseType;
+
+  /** Set the coordinate transformation that is to be inverted. */
+  itkSetConstObjectMacro( Transform, TransformType );
+
+  /** Get a pointer to the coordinate transform. */
+  itkGetConstObjectMacro( Transform, TransformType );
+
+  /** Set the size of the output image. */
+  virtual void SetOutputSize( const SizeType & size );
+
+  /** Get the size of the output image. */
+  virtual const SizeType & GetOutputSize();
+
+  /** Set the start index of the output largest possible region.
+  * The default is an index of all zeros. */
+  virtual void SetOutputIndex( const IndexType & index );
+
+  /** Get the start index of the output largest possible region. */
+  virtual const IndexType & GetOutputIndex();
+
+  /** Set the region of the output image. */
+  itkSetMacro( OutputRegion, OutputImageRegionType );
+
+  /** Get the region of the output image. */
+  itkGetConstReferenceMacro( OutputRegion, OutputImageRegionType );
+
+  /** Set the output image spacing. */
+  itkSetMacro( OutputSpacing, SpacingType );
+  virtual void SetOutputSpacing( const double * values );
+
+  /** Get the output image spacing. */
+  itkGetConstReferenceMacro( OutputSpacing, SpacingType );
+
+  /** Set the output image origin. */
+  itkSetMacro( OutputOrigin, OriginType );
+  virtual void SetOutputOrigin( const double * values );
+
+  /** Get the output image origin. */
+  itkGetConstReferenceMacro( OutputOrigin, OriginType );
+
+  /** Set the output direction cosine matrix. */
+  itkSetMacro( OutputDirection, DirectionType );
+  itkGetConstReferenceMacro( OutputDirection, DirectionType );
+
+  /** Helper method to set the output parameters based on this image */
+  void SetOutputParametersFromImage( const ImageBaseType * image );
+
+  /** Set/Get the maximum number of iterations per point. Default: 20. */
+  itkSetMacro( MaximumNumberOfIterations, unsigned int );
+  itkGetConstMacro( MaximumNumberOfIterations, unsigned int );
+
+  /** Set/Get the tolerance on |T(x) - y|, in physical units. Default: 0.01. */
+  itkSetMacro( Tolerance, double );
+  itkGetConstMacro( Tolerance, double );
+
+  /** Set/Get the factor by which the grid of the initial guess is coarser
+   * than the output grid. A factor of 1 or less disables the coarse initial
+   * guess. Default: 4.
+   */
+  itkSetMacro( CoarseningFactor, unsigned int );
+  itkGetConstMacro( CoarseningFactor, unsigned int );
+
+  /** Get the inverse-consistency errors |T(x) - y|, available after the update. */
+  itkGetConstMacro( MeanInverseConsistencyError, double );
+  itkGetConstMacro( MaximumInverseConsistencyError, double );
+
+  /** Get the number of points for which the tolerance was not reached. */
+  itkGetConstMacro( NumberOfNonConvergedPoints, SizeValueType );
+
+  /** Get the indices of the voxels for which the tolerance was not reached. */
+  const std::vector< IndexType > & GetNonConvergedIndices( void ) const
+  { return this->m_NonConvergedIndices; }
+
+  /** TransformToInverseDisplacementFieldSource produces a vector image. */
+  void GenerateOutputInformation( void ) override;
+
+  /** Checking if transform is set, and computing the coarse initial guess. */
+  void BeforeThreadedGenerateData( void ) override;
+
+  /** Gather the inverse-consistency errors of the threads. */
+  void AfterThreadedGenerateData( void ) override;
+
+  /** Compute the Modified Time based on changes to the components. */
+  ModifiedTimeType GetMTime( void ) const override;
+
+protected:
+
+  TransformToInverseDisplacementFieldSource();
+  ~TransformToInverseDisplacementFieldSource() override {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+  /** TransformToInverseDisplacementFieldSource is implemented as a
+   * multithreaded filter.
+   */
+  void ThreadedGenerateData(
+    const OutputImageRegionType & outputRegionForThread,
+    ThreadIdType threadId ) override;
+
+  /** Compute the direction of a step from x: the Newton direction
+   * J(x)^{-1} ( T(x) - y ), or the residual T(x) - y itself if the Newton
+   * step is not used or the spatial Jacobian is singular.
+   */
+  virtual void ComputeSearchDirection( const InputPointType & x,
+    const double residual[], double direction[] ) const;
+
+private:
+
+  TransformToInverseDisplacementFieldSource( const Self & ); // purposely not implemented
+  void operator=( const Self & );                            // purposely not implemented
+
+  /** Member variables. */
+  RegionType           m_OutputRegion;         // region of the output image
+  TransformPointerType m_Transform;            // Coordinate transform to invert
+  SpacingType          m_OutputSpacing;        // output image spacing
+  OriginType           m_OutputOrigin;         // output image origin
+  DirectionType        m_OutputDirection;      // output image direction cosines
+
+  unsigned int m_MaximumNumberOfIterations;
+  double       m_Tolerance;
+  unsigned int m_CoarseningFactor;
+
+  /** The inverse on the coarse grid, used as initial guess. */
+  OutputImagePointer m_CoarseInverseDisplacementField;
+
+  /** The exact inverse x = A^{-1} ( y - b ) of a linear transform T(x) = A x + b. */
+  typedef vnl_matrix_fixed< double, itkGetStaticConstMacro( ImageDimension ),
+    itkGetStaticConstMacro( ImageDimension ) >              InternalMatrixType;
+  typedef vnl_vector_fixed< double,
+    itkGetStaticConstMacro( ImageDimension ) >              InternalVectorType;
+  bool               m_UseLinearInverse;
+  InternalMatrixType m_LinearInverseMatrix;
+  InternalVectorType m_LinearOffset;
+
+  /** Whether the transform provides its spatial Jacobian for the Newton step. */
+  bool m_UseNewtonStep;
+
+  /** The inverse-consistency errors, and per thread temporaries. */
+  double                 m_MeanInverseConsistencyError;
+  double                 m_MaximumInverseConsistencyError;
+  SizeValueType          m_NumberOfNonConvergedPoints;
+  Array< double >        m_ThreadSumError;
+  Array< double >        m_ThreadMaximumError;
+  Array< SizeValueType > m_ThreadNumberOfNonConvergedPoints;
+
+  /** The non-converged voxels, and per thread temporaries. */
+  std::vector< IndexType >                m_NonConvergedIndices;
+  std::vector< std::vector< IndexType > > m_ThreadNonConvergedIndices;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkTransformToInverseDisplacementFieldSource.hxx"
+#endif
+
+#endif // end #ifndef __itkTransformToInverseDisplacementFieldSource_h
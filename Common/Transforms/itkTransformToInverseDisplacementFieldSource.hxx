@@ -0,0 +1,614 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkTransformToInverseDisplacementFieldSource_hxx
+#define __itkTransformToInverseDisplacementFieldSource_hxx
+
+#include "itkTransformToInverseDisplacementFieldSource.h"
+
+#include "itkAdvancedIdentityTransform.h"
+#include "itkProgressReporter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkVectorLinearInterpolateImageFunction.h"
+#include "vnl/vnl_det.h"
+#include "vnl/vnl_inverse.h"
+
+#include <algorithm> // std::max, std::min
+#include <cmath>     // std::sqrt, std::abs
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::TransformToInverseDisplacementFieldSource()
+{
+  this->m_OutputSpacing.Fill( 1.0 );
+  this->m_OutputOrigin.Fill( 0.0 );
+  this->m_OutputDirection.SetIdentity();
+
+  SizeType size;
+  size.Fill( 0 );
+  this->m_OutputRegion.SetSize( size );
+
+  IndexType index;
+  index.Fill( 0 );
+  this->m_OutputRegion.SetIndex( index );
+
+  this->m_Transform = AdvancedIdentityTransform< TTransformPrecisionType, ImageDimension >::New();
+
+  this->m_MaximumNumberOfIterations      = 20;
+  this->m_Tolerance                      = 0.01;
+  this->m_CoarseningFactor               = 4;
+  this->m_MeanInverseConsistencyError    = 0.0;
+  this->m_MaximumInverseConsistencyError = 0.0;
+  this->m_NumberOfNonConvergedPoints     = 0;
+  this->m_UseLinearInverse               = false;
+  this->m_UseNewtonStep                  = false;
+
+#if ITK_VERSION_MAJOR >= 5
+  // Use the classic (ITK4) threading model, to ensure ThreadedGenerateData is being called.
+  this->itk::ImageSource<TOutputImage>::DynamicMultiThreadingOff();
+#endif
+
+} // end Constructor
+
+
+/**
+ * Print out a description of self
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "OutputRegion: " << this->m_OutputRegion << std::endl;
+  os << indent << "OutputSpacing: " << this->m_OutputSpacing << std::endl;
+  os << indent << "OutputOrigin: " << this->m_OutputOrigin << std::endl;
+  os << indent << "OutputDirection: " << this->m_OutputDirection << std::endl;
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << indent << "MaximumNumberOfIterations: " << this->m_MaximumNumberOfIterations << std::endl;
+  os << indent << "Tolerance: " << this->m_Tolerance << std::endl;
+  os << indent << "CoarseningFactor: " << this->m_CoarseningFactor << std::endl;
+  os << indent << "MeanInverseConsistencyError: " << this->m_MeanInverseConsistencyError << std::endl;
+  os << indent << "MaximumInverseConsistencyError: " << this->m_MaximumInverseConsistencyError << std::endl;
+  os << indent << "NumberOfNonConvergedPoints: " << this->m_NumberOfNonConvergedPoints << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * Set the output image size.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SetOutputSize( const SizeType & size )
+{
+  this->m_OutputRegion.SetSize( size );
+}
+
+
+/**
+ * Get the output image size.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+const typename TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SizeType
+& TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GetOutputSize()
+{
+  return this->m_OutputRegion.GetSize();
+}
+
+/**
+ * Set the output image index.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SetOutputIndex( const IndexType & index )
+{
+  this->m_OutputRegion.SetIndex( index );
+}
+
+
+/**
+ * Get the output image index.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+const typename TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::IndexType
+& TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GetOutputIndex()
+{
+  return this->m_OutputRegion.GetIndex();
+}
+
+/**
+ * Set the output image spacing.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SetOutputSpacing( const double * spacing )
+{
+  SpacingType s( spacing );
+  this->SetOutputSpacing( s );
+
+} // end SetOutputSpacing()
+
+
+/**
+ * Set the output image origin.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SetOutputOrigin( const double * origin )
+{
+  OriginType p( origin );
+  this->SetOutputOrigin( p );
+
+}
+
+
+/** Helper method to set the output parameters based on this image */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SetOutputParametersFromImage( const ImageBaseType * image )
+{
+  if( !image )
+  {
+    itkExceptionMacro( << "Cannot use a null image reference" );
+  }
+
+  this->SetOutputOrigin( image->GetOrigin() );
+  this->SetOutputSpacing( image->GetSpacing() );
+  this->SetOutputDirection( image->GetDirection() );
+  this->SetOutputRegion( image->GetLargestPossibleRegion() );
+
+} // end SetOutputParametersFromImage()
+
+
+/**
+ * Set up state of filter before multi-threading.
+ * The coarse initial guess is computed here, by a second instance of
+ * this filter, which is multi-threaded itself.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::BeforeThreadedGenerateData( void )
+{
+  if( !this->m_Transform )
+  {
+    itkExceptionMacro( << "Transform not set" );
+  }
+
+#if ITK_VERSION_MAJOR >= 5
+  const ThreadIdType numberOfThreads = this->GetNumberOfWorkUnits();
+#else
+  const ThreadIdType numberOfThreads = this->GetNumberOfThreads();
+#endif
+
+  // Resize and initialize the thread temporaries
+  this->m_ThreadSumError.SetSize( numberOfThreads );
+  this->m_ThreadMaximumError.SetSize( numberOfThreads );
+  this->m_ThreadNumberOfNonConvergedPoints.SetSize( numberOfThreads );
+  this->m_ThreadSumError.Fill( 0.0 );
+  this->m_ThreadMaximumError.Fill( 0.0 );
+  this->m_ThreadNumberOfNonConvergedPoints.Fill( 0 );
+  this->m_ThreadNonConvergedIndices.assign( numberOfThreads, std::vector< IndexType >() );
+  this->m_NonConvergedIndices.clear();
+
+  // A linear transform T(x) = A x + b is inverted exactly. The columns of
+  // A are found by mapping the unit vectors.
+  this->m_CoarseInverseDisplacementField = 0;
+  this->m_UseLinearInverse               = this->m_Transform->IsLinear();
+  if( this->m_UseLinearInverse )
+  {
+    InputPointType zero;
+    zero.Fill( 0.0 );
+    const OutputPointType offset = this->m_Transform->TransformPoint( zero );
+    InternalMatrixType    matrix;
+    for( unsigned int j = 0; j < ImageDimension; ++j )
+    {
+      InputPointType unit = zero;
+      unit[ j ] = 1.0;
+      const OutputPointType mapped = this->m_Transform->TransformPoint( unit );
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+        matrix( i, j ) = mapped[ i ] - offset[ i ];
+      }
+      this->m_LinearOffset[ j ] = offset[ j ];
+    }
+    if( vnl_det( matrix ) == 0.0 )
+    {
+      itkExceptionMacro( << "The linear transform is not invertible" );
+    }
+    this->m_LinearInverseMatrix = vnl_inverse( matrix );
+    return;
+  }
+
+  // Use the Newton step if the transform provides its spatial Jacobian.
+  this->m_UseNewtonStep = true;
+  try
+  {
+    typename TransformType::SpatialJacobianType sj;
+    InputPointType                              origin;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      origin[ i ] = this->m_OutputOrigin[ i ];
+    }
+    this->m_Transform->GetSpatialJacobian( origin, sj );
+  }
+  catch( ExceptionObject & )
+  {
+    this->m_UseNewtonStep = false;
+  }
+
+  // Compute the inverse on a coarser grid, covering the output grid,
+  // unless the output grid is too small to benefit from it.
+  const unsigned int factor = this->m_CoarseningFactor;
+  if( factor <= 1 )
+  {
+    return;
+  }
+
+  const SizeType & size = this->m_OutputRegion.GetSize();
+  SizeType         coarseSize;
+  SpacingType      coarseSpacing;
+  bool             useCoarseGrid = true;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    if( size[ i ] < 2 * factor )
+    {
+      useCoarseGrid = false;
+    }
+    coarseSize[ i ]    = ( size[ i ] - 1 + factor - 1 ) / factor + 1;
+    coarseSpacing[ i ] = this->m_OutputSpacing[ i ] * factor;
+  }
+  if( !useCoarseGrid )
+  {
+    return;
+  }
+
+  OutputImagePointer outputPtr = this->GetOutput();
+  PointType          coarseOrigin;
+  outputPtr->TransformIndexToPhysicalPoint( this->m_OutputRegion.GetIndex(), coarseOrigin );
+
+  Pointer coarseSource = Self::New();
+  coarseSource->SetTransform( this->m_Transform );
+  coarseSource->SetOutputSize( coarseSize );
+  coarseSource->SetOutputSpacing( coarseSpacing );
+  coarseSource->SetOutputOrigin( coarseOrigin );
+  coarseSource->SetOutputDirection( this->m_OutputDirection );
+  coarseSource->SetMaximumNumberOfIterations( this->m_MaximumNumberOfIterations );
+  coarseSource->SetTolerance( this->m_Tolerance );
+  coarseSource->SetCoarseningFactor( 1 );
+#if ITK_VERSION_MAJOR >= 5
+  coarseSource->SetNumberOfWorkUnits( numberOfThreads );
+#else
+  coarseSource->SetNumberOfThreads( numberOfThreads );
+#endif
+  coarseSource->Update();
+
+  this->m_CoarseInverseDisplacementField = coarseSource->GetOutput();
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * ThreadedGenerateData
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::ThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread,
+  ThreadIdType threadId )
+{
+  typedef VectorLinearInterpolateImageFunction<
+    OutputImageType, TTransformPrecisionType >    InterpolatorType;
+  typedef typename InterpolatorType::OutputType InterpolatorOutputType;
+
+  // Get the output pointer
+  OutputImagePointer outputPtr = this->GetOutput();
+
+  // The interpolator of the initial guess; its SetInputImage is cheap,
+  // so every thread uses its own.
+  typename InterpolatorType::Pointer interpolator;
+  if( this->m_CoarseInverseDisplacementField.IsNotNull() )
+  {
+    interpolator = InterpolatorType::New();
+    interpolator->SetInputImage( this->m_CoarseInverseDisplacementField );
+  }
+
+  // Create an iterator that will walk the output region for this thread.
+  typedef ImageRegionIteratorWithIndex< TOutputImage > OutputIteratorType;
+  OutputIteratorType it( outputPtr, outputRegionForThread );
+  it.GoToBegin();
+
+  // Support for progress methods/callbacks
+  ProgressReporter progress( this, threadId, outputRegionForThread.GetNumberOfPixels() );
+
+  const double  toleranceSquared           = this->m_Tolerance * this->m_Tolerance;
+  double        sumError                   = 0.0;
+  double        maximumError               = 0.0;
+  SizeValueType numberOfNonConvergedPoints = 0;
+
+  PointType      target;
+  InputPointType x;
+  InputPointType bestX;
+  double         direction[ ImageDimension ];
+  PixelType      displacement;
+
+  // Walk the output region
+  while( !it.IsAtEnd() )
+  {
+    // Determine the coordinates of the current voxel
+    outputPtr->TransformIndexToPhysicalPoint( it.GetIndex(), target );
+
+    // The exact inverse of a linear transform
+    if( this->m_UseLinearInverse )
+    {
+      InternalVectorType y;
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+        y[ i ] = target[ i ] - this->m_LinearOffset[ i ];
+      }
+      const InternalVectorType inverse = this->m_LinearInverseMatrix * y;
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+        x[ i ] = inverse[ i ];
+      }
+    }
+    else
+    {
+      // The initial guess
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+        x[ i ] = target[ i ];
+      }
+      if( interpolator.IsNotNull() && interpolator->IsInsideBuffer( target ) )
+      {
+        const InterpolatorOutputType seed = interpolator->Evaluate( target );
+        for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+          x[ i ] += seed[ i ];
+        }
+      }
+    }
+
+    // The damped Newton iteration x <- x - step * J(x)^{-1} ( T(x) - y ),
+    // backtracking from the best point found whenever the residual does
+    // not decrease. For a linear transform no iterations are needed.
+    const unsigned int maximumNumberOfIterations
+      = this->m_UseLinearInverse ? 0 : this->m_MaximumNumberOfIterations;
+    double       step         = 1.0;
+    double       bestResidual = NumericTraits< double >::max();
+    unsigned int iteration    = 0;
+    while( true )
+    {
+      const OutputPointType mapped = this->m_Transform->TransformPoint( x );
+      double                residual[ ImageDimension ];
+      double                residualSquared = 0.0;
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+        residual[ i ]    = mapped[ i ] - target[ i ];
+        residualSquared += residual[ i ] * residual[ i ];
+      }
+
+      const bool improved = residualSquared < bestResidual;
+      if( improved )
+      {
+        bestResidual = residualSquared;
+        bestX        = x;
+      }
+      if( residualSquared < toleranceSquared || iteration == maximumNumberOfIterations )
+      {
+        break;
+      }
+
+      if( improved )
+      {
+        // A new direction from the new best point, and a larger step.
+        this->ComputeSearchDirection( x, residual, direction );
+        step = std::min( 1.0, 2.0 * step );
+      }
+      else
+      {
+        step *= 0.5;
+      }
+
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+        x[ i ] = bestX[ i ] - step * direction[ i ];
+      }
+      ++iteration;
+    }
+
+    // Store the displacement of the inverse
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      displacement[ i ] = static_cast< PixelValueType >( bestX[ i ] - target[ i ] );
+    }
+    it.Set( displacement );
+
+    // Gather the inverse-consistency error
+    const double error = std::sqrt( bestResidual );
+    sumError += error;
+    if( error > maximumError )
+    {
+      maximumError = error;
+    }
+    if( bestResidual >= toleranceSquared )
+    {
+      ++numberOfNonConvergedPoints;
+      this->m_ThreadNonConvergedIndices[ threadId ].push_back( it.GetIndex() );
+    }
+
+    // Update progress and iterator
+    progress.CompletedPixel();
+    ++it;
+  }
+
+  this->m_ThreadSumError[ threadId ]                   = sumError;
+  this->m_ThreadMaximumError[ threadId ]               = maximumError;
+  this->m_ThreadNumberOfNonConvergedPoints[ threadId ] = numberOfNonConvergedPoints;
+
+} // end ThreadedGenerateData()
+
+
+/**
+ * Compute the Newton direction J(x)^{-1} ( T(x) - y ).
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::ComputeSearchDirection( const InputPointType & x,
+  const double residual[], double direction[] ) const
+{
+  if( this->m_UseNewtonStep )
+  {
+    typename TransformType::SpatialJacobianType sj;
+    this->m_Transform->GetSpatialJacobian( x, sj );
+    InternalMatrixType jacobian;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      for( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+        jacobian( i, j ) = sj( i, j );
+      }
+    }
+
+    // Where the spatial Jacobian is (nearly) singular, use the fixed-point direction.
+    if( std::abs( vnl_det( jacobian ) ) > 1e-10 )
+    {
+      const InternalMatrixType inverse = vnl_inverse( jacobian );
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+        direction[ i ] = 0.0;
+        for( unsigned int j = 0; j < ImageDimension; ++j )
+        {
+          direction[ i ] += inverse( i, j ) * residual[ j ];
+        }
+      }
+      return;
+    }
+  }
+
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    direction[ i ] = residual[ i ];
+  }
+
+} // end ComputeSearchDirection()
+
+
+/**
+ * Gather the inverse-consistency errors of the threads.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::AfterThreadedGenerateData( void )
+{
+  double        sumError                   = 0.0;
+  double        maximumError               = 0.0;
+  SizeValueType numberOfNonConvergedPoints = 0;
+  for( unsigned int i = 0; i < this->m_ThreadSumError.GetSize(); ++i )
+  {
+    sumError                   += this->m_ThreadSumError[ i ];
+    maximumError                = std::max( maximumError, this->m_ThreadMaximumError[ i ] );
+    numberOfNonConvergedPoints += this->m_ThreadNumberOfNonConvergedPoints[ i ];
+    this->m_NonConvergedIndices.insert( this->m_NonConvergedIndices.end(),
+      this->m_ThreadNonConvergedIndices[ i ].begin(), this->m_ThreadNonConvergedIndices[ i ].end() );
+  }
+  this->m_ThreadNonConvergedIndices.clear();
+
+  const SizeValueType numberOfPixels = this->m_OutputRegion.GetNumberOfPixels();
+  this->m_MeanInverseConsistencyError
+    = numberOfPixels > 0 ? sumError / static_cast< double >( numberOfPixels ) : 0.0;
+  this->m_MaximumInverseConsistencyError = maximumError;
+  this->m_NumberOfNonConvergedPoints     = numberOfNonConvergedPoints;
+
+  // The coarse initial guess is not needed anymore.
+  this->m_CoarseInverseDisplacementField = 0;
+
+} // end AfterThreadedGenerateData()
+
+
+/**
+ * Inform pipeline of required output region
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GenerateOutputInformation( void )
+{
+  // call the superclass' implementation of this method
+  Superclass::GenerateOutputInformation();
+
+  // get pointer to the output
+  OutputImagePointer outputPtr = this->GetOutput();
+  if( !outputPtr )
+  {
+    return;
+  }
+
+  outputPtr->SetLargestPossibleRegion( m_OutputRegion );
+  outputPtr->SetSpacing( m_OutputSpacing );
+  outputPtr->SetOrigin( m_OutputOrigin );
+  outputPtr->SetDirection( m_OutputDirection );
+  outputPtr->Allocate();
+
+} // end GenerateOutputInformation()
+
+
+/**
+ * Verify if any of the components has been modified.
+ */
+template< class TOutputImage, class TTransformPrecisionType >
+ModifiedTimeType
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GetMTime( void ) const
+{
+  ModifiedTimeType latestTime = Object::GetMTime();
+
+  if( this->m_Transform )
+  {
+    if( latestTime < this->m_Transform->GetMTime() )
+    {
+      latestTime = this->m_Transform->GetMTime();
+    }
+  }
+
+  return latestTime;
+} // end GetMTime()
+
+
+} // end namespace itk
+
+#endif // end #ifndef _itkTransformToInverseDisplacementFieldSource_hxx
@@ -335,7 +335,9 @@ TransformToSpatialJacobianSource< TOutputImage, TTransformPrecisionType >
   outputPtr->SetSpacing( m_OutputSpacing );
   outputPtr->SetOrigin( m_OutputOrigin );
   outputPtr->SetDirection( m_OutputDirection );
-  outputPtr->Allocate();
+
+  // The output is allocated by the superclass, for the requested region
+  // only, so that the output can be generated in streamed pieces.
 
 } // end GenerateOutputInformation()
 
@@ -20,6 +20,8 @@
 
 #include "itkObject.h"
 #include "itkArray.h"
+#include "itkMultiThreader.h"
+#include <vector>
 
 namespace itk
 {
@@ -33,6 +35,15 @@ namespace itk
  * on a denser grid. Therefore, the user needs to supply the old B-spline grid
  * (region, spacing, origin, direction), and the required B-spline grid.
  *
+ * If the required grid is a dyadic refinement of the current grid, i.e. it
+ * has the same direction, half the spacing, and its nodes lie on the refined
+ * lattice of the current grid, the new coefficients are computed exactly with
+ * the two-scale relation of the B-spline,
+ *   B^n(x) = 2^{-n} \sum_{k=0}^{n+1} \binom{n+1}{k} B^n( 2x - k + (n+1)/2 ).
+ * This is a small separable convolution, which is done multi-threaded.
+ * Otherwise the current B-spline is resampled on the required grid and a
+ * B-spline decomposition is applied to the result.
+ *
  */
 
 template< class TArray, class TImage >
@@ -63,6 +74,7 @@ public:
   typedef typename ImageType::PointType     OriginType;
   typedef typename ImageType::DirectionType DirectionType;
   typedef typename ImageType::RegionType    RegionType;
+  typedef typename ImageType::IndexType     IndexType;
 
   /** Dimension of the fixed image. */
   itkStaticConstMacro( Dimension, unsigned int, ImageType::ImageDimension );
@@ -112,6 +124,39 @@ protected:
   /** Function that checks if upsampling is required. */
   virtual bool DoUpsampling( void );
 
+  /** Function that checks if the required grid is a dyadic refinement of
+   * the current grid. If so, firstFineIndex returns the position of the
+   * first required grid node on the refined lattice of the current grid.
+   */
+  virtual bool IsDyadicRefinement( IndexType & firstFineIndex ) const;
+
+  /** Compute the output parameters exactly by the two-scale relation. */
+  virtual void RefineParameters( const ArrayType & param_in,
+    ArrayType & param_out, const IndexType & firstFineIndex );
+
+  /** Typedefs for multi-threading. */
+  typedef itk::MultiThreader             ThreaderType;
+  typedef ThreaderType::ThreadInfoStruct ThreadInfoType;
+
+  /** Struct to pass the refinement of one dimension to the threads. The
+   * coefficients are processed as lines along this dimension, which are
+   * st_Stride elements apart.
+   */
+  struct RefineThreadStruct
+  {
+    const ValueType *                st_Input;
+    ValueType *                      st_Output;
+    const std::vector< ValueType > * st_Mask;
+    unsigned long                    st_NumberOfLines;
+    unsigned long                    st_Stride;
+    unsigned long                    st_InputLength;
+    unsigned long                    st_OutputLength;
+    OffsetValueType                  st_FirstFineIndex;
+  };
+
+  /** Refine a set of lines along one dimension. */
+  static ITK_THREAD_RETURN_TYPE RefineThreaderCallback( void * arg );
+
 private:
 
   UpsampleBSplineParametersFilter( const Self & ); // purposely not implemented
@@ -24,6 +24,9 @@
 #include "itkBSplineDecompositionImageFilter.h"
 #include "itkResampleImageFilter.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace itk
 {
 
@@ -64,6 +67,14 @@ UpsampleBSplineParametersFilter< TArray, TImage >
     return;
   }
 
+  /** Refine exactly if the required grid is a dyadic refinement. */
+  IndexType firstFineIndex;
+  if( this->IsDyadicRefinement( firstFineIndex ) )
+  {
+    this->RefineParameters( parameters_in, parameters_out, firstFineIndex );
+    return;
+  }
+
   /** Typedefs. */
   typedef itk::ResampleImageFilter<
     ImageType, ImageType >                        UpsampleFilterType;
@@ -183,6 +194,220 @@ UpsampleBSplineParametersFilter< TArray, TImage >
 } // end DoUpsampling()
 
 
+/**
+ * ******************* IsDyadicRefinement *******************
+ */
+
+template< class TArray, class TImage >
+bool
+UpsampleBSplineParametersFilter< TArray, TImage >
+::IsDyadicRefinement( IndexType & firstFineIndex ) const
+{
+  const double tolerance = 1e-4;
+
+  /** The grid directions should be equal. */
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      if( std::abs( this->m_CurrentGridDirection[ i ][ j ]
+        - this->m_RequiredGridDirection[ i ][ j ] ) > tolerance )
+      {
+        return false;
+      }
+    }
+  }
+
+  /** The required spacing should be half the current spacing. */
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    if( std::abs( 2.0 * this->m_RequiredGridSpacing[ i ] - this->m_CurrentGridSpacing[ i ] )
+      > tolerance * this->m_CurrentGridSpacing[ i ] )
+    {
+      return false;
+    }
+  }
+
+  /** Compute the continuous index u of the first required grid node in the
+   * current coefficient buffer. The refined basis functions are centred at
+   * u = i + ( k - ( n + 1 ) / 2 ) / 2, so 2u + ( n + 1 ) / 2 should be an integer.
+   */
+  OriginType firstNode = this->m_RequiredGridOrigin;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      firstNode[ i ] += this->m_RequiredGridDirection[ i ][ j ]
+        * this->m_RequiredGridRegion.GetIndex()[ j ] * this->m_RequiredGridSpacing[ j ];
+    }
+  }
+  for( unsigned int j = 0; j < Dimension; ++j )
+  {
+    /** The grid directions are orthonormal, so the transpose is the inverse. */
+    double projection = 0.0;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      projection += this->m_CurrentGridDirection[ i ][ j ]
+        * ( firstNode[ i ] - this->m_CurrentGridOrigin[ i ] );
+    }
+    const double u = projection / this->m_CurrentGridSpacing[ j ]
+      - this->m_CurrentGridRegion.GetIndex()[ j ];
+    const double r = 2.0 * u + 0.5 * ( this->m_BSplineOrder + 1 );
+    const double rounded = std::floor( r + 0.5 );
+    if( std::abs( r - rounded ) > tolerance )
+    {
+      return false;
+    }
+    firstFineIndex[ j ] = static_cast< OffsetValueType >( rounded );
+  }
+
+  return true;
+
+} // end IsDyadicRefinement()
+
+
+/**
+ * ******************* RefineParameters *******************
+ */
+
+template< class TArray, class TImage >
+void
+UpsampleBSplineParametersFilter< TArray, TImage >
+::RefineParameters( const ArrayType & parameters_in,
+  ArrayType & parameters_out, const IndexType & firstFineIndex )
+{
+  /** The two-scale mask 2^{-n} binom( n + 1, k ), k = 0, ..., n + 1. */
+  const unsigned int       maskSize = this->m_BSplineOrder + 2;
+  std::vector< ValueType > mask( maskSize, 0.0 );
+  mask[ 0 ] = 1.0;
+  for( unsigned int k = 1; k < maskSize; ++k )
+  {
+    for( unsigned int j = k; j > 0; --j )
+    {
+      mask[ j ] += mask[ j - 1 ];
+    }
+  }
+  const ValueType norm = std::pow( 2.0, -static_cast< double >( this->m_BSplineOrder ) );
+  for( unsigned int k = 0; k < maskSize; ++k )
+  {
+    mask[ k ] *= norm;
+  }
+
+  /** The parameters are refined one dimension at a time. All coefficient
+   * images (one per dimension of the displacement) are stored one after
+   * another, so they are simply treated as more lines.
+   */
+  unsigned long size[ Dimension ];
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    size[ i ] = this->m_CurrentGridRegion.GetSize()[ i ];
+  }
+  parameters_out.SetSize( this->m_RequiredGridRegion.GetNumberOfPixels() * Dimension );
+
+  std::vector< ValueType > buffer1, buffer2;
+  const ValueType *        input = parameters_in.data_block();
+  ThreaderType::Pointer    threader = ThreaderType::New();
+
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    RefineThreadStruct refineStruct;
+    refineStruct.st_Mask           = &mask;
+    refineStruct.st_InputLength    = size[ d ];
+    refineStruct.st_OutputLength   = this->m_RequiredGridRegion.GetSize()[ d ];
+    refineStruct.st_FirstFineIndex = firstFineIndex[ d ];
+    refineStruct.st_Stride         = 1;
+    refineStruct.st_NumberOfLines  = Dimension;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      if( i < d )
+      {
+        refineStruct.st_Stride *= size[ i ];
+      }
+      if( i != d )
+      {
+        refineStruct.st_NumberOfLines *= size[ i ];
+      }
+    }
+
+    /** The last dimension writes into the output parameters. */
+    ValueType * output = parameters_out.data_block();
+    if( d + 1 < Dimension )
+    {
+      std::vector< ValueType > & outputBuffer = ( d % 2 == 0 ) ? buffer1 : buffer2;
+      outputBuffer.resize( refineStruct.st_NumberOfLines * refineStruct.st_OutputLength );
+      output = &outputBuffer[ 0 ];
+    }
+
+    refineStruct.st_Input  = input;
+    refineStruct.st_Output = output;
+    threader->SetSingleMethod( Self::RefineThreaderCallback, &refineStruct );
+    threader->SingleMethodExecute();
+
+    input     = output;
+    size[ d ] = refineStruct.st_OutputLength;
+  }
+
+} // end RefineParameters()
+
+
+/**
+ * ******************* RefineThreaderCallback *******************
+ */
+
+template< class TArray, class TImage >
+ITK_THREAD_RETURN_TYPE
+UpsampleBSplineParametersFilter< TArray, TImage >
+::RefineThreaderCallback( void * arg )
+{
+  ThreadInfoType *           infoStruct   = static_cast< ThreadInfoType * >( arg );
+  const ThreadIdType         threadId     = infoStruct->ThreadID;
+  const ThreadIdType         nrOfThreads  = infoStruct->NumberOfThreads;
+  const RefineThreadStruct * refineStruct = static_cast< RefineThreadStruct * >( infoStruct->UserData );
+
+  const std::vector< ValueType > & mask         = *refineStruct->st_Mask;
+  const long                       maskSize     = static_cast< long >( mask.size() );
+  const unsigned long              stride       = refineStruct->st_Stride;
+  const long                       inputLength  = static_cast< long >( refineStruct->st_InputLength );
+  const unsigned long              outputLength = refineStruct->st_OutputLength;
+
+  /** Each thread refines a contiguous block of lines. */
+  const unsigned long numberOfLines = refineStruct->st_NumberOfLines;
+  const unsigned long chunk         = ( numberOfLines + nrOfThreads - 1 ) / nrOfThreads;
+  const unsigned long begin         = std::min( numberOfLines, threadId * chunk );
+  const unsigned long end           = std::min( numberOfLines, begin + chunk );
+
+  for( unsigned long line = begin; line < end; ++line )
+  {
+    const unsigned long lower  = line % stride;
+    const unsigned long upper  = line / stride;
+    const ValueType *   input  = refineStruct->st_Input + upper * stride * inputLength + lower;
+    ValueType *         output = refineStruct->st_Output + upper * stride * outputLength + lower;
+
+    for( unsigned long q = 0; q < outputLength; ++q )
+    {
+      /** Sum over the current nodes i with 0 <= r - 2i < maskSize. */
+      const long r    = static_cast< long >( refineStruct->st_FirstFineIndex ) + static_cast< long >( q );
+      const long iMax = std::min( inputLength - 1, static_cast< long >( std::floor( 0.5 * r ) ) );
+      const long iMin = std::max( 0L, static_cast< long >( std::ceil( 0.5 * ( r - maskSize + 1 ) ) ) );
+
+      ValueType sum = 0.0;
+      for( long i = iMin; i <= iMax; ++i )
+      {
+        sum += mask[ r - 2 * i ] * input[ i * stride ];
+      }
+      output[ q * stride ] = sum;
+    }
+  }
+
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end RefineThreaderCallback()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -0,0 +1,203 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMultiInputResampleImageFilter_h
+#define __itkMultiInputResampleImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkInterpolateImageFunction.h"
+#include "itkTransform.h"
+#include "itkAdvancedTransform.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class MultiInputResampleImageFilter
+ * \brief Resample several images with one transform, in a single pass.
+ *
+ * This filter resamples each of its inputs onto the same output grid,
+ * through the same transform, like one itk::ResampleImageFilter per input
+ * would do. Each input has its own interpolator, set with SetInterpolator( i, ... ),
+ * and produces output i. Pixels that map outside input i get its own default
+ * pixel value, if set with SetDefaultPixelValue( i, ... ), or else the
+ * DefaultPixelValue. The output grid is defined as in the
+ * itk::ResampleImageFilter.
+ *
+ * The output is processed line by line: the points of a line are mapped
+ * once, by the batched AdvancedTransform::TransformPoints() if the transform
+ * is an AdvancedTransform, and the mapped points are then used to interpolate
+ * all inputs. Since the transform usually dominates the cost of resampling,
+ * resampling N images costs little more than resampling one.
+ *
+ * The output pixel type should be scalar. Values are clamped to the range
+ * of the output pixel type.
+ *
+ * This filter is implemented as a multithreaded filter. It provides a
+ * ThreadedGenerateData() method for its implementation.
+ *
+ * \ingroup GeometricTransforms
+ */
+template< class TInputImage, class TOutputImage,
+class TInterpolatorPrecisionType = double >
+class MultiInputResampleImageFilter :
+  public ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef MultiInputResampleImageFilter                   Self;
+  typedef ImageToImageFilter< TInputImage, TOutputImage > Superclass;
+  typedef SmartPointer< Self >                            Pointer;
+  typedef SmartPointer< const Self >                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( MultiInputResampleImageFilter, ImageToImageFilter );
+
+  /** Number of dimensions. */
+  itkStaticConstMacro( ImageDimension, unsigned int,
+    TOutputImage::ImageDimension );
+
+  /** Typedefs for the images. */
+  typedef TInputImage                             InputImageType;
+  typedef TOutputImage                            OutputImageType;
+  typedef typename OutputImageType::Pointer       OutputImagePointer;
+  typedef typename OutputImageType::RegionType    OutputImageRegionType;
+  typedef typename OutputImageType::PixelType     PixelType;
+  typedef typename OutputImageType::SizeType      SizeType;
+  typedef typename OutputImageType::IndexType     IndexType;
+  typedef typename OutputImageType::PointType     PointType;
+  typedef typename OutputImageType::SpacingType   SpacingType;
+  typedef typename OutputImageType::PointType     OriginPointType;
+  typedef typename OutputImageType::DirectionType DirectionType;
+
+  /** Typedefs for the transform. */
+  typedef Transform< TInterpolatorPrecisionType,
+    itkGetStaticConstMacro( ImageDimension ),
+    itkGetStaticConstMacro( ImageDimension ) >       TransformType;
+  typedef typename TransformType::ConstPointer TransformPointerType;
+  typedef AdvancedTransform< TInterpolatorPrecisionType,
+    itkGetStaticConstMacro( ImageDimension ),
+    itkGetStaticConstMacro( ImageDimension ) >       AdvancedTransformType;
+
+  /** Typedefs for the interpolators. */
+  typedef InterpolateImageFunction< InputImageType,
+    TInterpolatorPrecisionType >                     InterpolatorType;
+  typedef typename InterpolatorType::Pointer           InterpolatorPointerType;
+  typedef typename InterpolatorType::ContinuousIndexType ContinuousIndexType;
+
+  /** Set input idx. An output is added for each input. */
+  using Superclass::SetInput;
+  void SetInput( unsigned int idx, const InputImageType * image ) override;
+
+  /** Set the interpolator of input idx. */
+  virtual void SetInterpolator( unsigned int idx, InterpolatorType * interpolator );
+
+  /** Get the interpolator of input idx. */
+  virtual InterpolatorType * GetInterpolator( unsigned int idx ) const;
+
+  /** Set/Get the coordinate transformation. */
+  itkSetConstObjectMacro( Transform, TransformType );
+  itkGetConstObjectMacro( Transform, TransformType );
+
+  /** Set/Get the value of output pixels that map outside an input. */
+  itkSetMacro( DefaultPixelValue, PixelType );
+  itkGetConstReferenceMacro( DefaultPixelValue, PixelType );
+
+  /** Set the default pixel value of input idx, which overrides DefaultPixelValue. */
+  virtual void SetDefaultPixelValue( unsigned int idx, const PixelType & value );
+
+  /** Get the default pixel value of input idx: its own, or else DefaultPixelValue. */
+  virtual PixelType GetDefaultPixelValue( unsigned int idx ) const;
+
+  /** Set/Get the size of the output images. */
+  itkSetMacro( Size, SizeType );
+  itkGetConstReferenceMacro( Size, SizeType );
+
+  /** Set/Get the start index of the output images. */
+  itkSetMacro( OutputStartIndex, IndexType );
+  itkGetConstReferenceMacro( OutputStartIndex, IndexType );
+
+  /** Set/Get the output image spacing. */
+  itkSetMacro( OutputSpacing, SpacingType );
+  itkGetConstReferenceMacro( OutputSpacing, SpacingType );
+
+  /** Set/Get the output image origin. */
+  itkSetMacro( OutputOrigin, OriginPointType );
+  itkGetConstReferenceMacro( OutputOrigin, OriginPointType );
+
+  /** Set/Get the output direction cosine matrix. */
+  itkSetMacro( OutputDirection, DirectionType );
+  itkGetConstReferenceMacro( OutputDirection, DirectionType );
+
+  /** The output images all have the grid set in this filter. */
+  void GenerateOutputInformation( void ) override;
+
+  /** The interpolators need the largest possible region of the inputs. */
+  void GenerateInputRequestedRegion( void ) override;
+
+  /** Connect the interpolators to the inputs. */
+  void BeforeThreadedGenerateData( void ) override;
+
+  /** Disconnect the interpolators from the inputs. */
+  void AfterThreadedGenerateData( void ) override;
+
+  /** Compute the Modified Time based on changes to the components. */
+  ModifiedTimeType GetMTime( void ) const override;
+
+protected:
+
+  MultiInputResampleImageFilter();
+  ~MultiInputResampleImageFilter() override {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+  /** MultiInputResampleImageFilter is implemented as a multithreaded filter. */
+  void ThreadedGenerateData(
+    const OutputImageRegionType & outputRegionForThread,
+    ThreadIdType threadId ) override;
+
+private:
+
+  MultiInputResampleImageFilter( const Self & ); // purposely not implemented
+  void operator=( const Self & );                // purposely not implemented
+
+  /** Member variables. */
+  TransformPointerType                   m_Transform;
+  std::vector< InterpolatorPointerType > m_Interpolators;
+  PixelType                              m_DefaultPixelValue;
+  std::vector< PixelType >               m_DefaultPixelValues;
+  std::vector< bool >                    m_UseOwnDefaultPixelValue;
+  SizeType                               m_Size;
+  IndexType                              m_OutputStartIndex;
+  SpacingType                            m_OutputSpacing;
+  OriginPointType                        m_OutputOrigin;
+  DirectionType                          m_OutputDirection;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkMultiInputResampleImageFilter.hxx"
+#endif
+
+#endif // end #ifndef __itkMultiInputResampleImageFilter_h
@@ -0,0 +1,448 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMultiInputResampleImageFilter_hxx
+#define __itkMultiInputResampleImageFilter_hxx
+
+#include "itkMultiInputResampleImageFilter.h"
+
+#include "itkImageLinearIteratorWithIndex.h"
+#include "itkProgressReporter.h"
+
+#include <algorithm> // std::min, std::max
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::MultiInputResampleImageFilter()
+{
+  this->m_Transform = 0;
+  this->m_DefaultPixelValue = NumericTraits< PixelType >::ZeroValue();
+  this->m_Size.Fill( 0 );
+  this->m_OutputStartIndex.Fill( 0 );
+  this->m_OutputSpacing.Fill( 1.0 );
+  this->m_OutputOrigin.Fill( 0.0 );
+  this->m_OutputDirection.SetIdentity();
+
+#if ITK_VERSION_MAJOR >= 5
+  // Use the classic (ITK4) threading model, to ensure ThreadedGenerateData is being called.
+  this->itk::ImageSource< TOutputImage >::DynamicMultiThreadingOff();
+#endif
+
+} // end Constructor
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << indent << "NumberOfInterpolators: " << this->m_Interpolators.size() << std::endl;
+  os << indent << "DefaultPixelValue: "
+     << static_cast< typename NumericTraits< PixelType >::PrintType >( this->m_DefaultPixelValue ) << std::endl;
+  os << indent << "Size: " << this->m_Size << std::endl;
+  os << indent << "OutputStartIndex: " << this->m_OutputStartIndex << std::endl;
+  os << indent << "OutputSpacing: " << this->m_OutputSpacing << std::endl;
+  os << indent << "OutputOrigin: " << this->m_OutputOrigin << std::endl;
+  os << indent << "OutputDirection: " << this->m_OutputDirection << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ******************* SetInput *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::SetInput( unsigned int idx, const InputImageType * image )
+{
+  this->Superclass::SetInput( idx, image );
+
+  /** Make sure there is an output for each input. */
+  for( unsigned int i = this->GetNumberOfIndexedOutputs(); i <= idx; ++i )
+  {
+    this->SetNthOutput( i, this->MakeOutput( i ) );
+  }
+
+} // end SetInput()
+
+
+/**
+ * ******************* SetInterpolator *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::SetInterpolator( unsigned int idx, InterpolatorType * interpolator )
+{
+  if( idx >= this->m_Interpolators.size() )
+  {
+    this->m_Interpolators.resize( idx + 1 );
+  }
+
+  if( this->m_Interpolators[ idx ] != interpolator )
+  {
+    this->m_Interpolators[ idx ] = interpolator;
+    this->Modified();
+  }
+
+} // end SetInterpolator()
+
+
+/**
+ * ******************* GetInterpolator *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+typename MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >::InterpolatorType
+* MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::GetInterpolator( unsigned int idx ) const
+{
+  if( idx < this->m_Interpolators.size() )
+  {
+    return this->m_Interpolators[ idx ].GetPointer();
+  }
+  return 0;
+
+} // end GetInterpolator()
+
+
+/**
+ * ******************* SetDefaultPixelValue *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::SetDefaultPixelValue( unsigned int idx, const PixelType & value )
+{
+  if( idx >= this->m_DefaultPixelValues.size() )
+  {
+    this->m_DefaultPixelValues.resize( idx + 1, NumericTraits< PixelType >::ZeroValue() );
+    this->m_UseOwnDefaultPixelValue.resize( idx + 1, false );
+  }
+
+  if( !this->m_UseOwnDefaultPixelValue[ idx ] || this->m_DefaultPixelValues[ idx ] != value )
+  {
+    this->m_DefaultPixelValues[ idx ]      = value;
+    this->m_UseOwnDefaultPixelValue[ idx ] = true;
+    this->Modified();
+  }
+
+} // end SetDefaultPixelValue()
+
+
+/**
+ * ******************* GetDefaultPixelValue *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+typename MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >::PixelType
+MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::GetDefaultPixelValue( unsigned int idx ) const
+{
+  if( idx < this->m_UseOwnDefaultPixelValue.size() && this->m_UseOwnDefaultPixelValue[ idx ] )
+  {
+    return this->m_DefaultPixelValues[ idx ];
+  }
+  return this->m_DefaultPixelValue;
+
+} // end GetDefaultPixelValue()
+
+
+/**
+ * ******************* GenerateOutputInformation *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::GenerateOutputInformation( void )
+{
+  /** Call the superclass' implementation of this method. */
+  Superclass::GenerateOutputInformation();
+
+  /** All outputs share the output grid. */
+  OutputImageRegionType outputLargestPossibleRegion;
+  outputLargestPossibleRegion.SetSize( this->m_Size );
+  outputLargestPossibleRegion.SetIndex( this->m_OutputStartIndex );
+
+  for( unsigned int i = 0; i < this->GetNumberOfIndexedOutputs(); ++i )
+  {
+    OutputImageType * output = this->GetOutput( i );
+    if( !output ) { continue; }
+    output->SetLargestPossibleRegion( outputLargestPossibleRegion );
+    output->SetSpacing( this->m_OutputSpacing );
+    output->SetOrigin( this->m_OutputOrigin );
+    output->SetDirection( this->m_OutputDirection );
+  }
+
+} // end GenerateOutputInformation()
+
+
+/**
+ * ******************* GenerateInputRequestedRegion *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::GenerateInputRequestedRegion( void )
+{
+  /** Call the superclass' implementation of this method. */
+  Superclass::GenerateInputRequestedRegion();
+
+  /** The points may map anywhere, so request the whole inputs. */
+  for( unsigned int i = 0; i < this->GetNumberOfIndexedInputs(); ++i )
+  {
+    InputImageType * input = const_cast< InputImageType * >( this->GetInput( i ) );
+    if( input )
+    {
+      input->SetRequestedRegionToLargestPossibleRegion();
+    }
+  }
+
+} // end GenerateInputRequestedRegion()
+
+
+/**
+ * ******************* BeforeThreadedGenerateData *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::BeforeThreadedGenerateData( void )
+{
+  if( !this->m_Transform )
+  {
+    itkExceptionMacro( << "Transform not set" );
+  }
+
+  const unsigned int numberOfImages = this->GetNumberOfIndexedInputs();
+  for( unsigned int i = 0; i < numberOfImages; ++i )
+  {
+    if( i >= this->m_Interpolators.size() || !this->m_Interpolators[ i ] )
+    {
+      itkExceptionMacro( << "Interpolator not set for input " << i );
+    }
+    this->m_Interpolators[ i ]->SetInputImage( this->GetInput( i ) );
+  }
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * ******************* AfterThreadedGenerateData *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::AfterThreadedGenerateData( void )
+{
+  /** Disconnect the inputs from the interpolators, as the
+   * itk::ResampleImageFilter does, to release their memory.
+   */
+  for( unsigned int i = 0; i < this->m_Interpolators.size(); ++i )
+  {
+    if( this->m_Interpolators[ i ] )
+    {
+      this->m_Interpolators[ i ]->SetInputImage( 0 );
+    }
+  }
+
+} // end AfterThreadedGenerateData()
+
+
+/**
+ * ******************* ThreadedGenerateData *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::ThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread,
+  ThreadIdType threadId )
+{
+  typedef typename TransformType::InputPointType         InputPointType;
+  typedef typename TransformType::OutputPointType        OutputPointType;
+  typedef typename InterpolatorType::OutputType          InterpolatorOutputType;
+  typedef ImageLinearIteratorWithIndex< OutputImageType > LineIteratorType;
+
+  const SizeValueType lineLength = outputRegionForThread.GetSize( 0 );
+  if( lineLength == 0 ) { return; }
+  const SizeValueType numberOfLines  = outputRegionForThread.GetNumberOfPixels() / lineLength;
+  const unsigned int  numberOfImages = this->GetNumberOfIndexedInputs();
+
+  /** Support for progress methods/callbacks. */
+  ProgressReporter progress( this, threadId, numberOfLines );
+
+  /** Use the batched TransformPoints() when possible. */
+  const AdvancedTransformType * advancedTransform
+    = dynamic_cast< const AdvancedTransformType * >( this->m_Transform.GetPointer() );
+
+  /** Buffers for the points of one line, in structure-of-arrays layout. */
+  std::vector< TInterpolatorPrecisionType > pointBuffer( 2 * ImageDimension * lineLength );
+  typename AdvancedTransformType::InputCoordinateArraysType  inputCoordinates;
+  typename AdvancedTransformType::OutputCoordinateArraysType outputCoordinates;
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    inputCoordinates[ d ]  = &pointBuffer[ d * lineLength ];
+    outputCoordinates[ d ] = &pointBuffer[ ( ImageDimension + d ) * lineLength ];
+  }
+
+  /** The step in physical space along a line. */
+  OutputImageType * output0 = this->GetOutput( 0 );
+  PointType         step;
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    step[ d ] = this->m_OutputDirection[ d ][ 0 ] * this->m_OutputSpacing[ 0 ];
+  }
+
+  /** The range of the output pixel type. */
+  const InterpolatorOutputType minimumValue
+    = static_cast< InterpolatorOutputType >( NumericTraits< PixelType >::NonpositiveMin() );
+  const InterpolatorOutputType maximumValue
+    = static_cast< InterpolatorOutputType >( NumericTraits< PixelType >::max() );
+
+  LineIteratorType it( output0, outputRegionForThread );
+  it.SetDirection( 0 );
+  for( it.GoToBegin(); !it.IsAtEnd(); it.NextLine() )
+  {
+    const IndexType lineIndex = it.GetIndex();
+
+    /** Map the points of this line, once for all images. */
+    PointType firstPoint;
+    output0->TransformIndexToPhysicalPoint( lineIndex, firstPoint );
+    for( SizeValueType k = 0; k < lineLength; ++k )
+    {
+      for( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+        pointBuffer[ d * lineLength + k ] = firstPoint[ d ] + k * step[ d ];
+      }
+    }
+
+    if( advancedTransform )
+    {
+      advancedTransform->TransformPoints( inputCoordinates, outputCoordinates, lineLength, 0 );
+    }
+    else
+    {
+      InputPointType inputPoint;
+      for( SizeValueType k = 0; k < lineLength; ++k )
+      {
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+          inputPoint[ d ] = inputCoordinates[ d ][ k ];
+        }
+        const OutputPointType outputPoint = this->m_Transform->TransformPoint( inputPoint );
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+          outputCoordinates[ d ][ k ] = outputPoint[ d ];
+        }
+      }
+    }
+
+    /** Interpolate all images at the mapped points. */
+    for( unsigned int i = 0; i < numberOfImages; ++i )
+    {
+      const InputImageType *   input        = this->GetInput( i );
+      const InterpolatorType * interpolator = this->m_Interpolators[ i ].GetPointer();
+      const PixelType          defaultValue = this->GetDefaultPixelValue( i );
+      OutputImageType *        output       = this->GetOutput( i );
+      PixelType *              outputLine
+        = output->GetBufferPointer() + output->ComputeOffset( lineIndex );
+
+      OutputPointType     mappedPoint;
+      ContinuousIndexType cindex;
+      for( SizeValueType k = 0; k < lineLength; ++k )
+      {
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+          mappedPoint[ d ] = outputCoordinates[ d ][ k ];
+        }
+        input->TransformPhysicalPointToContinuousIndex( mappedPoint, cindex );
+
+        if( interpolator->IsInsideBuffer( cindex ) )
+        {
+          const InterpolatorOutputType value = interpolator->EvaluateAtContinuousIndex( cindex );
+          outputLine[ k ] = static_cast< PixelType >(
+            std::min( std::max( value, minimumValue ), maximumValue ) );
+        }
+        else
+        {
+          outputLine[ k ] = defaultValue;
+        }
+      }
+    }
+
+    progress.CompletedPixel();
+  }
+
+} // end ThreadedGenerateData()
+
+
+/**
+ * ******************* GetMTime *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+ModifiedTimeType
+MultiInputResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::GetMTime( void ) const
+{
+  ModifiedTimeType latestTime = Object::GetMTime();
+
+  if( this->m_Transform )
+  {
+    latestTime = std::max( latestTime, this->m_Transform->GetMTime() );
+  }
+
+  for( unsigned int i = 0; i < this->m_Interpolators.size(); ++i )
+  {
+    if( this->m_Interpolators[ i ] )
+    {
+      latestTime = std::max( latestTime, this->m_Interpolators[ i ]->GetMTime() );
+    }
+  }
+
+  return latestTime;
+
+} // end GetMTime()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkMultiInputResampleImageFilter_hxx
@@ -23,6 +23,7 @@
 #include "itkBSplineKernelFunction2.h"
 #include "itkBSplineDerivativeKernelFunction2.h"
 #include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
+#include "itkGridAlignedBSplineWeightsTable.h"
 
 namespace itk
 {
@@ -139,6 +140,18 @@ public:
   void EvaluateSecondOrderDerivative( const ContinuousIndexType & index,
     WeightsType & weights, const IndexType & startIndex ) const;
 
+  /** Table of precomputed 1D weights for points on a lattice. */
+  typedef GridAlignedBSplineWeightsTable<
+    VSpaceDimension, VSplineOrder >                 GridAlignedWeightsTableType;
+
+  /** Set the table of precomputed 1D weights, which is owned by the caller.
+   * A null pointer (the default) means that the weights are always computed.
+   */
+  void SetGridAlignedWeightsTable( const GridAlignedWeightsTableType * table )
+  {
+    this->m_GridAlignedWeightsTable = table;
+  }
+
 protected:
 
   RecursiveBSplineInterpolationWeightFunction();
@@ -155,6 +168,9 @@ private:
   unsigned int m_NumberOfIndices;
   SizeType     m_SupportSize;
 
+  /** The table of precomputed 1D weights, not owned. */
+  const GridAlignedWeightsTableType * m_GridAlignedWeightsTable;
+
   /** Interpolation kernel type. */
   typedef BSplineKernelFunction2< itkGetStaticConstMacro( SplineOrder ) >                      KernelType;
   typedef BSplineDerivativeKernelFunction2< itkGetStaticConstMacro( SplineOrder ) >            DerivativeKernelType;
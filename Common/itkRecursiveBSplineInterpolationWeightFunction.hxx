@@ -45,6 +45,8 @@ RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSpline
     this->m_NumberOfWeights *= this->m_SupportSize[ i ];
   }
 
+  this->m_GridAlignedWeightsTable = nullptr;
+
   // Initialize the interpolation kernel
   this->m_Kernel                      = KernelType::New();
   this->m_DerivativeKernel            = DerivativeKernelType::New();
@@ -104,7 +106,12 @@ RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSpline
   {
     startIndex[ i ] = Math::Floor< IndexValueType >( cindex[i] + 0.5 - SplineOrder / 2.0 );
     double x = cindex[ i ] - static_cast< double >( startIndex[ i ] );
-    this->m_Kernel->Evaluate( x, weightsPtr );
+    if( this->m_GridAlignedWeightsTable == nullptr
+      || !this->m_GridAlignedWeightsTable->Lookup( i, cindex[ i ], startIndex[ i ],
+      GridAlignedWeightsTableType::Weights, weightsPtr ) )
+    {
+      this->m_Kernel->Evaluate( x, weightsPtr );
+    }
     weightsPtr += SplineOrder + 1;
   }
 
@@ -126,7 +133,12 @@ RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSpline
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
     double x = cindex[ i ] - static_cast< double >( startIndex[ i ] );
-    this->m_DerivativeKernel->Evaluate( x, &derivativeWeights[ i * this->m_SupportSize[ i ] ] );
+    if( this->m_GridAlignedWeightsTable == nullptr
+      || !this->m_GridAlignedWeightsTable->Lookup( i, cindex[ i ], startIndex[ i ],
+      GridAlignedWeightsTableType::DerivativeWeights, &derivativeWeights[ i * this->m_SupportSize[ i ] ] ) )
+    {
+      this->m_DerivativeKernel->Evaluate( x, &derivativeWeights[ i * this->m_SupportSize[ i ] ] );
+    }
   }
 } // end EvaluateDerivative()
 
@@ -146,7 +158,12 @@ RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSpline
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
     double x = cindex[ i ] - static_cast< double >( startIndex[ i ] );
-    this->m_SecondOrderDerivativeKernel->Evaluate( x, &hessianWeights[ i * this->m_SupportSize[ i ] ] );
+    if( this->m_GridAlignedWeightsTable == nullptr
+      || !this->m_GridAlignedWeightsTable->Lookup( i, cindex[ i ], startIndex[ i ],
+      GridAlignedWeightsTableType::SecondOrderDerivativeWeights, &hessianWeights[ i * this->m_SupportSize[ i ] ] ) )
+    {
+      this->m_SecondOrderDerivativeKernel->Evaluate( x, &hessianWeights[ i * this->m_SupportSize[ i ] ] );
+    }
   }
 } // end EvaluateSecondOrderDerivative()
 
@@ -0,0 +1,156 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkScanlineResampleImageFilter_h
+#define __itkScanlineResampleImageFilter_h
+
+#include "itkResampleImageFilter.h"
+#include "itkProgressReporter.h"
+
+namespace itk
+{
+
+/** \class ScanlineResampleImageFilter
+ * \brief Resample an image, with a scanline fast path for linear transforms.
+ *
+ * This filter is an itk::ResampleImageFilter that adds a fast path for a
+ * linear transform (also when composed of several linear transforms, see
+ * AdvancedCombinationTransform::IsLinear()) combined with a
+ * LinearInterpolateImageFunction or NearestNeighborInterpolateImageFunction.
+ *
+ * The mapping from output index to input continuous index is then affine.
+ * It is computed once before resampling, and along each scanline the
+ * continuous index is stepped by a constant increment. The part of a scanline
+ * that maps inside the input is determined up front, so the inner loop
+ * interpolates directly from the input buffer without per pixel transform,
+ * index conversion, bounds check, or virtual interpolator call. The border
+ * handling and rounding of the two interpolators, and the clamping to the
+ * output pixel range, are those of the ITK classes.
+ *
+ * Other combinations, and an extrapolator, are handled by the
+ * itk::ResampleImageFilter. The threading model is that of the
+ * itk::ResampleImageFilter in both cases.
+ *
+ * \ingroup GeometricTransforms
+ */
+template< class TInputImage, class TOutputImage,
+class TInterpolatorPrecisionType = double >
+class ScanlineResampleImageFilter :
+  public ResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef ScanlineResampleImageFilter Self;
+  typedef ResampleImageFilter<
+    TInputImage, TOutputImage, TInterpolatorPrecisionType > Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ScanlineResampleImageFilter, ResampleImageFilter );
+
+  /** Number of dimensions. */
+  itkStaticConstMacro( ImageDimension, unsigned int,
+    TOutputImage::ImageDimension );
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::InputImageType        InputImageType;
+  typedef typename Superclass::OutputImageType       OutputImageType;
+  typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
+  typedef typename Superclass::TransformType         TransformType;
+  typedef typename Superclass::InterpolatorType      InterpolatorType;
+  typedef typename Superclass::IndexType             IndexType;
+  typedef typename Superclass::PointType             PointType;
+  typedef typename Superclass::PixelType             PixelType;
+  typedef typename InterpolatorType::ContinuousIndexType ContinuousIndexType;
+
+  /** The fast paths, selected in BeforeThreadedGenerateData(). */
+  enum FastPathType { NoFastPath, LinearFastPath, NearestNeighborFastPath };
+
+  /** Allow the fast path. Default: true. */
+  itkSetMacro( UseFastPath, bool );
+  itkGetConstMacro( UseFastPath, bool );
+  itkBooleanMacro( UseFastPath );
+
+  /** Get the fast path that was selected for the last update. */
+  itkGetConstMacro( FastPath, FastPathType );
+
+  /** Compute the range [kBegin, kEnd) of the points firstIndex + k * step,
+   * with 0 <= k < numberOfPoints, that the interpolator reports inside its
+   * buffer. The points are assumed to be inside on at most one interval,
+   * which holds for the points of a line.
+   */
+  static void ComputeScanlineInsideRange( const InterpolatorType * interpolator,
+    const ContinuousIndexType & firstIndex, const ContinuousIndexType & step,
+    const SizeValueType numberOfPoints, SizeValueType & kBegin, SizeValueType & kEnd );
+
+protected:
+
+  ScanlineResampleImageFilter();
+  ~ScanlineResampleImageFilter() override {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+  /** Select the fast path, and compute the affine index mapping of a linear transform. */
+  void BeforeThreadedGenerateData( void ) override;
+
+  /** Resample along scanlines if the fast path is selected, otherwise
+   * let the itk::ResampleImageFilter do the work.
+   */
+#if ITK_VERSION_MAJOR >= 5
+  void DynamicThreadedGenerateData( const OutputImageRegionType & outputRegionForThread ) override;
+#else
+  void ThreadedGenerateData( const OutputImageRegionType & outputRegionForThread,
+    ThreadIdType threadId ) override;
+#endif
+
+private:
+
+  ScanlineResampleImageFilter( const Self & ); // purposely not implemented
+  void operator=( const Self & );              // purposely not implemented
+
+  /** Resample the scanlines of a region with the fast path. The progress
+   * reporter may be null.
+   */
+  template< FastPathType VFastPath >
+  void GenerateDataOfScanlines( const OutputImageRegionType & outputRegionForThread,
+    ProgressReporter * progress );
+
+  bool         m_UseFastPath;
+  FastPathType m_FastPath;
+
+  /** The affine mapping from output index to input continuous index:
+   * the continuous index of the output start index, and the step per
+   * output index, for each output dimension.
+   */
+  IndexType           m_OutputStartIndex;
+  ContinuousIndexType m_ContinuousIndexAtStart;
+  ContinuousIndexType m_ContinuousIndexSteps[ ImageDimension ];
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkScanlineResampleImageFilter.hxx"
+#endif
+
+#endif // end #ifndef __itkScanlineResampleImageFilter_h
@@ -0,0 +1,393 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkScanlineResampleImageFilter_hxx
+#define __itkScanlineResampleImageFilter_hxx
+
+#include "itkScanlineResampleImageFilter.h"
+
+#include "itkImageLinearIteratorWithIndex.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+
+#include <algorithm> // std::min, std::max, std::fill
+#include <cmath>     // std::floor, std::ceil
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+ScanlineResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::ScanlineResampleImageFilter()
+{
+  this->m_UseFastPath = true;
+  this->m_FastPath    = NoFastPath;
+  this->m_OutputStartIndex.Fill( 0 );
+  this->m_ContinuousIndexAtStart.Fill( 0.0 );
+  for( unsigned int j = 0; j < ImageDimension; ++j )
+  {
+    this->m_ContinuousIndexSteps[ j ].Fill( 0.0 );
+  }
+
+} // end Constructor
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+ScanlineResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "UseFastPath: " << this->m_UseFastPath << std::endl;
+  os << indent << "FastPath: " << this->m_FastPath << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ******************* BeforeThreadedGenerateData *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+ScanlineResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::BeforeThreadedGenerateData( void )
+{
+  Superclass::BeforeThreadedGenerateData();
+
+  /** Select the fast path. */
+  typedef LinearInterpolateImageFunction<
+    InputImageType, TInterpolatorPrecisionType >          LinearInterpolatorType;
+  typedef NearestNeighborInterpolateImageFunction<
+    InputImageType, TInterpolatorPrecisionType >          NearestNeighborInterpolatorType;
+
+  const TransformType *    transform    = this->GetTransform();
+  const InterpolatorType * interpolator = this->GetInterpolator();
+
+  this->m_FastPath = NoFastPath;
+  if( !this->m_UseFastPath || transform == nullptr || !transform->IsLinear()
+    || this->GetExtrapolator() != nullptr )
+  {
+    return;
+  }
+  if( dynamic_cast< const LinearInterpolatorType * >( interpolator ) != nullptr )
+  {
+    this->m_FastPath = LinearFastPath;
+  }
+  else if( dynamic_cast< const NearestNeighborInterpolatorType * >( interpolator ) != nullptr )
+  {
+    this->m_FastPath = NearestNeighborFastPath;
+  }
+  else
+  {
+    return;
+  }
+
+  /** The mapping from output index to input continuous index is affine.
+   * Recover it by mapping the start index and, for each dimension, the
+   * last index of the output region, which keeps the steps accurate.
+   */
+  const OutputImageType *     output       = this->GetOutput();
+  const InputImageType *      input        = this->GetInput();
+  const OutputImageRegionType outputRegion = output->GetLargestPossibleRegion();
+  this->m_OutputStartIndex = outputRegion.GetIndex();
+
+  PointType point;
+  output->TransformIndexToPhysicalPoint( this->m_OutputStartIndex, point );
+  input->TransformPhysicalPointToContinuousIndex(
+    transform->TransformPoint( point ), this->m_ContinuousIndexAtStart );
+
+  for( unsigned int j = 0; j < ImageDimension; ++j )
+  {
+    const SizeValueType numberOfSteps
+      = std::max< SizeValueType >( outputRegion.GetSize( j ), 2 ) - 1;
+    IndexType index = this->m_OutputStartIndex;
+    index[ j ] += numberOfSteps;
+
+    ContinuousIndexType continuousIndex;
+    output->TransformIndexToPhysicalPoint( index, point );
+    input->TransformPhysicalPointToContinuousIndex(
+      transform->TransformPoint( point ), continuousIndex );
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      this->m_ContinuousIndexSteps[ j ][ d ]
+        = ( continuousIndex[ d ] - this->m_ContinuousIndexAtStart[ d ] ) / numberOfSteps;
+    }
+  }
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * ******************* ThreadedGenerateData *******************
+ */
+
+#if ITK_VERSION_MAJOR >= 5
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+ScanlineResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::DynamicThreadedGenerateData( const OutputImageRegionType & outputRegionForThread )
+{
+  /** The progress of dynamic threading is reported per region by the ImageSource. */
+  if( this->m_FastPath == LinearFastPath )
+  {
+    this->template GenerateDataOfScanlines< LinearFastPath >( outputRegionForThread, nullptr );
+  }
+  else if( this->m_FastPath == NearestNeighborFastPath )
+  {
+    this->template GenerateDataOfScanlines< NearestNeighborFastPath >( outputRegionForThread, nullptr );
+  }
+  else
+  {
+    Superclass::DynamicThreadedGenerateData( outputRegionForThread );
+  }
+
+} // end DynamicThreadedGenerateData()
+
+
+#else
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+ScanlineResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::ThreadedGenerateData( const OutputImageRegionType & outputRegionForThread,
+  ThreadIdType threadId )
+{
+  if( this->m_FastPath == NoFastPath )
+  {
+    Superclass::ThreadedGenerateData( outputRegionForThread, threadId );
+    return;
+  }
+
+  /** Support for progress methods/callbacks, per scanline. */
+  const SizeValueType lineLength = outputRegionForThread.GetSize( 0 );
+  if( lineLength == 0 ) { return; }
+  ProgressReporter progress( this, threadId,
+    outputRegionForThread.GetNumberOfPixels() / lineLength );
+
+  if( this->m_FastPath == LinearFastPath )
+  {
+    this->template GenerateDataOfScanlines< LinearFastPath >( outputRegionForThread, &progress );
+  }
+  else
+  {
+    this->template GenerateDataOfScanlines< NearestNeighborFastPath >( outputRegionForThread, &progress );
+  }
+
+} // end ThreadedGenerateData()
+
+
+#endif
+
+/**
+ * ******************* GenerateDataOfScanlines *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+template< typename ScanlineResampleImageFilter< TInputImage, TOutputImage,
+TInterpolatorPrecisionType >::FastPathType VFastPath >
+void
+ScanlineResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::GenerateDataOfScanlines( const OutputImageRegionType & outputRegionForThread,
+  ProgressReporter * progress )
+{
+  typedef typename InputImageType::PixelType              InputPixelType;
+  typedef ImageLinearIteratorWithIndex< OutputImageType > LineIteratorType;
+
+  const SizeValueType lineLength = outputRegionForThread.GetSize( 0 );
+  if( lineLength == 0 ) { return; }
+
+  /** Access the input buffer directly. The interpolator clamps to, and
+   * checks against, the same region.
+   */
+  const InputImageType *   input        = this->GetInput();
+  const InterpolatorType * interpolator = this->GetInterpolator();
+  const InputPixelType *   inputBuffer  = input->GetBufferPointer();
+  const OffsetValueType *  offsetTable  = input->GetOffsetTable();
+  const IndexType          bufferStart  = input->GetBufferedRegion().GetIndex();
+  const IndexType          startIndex   = interpolator->GetStartIndex();
+  const IndexType          endIndex     = interpolator->GetEndIndex();
+
+  /** The range of the output pixel type, as in the itk::ResampleImageFilter. */
+  const double    minimumValue = static_cast< double >( NumericTraits< PixelType >::NonpositiveMin() );
+  const double    maximumValue = static_cast< double >( NumericTraits< PixelType >::max() );
+  const PixelType defaultPixelValue = this->GetDefaultPixelValue();
+
+  OutputImageType *           output = this->GetOutput();
+  const ContinuousIndexType & step   = this->m_ContinuousIndexSteps[ 0 ];
+
+  LineIteratorType it( output, outputRegionForThread );
+  it.SetDirection( 0 );
+  for( it.GoToBegin(); !it.IsAtEnd(); it.NextLine() )
+  {
+    const IndexType lineIndex  = it.GetIndex();
+    PixelType *     outputLine = output->GetBufferPointer() + output->ComputeOffset( lineIndex );
+
+    /** The continuous index of the first point of the line. */
+    ContinuousIndexType first = this->m_ContinuousIndexAtStart;
+    for( unsigned int j = 0; j < ImageDimension; ++j )
+    {
+      const double n = static_cast< double >( lineIndex[ j ] - this->m_OutputStartIndex[ j ] );
+      for( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+        first[ d ] += n * this->m_ContinuousIndexSteps[ j ][ d ];
+      }
+    }
+
+    /** Only the points in [kBegin, kEnd) are inside the input. */
+    SizeValueType kBegin = 0;
+    SizeValueType kEnd   = 0;
+    ComputeScanlineInsideRange( interpolator, first, step, lineLength, kBegin, kEnd );
+    std::fill( outputLine, outputLine + kBegin, defaultPixelValue );
+    std::fill( outputLine + kEnd, outputLine + lineLength, defaultPixelValue );
+
+    for( SizeValueType k = kBegin; k < kEnd; ++k )
+    {
+      double value = 0.0;
+      if( VFastPath == NearestNeighborFastPath )
+      {
+        /** Round half integers up, like the NearestNeighborInterpolateImageFunction. */
+        OffsetValueType offset = 0;
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+          const double         cindex = first[ d ] + k * step[ d ];
+          const IndexValueType index  = static_cast< IndexValueType >( std::floor( cindex + 0.5 ) );
+          offset += ( index - bufferStart[ d ] ) * offsetTable[ d ];
+        }
+        value = static_cast< double >( inputBuffer[ offset ] );
+      }
+      else
+      {
+        /** Multilinear interpolation; neighbours outside the buffer are
+         * replaced by the border, like the LinearInterpolateImageFunction.
+         */
+        double          distance[ ImageDimension ];
+        OffsetValueType lowerOffset[ ImageDimension ];
+        OffsetValueType upperOffset[ ImageDimension ];
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+          const double cindex = std::min( std::max( first[ d ] + k * step[ d ],
+            static_cast< double >( startIndex[ d ] ) ), static_cast< double >( endIndex[ d ] ) );
+          const IndexValueType base = static_cast< IndexValueType >( std::floor( cindex ) );
+          distance[ d ]    = cindex - base;
+          lowerOffset[ d ] = ( base - bufferStart[ d ] ) * offsetTable[ d ];
+          upperOffset[ d ] = lowerOffset[ d ] + ( base < endIndex[ d ] ? offsetTable[ d ] : 0 );
+        }
+
+        for( unsigned int corner = 0; corner < ( 1u << ImageDimension ); ++corner )
+        {
+          double          weight = 1.0;
+          OffsetValueType offset = 0;
+          for( unsigned int d = 0; d < ImageDimension; ++d )
+          {
+            const bool upper = ( corner >> d ) & 1u;
+            weight *= upper ? distance[ d ] : 1.0 - distance[ d ];
+            offset += upper ? upperOffset[ d ] : lowerOffset[ d ];
+          }
+          value += weight * static_cast< double >( inputBuffer[ offset ] );
+        }
+      }
+
+      outputLine[ k ] = static_cast< PixelType >(
+        std::min( std::max( value, minimumValue ), maximumValue ) );
+    }
+
+    if( progress ) { progress->CompletedPixel(); }
+  }
+
+} // end GenerateDataOfScanlines()
+
+
+/**
+ * ******************* ComputeScanlineInsideRange *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+ScanlineResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::ComputeScanlineInsideRange( const InterpolatorType * interpolator,
+  const ContinuousIndexType & firstIndex, const ContinuousIndexType & step,
+  const SizeValueType numberOfPoints, SizeValueType & kBegin, SizeValueType & kEnd )
+{
+  const ContinuousIndexType & startIndex = interpolator->GetStartContinuousIndex();
+  const ContinuousIndexType & endIndex   = interpolator->GetEndContinuousIndex();
+
+  /** Intersect the line with the buffer, per dimension. */
+  const double n     = static_cast< double >( numberOfPoints );
+  double       kLow  = 0.0;
+  double       kHigh = n;
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    if( step[ d ] == 0.0 )
+    {
+      if( !( firstIndex[ d ] >= startIndex[ d ] && firstIndex[ d ] < endIndex[ d ] ) )
+      {
+        kHigh = 0.0;
+      }
+      continue;
+    }
+    const double k1 = ( startIndex[ d ] - firstIndex[ d ] ) / step[ d ];
+    const double k2 = ( endIndex[ d ] - firstIndex[ d ] ) / step[ d ];
+    kLow  = std::max( kLow, std::min( k1, k2 ) );
+    kHigh = std::min( kHigh, std::max( k1, k2 ) );
+  }
+
+  /** Seed with a range that encloses the rounded intersection. It may be
+   * empty, or touch the buffer in a single point, when kLow >= kHigh.
+   */
+  const double seedBegin = std::min( std::max( std::floor( kLow ), 0.0 ), n );
+  const double seedEnd   = std::min( std::max( std::ceil( kHigh ) + 1.0, seedBegin ), n );
+  kBegin = static_cast< SizeValueType >( seedBegin );
+  kEnd   = static_cast< SizeValueType >( seedEnd );
+
+  /** Correct with the exact test of the interpolator. The inside points
+   * form one interval, so it suffices to check the borders.
+   */
+  ContinuousIndexType cindex;
+  const auto isInside = [ & ]( const SizeValueType k ) -> bool
+  {
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      cindex[ d ] = firstIndex[ d ] + k * step[ d ];
+    }
+    return interpolator->IsInsideBuffer( cindex );
+  };
+  while( kBegin < kEnd && !isInside( kBegin ) ) { ++kBegin; }
+  while( kEnd > kBegin && !isInside( kEnd - 1 ) ) { --kEnd; }
+  if( kBegin == kEnd )
+  {
+    kBegin = 0;
+    kEnd   = 0;
+    return;
+  }
+  while( kBegin > 0 && isInside( kBegin - 1 ) ) { --kBegin; }
+  while( kEnd < numberOfPoints && isInside( kEnd ) ) { ++kEnd; }
+
+} // end ComputeScanlineInsideRange()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkScanlineResampleImageFilter_hxx
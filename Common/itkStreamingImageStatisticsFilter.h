@@ -0,0 +1,182 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStreamingImageStatisticsFilter_h
+#define itkStreamingImageStatisticsFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkSpatialObject.h"
+#include "itkArray.h"
+#include <vector>
+
+namespace itk
+{
+/** \class StreamingImageStatisticsFilter
+ * \brief Accumulate statistics of a scalar image over streamed regions.
+ *
+ * The filter passes its input through unmodified, for the requested region
+ * only, so that it can be placed in front of a streaming writer, or be
+ * driven slab by slab by StreamStatistics(). In contrast to
+ * StatisticsImageFilter, it never requests the largest possible region of
+ * its input: the statistics are accumulated over all regions that pass
+ * through the filter since the last call to ResetStatistics().
+ *
+ * The accumulated statistics are the number of voxels, minimum, maximum,
+ * mean, standard deviation, the number of voxels with a value <= 0, and a
+ * histogram with NumberOfHistogramBins equal bins between HistogramMinimum
+ * and HistogramMaximum. Values outside this range are counted in the first
+ * and last bin. Optionally, only the voxels whose physical point is inside
+ * a spatial object mask are taken into account.
+ *
+ * The filter is threaded. Each thread accumulates into its own
+ * temporaries, which are merged in AfterThreadedGenerateData().
+ *
+ * \ingroup MathematicalStatisticsImageFilters
+ */
+template< typename TInputImage >
+class StreamingImageStatisticsFilter :
+  public ImageToImageFilter< TInputImage, TInputImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef StreamingImageStatisticsFilter                 Self;
+  typedef ImageToImageFilter< TInputImage, TInputImage > Superclass;
+  typedef SmartPointer< Self >                           Pointer;
+  typedef SmartPointer< const Self >                     ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( StreamingImageStatisticsFilter, ImageToImageFilter );
+
+  /** Image related typedefs. */
+  typedef TInputImage                           InputImageType;
+  typedef typename InputImageType::Pointer      InputImagePointer;
+  typedef typename InputImageType::RegionType   RegionType;
+  typedef typename InputImageType::PixelType    PixelType;
+  typedef typename InputImageType::PointType    PointType;
+
+  itkStaticConstMacro( ImageDimension, unsigned int,
+    TInputImage::ImageDimension );
+
+  /** Typedefs for the mask and the histogram. */
+  typedef SpatialObject< itkGetStaticConstMacro( ImageDimension ) > MaskType;
+  typedef typename MaskType::ConstPointer                            MaskConstPointer;
+  typedef std::vector< SizeValueType >                               HistogramType;
+
+  /** Set/Get the mask. Only voxels inside the mask contribute. Default: none. */
+  itkSetConstObjectMacro( Mask, MaskType );
+  itkGetConstObjectMacro( Mask, MaskType );
+
+  /** Set/Get the histogram range and number of bins. Default: 20 bins
+   * between 0.0 and 2.0. Zero bins disables the histogram.
+   */
+  itkSetMacro( HistogramMinimum, double );
+  itkGetConstMacro( HistogramMinimum, double );
+  itkSetMacro( HistogramMaximum, double );
+  itkGetConstMacro( HistogramMaximum, double );
+  itkSetMacro( NumberOfHistogramBins, unsigned int );
+  itkGetConstMacro( NumberOfHistogramBins, unsigned int );
+
+  /** Set/Get the number of slabs in which StreamStatistics() divides the
+   * largest possible region. Default: 1.
+   */
+  itkSetClampMacro( NumberOfStreamDivisions, unsigned int,
+    1, NumericTraits< unsigned int >::max() );
+  itkGetConstMacro( NumberOfStreamDivisions, unsigned int );
+
+  /** Clear the accumulated statistics. */
+  virtual void ResetStatistics( void );
+
+  /** Reset the statistics, and then pull the largest possible region of
+   * the input through the filter in NumberOfStreamDivisions slabs, without
+   * ever holding more than one slab in memory.
+   */
+  virtual void StreamStatistics( void );
+
+  /** Get the accumulated statistics. */
+  itkGetConstMacro( Count, SizeValueType );
+  itkGetConstMacro( Minimum, double );
+  itkGetConstMacro( Maximum, double );
+  itkGetConstMacro( NumberOfNonPositiveValues, SizeValueType );
+  itkGetConstReferenceMacro( Histogram, HistogramType );
+  virtual double GetMean( void ) const;
+
+  virtual double GetSigma( void ) const;
+
+  virtual double GetFractionOfNonPositiveValues( void ) const;
+
+protected:
+
+  StreamingImageStatisticsFilter();
+  ~StreamingImageStatisticsFilter() override {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+  /** Pass the input through as the output, instead of allocating. */
+  void AllocateOutputs( void ) override;
+
+  /** Initialize the thread temporaries. */
+  void BeforeThreadedGenerateData( void ) override;
+
+  /** Merge the thread temporaries into the accumulated statistics. */
+  void AfterThreadedGenerateData( void ) override;
+
+  /** Accumulate the statistics of one thread's region. */
+  void ThreadedGenerateData( const RegionType & outputRegionForThread,
+    ThreadIdType threadId ) override;
+
+private:
+
+  StreamingImageStatisticsFilter( const Self & ); // purposely not implemented
+  void operator=( const Self & );                 // purposely not implemented
+
+  MaskConstPointer m_Mask;
+  double           m_HistogramMinimum;
+  double           m_HistogramMaximum;
+  unsigned int     m_NumberOfHistogramBins;
+  unsigned int     m_NumberOfStreamDivisions;
+
+  /** The accumulated statistics. */
+  SizeValueType m_Count;
+  double        m_Sum;
+  double        m_SumOfSquares;
+  double        m_Minimum;
+  double        m_Maximum;
+  SizeValueType m_NumberOfNonPositiveValues;
+  HistogramType m_Histogram;
+
+  /** The per thread temporaries. */
+  Array< SizeValueType >       m_ThreadCount;
+  Array< double >              m_ThreadSum;
+  Array< double >              m_ThreadSumOfSquares;
+  Array< double >              m_ThreadMinimum;
+  Array< double >              m_ThreadMaximum;
+  Array< SizeValueType >       m_ThreadNumberOfNonPositiveValues;
+  std::vector< HistogramType > m_ThreadHistogram;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkStreamingImageStatisticsFilter.hxx"
+#endif
+
+#endif // end #ifndef itkStreamingImageStatisticsFilter_h
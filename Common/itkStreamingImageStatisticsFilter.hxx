@@ -0,0 +1,376 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStreamingImageStatisticsFilter_hxx
+#define itkStreamingImageStatisticsFilter_hxx
+
+#include "itkStreamingImageStatisticsFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionSplitterSlowDimension.h"
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template< typename TInputImage >
+StreamingImageStatisticsFilter< TInputImage >
+::StreamingImageStatisticsFilter()
+{
+  this->m_HistogramMinimum        = 0.0;
+  this->m_HistogramMaximum        = 2.0;
+  this->m_NumberOfHistogramBins   = 20;
+  this->m_NumberOfStreamDivisions = 1;
+
+  this->ResetStatistics();
+
+#if ITK_VERSION_MAJOR >= 5
+  // Use the classic (ITK4) threading model, to ensure ThreadedGenerateData is being called.
+  this->itk::ImageSource< TInputImage >::DynamicMultiThreadingOff();
+#endif
+
+} // end Constructor()
+
+
+/**
+ * ********************* ResetStatistics ****************************
+ */
+
+template< typename TInputImage >
+void
+StreamingImageStatisticsFilter< TInputImage >
+::ResetStatistics( void )
+{
+  this->m_Count                     = 0;
+  this->m_Sum                       = 0.0;
+  this->m_SumOfSquares              = 0.0;
+  this->m_Minimum                   = NumericTraits< double >::max();
+  this->m_Maximum                   = NumericTraits< double >::NonpositiveMin();
+  this->m_NumberOfNonPositiveValues = 0;
+  this->m_Histogram.assign( this->m_NumberOfHistogramBins, 0 );
+
+} // end ResetStatistics()
+
+
+/**
+ * ********************* StreamStatistics ****************************
+ */
+
+template< typename TInputImage >
+void
+StreamingImageStatisticsFilter< TInputImage >
+::StreamStatistics( void )
+{
+  this->ResetStatistics();
+
+  this->UpdateOutputInformation();
+  InputImageType * outputPtr = this->GetOutput();
+  const RegionType largestRegion = outputPtr->GetLargestPossibleRegion();
+
+  /** Pull the slabs through the pipeline one by one. Each slab replaces
+   * the buffer of the previous one, upstream as well as in this filter.
+   */
+  ImageRegionSplitterSlowDimension::Pointer splitter
+    = ImageRegionSplitterSlowDimension::New();
+  const unsigned int numberOfPieces = splitter->GetNumberOfSplits(
+    largestRegion, this->m_NumberOfStreamDivisions );
+
+  for( unsigned int piece = 0; piece < numberOfPieces && !this->GetAbortGenerateData(); ++piece )
+  {
+    RegionType streamRegion = largestRegion;
+    splitter->GetSplit( piece, numberOfPieces, streamRegion );
+
+    outputPtr->SetRequestedRegion( streamRegion );
+    outputPtr->PropagateRequestedRegion();
+    outputPtr->UpdateOutputData();
+  }
+
+} // end StreamStatistics()
+
+
+/**
+ * ********************* AllocateOutputs ****************************
+ */
+
+template< typename TInputImage >
+void
+StreamingImageStatisticsFilter< TInputImage >
+::AllocateOutputs( void )
+{
+  // Pass the input through as the output. The input buffer only covers
+  // the requested region, so nothing beyond the current slab is held.
+  InputImagePointer image = const_cast< TInputImage * >( this->GetInput() );
+  this->GraftOutput( image );
+
+} // end AllocateOutputs()
+
+
+/**
+ * ********************* BeforeThreadedGenerateData ****************************
+ */
+
+template< typename TInputImage >
+void
+StreamingImageStatisticsFilter< TInputImage >
+::BeforeThreadedGenerateData( void )
+{
+#if ITK_VERSION_MAJOR >= 5
+  const ThreadIdType numberOfThreads = this->GetNumberOfWorkUnits();
+#else
+  const ThreadIdType numberOfThreads = this->GetNumberOfThreads();
+#endif
+
+  /** The number of bins may have been changed after the last reset. */
+  if( this->m_Histogram.size() != this->m_NumberOfHistogramBins )
+  {
+    if( this->m_Count > 0 )
+    {
+      itkExceptionMacro( << "NumberOfHistogramBins changed without calling ResetStatistics()" );
+    }
+    this->m_Histogram.assign( this->m_NumberOfHistogramBins, 0 );
+  }
+  if( this->m_NumberOfHistogramBins > 0
+    && !( this->m_HistogramMaximum > this->m_HistogramMinimum ) )
+  {
+    itkExceptionMacro( << "HistogramMaximum should be larger than HistogramMinimum" );
+  }
+
+  // Resize and initialize the thread temporaries
+  this->m_ThreadCount.SetSize( numberOfThreads );
+  this->m_ThreadSum.SetSize( numberOfThreads );
+  this->m_ThreadSumOfSquares.SetSize( numberOfThreads );
+  this->m_ThreadMinimum.SetSize( numberOfThreads );
+  this->m_ThreadMaximum.SetSize( numberOfThreads );
+  this->m_ThreadNumberOfNonPositiveValues.SetSize( numberOfThreads );
+  this->m_ThreadCount.Fill( 0 );
+  this->m_ThreadSum.Fill( 0.0 );
+  this->m_ThreadSumOfSquares.Fill( 0.0 );
+  this->m_ThreadMinimum.Fill( NumericTraits< double >::max() );
+  this->m_ThreadMaximum.Fill( NumericTraits< double >::NonpositiveMin() );
+  this->m_ThreadNumberOfNonPositiveValues.Fill( 0 );
+  this->m_ThreadHistogram.assign( numberOfThreads,
+    HistogramType( this->m_NumberOfHistogramBins, 0 ) );
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * ********************* ThreadedGenerateData ****************************
+ */
+
+template< typename TInputImage >
+void
+StreamingImageStatisticsFilter< TInputImage >
+::ThreadedGenerateData( const RegionType & outputRegionForThread,
+  ThreadIdType threadId )
+{
+  if( outputRegionForThread.GetNumberOfPixels() == 0 )
+  {
+    return;
+  }
+
+  const InputImageType * inputPtr = this->GetInput();
+  const MaskType *       mask     = this->m_Mask.GetPointer();
+
+  const unsigned int nrOfBins = this->m_NumberOfHistogramBins;
+  const double       binScale = nrOfBins > 0
+    ? nrOfBins / ( this->m_HistogramMaximum - this->m_HistogramMinimum ) : 0.0;
+  HistogramType & histogram = this->m_ThreadHistogram[ threadId ];
+
+  SizeValueType count           = 0;
+  SizeValueType nrOfNonPositive = 0;
+  double        sum             = 0.0;
+  double        sumOfSquares    = 0.0;
+  double        minimum         = NumericTraits< double >::max();
+  double        maximum         = NumericTraits< double >::NonpositiveMin();
+  PointType     point;
+
+  ImageRegionConstIteratorWithIndex< InputImageType > it( inputPtr, outputRegionForThread );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    if( mask )
+    {
+      inputPtr->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+      if( !mask->IsInside( point ) )
+      {
+        continue;
+      }
+    }
+
+    const double value = static_cast< double >( it.Get() );
+    if( value != value )
+    {
+      continue; // skip NaN
+    }
+
+    ++count;
+    sum          += value;
+    sumOfSquares += value * value;
+    minimum       = std::min( minimum, value );
+    maximum       = std::max( maximum, value );
+    if( value <= 0.0 )
+    {
+      ++nrOfNonPositive;
+    }
+
+    if( nrOfBins > 0 )
+    {
+      const double bin = std::floor( ( value - this->m_HistogramMinimum ) * binScale );
+      if( bin < 0.0 )
+      {
+        ++histogram[ 0 ];
+      }
+      else if( bin >= static_cast< double >( nrOfBins ) )
+      {
+        ++histogram[ nrOfBins - 1 ];
+      }
+      else
+      {
+        ++histogram[ static_cast< unsigned int >( bin ) ];
+      }
+    }
+  }
+
+  this->m_ThreadCount[ threadId ]                     = count;
+  this->m_ThreadSum[ threadId ]                       = sum;
+  this->m_ThreadSumOfSquares[ threadId ]              = sumOfSquares;
+  this->m_ThreadMinimum[ threadId ]                   = minimum;
+  this->m_ThreadMaximum[ threadId ]                   = maximum;
+  this->m_ThreadNumberOfNonPositiveValues[ threadId ] = nrOfNonPositive;
+
+} // end ThreadedGenerateData()
+
+
+/**
+ * ********************* AfterThreadedGenerateData ****************************
+ */
+
+template< typename TInputImage >
+void
+StreamingImageStatisticsFilter< TInputImage >
+::AfterThreadedGenerateData( void )
+{
+  for( unsigned int i = 0; i < this->m_ThreadCount.GetSize(); ++i )
+  {
+    this->m_Count                     += this->m_ThreadCount[ i ];
+    this->m_Sum                       += this->m_ThreadSum[ i ];
+    this->m_SumOfSquares              += this->m_ThreadSumOfSquares[ i ];
+    this->m_Minimum                    = std::min( this->m_Minimum, this->m_ThreadMinimum[ i ] );
+    this->m_Maximum                    = std::max( this->m_Maximum, this->m_ThreadMaximum[ i ] );
+    this->m_NumberOfNonPositiveValues += this->m_ThreadNumberOfNonPositiveValues[ i ];
+    for( unsigned int b = 0; b < this->m_NumberOfHistogramBins; ++b )
+    {
+      this->m_Histogram[ b ] += this->m_ThreadHistogram[ i ][ b ];
+    }
+  }
+
+} // end AfterThreadedGenerateData()
+
+
+/**
+ * ********************* GetMean ****************************
+ */
+
+template< typename TInputImage >
+double
+StreamingImageStatisticsFilter< TInputImage >
+::GetMean( void ) const
+{
+  if( this->m_Count == 0 )
+  {
+    return 0.0;
+  }
+  return this->m_Sum / static_cast< double >( this->m_Count );
+
+} // end GetMean()
+
+
+/**
+ * ********************* GetSigma ****************************
+ */
+
+template< typename TInputImage >
+double
+StreamingImageStatisticsFilter< TInputImage >
+::GetSigma( void ) const
+{
+  if( this->m_Count < 2 )
+  {
+    return 0.0;
+  }
+
+  // unbiased estimate
+  const double count    = static_cast< double >( this->m_Count );
+  const double variance = ( this->m_SumOfSquares - this->m_Sum * this->m_Sum / count )
+    / ( count - 1.0 );
+  return std::sqrt( std::max( variance, 0.0 ) );
+
+} // end GetSigma()
+
+
+/**
+ * ********************* GetFractionOfNonPositiveValues ****************************
+ */
+
+template< typename TInputImage >
+double
+StreamingImageStatisticsFilter< TInputImage >
+::GetFractionOfNonPositiveValues( void ) const
+{
+  if( this->m_Count == 0 )
+  {
+    return 0.0;
+  }
+  return static_cast< double >( this->m_NumberOfNonPositiveValues )
+    / static_cast< double >( this->m_Count );
+
+} // end GetFractionOfNonPositiveValues()
+
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+template< typename TInputImage >
+void
+StreamingImageStatisticsFilter< TInputImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Mask: " << this->m_Mask.GetPointer() << std::endl;
+  os << indent << "HistogramMinimum: " << this->m_HistogramMinimum << std::endl;
+  os << indent << "HistogramMaximum: " << this->m_HistogramMaximum << std::endl;
+  os << indent << "NumberOfHistogramBins: " << this->m_NumberOfHistogramBins << std::endl;
+  os << indent << "NumberOfStreamDivisions: " << this->m_NumberOfStreamDivisions << std::endl;
+  os << indent << "Count: " << this->m_Count << std::endl;
+  os << indent << "Minimum: " << this->m_Minimum << std::endl;
+  os << indent << "Maximum: " << this->m_Maximum << std::endl;
+  os << indent << "Mean: " << this->GetMean() << std::endl;
+  os << indent << "Sigma: " << this->GetSigma() << std::endl;
+  os << indent << "NumberOfNonPositiveValues: " << this->m_NumberOfNonPositiveValues << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef itkStreamingImageStatisticsFilter_hxx
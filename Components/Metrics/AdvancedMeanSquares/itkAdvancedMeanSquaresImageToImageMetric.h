@@ -24,6 +24,8 @@
 #include "itkImageGridSampler.h"                        // needed for SelfHessian
 #include "itkNearestNeighborInterpolateImageFunction.h" // needed for SelfHessian
 
+#include <vector>
+
 namespace itk
 {
 
@@ -120,6 +122,7 @@ public:
     Superclass::MovingImageDerivativeScalesType MovingImageDerivativeScalesType;
   typedef typename Superclass::HessianValueType HessianValueType;
   typedef typename Superclass::HessianType      HessianType;
+  typedef typename Superclass::CompressedHessianType CompressedHessianType;
   typedef typename Superclass::ThreaderType     ThreaderType;
   typedef typename Superclass::ThreadInfoType   ThreadInfoType;
 
@@ -153,6 +156,10 @@ public:
   /** Experimental feature: compute SelfHessian */
   void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const override;
 
+  /** Experimental feature: compute SelfHessian, in compressed row format. */
+  void GetCompressedSelfHessian( const TransformParametersType & parameters,
+    CompressedHessianType & H ) const override;
+
   /** Default: 1.0 mm */
   itkSetMacro( SelfHessianSmoothingSigma, double );
   itkGetConstMacro( SelfHessianSmoothingSigma, double );
@@ -217,6 +224,8 @@ protected:
   typedef NearestNeighborInterpolateImageFunction<
     FixedImageType, CoordinateRepresentationType >                 DummyFixedImageInterpolatorType;
   typedef ImageGridSampler< FixedImageType >                       SelfHessianSamplerType;
+  typedef typename CompressedHessianType::IndexType                HessianIndexType;
+  typedef typename CompressedHessianType::IndexContainerType       HessianIndexContainerType;
 
   double m_NormalizationFactor;
 
@@ -230,12 +239,51 @@ protected:
     MeasureType & measure,
     DerivativeType & deriv ) const;
 
-  /** Compute a pixel's contribution to the SelfHessian;
-   * Called by GetSelfHessian(). */
-  void UpdateSelfHessianTerms(
-    const DerivativeType & imageJacobian,
-    const NonZeroJacobianIndicesType & nzji,
-    HessianType & H ) const;
+  /** The steps of the SelfHessian computation, each launched over all threads. */
+  enum SelfHessianStepType {
+    ComputeSelfHessianGradientsStep = 0, FindSelfHessianSupportsStep, ComputeSelfHessianPatternStep,
+    AccumulateSelfHessianStep, ScatterSelfHessianStep
+  };
+
+  /** Helper struct that multi-threads the computation of the SelfHessian.
+   * The valid samples are sorted on their support, i.e. their nonzero Jacobian
+   * indices. The sparsity pattern of the Hessian follows from the supports, and
+   * is filled with the summed outer products of all samples of a support.
+   */
+  struct SelfHessianThreaderParametersType
+  {
+    const Self *                                             st_Metric;
+    SelfHessianStepType                                      st_Step;
+    ThreadIdType                                             st_NumberOfThreads;
+    const ImageSampleContainerType *                         st_SampleContainer;
+    const FixedImageInterpolatorType *                       st_FixedInterpolator;
+    std::vector< MovingImageDerivativeType >                 st_Gradients;
+    std::vector< unsigned char >                             st_IsValid;
+    std::vector< unsigned long >                             st_SupportKeys;
+    std::vector< std::pair< unsigned long, unsigned long > > st_SampleOrder;
+    std::vector< unsigned char >                             st_IsSupportBegin;
+    std::vector< unsigned long >                             st_SupportBegins;
+    NonZeroJacobianIndicesType                               st_SupportIndices;
+    std::vector< unsigned long >                             st_RowSupportPointers;
+    std::vector< unsigned long >                             st_RowSupports;
+    std::vector< HessianIndexContainerType >                 st_PatternColumns;
+    unsigned long                                            st_BatchBegin;
+    unsigned long                                            st_BatchEnd;
+    std::vector< double >                                    st_Blocks;
+    CompressedHessianType *                                  st_Hessian;
+  };
+
+  /** Run a step of the SelfHessian computation, multi-threaded if
+   * more than one thread is used. */
+  void LaunchSelfHessianStep( SelfHessianThreaderParametersType & parameters,
+    const SelfHessianStepType step ) const;
+
+  /** SelfHessian threader callback function. */
+  static ITK_THREAD_RETURN_TYPE SelfHessianThreaderCallback( void * arg );
+
+  /** Run the current SelfHessian step for one of the threads. */
+  void ThreadedSelfHessianStep( const ThreadIdType threadId, const ThreadIdType numberOfThreads,
+    SelfHessianThreaderParametersType & parameters ) const;
 
   /** Get value for each thread. */
   inline void ThreadedGetValue( ThreadIdType threadID ) override;
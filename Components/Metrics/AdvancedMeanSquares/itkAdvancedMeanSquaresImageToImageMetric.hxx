@@ -23,6 +23,8 @@
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "itkComputeImageExtremaFilter.h"
 
+#include <algorithm>
+
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
 #endif
@@ -881,6 +883,25 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const
 {
   itkDebugMacro( "GetSelfHessian()" );
+
+  CompressedHessianType compressedH;
+  this->GetCompressedSelfHessian( parameters, compressedH );
+  compressedH.CopyTo( H );
+
+} // end GetSelfHessian()
+
+
+/**
+ * ******************* GetCompressedSelfHessian *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::GetCompressedSelfHessian( const TransformParametersType & parameters,
+  CompressedHessianType & H ) const
+{
+  itkDebugMacro( "GetCompressedSelfHessian()" );
   typedef Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
 
   /** Initialize some variables. */
@@ -888,19 +909,12 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
   randomGenerator->Initialize();
 
-  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
-  NonZeroJacobianIndicesType nzji(
-  this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  DerivativeType        imageJacobian( nzji.size() );
-  TransformJacobianType jacobian;
-
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
   /** Prepare Hessian */
-  H.set_size( this->GetNumberOfParameters(),
-    this->GetNumberOfParameters() );
-  //H.Fill(0.0); // done by set_size if sparse matrix
+  const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
+  H.SetSize( numberOfParameters );
 
   /** Smooth fixed image */
   typename SmootherType::Pointer smoother = SmootherType::New();
@@ -924,176 +938,421 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
    * Actually we could do without a sampler, but it's easy like this.
    */
   typename SelfHessianSamplerType::Pointer sampler = SelfHessianSamplerType::New();
-  //typename DummyFixedImageInterpolatorType::Pointer dummyInterpolator =
-  //  DummyFixedImageInterpolatorType::New();
   sampler->SetInputImageRegion( this->GetImageSampler()->GetInputImageRegion() );
   sampler->SetMask( this->GetImageSampler()->GetMask() );
   sampler->SetInput( smoother->GetInput() );
   sampler->SetNumberOfSamples( this->m_NumberOfSamplesForSelfHessian );
-  //sampler->SetInterpolator( dummyInterpolator );
 
   /** Update the imageSampler and get a handle to the sample container. */
   sampler->Update();
   ImageSampleContainerPointer sampleContainer = sampler->GetOutput();
+  const unsigned long         numberOfSamples = sampleContainer->Size();
+
+  /** Setup the threader parameters. */
+  SelfHessianThreaderParametersType threaderParameters;
+  threaderParameters.st_Metric            = this;
+  threaderParameters.st_Step              = ComputeSelfHessianGradientsStep;
+  threaderParameters.st_NumberOfThreads   = this->m_UseMultiThread ? Self::GetNumberOfThreads() : 1;
+  threaderParameters.st_SampleContainer   = sampleContainer.GetPointer();
+  threaderParameters.st_FixedInterpolator = fixedInterpolator.GetPointer();
+  threaderParameters.st_Hessian           = &H;
+  threaderParameters.st_Gradients.resize( numberOfSamples );
+  threaderParameters.st_IsValid.resize( numberOfSamples );
+  threaderParameters.st_SupportKeys.resize( numberOfSamples );
+
+  /** Compute the fixed image gradients, and find the valid samples. */
+  this->LaunchSelfHessianStep( threaderParameters, ComputeSelfHessianGradientsStep );
+
+  /** Add the noise to the gradients of the valid samples. The random generator
+   * is not thread-safe, so this is done here, in the order of the samples.
+   */
+  std::vector< std::pair< unsigned long, unsigned long > > & sampleOrder = threaderParameters.st_SampleOrder;
+  for( unsigned long i = 0; i < numberOfSamples; ++i )
+  {
+    if( threaderParameters.st_IsValid[ i ] )
+    {
+      for( unsigned int d = 0; d < FixedImageDimension; ++d )
+      {
+        threaderParameters.st_Gradients[ i ][ d ] += randomGenerator->GetVariateWithClosedRange(
+          this->m_SelfHessianNoiseRange ) - this->m_SelfHessianNoiseRange / 2.0;
+      }
+      sampleOrder.push_back( std::make_pair( threaderParameters.st_SupportKeys[ i ], i ) );
+    }
+  }
+  this->m_NumberOfPixelsCounted = sampleOrder.size();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(
+    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  if( this->m_NumberOfPixelsCounted == 0 )
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
-    MovingImagePointType        mappedPoint;
-    MovingImageDerivativeType   movingImageDerivative;
+    H.SetIdentity( numberOfParameters );
+    return;
+  }
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+  /** Sort the valid samples on their support, given by the first nonzero
+   * Jacobian index, and split them in groups of samples with the same
+   * nonzero Jacobian indices.
+   */
+  std::sort( sampleOrder.begin(), sampleOrder.end() );
+  threaderParameters.st_IsSupportBegin.resize( sampleOrder.size() );
+  this->LaunchSelfHessianStep( threaderParameters, FindSelfHessianSupportsStep );
 
-    /** Check if point is inside mask. NB: we assume here that the
-     * initial transformation is approximately ok.
-     */
-    if( sampleOk )
+  std::vector< unsigned long > & supportBegins = threaderParameters.st_SupportBegins;
+  for( unsigned long k = 0; k < sampleOrder.size(); ++k )
+  {
+    if( threaderParameters.st_IsSupportBegin[ k ] )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
+      supportBegins.push_back( k );
     }
-
-    /** Check if point is inside moving image. NB: we assume here that the
-     * initial transformation is approximately ok.
-     */
-    if( sampleOk )
+  }
+  const unsigned long numberOfSupports = supportBegins.size();
+  supportBegins.push_back( sampleOrder.size() );
+
+  /** Store the nonzero Jacobian indices of all supports. */
+  const unsigned long nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType & supportIndices = threaderParameters.st_SupportIndices;
+  NonZeroJacobianIndicesType   nzji( nnzji );
+  supportIndices.resize( numberOfSupports * nnzji );
+  for( unsigned long s = 0; s < numberOfSupports; ++s )
+  {
+    const unsigned long i = sampleOrder[ supportBegins[ s ] ].second;
+    this->m_AdvancedTransform->GetNonZeroJacobianIndices(
+      sampleContainer->ElementAt( i ).m_ImageCoordinates, nzji );
+    if( nzji.size() != nnzji )
     {
-      sampleOk = this->m_Interpolator->IsInsideBuffer( mappedPoint );
+      itkExceptionMacro( << "The transform returned " << nzji.size()
+                         << " nonzero Jacobian indices, instead of " << nnzji << "." );
     }
+    std::copy( nzji.begin(), nzji.end(), supportIndices.begin() + s * nnzji );
+  }
 
-    if( sampleOk )
-    {
-      this->m_NumberOfPixelsCounted++;
+  /** For every row of the Hessian, list the supports that contain it, in
+   * increasing order. An entry s * nnzji + a refers to the a-th nonzero
+   * Jacobian index of support s.
+   */
+  std::vector< unsigned long > & rowSupportPointers = threaderParameters.st_RowSupportPointers;
+  std::vector< unsigned long > & rowSupports        = threaderParameters.st_RowSupports;
+  rowSupportPointers.assign( numberOfParameters + 1, 0 );
+  for( unsigned long p = 0; p < supportIndices.size(); ++p )
+  {
+    ++rowSupportPointers[ supportIndices[ p ] + 1 ];
+  }
+  for( unsigned long r = 0; r < numberOfParameters; ++r )
+  {
+    rowSupportPointers[ r + 1 ] += rowSupportPointers[ r ];
+  }
+  rowSupports.resize( supportIndices.size() );
+  std::vector< unsigned long > rowFill( rowSupportPointers.begin(), rowSupportPointers.end() - 1 );
+  for( unsigned long p = 0; p < supportIndices.size(); ++p )
+  {
+    rowSupports[ rowFill[ supportIndices[ p ] ]++ ] = p;
+  }
 
-      /** Use the derivative of the fixed image for the self Hessian!
-       * \todo: we can do this more efficient without the interpolation,
-       * without the sampler, and with a precomputed gradient image,
-       * but is this the bottleneck?
-       */
-      movingImageDerivative = fixedInterpolator->EvaluateDerivative( fixedPoint );
-      for( unsigned int d = 0; d < FixedImageDimension; ++d )
-      {
-        movingImageDerivative[ d ] += randomGenerator->GetVariateWithClosedRange(
-          this->m_SelfHessianNoiseRange ) - this->m_SelfHessianNoiseRange / 2.0;
-      }
+  /** Compute the sparsity pattern of the upper triangular part. Every
+   * thread computes the columns of its own rows.
+   */
+  threaderParameters.st_PatternColumns.resize( threaderParameters.st_NumberOfThreads );
+  this->LaunchSelfHessianStep( threaderParameters, ComputeSelfHessianPatternStep );
 
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+  typename CompressedHessianType::IndexContainerType & rowPointers   = H.GetRowPointers();
+  typename CompressedHessianType::IndexContainerType & columnIndices = H.GetColumnIndices();
+  for( unsigned long r = 0; r < numberOfParameters; ++r )
+  {
+    rowPointers[ r + 1 ] += rowPointers[ r ];
+  }
+  columnIndices.reserve( rowPointers[ numberOfParameters ] );
+  for( ThreadIdType t = 0; t < threaderParameters.st_NumberOfThreads; ++t )
+  {
+    HessianIndexContainerType & threadColumns = threaderParameters.st_PatternColumns[ t ];
+    columnIndices.insert( columnIndices.end(), threadColumns.begin(), threadColumns.end() );
+    HessianIndexContainerType().swap( threadColumns );
+  }
+  H.GetValues().assign( columnIndices.size(), 0.0 );
 
-      /** Compute the innerproducts (dM/dx)^T (dT/dmu) */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+  /** Fill the pattern with the summed outer products of the image Jacobians.
+   * The supports are processed in batches, whose dense blocks take at most
+   * 64 MB. Per batch, the blocks are computed per support, and then added to
+   * the rows of the Hessian. Every element thus receives its terms in the same
+   * order, independent of the number of threads.
+   */
+  const unsigned long blockSize = nnzji * nnzji;
+  const unsigned long batchSize = std::max( static_cast< unsigned long >( 8388608 / blockSize ), 1ul );
+  for( unsigned long s = 0; s < numberOfSupports; s += batchSize )
+  {
+    threaderParameters.st_BatchBegin = s;
+    threaderParameters.st_BatchEnd   = std::min( s + batchSize, numberOfSupports );
+    threaderParameters.st_Blocks.resize( ( threaderParameters.st_BatchEnd - s ) * blockSize );
+    this->LaunchSelfHessianStep( threaderParameters, AccumulateSelfHessianStep );
+    this->LaunchSelfHessianStep( threaderParameters, ScatterSelfHessianStep );
+  }
 
-      /** Compute this pixel's contribution to the SelfHessian. */
-      this->UpdateSelfHessianTerms( imageJacobian, nzji, H );
+  /** Normalize. */
+  const double normal_sum = 2.0 * this->m_NormalizationFactor
+    / static_cast< double >( this->m_NumberOfPixelsCounted );
+  typename CompressedHessianType::ValueContainerType & values = H.GetValues();
+  for( unsigned long p = 0; p < values.size(); ++p )
+  {
+    values[ p ] *= normal_sum;
+  }
 
-    } // end if sampleOk
+} // end GetCompressedSelfHessian()
 
-  } // end for loop over the image sample container
 
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples(
-    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+/**
+ * *************** LaunchSelfHessianStep ***************************
+ */
 
-  /** Compute the measure value and derivative. */
-  if( this->m_NumberOfPixelsCounted > 0 )
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::LaunchSelfHessianStep(
+  SelfHessianThreaderParametersType & parameters,
+  const SelfHessianStepType step ) const
+{
+  parameters.st_Step = step;
+
+  /** Single-threaded: run the step directly. */
+  if( parameters.st_NumberOfThreads == 1 )
   {
-    const double normal_sum = 2.0 * this->m_NormalizationFactor
-      / static_cast< double >( this->m_NumberOfPixelsCounted );
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
-    {
-      H.scale_row( i, normal_sum );
-    }
-  }
-  else
-  {
-    //H.fill_diagonal(1.0);
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
-    {
-      H( i, i ) = 1.0;
-    }
+    this->ThreadedSelfHessianStep( 0, 1, parameters );
+    return;
   }
 
-} // end GetSelfHessian()
+  this->m_Threader->SetSingleMethod( SelfHessianThreaderCallback,
+    static_cast< void * >( &parameters ) );
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchSelfHessianStep()
+
+
+/**
+ * *************** SelfHessianThreaderCallback ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::SelfHessianThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
+
+  SelfHessianThreaderParametersType * temp
+    = static_cast< SelfHessianThreaderParametersType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedSelfHessianStep( threadId, nrOfThreads, *temp );
+
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end SelfHessianThreaderCallback()
 
 
 /**
- * *************** UpdateSelfHessianTerms ***************************
+ * *************** ThreadedSelfHessianStep ***************************
  */
 
 template< class TFixedImage, class TMovingImage >
 void
 AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
-::UpdateSelfHessianTerms(
-  const DerivativeType & imageJacobian,
-  const NonZeroJacobianIndicesType & nzji,
-  HessianType & H ) const
+::ThreadedSelfHessianStep( const ThreadIdType threadId, const ThreadIdType numberOfThreads,
+  SelfHessianThreaderParametersType & parameters ) const
 {
-  typedef typename HessianType::row    RowType;
-  typedef typename RowType::iterator   RowIteratorType;
-  typedef typename HessianType::pair_t ElementType;
-
-  // does not work for sparse matrix. \todo: distinguish between sparse and nonsparse
-  ///** Do rank-1 update of H */
-  //if ( nzji.size() == this->GetNumberOfParameters() )
-  //{
-  //  /** Loop over all Jacobians. */
-  //  vnl_matrix_update( H, imageJacobian, imageJacobian );
-  //}
-  //else
-  //{
-  /** Only pick the nonzero Jacobians.
-  * Save only upper triangular part of the matrix */
-  const unsigned int imjacsize = imageJacobian.GetSize();
-  for( unsigned int i = 0; i < imjacsize; ++i )
+  /** The samples, sorted samples, supports or Hessian rows of this thread. */
+  unsigned long numberOfItems = parameters.st_SampleContainer->Size();
+  unsigned long firstItem     = 0;
+  if( parameters.st_Step == FindSelfHessianSupportsStep )
   {
-    const unsigned int row      = nzji[ i ];
-    const double       imjacrow = imageJacobian[ i ];
+    numberOfItems = parameters.st_SampleOrder.size();
+  }
+  else if( parameters.st_Step == AccumulateSelfHessianStep )
+  {
+    firstItem     = parameters.st_BatchBegin;
+    numberOfItems = parameters.st_BatchEnd - parameters.st_BatchBegin;
+  }
+  else if( parameters.st_Step == ComputeSelfHessianPatternStep
+    || parameters.st_Step == ScatterSelfHessianStep )
+  {
+    numberOfItems = this->GetNumberOfParameters();
+  }
+  const unsigned long itemsPerThread = static_cast< unsigned long >(
+    std::ceil( static_cast< double >( numberOfItems ) / static_cast< double >( numberOfThreads ) ) );
+  const unsigned long pos_begin = firstItem + std::min( itemsPerThread * threadId, numberOfItems );
+  const unsigned long pos_end   = firstItem + std::min( itemsPerThread * ( threadId + 1 ), numberOfItems );
 
-    RowType &       rowVector = H.get_row( row );
-    RowIteratorType rowIt     = rowVector.begin();
+  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
+  const unsigned long        n = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType nzji( n );
+  DerivativeType             imageJacobian( n );
 
-    for( unsigned int j = i; j < imjacsize; ++j )
+  if( parameters.st_Step == ComputeSelfHessianGradientsStep )
+  {
+    for( unsigned long i = pos_begin; i < pos_end; ++i )
     {
-      const unsigned int col = nzji[ j ];
-      const double       val = imjacrow * imageJacobian[ j ];
-      if( ( val < 1e-14 ) && ( val > -1e-14 ) )
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint = parameters.st_SampleContainer->ElementAt( i ).m_ImageCoordinates;
+      MovingImagePointType        mappedPoint;
+
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+
+      /** Check if point is inside mask. NB: we assume here that the
+       * initial transformation is approximately ok.
+       */
+      if( sampleOk )
       {
-        continue;
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
       }
 
-      /** The following implements:
-       * H(row,col) += imjacrow * imageJacobian[ j ];
-       * But more efficient.
+      /** Check if point is inside moving image. NB: we assume here that the
+       * initial transformation is approximately ok.
        */
+      if( sampleOk )
+      {
+        sampleOk = this->m_Interpolator->IsInsideBuffer( mappedPoint );
+      }
 
-      /** Go to next element */
-      for(; ( rowIt != rowVector.end() ) && ( ( *rowIt ).first < col ); ++rowIt )
-      {}
-
-      if( ( rowIt == rowVector.end() ) || ( ( *rowIt ).first != col ) )
+      parameters.st_IsValid[ i ] = sampleOk;
+      if( sampleOk )
       {
-        /** Add new column to the row and set iterator to that column. */
-        rowIt = rowVector.insert( rowIt, ElementType( col, val ) );
+        /** Use the derivative of the fixed image for the self Hessian!
+         * The noise is added afterwards.
+         */
+        parameters.st_Gradients[ i ] = parameters.st_FixedInterpolator->EvaluateDerivative( fixedPoint );
+
+        /** The support of the sample is identified by its first nonzero
+         * Jacobian index.
+         */
+        this->m_AdvancedTransform->GetNonZeroJacobianIndices( fixedPoint, nzji );
+        parameters.st_SupportKeys[ i ] = nzji.empty() ? 0 : nzji[ 0 ];
       }
-      else
+    }
+  }
+  else if( parameters.st_Step == FindSelfHessianSupportsStep )
+  {
+    /** A new support starts where the nonzero Jacobian indices change. */
+    NonZeroJacobianIndicesType previousNzji;
+    if( pos_begin > 0 && pos_begin < pos_end )
+    {
+      const unsigned long i = parameters.st_SampleOrder[ pos_begin - 1 ].second;
+      this->m_AdvancedTransform->GetNonZeroJacobianIndices(
+        parameters.st_SampleContainer->ElementAt( i ).m_ImageCoordinates, previousNzji );
+    }
+    for( unsigned long k = pos_begin; k < pos_end; ++k )
+    {
+      const unsigned long i = parameters.st_SampleOrder[ k ].second;
+      this->m_AdvancedTransform->GetNonZeroJacobianIndices(
+        parameters.st_SampleContainer->ElementAt( i ).m_ImageCoordinates, nzji );
+      parameters.st_IsSupportBegin[ k ] = ( k == 0 ) || ( nzji != previousNzji );
+      previousNzji.swap( nzji );
+    }
+  }
+  else if( parameters.st_Step == ComputeSelfHessianPatternStep )
+  {
+    /** The columns of row r are the nonzero Jacobian indices, not smaller
+     * than r, of all supports that contain r. The last row in which a
+     * column was found is marked, to add every column only once.
+     */
+    const NonZeroJacobianIndicesType & supportIndices = parameters.st_SupportIndices;
+    HessianIndexContainerType &        columns        = parameters.st_PatternColumns[ threadId ];
+    HessianIndexContainerType &        rowPointers    = parameters.st_Hessian->GetRowPointers();
+    std::vector< long >                lastRow( this->GetNumberOfParameters(), -1 );
+    columns.clear();
+    for( unsigned long r = pos_begin; r < pos_end; ++r )
+    {
+      const std::size_t rowBegin = columns.size();
+      for( unsigned long q = parameters.st_RowSupportPointers[ r ];
+        q < parameters.st_RowSupportPointers[ r + 1 ]; ++q )
       {
-        /** Add to existing value */
-        ( *rowIt ).second += val;
+        const unsigned long p         = parameters.st_RowSupports[ q ];
+        const unsigned long supportEnd = p - p % n + n;
+        for( unsigned long b = p; b < supportEnd; ++b )
+        {
+          const unsigned long col = supportIndices[ b ];
+          if( lastRow[ col ] != static_cast< long >( r ) )
+          {
+            lastRow[ col ] = r;
+            columns.push_back( static_cast< HessianIndexType >( col ) );
+          }
+        }
+      }
+      std::sort( columns.begin() + rowBegin, columns.end() );
+      rowPointers[ r + 1 ] = static_cast< HessianIndexType >( columns.size() - rowBegin );
+    }
+  }
+  else if( parameters.st_Step == AccumulateSelfHessianStep )
+  {
+    /** Sum the outer products of the samples of a support in a dense block,
+     * only the upper triangular part.
+     */
+    for( unsigned long s = pos_begin; s < pos_end; ++s )
+    {
+      double * block = &parameters.st_Blocks[ ( s - parameters.st_BatchBegin ) * n * n ];
+      std::fill( block, block + n * n, 0.0 );
+      for( unsigned long k = parameters.st_SupportBegins[ s ]; k < parameters.st_SupportBegins[ s + 1 ]; ++k )
+      {
+        const unsigned long         i          = parameters.st_SampleOrder[ k ].second;
+        const FixedImagePointType & fixedPoint = parameters.st_SampleContainer->ElementAt( i ).m_ImageCoordinates;
+
+        /** Compute the inner product of the transform Jacobian dT/dmu and the gradient. */
+        this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+          fixedPoint, parameters.st_Gradients[ i ], imageJacobian, nzji );
+
+        for( unsigned long a = 0; a < n; ++a )
+        {
+          const double imjaca   = imageJacobian[ a ];
+          double *     blockRow = block + a * n;
+          for( unsigned long b = a; b < n; ++b )
+          {
+            blockRow[ b ] += imjaca * imageJacobian[ b ];
+          }
+        }
+      }
+    }
+  }
+  else if( parameters.st_Step == ScatterSelfHessianStep )
+  {
+    /** Add the block rows of the batch to the Hessian rows of this thread.
+     * The columns of a block row are a sorted subset of the Hessian row.
+     */
+    const NonZeroJacobianIndicesType & supportIndices = parameters.st_SupportIndices;
+    const HessianIndexContainerType &  rowPointers    = parameters.st_Hessian->GetRowPointers();
+    const HessianIndexContainerType &  columnIndices  = parameters.st_Hessian->GetColumnIndices();
+    typename CompressedHessianType::ValueContainerType & values = parameters.st_Hessian->GetValues();
+    for( unsigned long s = parameters.st_BatchBegin; s < parameters.st_BatchEnd; ++s )
+    {
+      const unsigned long * indices = &supportIndices[ s * n ];
+      const double *        block   = &parameters.st_Blocks[ ( s - parameters.st_BatchBegin ) * n * n ];
+      for( unsigned long a = 0; a < n; ++a )
+      {
+        const unsigned long r = indices[ a ];
+        if( r < pos_begin || r >= pos_end )
+        {
+          continue;
+        }
+
+        const double * blockRow = block + a * n;
+        HessianIndexType pos = rowPointers[ r ];
+        for( unsigned long b = a; b < n; ++b )
+        {
+          const HessianIndexType col = static_cast< HessianIndexType >( indices[ b ] );
+          while( columnIndices[ pos ] != col )
+          {
+            ++pos;
+          }
+          values[ pos ] += blockRow[ b ];
+        }
       }
     }
   }
 
-  //} // end else
-
-} // end UpdateSelfHessianTerms()
+} // end ThreadedSelfHessianStep()
 
 
 } // end namespace itk
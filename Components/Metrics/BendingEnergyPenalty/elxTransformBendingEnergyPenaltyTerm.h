@@ -39,6 +39,14 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter Metric: Select this metric as follows:\n
  *    <tt>(Metric "TransformBendingEnergyPenalty")</tt>
+ * \parameter UseExactBendingEnergy: For a cubic B-spline transform, compute the
+ *    bending energy and its derivative exactly from the B-spline coefficients,
+ *    instead of estimating it from image samples. This is noise-free and for fine
+ *    grids cheaper than sampling. Other transforms ignore this option, and for a
+ *    combination transform only the B-spline part is penalized. Can be given for
+ *    each resolution. \n
+ *    example: <tt>(UseExactBendingEnergy "true")</tt> \n
+ *    The default is "false".
  *
  * \ingroup Metrics
  *
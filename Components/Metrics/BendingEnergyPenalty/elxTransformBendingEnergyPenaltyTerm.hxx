@@ -62,6 +62,12 @@ TransformBendingEnergyPenalty< TElastix >
     "NumberOfSamplesForSelfHessian", this->GetComponentLabel(), level, 0 );
   this->SetNumberOfSamplesForSelfHessian( numberOfSamplesForSelfHessian );
 
+  /** Compute the bending energy exactly from the B-spline coefficients? */
+  bool useExactBendingEnergy = false;
+  this->GetConfiguration()->ReadParameter( useExactBendingEnergy,
+    "UseExactBendingEnergy", this->GetComponentLabel(), level, 0 );
+  this->SetUseExactBendingEnergy( useExactBendingEnergy );
+
 } // end BeforeEachResolution()
 
 
@@ -21,6 +21,8 @@
 #include "itkTransformPenaltyTerm.h"
 #include "itkImageGridSampler.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -34,6 +36,18 @@ namespace itk
  * [1]. For rigid and affine transformation this energy is always
  * zero.
  *
+ * By default the bending energy is estimated from the spatial Hessians at
+ * the samples of the image sampler. When UseExactBendingEnergy is set and
+ * the (current) transform is a third order B-spline, the energy is instead
+ * evaluated exactly from the coefficient grid. The bending energy of a
+ * B-spline is a quadratic form in its coefficients, whose matrix is a
+ * Kronecker product of banded 1D Gram matrices of the B-spline kernel and
+ * its derivatives. The value and derivative are then obtained by separable
+ * (multi-threaded) stencil passes over the coefficient grid, without a
+ * sampler and without per-sample Hessians. The energy is averaged over the
+ * valid region of the B-spline grid, and only the B-spline part of a
+ * combination transform is penalized.
+ *
  *
  * [1]: D. Rueckert, L. I. Sonoda, C. Hayes, D. L. G. Hill,
  *      M. O. Leach, and D. J. Hawkes, "Nonrigid registration
@@ -160,6 +174,13 @@ public:
   itkSetMacro( NumberOfSamplesForSelfHessian, unsigned int );
   itkGetConstMacro( NumberOfSamplesForSelfHessian, unsigned int );
 
+  /** Use the exact, grid-based bending energy for third order B-spline
+   * transforms, instead of the sampled estimate. Default: false.
+   */
+  itkSetMacro( UseExactBendingEnergy, bool );
+  itkGetConstMacro( UseExactBendingEnergy, bool );
+  itkBooleanMacro( UseExactBendingEnergy );
+
 protected:
 
   /** Typedefs for indices and points. */
@@ -174,6 +195,24 @@ protected:
   /** Typedefs for SelfHessian */
   typedef ImageGridSampler< FixedImageType > SelfHessianSamplerType;
 
+  /** Typedefs for the exact bending energy. */
+  typedef typename BSplineOrder3TransformType::SizeType    BSplineGridSizeType;
+  typedef typename BSplineOrder3TransformType::SpacingType BSplineGridSpacingType;
+
+  /** Returns true, and the B-spline by reference, if the exact bending
+   * energy can be used for the current transform.
+   */
+  virtual bool CheckForExactBendingEnergy( BSplineOrder3TransformPointer & bspline ) const;
+
+  /** Compute the exact bending energy of a third order B-spline from its
+   * coefficients. The derivative is only computed when it is not a null pointer.
+   */
+  virtual void GetExactValueAndDerivative(
+    const BSplineOrder3TransformType * bspline,
+    const ParametersType & parameters,
+    MeasureType & value,
+    DerivativeType * derivative ) const;
+
   /** The constructor. */
   TransformBendingEnergyPenaltyTerm();
 
@@ -187,7 +226,51 @@ private:
   /** The private copy constructor. */
   void operator=( const Self & );                    // purposely not implemented
 
+  /** Compute the banded 1D Gram matrices of the cubic B-spline kernel and
+   * its first and second order derivatives over the valid grid cells.
+   */
+  void InitializeExactBendingEnergy( const BSplineGridSizeType & gridSize ) const;
+
+  /** Apply a 1D Gram matrix along one axis of the coefficient grid. */
+  void ApplyExactStencil( const double * input, double * output,
+    const double * coefficients, DerivativeValueType * derivative,
+    const double weight, const unsigned int axis, const unsigned int order ) const;
+
+  /** Apply the stencil to the lines [ lineBegin, lineEnd [; returns the
+   * contribution to the value if the coefficients are given.
+   */
+  double ApplyExactStencilToLines( const double * input, double * output,
+    const double * coefficients, DerivativeValueType * derivative,
+    const double weight, const unsigned int axis, const unsigned int order,
+    const SizeValueType lineBegin, const SizeValueType lineEnd ) const;
+
+  /** The threader callback for ApplyExactStencil(). */
+  static ITK_THREAD_RETURN_TYPE ApplyExactStencilThreaderCallback( void * arg );
+
+  struct ExactStencilThreaderParameterType
+  {
+    const Self *          st_Metric;
+    const double *        st_Input;
+    double *              st_Output;
+    const double *        st_Coefficients;
+    DerivativeValueType * st_Derivative;
+    double                st_Weight;
+    unsigned int          st_Axis;
+    unsigned int          st_Order;
+    std::vector< double > st_Values;
+  };
+
   unsigned int m_NumberOfSamplesForSelfHessian;
+  bool         m_UseExactBendingEnergy;
+
+  /** Cached Gram matrices, for the orders 0, 1, 2 of each dimension. The
+   * cubic B-spline couples 3 neighbours on each side, so the matrices are
+   * stored row-wise as bands of 7 entries.
+   */
+  mutable BSplineGridSizeType               m_ExactGridSize;
+  mutable std::vector< double >             m_ExactGramMatrices[ FixedImageDimension ][ 3 ];
+  mutable std::vector< double >             m_ExactWorkBuffers[ 2 ];
+  mutable ExactStencilThreaderParameterType m_ExactStencilThreaderParameters;
 
 };
 
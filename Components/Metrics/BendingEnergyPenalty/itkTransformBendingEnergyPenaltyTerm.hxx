@@ -19,6 +19,9 @@
 #define __itkTransformBendingEnergyPenaltyTerm_hxx
 
 #include "itkTransformBendingEnergyPenaltyTerm.h"
+#include "itkBSplineKernelFunction2.h"
+#include "itkBSplineDerivativeKernelFunction2.h"
+#include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -41,6 +44,8 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   this->SetUseImageSampler( true );
 
   this->m_NumberOfSamplesForSelfHessian = 100000;
+  this->m_UseExactBendingEnergy         = false;
+  this->m_ExactGridSize.Fill( 0 );
 
 } // end Constructor
 
@@ -59,6 +64,15 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   RealType           measure = NumericTraits< RealType >::Zero;
   SpatialHessianType spatialHessian;
 
+  /** Compute the exact bending energy from the B-spline coefficients, if requested. */
+  BSplineOrder3TransformPointer bspline;
+  if( this->CheckForExactBendingEnergy( bspline ) )
+  {
+    MeasureType value = NumericTraits< MeasureType >::Zero;
+    this->GetExactValueAndDerivative( bspline.GetPointer(), parameters, value, 0 );
+    return value;
+  }
+
   /** Check if the SpatialHessian is nonzero. */
   if( !this->m_AdvancedTransform->GetHasNonZeroSpatialHessian() )
   {
@@ -173,6 +187,14 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   derivative = DerivativeType( this->GetNumberOfParameters() );
   derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
 
+  /** Compute the exact bending energy from the B-spline coefficients, if requested. */
+  BSplineOrder3TransformPointer bspline;
+  if( this->CheckForExactBendingEnergy( bspline ) )
+  {
+    this->GetExactValueAndDerivative( bspline.GetPointer(), parameters, value, &derivative );
+    return;
+  }
+
   SpatialHessianType           spatialHessian;
   JacobianOfSpatialHessianType jacobianOfSpatialHessian;
   NonZeroJacobianIndicesType   nonZeroJacobianIndices;
@@ -375,6 +397,16 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
       parameters, value, derivative );
   }
 
+  /** Compute the exact bending energy from the B-spline coefficients, if requested. */
+  BSplineOrder3TransformPointer bspline;
+  if( this->CheckForExactBendingEnergy( bspline ) )
+  {
+    derivative = DerivativeType( this->GetNumberOfParameters() );
+    derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    this->GetExactValueAndDerivative( bspline.GetPointer(), parameters, value, &derivative );
+    return;
+  }
+
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
    *   this->GetImageSampler()->Update();
@@ -843,6 +875,358 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 } // end GetSelfHessian()
 
 
+/**
+ * ******************* CheckForExactBendingEnergy *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+bool
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::CheckForExactBendingEnergy( BSplineOrder3TransformPointer & bspline ) const
+{
+  if( !this->m_UseExactBendingEnergy ) { return false; }
+
+  /** The exact bending energy is only implemented for third order B-splines. */
+  this->CheckForBSplineTransform2( bspline );
+  return bspline.IsNotNull();
+
+} // end CheckForExactBendingEnergy()
+
+
+/**
+ * ******************* InitializeExactBendingEnergy *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::InitializeExactBendingEnergy( const BSplineGridSizeType & gridSize ) const
+{
+  /** The Gram matrices only depend on the grid size. */
+  if( gridSize == this->m_ExactGridSize ) { return; }
+
+  typedef BSplineKernelFunction2< 3 >                     KernelType;
+  typedef BSplineDerivativeKernelFunction2< 3 >           DerivativeKernelType;
+  typedef BSplineSecondOrderDerivativeKernelFunction2< 3 > SecondOrderDerivativeKernelType;
+  typename KernelType::Pointer                      kernel  = KernelType::New();
+  typename DerivativeKernelType::Pointer            kernel1 = DerivativeKernelType::New();
+  typename SecondOrderDerivativeKernelType::Pointer kernel2 = SecondOrderDerivativeKernelType::New();
+
+  /** Four point Gauss-Legendre quadrature on [0,1]. Within a grid cell the
+   * product of two (derivatives of) cubic B-splines is a polynomial of
+   * degree at most 6, so this integrates the Gram matrices exactly.
+   */
+  const double nodes[ 4 ] = {
+    0.5 - 0.5 * 0.8611363115940526, 0.5 - 0.5 * 0.3399810435848563,
+    0.5 + 0.5 * 0.3399810435848563, 0.5 + 0.5 * 0.8611363115940526
+  };
+  const double weights[ 4 ] = {
+    0.5 * 0.3478548451374538, 0.5 * 0.6521451548625461,
+    0.5 * 0.6521451548625461, 0.5 * 0.3478548451374538
+  };
+
+  const int radius = 3;
+  const int width  = 7;
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    const int N = static_cast< int >( gridSize[ d ] );
+    for( unsigned int n = 0; n < 3; ++n )
+    {
+      std::vector< double > & G = this->m_ExactGramMatrices[ d ][ n ];
+      G.assign( N * width, 0.0 );
+
+      /** Integrate over the valid cells [ m, m + 1 ], m = 1, ..., N - 3,
+       * on which the coefficients m - 1, ..., m + 2 are nonzero.
+       */
+      for( int m = 1; m + 2 < N; ++m )
+      {
+        for( unsigned int q = 0; q < 4; ++q )
+        {
+          const double u = static_cast< double >( m ) + nodes[ q ];
+          double       values[ 4 ];
+          for( int a = 0; a < 4; ++a )
+          {
+            const double x = u - static_cast< double >( m - 1 + a );
+            if( n == 0 ) { values[ a ] = kernel->Evaluate( x ); }
+            else if( n == 1 ) { values[ a ] = kernel1->Evaluate( x ); }
+            else { values[ a ] = kernel2->Evaluate( x ); }
+          }
+
+          for( int a = 0; a < 4; ++a )
+          {
+            for( int b = 0; b < 4; ++b )
+            {
+              G[ ( m - 1 + a ) * width + ( b - a ) + radius ]
+                += weights[ q ] * values[ a ] * values[ b ];
+            }
+          }
+        }
+      }
+    }
+  }
+
+  this->m_ExactGridSize = gridSize;
+
+} // end InitializeExactBendingEnergy()
+
+
+/**
+ * ******************* GetExactValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::GetExactValueAndDerivative(
+  const BSplineOrder3TransformType * bspline,
+  const ParametersType & parameters,
+  MeasureType & value,
+  DerivativeType * derivative ) const
+{
+  const BSplineGridSizeType    gridSize = bspline->GetGridRegion().GetSize();
+  const BSplineGridSpacingType spacing  = bspline->GetGridSpacing();
+
+  /** Check the grid and the parameters. */
+  SizeValueType numberOfCoefficients = 1;
+  double        numberOfCells        = 1.0;
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    if( gridSize[ d ] < 4 )
+    {
+      itkExceptionMacro( << "The B-spline grid should have at least 4 control points "
+                         << "in each dimension to compute the exact bending energy." );
+    }
+    numberOfCoefficients *= gridSize[ d ];
+    numberOfCells        *= static_cast< double >( gridSize[ d ] - 3 );
+  }
+  if( parameters.GetSize() != FixedImageDimension * numberOfCoefficients )
+  {
+    itkExceptionMacro( << "The number of parameters (" << parameters.GetSize()
+                       << ") does not match the B-spline grid." );
+  }
+
+  this->InitializeExactBendingEnergy( gridSize );
+  this->m_ExactWorkBuffers[ 0 ].resize( numberOfCoefficients );
+  this->m_ExactWorkBuffers[ 1 ].resize( numberOfCoefficients );
+  this->m_NumberOfPixelsCounted = static_cast< SizeValueType >( numberOfCells );
+
+  /** The bending energy of component k is
+   *   \sum_{i,j} \int ( d^2 T_k / dx_i dx_j )^2 dx,
+   * which for every pair (i,j) equals w_ij c_k^T ( \otimes_d G_d ) c_k,
+   * with G_d the Gram matrix of the B-spline derivative of the order
+   * needed along dimension d. The directions of the grid do not change
+   * the Frobenius norm of the Hessian, so only the spacing enters w_ij.
+   */
+  RealType measure = NumericTraits< RealType >::Zero;
+  for( unsigned int k = 0; k < FixedImageDimension; ++k )
+  {
+    const double *        coefficients  = parameters.data_block() + k * numberOfCoefficients;
+    DerivativeValueType * derivativePtr = derivative
+      ? derivative->data_block() + k * numberOfCoefficients : 0;
+
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      for( unsigned int j = i; j < FixedImageDimension; ++j )
+      {
+        unsigned int orders[ FixedImageDimension ];
+        for( unsigned int d = 0; d < FixedImageDimension; ++d )
+        {
+          orders[ d ] = ( d == i ? 1 : 0 ) + ( d == j ? 1 : 0 );
+        }
+        const double weight = ( i == j ? 1.0 : 2.0 )
+          / ( spacing[ i ] * spacing[ i ] * spacing[ j ] * spacing[ j ] );
+
+        /** Apply the Gram matrices dimension by dimension. The last pass
+         * accumulates the value and the derivative instead of storing its output.
+         */
+        const double * input = coefficients;
+        for( unsigned int d = 0; d < FixedImageDimension; ++d )
+        {
+          if( d + 1 < FixedImageDimension )
+          {
+            double * output = &( this->m_ExactWorkBuffers[ d % 2 ][ 0 ] );
+            this->ApplyExactStencil( input, output, 0, 0, 0.0, d, orders[ d ] );
+            input = output;
+          }
+          else
+          {
+            this->ApplyExactStencil( input, 0, coefficients, derivativePtr, weight, d, orders[ d ] );
+            for( std::size_t t = 0; t < this->m_ExactStencilThreaderParameters.st_Values.size(); ++t )
+            {
+              measure += this->m_ExactStencilThreaderParameters.st_Values[ t ];
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /** Average over the valid region of the grid. In grid index units the
+   * cell volume is one; the physical cell volume cancels in the average.
+   */
+  value = static_cast< MeasureType >( measure / numberOfCells );
+  if( derivative )
+  {
+    *derivative /= numberOfCells;
+  }
+
+} // end GetExactValueAndDerivative()
+
+
+/**
+ * ******************* ApplyExactStencil *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ApplyExactStencil( const double * input, double * output,
+  const double * coefficients, DerivativeValueType * derivative,
+  const double weight, const unsigned int axis, const unsigned int order ) const
+{
+  ExactStencilThreaderParameterType & temp = this->m_ExactStencilThreaderParameters;
+  temp.st_Metric       = this;
+  temp.st_Input        = input;
+  temp.st_Output       = output;
+  temp.st_Coefficients = coefficients;
+  temp.st_Derivative   = derivative;
+  temp.st_Weight       = weight;
+  temp.st_Axis         = axis;
+  temp.st_Order        = order;
+
+  SizeValueType numberOfLines = 1;
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    if( d != axis ) { numberOfLines *= this->m_ExactGridSize[ d ]; }
+  }
+
+  if( !this->m_UseMultiThread )
+  {
+    temp.st_Values.assign( 1, 0.0 );
+    temp.st_Values[ 0 ] = this->ApplyExactStencilToLines( input, output,
+      coefficients, derivative, weight, axis, order, 0, numberOfLines );
+    return;
+  }
+
+  temp.st_Values.assign( Self::GetNumberOfThreads(), 0.0 );
+  this->m_Threader->SetSingleMethod( this->ApplyExactStencilThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &temp ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+} // end ApplyExactStencil()
+
+
+/**
+ * ******************* ApplyExactStencilThreaderCallback *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+ITK_THREAD_RETURN_TYPE
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ApplyExactStencilThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
+
+  ExactStencilThreaderParameterType * temp
+    = static_cast< ExactStencilThreaderParameterType * >( infoStruct->UserData );
+
+  /** Distribute the lines along the axis over the threads. */
+  SizeValueType numberOfLines = 1;
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    if( d != temp->st_Axis ) { numberOfLines *= temp->st_Metric->m_ExactGridSize[ d ]; }
+  }
+  const SizeValueType subSize = static_cast< SizeValueType >(
+    std::ceil( static_cast< double >( numberOfLines )
+    / static_cast< double >( nrOfThreads ) ) );
+  SizeValueType lineBegin = threadID * subSize;
+  SizeValueType lineEnd   = ( threadID + 1 ) * subSize;
+  lineBegin = ( lineBegin > numberOfLines ) ? numberOfLines : lineBegin;
+  lineEnd   = ( lineEnd > numberOfLines ) ? numberOfLines : lineEnd;
+
+  const double value = temp->st_Metric->ApplyExactStencilToLines(
+    temp->st_Input, temp->st_Output, temp->st_Coefficients, temp->st_Derivative,
+    temp->st_Weight, temp->st_Axis, temp->st_Order, lineBegin, lineEnd );
+  if( threadID < temp->st_Values.size() )
+  {
+    temp->st_Values[ threadID ] = value;
+  }
+
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end ApplyExactStencilThreaderCallback()
+
+
+/**
+ * ******************* ApplyExactStencilToLines *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+double
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ApplyExactStencilToLines( const double * input, double * output,
+  const double * coefficients, DerivativeValueType * derivative,
+  const double weight, const unsigned int axis, const unsigned int order,
+  const SizeValueType lineBegin, const SizeValueType lineEnd ) const
+{
+  /** The elements of a line along the axis are stride apart. */
+  SizeValueType stride = 1;
+  for( unsigned int d = 0; d < axis; ++d )
+  {
+    stride *= this->m_ExactGridSize[ d ];
+  }
+  const int    N      = static_cast< int >( this->m_ExactGridSize[ axis ] );
+  const int    radius = 3;
+  const int    width  = 7;
+  const double * G    = &( this->m_ExactGramMatrices[ axis ][ order ][ 0 ] );
+
+  double value = 0.0;
+  for( SizeValueType line = lineBegin; line < lineEnd; ++line )
+  {
+    const SizeValueType inner = line % stride;
+    const SizeValueType outer = line / stride;
+    const SizeValueType base  = outer * stride * N + inner;
+
+    for( int c = 0; c < N; ++c )
+    {
+      const int oBegin = ( c - radius < 0 ) ? -c : -radius;
+      const int oEnd   = ( c + radius >= N ) ? N - 1 - c : radius;
+      const double * Grow = G + c * width + radius;
+
+      double sum = 0.0;
+      for( int o = oBegin; o <= oEnd; ++o )
+      {
+        sum += Grow[ o ] * input[ base + ( c + o ) * stride ];
+      }
+
+      const SizeValueType index = base + c * stride;
+      if( coefficients )
+      {
+        value += weight * coefficients[ index ] * sum;
+        if( derivative )
+        {
+          derivative[ index ] += 2.0 * weight * sum;
+        }
+      }
+      else
+      {
+        output[ index ] = sum;
+      }
+    }
+  }
+
+  return value;
+
+} // end ApplyExactStencilToLines()
+
+
+
 } // end namespace itk
 
 #endif // #ifndef __itkTransformBendingEnergyPenaltyTerm_hxx
@@ -23,6 +23,8 @@
 #include "itkPointSet.h"
 #include "itkImage.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -31,6 +33,8 @@ namespace itk
  *  and a fixed point-set.
  *  Correspondence is needed.
  *
+ *  The corresponding points are evaluated in parallel chunks when
+ *  UseMultiThread is on, see SingleValuedPointSetToPointSetMetric.
  *
  * \ingroup RegistrationMetrics
  */
@@ -78,6 +82,10 @@ public:
   typedef vnl_vector< CoordRepType >             VnlVectorType;
 
   typedef typename Superclass::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+  typedef typename Superclass::OutputVectorType           OutputVectorType;
+
+  /** Initialize the metric: copies the corresponding points to contiguous arrays. */
+  void Initialize( void ) override;
 
   /**  Get the value for single valued optimizers. */
   MeasureType GetValue( const TransformParametersType & parameters ) const override;
@@ -95,11 +103,27 @@ protected:
   CorrespondingPointsEuclideanDistancePointMetric();
   ~CorrespondingPointsEuclideanDistancePointMetric() override {}
 
+  /** Compute the distances, and optionally their derivatives, of the points [ begin, end [. */
+  void ThreadedGetValueAndDerivativeOfPoints( const unsigned int begin,
+    const unsigned int end, const ThreadIdType threadId,
+    const bool computeDerivative ) const override;
+
 private:
 
   CorrespondingPointsEuclideanDistancePointMetric( const Self & ); // purposely not implemented
   void operator=( const Self & );                                  // purposely not implemented
 
+  /** Copy the point sets to the contiguous arrays below. */
+  void UpdatePointArrays( void ) const;
+
+  /** Check if the point sets or their point containers changed since the last copy. */
+  bool PointArraysAreOutOfDate( void ) const;
+
+  mutable std::vector< InputPointType >  m_FixedPoints;
+  mutable std::vector< InputPointType >  m_MovingPoints;
+  mutable std::vector< OutputPointType > m_MappedPoints;
+  mutable TimeStamp                      m_PointArraysMTime;
+
 };
 
 } // end namespace itk
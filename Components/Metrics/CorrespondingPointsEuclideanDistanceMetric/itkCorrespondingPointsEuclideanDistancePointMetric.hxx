@@ -19,6 +19,7 @@
 #define __itkCorrespondingPointsEuclideanDistancePointMetric_hxx
 
 #include "itkCorrespondingPointsEuclideanDistancePointMetric.h"
+#include <limits>
 
 namespace itk
 {
@@ -32,6 +33,75 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
 ::CorrespondingPointsEuclideanDistancePointMetric()
 {} // end Constructor
 
+/**
+ * ******************* Initialize *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::Initialize( void )
+{
+  /** Call the initialize of the superclass. */
+  this->Superclass::Initialize();
+
+  this->UpdatePointArrays();
+
+} // end Initialize()
+
+
+/**
+ * ******************* UpdatePointArrays *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::UpdatePointArrays( void ) const
+{
+  const unsigned int numberOfPoints = this->GetFixedPointSet()->GetNumberOfPoints();
+  if( this->GetMovingPointSet()->GetNumberOfPoints() < numberOfPoints )
+  {
+    itkExceptionMacro( << "The moving point set has less points than the fixed point set" );
+  }
+
+  this->m_FixedPoints.resize( numberOfPoints );
+  this->m_MovingPoints.resize( numberOfPoints );
+  this->m_MappedPoints.resize( numberOfPoints );
+
+  PointIterator pointItFixed  = this->GetFixedPointSet()->GetPoints()->Begin();
+  PointIterator pointItMoving = this->GetMovingPointSet()->GetPoints()->Begin();
+  for( unsigned int i = 0; i < numberOfPoints; ++i, ++pointItFixed, ++pointItMoving )
+  {
+    this->m_FixedPoints[ i ]  = pointItFixed.Value();
+    this->m_MovingPoints[ i ] = pointItMoving.Value();
+  }
+  this->m_PointArraysMTime.Modified();
+
+} // end UpdatePointArrays()
+
+
+/**
+ * ******************* PointArraysAreOutOfDate *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+bool
+CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::PointArraysAreOutOfDate( void ) const
+{
+  /** Changing the points through the point container does not modify
+   * the point set itself, so the containers are checked as well.
+   */
+  const ModifiedTimeType arraysMTime = this->m_PointArraysMTime.GetMTime();
+  return this->GetFixedPointSet()->GetMTime() > arraysMTime
+         || this->GetFixedPointSet()->GetPoints()->GetMTime() > arraysMTime
+         || this->GetMovingPointSet()->GetMTime() > arraysMTime
+         || this->GetMovingPointSet()->GetPoints()->GetMTime() > arraysMTime;
+
+} // end PointArraysAreOutOfDate()
+
+
 /**
  * ******************* GetValue *******************
  */
@@ -56,53 +126,17 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
 
   /** Initialize some variables. */
   this->m_NumberOfPointsCounted = 0;
-  MeasureType     measure = NumericTraits< MeasureType >::Zero;
-  InputPointType  movingPoint;
-  OutputPointType fixedPoint, mappedPoint;
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  if( this->PointArraysAreOutOfDate() )
+  {
+    this->UpdatePointArrays();
+  }
 
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
-  /** Create iterators. */
-  PointIterator pointItFixed  = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointItMoving = movingPointSet->GetPoints()->Begin();
-  PointIterator pointEnd      = fixedPointSet->GetPoints()->End();
-
-  /** Loop over the corresponding points. */
-  while( pointItFixed != pointEnd )
-  {
-    /** Get the current corresponding points. */
-    fixedPoint  = pointItFixed.Value();
-    movingPoint = pointItMoving.Value();
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    //bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-    mappedPoint = this->m_Transform->TransformPoint( fixedPoint );
-
-    /** Check if point is inside mask. */
-    bool sampleOk = true;
-    if( sampleOk )
-    {
-      //sampleOk = this->IsInsideMovingMask( mappedPoint );
-      if( this->m_MovingImageMask.IsNotNull() )
-      {
-        sampleOk = this->m_MovingImageMask->IsInside( mappedPoint );
-      }
-    }
-
-    if( sampleOk )
-    {
-      this->m_NumberOfPointsCounted++;
-
-      VnlVectorType diffPoint = ( movingPoint - mappedPoint ).GetVnlVector();
-      measure += diffPoint.magnitude();
-
-    } // end if sampleOk
-
-    ++pointItFixed;
-    ++pointItMoving;
-
-  } // end loop over all corresponding points
+  /** Loop over the corresponding points, possibly multi-threaded. */
+  this->LaunchGetValueAndDerivativeOfPoints( this->m_FixedPoints.size(), measure, NULL );
 
   return measure / this->m_NumberOfPointsCounted;
 
@@ -158,12 +192,10 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
   MeasureType measure = NumericTraits< MeasureType >::Zero;
   derivative = DerivativeType( this->GetNumberOfParameters() );
   derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
-  NonZeroJacobianIndicesType nzji(
-  this->m_Transform->GetNumberOfNonZeroJacobianIndices() );
-  TransformJacobianType jacobian;
-
-  InputPointType  movingPoint;
-  OutputPointType fixedPoint, mappedPoint;
+  if( this->PointArraysAreOutOfDate() )
+  {
+    this->UpdatePointArrays();
+  }
 
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
@@ -180,72 +212,8 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
    */
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
-  /** Create iterators. */
-  PointIterator pointItFixed  = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointItMoving = movingPointSet->GetPoints()->Begin();
-  PointIterator pointEnd      = fixedPointSet->GetPoints()->End();
-
-  /** Loop over the corresponding points. */
-  while( pointItFixed != pointEnd )
-  {
-    /** Get the current corresponding points. */
-    fixedPoint  = pointItFixed.Value();
-    movingPoint = pointItMoving.Value();
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    //bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-    mappedPoint = this->m_Transform->TransformPoint( fixedPoint );
-
-    /** Check if point is inside mask. */
-    bool sampleOk = true;
-    if( sampleOk )
-    {
-      //sampleOk = this->IsInsideMovingMask( mappedPoint );
-      if( this->m_MovingImageMask.IsNotNull() )
-      {
-        sampleOk = this->m_MovingImageMask->IsInside( mappedPoint );
-      }
-    }
-
-    if( sampleOk )
-    {
-      this->m_NumberOfPointsCounted++;
-
-      /** Get the TransformJacobian dT/dmu. */
-      //this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-      this->m_Transform->GetJacobian( fixedPoint, jacobian, nzji );
-
-      VnlVectorType diffPoint = ( movingPoint - mappedPoint ).GetVnlVector();
-      MeasureType   distance  = diffPoint.magnitude();
-      measure += distance;
-
-      /** Calculate the contributions to the derivatives with respect to each parameter. */
-      if( distance > std::numeric_limits< MeasureType >::epsilon() )
-      {
-        VnlVectorType diff_2 = diffPoint / distance;
-        if( nzji.size() == this->GetNumberOfParameters() )
-        {
-          /** Loop over all Jacobians. */
-          derivative -= diff_2 * jacobian;
-        }
-        else
-        {
-          /** Only pick the nonzero Jacobians. */
-          for( unsigned int i = 0; i < nzji.size(); ++i )
-          {
-            const unsigned int index  = nzji[ i ];
-            VnlVectorType      column = jacobian.get_column( i );
-            derivative[ index ] -= dot_product( diff_2, column );
-          }
-        }
-      } // end if distance != 0
-
-    } // end if sampleOk
-
-    ++pointItFixed;
-    ++pointItMoving;
-
-  } // end loop over all corresponding points
+  /** Loop over the corresponding points, possibly multi-threaded. */
+  this->LaunchGetValueAndDerivativeOfPoints( this->m_FixedPoints.size(), measure, &derivative );
 
   /** Check if enough samples were valid. */
 //   this->CheckNumberOfSamples(
@@ -262,6 +230,70 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
 } // end GetValueAndDerivative()
 
 
+/**
+ * ******************* ThreadedGetValueAndDerivativeOfPoints *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::ThreadedGetValueAndDerivativeOfPoints( const unsigned int begin,
+  const unsigned int end, const ThreadIdType threadId,
+  const bool computeDerivative ) const
+{
+  if( begin >= end )
+  {
+    return;
+  }
+
+  /** Initialize some variables. */
+  MeasureType                measure               = NumericTraits< MeasureType >::Zero;
+  SizeValueType              numberOfPointsCounted = NumericTraits< SizeValueType >::Zero;
+  NonZeroJacobianIndicesType nzji;
+  TransformJacobianType      jacobian;
+  if( computeDerivative )
+  {
+    nzji.resize( this->m_Transform->GetNumberOfNonZeroJacobianIndices() );
+  }
+
+  /** Transform this chunk of points at once. */
+  this->TransformPoints( &this->m_FixedPoints[ begin ], &this->m_MappedPoints[ begin ], end - begin );
+
+  /** Loop over the corresponding points. */
+  for( unsigned int i = begin; i < end; ++i )
+  {
+    const OutputPointType & mappedPoint = this->m_MappedPoints[ i ];
+
+    /** Check if point is inside mask. */
+    if( this->m_MovingImageMask.IsNotNull()
+      && !this->m_MovingImageMask->IsInside( mappedPoint ) )
+    {
+      continue;
+    }
+
+    ++numberOfPointsCounted;
+
+    const OutputVectorType diffPoint = this->m_MovingPoints[ i ] - mappedPoint;
+    const MeasureType      distance  = diffPoint.GetNorm();
+    measure += distance;
+
+    /** Calculate the contributions to the derivatives with respect to each parameter. */
+    if( computeDerivative && distance > std::numeric_limits< MeasureType >::epsilon() )
+    {
+      /** Get the TransformJacobian dT/dmu. */
+      this->m_Transform->GetJacobian( this->m_FixedPoints[ i ], jacobian, nzji );
+      this->AccumulateDerivativeOfPoint( threadId, jacobian, nzji, diffPoint * ( -1.0 / distance ) );
+    }
+
+  } // end loop over the corresponding points
+
+  /** Store the results of this thread. */
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value                 += measure;
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPointsCounted += numberOfPointsCounted;
+
+} // end ThreadedGetValueAndDerivativeOfPoints()
+
+
 } // end namespace itk
 
 #endif // end #ifndef __itkCorrespondingPointsEuclideanDistancePointMetric_hxx
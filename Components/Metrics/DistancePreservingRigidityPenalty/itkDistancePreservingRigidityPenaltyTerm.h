@@ -33,6 +33,8 @@
 #include "itkImageRegionIterator.h"
 #include "itkMultiResolutionPyramidImageFilter.h"
 
+#include <vector>
+
 namespace itk
 {
 /**
@@ -63,6 +65,14 @@ namespace itk
  *  resolutions.
  *  - In the publication above, the grid spacing was set as [4, 4, 1].
  *
+ * The pairs of neighbouring penalty grid points within the same rigid
+ * region, and the B-spline weights of these points, are computed once per
+ * resolution in Initialize(). They are stored in a compressed sparse row
+ * structure, so that the evaluation only visits the rigid points. Each
+ * point is transformed once per evaluation, and with multi-threading
+ * enabled both the point transformation and the pair loop are threaded,
+ * with per-thread accumulation of the sparse derivative.
+ *
  * \author Jihun Kim, University of Michigan, Ann Arbor
  * \author Martha M. Matuszak, University of Michigan, Ann Arbor
  * \author Kazuhiro Saitou, University of Michigan, Ann Arbor
@@ -126,6 +136,7 @@ public:
   typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
   typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
   typedef typename Superclass::ScalarType                   ScalarType;
+  typedef typename Superclass::ThreadInfoType               ThreadInfoType;
 
   /** Typedefs from the AdvancedTransform. */
   typedef typename Superclass::SpatialJacobianType           SpatialJacobianType;
@@ -160,6 +171,19 @@ public:
   /** The GetValueAndDerivative()-method returns the rigid penalty value and its derivative. */
   void GetValueAndDerivative( const ParametersType & parameters, MeasureType & value, DerivativeType & derivative ) const override;
 
+  /** Get the value for the penalty points assigned to each thread. */
+  inline void ThreadedGetValue( ThreadIdType threadID ) override;
+
+  /** Gather the values from all threads. */
+  inline void AfterThreadedGetValue( MeasureType & value ) const override;
+
+  /** Get the value and derivative for the penalty points assigned to each thread. */
+  inline void ThreadedGetValueAndDerivative( ThreadIdType threadID ) override;
+
+  /** Gather the values and derivatives from all threads. */
+  inline void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const override;
+
   /** Set the B-spline transform in this class.
    * This class expects a BSplineTransform! It is not suited for others.
    */
@@ -205,6 +229,38 @@ protected:
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Typedef for the multi-threading parameters. */
+  typedef typename Superclass::MultiThreaderParameterType MultiThreaderParameterType;
+
+  /** Typedefs for the precomputed neighbour pairs. */
+  typedef typename PenaltyGridImageType::PointType PenaltyPointType;
+  typedef std::vector< PenaltyPointType >          PenaltyPointContainerType;
+  typedef std::vector< OutputPointType >           MappedPointContainerType;
+
+  /** Collect the rigid penalty grid points, their neighbours within the same
+   * rigid region and their B-spline weights. Called by Initialize().
+   */
+  virtual void InitializeNeighborPairs( void );
+
+  /** Transform the penalty points in the range [ begin, end [. */
+  void TransformPenaltyPoints( const SizeValueType begin, const SizeValueType end ) const;
+
+  /** Compute the penalty term for the points in the range [ begin, end [.
+   * The derivative is only updated when it is not a null pointer.
+   */
+  MeasureType ComputePenaltyOfPoints( const SizeValueType begin,
+    const SizeValueType end, DerivativeType * derivative ) const;
+
+  /** Transform all penalty points, possibly multi-threaded. */
+  void LaunchTransformPenaltyPoints( void ) const;
+
+  /** The threader callback for transforming the penalty points. */
+  static ITK_THREAD_RETURN_TYPE TransformPenaltyPointsThreaderCallback( void * arg );
+
+  /** Get the range of penalty points assigned to a thread. */
+  void GetPenaltyPointRange( const ThreadIdType threadID, const ThreadIdType numberOfThreads,
+    SizeValueType & begin, SizeValueType & end ) const;
+
 private:
 
   /** The private constructor. */
@@ -225,6 +281,30 @@ private:
 
   unsigned int m_NumberOfRigidGrids;
 
+  /** The rigid penalty points that have at least one neighbour in the same
+   * rigid region, and the weight of their row in the penalty term.
+   */
+  PenaltyPointContainerType m_PenaltyPoints;
+  std::vector< double >     m_PenaltyPointWeights;
+
+  /** The neighbours of point p are m_NeighborIndices[ m_NeighborOffsets[ p ] ]
+   * up to m_NeighborIndices[ m_NeighborOffsets[ p + 1 ] ], with the squared
+   * distances in the fixed image stored in the same layout.
+   */
+  std::vector< SizeValueType > m_NeighborOffsets;
+  std::vector< unsigned int >  m_NeighborIndices;
+  std::vector< double >        m_NeighborSquaredDistances;
+
+  /** The B-spline weights and the parameter indices (of the first dimension)
+   * of each penalty point, m_NumberOfWeights consecutive entries per point.
+   */
+  unsigned int                 m_NumberOfWeights;
+  std::vector< double >        m_BSplineWeights;
+  std::vector< SizeValueType > m_BSplineParameterIndices;
+
+  /** The transformed penalty points, updated at each evaluation. */
+  mutable MappedPointContainerType m_MappedPoints;
+
 };
 
 // end class DistancePreservingRigidityPenaltyTerm
@@ -120,14 +120,23 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
   this->m_PenaltyGridImage->SetDirection( sampledSegmentedImageDirection );
   this->m_PenaltyGridImage->Update();
 
-  /** compute number of knots in rigid regions */
-  this->m_NumberOfRigidGrids = 0;
+  /** Collect the rigid points and their neighbours. */
+  this->InitializeNeighborPairs();
 
-  typedef itk::ImageRegionIterator< PenaltyGridImageType > PenaltyGridIteratorType;
-  PenaltyGridIteratorType ki( this->m_PenaltyGridImage, this->m_PenaltyGridImage->GetBufferedRegion() );
+} // end Initialize()
 
-  typename PenaltyGridImageType::IndexType penaltyGridIndex;
-  typename PenaltyGridImageType::PointType penaltyGridPoint;
+
+/**
+ * *********************** InitializeNeighborPairs *****************************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::InitializeNeighborPairs( void )
+{
+  const PenaltyGridImageRegionType penaltyGridImageRegion = this->m_PenaltyGridImage->GetBufferedRegion();
+  const SizeValueType              numberOfGridPoints     = penaltyGridImageRegion.GetNumberOfPixels();
 
   //typedef itk::LinearInterpolateImageFunction< SegmentedImageType, double > SegmentedImageInterpolatorType;
   typedef itk::NearestNeighborInterpolateImageFunction< SegmentedImageType, double > SegmentedImageInterpolatorType;
@@ -135,141 +144,245 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
 
   segmentedImageInterpolator->SetInputImage( this->m_SampledSegmentedImage );
 
-  unsigned int PixelValue;
+  /** Look up the rigidity index of all penalty grid points once, and
+   * compute the number of knots in rigid regions.
+   */
+  typedef itk::ImageRegionConstIteratorWithIndex< PenaltyGridImageType > PenaltyGridIteratorType;
+  PenaltyGridIteratorType pgi( this->m_PenaltyGridImage, penaltyGridImageRegion );
 
-  ki.GoToBegin();
+  typename PenaltyGridImageType::IndexType penaltyGridIndex, neighborPenaltyGridIndex;
+  PenaltyPointType                         penaltyGridPoint, neighborPenaltyGridPoint;
 
-  while( !ki.IsAtEnd() )
+  std::vector< unsigned int > pixelValues( numberOfGridPoints );
+  this->m_NumberOfRigidGrids = 0;
+  SizeValueType i = 0;
+  for( pgi.GoToBegin(); !pgi.IsAtEnd(); ++pgi, ++i )
   {
-    penaltyGridIndex = ki.GetIndex();
-
-    this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( penaltyGridIndex, penaltyGridPoint );
+    this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( pgi.GetIndex(), penaltyGridPoint );
+    pixelValues[ i ] = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( penaltyGridPoint ) );
 
-    PixelValue =  static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( penaltyGridPoint ) );
-
-    if( PixelValue > 0 )
+    if( pixelValues[ i ] > 0 )
     {
       this->m_NumberOfRigidGrids++;
     }
-    ++ki;
   }
-} // end Initialize()
 
+  /** The offsets of the 3^D - 1 direct neighbours. */
+  std::vector< typename PenaltyGridImageType::OffsetType > neighborOffsets;
+  unsigned int numberOfNeighborhood = 1;
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    numberOfNeighborhood *= 3;
+  }
+  for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
+  {
+    typename PenaltyGridImageType::OffsetType offset;
+    unsigned int rest   = kk;
+    bool         isZero = true;
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      offset[ d ] = static_cast< OffsetValueType >( rest % 3 ) - 1;
+      rest       /= 3;
+      isZero      = isZero && offset[ d ] == 0;
+    }
+    if( !isZero )
+    {
+      neighborOffsets.push_back( offset );
+    }
+  }
 
-/**
- * *********************** GetValue *****************************
- */
+  /** A rigid point contributes to the penalty term if at least one of its
+   * neighbours belongs to the same rigid region. Since this relation is
+   * symmetric, all neighbours of such a point are penalty points as well.
+   * Neighbours outside the penalty grid are not considered.
+   */
+  const unsigned int invalidPoint = NumericTraits< unsigned int >::max();
+  std::vector< unsigned int > pointIds( numberOfGridPoints, invalidPoint );
+
+  this->m_PenaltyPoints.clear();
+  this->m_PenaltyPointWeights.clear();
+  for( pgi.GoToBegin(), i = 0; !pgi.IsAtEnd(); ++pgi, ++i )
+  {
+    const unsigned int pixelValue = pixelValues[ i ];
+    if( pixelValue == 0 || pixelValue >= 6 ) { continue; }
 
-template< class TFixedImage, class TScalarType >
-typename DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >::MeasureType
-DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
-::GetValue( const ParametersType & parameters ) const
-{
-  /** Set output values to zero. */
-  this->m_RigidityPenaltyTermValue = NumericTraits< MeasureType >::Zero;
+    penaltyGridIndex = pgi.GetIndex();
+    unsigned int numberOfRigidGridsNeighbor = 1; // the point itself
+    for( std::size_t kk = 0; kk < neighborOffsets.size(); ++kk )
+    {
+      neighborPenaltyGridIndex = penaltyGridIndex + neighborOffsets[ kk ];
+      if( penaltyGridImageRegion.IsInside( neighborPenaltyGridIndex )
+        && pixelValues[ this->m_PenaltyGridImage->ComputeOffset( neighborPenaltyGridIndex ) ] == pixelValue )
+      {
+        numberOfRigidGridsNeighbor++;
+      }
+    }
 
-  //this->SetTransformParameters( parameters );
-  this->m_BSplineTransform->SetParameters( parameters );
+    if( numberOfRigidGridsNeighbor > 1 )
+    {
+      this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( penaltyGridIndex, penaltyGridPoint );
+      pointIds[ i ] = static_cast< unsigned int >( this->m_PenaltyPoints.size() );
+      this->m_PenaltyPoints.push_back( penaltyGridPoint );
+      this->m_PenaltyPointWeights.push_back( 1.0 / numberOfRigidGridsNeighbor / this->m_NumberOfRigidGrids );
+    }
+  }
 
-  /** distance-preserving penalty computation */
-  MeasureType penaltyTerm       = 0.0;
-  MeasureType penaltyTermBuffer = 0.0;
+  /** Store the neighbours in compressed sparse row format. */
+  const SizeValueType numberOfPenaltyPoints = this->m_PenaltyPoints.size();
+  this->m_NeighborOffsets.assign( 1, 0 );
+  this->m_NeighborOffsets.reserve( numberOfPenaltyPoints + 1 );
+  this->m_NeighborIndices.clear();
+  this->m_NeighborSquaredDistances.clear();
+  for( pgi.GoToBegin(), i = 0; !pgi.IsAtEnd(); ++pgi, ++i )
+  {
+    const unsigned int pointId = pointIds[ i ];
+    if( pointId == invalidPoint ) { continue; }
 
-  MeasureType dx = 0.0;
-  MeasureType dX = 0.0;
+    penaltyGridIndex = pgi.GetIndex();
+    const PenaltyPointType & point = this->m_PenaltyPoints[ pointId ];
+    for( std::size_t kk = 0; kk < neighborOffsets.size(); ++kk )
+    {
+      neighborPenaltyGridIndex = penaltyGridIndex + neighborOffsets[ kk ];
+      if( !penaltyGridImageRegion.IsInside( neighborPenaltyGridIndex ) ) { continue; }
 
-  typedef itk::ImageRegionConstIteratorWithIndex< PenaltyGridImageType > PenaltyGridIteratorType;
-  PenaltyGridImageRegionType penaltyGridImageRegion = this->m_PenaltyGridImage->GetBufferedRegion();
+      const SizeValueType neighborOffset = this->m_PenaltyGridImage->ComputeOffset( neighborPenaltyGridIndex );
+      if( pixelValues[ neighborOffset ] == pixelValues[ i ] )
+      {
+        const unsigned int neighborId = pointIds[ neighborOffset ];
+        this->m_NeighborIndices.push_back( neighborId );
+        this->m_NeighborSquaredDistances.push_back(
+          point.SquaredEuclideanDistanceTo( this->m_PenaltyPoints[ neighborId ] ) );
+      }
+    }
+    this->m_NeighborOffsets.push_back( this->m_NeighborIndices.size() );
+  }
 
-  PenaltyGridIteratorType pgi( this->m_PenaltyGridImage, penaltyGridImageRegion );
+  /** Precompute the B-spline weights of the penalty points. */
+  typedef itk::BSplineKernelFunction< 3 > BSplineKernelFunctionType;
+  BSplineKernelFunctionType::Pointer bSplineKernel = BSplineKernelFunctionType::New();
 
-  typename PenaltyGridImageType::IndexType penaltyGridIndex, neighborPenaltyGridIndex;
-  typename PenaltyGridImageType::PointType penaltyGridPoint, neighborPenaltyGridPoint, xn, xf;
+  typedef itk::BSplineInterpolationWeightFunction< double, ImageDimension, 3 > WeightsFunctionType;
+  typedef typename WeightsFunctionType::ContinuousIndexType                    ContinuousIndexType;
 
-  typedef itk::ConstNeighborhoodIterator< PenaltyGridImageType > NeighborhoodIteratorType;
-  typename NeighborhoodIteratorType::RadiusType radius;
-  radius.Fill( 1 );
-  NeighborhoodIteratorType ni( radius, this->m_PenaltyGridImage, penaltyGridImageRegion );
-  unsigned int             numberOfNeighborhood = ni.Size();
+  const typename BSplineKnotImageType::SizeType bSplineKnotImageSize
+    = this->m_BSplineKnotImage->GetBufferedRegion().GetSize();
 
-  unsigned int numberOfRigidGridsNeighbor;
+  this->m_NumberOfWeights = 1;
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    this->m_NumberOfWeights *= 4;
+  }
+  this->m_BSplineWeights.resize( numberOfPenaltyPoints * this->m_NumberOfWeights );
+  this->m_BSplineParameterIndices.resize( numberOfPenaltyPoints * this->m_NumberOfWeights );
 
-  // interpolation of segmented image
-  typedef itk::NearestNeighborInterpolateImageFunction< SegmentedImageType, double > SegmentedImageInterpolatorType;
-  typename SegmentedImageInterpolatorType::Pointer segmentedImageInterpolator = SegmentedImageInterpolatorType::New();
+  ContinuousIndexType tindex;
+  long                ntindex_start[ ImageDimension ];
+  for( SizeValueType p = 0; p < numberOfPenaltyPoints; ++p )
+  {
+    this->m_BSplineKnotImage->TransformPhysicalPointToContinuousIndex( this->m_PenaltyPoints[ p ], tindex );
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      ntindex_start[ d ] = static_cast< long >( std::floor( tindex[ d ] ) ) - 1;
+    }
 
-  segmentedImageInterpolator->SetInputImage( this->m_SampledSegmentedImage );
+    for( unsigned int mu = 0; mu < this->m_NumberOfWeights; ++mu )
+    {
+      double        du_dC  = 1.0;
+      SizeValueType par    = 0;
+      SizeValueType stride = 1;
+      unsigned int  rest   = mu;
+      for( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+        const long m = ntindex_start[ d ] + static_cast< long >( rest % 4 );
+        rest  /= 4;
+        du_dC *= bSplineKernel->Evaluate( tindex[ d ] - static_cast< double >( m ) );
+        par   += static_cast< SizeValueType >( m ) * stride;
+        stride *= bSplineKnotImageSize[ d ];
+      }
+      this->m_BSplineWeights[ p * this->m_NumberOfWeights + mu ]          = du_dC;
+      this->m_BSplineParameterIndices[ p * this->m_NumberOfWeights + mu ] = par;
+    }
+  }
 
-  unsigned int pixelValue, pixelValueNeighbor;
+  this->m_MappedPoints.resize( numberOfPenaltyPoints );
 
-  /** Penalty term computation */
-  if( MovingImageDimension == 3 )
-  {
-    for( pgi.GoToBegin(), ni.GoToBegin(); !pgi.IsAtEnd(); ++pgi, ++ni )
-    {
-      penaltyGridIndex = pgi.GetIndex();
+} // end InitializeNeighborPairs()
 
-      this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( penaltyGridIndex, penaltyGridPoint );
 
-      ni.SetLocation( penaltyGridIndex );
+/**
+ * *********************** GetValue *****************************
+ */
 
-      pixelValue = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( penaltyGridPoint ) );
+template< class TFixedImage, class TScalarType >
+typename DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >::MeasureType
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::GetValue( const ParametersType & parameters ) const
+{
+  /** Set output values to zero. */
+  this->m_RigidityPenaltyTermValue = NumericTraits< MeasureType >::Zero;
 
-      if( pixelValue > 0 && pixelValue < 6 )
-      {
-        numberOfRigidGridsNeighbor = 0;
+  //this->SetTransformParameters( parameters );
+  this->m_BSplineTransform->SetParameters( parameters );
 
-        for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
-        {
-          neighborPenaltyGridIndex = ni.GetIndex( kk );
+  /** Transform all penalty points once. */
+  this->LaunchTransformPenaltyPoints();
 
-          this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( neighborPenaltyGridIndex, neighborPenaltyGridPoint );
+  /** Distance-preserving penalty computation. */
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  if( !this->m_UseMultiThread )
+  {
+    value = this->ComputePenaltyOfPoints( 0, this->m_PenaltyPoints.size(), 0 );
+  }
+  else
+  {
+    this->LaunchGetValueThreaderCallback();
+    this->AfterThreadedGetValue( value );
+  }
 
-          pixelValueNeighbor = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( neighborPenaltyGridPoint ) );
+  /** Return the rigidity penalty term value. */
+  this->m_RigidityPenaltyTermValue = value;
+  return value;
 
-          if( pixelValue == pixelValueNeighbor )
-          {
-            numberOfRigidGridsNeighbor++;
-          }
-        }
+} // end GetValue()
 
-        if( numberOfRigidGridsNeighbor > 1 )
-        {
-          for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
-          {
-            neighborPenaltyGridIndex = ni.GetIndex( kk );
 
-            this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( neighborPenaltyGridIndex, neighborPenaltyGridPoint );
+/**
+ * *********************** ThreadedGetValue *****************************
+ */
 
-            pixelValueNeighbor = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( neighborPenaltyGridPoint ) );
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ThreadedGetValue( ThreadIdType threadId )
+{
+  SizeValueType pos_begin, pos_end;
+  this->GetPenaltyPointRange( threadId, Self::GetNumberOfThreads(), pos_begin, pos_end );
 
-            if( pixelValue == pixelValueNeighbor )
-            {
-              xn = this->m_Transform->TransformPoint( neighborPenaltyGridPoint );
-              xf = this->m_Transform->TransformPoint( penaltyGridPoint );
+  this->m_GetValuePerThreadVariables[ threadId ].st_Value
+    = this->ComputePenaltyOfPoints( pos_begin, pos_end, 0 );
 
-              dX = ( neighborPenaltyGridPoint[ 0 ] - penaltyGridPoint[ 0 ] ) * ( neighborPenaltyGridPoint[ 0 ] - penaltyGridPoint[ 0 ] )
-                + ( neighborPenaltyGridPoint[ 1 ] - penaltyGridPoint[ 1 ] ) * ( neighborPenaltyGridPoint[ 1 ] - penaltyGridPoint[ 1 ] )
-                + ( neighborPenaltyGridPoint[ 2 ] - penaltyGridPoint[ 2 ] ) * ( neighborPenaltyGridPoint[ 2 ] - penaltyGridPoint[ 2 ] );
+} // end ThreadedGetValue()
 
-              dx = ( xn[ 0 ] - xf[ 0 ] ) * ( xn[ 0 ] - xf[ 0 ] )
-                + ( xn[ 1 ] - xf[ 1 ] ) * ( xn[ 1 ] - xf[ 1 ] )
-                + ( xn[ 2 ] - xf[ 2 ] ) * ( xn[ 2 ] - xf[ 2 ] );
 
-              penaltyTermBuffer = ( dx - dX ) * ( dx - dX );
+/**
+ * *********************** AfterThreadedGetValue *****************************
+ */
 
-              penaltyTerm += penaltyTermBuffer / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-            }
-          } // end for
-        } // end if
-      }     // end if
-    }       // end for
-  }         // end if ( dimension = 3 )
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::AfterThreadedGetValue( MeasureType & value ) const
+{
+  value = NumericTraits< MeasureType >::Zero;
+  for( ThreadIdType i = 0; i < Self::GetNumberOfThreads(); ++i )
+  {
+    value += this->m_GetValuePerThreadVariables[ i ].st_Value;
 
-  /** Return the rigidity penalty term value. */
-  return penaltyTerm;
+    /** Reset this variable for the next iteration. */
+    this->m_GetValuePerThreadVariables[ i ].st_Value = NumericTraits< MeasureType >::Zero;
+  }
 
-} // end GetValue()
+} // end AfterThreadedGetValue()
 
 
 /**
@@ -307,188 +420,236 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
 
   this->m_BSplineTransform->SetParameters( parameters );
 
-  /** Distance-preserving penalty */
-  MeasureType penaltyTermBuffer   = 0.0;
-  MeasureType derivativeTermTemp1 = 0.0, derivativeTermTemp2 = 0.0, derivativeTermTemp3 = 0.0;
+  /** Transform all penalty points once. */
+  this->LaunchTransformPenaltyPoints();
 
-  unsigned int par1, par2;
+  /** Distance-preserving penalty and its derivative. */
+  if( !this->m_UseMultiThread )
+  {
+    value = this->ComputePenaltyOfPoints( 0, this->m_PenaltyPoints.size(), &derivative );
+  }
+  else
+  {
+    this->LaunchGetValueAndDerivativeThreaderCallback();
+    this->AfterThreadedGetValueAndDerivative( value, derivative );
+  }
 
-  MeasureType dX = 0.0;
-  MeasureType dx = 0.0;
+  this->m_RigidityPenaltyTermValue = value;
 
-  typename PenaltyGridImageType::IndexType penaltyGridIndex, neighborPenaltyGridIndex;
-  typename PenaltyGridImageType::PointType penaltyGridPoint, neighborPenaltyGridPoint, xn, xf;
+} // end GetValueAndDerivative()
 
-  typedef itk::BSplineKernelFunction< 3 > BSplineKernelFunctionType;
-  BSplineKernelFunctionType::Pointer bSplineKernel = BSplineKernelFunctionType::New();
 
-  typedef itk::BSplineInterpolationWeightFunction< double, ImageDimension, 3 > WeightsFunctionType;
-  typedef typename WeightsFunctionType::ContinuousIndexType                    ContinuousIndexType;
-  typedef double                                                               ContinuousIndexValueType;
+/**
+ * *********************** ThreadedGetValueAndDerivative ****************
+ */
 
-  ContinuousIndexType      tindex;
-  ContinuousIndexValueType tx, ty, tz;
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ThreadedGetValueAndDerivative( ThreadIdType threadId )
+{
+  SizeValueType pos_begin, pos_end;
+  this->GetPenaltyPointRange( threadId, Self::GetNumberOfThreads(), pos_begin, pos_end );
 
-  ContinuousIndexValueType m, n, p, neighbor_m, neighbor_n, neighbor_p;
+  /** Get a handle to the pre-allocated derivative for the current thread.
+   * The initialization is performed at the beginning of each resolution in
+   * InitializeThreadingParameters(), and at the end of each iteration in
+   * AfterThreadedGetValueAndDerivative() and the accumulate functions.
+   */
+  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
 
-  typedef itk::ImageRegionConstIteratorWithIndex< PenaltyGridImageType > PenaltyGridIteratorType;
-  PenaltyGridImageRegionType penaltyGridImageRegion = this->m_PenaltyGridImage->GetBufferedRegion();
-  PenaltyGridIteratorType    pgi( this->m_PenaltyGridImage, penaltyGridImageRegion );
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value
+    = this->ComputePenaltyOfPoints( pos_begin, pos_end, &derivative );
 
-  // neighborhood iterator
-  typedef itk::ConstNeighborhoodIterator< PenaltyGridImageType > NeighborhoodIteratorType;
-  typename NeighborhoodIteratorType::RadiusType radius;
-  radius.Fill( 1 );
-  NeighborhoodIteratorType ni( radius, this->m_PenaltyGridImage, penaltyGridImageRegion );
-  unsigned int             numberOfNeighborhood = ni.Size();
+} // end ThreadedGetValueAndDerivative()
 
-  ContinuousIndexType      tindex_neighbor, ntindex_start, ntindex_neighbor_start;
-  ContinuousIndexValueType tx_neighbor, ty_neighbor, tz_neighbor;
 
-  typename BSplineKnotImageType::SizeType bSplineKnotImageSize = this->m_BSplineKnotImage->GetBufferedRegion().GetSize();
+/**
+ * *********************** AfterThreadedGetValueAndDerivative ****************
+ */
 
-  MeasureType du_dC, du_dC_neighbor;
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Accumulate the values. */
+  value = NumericTraits< MeasureType >::Zero;
+  for( ThreadIdType i = 0; i < Self::GetNumberOfThreads(); ++i )
+  {
+    value += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
 
-  unsigned int numberOfRigidGridsNeighbor;
+    /** Reset this variable for the next iteration. */
+    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value = NumericTraits< MeasureType >::Zero;
+  }
 
-  const unsigned int parametersDimension            = this->GetNumberOfParameters();
-  unsigned int       numberOfParametersPerDimension = parametersDimension / ImageDimension;
+  /** Accumulate the derivatives multi-threadedly; the weights are already included. */
+  this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor = 1.0;
 
-  // interpolation of segmented image
-  typedef itk::NearestNeighborInterpolateImageFunction< SegmentedImageType, double > SegmentedImageInterpolatorType;
-  typename SegmentedImageInterpolatorType::Pointer segmentedImageInterpolator = SegmentedImageInterpolatorType::New();
+  this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+} // end AfterThreadedGetValueAndDerivative()
 
-  segmentedImageInterpolator->SetInputImage( this->m_SampledSegmentedImage );
 
-  unsigned int pixelValue, pixelValueNeighbor;
+/**
+ * *********************** GetPenaltyPointRange ****************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::GetPenaltyPointRange( const ThreadIdType threadId, const ThreadIdType numberOfThreads,
+  SizeValueType & pos_begin, SizeValueType & pos_end ) const
+{
+  const SizeValueType numberOfPenaltyPoints = this->m_PenaltyPoints.size();
+  const SizeValueType nrOfPointsPerThreads
+    = static_cast< SizeValueType >( std::ceil( static_cast< double >( numberOfPenaltyPoints )
+    / static_cast< double >( numberOfThreads ) ) );
+
+  pos_begin = nrOfPointsPerThreads * threadId;
+  pos_end   = nrOfPointsPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > numberOfPenaltyPoints ) ? numberOfPenaltyPoints : pos_begin;
+  pos_end   = ( pos_end > numberOfPenaltyPoints ) ? numberOfPenaltyPoints : pos_end;
+
+} // end GetPenaltyPointRange()
+
+
+/**
+ * *********************** LaunchTransformPenaltyPoints ****************
+ */
 
-  if( MovingImageDimension == 3 )
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::LaunchTransformPenaltyPoints( void ) const
+{
+  if( !this->m_UseMultiThread )
   {
-    for( pgi.GoToBegin(), ni.GoToBegin(); !pgi.IsAtEnd(); ++pgi, ++ni )
-    {
-      penaltyGridIndex = pgi.GetIndex();
+    this->TransformPenaltyPoints( 0, this->m_PenaltyPoints.size() );
+    return;
+  }
 
-      this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( penaltyGridIndex, penaltyGridPoint );
+  this->m_Threader->SetSingleMethod( this->TransformPenaltyPointsThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
 
-      pixelValue = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( penaltyGridPoint ) );
+} // end LaunchTransformPenaltyPoints()
 
-      ni.SetLocation( penaltyGridIndex );
 
-      /** Penalty term calculation */
-      if( pixelValue > 0 && pixelValue < 6 )
-      {
-        numberOfRigidGridsNeighbor = 0;
+/**
+ * *********************** TransformPenaltyPointsThreaderCallback ****************
+ */
 
-        for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
-        {
-          neighborPenaltyGridIndex = ni.GetIndex( kk );
+template< class TFixedImage, class TScalarType >
+ITK_THREAD_RETURN_TYPE
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::TransformPenaltyPointsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
 
-          this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( neighborPenaltyGridIndex, neighborPenaltyGridPoint );
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+  const Self * metric = static_cast< const Self * >( temp->st_Metric );
 
-          pixelValueNeighbor = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( neighborPenaltyGridPoint ) );
+  SizeValueType pos_begin, pos_end;
+  metric->GetPenaltyPointRange( threadID, nrOfThreads, pos_begin, pos_end );
+  metric->TransformPenaltyPoints( pos_begin, pos_end );
 
-          if( pixelValue == pixelValueNeighbor )
-          {
-            numberOfRigidGridsNeighbor++;
-          }
-        }
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end TransformPenaltyPointsThreaderCallback()
+
+
+/**
+ * *********************** TransformPenaltyPoints ****************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::TransformPenaltyPoints( const SizeValueType begin, const SizeValueType end ) const
+{
+  /** Both end points of a pair are looked up in m_MappedPoints, so every
+   * penalty point is transformed only once per evaluation.
+   */
+  for( SizeValueType p = begin; p < end; ++p )
+  {
+    this->m_MappedPoints[ p ] = this->m_Transform->TransformPoint( this->m_PenaltyPoints[ p ] );
+  }
+
+} // end TransformPenaltyPoints()
+
+
+/**
+ * *********************** ComputePenaltyOfPoints ****************
+ */
+
+template< class TFixedImage, class TScalarType >
+typename DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >::MeasureType
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputePenaltyOfPoints( const SizeValueType begin, const SizeValueType end,
+  DerivativeType * derivative ) const
+{
+  typedef typename OutputPointType::VectorType OutputVectorType;
+
+  const SizeValueType numberOfParametersPerDimension
+    = this->GetNumberOfParameters() / ImageDimension;
+
+  MeasureType      value = NumericTraits< MeasureType >::Zero;
+  OutputVectorType du_dC_sum;
+  for( SizeValueType p = begin; p < end; ++p )
+  {
+    const OutputPointType & xf     = this->m_MappedPoints[ p ];
+    const double            weight = this->m_PenaltyPointWeights[ p ];
+    du_dC_sum.Fill( 0.0 );
 
-        if( numberOfRigidGridsNeighbor > 1 )
+    for( SizeValueType e = this->m_NeighborOffsets[ p ]; e < this->m_NeighborOffsets[ p + 1 ]; ++e )
+    {
+      const unsigned int     q  = this->m_NeighborIndices[ e ];
+      const OutputVectorType xd = this->m_MappedPoints[ q ] - xf;
+      const double           dx = xd.GetSquaredNorm();
+      const double           dX = this->m_NeighborSquaredDistances[ e ];
+
+      value += weight * ( dx - dX ) * ( dx - dX );
+
+      /** The pair (p,q) moves both points; its contribution to the derivative
+       * of point p is combined with that of the mirrored pair (q,p), so that
+       * each thread only writes the derivative of its own points.
+       */
+      if( derivative )
+      {
+        du_dC_sum -= xd * ( 4.0 * ( dx - dX ) * ( weight + this->m_PenaltyPointWeights[ q ] ) );
+      }
+    }
+
+    /** Distribute the derivative of point p over its B-spline coefficients. */
+    if( derivative )
+    {
+      const double *        weights = &( this->m_BSplineWeights[ p * this->m_NumberOfWeights ] );
+      const SizeValueType * indices = &( this->m_BSplineParameterIndices[ p * this->m_NumberOfWeights ] );
+      for( unsigned int mu = 0; mu < this->m_NumberOfWeights; ++mu )
+      {
+        for( unsigned int d = 0; d < ImageDimension; ++d )
         {
-          for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
-          {
-            neighborPenaltyGridIndex = ni.GetIndex( kk );
-
-            this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( neighborPenaltyGridIndex, neighborPenaltyGridPoint );
-
-            pixelValueNeighbor = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( neighborPenaltyGridPoint ) );
-
-            if( pixelValue == pixelValueNeighbor )
-            {
-              xn = this->m_Transform->TransformPoint( neighborPenaltyGridPoint );
-              xf = this->m_Transform->TransformPoint( penaltyGridPoint );
-
-              dX = ( neighborPenaltyGridPoint[ 0 ] - penaltyGridPoint[ 0 ] ) * ( neighborPenaltyGridPoint[ 0 ] - penaltyGridPoint[ 0 ] )
-                + ( neighborPenaltyGridPoint[ 1 ] - penaltyGridPoint[ 1 ] ) * ( neighborPenaltyGridPoint[ 1 ] - penaltyGridPoint[ 1 ] )
-                + ( neighborPenaltyGridPoint[ 2 ] - penaltyGridPoint[ 2 ] ) * ( neighborPenaltyGridPoint[ 2 ] - penaltyGridPoint[ 2 ] );
-
-              dx = ( xn[ 0 ] - xf[ 0 ] ) * ( xn[ 0 ] - xf[ 0 ] )
-                + ( xn[ 1 ] - xf[ 1 ] ) * ( xn[ 1 ] - xf[ 1 ] )
-                + ( xn[ 2 ] - xf[ 2 ] ) * ( xn[ 2 ] - xf[ 2 ] );
-
-              penaltyTermBuffer = ( dx - dX ) * ( dx - dX );
-
-              value += penaltyTermBuffer / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-
-              // find neighboring B-Spline control points
-              this->m_BSplineKnotImage->TransformPhysicalPointToContinuousIndex( penaltyGridPoint, tindex );
-              this->m_BSplineKnotImage->TransformPhysicalPointToContinuousIndex( neighborPenaltyGridPoint, tindex_neighbor );
-
-              tx = tindex[ 0 ];
-              ty = tindex[ 1 ];
-              tz = tindex[ 2 ];
-
-              tx_neighbor = tindex_neighbor[ 0 ];
-              ty_neighbor = tindex_neighbor[ 1 ];
-              tz_neighbor = tindex_neighbor[ 2 ];
-
-              for( unsigned dd = 0; dd < ImageDimension; dd++ )
-              {
-                ntindex_start[ dd ]          = static_cast< ContinuousIndexValueType >( floor( tindex[ dd ] ) ) - 1.0;
-                ntindex_neighbor_start[ dd ] = static_cast< ContinuousIndexValueType >( floor( tindex_neighbor[ dd ] ) ) - 1.0;
-              }
-
-              derivativeTermTemp1 = 4 * ( dx - dX ) * ( xn[ 0 ] - xf[ 0 ] ) / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-              derivativeTermTemp2 = 4 * ( dx - dX ) * ( xn[ 1 ] - xf[ 1 ] ) / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-              derivativeTermTemp3 = 4 * ( dx - dX ) * ( xn[ 2 ] - xf[ 2 ] ) / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-
-              for( unsigned int kk = 0; kk < 4; ++kk )
-              {
-                p          = ntindex_start[ 2 ] + kk;
-                neighbor_p = ntindex_neighbor_start[ 2 ] + kk;
-
-                for( unsigned int jj = 0; jj < 4; ++jj )
-                {
-                  n          = ntindex_start[ 1 ] + jj;
-                  neighbor_n = ntindex_neighbor_start[ 1 ] + jj;
-
-                  for( unsigned int ii = 0; ii < 4; ++ii )
-                  {
-                    m          = ntindex_start[ 0 ] + ii;
-                    neighbor_m = ntindex_neighbor_start[ 0 ] + ii;
-
-                    // neighborhood of (i',j',k')
-                    du_dC_neighbor = ( bSplineKernel->Evaluate( tx_neighbor - neighbor_m ) ) * ( bSplineKernel->Evaluate( ty_neighbor - neighbor_n ) )
-                      * ( bSplineKernel->Evaluate( tz_neighbor - neighbor_p ) );
-
-                    par1 = static_cast< unsigned int >( neighbor_m ) + bSplineKnotImageSize[ 0 ] * static_cast< unsigned int >( neighbor_n )
-                      + bSplineKnotImageSize[ 0 ] * bSplineKnotImageSize[ 1 ] * static_cast< unsigned int >( neighbor_p );
-
-                    derivative[ par1 ]                                      += derivativeTermTemp1 * du_dC_neighbor;
-                    derivative[ par1 + numberOfParametersPerDimension ]     += derivativeTermTemp2 * du_dC_neighbor;
-                    derivative[ par1 + 2 * numberOfParametersPerDimension ] += derivativeTermTemp3 * du_dC_neighbor;
-
-                    // neighborhood of (i,j,k)
-                    du_dC = ( bSplineKernel->Evaluate( tx - m ) ) * ( bSplineKernel->Evaluate( ty - n ) )
-                      * ( bSplineKernel->Evaluate( tz - p ) );
-
-                    par2 = static_cast< unsigned int >( m ) + bSplineKnotImageSize[ 0 ] * static_cast< unsigned int >( n )
-                      + bSplineKnotImageSize[ 0 ] * bSplineKnotImageSize[ 1 ] * static_cast< unsigned int >( p );
-
-                    derivative[ par2 ]                                      -= derivativeTermTemp1 * du_dC;
-                    derivative[ par2 + numberOfParametersPerDimension ]     -= derivativeTermTemp2 * du_dC;
-                    derivative[ par2 + 2 * numberOfParametersPerDimension ] -= derivativeTermTemp3 * du_dC;
-                  }
-                }
-              }
-            }
-          } // end for
-        } // end if
+          ( *derivative )[ indices[ mu ] + d * numberOfParametersPerDimension ] += du_dC_sum[ d ] * weights[ mu ];
+        }
       }
-    } // end for
-  } // end if ( dimension = 3 )
+    }
+  }
 
-} // end GetValueAndDerivative()
+  return value;
+
+} // end ComputePenaltyOfPoints()
 
 
 /**
@@ -506,6 +667,8 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
   /** Add debugging information. */
   os << indent << "BSplineTransform: " << this->m_BSplineTransform << std::endl;
   os << indent << "RigidityPenaltyTermValue: " << this->m_RigidityPenaltyTermValue << std::endl;
+  os << indent << "NumberOfPenaltyPoints: " << this->m_PenaltyPoints.size() << std::endl;
+  os << indent << "NumberOfNeighborPairs: " << this->m_NeighborIndices.size() << std::endl;
 
 } // end PrintSelf()
 
@@ -0,0 +1,72 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxLocalNormalizedCorrelationMetric_HXX__
+#define __elxLocalNormalizedCorrelationMetric_HXX__
+
+#include "elxLocalNormalizedCorrelationMetric.h"
+#include "itkTimeProbe.h"
+
+namespace elastix
+{
+
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template< class TElastix >
+void
+LocalNormalizedCorrelationMetric< TElastix >
+::BeforeEachResolution( void )
+{
+  /** Get the current resolution level. */
+  unsigned int level
+    = ( this->m_Registration->GetAsITKBaseType() )->GetCurrentLevel();
+
+  /** Get and set the radius of the correlation window. Default 2. */
+  unsigned int radius = 2;
+  this->GetConfiguration()->ReadParameter( radius, "LocalNormalizedCorrelationRadius",
+    this->GetComponentLabel(), level, 0 );
+  RadiusType radiusArray;
+  radiusArray.Fill( radius );
+  this->SetRadius( radiusArray );
+
+} // end BeforeEachResolution()
+
+
+/**
+ * ******************* Initialize ***********************
+ */
+
+template< class TElastix >
+void
+LocalNormalizedCorrelationMetric< TElastix >
+::Initialize( void )
+{
+  itk::TimeProbe timer;
+  timer.Start();
+  this->Superclass1::Initialize();
+  timer.Stop();
+  elxout << "Initialization of LocalNormalizedCorrelation metric took: "
+         << static_cast< long >( timer.GetMean() * 1000 ) << " ms." << std::endl;
+
+} // end Initialize()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxLocalNormalizedCorrelationMetric_HXX__
@@ -0,0 +1,284 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkLocalNormalizedCorrelationImageToImageMetric_h
+#define __itkLocalNormalizedCorrelationImageToImageMetric_h
+
+#include "itkAdvancedImageToImageMetric.h"
+
+#include <vector>
+
+namespace itk
+{
+/** \class LocalNormalizedCorrelationImageToImageMetric
+ * \brief Computes the local normalized correlation between two images, based on AdvancedImageToImageMetric.
+ *
+ * This metric computes the squared correlation coefficient between the fixed
+ * and the transformed moving image in a small box window around every voxel
+ * of the fixed image region, and averages it over all voxels. Contrary to the
+ * global AdvancedNormalizedCorrelation, it is insensitive to smoothly varying
+ * intensity offsets and gains, such as MR bias fields.
+ *
+ * The local normalized correlation LNCC is defined as:
+ *
+ * \f[
+ * \mathrm{LNCC} = -\frac{1}{|\Omega|} \sum_{c \in \Omega}
+ *   \frac{ \mathtt{sfm}_c^2 }{ \mathtt{sff}_c \, \mathtt{smm}_c },
+ * \f]
+ *
+ * where \f$\mathtt{sfm}_c\f$, \f$\mathtt{sff}_c\f$ and \f$\mathtt{smm}_c\f$ are
+ * the mean-subtracted cross and auto correlations of f(x) and m(x+u(x,p)) over
+ * the valid voxels x in the window around c.
+ *
+ * Every iteration, the moving image is resampled on the whole fixed image
+ * region, after which the window sums are computed with separable running
+ * sums, so that their cost is independent of the window size. The derivative
+ * of LNCC to m(x+u(x,p)) is a sum over all windows containing x of the
+ * derivatives to the window sums, which is again computed with separable
+ * running sums. It is then combined with the moving image gradient and the
+ * transform Jacobian through EvaluateJacobianWithImageGradientProduct().
+ *
+ * Note that this metric does not use the ImageSampler-framework: all voxels
+ * of the fixed image region that are inside the fixed mask are used. All steps
+ * are multi-threaded when UseMultiThread is set.
+ *
+ * \ingroup RegistrationMetrics
+ * \ingroup Metrics
+ */
+
+template< class TFixedImage, class TMovingImage >
+class LocalNormalizedCorrelationImageToImageMetric :
+  public AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef LocalNormalizedCorrelationImageToImageMetric Self;
+  typedef AdvancedImageToImageMetric<
+    TFixedImage, TMovingImage >                      Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( LocalNormalizedCorrelationImageToImageMetric, AdvancedImageToImageMetric );
+
+  /** Typedefs from the superclass. */
+  typedef typename
+    Superclass::CoordinateRepresentationType CoordinateRepresentationType;
+  typedef typename Superclass::MovingImageType            MovingImageType;
+  typedef typename Superclass::MovingImagePixelType       MovingImagePixelType;
+  typedef typename Superclass::MovingImageConstPointer    MovingImageConstPointer;
+  typedef typename Superclass::FixedImageType             FixedImageType;
+  typedef typename Superclass::FixedImageConstPointer     FixedImageConstPointer;
+  typedef typename Superclass::FixedImageRegionType       FixedImageRegionType;
+  typedef typename Superclass::TransformType              TransformType;
+  typedef typename Superclass::TransformPointer           TransformPointer;
+  typedef typename Superclass::InputPointType             InputPointType;
+  typedef typename Superclass::OutputPointType            OutputPointType;
+  typedef typename Superclass::TransformParametersType    TransformParametersType;
+  typedef typename Superclass::TransformJacobianType      TransformJacobianType;
+  typedef typename Superclass::NumberOfParametersType     NumberOfParametersType;
+  typedef typename Superclass::InterpolatorType           InterpolatorType;
+  typedef typename Superclass::InterpolatorPointer        InterpolatorPointer;
+  typedef typename Superclass::RealType                   RealType;
+  typedef typename Superclass::GradientPixelType          GradientPixelType;
+  typedef typename Superclass::GradientImageType          GradientImageType;
+  typedef typename Superclass::GradientImagePointer       GradientImagePointer;
+  typedef typename Superclass::GradientImageFilterType    GradientImageFilterType;
+  typedef typename Superclass::GradientImageFilterPointer GradientImageFilterPointer;
+  typedef typename Superclass::FixedImageMaskType         FixedImageMaskType;
+  typedef typename Superclass::FixedImageMaskPointer      FixedImageMaskPointer;
+  typedef typename Superclass::MovingImageMaskType        MovingImageMaskType;
+  typedef typename Superclass::MovingImageMaskPointer     MovingImageMaskPointer;
+  typedef typename Superclass::MeasureType                MeasureType;
+  typedef typename Superclass::DerivativeType             DerivativeType;
+  typedef typename Superclass::DerivativeValueType        DerivativeValueType;
+  typedef typename Superclass::ParametersType             ParametersType;
+  typedef typename Superclass::FixedImagePixelType        FixedImagePixelType;
+  typedef typename Superclass::MovingImageRegionType      MovingImageRegionType;
+  typedef typename Superclass::ImageSamplerType           ImageSamplerType;
+  typedef typename Superclass::ImageSamplerPointer        ImageSamplerPointer;
+  typedef typename Superclass::ImageSampleContainerType   ImageSampleContainerType;
+  typedef typename
+    Superclass::ImageSampleContainerPointer ImageSampleContainerPointer;
+  typedef typename Superclass::FixedImageLimiterType  FixedImageLimiterType;
+  typedef typename Superclass::MovingImageLimiterType MovingImageLimiterType;
+  typedef typename
+    Superclass::FixedImageLimiterOutputType FixedImageLimiterOutputType;
+  typedef typename
+    Superclass::MovingImageLimiterOutputType MovingImageLimiterOutputType;
+  typedef typename
+    Superclass::MovingImageDerivativeScalesType MovingImageDerivativeScalesType;
+  typedef typename Superclass::ThreaderType   ThreaderType;
+  typedef typename Superclass::ThreadInfoType ThreadInfoType;
+
+  /** The fixed image dimension. */
+  itkStaticConstMacro( FixedImageDimension, unsigned int,
+    FixedImageType::ImageDimension );
+
+  /** The moving image dimension. */
+  itkStaticConstMacro( MovingImageDimension, unsigned int,
+    MovingImageType::ImageDimension );
+
+  /** The type of the window radius, in voxels. */
+  typedef Size< itkGetStaticConstMacro( FixedImageDimension ) > RadiusType;
+
+  /** Get the value for single valued optimizers. */
+  MeasureType GetValue( const TransformParametersType & parameters ) const override;
+
+  /** Get the derivatives of the match measure. */
+  void GetDerivative(
+    const TransformParametersType & parameters,
+    DerivativeType & derivative ) const override;
+
+  /** Get value and derivatives for multiple valued optimizers. */
+  void GetValueAndDerivative(
+    const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const override;
+
+  /** Initialize the Metric by making sure that all the components
+   *  are present and plugged together correctly, and by caching the
+   *  fixed image values in the fixed image region.
+   */
+  void Initialize( void ) override;
+
+  /** Set/Get the radius of the correlation window, in voxels.
+   * The window contains 2 * radius + 1 voxels in each dimension.
+   * Default: 2 in each dimension.
+   */
+  itkSetMacro( Radius, RadiusType );
+  itkGetConstReferenceMacro( Radius, RadiusType );
+
+protected:
+
+  LocalNormalizedCorrelationImageToImageMetric();
+  ~LocalNormalizedCorrelationImageToImageMetric() override {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+  /** Protected Typedefs ******************/
+
+  /** Typedefs inherited from superclass */
+  typedef typename Superclass::FixedImageIndexType        FixedImageIndexType;
+  typedef typename Superclass::FixedImagePointType        FixedImagePointType;
+  typedef typename Superclass::MovingImagePointType       MovingImagePointType;
+  typedef typename Superclass::MovingImageDerivativeType  MovingImageDerivativeType;
+  typedef typename Superclass::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+
+  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
+  typedef std::vector< RealType >                               ImageValueContainerType;
+  typedef std::vector< unsigned char >                          ValidityContainerType;
+
+  /** The window sums, stored per voxel of the fixed image region. After the
+   * value computation, the last three hold the derivatives of the measure to
+   * the window sums sm, smm and sfm, respectively.
+   */
+  enum WindowSumType {
+    SumW = 0, SumF, SumFF, SumM, SumMM, SumFM, NumberOfWindowSums
+  };
+
+  /** The steps of the computation, each launched over all threads. */
+  enum ComputationStepType {
+    ComputeImageValuesStep = 0, BoxFilterStep, ComputeLocalCorrelationStep, ComputeDerivativeStep
+  };
+
+  /** Compute the value and, if derivative is not NULL, the derivative. */
+  void ComputeValueAndDerivative( MeasureType & value, DerivativeType * derivative ) const;
+
+  /** Resample the moving image on the voxels [begin, end) of the fixed image
+   * region, and initialize the window sums with the voxel values.
+   */
+  void ThreadedComputeImageValues( const SizeValueType begin, const SizeValueType end,
+    const bool computeDerivative ) const;
+
+  /** Replace the images [first, first + number) by their box sums along the
+   * given axis, for the image lines [begin, end) along that axis.
+   */
+  void ThreadedBoxFilter( const SizeValueType begin, const SizeValueType end,
+    const unsigned int axis, const unsigned int first, const unsigned int number ) const;
+
+  /** Compute the local correlation at the voxels [begin, end), and if needed
+   * the derivatives to the window sums. Accumulates into the variables of the thread.
+   */
+  void ThreadedComputeLocalCorrelation( const SizeValueType begin, const SizeValueType end,
+    const bool computeDerivative, const ThreadIdType threadId ) const;
+
+  /** Accumulate the derivative contributions of the voxels [begin, end). */
+  void ThreadedComputeDerivative( const SizeValueType begin, const SizeValueType end,
+    const ThreadIdType threadId ) const;
+
+  /** Run the current computation step for one of the threads. */
+  void ThreadedComputationStep( const ThreadIdType threadId, const ThreadIdType numberOfThreads ) const;
+
+  /** Run a computation step, multi-threaded or single-threaded. */
+  void LaunchComputationStep( const ComputationStepType step,
+    const unsigned int axis = 0, const unsigned int first = 0, const unsigned int number = 0 ) const;
+
+  /** Computation step threader callback function. */
+  static ITK_THREAD_RETURN_TYPE ComputationStepThreaderCallback( void * arg );
+
+  /** Convert an offset in the fixed image region to an image index. */
+  FixedImageIndexType ComputeIndex( SizeValueType offset ) const;
+
+private:
+
+  LocalNormalizedCorrelationImageToImageMetric( const Self & ); // purposely not implemented
+  void operator=( const Self & );                               // purposely not implemented
+
+  /** The radius of the correlation window. */
+  RadiusType m_Radius;
+
+  /** The fixed image values in the fixed image region, minus their mean,
+   * and whether the voxels are inside the fixed image mask.
+   */
+  ImageValueContainerType m_FixedImageValues;
+  ValidityContainerType   m_IsInsideFixedMask;
+  SizeValueType           m_NumberOfFixedImageVoxels;
+  RealType                m_FixedImageMean;
+
+  /** Per iteration: the resampled moving image values and gradients, minus
+   * the fixed image mean, whether the voxels are valid, and the window sums.
+   */
+  mutable ImageValueContainerType                  m_MovingImageValues;
+  mutable std::vector< MovingImageDerivativeType > m_MovingImageDerivatives;
+  mutable ValidityContainerType                    m_IsValid;
+  mutable ImageValueContainerType                  m_WindowSums[ NumberOfWindowSums ];
+
+  /** Helper struct that multi-threads the computation steps using ITK threads. */
+  struct MultiThreaderComputationStepType
+  {
+    const Self *        st_Metric;
+    ComputationStepType st_Step;
+    unsigned int        st_Axis;
+    unsigned int        st_First;
+    unsigned int        st_Number;
+    bool                st_ComputeDerivative;
+  };
+  mutable MultiThreaderComputationStepType m_ComputationStepParameters;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkLocalNormalizedCorrelationImageToImageMetric.hxx"
+#endif
+
+#endif // end #ifndef __itkLocalNormalizedCorrelationImageToImageMetric_h
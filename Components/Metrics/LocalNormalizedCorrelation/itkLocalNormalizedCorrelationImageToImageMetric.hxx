@@ -0,0 +1,674 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkLocalNormalizedCorrelationImageToImageMetric_hxx
+#define __itkLocalNormalizedCorrelationImageToImageMetric_hxx
+
+#include "itkLocalNormalizedCorrelationImageToImageMetric.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::LocalNormalizedCorrelationImageToImageMetric()
+{
+  /** All voxels of the fixed image region are used. */
+  this->SetUseImageSampler( false );
+
+  this->m_Radius.Fill( 2 );
+  this->m_NumberOfFixedImageVoxels = 0;
+  this->m_FixedImageMean           = NumericTraits< RealType >::Zero;
+
+  this->m_ComputationStepParameters.st_Metric            = this;
+  this->m_ComputationStepParameters.st_Step              = ComputeImageValuesStep;
+  this->m_ComputationStepParameters.st_Axis              = 0;
+  this->m_ComputationStepParameters.st_First             = 0;
+  this->m_ComputationStepParameters.st_Number            = 0;
+  this->m_ComputationStepParameters.st_ComputeDerivative = false;
+
+} // end Constructor
+
+
+/**
+ * ******************* Initialize *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::Initialize( void )
+{
+  /** Initialize transform, interpolator, etc. */
+  Superclass::Initialize();
+
+  /** Cache the fixed image values in the fixed image region, and whether
+   * they are inside the fixed image mask. The offsets follow the buffer
+   * order of the fixed image region.
+   */
+  const FixedImageRegionType & fixedImageRegion = this->GetFixedImageRegion();
+  const SizeValueType          numberOfVoxels   = fixedImageRegion.GetNumberOfPixels();
+  this->m_FixedImageValues.resize( numberOfVoxels );
+  this->m_IsInsideFixedMask.resize( numberOfVoxels );
+
+  typedef ImageRegionConstIteratorWithIndex< FixedImageType > FixedIteratorType;
+  FixedIteratorType   fixedIterator( this->m_FixedImage, fixedImageRegion );
+  FixedImagePointType fixedPoint;
+  AccumulateType      sumOfFixedImageValues = NumericTraits< AccumulateType >::Zero;
+  SizeValueType       offset                = 0;
+  this->m_NumberOfFixedImageVoxels = 0;
+  for( fixedIterator.GoToBegin(); !fixedIterator.IsAtEnd(); ++fixedIterator, ++offset )
+  {
+    bool isInside = true;
+    if( !this->m_FixedImageMask.IsNull() )
+    {
+      this->m_FixedImage->TransformIndexToPhysicalPoint( fixedIterator.GetIndex(), fixedPoint );
+      isInside = this->m_FixedImageMask->IsInside( fixedPoint );
+    }
+
+    this->m_IsInsideFixedMask[ offset ] = isInside;
+    this->m_FixedImageValues[ offset ]  = NumericTraits< RealType >::Zero;
+    if( isInside )
+    {
+      this->m_FixedImageValues[ offset ] = static_cast< RealType >( fixedIterator.Get() );
+      sumOfFixedImageValues             += this->m_FixedImageValues[ offset ];
+      ++this->m_NumberOfFixedImageVoxels;
+    }
+  }
+
+  if( this->m_NumberOfFixedImageVoxels == 0 )
+  {
+    itkExceptionMacro( << "ERROR: the fixed image region contains no voxels inside the fixed mask." );
+  }
+
+  /** Subtract the mean from the fixed image values. The moving image values
+   * are shifted by the same amount. This does not change the local
+   * correlation, but it reduces the round-off errors in the window sums.
+   */
+  this->m_FixedImageMean = static_cast< RealType >(
+    sumOfFixedImageValues / static_cast< AccumulateType >( this->m_NumberOfFixedImageVoxels ) );
+  for( offset = 0; offset < numberOfVoxels; ++offset )
+  {
+    if( this->m_IsInsideFixedMask[ offset ] )
+    {
+      this->m_FixedImageValues[ offset ] -= this->m_FixedImageMean;
+    }
+  }
+
+  /** Allocate the per-iteration buffers. */
+  this->m_MovingImageValues.resize( numberOfVoxels );
+  this->m_MovingImageDerivatives.resize( numberOfVoxels );
+  this->m_IsValid.resize( numberOfVoxels );
+  for( unsigned int i = 0; i < NumberOfWindowSums; ++i )
+  {
+    this->m_WindowSums[ i ].resize( numberOfVoxels );
+  }
+
+  /** The per-thread variables are also used by the single-threaded code. */
+  this->InitializeThreadingParameters();
+
+} // end Initialize()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Radius: " << this->m_Radius << std::endl;
+  os << indent << "NumberOfFixedImageVoxels: " << this->m_NumberOfFixedImageVoxels << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ******************* ComputeIndex *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >::FixedImageIndexType
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeIndex( SizeValueType offset ) const
+{
+  const FixedImageRegionType & fixedImageRegion = this->GetFixedImageRegion();
+
+  FixedImageIndexType index = fixedImageRegion.GetIndex();
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
+  {
+    index[ i ] += static_cast< IndexValueType >( offset % fixedImageRegion.GetSize()[ i ] );
+    offset     /= fixedImageRegion.GetSize()[ i ];
+  }
+  return index;
+
+} // end ComputeIndex()
+
+
+/**
+ * ******************* GetValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::GetValue( const TransformParametersType & parameters ) const
+{
+  /** Make sure the transform parameters are up to date. */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  this->ComputeValueAndDerivative( value, NULL );
+  return value;
+
+} // end GetValue()
+
+
+/**
+ * ******************* GetDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::GetDerivative( const TransformParametersType & parameters,
+  DerivativeType & derivative ) const
+{
+  /** When the derivative is calculated, all information for calculating
+   * the metric value is available. It does not cost anything to calculate
+   * the metric value now. Therefore, we have chosen to only implement the
+   * GetValueAndDerivative(), supplying it with a dummy value variable.
+   */
+  MeasureType dummyvalue = NumericTraits< MeasureType >::Zero;
+  this->GetValueAndDerivative( parameters, dummyvalue, derivative );
+
+} // end GetDerivative()
+
+
+/**
+ * ******************* GetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueAndDerivative(
+  const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   * Because of these calls GetValueAndDerivative itself is not thread-safe,
+   * so cannot be called multiple times simultaneously.
+   * This is however needed in the CombinationImageToImageMetric.
+   * In that case, you need to:
+   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
+   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
+   *   calling GetValueAndDerivative
+   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
+   * - Now you can call GetValueAndDerivative multi-threaded.
+   */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+
+  derivative.SetSize( this->GetNumberOfParameters() );
+  this->ComputeValueAndDerivative( value, &derivative );
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ComputeValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeValueAndDerivative( MeasureType & value, DerivativeType * derivative ) const
+{
+  this->m_ComputationStepParameters.st_ComputeDerivative = ( derivative != NULL );
+
+  /** Resample the moving image on the fixed image region. */
+  this->LaunchComputationStep( ComputeImageValuesStep );
+
+  /** Compute the window sums with separable box filters. */
+  for( unsigned int axis = 0; axis < FixedImageDimension; ++axis )
+  {
+    this->LaunchComputationStep( BoxFilterStep, axis, SumW, NumberOfWindowSums );
+  }
+
+  /** Compute the local correlation in every window. */
+  this->LaunchComputationStep( ComputeLocalCorrelationStep );
+
+  /** Gather the values from all threads. */
+  const ThreadIdType numberOfThreads
+    = this->m_UseMultiThread ? Self::GetNumberOfThreads() : 1;
+  AccumulateType sumOfValues           = NumericTraits< AccumulateType >::Zero;
+  SizeValueType  numberOfPixelsCounted = 0;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    sumOfValues           += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
+    numberOfPixelsCounted += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted;
+
+    /** Reset these variables for the next iteration. */
+    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value                 = NumericTraits< MeasureType >::Zero;
+    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = 0;
+  }
+
+  /** Check if enough windows were valid. */
+  this->CheckNumberOfSamples( this->m_NumberOfFixedImageVoxels, numberOfPixelsCounted );
+  if( numberOfPixelsCounted == 0 )
+  {
+    value = NumericTraits< MeasureType >::Zero;
+    if( derivative )
+    {
+      derivative->Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    }
+    return;
+  }
+  value = static_cast< MeasureType >( sumOfValues / static_cast< AccumulateType >( numberOfPixelsCounted ) );
+
+  if( !derivative )
+  {
+    return;
+  }
+
+  /** Sum the derivatives to the window sums over all windows containing a
+   * voxel, again with separable box filters.
+   */
+  for( unsigned int axis = 0; axis < FixedImageDimension; ++axis )
+  {
+    this->LaunchComputationStep( BoxFilterStep, axis, SumM, NumberOfWindowSums - SumM );
+  }
+
+  /** Combine them with the moving image gradient and the transform Jacobian. */
+  this->LaunchComputationStep( ComputeDerivativeStep );
+
+  /** Accumulate the derivatives of all threads. */
+  if( this->m_UseMultiThread )
+  {
+    this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative->begin();
+    this->m_ThreaderMetricParameters.st_NormalizationFactor = static_cast< DerivativeValueType >( numberOfPixelsCounted );
+
+    this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+      const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
+  }
+  else
+  {
+    DerivativeType & threadDerivative = this->m_GetValueAndDerivativePerThreadVariables[ 0 ].st_Derivative;
+    *derivative = threadDerivative / static_cast< DerivativeValueType >( numberOfPixelsCounted );
+    threadDerivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+  }
+
+} // end ComputeValueAndDerivative()
+
+
+/**
+ * ******************* LaunchComputationStep *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::LaunchComputationStep( const ComputationStepType step,
+  const unsigned int axis, const unsigned int first, const unsigned int number ) const
+{
+  this->m_ComputationStepParameters.st_Step   = step;
+  this->m_ComputationStepParameters.st_Axis   = axis;
+  this->m_ComputationStepParameters.st_First  = first;
+  this->m_ComputationStepParameters.st_Number = number;
+
+  if( !this->m_UseMultiThread )
+  {
+    this->ThreadedComputationStep( 0, 1 );
+    return;
+  }
+
+  this->m_Threader->SetSingleMethod( ComputationStepThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ComputationStepParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchComputationStep()
+
+
+/**
+ * **************** ComputationStepThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputationStepThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
+
+  MultiThreaderComputationStepType * temp
+    = static_cast< MultiThreaderComputationStepType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedComputationStep( threadId, nrOfThreads );
+
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end ComputationStepThreaderCallback()
+
+
+/**
+ * ******************* ThreadedComputationStep *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputationStep( const ThreadIdType threadId, const ThreadIdType numberOfThreads ) const
+{
+  const MultiThreaderComputationStepType & parameters = this->m_ComputationStepParameters;
+
+  /** The box filter is split over the image lines along the axis,
+   * the other steps over the voxels.
+   */
+  SizeValueType numberOfItems = this->m_IsValid.size();
+  if( parameters.st_Step == BoxFilterStep )
+  {
+    numberOfItems /= this->GetFixedImageRegion().GetSize()[ parameters.st_Axis ];
+  }
+
+  const SizeValueType itemsPerThread = static_cast< SizeValueType >(
+    std::ceil( static_cast< double >( numberOfItems ) / static_cast< double >( numberOfThreads ) ) );
+  const SizeValueType pos_begin = std::min( itemsPerThread * threadId, numberOfItems );
+  const SizeValueType pos_end   = std::min( itemsPerThread * ( threadId + 1 ), numberOfItems );
+
+  switch( parameters.st_Step )
+  {
+    case ComputeImageValuesStep:
+      this->ThreadedComputeImageValues( pos_begin, pos_end, parameters.st_ComputeDerivative );
+      break;
+    case BoxFilterStep:
+      this->ThreadedBoxFilter( pos_begin, pos_end,
+        parameters.st_Axis, parameters.st_First, parameters.st_Number );
+      break;
+    case ComputeLocalCorrelationStep:
+      this->ThreadedComputeLocalCorrelation( pos_begin, pos_end,
+        parameters.st_ComputeDerivative, threadId );
+      break;
+    case ComputeDerivativeStep:
+      this->ThreadedComputeDerivative( pos_begin, pos_end, threadId );
+      break;
+  }
+
+} // end ThreadedComputationStep()
+
+
+/**
+ * ******************* ThreadedComputeImageValues *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputeImageValues( const SizeValueType begin, const SizeValueType end,
+  const bool computeDerivative ) const
+{
+  const RealType zero = NumericTraits< RealType >::Zero;
+
+  FixedImagePointType  fixedPoint;
+  MovingImagePointType mappedPoint;
+  for( SizeValueType k = begin; k < end; ++k )
+  {
+    RealType                  movingImageValue = zero;
+    MovingImageDerivativeType movingImageDerivative;
+
+    /** Only voxels inside the fixed mask are considered. */
+    bool sampleOk = this->m_IsInsideFixedMask[ k ] != 0;
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    if( sampleOk )
+    {
+      this->m_FixedImage->TransformIndexToPhysicalPoint( this->ComputeIndex( k ), fixedPoint );
+      sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    }
+
+    /** Check if point is inside mask. */
+    if( sampleOk )
+    {
+      sampleOk = this->IsInsideMovingMask( mappedPoint );
+    }
+
+    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+     * the point is inside the moving image buffer.
+     */
+    if( sampleOk )
+    {
+      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, computeDerivative ? &movingImageDerivative : 0 );
+    }
+
+    /** Store the values and initialize the window sums. Invalid voxels
+     * contribute nothing to the windows.
+     */
+    const RealType w = sampleOk ? 1.0 : zero;
+    const RealType f = this->m_FixedImageValues[ k ];
+    const RealType m = sampleOk ? movingImageValue - this->m_FixedImageMean : zero;
+
+    this->m_IsValid[ k ]           = sampleOk;
+    this->m_MovingImageValues[ k ] = m;
+    if( computeDerivative && sampleOk )
+    {
+      this->m_MovingImageDerivatives[ k ] = movingImageDerivative;
+    }
+
+    this->m_WindowSums[ SumW ][ k ]  = w;
+    this->m_WindowSums[ SumF ][ k ]  = w * f;
+    this->m_WindowSums[ SumFF ][ k ] = w * f * f;
+    this->m_WindowSums[ SumM ][ k ]  = m;
+    this->m_WindowSums[ SumMM ][ k ] = m * m;
+    this->m_WindowSums[ SumFM ][ k ] = f * m;
+  }
+
+} // end ThreadedComputeImageValues()
+
+
+/**
+ * ******************* ThreadedBoxFilter *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedBoxFilter( const SizeValueType begin, const SizeValueType end,
+  const unsigned int axis, const unsigned int first, const unsigned int number ) const
+{
+  const typename FixedImageRegionType::SizeType & size = this->GetFixedImageRegion().GetSize();
+
+  /** The stride and length of the lines along the axis. */
+  SizeValueType stride = 1;
+  for( unsigned int i = 0; i < axis; ++i )
+  {
+    stride *= size[ i ];
+  }
+  const SizeValueType length = size[ axis ];
+  const SizeValueType radius = std::min(
+    static_cast< SizeValueType >( this->m_Radius[ axis ] ), length - 1 );
+
+  /** Running sums: every box sum is the difference of two prefix sums,
+   * which makes the cost independent of the radius.
+   */
+  ImageValueContainerType prefixSums( length + 1 );
+  for( SizeValueType line = begin; line < end; ++line )
+  {
+    const SizeValueType lineStart = line % stride + ( line / stride ) * stride * length;
+
+    for( unsigned int b = first; b < first + number; ++b )
+    {
+      RealType * data = &this->m_WindowSums[ b ][ lineStart ];
+
+      prefixSums[ 0 ] = NumericTraits< RealType >::Zero;
+      for( SizeValueType i = 0; i < length; ++i )
+      {
+        prefixSums[ i + 1 ] = prefixSums[ i ] + data[ i * stride ];
+      }
+
+      for( SizeValueType i = 0; i < length; ++i )
+      {
+        const SizeValueType lower = ( i > radius ) ? i - radius : 0;
+        const SizeValueType upper = std::min( i + radius + 1, length );
+        data[ i * stride ] = prefixSums[ upper ] - prefixSums[ lower ];
+      }
+    }
+  }
+
+} // end ThreadedBoxFilter()
+
+
+/**
+ * ******************* ThreadedComputeLocalCorrelation *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputeLocalCorrelation( const SizeValueType begin, const SizeValueType end,
+  const bool computeDerivative, const ThreadIdType threadId ) const
+{
+  const RealType zero = NumericTraits< RealType >::Zero;
+
+  AccumulateType measure               = NumericTraits< AccumulateType >::Zero;
+  SizeValueType  numberOfPixelsCounted = 0;
+  for( SizeValueType c = begin; c < end; ++c )
+  {
+    RealType dsm  = zero;
+    RealType dsmm = zero;
+    RealType dsfm = zero;
+
+    const RealType n = this->m_WindowSums[ SumW ][ c ];
+    if( this->m_IsValid[ c ] && n > 1.5 )
+    {
+      const RealType sf  = this->m_WindowSums[ SumF ][ c ];
+      const RealType sff = this->m_WindowSums[ SumFF ][ c ];
+      const RealType sm  = this->m_WindowSums[ SumM ][ c ];
+      const RealType smm = this->m_WindowSums[ SumMM ][ c ];
+      const RealType sfm = this->m_WindowSums[ SumFM ][ c ];
+
+      /** The mean-subtracted auto and cross correlations. */
+      const RealType varF  = sff - sf * sf / n;
+      const RealType varM  = smm - sm * sm / n;
+      const RealType cross = sfm - sf * sm / n;
+
+      /** Skip windows with (numerically) constant intensities. */
+      if( varF > 1e-10 * sff && varM > 1e-10 * smm )
+      {
+        const RealType invVar = 1.0 / ( varF * varM );
+        const RealType cc     = cross * cross * invVar;
+        measure -= cc;
+        ++numberOfPixelsCounted;
+
+        /** The derivatives of -cc to the window sums sm, smm and sfm. */
+        if( computeDerivative )
+        {
+          dsm  = 2.0 * cross * invVar / n * ( sf - cross * sm / varM );
+          dsmm = cc / varM;
+          dsfm = -2.0 * cross * invVar;
+        }
+      }
+    }
+
+    if( computeDerivative )
+    {
+      this->m_WindowSums[ SumM ][ c ]  = dsm;
+      this->m_WindowSums[ SumMM ][ c ] = dsmm;
+      this->m_WindowSums[ SumFM ][ c ] = dsfm;
+    }
+  }
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value                 = measure;
+
+} // end ThreadedComputeLocalCorrelation()
+
+
+/**
+ * ******************* ThreadedComputeDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+LocalNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputeDerivative( const SizeValueType begin, const SizeValueType end,
+  const ThreadIdType threadId ) const
+{
+  /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType   nzji  = NonZeroJacobianIndicesType( nnzji );
+  DerivativeType               imageJacobian( nnzji );
+
+  /** Get a handle to the pre-allocated derivative for the current thread. */
+  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
+
+  FixedImagePointType fixedPoint;
+  for( SizeValueType k = begin; k < end; ++k )
+  {
+    if( !this->m_IsValid[ k ] )
+    {
+      continue;
+    }
+
+    /** The derivative of the measure to the moving image value at this voxel,
+     * summed over all windows that contain the voxel.
+     */
+    const RealType dMeasure = this->m_WindowSums[ SumM ][ k ]
+      + 2.0 * this->m_MovingImageValues[ k ] * this->m_WindowSums[ SumMM ][ k ]
+      + this->m_FixedImageValues[ k ] * this->m_WindowSums[ SumFM ][ k ];
+    if( dMeasure == 0.0 )
+    {
+      continue;
+    }
+
+    /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+    this->m_FixedImage->TransformIndexToPhysicalPoint( this->ComputeIndex( k ), fixedPoint );
+    this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+      fixedPoint, this->m_MovingImageDerivatives[ k ], imageJacobian, nzji );
+
+    for( unsigned int i = 0; i < imageJacobian.GetSize(); ++i )
+    {
+      derivative[ nzji[ i ] ] += dMeasure * imageJacobian[ i ];
+    }
+  }
+
+} // end ThreadedComputeDerivative()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkLocalNormalizedCorrelationImageToImageMetric_hxx
@@ -26,6 +26,8 @@
 #include "itkVectorContainer.h"
 #include "vnl_adjugate_fixed.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -38,6 +40,10 @@ namespace itk
  * M.A. Viergever and J.P.W. Pluim "Registration of structurally dissimilar \n
  * images in MRI-based brachytherapy ", Phys. Med. Biol. 59 (2014) 4033-4045.\n
  * http://stacks.iop.org/0031-9155/59/4033
+ *
+ * The mesh points are mapped, and the volume derivatives are propagated
+ * through the transform Jacobians, in parallel chunks when UseMultiThread
+ * is on. The loop over the cells is serial.
  * \ingroup RegistrationMetrics
  */
 template< class TFixedPointSet, class TMovingPointSet >
@@ -78,6 +84,7 @@ public:
   typedef vnl_vector< CoordRepType >             VnlVectorType;
 
   typedef typename Superclass::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+  typedef typename Superclass::OutputVectorType           OutputVectorType;
 
   /** Constants for the pointset dimensions. */
   itkStaticConstMacro( FixedPointSetDimension, unsigned int,
@@ -165,6 +172,15 @@ protected:
   /** PrintSelf. */
   //void PrintSelf(std::ostream& os, Indent indent) const;
 
+  /** Called twice per mesh by LaunchGetValueAndDerivativeOfPoints():
+   * without derivative to map the points [ begin, end [ of the current mesh,
+   * and with derivative to multiply their volume gradients with the
+   * transform Jacobians.
+   */
+  void ThreadedGetValueAndDerivativeOfPoints( const unsigned int begin,
+    const unsigned int end, const ThreadIdType threadId,
+    const bool computeDerivative ) const override;
+
   /** Member variables. */
   FixedMeshConstPointer m_FixedMesh;
 
@@ -175,6 +191,18 @@ private:
 
   void SubVector( const VectorType & fullVector, SubVectorType & subVector, const unsigned int leaveOutIndex ) const;
 
+  /** Map the points of a mesh and compute its (pseudo) volume, and, when
+   * requested, the derivative of the volume with respect to the mapped points.
+   */
+  MeasureType ComputeMeshVolume( const FixedMeshContainerElementIdentifier meshId,
+    const bool computeDerivative ) const;
+
+  /** The mesh that is being processed by the threads. */
+  mutable FixedMeshContainerElementIdentifier m_CurrentMeshId;
+
+  /** The derivative of the volume of the current mesh with respect to its mapped points. */
+  mutable std::vector< OutputVectorType > m_PointGradients;
+
   MissingVolumeMeshPenalty( const Self & ); // purposely not implemented
   void operator=( const Self & );           // purposely not implemented
 
@@ -19,6 +19,7 @@
 #define __itkMissingStructurePenalty_hxx
 
 #include "itkMissingStructurePenalty.h"
+#include <algorithm>
 #include <cmath>
 
 namespace itk
@@ -33,6 +34,7 @@ MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
 ::MissingVolumeMeshPenalty()
 {
   this->m_MappedMeshContainer = MappedMeshContainerType::New();
+  this->m_CurrentMeshId       = 0;
 } // end Constructor
 
 
@@ -71,11 +73,13 @@ MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
   const FixedMeshContainerElementIdentifier numberOfMeshes = this->m_FixedMeshContainer->Size();
   this->m_MappedMeshContainer->Reserve( numberOfMeshes );
 
+  unsigned int maximumNumberOfPoints = 0;
   for( FixedMeshContainerElementIdentifier meshId = 0; meshId < numberOfMeshes; ++meshId )
   {
     FixedMeshConstPointer           fixedMesh      = this->m_FixedMeshContainer->ElementAt( meshId );
     MeshPointsContainerConstPointer fixedPoints    = fixedMesh->GetPoints();
     const unsigned int              numberOfPoints = fixedPoints->Size();
+    maximumNumberOfPoints = std::max( maximumNumberOfPoints, numberOfPoints );
 
     typename MeshPointsContainerType::Pointer mappedPoints =  MeshPointsContainerType::New();
     mappedPoints->Reserve( numberOfPoints );
@@ -93,6 +97,10 @@ MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
     this->m_MappedMeshContainer->SetElement( meshId, mappedMesh );
 
   }
+
+  /** Allocate the point gradients once, for the largest mesh. */
+  this->m_PointGradients.resize( maximumNumberOfPoints );
+
 } // end Initialize()
 
 
@@ -121,8 +129,11 @@ MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
-  DerivativeType dummyDerivative;
-  this->GetValueAndDerivative( parameters, value, dummyDerivative );
+  const FixedMeshContainerElementIdentifier numberOfMeshes = fixedMeshContainer->Size();
+  for( FixedMeshContainerElementIdentifier meshId = 0; meshId < numberOfMeshes; ++meshId )
+  {
+    value += this->ComputeMeshVolume( meshId, false );
+  }
 
   return value;
 
@@ -176,169 +187,204 @@ MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
   derivative = DerivativeType( this->GetNumberOfParameters() );
   derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
 
-  NonZeroJacobianIndicesType nzji( this->m_Transform->GetNumberOfNonZeroJacobianIndices() );
-  TransformJacobianType      jacobian;
-
-  const FixedMeshContainerElementIdentifier numberOfMeshes = this->m_FixedMeshContainer->Size();
-
-  typedef typename FixedMeshType::PointType FixedMeshPointType;
-
-  FixedMeshPointType zeroPoint = typename FixedMeshPointType::Point();
-  zeroPoint.Fill( 0.0 );
-
-  typename MeshPointsContainerType::Pointer pointCentroids = FixedMeshType::PointsContainer::New();
-  pointCentroids->resize( numberOfMeshes, typename FixedMeshPointType::Point( zeroPoint ) );
-
+  const FixedMeshContainerElementIdentifier numberOfMeshes = fixedMeshContainer->Size();
   for( FixedMeshContainerElementIdentifier meshId = 0; meshId < numberOfMeshes; ++meshId ) // loop over all meshes in container
   {
-    const FixedMeshConstPointer           fixedMesh      = fixedMeshContainer->ElementAt( meshId );
-    const MeshPointsContainerConstPointer fixedPoints    = fixedMesh->GetPoints();
-    const unsigned int                    numberOfPoints = fixedPoints->Size();
+    value += this->ComputeMeshVolume( meshId, true );
 
-    const FixedMeshPointer           mappedMesh   = this->m_MappedMeshContainer->ElementAt( meshId );
-    const MeshPointsContainerPointer mappedPoints = mappedMesh->GetPoints();
+    /** Multiply the point gradients with the transform Jacobians, possibly multi-threaded. */
+    MeasureType dummyValue = NumericTraits< MeasureType >::Zero;
+    this->m_CurrentMeshId = meshId;
+    this->LaunchGetValueAndDerivativeOfPoints(
+      fixedMeshContainer->ElementAt( meshId )->GetPoints()->Size(), dummyValue, &derivative );
 
-    typename FixedMeshType::PointType &              pointCentroid = pointCentroids->ElementAt( meshId );
-    typedef typename FixedMeshType::PointsContainer FixedMeshPointsContainerType;
-    typename FixedMeshType::PointsContainer::Pointer derivPoints = FixedMeshPointsContainerType::New();
+  } // end loop over all meshes in container
+} // end GetValueAndDerivative()
 
-    derivPoints->resize( numberOfPoints, typename FixedMeshPointType::Point( zeroPoint ) );
 
-    MeshPointsContainerConstIteratorType fixedPointIt  = fixedPoints->Begin();
-    MeshPointsContainerIteratorType      mappedPointIt = mappedPoints->Begin();
-    MeshPointsContainerConstIteratorType fixedPointEnd = fixedPoints->End();
+/**
+ * ******************* ComputeMeshVolume *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+typename MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >::MeasureType
+MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
+::ComputeMeshVolume( const FixedMeshContainerElementIdentifier meshId,
+  const bool computeDerivative ) const
+{
+  const FixedMeshConstPointer           fixedMesh      = this->m_FixedMeshContainer->ElementAt( meshId );
+  const MeshPointsContainerConstPointer fixedPoints    = fixedMesh->GetPoints();
+  const unsigned int                    numberOfPoints = fixedPoints->Size();
+
+  const FixedMeshPointer           mappedMesh   = this->m_MappedMeshContainer->ElementAt( meshId );
+  const MeshPointsContainerPointer mappedPoints = mappedMesh->GetPoints();
+
+  /** Map the points, possibly multi-threaded. */
+  MeasureType dummyValue = NumericTraits< MeasureType >::Zero;
+  this->m_CurrentMeshId = meshId;
+  this->LaunchGetValueAndDerivativeOfPoints( numberOfPoints, dummyValue, NULL );
+
+  MeshPointType pointCentroid;
+  pointCentroid.Fill( 0.0 );
+  MeshPointsContainerIteratorType mappedPointIt  = mappedPoints->Begin();
+  MeshPointsContainerIteratorType mappedPointEnd = mappedPoints->End();
+  for(; mappedPointIt != mappedPointEnd; ++mappedPointIt )
+  {
+    pointCentroid.GetVnlVector() += mappedPointIt.Value().GetVnlVector();
+  }
+  pointCentroid.GetVnlVector() /= numberOfPoints;
 
-    for(; fixedPointIt != fixedPointEnd; ++fixedPointIt, ++mappedPointIt )
+  std::vector< OutputVectorType > & derivPoints = this->m_PointGradients;
+  if( computeDerivative )
+  {
+    for( unsigned int i = 0; i < numberOfPoints; ++i )
     {
-      const OutputPointType mappedPoint = this->m_Transform->TransformPoint( fixedPointIt->Value() );
-      mappedPointIt.Value()         = mappedPoint;
-      pointCentroid.GetVnlVector() += mappedPoint.GetVnlVector();
+      derivPoints[ i ].Fill( 0.0 );
     }
-    pointCentroid.GetVnlVector() /= numberOfPoints;
+  }
 
-    typename FixedMeshType::CellsContainerConstIterator cellBegin = fixedMesh->GetCells()->Begin();
-    typename FixedMeshType::CellsContainerConstIterator cellEnd   = fixedMesh->GetCells()->End();
+  typename FixedMeshType::CellsContainerConstIterator cellBegin = fixedMesh->GetCells()->Begin();
+  typename FixedMeshType::CellsContainerConstIterator cellEnd   = fixedMesh->GetCells()->End();
 
-    typename CellInterfaceType::PointIdIterator beginpointer;
-    float sumSignedVolume = 0.0;
-    float sumAbsVolume    = 0.0;
+  typename CellInterfaceType::PointIdIterator beginpointer;
+  float sumSignedVolume = 0.0;
+  float sumAbsVolume    = 0.0;
 
-    const float eps = 0.00001;
+  const float eps = 0.00001;
 
-    for(; cellBegin != cellEnd; ++cellBegin )
-    {
-      beginpointer = cellBegin->Value()->PointIdsBegin();
-      float signedVolume;  // = vnl_determinant(fullMatrix.GetVnlMatrix());
+  for(; cellBegin != cellEnd; ++cellBegin )
+  {
+    beginpointer = cellBegin->Value()->PointIdsBegin();
+    float signedVolume;  // = vnl_determinant(fullMatrix.GetVnlMatrix());
 
-      //const VectorType::const_pointer p1,p2,p3,p4;
-      switch( static_cast< unsigned int >( FixedPointSetDimension ) )
+    //const VectorType::const_pointer p1,p2,p3,p4;
+    switch( static_cast< unsigned int >( FixedPointSetDimension ) )
+    {
+      case 2:
       {
-        case 2:
-        {
-          const FixedMeshPointIdentifier p1Id = *beginpointer;
-          ++beginpointer;
-          const VectorType               p1   = mappedPoints->GetElement( p1Id ) - pointCentroid;
-          const FixedMeshPointIdentifier p2Id = *beginpointer;
-          ++beginpointer;
-          const VectorType p2 = mappedPoints->GetElement( p2Id ) - pointCentroid;
-
-          signedVolume = vnl_determinant( p1.GetDataPointer(), p2.GetDataPointer() );
-
-          const int sign = ( signedVolume > eps ) - ( signedVolume < -eps );
-          if( sign != 0 )
-          {
-            derivPoints->at( p1Id )[ 0 ] += sign * p2[ 1 ];
-            derivPoints->at( p1Id )[ 1 ] -= sign * p2[ 0 ];
-            derivPoints->at( p2Id )[ 0 ] -= sign * p1[ 1 ];
-            derivPoints->at( p2Id )[ 1 ] += sign * p1[ 0 ];
-          }
+        const FixedMeshPointIdentifier p1Id = *beginpointer;
+        ++beginpointer;
+        const VectorType               p1   = mappedPoints->GetElement( p1Id ) - pointCentroid;
+        const FixedMeshPointIdentifier p2Id = *beginpointer;
+        ++beginpointer;
+        const VectorType p2 = mappedPoints->GetElement( p2Id ) - pointCentroid;
 
-        }
-        break;
-        case 3:
-        {
-          const FixedMeshPointIdentifier p1Id = *beginpointer;
-          ++beginpointer;
-          const VectorType               p1   = mappedPoints->GetElement( p1Id ) - pointCentroid;
-          const FixedMeshPointIdentifier p2Id = *beginpointer;
-          ++beginpointer;
-          const VectorType               p2   = mappedPoints->GetElement( p2Id ) - pointCentroid;
-          const FixedMeshPointIdentifier p3Id = *beginpointer;
-          ++beginpointer;
-          const VectorType p3 = mappedPoints->GetElement( p3Id ) - pointCentroid;
-
-          signedVolume = vnl_determinant( p1.GetDataPointer(), p2.GetDataPointer(), p3.GetDataPointer() );
-
-          const int sign = ( ( signedVolume > eps ) - ( signedVolume < -eps ) );
-
-          if( sign != 0 )
-          {
-            derivPoints->at( p1Id )[ 0 ] += sign * ( p2[ 1 ] * p3[ 2 ] - p2[ 2 ] * p3[ 1 ] );
-            derivPoints->at( p1Id )[ 1 ] += sign * ( p2[ 2 ] * p3[ 0 ] - p2[ 0 ] * p3[ 2 ] );
-            derivPoints->at( p1Id )[ 2 ] += sign * ( p2[ 0 ] * p3[ 1 ] - p2[ 1 ] * p3[ 0 ] );
-
-            derivPoints->at( p2Id )[ 0 ] += sign * ( p1[ 2 ] * p3[ 1 ] - p1[ 1 ] * p3[ 2 ] );
-            derivPoints->at( p2Id )[ 1 ] += sign * ( p1[ 0 ] * p3[ 2 ] - p1[ 2 ] * p3[ 0 ] );
-            derivPoints->at( p2Id )[ 2 ] += sign * ( p1[ 1 ] * p3[ 0 ] - p1[ 0 ] * p3[ 1 ] );
-
-            derivPoints->at( p3Id )[ 0 ] += sign * ( p1[ 1 ] * p2[ 2 ] - p1[ 2 ] * p2[ 1 ] );
-            derivPoints->at( p3Id )[ 1 ] += sign * ( p1[ 2 ] * p2[ 0 ] - p1[ 0 ] * p2[ 2 ] );
-            derivPoints->at( p3Id )[ 2 ] += sign * ( p1[ 0 ] * p2[ 1 ] - p1[ 1 ] * p2[ 0 ] );
-
-          }
-        }
+        signedVolume = vnl_determinant( p1.GetDataPointer(), p2.GetDataPointer() );
 
-        break;
-        case 4:
+        const int sign = ( signedVolume > eps ) - ( signedVolume < -eps );
+        if( computeDerivative && sign != 0 )
         {
-          const VectorConstPointer p1 = mappedPoints->GetElement( *beginpointer++ ).GetDataPointer();
-          const VectorConstPointer p2 = mappedPoints->GetElement( *beginpointer++ ).GetDataPointer();
-          const VectorConstPointer p3 = mappedPoints->GetElement( *beginpointer++ ).GetDataPointer();
-          const VectorConstPointer p4 = mappedPoints->GetElement( *beginpointer++ ).GetDataPointer();
-          signedVolume = vnl_determinant( p1, p2, p3, p4 );
+          derivPoints[ p1Id ][ 0 ] += sign * p2[ 1 ];
+          derivPoints[ p1Id ][ 1 ] -= sign * p2[ 0 ];
+          derivPoints[ p2Id ][ 0 ] -= sign * p1[ 1 ];
+          derivPoints[ p2Id ][ 1 ] += sign * p1[ 0 ];
         }
-        break;
-        default:
-          std::cout << "no dimensions higher than 4"  << std::endl;
-      }
 
-      sumSignedVolume +=  signedVolume;
-      sumAbsVolume    += std::abs( signedVolume );
-    }
-
-    /** Create iterators. */
-    fixedPointIt = fixedPoints->Begin();
-    unsigned int pointIndex;
-    /** Loop over points. */
-    for( pointIndex = 0; fixedPointIt != fixedPointEnd; ++fixedPointIt, ++pointIndex )
-    {
-      /** Get the TransformJacobian dT/dmu. */
-      this->m_Transform->GetJacobian( fixedPointIt.Value(), jacobian, nzji );
-      if( nzji.size() == this->GetNumberOfParameters() )
-      {
-        /** Loop over all Jacobians. */
-        derivative += derivPoints->at( pointIndex ).GetVnlVector() * jacobian; //* sumAbsVolumeEps;
       }
-      else
+      break;
+      case 3:
       {
-        /** Only pick the nonzero Jacobians. */
-        for( unsigned int i = 0; i < nzji.size(); ++i )
+        const FixedMeshPointIdentifier p1Id = *beginpointer;
+        ++beginpointer;
+        const VectorType               p1   = mappedPoints->GetElement( p1Id ) - pointCentroid;
+        const FixedMeshPointIdentifier p2Id = *beginpointer;
+        ++beginpointer;
+        const VectorType               p2   = mappedPoints->GetElement( p2Id ) - pointCentroid;
+        const FixedMeshPointIdentifier p3Id = *beginpointer;
+        ++beginpointer;
+        const VectorType p3 = mappedPoints->GetElement( p3Id ) - pointCentroid;
+
+        signedVolume = vnl_determinant( p1.GetDataPointer(), p2.GetDataPointer(), p3.GetDataPointer() );
+
+        const int sign = ( ( signedVolume > eps ) - ( signedVolume < -eps ) );
+
+        if( computeDerivative && sign != 0 )
         {
-          const unsigned int index  = nzji[ i ];
-          VnlVectorType      column = jacobian.get_column( i );
-          derivative[ index ] += dot_product( derivPoints->at( pointIndex ).GetVnlVector(), column ); // *sumAbsVolumeEps;
+          derivPoints[ p1Id ][ 0 ] += sign * ( p2[ 1 ] * p3[ 2 ] - p2[ 2 ] * p3[ 1 ] );
+          derivPoints[ p1Id ][ 1 ] += sign * ( p2[ 2 ] * p3[ 0 ] - p2[ 0 ] * p3[ 2 ] );
+          derivPoints[ p1Id ][ 2 ] += sign * ( p2[ 0 ] * p3[ 1 ] - p2[ 1 ] * p3[ 0 ] );
+
+          derivPoints[ p2Id ][ 0 ] += sign * ( p1[ 2 ] * p3[ 1 ] - p1[ 1 ] * p3[ 2 ] );
+          derivPoints[ p2Id ][ 1 ] += sign * ( p1[ 0 ] * p3[ 2 ] - p1[ 2 ] * p3[ 0 ] );
+          derivPoints[ p2Id ][ 2 ] += sign * ( p1[ 1 ] * p3[ 0 ] - p1[ 0 ] * p3[ 1 ] );
+
+          derivPoints[ p3Id ][ 0 ] += sign * ( p1[ 1 ] * p2[ 2 ] - p1[ 2 ] * p2[ 1 ] );
+          derivPoints[ p3Id ][ 1 ] += sign * ( p1[ 2 ] * p2[ 0 ] - p1[ 0 ] * p2[ 2 ] );
+          derivPoints[ p3Id ][ 2 ] += sign * ( p1[ 0 ] * p2[ 1 ] - p1[ 1 ] * p2[ 0 ] );
+
         }
       }
 
-    } // end loop over all corresponding points
+      break;
+      case 4:
+      {
+        const VectorConstPointer p1 = mappedPoints->GetElement( *beginpointer++ ).GetDataPointer();
+        const VectorConstPointer p2 = mappedPoints->GetElement( *beginpointer++ ).GetDataPointer();
+        const VectorConstPointer p3 = mappedPoints->GetElement( *beginpointer++ ).GetDataPointer();
+        const VectorConstPointer p4 = mappedPoints->GetElement( *beginpointer++ ).GetDataPointer();
+        signedVolume = vnl_determinant( p1, p2, p3, p4 );
+      }
+      break;
+      default:
+        itkExceptionMacro( << "ComputeMeshVolume: meshes of dimension higher than 4 are not supported" );
+    }
 
-    /** Check if enough samples were valid. */
+    sumSignedVolume +=  signedVolume;
+    sumAbsVolume    += std::abs( signedVolume );
+  }
 
-    /** Copy the measure to value. */
-    value += sumAbsVolume;
+  return sumAbsVolume;
 
-  } // end loop over all meshes in container
-} // end GetValueAndDerivative()
+} // end ComputeMeshVolume()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivativeOfPoints *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
+::ThreadedGetValueAndDerivativeOfPoints( const unsigned int begin,
+  const unsigned int end, const ThreadIdType threadId,
+  const bool computeDerivative ) const
+{
+  if( begin >= end )
+  {
+    return;
+  }
+
+  const MeshPointsContainerConstPointer fixedPoints
+    = this->m_FixedMeshContainer->ElementAt( this->m_CurrentMeshId )->GetPoints();
+
+  if( !computeDerivative )
+  {
+    /** Map this chunk of points at once. */
+    const MeshPointsContainerPointer mappedPoints
+      = this->m_MappedMeshContainer->ElementAt( this->m_CurrentMeshId )->GetPoints();
+    this->TransformPoints( &fixedPoints->ElementAt( begin ),
+      &mappedPoints->ElementAt( begin ), end - begin );
+    return;
+  }
+
+  NonZeroJacobianIndicesType nzji( this->m_Transform->GetNumberOfNonZeroJacobianIndices() );
+  TransformJacobianType      jacobian;
+
+  for( unsigned int pointIndex = begin; pointIndex < end; ++pointIndex )
+  {
+    /** Points that are not part of a cell with non-zero volume do not contribute. */
+    const OutputVectorType & pointGradient = this->m_PointGradients[ pointIndex ];
+    if( pointGradient.GetSquaredNorm() == 0.0 )
+    {
+      continue;
+    }
+
+    /** Get the TransformJacobian dT/dmu. */
+    this->m_Transform->GetJacobian( fixedPoints->ElementAt( pointIndex ), jacobian, nzji );
+    this->AccumulateDerivativeOfPoint( threadId, jacobian, nzji, pointGradient );
+  }
+
+} // end ThreadedGetValueAndDerivativeOfPoints()
 
 
 /**
@@ -28,6 +28,10 @@ namespace elastix
  * \class NormalizedGradientCorrelationMetric
  * \brief An metric based on the itk::NormalizedGradientCorrelationImageToImageMetric.
  *
+ * With a RayCastInterpolator the metric is used for 2D-3D registration, which
+ * requires a 3D fixed image of one slice thick. With any other interpolator
+ * it registers images of the same dimension, for example two 3D volumes, and
+ * its derivative is computed analytically.
  *
  * \ingroup Metrics
  *
@@ -132,13 +136,6 @@ public:
    */
   void Initialize( void ) override;
 
-  /**
-   * Do some things before each resolution:
-   * \li Set CheckNumberOfSamples setting
-   * \li Set UseNormalization setting
-   */
-  void BeforeRegistration( void ) override;
-
   void BeforeEachResolution( void ) override;
 
 protected:
@@ -19,15 +19,13 @@
 #define __itkNormalizedGradientCorrelationImageToImageMetric_h
 
 #include "itkAdvancedImageToImageMetric.h"
-#include "itkSobelOperator.h"
-#include "itkNeighborhoodOperatorImageFilter.h"
 #include "itkPoint.h"
-#include "itkCastImageFilter.h"
-#include "itkResampleImageFilter.h"
 #include "itkOptimizer.h"
 #include "itkAdvancedCombinationTransform.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -35,6 +33,34 @@ namespace itk
  * \class NormalizedGradientCorrelationImageToImageMetric
  * \brief An metric based on the itk::NormalizedGradientCorrelationImageToImageMetric.
  *
+ * The metric correlates the Sobel gradients of the fixed image with those of
+ * the moved image. The fixed image gradients are computed once per
+ * resolution, in Initialize(). At each evaluation the moving image is only
+ * evaluated at the pixels needed by the Sobel stencils of the fixed image
+ * pixels inside the mask, after which the correlation terms are accumulated.
+ * Both steps are multi-threaded when UseMultiThread is set.
+ *
+ * Two registration types are supported. With a ray cast interpolator the
+ * fixed image is a projection (a 3D image of one slice thick) of the moving
+ * volume, i.e. 2D-3D registration. The derivative is then computed by finite
+ * differences, using the DerivativeDelta and the Scales. With any other
+ * interpolator the fixed and moving images are of the same kind, for example
+ * two 3D volumes, and the moving image is interpolated at the transformed
+ * fixed image pixels. The derivative is then computed analytically: the
+ * derivative of the measure to the Sobel gradients of the moved image is
+ * propagated back through the Sobel stencils to the moved image pixels, and
+ * multiplied with the interpolator gradient and the transform Jacobian there.
+ * Pixels that are mapped outside the moving image have a value of 0.
+ *
+ * The boundary handling is that of the original implementation, which
+ * projected the moving image on the complete fixed image grid and applied
+ * Sobel filters with zero flux Neumann boundary conditions to both images:
+ * the stencils of pixels at the border of the fixed image (largest possible
+ * region) use the nearest pixel inside, while the stencils of pixels at the
+ * border of the fixed image region use the pixels just outside of it.
+ * Two things differ from the original implementation: the projected moving
+ * image values are no longer rounded to the fixed image pixel type, and a
+ * zero gradient variance gives a value of 0 instead of NaN.
  *
  * \ingroup Metrics
  *
@@ -83,45 +109,28 @@ public:
   typedef typename Superclass::FixedImageConstPointer  FixedImageConstPointer;
   typedef typename Superclass::MovingImageConstPointer MovingImageConstPointer;
   typedef typename Superclass::MovingImagePointer      MovingImagePointer;
+  typedef typename Superclass::DerivativeValueType     DerivativeValueType;
   typedef typename TFixedImage::PixelType              FixedImagePixelType;
   typedef typename TMovingImage::PixelType             MovedImagePixelType;
   typedef typename itk::Optimizer                      OptimizerType;
   typedef typename OptimizerType::ScalesType           ScalesType;
 
   itkStaticConstMacro( FixedImageDimension, unsigned int, TFixedImage::ImageDimension );
+  itkStaticConstMacro( MovingImageDimension, unsigned int, TMovingImage::ImageDimension );
 
   /** Types for transforming the moving image */
   typedef typename itk::AdvancedCombinationTransform<
     ScalarType, FixedImageDimension >                    CombinationTransformType;
   typedef typename CombinationTransformType::Pointer CombinationTransformPointer;
-  typedef itk::Image< FixedImagePixelType,
-    itkGetStaticConstMacro( FixedImageDimension ) >   TransformedMovingImageType;
-  typedef itk::Image< unsigned char,
-    itkGetStaticConstMacro( FixedImageDimension ) >   MaskImageType;
-  typedef typename MaskImageType::Pointer MaskImageTypePointer;
-  typedef itk::ResampleImageFilter<
-    MovingImageType, TransformedMovingImageType >       TransformMovingImageFilterType;
-  typedef typename TransformMovingImageFilterType::Pointer TransformMovingImageFilterPointer;
   typedef typename itk::AdvancedRayCastInterpolateImageFunction
     < MovingImageType, ScalarType >                     RayCastInterpolatorType;
-  typedef typename RayCastInterpolatorType::Pointer RayCastInterpolatorPointer;
-
-  /** Sobel filters to compute the gradients of the Fixed Image */
-  typedef itk::Image< RealType,
-    itkGetStaticConstMacro( FixedImageDimension ) >       FixedGradientImageType;
-  typedef itk::CastImageFilter< FixedImageType,
-    FixedGradientImageType >                              CastFixedImageFilterType;
-  typedef typename CastFixedImageFilterType::Pointer CastFixedImageFilterPointer;
-  typedef typename FixedGradientImageType::PixelType FixedGradientPixelType;
-
-  /** Sobel filters to compute the gradients of the Moved Image */
-  itkStaticConstMacro( MovedImageDimension, unsigned int, MovingImageType::ImageDimension );
-  typedef itk::Image< RealType,
-    itkGetStaticConstMacro( MovedImageDimension ) >       MovedGradientImageType;
-  typedef itk::CastImageFilter< TransformedMovingImageType,
-    MovedGradientImageType >                              CastMovedImageFilterType;
-  typedef typename CastMovedImageFilterType::Pointer CastMovedImageFilterPointer;
-  typedef typename MovedGradientImageType::PixelType MovedGradientPixelType;
+  typedef typename RayCastInterpolatorType::Pointer       RayCastInterpolatorPointer;
+  typedef typename RayCastInterpolatorType::TransformType RayCastTransformType;
+  typedef typename RayCastTransformType::Pointer          RayCastTransformPointer;
+
+  /** Typedefs for the multi-threading. */
+  typedef typename Superclass::ThreaderType   ThreaderType;
+  typedef typename Superclass::ThreadInfoType ThreadInfoType;
 
   /** Get the derivatives of the match measure. */
   void GetDerivative( const TransformParametersType & parameters,
@@ -139,15 +148,13 @@ public:
    */
   void Initialize( void ) override;
 
-  /** Write gradient images to a files for debugging purposes. */
-  void WriteGradientImagesToFiles( void ) const;
-
   /** Set/Get Scales  */
   itkSetMacro( Scales, ScalesType );
   itkGetConstReferenceMacro( Scales, ScalesType );
 
   /** Set/Get the value of Delta used for computing derivatives by finite
-   * differences in the GetDerivative() method.
+   * differences in the GetDerivative() method. Only used for 2D-3D
+   * registration, i.e. with a ray cast interpolator.
    */
   itkSetMacro( DerivativeDelta, double );
   itkGetConstReferenceMacro( DerivativeDelta, double );
@@ -158,21 +165,100 @@ public:
 protected:
 
   NormalizedGradientCorrelationImageToImageMetric();
-  ~NormalizedGradientCorrelationImageToImageMetric() override {}
+  ~NormalizedGradientCorrelationImageToImageMetric() override;
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
-  /** Compute the mean of the fixed and moved image gradients. */
-  void ComputeMeanMovedGradient( void ) const;
+  /** Typedefs for the cached image values. */
+  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
+  typedef std::vector< RealType >                               ImageValueContainerType;
+  typedef std::vector< SizeValueType >                          OffsetContainerType;
+  typedef typename FixedImageType::IndexType                    FixedImageIndexType;
+  typedef typename Superclass::FixedImagePointType              FixedImagePointType;
+  typedef typename Superclass::MovingImagePointType             MovingImagePointType;
+  typedef typename Superclass::MovingImageDerivativeType        MovingImageDerivativeType;
+  typedef typename Superclass::NonZeroJacobianIndicesType       NonZeroJacobianIndicesType;
+
+  /** Compute the Sobel gradient and the mean of the fixed image at all
+   * pixels in the fixed image region that are inside the mask.
+   */
+  void ComputeFixedGradients( void );
+
+  /** Convert an offset in the stencil region to a position per dimension,
+   * and compute the strides of the stencil region.
+   */
+  void ComputeStencilPosition( SizeValueType offset,
+    SizeValueType * position, SizeValueType * stride ) const;
+
+  /** Compute the offset of one of the 3^D Sobel neighbours of a position in
+   * the stencil region. Neighbours outside the stencil region are clamped to
+   * its border, i.e. zero flux Neumann boundary conditions.
+   */
+  SizeValueType ComputeSobelNeighbourOffset( const SizeValueType * position,
+    const SizeValueType * stride, unsigned int neighbour ) const;
+
+  /** Compute the Sobel gradient at a position in the stencil region. */
+  void ComputeSobelGradient( const ImageValueContainerType & imageValues,
+    const SizeValueType offset, RealType * gradient ) const;
+
+  /** Convert an offset in the stencil region to an image index. */
+  FixedImageIndexType ComputeStencilIndex( SizeValueType offset ) const;
+
+  /** Compute the moved image values at the pixels in a range of
+   * m_MovedImageOffsets, and optionally the moving image gradients there.
+   */
+  void ComputeMovedImageValues( const SizeValueType begin, const SizeValueType end,
+    const bool computeGradients ) const;
+
+  /** Compute the moved image values and accumulate the correlation terms
+   * over all samples, single- or multi-threaded.
+   */
+  void ComputeGradientCorrelation( const TransformParametersType & parameters,
+    const bool computeGradients, SizeValueType & numberOfPixelsCounted,
+    AccumulateType & sfm, AccumulateType & smm, AccumulateType * sm ) const;
+
+  /** Sum the correlation terms of all threads. */
+  void GatherGradientCorrelation( SizeValueType & numberOfPixelsCounted,
+    AccumulateType & sfm, AccumulateType & smm, AccumulateType * sm ) const;
+
+  /** Accumulate the correlation terms over a range of samples. */
+  void AccumulateGradientCorrelation( const SizeValueType begin, const SizeValueType end,
+    SizeValueType & numberOfPixelsCounted, AccumulateType & sfm,
+    AccumulateType & smm, AccumulateType * sm ) const;
+
+  /** Compute the similarity measure from the accumulated terms. */
+  MeasureType ComputeMeasure( const SizeValueType numberOfPixelsCounted,
+    const AccumulateType sfm, const AccumulateType smm, const AccumulateType * sm ) const;
+
+  /** Compute the derivative of the measure to the moved image values, by
+   * propagating its derivative to the moved image gradients back through the
+   * Sobel stencils. Returns false if the measure is 0 because of a too small
+   * denominator, in which case the derivative is 0 as well.
+   */
+  bool ComputeMovedImageAdjoints( const SizeValueType numberOfPixelsCounted,
+    const AccumulateType sfm, const AccumulateType smm, const AccumulateType * sm ) const;
+
+  /** Accumulate the derivative over a range of m_MovedImageOffsets. */
+  void AccumulateDerivative( const SizeValueType begin, const SizeValueType end,
+    DerivativeType & derivative ) const;
+
+  /** Compute the derivative by finite differences, for 2D-3D registration. */
+  void GetDerivativeByFiniteDifferences( const TransformParametersType & parameters,
+    DerivativeType & derivative ) const;
 
-  void ComputeMeanFixedGradient( void ) const;
+  /** Initialize some multi-threading related parameters. */
+  void InitializeThreadingParameters( void ) const override;
 
-  /** Compute the similarity measure  */
-  MeasureType ComputeMeasure( const TransformParametersType & parameters ) const;
+  /** Multi-threaded version of GetValue(). */
+  inline void ThreadedGetValue( ThreadIdType threadID ) override;
 
-  typedef NeighborhoodOperatorImageFilter<
-    FixedGradientImageType, FixedGradientImageType >        FixedSobelFilter;
-  typedef NeighborhoodOperatorImageFilter<
-    MovedGradientImageType, MovedGradientImageType >        MovedSobelFilter;
+  /** Gather the values from all threads. */
+  inline void AfterThreadedGetValue( MeasureType & value ) const override;
+
+  /** ComputeMovedImageValues threader callback function. */
+  static ITK_THREAD_RETURN_TYPE ComputeMovedImageValuesThreaderCallback( void * arg );
+
+  /** AccumulateDerivative threader callback function. */
+  static ITK_THREAD_RETURN_TYPE AccumulateDerivativeThreaderCallback( void * arg );
 
 private:
 
@@ -183,36 +269,62 @@ private:
   double                      m_DerivativeDelta;
   CombinationTransformPointer m_CombinationTransform;
 
-  /** The mean of the moving image gradients. */
-  mutable MovedGradientPixelType m_MeanMovedGradient[ MovedImageDimension ];
-
-  /** The mean of the fixed image gradients. */
-  mutable FixedGradientPixelType m_MeanFixedGradient[ FixedImageDimension ];
-
-  /** The filter for transforming the moving images. */
-  TransformMovingImageFilterPointer m_TransformMovingImageFilter;
-
-  /** The Sobel gradients of the fixed image */
-  CastFixedImageFilterPointer m_CastFixedImageFilter;
-
-  SobelOperator< FixedGradientPixelType,
-  itkGetStaticConstMacro( FixedImageDimension ) >
-  m_FixedSobelOperators[ FixedImageDimension ];
+  /** The ray cast interpolator and the transform that maps the fixed
+   * image points onto the detector.
+   */
+  RayCastInterpolatorPointer m_RayCastInterpolator;
+  RayCastTransformPointer    m_RayCastTransform;
 
-  typename FixedSobelFilter::Pointer m_FixedSobelFilters
-  [ itkGetStaticConstMacro( FixedImageDimension ) ];
+  /** The fixed image region padded by the radius of the Sobel stencil,
+   * cropped to the largest possible region. The cached image values are
+   * stored in the buffer order of this region.
+   */
+  FixedImageRegionType m_StencilRegion;
 
-  ZeroFluxNeumannBoundaryCondition< MovedGradientImageType > m_MovedBoundCond;
-  ZeroFluxNeumannBoundaryCondition< FixedGradientImageType > m_FixedBoundCond;
+  /** The Sobel stencil weights, per neighbour and dimension. */
+  ImageValueContainerType m_SobelWeights;
 
-  /** The Sobel gradients of the moving image */
-  CastMovedImageFilterPointer m_CastMovedImageFilter;
-  SobelOperator< MovedGradientPixelType,
-  itkGetStaticConstMacro( MovedImageDimension ) >
-  m_MovedSobelOperators[ MovedImageDimension ];
+  /** Offsets of the samples, the pixels of the fixed image region inside
+   * the mask, and their mean-subtracted fixed image gradients.
+   */
+  OffsetContainerType     m_SampleOffsets;
+  ImageValueContainerType m_FixedGradients;
+  AccumulateType          m_FixedGradientsSquaredNorm;
+
+  /** Offsets of the pixels that are used by the Sobel stencils of the
+   * samples, and the moved image values at these pixels. For the analytic
+   * derivative also the moving image gradients at these pixels, in the order
+   * of m_MovedImageOffsets, and the derivative of the measure to the moved
+   * image values.
+   */
+  OffsetContainerType             m_MovedImageOffsets;
+  mutable ImageValueContainerType m_MovedImageValues;
+  mutable ImageValueContainerType m_MovedImageGradients;
+  mutable ImageValueContainerType m_MovedImageAdjoints;
 
-  typename MovedSobelFilter::Pointer m_MovedSobelFilters[
-    itkGetStaticConstMacro( MovedImageDimension ) ];
+  /** Helper struct that multi-threads the computation of the moved image
+   * values and of the derivative using ITK threads.
+   */
+  struct MultiThreaderComputeMovedImageValuesType
+  {
+    const Self * st_Metric;
+    bool         st_ComputeGradients;
+  };
+
+  /** Per-thread accumulation of the correlation terms. */
+  struct GradientCorrelationGetValuePerThreadStruct
+  {
+    SizeValueType  st_NumberOfPixelsCounted;
+    AccumulateType st_Sfm;
+    AccumulateType st_Smm;
+    AccumulateType st_Sm[ FixedImageDimension ];
+  };
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, GradientCorrelationGetValuePerThreadStruct,
+    PaddedGradientCorrelationGetValuePerThreadStruct );
+  itkAlignedTypedef( ITK_CACHE_LINE_ALIGNMENT, PaddedGradientCorrelationGetValuePerThreadStruct,
+    AlignedGradientCorrelationGetValuePerThreadStruct );
+  mutable AlignedGradientCorrelationGetValuePerThreadStruct * m_GradientCorrelationGetValuePerThreadVariables;
+  mutable ThreadIdType                                        m_GradientCorrelationGetValuePerThreadVariablesSize;
 
 };
 
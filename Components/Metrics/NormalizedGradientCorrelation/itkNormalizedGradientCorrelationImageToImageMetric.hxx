@@ -21,11 +21,9 @@
 #include "itkNormalizedGradientCorrelationImageToImageMetric.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
 #include "itkNumericTraits.h"
-#include "itkSimpleFilterWatcher.h"
 
-#include <iostream>
-#include <iomanip>
-#include <stdio.h>
+#include <algorithm>
+#include <cmath>
 
 namespace itk
 {
@@ -38,21 +36,28 @@ template< class TFixedImage, class TMovingImage >
 NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::NormalizedGradientCorrelationImageToImageMetric()
 {
-  this->m_CastFixedImageFilter       = CastFixedImageFilterType::New();
-  this->m_CastMovedImageFilter       = CastMovedImageFilterType::New();
-  this->m_CombinationTransform       = CombinationTransformType::New();
-  this->m_TransformMovingImageFilter = TransformMovingImageFilterType::New();
-  this->m_DerivativeDelta            = 0.001;
+  this->m_CombinationTransform      = CombinationTransformType::New();
+  this->m_DerivativeDelta           = 0.001;
+  this->m_FixedGradientsSquaredNorm = NumericTraits< AccumulateType >::Zero;
 
-  for( unsigned int iDimension = 0; iDimension < MovedImageDimension; iDimension++ )
-  {
-    this->m_MeanFixedGradient[ iDimension ] = 0;
-    this->m_MeanMovedGradient[ iDimension ] = 0;
-  }
+  this->m_GradientCorrelationGetValuePerThreadVariables     = NULL;
+  this->m_GradientCorrelationGetValuePerThreadVariablesSize = 0;
 
 } // end Constructor
 
 
+/**
+ * ******************* Destructor *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::~NormalizedGradientCorrelationImageToImageMetric()
+{
+  delete[] this->m_GradientCorrelationGetValuePerThreadVariables;
+} // end Destructor
+
+
 /**
  * ***************** Initialize *****************
  */
@@ -65,62 +70,58 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   /** Initialize the base class */
   Superclass::Initialize();
 
-  unsigned int iFilter;
-
-  /** Compute the gradient of the fixed images */
-  this->m_CastFixedImageFilter->SetInput( this->m_FixedImage );
-  this->m_CastFixedImageFilter->Update();
-
-  for( iFilter = 0; iFilter < FixedImageDimension; iFilter++ )
-  {
-    this->m_FixedSobelOperators[ iFilter ].SetDirection( iFilter );
-    this->m_FixedSobelOperators[ iFilter ].CreateDirectional();
-    this->m_FixedSobelFilters[ iFilter ] = FixedSobelFilter::New();
-    this->m_FixedSobelFilters[ iFilter ]->OverrideBoundaryCondition( &this->m_FixedBoundCond );
-    this->m_FixedSobelFilters[ iFilter ]->SetOperator( this->m_FixedSobelOperators[ iFilter ] );
-    this->m_FixedSobelFilters[ iFilter ]->SetInput( this->m_CastFixedImageFilter->GetOutput() );
-    this->m_FixedSobelFilters[ iFilter ]->UpdateLargestPossibleRegion();
-  }
-
-  this->ComputeMeanFixedGradient();
-
-  /** Resampling for 3D->2D */
+  /** Resampling for 3D->2D: the moving image is ray cast onto the fixed image. */
   RayCastInterpolatorType * rayCaster = dynamic_cast< RayCastInterpolatorType * >(
     const_cast< InterpolatorType * >( this->GetInterpolator() ) );
   if( rayCaster != 0 )
   {
-    this->m_TransformMovingImageFilter->SetTransform( rayCaster->GetTransform() );
+    if( FixedImageDimension != 3
+      || this->m_FixedImage->GetLargestPossibleRegion().GetSize()[ FixedImageDimension - 1 ] != 1 )
+    {
+      itkExceptionMacro( << "ERROR: with a RayCastInterpolator the NormalizedGradientCorrelationImageToImageMetric "
+                         << "can only be used for 2D-3D registration.\n"
+                         << "  Therefore it expects a 3D fixed image with FixedImageSize[2] equal to 1." );
+    }
+    this->m_RayCastInterpolator = rayCaster;
+    this->m_RayCastTransform    = rayCaster->GetTransform();
   }
   else
   {
-    itkExceptionMacro( << "ERROR: the NormalizedGradientCorrelationImageToImageMetric is currently "
-                       << "only suitable for 2D-3D registration.\n"
-                       << "  Therefore it expects an interpolator of type RayCastInterpolator." );
+    /** Otherwise the moving image is interpolated at the transformed fixed image pixels. */
+    this->m_RayCastInterpolator = 0;
+    this->m_RayCastTransform    = 0;
   }
-  this->m_TransformMovingImageFilter->SetInterpolator( this->m_Interpolator );
-  this->m_TransformMovingImageFilter->SetInput( this->m_MovingImage );
-  this->m_TransformMovingImageFilter->SetDefaultPixelValue( 0 );
-  this->m_TransformMovingImageFilter->SetSize( this->m_FixedImage->GetLargestPossibleRegion().GetSize() );
-  this->m_TransformMovingImageFilter->SetOutputOrigin( this->m_FixedImage->GetOrigin() );
-  this->m_TransformMovingImageFilter->SetOutputSpacing( this->m_FixedImage->GetSpacing() );
-  this->m_TransformMovingImageFilter->SetOutputDirection( this->m_FixedImage->GetDirection() );
-  this->m_TransformMovingImageFilter->Update();
 
-  this->m_CastMovedImageFilter->SetInput(
-    this->m_TransformMovingImageFilter->GetOutput() );
+  /** Compute the gradients of the fixed image once for this resolution. */
+  this->ComputeFixedGradients();
 
-  for( iFilter = 0; iFilter < MovedImageDimension; iFilter++ )
+} // end Initialize()
+
+
+/**
+ * ******************* InitializeThreadingParameters *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeThreadingParameters( void ) const
+{
+  /** Initialize the superclass parameters. */
+  Superclass::InitializeThreadingParameters();
+
+  const ThreadIdType numberOfThreads = Self::GetNumberOfThreads();
+
+  /** Only resize the array of structs when needed. */
+  if( this->m_GradientCorrelationGetValuePerThreadVariablesSize != numberOfThreads )
   {
-    this->m_MovedSobelOperators[ iFilter ].SetDirection( iFilter );
-    this->m_MovedSobelOperators[ iFilter ].CreateDirectional();
-    this->m_MovedSobelFilters[ iFilter ] = MovedSobelFilter::New();
-    this->m_MovedSobelFilters[ iFilter ]->OverrideBoundaryCondition( &this->m_MovedBoundCond );
-    this->m_MovedSobelFilters[ iFilter ]->SetOperator( this->m_MovedSobelOperators[ iFilter ] );
-    this->m_MovedSobelFilters[ iFilter ]->SetInput( this->m_CastMovedImageFilter->GetOutput() );
-    this->m_MovedSobelFilters[ iFilter ]->UpdateLargestPossibleRegion();
+    delete[] this->m_GradientCorrelationGetValuePerThreadVariables;
+    this->m_GradientCorrelationGetValuePerThreadVariables
+      = new AlignedGradientCorrelationGetValuePerThreadStruct[ numberOfThreads ];
+    this->m_GradientCorrelationGetValuePerThreadVariablesSize = numberOfThreads;
   }
 
-} // end Initialize()
+} // end InitializeThreadingParameters()
 
 
 /**
@@ -134,280 +135,525 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 {
   Superclass::PrintSelf( os, indent );
   os << indent << "DerivativeDelta: " << this->m_DerivativeDelta << std::endl;
+  os << indent << "StencilRegion: " << this->m_StencilRegion << std::endl;
+  os << indent << "NumberOfSamples: " << this->m_SampleOffsets.size() << std::endl;
 } // end PrintSelf()
 
 
 /**
- * ***************** ComputeMeanFixedGradient *****************
+ * ***************** ComputeStencilIndex *****************
  */
 
 template< class TFixedImage, class TMovingImage >
-void
+typename NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >::FixedImageIndexType
 NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
-::ComputeMeanFixedGradient( void ) const
+::ComputeStencilIndex( SizeValueType offset ) const
 {
-  typename FixedGradientImageType::IndexType currentIndex;
-  typename FixedGradientImageType::PointType point;
+  const typename FixedImageRegionType::SizeType & size = this->m_StencilRegion.GetSize();
 
-  for( int iDimension = 0; iDimension < FixedImageDimension; iDimension++ )
+  FixedImageIndexType index = this->m_StencilRegion.GetIndex();
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
   {
-    this->m_FixedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
+    index[ i ] += static_cast< IndexValueType >( offset % size[ i ] );
+    offset     /= size[ i ];
   }
+  return index;
 
-  typedef  itk::ImageRegionConstIteratorWithIndex< FixedGradientImageType >
-    FixedIteratorType;
-  FixedIteratorType fixedIteratorx( this->m_FixedSobelFilters[ 0 ]->GetOutput(),
-  this->GetFixedImageRegion() );
-  FixedIteratorType fixedIteratory( this->m_FixedSobelFilters[ 1 ]->GetOutput(),
-  this->GetFixedImageRegion() );
+} // end ComputeStencilIndex()
 
-  fixedIteratorx.GoToBegin();
-  fixedIteratory.GoToBegin();
 
-  bool                   sampleOK = false;
-  FixedGradientPixelType fixedGradient[ FixedImageDimension ];
-  for( int i = 0; i < FixedImageDimension; i++ )
-  {
-    fixedGradient[ i ] = 0.0;
-  }
+/**
+ * ***************** ComputeStencilPosition *****************
+ */
 
-  unsigned long nPixels = 0;
+template< class TFixedImage, class TMovingImage >
+void
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeStencilPosition( SizeValueType offset,
+  SizeValueType * position, SizeValueType * stride ) const
+{
+  const typename FixedImageRegionType::SizeType & size = this->m_StencilRegion.GetSize();
 
-  if( this->m_FixedImageMask.IsNull() )
+  SizeValueType s = 1;
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
   {
-    sampleOK = true;
+    position[ i ] = offset % size[ i ];
+    offset       /= size[ i ];
+    stride[ i ]   = s;
+    s            *= size[ i ];
   }
 
-  while( !fixedIteratorx.IsAtEnd() )
-  {
-    /** Get current index */
-    currentIndex = fixedIteratorx.GetIndex();
-    this->m_FixedImage->TransformIndexToPhysicalPoint( currentIndex, point );
+} // end ComputeStencilPosition()
 
-    /** if fixedMask is given */
-    if( !this->m_FixedImageMask.IsNull() )
+
+/**
+ * ***************** ComputeSobelNeighbourOffset *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+SizeValueType
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeSobelNeighbourOffset( const SizeValueType * position,
+  const SizeValueType * stride, unsigned int neighbour ) const
+{
+  const typename FixedImageRegionType::SizeType & size = this->m_StencilRegion.GetSize();
+
+  SizeValueType neighbourOffset = 0;
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
+  {
+    const unsigned int o = neighbour % 3;
+    neighbour /= 3;
+    SizeValueType p = position[ i ];
+    if( o == 0 && p > 0 )
     {
-      if( this->m_FixedImageMask->IsInside( point ) )
-      {
-        sampleOK = true;
-      }
-      else
-      {
-        sampleOK = false;
-      }
+      --p;
     }
-
-    if( sampleOK )
+    else if( o == 2 && p + 1 < size[ i ] )
     {
-      fixedGradient[ 0 ] += fixedIteratorx.Get();
-      fixedGradient[ 1 ] += fixedIteratory.Get();
-      nPixels++;
+      ++p;
     }
+    neighbourOffset += p * stride[ i ];
+  }
+  return neighbourOffset;
 
-    ++fixedIteratorx;
-    ++fixedIteratory;
-  } // end while
-
-  this->m_MeanFixedGradient[ 0 ] = fixedGradient[ 0 ] / nPixels;
-  this->m_MeanFixedGradient[ 1 ] = fixedGradient[ 1 ] / nPixels;
-
-} // end ComputeMeanFixedGradient()
+} // end ComputeSobelNeighbourOffset()
 
 
 /**
- * ***************** ComputeMeanMovedGradient *****************
+ * ***************** ComputeSobelGradient *****************
  */
 
 template< class TFixedImage, class TMovingImage >
 void
 NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
-::ComputeMeanMovedGradient( void ) const
+::ComputeSobelGradient( const ImageValueContainerType & imageValues,
+  const SizeValueType offset, RealType * gradient ) const
 {
-  typename MovedGradientImageType::IndexType currentIndex;
-  typename MovedGradientImageType::PointType point;
-
-  for( int iDimension = 0; iDimension < MovedImageDimension; iDimension++ )
+  /** Position of the pixel in the stencil region, and the strides. */
+  SizeValueType position[ FixedImageDimension ];
+  SizeValueType stride[ FixedImageDimension ];
+  this->ComputeStencilPosition( offset, position, stride );
+  std::fill( gradient, gradient + FixedImageDimension, NumericTraits< RealType >::Zero );
+
+  /** Loop over the 3^D neighbours. */
+  const unsigned int numberOfNeighbours = this->m_SobelWeights.size() / FixedImageDimension;
+  for( unsigned int n = 0; n < numberOfNeighbours; ++n )
   {
-    this->m_MovedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
+    const RealType   value   = imageValues[ this->ComputeSobelNeighbourOffset( position, stride, n ) ];
+    const RealType * weights = &this->m_SobelWeights[ n * FixedImageDimension ];
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      gradient[ i ] += weights[ i ] * value;
+    }
   }
 
-  typedef  itk::ImageRegionConstIteratorWithIndex< MovedGradientImageType >
-    MovedIteratorType;
-
-  MovedIteratorType movedIteratorx( this->m_MovedSobelFilters[ 0 ]->GetOutput(),
-  this->GetFixedImageRegion() );
-  MovedIteratorType movedIteratory( this->m_MovedSobelFilters[ 1 ]->GetOutput(),
-  this->GetFixedImageRegion() );
+} // end ComputeSobelGradient()
 
-  movedIteratorx.GoToBegin();
-  movedIteratory.GoToBegin();
 
-  bool sampleOK = false;
+/**
+ * ***************** ComputeFixedGradients *****************
+ */
 
-  if( this->m_FixedImageMask.IsNull() )
+template< class TFixedImage, class TMovingImage >
+void
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeFixedGradients( void )
+{
+  /** The stencil region: the fixed image region padded by one pixel. */
+  this->m_StencilRegion = this->GetFixedImageRegion();
+  this->m_StencilRegion.PadByRadius( 1 );
+  this->m_StencilRegion.Crop( this->m_FixedImage->GetLargestPossibleRegion() );
+  const SizeValueType numberOfStencilPixels = this->m_StencilRegion.GetNumberOfPixels();
+
+  /** The Sobel weights: a derivative kernel [-1 0 1] along the gradient
+   * direction, and a smoothing kernel [1 2 1] along the other directions.
+   */
+  const RealType derivativeKernel[ 3 ] = { -1.0, 0.0, 1.0 };
+  const RealType smoothingKernel[ 3 ]  = { 1.0, 2.0, 1.0 };
+  unsigned int   numberOfNeighbours    = 1;
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
   {
-    sampleOK = true;
+    numberOfNeighbours *= 3;
   }
-
-  MovedGradientPixelType movedGradient[ MovedImageDimension ];
-
-  for( int i = 0; i < MovedImageDimension; i++ )
+  this->m_SobelWeights.assign( numberOfNeighbours * FixedImageDimension, 1.0 );
+  for( unsigned int n = 0; n < numberOfNeighbours; ++n )
   {
-    movedGradient[ i ] = 0.0;
+    unsigned int code = n;
+    for( unsigned int j = 0; j < FixedImageDimension; ++j )
+    {
+      const unsigned int o = code % 3;
+      code /= 3;
+      for( unsigned int i = 0; i < FixedImageDimension; ++i )
+      {
+        this->m_SobelWeights[ n * FixedImageDimension + i ]
+          *= ( i == j ) ? derivativeKernel[ o ] : smoothingKernel[ o ];
+      }
+    }
   }
 
-  unsigned long nPixels = 0;
+  /** Copy the fixed image values in the stencil region. */
+  ImageValueContainerType fixedImageValues( numberOfStencilPixels );
+  typedef ImageRegionConstIteratorWithIndex< FixedImageType > FixedIteratorType;
+  FixedIteratorType fixedIterator( this->m_FixedImage, this->m_StencilRegion );
+  SizeValueType     offset = 0;
+  for( fixedIterator.GoToBegin(); !fixedIterator.IsAtEnd(); ++fixedIterator, ++offset )
+  {
+    fixedImageValues[ offset ] = static_cast< RealType >( fixedIterator.Get() );
+  }
 
-  while( !movedIteratorx.IsAtEnd() )
+  /** Collect the samples: the pixels of the fixed image region that are
+   * inside the mask. Mark the pixels that their Sobel stencils use.
+   */
+  this->m_SampleOffsets.clear();
+  std::vector< unsigned char > isUsed( numberOfStencilPixels, 0 );
+  const FixedImageRegionType & fixedImageRegion = this->GetFixedImageRegion();
+  const FixedImageIndexType &  stencilStart     = this->m_StencilRegion.GetIndex();
+  const typename FixedImageRegionType::SizeType & stencilSize = this->m_StencilRegion.GetSize();
+  for( offset = 0; offset < numberOfStencilPixels; ++offset )
   {
-    /** Get current index */
-    currentIndex = movedIteratorx.GetIndex();
-    this->m_FixedImage->TransformIndexToPhysicalPoint( currentIndex, point );
+    const FixedImageIndexType index = this->ComputeStencilIndex( offset );
+    if( !fixedImageRegion.IsInside( index ) )
+    {
+      continue;
+    }
 
-    /** if fixedMask is given */
     if( !this->m_FixedImageMask.IsNull() )
     {
-      if( this->m_FixedImageMask->IsInside( point ) )
+      typename FixedImageType::PointType point;
+      this->m_FixedImage->TransformIndexToPhysicalPoint( index, point );
+      if( !this->m_FixedImageMask->IsInside( point ) )
       {
-        sampleOK = true;
+        continue;
       }
-      else
+    }
+
+    this->m_SampleOffsets.push_back( offset );
+
+    /** Mark the 3^D neighbours, clamped to the stencil region. */
+    for( unsigned int n = 0; n < numberOfNeighbours; ++n )
+    {
+      SizeValueType neighbourOffset = 0;
+      SizeValueType stride          = 1;
+      unsigned int  code            = n;
+      for( unsigned int i = 0; i < FixedImageDimension; ++i )
       {
-        sampleOK = false;
+        const IndexValueType o = static_cast< IndexValueType >( code % 3 ) - 1;
+        code /= 3;
+        const IndexValueType last = static_cast< IndexValueType >( stencilSize[ i ] ) - 1;
+        const IndexValueType p    = std::min( std::max( index[ i ] - stencilStart[ i ] + o,
+          static_cast< IndexValueType >( 0 ) ), last );
+        neighbourOffset += static_cast< SizeValueType >( p ) * stride;
+        stride          *= stencilSize[ i ];
       }
+      isUsed[ neighbourOffset ] = 1;
     }
+  }
 
-    if( sampleOK )
-    {
-      movedGradient[ 0 ] += movedIteratorx.Get();
-      movedGradient[ 1 ] += movedIteratory.Get();
-      nPixels++;
-    } // end if sampleOK
+  const SizeValueType numberOfSamples = this->m_SampleOffsets.size();
+  if( numberOfSamples == 0 )
+  {
+    itkExceptionMacro( << "ERROR: the fixed image region contains no pixels inside the mask." );
+  }
 
-    ++movedIteratorx;
-    ++movedIteratory;
-  } // end while
+  this->m_MovedImageOffsets.clear();
+  for( offset = 0; offset < numberOfStencilPixels; ++offset )
+  {
+    if( isUsed[ offset ] )
+    {
+      this->m_MovedImageOffsets.push_back( offset );
+    }
+  }
+  this->m_MovedImageValues.assign( numberOfStencilPixels, NumericTraits< RealType >::Zero );
+  this->m_MovedImageGradients.clear();
+  this->m_MovedImageAdjoints.clear();
+
+  /** Compute the fixed image gradients and their mean. */
+  this->m_FixedGradients.resize( numberOfSamples * FixedImageDimension );
+  RealType meanFixedGradient[ FixedImageDimension ];
+  std::fill( meanFixedGradient, meanFixedGradient + FixedImageDimension, NumericTraits< RealType >::Zero );
+  for( SizeValueType k = 0; k < numberOfSamples; ++k )
+  {
+    RealType * fixedGradient = &this->m_FixedGradients[ k * FixedImageDimension ];
+    this->ComputeSobelGradient( fixedImageValues, this->m_SampleOffsets[ k ], fixedGradient );
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      meanFixedGradient[ i ] += fixedGradient[ i ];
+    }
+  }
 
-  this->m_MeanMovedGradient[ 0 ] = movedGradient[ 0 ] / nPixels;
-  this->m_MeanMovedGradient[ 1 ] = movedGradient[ 1 ] / nPixels;
+  /** Subtract the mean, so that the cross correlation does not need the
+   * mean of the moved image gradients.
+   */
+  this->m_FixedGradientsSquaredNorm = NumericTraits< AccumulateType >::Zero;
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
+  {
+    meanFixedGradient[ i ] /= static_cast< RealType >( numberOfSamples );
+  }
+  for( SizeValueType k = 0; k < numberOfSamples; ++k )
+  {
+    RealType * fixedGradient = &this->m_FixedGradients[ k * FixedImageDimension ];
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      fixedGradient[ i ]                -= meanFixedGradient[ i ];
+      this->m_FixedGradientsSquaredNorm += fixedGradient[ i ] * fixedGradient[ i ];
+    }
+  }
 
-} // end ComputeMeanMovedGradient()
+} // end ComputeFixedGradients()
 
 
 /**
- * ***************** ComputeMeasure *****************
+ * ***************** ComputeMovedImageValues *****************
  */
 
 template< class TFixedImage, class TMovingImage >
-typename NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+void
 NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
-::ComputeMeasure( const TransformParametersType & parameters ) const
+::ComputeMovedImageValues( const SizeValueType begin, const SizeValueType end,
+  const bool computeGradients ) const
 {
-  this->SetTransformParameters( parameters );
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
+  FixedImagePointType       fixedPoint;
+  MovingImagePointType      mappedPoint;
+  MovingImageDerivativeType movingImageDerivative;
+  for( SizeValueType k = begin; k < end; ++k )
+  {
+    const SizeValueType offset = this->m_MovedImageOffsets[ k ];
+    this->m_FixedImage->TransformIndexToPhysicalPoint( this->ComputeStencilIndex( offset ), fixedPoint );
 
-  typename FixedImageType::IndexType currentIndex;
-  typename FixedImageType::PointType point;
+    /** Project the moving image onto the fixed image pixel. The ray caster
+     * accepts any point, so no buffer check is needed.
+     */
+    if( this->m_RayCastInterpolator.IsNotNull() )
+    {
+      const typename RayCastTransformType::OutputPointType rayCastPoint
+        = this->m_RayCastTransform->TransformPoint( fixedPoint );
+      this->m_MovedImageValues[ offset ]
+        = static_cast< RealType >( this->m_RayCastInterpolator->Evaluate( rayCastPoint ) );
+      continue;
+    }
+
+    /** Interpolate the moving image at the transformed fixed image pixel.
+     * Pixels that are mapped outside the moving image have a value and a
+     * gradient of 0.
+     */
+    RealType movingImageValue = NumericTraits< RealType >::Zero;
+    bool     sampleOk         = this->TransformPoint( fixedPoint, mappedPoint );
+    if( sampleOk )
+    {
+      sampleOk = this->EvaluateMovingImageValueAndDerivative( mappedPoint, movingImageValue,
+        computeGradients ? &movingImageDerivative : 0 );
+    }
+    this->m_MovedImageValues[ offset ] = sampleOk ? movingImageValue : NumericTraits< RealType >::Zero;
+
+    if( computeGradients )
+    {
+      RealType * movedImageGradient = &this->m_MovedImageGradients[ k * MovingImageDimension ];
+      for( unsigned int i = 0; i < MovingImageDimension; ++i )
+      {
+        movedImageGradient[ i ] = sampleOk
+          ? static_cast< RealType >( movingImageDerivative[ i ] ) : NumericTraits< RealType >::Zero;
+      }
+    }
+  }
 
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
+} // end ComputeMovedImageValues()
 
-  MovedGradientPixelType NmovedGradient[ FixedImageDimension ];
-  FixedGradientPixelType NfixedGradient[ FixedImageDimension ];
 
-  MeasureType NGcrosscorrelation      = NumericTraits< MeasureType >::Zero;
-  MeasureType NGautocorrelationfixed  = NumericTraits< MeasureType >::Zero;
-  MeasureType NGautocorrelationmoving = NumericTraits< MeasureType >::Zero;
+/**
+ * ***************** AccumulateGradientCorrelation *****************
+ */
 
-  /** Make sure all is updated */
-  for( int iDimension = 0; iDimension < FixedImageDimension; iDimension++ )
+template< class TFixedImage, class TMovingImage >
+void
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::AccumulateGradientCorrelation( const SizeValueType begin, const SizeValueType end,
+  SizeValueType & numberOfPixelsCounted, AccumulateType & sfm,
+  AccumulateType & smm, AccumulateType * sm ) const
+{
+  RealType movedGradient[ FixedImageDimension ];
+  for( SizeValueType k = begin; k < end; ++k )
   {
-    this->m_FixedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
-    this->m_MovedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
+    this->ComputeSobelGradient( this->m_MovedImageValues, this->m_SampleOffsets[ k ], movedGradient );
+
+    const RealType * fixedGradient = &this->m_FixedGradients[ k * FixedImageDimension ];
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      sfm     += fixedGradient[ i ] * movedGradient[ i ];
+      smm     += movedGradient[ i ] * movedGradient[ i ];
+      sm[ i ] += movedGradient[ i ];
+    }
   }
+  numberOfPixelsCounted += end - begin;
 
-  typedef  itk::ImageRegionConstIteratorWithIndex< FixedGradientImageType >
-    FixedIteratorType;
+} // end AccumulateGradientCorrelation()
 
-  FixedIteratorType fixedIteratorx( this->m_FixedSobelFilters[ 0 ]->GetOutput(),
-  this->GetFixedImageRegion() );
-  FixedIteratorType fixedIteratory( this->m_FixedSobelFilters[ 1 ]->GetOutput(),
-  this->GetFixedImageRegion() );
 
-  fixedIteratorx.GoToBegin();
-  fixedIteratory.GoToBegin();
+/**
+ * ***************** ComputeMeasure *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMeasure( const SizeValueType numberOfPixelsCounted,
+  const AccumulateType sfm, const AccumulateType smm, const AccumulateType * sm ) const
+{
+  /** The fixed gradients have zero mean, so only the auto correlation of
+   * the moved gradients needs the mean to be subtracted.
+   */
+  AccumulateType smmCentered = smm;
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
+  {
+    smmCentered -= sm[ i ] * sm[ i ] / static_cast< AccumulateType >( numberOfPixelsCounted );
+  }
 
-  typedef  itk::ImageRegionConstIteratorWithIndex< MovedGradientImageType >
-    MovedIteratorType;
+  /** Check for a sufficiently large denominator. */
+  const AccumulateType denom2 = this->m_FixedGradientsSquaredNorm * smmCentered;
+  if( !( denom2 > 1e-28 ) )
+  {
+    return NumericTraits< MeasureType >::Zero;
+  }
+  return static_cast< MeasureType >( -1.0 * sfm / std::sqrt( denom2 ) );
 
-  MovedIteratorType movedIteratorx( this->m_MovedSobelFilters[ 0 ]->GetOutput(),
-  this->GetFixedImageRegion() );
-  MovedIteratorType movedIteratory( this->m_MovedSobelFilters[ 1 ]->GetOutput(),
-  this->GetFixedImageRegion() );
+} // end ComputeMeasure()
 
-  movedIteratorx.GoToBegin();
-  movedIteratory.GoToBegin();
 
-  this->m_NumberOfPixelsCounted = 0;
-  bool sampleOK = false;
+/**
+ * ***************** ComputeMovedImageAdjoints *****************
+ */
 
-  if( this->m_FixedImageMask.IsNull() )
+template< class TFixedImage, class TMovingImage >
+bool
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMovedImageAdjoints( const SizeValueType numberOfPixelsCounted,
+  const AccumulateType sfm, const AccumulateType smm, const AccumulateType * sm ) const
+{
+  /** The mean moved gradient and the centered auto correlation, as in ComputeMeasure(). */
+  AccumulateType meanMovedGradient[ FixedImageDimension ];
+  AccumulateType smmCentered = smm;
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
   {
-    sampleOK = true;
+    meanMovedGradient[ i ] = sm[ i ] / static_cast< AccumulateType >( numberOfPixelsCounted );
+    smmCentered           -= sm[ i ] * meanMovedGradient[ i ];
   }
 
-  while( !fixedIteratorx.IsAtEnd() )
+  const AccumulateType denom2 = this->m_FixedGradientsSquaredNorm * smmCentered;
+  if( !( denom2 > 1e-28 ) )
   {
-    currentIndex = fixedIteratorx.GetIndex();
-    this->m_FixedImage->TransformIndexToPhysicalPoint( currentIndex, point );
+    return false;
+  }
+  const AccumulateType invDenom = 1.0 / std::sqrt( denom2 );
+  const AccumulateType ratio    = sfm / smmCentered;
+
+  /** The derivative of -sfm / sqrt( sff * smm ) to the moved gradient m_k of
+   * sample k is ( -f_k + sfm / smm * ( m_k - mean( m ) ) ) / sqrt( sff * smm ).
+   * The Sobel stencil of sample k scatters it to the moved image pixels that
+   * it uses. Neighbouring stencils share pixels, so this cheap pass is done
+   * single-threaded.
+   */
+  this->m_MovedImageAdjoints.assign( this->m_MovedImageValues.size(), NumericTraits< RealType >::Zero );
+  const unsigned int numberOfNeighbours = this->m_SobelWeights.size() / FixedImageDimension;
+  const SizeValueType numberOfSamples   = this->m_SampleOffsets.size();
+  SizeValueType       position[ FixedImageDimension ];
+  SizeValueType       stride[ FixedImageDimension ];
+  RealType            movedGradient[ FixedImageDimension ];
+  RealType            coefficients[ FixedImageDimension ];
+  for( SizeValueType k = 0; k < numberOfSamples; ++k )
+  {
+    const SizeValueType sampleOffset = this->m_SampleOffsets[ k ];
+    this->ComputeSobelGradient( this->m_MovedImageValues, sampleOffset, movedGradient );
 
-    /** if fixedMask is given */
-    if( !this->m_FixedImageMask.IsNull() )
+    const RealType * fixedGradient = &this->m_FixedGradients[ k * FixedImageDimension ];
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
     {
-      if( this->m_FixedImageMask->IsInside( point ) )
-      {
-        sampleOK = true;
-      }
-      else
+      coefficients[ i ] = static_cast< RealType >(
+        ( -fixedGradient[ i ] + ratio * ( movedGradient[ i ] - meanMovedGradient[ i ] ) ) * invDenom );
+    }
+
+    this->ComputeStencilPosition( sampleOffset, position, stride );
+    for( unsigned int n = 0; n < numberOfNeighbours; ++n )
+    {
+      const RealType * weights = &this->m_SobelWeights[ n * FixedImageDimension ];
+      RealType         adjoint = NumericTraits< RealType >::Zero;
+      for( unsigned int i = 0; i < FixedImageDimension; ++i )
       {
-        sampleOK = false;
+        adjoint += weights[ i ] * coefficients[ i ];
       }
+      this->m_MovedImageAdjoints[ this->ComputeSobelNeighbourOffset( position, stride, n ) ] += adjoint;
     }
+  }
 
-    if( sampleOK )
-    {
-      NmovedGradient[ 0 ]      = movedIteratorx.Get() - this->m_MeanMovedGradient[ 0 ];
-      NfixedGradient[ 0 ]      = fixedIteratorx.Get() - this->m_MeanFixedGradient[ 0 ];
-      NmovedGradient[ 1 ]      = movedIteratory.Get() - this->m_MeanMovedGradient[ 1 ];
-      NfixedGradient[ 1 ]      = fixedIteratory.Get() - this->m_MeanFixedGradient[ 1 ];
-      NGcrosscorrelation      += NmovedGradient[ 0 ] * NfixedGradient[ 0 ] + NmovedGradient[ 1 ] * NfixedGradient[ 1 ];
-      NGautocorrelationmoving += NmovedGradient[ 0 ] * NmovedGradient[ 0 ] + NmovedGradient[ 1 ] * NmovedGradient[ 1 ];
-      NGautocorrelationfixed  += NfixedGradient[ 0 ] * NfixedGradient[ 0 ] + NfixedGradient[ 1 ] * NfixedGradient[ 1 ];
+  return true;
+
+} // end ComputeMovedImageAdjoints()
+
+
+/**
+ * ***************** AccumulateDerivative *****************
+ */
 
-    } // end if sampleOK
+template< class TFixedImage, class TMovingImage >
+void
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::AccumulateDerivative( const SizeValueType begin, const SizeValueType end,
+  DerivativeType & derivative ) const
+{
+  const SizeValueType        nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType nzji( nnzji );
+  DerivativeType             imageJacobian( nnzji );
 
-    ++fixedIteratorx;
-    ++fixedIteratory;
-    ++movedIteratorx;
-    ++movedIteratory;
+  FixedImagePointType       fixedPoint;
+  MovingImageDerivativeType movingImageDerivative;
+  for( SizeValueType k = begin; k < end; ++k )
+  {
+    /** Skip the pixels that do not influence the measure, and the pixels
+     * that are mapped outside the moving image.
+     */
+    const SizeValueType offset  = this->m_MovedImageOffsets[ k ];
+    const RealType      adjoint = this->m_MovedImageAdjoints[ offset ];
+    if( adjoint == NumericTraits< RealType >::Zero )
+    {
+      continue;
+    }
+    const RealType * movedImageGradient = &this->m_MovedImageGradients[ k * MovingImageDimension ];
+    bool             isZeroGradient     = true;
+    for( unsigned int i = 0; i < MovingImageDimension; ++i )
+    {
+      movingImageDerivative[ i ] = adjoint * movedImageGradient[ i ];
+      isZeroGradient             = isZeroGradient && movedImageGradient[ i ] == NumericTraits< RealType >::Zero;
+    }
+    if( isZeroGradient )
+    {
+      continue;
+    }
 
-  } // end while
+    /** Compute the inner product of the transform Jacobian dT/dmu and the
+     * moving image gradient dM/dx, weighted by dNGC/dM.
+     */
+    this->m_FixedImage->TransformIndexToPhysicalPoint( this->ComputeStencilIndex( offset ), fixedPoint );
+    this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+      fixedPoint, movingImageDerivative, imageJacobian, nzji );
 
-  measure = -1.0 * ( NGcrosscorrelation
-    / ( std::sqrt( NGautocorrelationfixed ) * std::sqrt( NGautocorrelationmoving ) ) );
-  return measure;
+    /** Update the derivative, exploiting the sparse Jacobian. */
+    for( SizeValueType j = 0; j < nzji.size(); ++j )
+    {
+      derivative[ nzji[ j ] ] += imageJacobian[ j ];
+    }
+  }
 
-} // end ComputeMeasure()
+} // end AccumulateDerivative()
 
 
 /**
- * ***************** GetValue *****************
+ * ***************** ComputeGradientCorrelation *****************
  */
 
 template< class TFixedImage, class TMovingImage >
-typename NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+void
 NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
-::GetValue( const TransformParametersType & parameters ) const
+::ComputeGradientCorrelation( const TransformParametersType & parameters,
+  const bool computeGradients, SizeValueType & numberOfPixelsCounted,
+  AccumulateType & sfm, AccumulateType & smm, AccumulateType * sm ) const
 {
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
@@ -423,25 +669,186 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
    * - Now you can call GetValueAndDerivative multi-threaded.
    */
   this->BeforeThreadedGetValueAndDerivative( parameters );
-  //this->SetTransformParameters( parameters );
 
-  unsigned int iFilter;
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
+  if( computeGradients )
+  {
+    this->m_MovedImageGradients.resize( this->m_MovedImageOffsets.size() * MovingImageDimension );
+  }
 
-  for( iFilter = 0; iFilter < MovedImageDimension; iFilter++ )
+  /** Single-threaded: compute the moved image and accumulate in one go. */
+  if( !this->m_UseMultiThread )
   {
-    this->m_MovedSobelFilters[ iFilter ]->UpdateLargestPossibleRegion();
+    this->ComputeMovedImageValues( 0, this->m_MovedImageOffsets.size(), computeGradients );
+
+    numberOfPixelsCounted = 0;
+    sfm                   = NumericTraits< AccumulateType >::Zero;
+    smm                   = NumericTraits< AccumulateType >::Zero;
+    std::fill( sm, sm + FixedImageDimension, NumericTraits< AccumulateType >::Zero );
+    this->AccumulateGradientCorrelation( 0, this->m_SampleOffsets.size(),
+      numberOfPixelsCounted, sfm, smm, sm );
+    return;
   }
 
-  this->ComputeMeanMovedGradient();
-  MeasureType currentMeasure = this->ComputeMeasure( parameters );
+  /** Compute the moved image. All values need to be available before the
+   * Sobel stencils are evaluated, hence the separate threaded pass.
+   */
+  MultiThreaderComputeMovedImageValuesType userData;
+  userData.st_Metric           = this;
+  userData.st_ComputeGradients = computeGradients;
+  this->m_Threader->SetSingleMethod( ComputeMovedImageValuesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &userData ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+  /** Launch the threaded accumulation of the correlation terms. */
+  this->LaunchGetValueThreaderCallback();
+
+  /** Gather the results from all threads. */
+  this->GatherGradientCorrelation( numberOfPixelsCounted, sfm, smm, sm );
+
+} // end ComputeGradientCorrelation()
+
+
+/**
+ * ***************** GetValue *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::GetValue( const TransformParametersType & parameters ) const
+{
+  SizeValueType  numberOfPixelsCounted = 0;
+  AccumulateType sfm                   = NumericTraits< AccumulateType >::Zero;
+  AccumulateType smm                   = NumericTraits< AccumulateType >::Zero;
+  AccumulateType sm[ FixedImageDimension ];
+  this->ComputeGradientCorrelation( parameters, false, numberOfPixelsCounted, sfm, smm, sm );
 
-  return currentMeasure;
+  this->m_NumberOfPixelsCounted = numberOfPixelsCounted;
+  return this->ComputeMeasure( numberOfPixelsCounted, sfm, smm, sm );
 
 } // end GetValue()
 
 
+/**
+ * ***************** ComputeMovedImageValuesThreaderCallback *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMovedImageValuesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
+
+  MultiThreaderComputeMovedImageValuesType * temp
+    = static_cast< MultiThreaderComputeMovedImageValuesType * >( infoStruct->UserData );
+
+  const SizeValueType numberOfPixels = temp->st_Metric->m_MovedImageOffsets.size();
+  const SizeValueType subSize        = static_cast< SizeValueType >(
+    std::ceil( static_cast< double >( numberOfPixels ) / static_cast< double >( nrOfThreads ) ) );
+  const SizeValueType pos_begin = std::min( subSize * threadId, numberOfPixels );
+  const SizeValueType pos_end   = std::min( subSize * ( threadId + 1 ), numberOfPixels );
+
+  temp->st_Metric->ComputeMovedImageValues( pos_begin, pos_end, temp->st_ComputeGradients );
+
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end ComputeMovedImageValuesThreaderCallback()
+
+
+/**
+ * ***************** ThreadedGetValue *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValue( ThreadIdType threadId )
+{
+  /** Get the samples for this thread. */
+  const SizeValueType numberOfSamples = this->m_SampleOffsets.size();
+  const SizeValueType nrOfSamplesPerThreads
+    = static_cast< SizeValueType >( std::ceil( static_cast< double >( numberOfSamples )
+    / static_cast< double >( Self::GetNumberOfThreads() ) ) );
+  const SizeValueType pos_begin = std::min( nrOfSamplesPerThreads * threadId, numberOfSamples );
+  const SizeValueType pos_end   = std::min( nrOfSamplesPerThreads * ( threadId + 1 ), numberOfSamples );
+
+  /** Accumulate into the variables of this thread. */
+  GradientCorrelationGetValuePerThreadStruct & threadVariables
+    = this->m_GradientCorrelationGetValuePerThreadVariables[ threadId ];
+  threadVariables.st_NumberOfPixelsCounted = 0;
+  threadVariables.st_Sfm                   = NumericTraits< AccumulateType >::Zero;
+  threadVariables.st_Smm                   = NumericTraits< AccumulateType >::Zero;
+  std::fill( threadVariables.st_Sm, threadVariables.st_Sm + FixedImageDimension,
+    NumericTraits< AccumulateType >::Zero );
+
+  this->AccumulateGradientCorrelation( pos_begin, pos_end,
+    threadVariables.st_NumberOfPixelsCounted, threadVariables.st_Sfm,
+    threadVariables.st_Smm, threadVariables.st_Sm );
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ***************** GatherGradientCorrelation *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::GatherGradientCorrelation( SizeValueType & numberOfPixelsCounted,
+  AccumulateType & sfm, AccumulateType & smm, AccumulateType * sm ) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfThreads();
+
+  /** Accumulate the results of all threads. */
+  numberOfPixelsCounted = 0;
+  sfm                   = NumericTraits< AccumulateType >::Zero;
+  smm                   = NumericTraits< AccumulateType >::Zero;
+  std::fill( sm, sm + FixedImageDimension, NumericTraits< AccumulateType >::Zero );
+  for( ThreadIdType t = 0; t < numberOfThreads; ++t )
+  {
+    const GradientCorrelationGetValuePerThreadStruct & threadVariables
+      = this->m_GradientCorrelationGetValuePerThreadVariables[ t ];
+    numberOfPixelsCounted += threadVariables.st_NumberOfPixelsCounted;
+    sfm                   += threadVariables.st_Sfm;
+    smm                   += threadVariables.st_Smm;
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      sm[ i ] += threadVariables.st_Sm[ i ];
+    }
+  }
+
+} // end GatherGradientCorrelation()
+
+
+/**
+ * ***************** AfterThreadedGetValue *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::AfterThreadedGetValue( MeasureType & value ) const
+{
+  SizeValueType  numberOfPixelsCounted = 0;
+  AccumulateType sfm                   = NumericTraits< AccumulateType >::Zero;
+  AccumulateType smm                   = NumericTraits< AccumulateType >::Zero;
+  AccumulateType sm[ FixedImageDimension ];
+  this->GatherGradientCorrelation( numberOfPixelsCounted, sfm, smm, sm );
+
+  this->m_NumberOfPixelsCounted = numberOfPixelsCounted;
+  value                         = this->ComputeMeasure( numberOfPixelsCounted, sfm, smm, sm );
+
+} // end AfterThreadedGetValue()
+
+
 /**
  * ***************** SetTransformParameters *****************
  */
@@ -461,13 +868,13 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 
 
 /**
- * ***************** GetDerivative *****************
+ * ***************** GetDerivativeByFiniteDifferences *****************
  */
 
 template< class TFixedImage, class TMovingImage >
 void
 NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
-::GetDerivative( const TransformParametersType & parameters,
+::GetDerivativeByFiniteDifferences( const TransformParametersType & parameters,
   DerivativeType & derivative ) const
 {
   TransformParametersType testPoint;
@@ -485,6 +892,28 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     testPoint[ i ]  = parameters[ i ];
   }
 
+} // end GetDerivativeByFiniteDifferences()
+
+
+/**
+ * ***************** GetDerivative *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::GetDerivative( const TransformParametersType & parameters,
+  DerivativeType & derivative ) const
+{
+  if( this->m_RayCastInterpolator.IsNotNull() )
+  {
+    this->GetDerivativeByFiniteDifferences( parameters, derivative );
+    return;
+  }
+
+  MeasureType dummyvalue = NumericTraits< MeasureType >::Zero;
+  this->GetValueAndDerivative( parameters, dummyvalue, derivative );
+
 } // end GetDerivative()
 
 
@@ -498,12 +927,93 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::GetValueAndDerivative( const TransformParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
 {
-  value = this->GetValue( parameters );
-  this->GetDerivative( parameters, derivative );
+  /** For 2D-3D registration the derivative is computed by finite differences. */
+  if( this->m_RayCastInterpolator.IsNotNull() )
+  {
+    value = this->GetValue( parameters );
+    this->GetDerivativeByFiniteDifferences( parameters, derivative );
+    return;
+  }
+
+  /** Compute the moved image values and gradients, and the measure. */
+  SizeValueType  numberOfPixelsCounted = 0;
+  AccumulateType sfm                   = NumericTraits< AccumulateType >::Zero;
+  AccumulateType smm                   = NumericTraits< AccumulateType >::Zero;
+  AccumulateType sm[ FixedImageDimension ];
+  this->ComputeGradientCorrelation( parameters, true, numberOfPixelsCounted, sfm, smm, sm );
+
+  this->m_NumberOfPixelsCounted = numberOfPixelsCounted;
+  value                         = this->ComputeMeasure( numberOfPixelsCounted, sfm, smm, sm );
+
+  /** Propagate the derivative back to the moved image pixels. */
+  derivative.SetSize( this->GetNumberOfParameters() );
+  derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+  if( !this->ComputeMovedImageAdjoints( numberOfPixelsCounted, sfm, smm, sm ) )
+  {
+    return;
+  }
+
+  /** Single-threaded: accumulate the derivative directly. */
+  if( !this->m_UseMultiThread )
+  {
+    this->AccumulateDerivative( 0, this->m_MovedImageOffsets.size(), derivative );
+    return;
+  }
+
+  /** Let each thread accumulate its own derivative over a part of the
+   * moved image pixels, after which these derivatives are summed.
+   */
+  MultiThreaderComputeMovedImageValuesType userData;
+  userData.st_Metric           = this;
+  userData.st_ComputeGradients = true;
+  this->m_Threader->SetSingleMethod( AccumulateDerivativeThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &userData ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+  this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor = 1.0;
+  this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
 
 } // end GetValueAndDerivative()
 
 
+/**
+ * ***************** AccumulateDerivativeThreaderCallback *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::AccumulateDerivativeThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
+
+  MultiThreaderComputeMovedImageValuesType * temp
+    = static_cast< MultiThreaderComputeMovedImageValuesType * >( infoStruct->UserData );
+
+  const SizeValueType numberOfPixels = temp->st_Metric->m_MovedImageOffsets.size();
+  const SizeValueType subSize        = static_cast< SizeValueType >(
+    std::ceil( static_cast< double >( numberOfPixels ) / static_cast< double >( nrOfThreads ) ) );
+  const SizeValueType pos_begin = std::min( subSize * threadId, numberOfPixels );
+  const SizeValueType pos_end   = std::min( subSize * ( threadId + 1 ), numberOfPixels );
+
+  /** The derivatives of the threads are reset by AccumulateDerivativesThreaderCallback(). */
+  temp->st_Metric->AccumulateDerivative( pos_begin, pos_end,
+    temp->st_Metric->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative );
+
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end AccumulateDerivativeThreaderCallback()
+
+
 } // end namespace itk
 
 #endif
@@ -54,6 +54,16 @@ namespace elastix
  *    image, without using a fixed image. Possible values are "true" or "false".
  * \parameter NumEigenValues: number of eigenvalues used in the metric: sum(e) - e, where sum(e)
  *  is the sum of all eigenvalues and e is the sum of the first highest NumEigenValues eigenvalues.
+ * \parameter UsePartialEigenSolver: compute only the NumEigenValues largest eigenpairs with a
+ *    subspace iteration that is warm-started from the previous iteration, instead of a full
+ *    eigendecomposition. This is much cheaper for large groups. When the iteration does not
+ *    converge, the full eigendecomposition is used. Can be given for each resolution. \n
+ *    example: <tt>(UsePartialEigenSolver "true")</tt> \n
+ *    The default is "false".
+ * \parameter MaximumNumberOfEigenSolverIterations: the maximum number of subspace iterations
+ *    before falling back to the full eigendecomposition. Default: 50.
+ * \parameter EigenSolverTolerance: the relative residual at which the subspace iteration is
+ *    considered converged. Default: 1e-6.
  *
  * \ingroup RegistrationMetrics
  * \ingroup Metrics
@@ -61,6 +61,22 @@ PCAMetric< TElastix >
     this->GetComponentLabel(), level, 0 );
   this->SetNumEigenValues( NumEigenValues );
 
+  /** Get and set the settings of the partial eigensolver. */
+  bool usePartialEigenSolver = false;
+  this->GetConfiguration()->ReadParameter( usePartialEigenSolver,
+    "UsePartialEigenSolver", this->GetComponentLabel(), level, 0 );
+  this->SetUsePartialEigenSolver( usePartialEigenSolver );
+
+  unsigned int maximumNumberOfEigenSolverIterations = 50;
+  this->GetConfiguration()->ReadParameter( maximumNumberOfEigenSolverIterations,
+    "MaximumNumberOfEigenSolverIterations", this->GetComponentLabel(), level, 0 );
+  this->SetMaximumNumberOfEigenSolverIterations( maximumNumberOfEigenSolverIterations );
+
+  double eigenSolverTolerance = 1e-6;
+  this->GetConfiguration()->ReadParameter( eigenSolverTolerance,
+    "EigenSolverTolerance", this->GetComponentLabel(), level, 0 );
+  this->SetEigenSolverTolerance( eigenSolverTolerance );
+
   /** Get and set if we want to subtract the mean from the derivative. */
   bool subtractMean = false;
   this->GetConfiguration()->ReadParameter( subtractMean,
@@ -55,6 +55,18 @@ public:
   itkSetMacro( TransformIsStackTransform, bool );
   itkSetMacro( NumEigenValues, unsigned int );
 
+  /** Use a warm-started subspace iteration to compute only the
+   * NumEigenValues largest eigenpairs of the correlation matrix, instead
+   * of a full dense eigendecomposition. Falls back to the full
+   * decomposition when the iteration does not converge. Default: false.
+   */
+  itkSetMacro( UsePartialEigenSolver, bool );
+  itkGetConstMacro( UsePartialEigenSolver, bool );
+  itkSetMacro( MaximumNumberOfEigenSolverIterations, unsigned int );
+  itkGetConstMacro( MaximumNumberOfEigenSolverIterations, unsigned int );
+  itkSetMacro( EigenSolverTolerance, double );
+  itkGetConstMacro( EigenSolverTolerance, double );
+
   /** Typedefs from the superclass. */
   typedef typename
     Superclass::CoordinateRepresentationType              CoordinateRepresentationType;
@@ -215,6 +227,22 @@ protected:
   /** Initialize some multi-threading related parameters. */
   void InitializeThreadingParameters( void ) const override;
 
+  /** Compute the m_NumEigenValues largest eigenvalues of the symmetric
+   * matrix K, in descending order, and the corresponding normalized
+   * eigenvectors as columns of eigenVectors.
+   */
+  void ComputeLargestEigenPairs( const MatrixType & K,
+    vnl_vector< RealType > & eigenValues, MatrixType & eigenVectors ) const;
+
+  /** Subspace iteration warm-started from m_EigenSubspace. Returns false
+   * when the residuals did not drop below the tolerance in time.
+   */
+  bool ComputeLargestEigenPairsPartial( const MatrixType & K,
+    vnl_vector< RealType > & eigenValues, MatrixType & eigenVectors ) const;
+
+  /** Orthonormalize the columns of Q in-place (modified Gram-Schmidt). */
+  static void OrthonormalizeColumns( MatrixType & Q );
+
 private:
 
   PCAMetric( const Self & );      // purposely not implemented
@@ -235,6 +263,15 @@ private:
   /** Integer to indicate how many eigenvalues you want to use in the metric */
   unsigned int m_NumEigenValues;
 
+  /** Settings of the partial eigensolver. */
+  bool         m_UsePartialEigenSolver;
+  unsigned int m_MaximumNumberOfEigenSolverIterations;
+  double       m_EigenSolverTolerance;
+  unsigned int m_EigenSolverOversampling;
+
+  /** Ritz vectors of the previous evaluation, used as warm start. */
+  mutable MatrixType m_EigenSubspace;
+
   /** Matrices, needed for derivative calculation */
   mutable std::vector< unsigned int > m_PixelStartIndex;
   mutable MatrixType                  m_Atmm;
@@ -28,6 +28,7 @@
 #include "vnl/algo/vnl_symmetric_eigensystem.h"
 #include <numeric>
 #include <fstream>
+#include <algorithm>
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -44,7 +45,11 @@ PCAMetric< TFixedImage, TMovingImage >
 ::PCAMetric() :
   m_SubtractMean( false ),
   m_TransformIsStackTransform( false ),
-  m_NumEigenValues( 6 )
+  m_NumEigenValues( 6 ),
+  m_UsePartialEigenSolver( false ),
+  m_MaximumNumberOfEigenSolverIterations( 50 ),
+  m_EigenSolverTolerance( 1e-6 ),
+  m_EigenSolverOversampling( 4 )
 {
   this->SetUseImageSampler( true );
   this->SetUseFixedImageLimiter( false );
@@ -92,6 +97,10 @@ PCAMetric< TFixedImage, TMovingImage >
     std::cerr << "ERROR: Number of eigenvalues is larger than number of images. Maximum number of eigenvalues equals: "
               << this->m_G << std::endl;
   }
+
+  /** The warm start of the partial eigensolver is only valid within one resolution. */
+  this->m_EigenSubspace.clear();
+
 } // end Initializes
 
 
@@ -106,6 +115,12 @@ PCAMetric< TFixedImage, TMovingImage >
 {
   Superclass::PrintSelf( os, indent );
 
+  os << indent << "NumEigenValues: " << this->m_NumEigenValues << std::endl;
+  os << indent << "UsePartialEigenSolver: " << this->m_UsePartialEigenSolver << std::endl;
+  os << indent << "MaximumNumberOfEigenSolverIterations: "
+     << this->m_MaximumNumberOfEigenSolverIterations << std::endl;
+  os << indent << "EigenSolverTolerance: " << this->m_EigenSolverTolerance << std::endl;
+
 } // end PrintSelf
 
 
@@ -148,6 +163,199 @@ PCAMetric< TFixedImage, TMovingImage >
 } // end InitializeThreadingParameters()
 
 
+/**
+ * ******************* ComputeLargestEigenPairs *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric< TFixedImage, TMovingImage >
+::ComputeLargestEigenPairs( const MatrixType & K,
+  vnl_vector< RealType > & eigenValues, MatrixType & eigenVectors ) const
+{
+  const unsigned int G     = this->m_G;
+  const unsigned int numEV = this->m_NumEigenValues;
+
+  /** Try the warm-started subspace iteration first. */
+  if( this->m_UsePartialEigenSolver
+    && this->ComputeLargestEigenPairsPartial( K, eigenValues, eigenVectors ) )
+  {
+    return;
+  }
+
+  /** Full dense eigendecomposition. The eigenvalues are sorted ascending. */
+  vnl_symmetric_eigensystem< RealType > eig( K );
+
+  eigenValues.set_size( numEV );
+  eigenVectors.set_size( G, numEV );
+  for( unsigned int i = 1; i < numEV + 1; i++ )
+  {
+    eigenValues[ i - 1 ] = eig.get_eigenvalue( G - i );
+    eigenVectors.set_column( i - 1, ( eig.get_eigenvector( G - i ) ).normalize() );
+  }
+
+  /** Store the dominant subspace as warm start for the next evaluation. */
+  if( this->m_UsePartialEigenSolver )
+  {
+    const unsigned int subspaceDimension = std::min( G, numEV + this->m_EigenSolverOversampling );
+    this->m_EigenSubspace.set_size( G, subspaceDimension );
+    for( unsigned int i = 1; i < subspaceDimension + 1; i++ )
+    {
+      this->m_EigenSubspace.set_column( i - 1, eig.get_eigenvector( G - i ) );
+    }
+  }
+
+} // end ComputeLargestEigenPairs()
+
+
+/**
+ * ******************* ComputeLargestEigenPairsPartial *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+PCAMetric< TFixedImage, TMovingImage >
+::ComputeLargestEigenPairsPartial( const MatrixType & K,
+  vnl_vector< RealType > & eigenValues, MatrixType & eigenVectors ) const
+{
+  const unsigned int G     = this->m_G;
+  const unsigned int numEV = this->m_NumEigenValues;
+  const unsigned int subspaceDimension = std::min( G, numEV + this->m_EigenSolverOversampling );
+
+  /** The subspace iteration only pays off when the subspace is small
+   * compared to the full matrix.
+   */
+  if( 2 * subspaceDimension > G )
+  {
+    return false;
+  }
+
+  /** Warm start from the Ritz vectors of the previous evaluation. In the
+   * first evaluation of a resolution, start from evenly spread columns of K.
+   */
+  MatrixType Q;
+  if( this->m_EigenSubspace.rows() == G && this->m_EigenSubspace.cols() == subspaceDimension )
+  {
+    Q = this->m_EigenSubspace;
+  }
+  else
+  {
+    Q.set_size( G, subspaceDimension );
+    for( unsigned int j = 0; j < subspaceDimension; ++j )
+    {
+      Q.set_column( j, K.get_column( ( j * G ) / subspaceDimension ) );
+    }
+  }
+  Self::OrthonormalizeColumns( Q );
+
+  for( unsigned int iter = 0; iter < this->m_MaximumNumberOfEigenSolverIterations; ++iter )
+  {
+    /** Rayleigh-Ritz: project K onto the current subspace. */
+    const MatrixType KQ( K * Q );
+    MatrixType       H( Q.transpose() * KQ );
+    H += H.transpose();
+    H *= 0.5;
+    vnl_symmetric_eigensystem< RealType > eig( H );
+
+    /** Ritz vectors X = Q V and K X = K Q V, sorted by descending Ritz value. */
+    MatrixType V( subspaceDimension, subspaceDimension );
+    for( unsigned int j = 0; j < subspaceDimension; ++j )
+    {
+      V.set_column( j, eig.get_eigenvector( subspaceDimension - 1 - j ) );
+    }
+    const MatrixType X( Q * V );
+    const MatrixType KX( KQ * V );
+
+    /** Check the residuals || K x - theta x || of the wanted eigenpairs. */
+    const RealType scale = std::max( std::abs( eig.get_eigenvalue( subspaceDimension - 1 ) ),
+      NumericTraits< RealType >::One );
+    bool converged = true;
+    for( unsigned int j = 0; j < numEV && converged; ++j )
+    {
+      const RealType theta    = eig.get_eigenvalue( subspaceDimension - 1 - j );
+      const RealType residual = ( KX.get_column( j ) - theta * X.get_column( j ) ).two_norm();
+      converged = residual <= this->m_EigenSolverTolerance * scale;
+    }
+
+    if( converged )
+    {
+      eigenValues.set_size( numEV );
+      eigenVectors.set_size( G, numEV );
+      for( unsigned int j = 0; j < numEV; ++j )
+      {
+        eigenValues[ j ] = eig.get_eigenvalue( subspaceDimension - 1 - j );
+        eigenVectors.set_column( j, ( X.get_column( j ) ).normalize() );
+      }
+      this->m_EigenSubspace = X;
+      return true;
+    }
+
+    /** Power step on the Ritz vectors. */
+    Q = KX;
+    Self::OrthonormalizeColumns( Q );
+  }
+
+  /** No convergence: let the caller fall back to the full decomposition. */
+  return false;
+
+} // end ComputeLargestEigenPairsPartial()
+
+
+/**
+ * ******************* OrthonormalizeColumns *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric< TFixedImage, TMovingImage >
+::OrthonormalizeColumns( MatrixType & Q )
+{
+  const unsigned int rows = Q.rows();
+  const unsigned int cols = Q.cols();
+
+  unsigned int replacement = 0;
+  for( unsigned int j = 0; j < cols; ++j )
+  {
+    RealType norm = NumericTraits< RealType >::Zero;
+    while( true )
+    {
+      /** Modified Gram-Schmidt against the previous columns. */
+      for( unsigned int i = 0; i < j; ++i )
+      {
+        RealType dot = NumericTraits< RealType >::Zero;
+        for( unsigned int r = 0; r < rows; ++r )
+        {
+          dot += Q( r, i ) * Q( r, j );
+        }
+        for( unsigned int r = 0; r < rows; ++r )
+        {
+          Q( r, j ) -= dot * Q( r, i );
+        }
+      }
+
+      norm = Q.get_column( j ).two_norm();
+      if( norm > 1e-10 || replacement >= rows )
+      {
+        break;
+      }
+
+      /** The column collapsed into the span of the previous ones;
+       * replace it by a unit vector and try again.
+       */
+      Q.set_column( j, NumericTraits< RealType >::Zero );
+      Q( replacement, j ) = NumericTraits< RealType >::One;
+      ++replacement;
+    }
+
+    for( unsigned int r = 0; r < rows; ++r )
+    {
+      Q( r, j ) /= norm;
+    }
+  }
+
+} // end OrthonormalizeColumns()
+
+
 /**
  * *************** EvaluateTransformJacobianInnerProduct ****************
  */
@@ -324,14 +532,12 @@ PCAMetric< TFixedImage, TMovingImage >
   /** Compute correlation matrix K */
   MatrixType K( S * C * S );
 
-  /** Compute first eigenvalue and eigenvector of K */
-  vnl_symmetric_eigensystem< RealType > eig( K );
+  /** Compute the largest eigenvalues and eigenvectors of K */
+  vnl_vector< RealType > eigenValues;
+  MatrixType             eigenVectorMatrix;
+  this->ComputeLargestEigenPairs( K, eigenValues, eigenVectorMatrix );
 
-  RealType sumEigenValuesUsed = itk::NumericTraits< RealType >::Zero;
-  for( unsigned int i = 1; i < this->m_NumEigenValues + 1; i++ )
-  {
-    sumEigenValuesUsed += eig.get_eigenvalue( this->m_G - i );
-  }
+  const RealType sumEigenValuesUsed = eigenValues.sum();
 
   measure = this->m_G - sumEigenValuesUsed;
 
@@ -511,20 +717,12 @@ PCAMetric< TFixedImage, TMovingImage >
 
   MatrixType K( S * C * S );
 
-  /** Compute first eigenvalue and eigenvector of K */
-  vnl_symmetric_eigensystem< RealType > eig( K );
-
-  RealType sumEigenValuesUsed = itk::NumericTraits< RealType >::Zero;
-  for( unsigned int i = 1; i < this->m_NumEigenValues + 1; i++ )
-  {
-    sumEigenValuesUsed += eig.get_eigenvalue( this->m_G - i );
-  }
+  /** Compute the largest eigenvalues and eigenvectors of K */
+  vnl_vector< RealType > eigenValues;
+  MatrixType             eigenVectorMatrix;
+  this->ComputeLargestEigenPairs( K, eigenValues, eigenVectorMatrix );
 
-  MatrixType eigenVectorMatrix( this->m_G, this->m_NumEigenValues );
-  for( unsigned int i = 1; i < this->m_NumEigenValues + 1; i++ )
-  {
-    eigenVectorMatrix.set_column( i - 1, ( eig.get_eigenvector( this->m_G - i ) ).normalize() );
-  }
+  const RealType sumEigenValuesUsed = eigenValues.sum();
 
   MatrixType eigenVectorMatrixTranspose( eigenVectorMatrix.transpose() );
 
@@ -895,16 +1093,12 @@ PCAMetric< TFixedImage, TMovingImage >
 
   MatrixType K( S * C * S );
 
-  /** Compute first eigenvalue and eigenvector of K */
-  vnl_symmetric_eigensystem< RealType > eig( K );
+  /** Compute the largest eigenvalues and eigenvectors of K */
+  vnl_vector< RealType > eigenValues;
+  MatrixType             eigenVectorMatrix;
+  this->ComputeLargestEigenPairs( K, eigenValues, eigenVectorMatrix );
 
-  RealType   sumEigenValuesUsed = itk::NumericTraits< RealType >::Zero;
-  MatrixType eigenVectorMatrix( this->m_G, this->m_NumEigenValues );
-  for( unsigned int i = 1; i < this->m_NumEigenValues + 1; i++ )
-  {
-    sumEigenValuesUsed += eig.get_eigenvalue( this->m_G - i );
-    eigenVectorMatrix.set_column( i - 1, ( eig.get_eigenvector( this->m_G - i ) ).normalize() );
-  }
+  const RealType sumEigenValuesUsed = eigenValues.sum();
 
   value = this->m_G - sumEigenValuesUsed;
 
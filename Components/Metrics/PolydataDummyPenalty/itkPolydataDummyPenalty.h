@@ -31,7 +31,7 @@ namespace itk
 /** \class MeshPenalty
  * \brief A dummy metric to generate transformed meshes each iteration.
  *
- *
+ * The mesh points are mapped in parallel chunks when UseMultiThread is on.
  *
  * \ingroup RegistrationMetrics
  */
@@ -181,10 +181,18 @@ protected:
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Map the points [ begin, end [ of the current mesh. */
+  void ThreadedGetValueAndDerivativeOfPoints( const unsigned int begin,
+    const unsigned int end, const ThreadIdType threadId,
+    const bool computeDerivative ) const override;
+
   /** Member variables. */
   mutable FixedMeshContainerConstPointer m_FixedMeshContainer;
   mutable MappedMeshContainerPointer     m_MappedMeshContainer;
 
+  /** The mesh that is being processed by the threads. */
+  mutable FixedMeshContainerElementIdentifier m_CurrentMeshId;
+
 private:
 
   MeshPenalty( const Self & );    // purposely not implemented
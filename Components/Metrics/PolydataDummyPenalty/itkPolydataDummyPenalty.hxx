@@ -32,6 +32,7 @@ MeshPenalty< TFixedPointSet, TMovingPointSet >
 ::MeshPenalty()
 {
   this->m_MappedMeshContainer = MappedMeshContainerType::New();
+  this->m_CurrentMeshId       = 0;
 } // end Constructor
 
 
@@ -204,40 +205,46 @@ MeshPenalty< TFixedPointSet, TMovingPointSet >
   /* Loop over all meshes in this Metric*/
   for( FixedMeshContainerElementIdentifier meshId = 0; meshId < numberOfMeshes; ++meshId )
   {
-    const FixedMeshConstPointer           fixedMesh   = fixedMeshContainer->ElementAt( meshId );
-    const MeshPointsContainerConstPointer fixedPoints = fixedMesh->GetPoints();
-    //const MeshPointDataContainerConstPointer fixedNormals =  fixedMesh->GetPointData();
-    //const unsigned int numberOfPoints = fixedPoints->Size();
+    /* Transform all points by current transformation, possibly multi-threaded */
+    MeasureType dummyValue = NumericTraits< MeasureType >::Zero;
+    this->m_CurrentMeshId = meshId;
+    this->LaunchGetValueAndDerivativeOfPoints(
+      fixedMeshContainer->ElementAt( meshId )->GetPoints()->Size(), dummyValue, NULL );
+    //this->TransformPointNormal(fixedPointIt->Value(),  fixedPointDataIt->Value(), mappedPointDataIt->Value()  );
 
-    const FixedMeshPointer           mappedMesh   = this->m_MappedMeshContainer->ElementAt( meshId );
-    const MeshPointsContainerPointer mappedPoints = mappedMesh->GetPoints();
-    //const MeshPointDataContainerPointer mappedNormals =  mappedMesh->GetPointData();
+  } // end of loop over meshes
 
-    //FixedMeshType::PointsContainer::Pointer derivPoints = FixedMeshType::PointsContainer::New();
-    //FixedMeshType::PointType zeroPoint =  FixedMeshType::PointType::Point();
-    //zeroPoint.Fill(0.0);
-    //derivPoints->resize(numberOfPoints,FixedMeshType::PointType::Point(zeroPoint));
+  // Since this is a dummy metric always return value = 0 and derivative = [0,...,0]
 
-    MeshPointsContainerConstIteratorType fixedPointIt  = fixedPoints->Begin();
-    MeshPointsContainerIteratorType      mappedPointIt = mappedPoints->Begin();
-    MeshPointsContainerConstIteratorType fixedPointEnd = fixedPoints->End();
+} // end GetValueAndDerivative()
 
-    //MeshPointDataContainerConstIteratorType fixedPointDataIt =fixedNormals->Begin();
-    //MeshPointDataContainerIteratorType mappedPointDataIt = mappedNormals->Begin();
 
-    /* Transform all points and their normals by current transformation*/
-    for(; fixedPointIt != fixedPointEnd; ++fixedPointIt, ++mappedPointIt )  //,++fixedPointDataIt,++mappedPointDataIt)
-    {
-      const OutputPointType mappedPoint = this->m_Transform->TransformPoint( fixedPointIt->Value() );
-      mappedPointIt.Value() = mappedPoint;
-      //this->TransformPointNormal(fixedPointIt->Value(),  fixedPointDataIt->Value(), mappedPointDataIt->Value()  );
+/**
+ * ******************* ThreadedGetValueAndDerivativeOfPoints *******************
+ */
 
-    }
-  } // end of loop over meshes
+template< class TFixedPointSet, class TMovingPointSet >
+void
+MeshPenalty< TFixedPointSet, TMovingPointSet >
+::ThreadedGetValueAndDerivativeOfPoints( const unsigned int begin,
+  const unsigned int end, const ThreadIdType threadId,
+  const bool computeDerivative ) const
+{
+  if( begin >= end )
+  {
+    return;
+  }
 
-  // Since this is a dummy metric always return value = 0 and derivative = [0,...,0]
+  const MeshPointsContainerConstPointer fixedPoints
+    = this->m_FixedMeshContainer->ElementAt( this->m_CurrentMeshId )->GetPoints();
+  const MeshPointsContainerPointer mappedPoints
+    = this->m_MappedMeshContainer->ElementAt( this->m_CurrentMeshId )->GetPoints();
 
-} // end GetValueAndDerivative()
+  /** Map this chunk of points at once. */
+  this->TransformPoints( &fixedPoints->ElementAt( begin ),
+    &mappedPoints->ElementAt( begin ), end - begin );
+
+} // end ThreadedGetValueAndDerivativeOfPoints()
 
 
 /**
@@ -27,13 +27,13 @@
 /** Needed for the filtering of the B-spline coefficients. */
 #include "itkNeighborhood.h"
 #include "itkImageRegionIterator.h"
-#include "itkNeighborhoodOperatorImageFilter.h"
 #include "itkNeighborhoodIterator.h"
 
 /** Include stuff needed for the construction of the rigidity coefficient image. */
 #include "itkGrayscaleDilateImageFilter.h"
 #include "itkBinaryBallStructuringElement.h"
 #include "itkImageRegionIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
 
 namespace itk
 {
@@ -57,6 +57,12 @@ namespace itk
  *
  * This metric only works with B-splines as a transformation model.
  *
+ * Since all filter operators have radius one, the penalty term and its
+ * derivative are only computed within the bounding box of the nonzero
+ * rigidity coefficients, dilated by one grid point. The separable filters
+ * share their common first passes, and every pass as well as the per
+ * voxel computations are multi-threaded over the last image axis.
+ *
  * References:\n
  * [1] M. Staring, S. Klein and J.P.W. Pluim,
  *    "A Rigidity Penalty Term for Nonrigid Registration,"
@@ -122,6 +128,8 @@ public:
   typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
   typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
   typedef typename Superclass::ScalarType                   ScalarType;
+  typedef typename Superclass::ThreaderType                 ThreaderType;
+  typedef typename Superclass::ThreadInfoType               ThreadInfoType;
 
   /** Typedef's for the B-spline transform. */
   typedef typename Superclass::CombinationTransformType       CombinationTransformType;
@@ -160,8 +168,6 @@ public:
     itkGetStaticConstMacro( FixedImageDimension ) >     NeighborhoodType;
   typedef typename NeighborhoodType::SizeType           NeighborhoodSizeType;
   typedef ImageRegionIterator< CoefficientImageType >   CoefficientImageIteratorType;
-  typedef NeighborhoodOperatorImageFilter<
-    CoefficientImageType, CoefficientImageType >        NOIFType;
   typedef NeighborhoodIterator< CoefficientImageType >  NeighborhoodIteratorType;
   typedef typename NeighborhoodIteratorType::RadiusType RadiusType;
 
@@ -171,8 +177,11 @@ public:
   typedef typename RigidityImageType::PixelType    RigidityPixelType;
   typedef typename RigidityImageType::RegionType   RigidityImageRegionType;
   typedef typename RigidityImageType::IndexType    RigidityImageIndexType;
+  typedef typename RigidityImageType::SizeType     RigidityImageSizeType;
   typedef typename RigidityImageType::PointType    RigidityImagePointType;
   typedef ImageRegionIterator< RigidityImageType > RigidityImageIteratorType;
+  typedef ImageRegionIteratorWithIndex<
+    RigidityImageType >                            RigidityImageIteratorWithIndexType;
   typedef BinaryBallStructuringElement<
     RigidityPixelType,
     itkGetStaticConstMacro( FixedImageDimension ) >     StructuringElementType;
@@ -322,9 +331,77 @@ private:
   void CreateNDOperator( NeighborhoodType & F, const std::string & whichF,
     const CoefficientImageSpacingType & spacing ) const;
 
-  /** Private function used for the filtering. It performs 1D separable filtering. */
-  CoefficientImagePointer FilterSeparable( const CoefficientImageType *,
-    const std::vector< NeighborhoodType > & Operators ) const;
+  /** The separable operators F_A to F_I. In 2D only A, B, D, E and G are used. */
+  enum SeparableOperatorEnum {
+    OperatorFA = 0, OperatorFB, OperatorFC, OperatorFD, OperatorFE,
+    OperatorFF, OperatorFG, OperatorFH, OperatorFI, NumberOfSeparableOperators
+  };
+
+  /** The steps that are executed on (parts of) the evaluation region. */
+  enum RigidityStepEnum {
+    SeparableFilterStep = 0, ConditionsStep, FilterPartsStep, DerivativeStep
+  };
+
+  /** Private function that creates the 1D and ND operators for the current grid
+   * spacing. Separable operators whose kernels agree along the first axes share
+   * their first filtering steps, which are organised as a tree.
+   */
+  void InitializeFilters( const CoefficientImageSpacingType & spacing );
+
+  /** Private function used for the filtering. It filters all B-spline coefficient
+   * images with all separable operators, only computing the output in the given
+   * region. Each axis is filtered in a single multi-threaded pass.
+   */
+  void FilterSeparable( const std::vector< CoefficientImagePointer > & inputImages,
+    const RigidityImageRegionType & region ) const;
+
+  /** Get a B-spline coefficient image, filtered with one of the separable operators. */
+  CoefficientImageType * GetFilteredCoefficientImage(
+    const unsigned int whichOperator, const unsigned int component ) const;
+
+  /** Allocate an image on the given region, unless it already is. */
+  static void AllocateCoefficientImage( CoefficientImagePointer & image,
+    const RigidityImageRegionType & region );
+
+  /** Execute one of the steps on the given region, split along the last axis
+   * over the threads. The values that the threads return are added in order.
+   */
+  void ThreadedExecuteStep( const unsigned int step,
+    const RigidityImageRegionType & region, MeasureType values[ 3 ] ) const;
+
+  /** The threader callback for ThreadedExecuteStep(). */
+  static ITK_THREAD_RETURN_TYPE ExecuteStepThreaderCallback( void * arg );
+
+  /** Execute the current step in a part of the region. */
+  void ExecuteStepOnSubRegion( const RigidityImageRegionType & subRegion,
+    MeasureType values[ 3 ] ) const;
+
+  /** Filter the part of the region along one axis. */
+  void FilterSeparableOnSubRegion( const unsigned int axis,
+    const RigidityImageRegionType & subRegion ) const;
+
+  /** Compute the linearity, orthonormality and properness values in a part of
+   * the evaluation region, and optionally the parts needed for the derivative.
+   */
+  void ComputeConditionsOnSubRegion( const RigidityImageRegionType & subRegion,
+    const bool computeParts, MeasureType values[ 3 ] ) const;
+
+  /** Filter the parts with the ND operators in a part of the evaluation region. */
+  void FilterPartsOnSubRegion( const RigidityImageRegionType & subRegion ) const;
+
+  /** Compute the derivative in a part of the evaluation region, and the
+   * contributions to the squared gradient magnitudes of the conditions.
+   */
+  void ComputeDerivativeOnSubRegion( const RigidityImageRegionType & subRegion,
+    const ScalarType rigidityCoefficientSum, DerivativeValueType * derivative,
+    MeasureType gradientMagnitudes[ 3 ] ) const;
+
+  /** Private function that sums the rigidity coefficients, and computes the
+   * region of the B-spline grid where the penalty term is nonzero: the
+   * bounding box of the rigid region, dilated by the filter radius.
+   */
+  ScalarType ComputeRigidityCoefficientSumAndRegion(
+    RigidityImageRegionType & evaluationRegion ) const;
 
   /** Member variables. */
   BSplineTransformPointer m_BSplineTransform;
@@ -361,6 +438,45 @@ private:
   bool                               m_UseFixedRigidityImage;
   bool                               m_UseMovingRigidityImage;
 
+  /** A step of the separable filtering: the output of step m_Input of the
+   * previous axis, filtered along the current axis, for every component.
+   */
+  struct SeparableFilterStepType
+  {
+    NeighborhoodType                       m_Operator;
+    unsigned int                           m_Input;
+    std::vector< CoefficientImagePointer > m_Outputs;
+  };
+
+  struct RigidityThreaderParameterType
+  {
+    const Self *               st_Metric;
+    unsigned int               st_Step;
+    RigidityImageRegionType    st_Region;
+    unsigned int               st_Axis;
+    bool                       st_ComputeParts;
+    ScalarType                 st_RigidityCoefficientSum;
+    DerivativeValueType *      st_Derivative;
+    std::vector< MeasureType > st_Values;
+  };
+
+  /** The filtering steps per axis, and per separable operator the step of the
+   * last axis that holds its result. The ND operators are indexed likewise.
+   */
+  mutable std::vector< std::vector< SeparableFilterStepType > > m_SeparableFilterSteps;
+  std::vector< unsigned int >                                   m_SeparableFilterResults;
+  std::vector< NeighborhoodType >                               m_NDOperators;
+
+  /** Intermediate images, reused over the iterations. */
+  mutable std::vector< CoefficientImagePointer >                m_CoefficientImages;
+  mutable std::vector< std::vector< CoefficientImagePointer > > m_OrthonormalityParts;
+  mutable std::vector< std::vector< CoefficientImagePointer > > m_PropernessParts;
+  mutable std::vector< std::vector< CoefficientImagePointer > > m_LinearityParts;
+  mutable std::vector< CoefficientImagePointer >                m_FilteredOrthonormalityParts;
+  mutable std::vector< CoefficientImagePointer >                m_FilteredPropernessParts;
+  mutable std::vector< CoefficientImagePointer >                m_FilteredLinearityParts;
+  mutable RigidityThreaderParameterType                         m_RigidityThreaderParameters;
+
 };
 
 } // end namespace itk
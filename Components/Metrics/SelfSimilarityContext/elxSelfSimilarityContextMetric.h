@@ -0,0 +1,177 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxSelfSimilarityContextMetric_H__
+#define __elxSelfSimilarityContextMetric_H__
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "itkSelfSimilarityContextImageToImageMetric.h"
+
+namespace elastix
+{
+
+/**
+ * \class SelfSimilarityContextMetric
+ * \brief A metric based on the itk::SelfSimilarityContextImageToImageMetric.
+ *
+ * The parameters used in this class are:
+ * \parameter Metric: Select this metric as follows:\n
+ *    <tt>(Metric "SelfSimilarityContext")</tt>
+ * \parameter SelfSimilarityPatchRadius: The radius of the patches that are compared
+ *    to compute the self-similarity context descriptors, in voxels.
+ *    Default value is 1. Can be defined for each resolution\n
+ *    example: <tt>(SelfSimilarityPatchRadius 1 1 1)</tt>
+ * \parameter SelfSimilarityNeighbourhoodDistance: The distance of the six-neighbourhood
+ *    voxels of which the patches are compared, in voxels.
+ *    Default value is 2. Can be defined for each resolution\n
+ *    example: <tt>(SelfSimilarityNeighbourhoodDistance 3 2 2)</tt>
+ *
+ * The descriptors of the fixed and moving images are computed once per resolution.
+ * Since the descriptors are interpolated by the metric itself, the Interpolator
+ * only has to be cheap; a NearestNeighborInterpolator or LinearInterpolator suffices.
+ *
+ * \ingroup Metrics
+ *
+ */
+
+template< class TElastix >
+class SelfSimilarityContextMetric :
+  public
+  itk::SelfSimilarityContextImageToImageMetric<
+  typename MetricBase< TElastix >::FixedImageType,
+  typename MetricBase< TElastix >::MovingImageType >,
+  public MetricBase< TElastix >
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef SelfSimilarityContextMetric Self;
+  typedef itk::SelfSimilarityContextImageToImageMetric<
+    typename MetricBase< TElastix >::FixedImageType,
+    typename MetricBase< TElastix >::MovingImageType >    Superclass1;
+  typedef MetricBase< TElastix >          Superclass2;
+  typedef itk::SmartPointer< Self >       Pointer;
+  typedef itk::SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( SelfSimilarityContextMetric, itk::SelfSimilarityContextImageToImageMetric );
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific metric. \n
+   * example: <tt>(Metric "SelfSimilarityContext")</tt>\n
+   */
+  elxClassNameMacro( "SelfSimilarityContext" );
+
+  /** Typedefs from the superclass. */
+  typedef typename
+    Superclass1::CoordinateRepresentationType CoordinateRepresentationType;
+  typedef typename Superclass1::MovingImageType            MovingImageType;
+  typedef typename Superclass1::MovingImagePixelType       MovingImagePixelType;
+  typedef typename Superclass1::MovingImageConstPointer    MovingImageConstPointer;
+  typedef typename Superclass1::FixedImageType             FixedImageType;
+  typedef typename Superclass1::FixedImageConstPointer     FixedImageConstPointer;
+  typedef typename Superclass1::FixedImageRegionType       FixedImageRegionType;
+  typedef typename Superclass1::TransformType              TransformType;
+  typedef typename Superclass1::TransformPointer           TransformPointer;
+  typedef typename Superclass1::InputPointType             InputPointType;
+  typedef typename Superclass1::OutputPointType            OutputPointType;
+  typedef typename Superclass1::TransformParametersType    TransformParametersType;
+  typedef typename Superclass1::TransformJacobianType      TransformJacobianType;
+  typedef typename Superclass1::InterpolatorType           InterpolatorType;
+  typedef typename Superclass1::InterpolatorPointer        InterpolatorPointer;
+  typedef typename Superclass1::RealType                   RealType;
+  typedef typename Superclass1::GradientPixelType          GradientPixelType;
+  typedef typename Superclass1::GradientImageType          GradientImageType;
+  typedef typename Superclass1::GradientImagePointer       GradientImagePointer;
+  typedef typename Superclass1::GradientImageFilterType    GradientImageFilterType;
+  typedef typename Superclass1::GradientImageFilterPointer GradientImageFilterPointer;
+  typedef typename Superclass1::FixedImageMaskType         FixedImageMaskType;
+  typedef typename Superclass1::FixedImageMaskPointer      FixedImageMaskPointer;
+  typedef typename Superclass1::MovingImageMaskType        MovingImageMaskType;
+  typedef typename Superclass1::MovingImageMaskPointer     MovingImageMaskPointer;
+  typedef typename Superclass1::MeasureType                MeasureType;
+  typedef typename Superclass1::DerivativeType             DerivativeType;
+  typedef typename Superclass1::ParametersType             ParametersType;
+  typedef typename Superclass1::FixedImagePixelType        FixedImagePixelType;
+  typedef typename Superclass1::MovingImageRegionType      MovingImageRegionType;
+  typedef typename Superclass1::ImageSamplerType           ImageSamplerType;
+  typedef typename Superclass1::ImageSamplerPointer        ImageSamplerPointer;
+  typedef typename Superclass1::ImageSampleContainerType   ImageSampleContainerType;
+  typedef typename
+    Superclass1::ImageSampleContainerPointer ImageSampleContainerPointer;
+  typedef typename Superclass1::FixedImageLimiterType  FixedImageLimiterType;
+  typedef typename Superclass1::MovingImageLimiterType MovingImageLimiterType;
+  typedef typename
+    Superclass1::FixedImageLimiterOutputType FixedImageLimiterOutputType;
+  typedef typename
+    Superclass1::MovingImageLimiterOutputType MovingImageLimiterOutputType;
+  typedef typename
+    Superclass1::MovingImageDerivativeScalesType MovingImageDerivativeScalesType;
+
+  /** The fixed image dimension. */
+  itkStaticConstMacro( FixedImageDimension, unsigned int,
+    FixedImageType::ImageDimension );
+
+  /** The moving image dimension. */
+  itkStaticConstMacro( MovingImageDimension, unsigned int,
+    MovingImageType::ImageDimension );
+
+  /** Typedef's inherited from Elastix. */
+  typedef typename Superclass2::ElastixType          ElastixType;
+  typedef typename Superclass2::ElastixPointer       ElastixPointer;
+  typedef typename Superclass2::ConfigurationType    ConfigurationType;
+  typedef typename Superclass2::ConfigurationPointer ConfigurationPointer;
+  typedef typename Superclass2::RegistrationType     RegistrationType;
+  typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
+  typedef typename Superclass2::ITKBaseType          ITKBaseType;
+
+  /** Execute stuff before each new pyramid resolution:
+   * \li Set the patch radius and the neighbourhood distance of the descriptors.
+   */
+  void BeforeEachResolution( void ) override;
+
+  /** Sets up a timer to measure the initialization time, which includes
+   * the computation of the descriptors, and calls the Superclass' implementation.
+   */
+  void Initialize( void ) override;
+
+protected:
+
+  /** The constructor. */
+  SelfSimilarityContextMetric() {}
+  /** The destructor. */
+  ~SelfSimilarityContextMetric() override {}
+
+private:
+
+  /** The private constructor. */
+  SelfSimilarityContextMetric( const Self & );  // purposely not implemented
+  /** The private copy constructor. */
+  void operator=( const Self & );               // purposely not implemented
+
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "elxSelfSimilarityContextMetric.hxx"
+#endif
+
+#endif // end #ifndef __elxSelfSimilarityContextMetric_H__
@@ -0,0 +1,76 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxSelfSimilarityContextMetric_HXX__
+#define __elxSelfSimilarityContextMetric_HXX__
+
+#include "elxSelfSimilarityContextMetric.h"
+#include "itkTimeProbe.h"
+
+namespace elastix
+{
+
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template< class TElastix >
+void
+SelfSimilarityContextMetric< TElastix >
+::BeforeEachResolution( void )
+{
+  /** Get the current resolution level. */
+  unsigned int level
+    = ( this->m_Registration->GetAsITKBaseType() )->GetCurrentLevel();
+
+  /** Get and set the patch radius. Default 1. */
+  unsigned int patchRadius = 1;
+  this->GetConfiguration()->ReadParameter( patchRadius, "SelfSimilarityPatchRadius",
+    this->GetComponentLabel(), level, 0 );
+  this->SetPatchRadius( patchRadius );
+
+  /** Get and set the neighbourhood distance. Default 2. */
+  unsigned int neighbourhoodDistance = 2;
+  this->GetConfiguration()->ReadParameter( neighbourhoodDistance, "SelfSimilarityNeighbourhoodDistance",
+    this->GetComponentLabel(), level, 0 );
+  this->SetNeighbourhoodDistance( neighbourhoodDistance );
+
+} // end BeforeEachResolution()
+
+
+/**
+ * ******************* Initialize ***********************
+ */
+
+template< class TElastix >
+void
+SelfSimilarityContextMetric< TElastix >
+::Initialize( void )
+{
+  itk::TimeProbe timer;
+  timer.Start();
+  this->Superclass1::Initialize();
+  timer.Stop();
+  elxout << "Initialization of SelfSimilarityContext metric took: "
+         << static_cast< long >( timer.GetMean() * 1000 ) << " ms." << std::endl;
+
+} // end Initialize()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxSelfSimilarityContextMetric_HXX__
@@ -0,0 +1,333 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkSelfSimilarityContextImageToImageMetric_h
+#define __itkSelfSimilarityContextImageToImageMetric_h
+
+#include "itkAdvancedImageToImageMetric.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class SelfSimilarityContextImageToImageMetric
+ * \brief Compute the Hamming distance between self-similarity context (SSC)
+ * descriptors of two images, based on AdvancedImageToImageMetric...
+ *
+ * This Class is templated over the type of the fixed and moving
+ * images to be compared.
+ *
+ * The self-similarity context descriptor (Heinrich et al., MICCAI 2013,
+ * a variant of MIND) describes each voxel by the patch distances between
+ * pairs of its six-neighbourhood voxels:
+ *
+ *   \f[ D_c(x) = \sum_{p \in P} ( I(x + a_c + p) - I(x + b_c + p) )^2, \f]
+ *   \f[ S_c(x) = \exp( - ( D_c(x) - \min_c D_c(x) ) / V(x) ), \f]
+ *
+ * with \f$V(x)\f$ the mean of \f$D_c(x) - \min_c D_c(x)\f$ over the channels,
+ * and \f$P\f$ a box shaped patch. The pairs \f$(a_c, b_c)\f$ are all pairs of
+ * six-neighbourhood offsets at a given distance that are not opposite, which
+ * gives 12 channels in 3D. Since the descriptor only depends on the local
+ * image structure, it is suited for multi-modal registration.
+ *
+ * Every channel is quantized and stored as a thermometer code, and all
+ * channels are packed in a single 64-bit word per voxel. The L1 distance
+ * between two quantized descriptors is then the number of differing bits,
+ * which is computed with a single popcount.
+ *
+ * The descriptor images of the fixed and the moving image are computed in
+ * Initialize(), so once per resolution, on the buffered region of the
+ * (pyramid) images. They are only recomputed when the image or the
+ * descriptor settings change. When UseMultiThread is set, the images are
+ * split in slabs along their last axis, which are processed by separate
+ * threads; the descriptors do not depend on the number of threads. The fixed descriptor at a sample is taken from
+ * the nearest voxel. The Hamming distance to the moving descriptors is
+ * linearly interpolated between the voxels around the mapped point, which
+ * makes the measure a continuous function of the transform parameters, with
+ * an analytic derivative. The measure is normalized to [0, 1].
+ *
+ * Note that the moving image interpolator is not used for the measure.
+ *
+ * This implementation is based on the AdvancedImageToImageMetric, which means that:
+ * \li It uses the ImageSampler-framework
+ * \li It makes use of the compact support of B-splines, in case of B-spline transforms.
+ * \li A minimum number of samples that should map within the moving image (mask) can be specified.
+ * \li It is multi-threaded.
+ *
+ * \ingroup RegistrationMetrics
+ * \ingroup Metrics
+ */
+
+template< class TFixedImage, class TMovingImage >
+class SelfSimilarityContextImageToImageMetric :
+  public AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef SelfSimilarityContextImageToImageMetric Self;
+  typedef AdvancedImageToImageMetric<
+    TFixedImage, TMovingImage >                   Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( SelfSimilarityContextImageToImageMetric, AdvancedImageToImageMetric );
+
+  /** Typedefs from the superclass. */
+  typedef typename
+    Superclass::CoordinateRepresentationType CoordinateRepresentationType;
+  typedef typename Superclass::MovingImageType            MovingImageType;
+  typedef typename Superclass::MovingImagePixelType       MovingImagePixelType;
+  typedef typename Superclass::MovingImageConstPointer    MovingImageConstPointer;
+  typedef typename Superclass::FixedImageType             FixedImageType;
+  typedef typename Superclass::FixedImageConstPointer     FixedImageConstPointer;
+  typedef typename Superclass::FixedImageRegionType       FixedImageRegionType;
+  typedef typename Superclass::TransformType              TransformType;
+  typedef typename Superclass::TransformPointer           TransformPointer;
+  typedef typename Superclass::InputPointType             InputPointType;
+  typedef typename Superclass::OutputPointType            OutputPointType;
+  typedef typename Superclass::TransformParametersType    TransformParametersType;
+  typedef typename Superclass::TransformJacobianType      TransformJacobianType;
+  typedef typename Superclass::NumberOfParametersType     NumberOfParametersType;
+  typedef typename Superclass::InterpolatorType           InterpolatorType;
+  typedef typename Superclass::InterpolatorPointer        InterpolatorPointer;
+  typedef typename Superclass::RealType                   RealType;
+  typedef typename Superclass::GradientPixelType          GradientPixelType;
+  typedef typename Superclass::GradientImageType          GradientImageType;
+  typedef typename Superclass::GradientImagePointer       GradientImagePointer;
+  typedef typename Superclass::GradientImageFilterType    GradientImageFilterType;
+  typedef typename Superclass::GradientImageFilterPointer GradientImageFilterPointer;
+  typedef typename Superclass::FixedImageMaskType         FixedImageMaskType;
+  typedef typename Superclass::FixedImageMaskPointer      FixedImageMaskPointer;
+  typedef typename Superclass::MovingImageMaskType        MovingImageMaskType;
+  typedef typename Superclass::MovingImageMaskPointer     MovingImageMaskPointer;
+  typedef typename Superclass::MeasureType                MeasureType;
+  typedef typename Superclass::DerivativeType             DerivativeType;
+  typedef typename Superclass::DerivativeValueType        DerivativeValueType;
+  typedef typename Superclass::ParametersType             ParametersType;
+  typedef typename Superclass::FixedImagePixelType        FixedImagePixelType;
+  typedef typename Superclass::MovingImageRegionType      MovingImageRegionType;
+  typedef typename Superclass::ImageSamplerType           ImageSamplerType;
+  typedef typename Superclass::ImageSamplerPointer        ImageSamplerPointer;
+  typedef typename Superclass::ImageSampleContainerType   ImageSampleContainerType;
+  typedef typename
+    Superclass::ImageSampleContainerPointer ImageSampleContainerPointer;
+  typedef typename Superclass::FixedImageLimiterType  FixedImageLimiterType;
+  typedef typename Superclass::MovingImageLimiterType MovingImageLimiterType;
+  typedef typename
+    Superclass::FixedImageLimiterOutputType FixedImageLimiterOutputType;
+  typedef typename
+    Superclass::MovingImageLimiterOutputType MovingImageLimiterOutputType;
+  typedef typename
+    Superclass::MovingImageDerivativeScalesType MovingImageDerivativeScalesType;
+  typedef typename Superclass::ThreaderType   ThreaderType;
+  typedef typename Superclass::ThreadInfoType ThreadInfoType;
+
+  /** The fixed image dimension. */
+  itkStaticConstMacro( FixedImageDimension, unsigned int,
+    FixedImageType::ImageDimension );
+
+  /** The moving image dimension. */
+  itkStaticConstMacro( MovingImageDimension, unsigned int,
+    MovingImageType::ImageDimension );
+
+  /** The number of descriptor channels: the number of pairs of
+   * six-neighbourhood offsets that are not opposite, 2 D (D - 1).
+   */
+  itkStaticConstMacro( NumberOfChannels, unsigned int,
+    2 * FixedImageDimension * ( FixedImageDimension - 1 ) );
+
+  /** The number of bits of the thermometer code of each channel. */
+  itkStaticConstMacro( BitsPerChannel, unsigned int, 64 / NumberOfChannels );
+
+  /** The descriptor images: all channels bit-packed in one word per voxel. */
+  typedef unsigned long long DescriptorValueType;
+  typedef Image< DescriptorValueType,
+    itkGetStaticConstMacro( FixedImageDimension ) >             DescriptorImageType;
+  typedef typename DescriptorImageType::Pointer DescriptorImagePointer;
+
+  /** Get the value for single valued optimizers. */
+  MeasureType GetValue( const TransformParametersType & parameters ) const override;
+
+  /** Get the derivatives of the match measure. */
+  void GetDerivative( const TransformParametersType & parameters,
+    DerivativeType & derivative ) const override;
+
+  /** Get value and derivative. */
+  void GetValueAndDerivative( const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const override;
+
+  /** Initialize the Metric by making sure that all the components
+   *  are present and plugged together correctly.
+   * \li Call the superclass' implementation
+   * \li Compute the descriptor images, if needed.
+   */
+  void Initialize( void ) override;
+
+  /** Set/Get the radius of the patches of the descriptor, in voxels. Default: 1. */
+  itkSetMacro( PatchRadius, unsigned int );
+  itkGetConstMacro( PatchRadius, unsigned int );
+
+  /** Set/Get the distance of the six-neighbourhood voxels of which the
+   * patches are compared, in voxels. Default: 2.
+   */
+  itkSetMacro( NeighbourhoodDistance, unsigned int );
+  itkGetConstMacro( NeighbourhoodDistance, unsigned int );
+
+  /** Get the descriptor images. */
+  itkGetConstObjectMacro( FixedDescriptorImage, DescriptorImageType );
+  itkGetConstObjectMacro( MovingDescriptorImage, DescriptorImageType );
+
+  /** Compute the bit-packed self-similarity context descriptors of an image,
+   * on its buffered region. Multi-threaded when UseMultiThread is set.
+   */
+  template< class TImage >
+  void ComputeDescriptorImage( const TImage * image,
+    const unsigned int patchRadius, const unsigned int neighbourhoodDistance,
+    DescriptorImageType * descriptors ) const;
+
+  /** The number of bits that differ between two descriptors. */
+  static unsigned int HammingDistance( const DescriptorValueType a, const DescriptorValueType b );
+
+protected:
+
+  SelfSimilarityContextImageToImageMetric();
+  ~SelfSimilarityContextImageToImageMetric() override {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+  /** Protected Typedefs ******************/
+
+  /** Typedefs inherited from superclass */
+  typedef typename Superclass::FixedImageIndexType            FixedImageIndexType;
+  typedef typename Superclass::MovingImageIndexType           MovingImageIndexType;
+  typedef typename Superclass::FixedImagePointType            FixedImagePointType;
+  typedef typename Superclass::MovingImagePointType           MovingImagePointType;
+  typedef typename Superclass::MovingImageContinuousIndexType MovingImageContinuousIndexType;
+  typedef typename Superclass::MovingImageDerivativeType      MovingImageDerivativeType;
+  typedef typename Superclass::NonZeroJacobianIndicesType     NonZeroJacobianIndicesType;
+
+  /** Compute the descriptor distance of a sample, and if gradient is not
+   * NULL its derivative to the mapped point. Returns false if the sample
+   * falls outside the descriptor images.
+   */
+  bool EvaluateDescriptorDistance(
+    const FixedImagePointType & fixedPoint,
+    const MovingImagePointType & mappedPoint,
+    RealType & distance,
+    MovingImageDerivativeType * gradient ) const;
+
+  /** Compute the value and, if derivative is not NULL, the derivative of the
+   * samples [begin, end). The derivative is accumulated.
+   */
+  void ComputeValueAndDerivativeOfSamples(
+    const unsigned long begin, const unsigned long end,
+    MeasureType & measure, DerivativeType * derivative,
+    unsigned long & numberOfPixelsCounted ) const;
+
+  /** Get value for each thread. */
+  void ThreadedGetValue( ThreadIdType threadID ) override;
+
+  /** Gather the values from all threads. */
+  void AfterThreadedGetValue( MeasureType & value ) const override;
+
+  /** Get value and derivatives for each thread. */
+  void ThreadedGetValueAndDerivative( ThreadIdType threadID ) override;
+
+  /** Gather the values and derivatives from all threads. */
+  void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const override;
+
+private:
+
+  SelfSimilarityContextImageToImageMetric( const Self & ); // purposely not implemented
+  void operator=( const Self & );                          // purposely not implemented
+
+  /** Compute the descriptors of an image, unless they are up to date. */
+  template< class TImage >
+  void UpdateDescriptorImage( const TImage * image,
+    DescriptorImagePointer & descriptors,
+    const DataObject * & cachedImage, ModifiedTimeType & cachedImageMTime,
+    unsigned int cachedSettings[ 2 ] );
+
+  /** Helper struct that multi-threads the computation of the descriptors
+   * using ITK threads. The descriptors are computed in two passes over the
+   * channels: the first computes the minimum and the mean of the patch
+   * distances, the second the descriptors.
+   */
+  struct MultiThreaderComputeDescriptorsType
+  {
+    const float *                          st_Intensities;
+    typename DescriptorImageType::SizeType st_Size;
+    unsigned int                           st_PatchRadius;
+    const OffsetValueType *                st_ChannelOffsets;
+    unsigned int                           st_Pass;
+    float *                                st_Minimum;
+    float *                                st_Variance;
+    DescriptorValueType *                  st_Descriptors;
+  };
+
+  /** ComputeDescriptors threader callback function. */
+  static ITK_THREAD_RETURN_TYPE ComputeDescriptorsThreaderCallback( void * arg );
+
+  /** Run a pass of the descriptor computation on the slices [begin, end)
+   * along the last axis.
+   */
+  static void ComputeDescriptorsOfSlab(
+    const MultiThreaderComputeDescriptorsType & parameters,
+    const SizeValueType sliceBegin, const SizeValueType sliceEnd );
+
+  /** Replace the data by its box sums with the given radius along the first
+   * numberOfAxes axes.
+   */
+  static void BoxFilter( std::vector< float > & data,
+    const typename DescriptorImageType::SizeType & size, const unsigned int radius,
+    const unsigned int numberOfAxes );
+
+  unsigned int m_PatchRadius;
+  unsigned int m_NeighbourhoodDistance;
+
+  /** The descriptor images, and the images and settings they were computed from. */
+  DescriptorImagePointer m_FixedDescriptorImage;
+  DescriptorImagePointer m_MovingDescriptorImage;
+  const DataObject *     m_FixedDescriptorSourceImage;
+  const DataObject *     m_MovingDescriptorSourceImage;
+  ModifiedTimeType       m_FixedDescriptorSourceMTime;
+  ModifiedTimeType       m_MovingDescriptorSourceMTime;
+  unsigned int           m_FixedDescriptorSettings[ 2 ];
+  unsigned int           m_MovingDescriptorSettings[ 2 ];
+
+  /** Converts a gradient to the continuous index of the moving descriptor
+   * image to a gradient in physical space.
+   */
+  Matrix< double, itkGetStaticConstMacro( MovingImageDimension ),
+    itkGetStaticConstMacro( MovingImageDimension ) > m_IndexToPhysicalGradient;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSelfSimilarityContextImageToImageMetric.hxx"
+#endif
+
+#endif // end #ifndef __itkSelfSimilarityContextImageToImageMetric_h
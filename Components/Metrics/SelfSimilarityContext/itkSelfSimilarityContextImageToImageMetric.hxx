@@ -0,0 +1,920 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkSelfSimilarityContextImageToImageMetric_hxx
+#define __itkSelfSimilarityContextImageToImageMetric_hxx
+
+#include "itkSelfSimilarityContextImageToImageMetric.h"
+#include "itkImageRegionConstIterator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::SelfSimilarityContextImageToImageMetric()
+{
+  this->SetUseImageSampler( true );
+  this->SetUseFixedImageLimiter( false );
+  this->SetUseMovingImageLimiter( false );
+
+  this->m_PatchRadius           = 1;
+  this->m_NeighbourhoodDistance = 2;
+
+  this->m_FixedDescriptorSourceImage  = NULL;
+  this->m_MovingDescriptorSourceImage = NULL;
+  this->m_FixedDescriptorSourceMTime  = 0;
+  this->m_MovingDescriptorSourceMTime = 0;
+  for( unsigned int i = 0; i < 2; ++i )
+  {
+    this->m_FixedDescriptorSettings[ i ]  = 0;
+    this->m_MovingDescriptorSettings[ i ] = 0;
+  }
+  this->m_IndexToPhysicalGradient.SetIdentity();
+
+} // end Constructor
+
+
+/**
+ * ********************* Initialize ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::Initialize( void )
+{
+  /** Initialize transform, interpolator, etc. */
+  Superclass::Initialize();
+
+  /** Compute the descriptors of the (pyramid) images of this resolution. */
+  this->UpdateDescriptorImage( this->m_FixedImage.GetPointer(),
+    this->m_FixedDescriptorImage, this->m_FixedDescriptorSourceImage,
+    this->m_FixedDescriptorSourceMTime, this->m_FixedDescriptorSettings );
+  this->UpdateDescriptorImage( this->m_MovingImage.GetPointer(),
+    this->m_MovingDescriptorImage, this->m_MovingDescriptorSourceImage,
+    this->m_MovingDescriptorSourceMTime, this->m_MovingDescriptorSettings );
+
+  /** The gradient to the continuous index is converted to a physical
+   * gradient by multiplication with direction * spacing^-1.
+   */
+  const typename DescriptorImageType::DirectionType & direction
+    = this->m_MovingDescriptorImage->GetDirection();
+  const typename DescriptorImageType::SpacingType & spacing
+    = this->m_MovingDescriptorImage->GetSpacing();
+  for( unsigned int i = 0; i < MovingImageDimension; ++i )
+  {
+    for( unsigned int j = 0; j < MovingImageDimension; ++j )
+    {
+      this->m_IndexToPhysicalGradient[ i ][ j ] = direction[ i ][ j ] / spacing[ j ];
+    }
+  }
+
+} // end Initialize()
+
+
+/**
+ * ******************* UpdateDescriptorImage *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateDescriptorImage( const TImage * image,
+  DescriptorImagePointer & descriptors,
+  const DataObject * & cachedImage, ModifiedTimeType & cachedImageMTime,
+  unsigned int cachedSettings[ 2 ] )
+{
+  /** The descriptors are only recomputed if the image or the settings changed. */
+  if( descriptors.IsNotNull()
+    && cachedImage == image && cachedImageMTime == image->GetMTime()
+    && cachedSettings[ 0 ] == this->m_PatchRadius
+    && cachedSettings[ 1 ] == this->m_NeighbourhoodDistance )
+  {
+    return;
+  }
+
+  if( descriptors.IsNull() )
+  {
+    descriptors = DescriptorImageType::New();
+  }
+  this->ComputeDescriptorImage( image,
+    this->m_PatchRadius, this->m_NeighbourhoodDistance, descriptors.GetPointer() );
+
+  cachedImage         = image;
+  cachedImageMTime    = image->GetMTime();
+  cachedSettings[ 0 ] = this->m_PatchRadius;
+  cachedSettings[ 1 ] = this->m_NeighbourhoodDistance;
+
+} // end UpdateDescriptorImage()
+
+
+/**
+ * ******************* ComputeDescriptorImage *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeDescriptorImage( const TImage * image,
+  const unsigned int patchRadius, const unsigned int neighbourhoodDistance,
+  DescriptorImageType * descriptors ) const
+{
+  typedef typename DescriptorImageType::RegionType RegionType;
+  const unsigned int Dimension = FixedImageDimension;
+
+  /** The descriptor image has the geometry of the buffered region of the image. */
+  const RegionType region = image->GetBufferedRegion();
+  descriptors->SetRegions( region );
+  descriptors->SetOrigin( image->GetOrigin() );
+  descriptors->SetSpacing( image->GetSpacing() );
+  descriptors->SetDirection( image->GetDirection() );
+  descriptors->Allocate();
+  descriptors->FillBuffer( NumericTraits< DescriptorValueType >::Zero );
+
+  const SizeValueType numberOfVoxels = region.GetNumberOfPixels();
+  if( numberOfVoxels == 0 )
+  {
+    return;
+  }
+
+  /** Copy the intensities, in buffer order. */
+  std::vector< float >              intensities( numberOfVoxels );
+  ImageRegionConstIterator< TImage > it( image, region );
+  for( SizeValueType k = 0; !it.IsAtEnd(); ++it, ++k )
+  {
+    intensities[ k ] = static_cast< float >( it.Get() );
+  }
+
+  /** The six-neighbourhood at the given distance, and all pairs of
+   * neighbours that are not opposite: neighbours 2d and 2d+1 are.
+   */
+  std::vector< OffsetValueType > neighbours( 2 * Dimension * Dimension, 0 );
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    neighbours[ 2 * d * Dimension + d ]       = -static_cast< OffsetValueType >( neighbourhoodDistance );
+    neighbours[ ( 2 * d + 1 ) * Dimension + d ] = static_cast< OffsetValueType >( neighbourhoodDistance );
+  }
+  std::vector< OffsetValueType > channelOffsets;
+  for( unsigned int a = 0; a < 2 * Dimension; ++a )
+  {
+    for( unsigned int b = a + 1; b < 2 * Dimension; ++b )
+    {
+      if( !( a % 2 == 0 && b == a + 1 ) )
+      {
+        channelOffsets.insert( channelOffsets.end(),
+          neighbours.begin() + a * Dimension, neighbours.begin() + ( a + 1 ) * Dimension );
+        channelOffsets.insert( channelOffsets.end(),
+          neighbours.begin() + b * Dimension, neighbours.begin() + ( b + 1 ) * Dimension );
+      }
+    }
+  }
+
+  /** Two passes over the channels: the first to compute the minimum and the
+   * mean of the patch distances, the second to compute the descriptors. This
+   * avoids storing the patch distances of all channels.
+   */
+  std::vector< float >                minimum( numberOfVoxels );
+  std::vector< float >                variance( numberOfVoxels, 0.0f );
+  MultiThreaderComputeDescriptorsType parameters;
+  parameters.st_Intensities    = &intensities[ 0 ];
+  parameters.st_Size           = region.GetSize();
+  parameters.st_PatchRadius    = patchRadius;
+  parameters.st_ChannelOffsets = &channelOffsets[ 0 ];
+  parameters.st_Minimum        = &minimum[ 0 ];
+  parameters.st_Variance       = &variance[ 0 ];
+  parameters.st_Descriptors    = descriptors->GetBufferPointer();
+  for( unsigned int pass = 0; pass < 2; ++pass )
+  {
+    parameters.st_Pass = pass;
+    if( this->m_UseMultiThread )
+    {
+      this->m_Threader->SetSingleMethod( ComputeDescriptorsThreaderCallback,
+        const_cast< void * >( static_cast< const void * >( &parameters ) ) );
+      this->m_Threader->SingleMethodExecute();
+    }
+    else
+    {
+      Self::ComputeDescriptorsOfSlab( parameters, 0, parameters.st_Size[ Dimension - 1 ] );
+    }
+
+    if( pass == 0 )
+    {
+      /** The mean of the patch distances relative to the minimum, limited to
+       * a range around its image average for robustness to noise and
+       * homogeneous regions.
+       */
+      double meanVariance = 0.0;
+      for( SizeValueType k = 0; k < numberOfVoxels; ++k )
+      {
+        variance[ k ] = variance[ k ] / NumberOfChannels - minimum[ k ];
+        meanVariance += variance[ k ];
+      }
+      meanVariance /= static_cast< double >( numberOfVoxels );
+
+      const float lower = ( meanVariance > 0.0 ) ? static_cast< float >( 0.001 * meanVariance ) : 1.0f;
+      const float upper = ( meanVariance > 0.0 ) ? static_cast< float >( 1000.0 * meanVariance ) : 1.0f;
+      for( SizeValueType k = 0; k < numberOfVoxels; ++k )
+      {
+        variance[ k ] = std::min( std::max( variance[ k ], lower ), upper );
+      }
+    }
+  }
+
+} // end ComputeDescriptorImage()
+
+
+/**
+ * ******************* ComputeDescriptorsThreaderCallback *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeDescriptorsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
+
+  MultiThreaderComputeDescriptorsType * temp
+    = static_cast< MultiThreaderComputeDescriptorsType * >( infoStruct->UserData );
+
+  /** Each thread processes a slab of slices along the last axis. */
+  const SizeValueType numberOfSlices = temp->st_Size[ FixedImageDimension - 1 ];
+  const SizeValueType subSize        = static_cast< SizeValueType >(
+    std::ceil( static_cast< double >( numberOfSlices ) / static_cast< double >( nrOfThreads ) ) );
+  const SizeValueType pos_begin = std::min( subSize * threadId, numberOfSlices );
+  const SizeValueType pos_end   = std::min( subSize * ( threadId + 1 ), numberOfSlices );
+
+  Self::ComputeDescriptorsOfSlab( *temp, pos_begin, pos_end );
+
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end ComputeDescriptorsThreaderCallback()
+
+
+/**
+ * ******************* ComputeDescriptorsOfSlab *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeDescriptorsOfSlab(
+  const MultiThreaderComputeDescriptorsType & parameters,
+  const SizeValueType sliceBegin, const SizeValueType sliceEnd )
+{
+  typedef typename DescriptorImageType::SizeType SizeType;
+  const unsigned int Dimension = FixedImageDimension;
+  const unsigned int lastAxis  = Dimension - 1;
+  if( sliceBegin >= sliceEnd )
+  {
+    return;
+  }
+
+  /** The strides of the buffer. */
+  const SizeType & size = parameters.st_Size;
+  OffsetValueType  stride[ Dimension ];
+  stride[ 0 ] = 1;
+  for( unsigned int d = 1; d < Dimension; ++d )
+  {
+    stride[ d ] = stride[ d - 1 ] * static_cast< OffsetValueType >( size[ d - 1 ] );
+  }
+  const SizeValueType sliceSize = static_cast< SizeValueType >( stride[ lastAxis ] );
+
+  /** The patch distances are computed on the slab extended by the patch
+   * radius, so that the patch sums of the slab voxels are complete.
+   */
+  const SizeValueType radius    = parameters.st_PatchRadius;
+  const SizeValueType haloBegin = ( sliceBegin > radius ) ? sliceBegin - radius : 0;
+  const SizeValueType haloEnd   = std::min( sliceEnd + radius, static_cast< SizeValueType >( size[ lastAxis ] ) );
+  SizeType            haloSize  = size;
+  haloSize[ lastAxis ] = haloEnd - haloBegin;
+
+  const SizeValueType   numberOfHaloVoxels = sliceSize * haloSize[ lastAxis ];
+  const SizeValueType   numberOfSlabVoxels = sliceSize * ( sliceEnd - sliceBegin );
+  float * const         minimum            = parameters.st_Minimum + sliceBegin * sliceSize;
+  float * const         variance           = parameters.st_Variance + sliceBegin * sliceSize;
+  DescriptorValueType * buffer             = parameters.st_Descriptors + sliceBegin * sliceSize;
+  std::vector< float >  distances( numberOfHaloVoxels );
+  std::vector< double > sliceSums( sliceSize );
+  std::vector< float >  slabDistances( numberOfSlabVoxels );
+  for( unsigned int c = 0; c < NumberOfChannels; ++c )
+  {
+    const OffsetValueType * na = parameters.st_ChannelOffsets + 2 * c * Dimension;
+    const OffsetValueType * nb = na + Dimension;
+
+    /** The squared differences between the neighbours, clamped to the image. */
+    OffsetValueType index[ Dimension ];
+    std::fill( index, index + Dimension, 0 );
+    index[ lastAxis ] = static_cast< OffsetValueType >( haloBegin );
+    for( SizeValueType k = 0; k < numberOfHaloVoxels; ++k )
+    {
+      OffsetValueType offsetA = 0;
+      OffsetValueType offsetB = 0;
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        const OffsetValueType last = static_cast< OffsetValueType >( size[ d ] ) - 1;
+        offsetA += std::min( std::max( index[ d ] + na[ d ], OffsetValueType( 0 ) ), last ) * stride[ d ];
+        offsetB += std::min( std::max( index[ d ] + nb[ d ], OffsetValueType( 0 ) ), last ) * stride[ d ];
+      }
+      const float diff = parameters.st_Intensities[ offsetA ] - parameters.st_Intensities[ offsetB ];
+      distances[ k ] = diff * diff;
+
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        if( ++index[ d ] < static_cast< OffsetValueType >( size[ d ] ) )
+        {
+          break;
+        }
+        index[ d ] = 0;
+      }
+    }
+
+    /** Sum over the patches. Along the last axis the sums are computed
+     * directly, so that they do not depend on the slab boundaries.
+     */
+    Self::BoxFilter( distances, haloSize, parameters.st_PatchRadius, lastAxis );
+    for( SizeValueType slice = sliceBegin; slice < sliceEnd; ++slice )
+    {
+      const SizeValueType lower = ( slice > radius ) ? slice - radius : 0;
+      const SizeValueType upper = std::min( slice + radius + 1, static_cast< SizeValueType >( size[ lastAxis ] ) );
+      std::fill( sliceSums.begin(), sliceSums.end(), 0.0 );
+      for( SizeValueType t = lower; t < upper; ++t )
+      {
+        const float * sliceData = &distances[ ( t - haloBegin ) * sliceSize ];
+        for( SizeValueType k = 0; k < sliceSize; ++k )
+        {
+          sliceSums[ k ] += sliceData[ k ];
+        }
+      }
+      float * slabData = &slabDistances[ ( slice - sliceBegin ) * sliceSize ];
+      for( SizeValueType k = 0; k < sliceSize; ++k )
+      {
+        slabData[ k ] = static_cast< float >( sliceSums[ k ] );
+      }
+    }
+
+    if( parameters.st_Pass == 0 )
+    {
+      for( SizeValueType k = 0; k < numberOfSlabVoxels; ++k )
+      {
+        minimum[ k ]   = ( c == 0 ) ? slabDistances[ k ] : std::min( minimum[ k ], slabDistances[ k ] );
+        variance[ k ] += slabDistances[ k ];
+      }
+      continue;
+    }
+
+    /** Quantize the descriptor value and store it as a thermometer code. */
+    for( SizeValueType k = 0; k < numberOfSlabVoxels; ++k )
+    {
+      const double       value = std::exp( -( slabDistances[ k ] - minimum[ k ] ) / variance[ k ] );
+      const unsigned int level = static_cast< unsigned int >( value * BitsPerChannel + 0.5 );
+      buffer[ k ] |= ( ( DescriptorValueType( 1 ) << level ) - 1 ) << ( c * BitsPerChannel );
+    }
+  }
+
+} // end ComputeDescriptorsOfSlab()
+
+
+/**
+ * ******************* BoxFilter *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::BoxFilter( std::vector< float > & data,
+  const typename DescriptorImageType::SizeType & size, const unsigned int radius,
+  const unsigned int numberOfAxes )
+{
+  std::vector< double > prefixSums;
+  SizeValueType         stride = 1;
+  for( unsigned int axis = 0; axis < numberOfAxes; ++axis )
+  {
+    const SizeValueType length        = size[ axis ];
+    const SizeValueType numberOfLines = data.size() / length;
+    const SizeValueType r             = std::min( static_cast< SizeValueType >( radius ), length - 1 );
+    prefixSums.resize( length + 1 );
+
+    /** Every box sum is the difference of two prefix sums along the line. */
+    for( SizeValueType line = 0; line < numberOfLines; ++line )
+    {
+      float * lineData = &data[ line % stride + ( line / stride ) * stride * length ];
+
+      prefixSums[ 0 ] = 0.0;
+      for( SizeValueType i = 0; i < length; ++i )
+      {
+        prefixSums[ i + 1 ] = prefixSums[ i ] + lineData[ i * stride ];
+      }
+      for( SizeValueType i = 0; i < length; ++i )
+      {
+        const SizeValueType lower = ( i > r ) ? i - r : 0;
+        const SizeValueType upper = std::min( i + r + 1, length );
+        lineData[ i * stride ] = static_cast< float >( prefixSums[ upper ] - prefixSums[ lower ] );
+      }
+    }
+
+    stride *= length;
+  }
+
+} // end BoxFilter()
+
+
+/**
+ * ******************* HammingDistance *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+unsigned int
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::HammingDistance( const DescriptorValueType a, const DescriptorValueType b )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+  return static_cast< unsigned int >( __builtin_popcountll( a ^ b ) );
+#else
+  /** Count the bits in parallel, see "Bit Twiddling Hacks". */
+  DescriptorValueType x = a ^ b;
+  x = x - ( ( x >> 1 ) & 0x5555555555555555ULL );
+  x = ( x & 0x3333333333333333ULL ) + ( ( x >> 2 ) & 0x3333333333333333ULL );
+  x = ( x + ( x >> 4 ) ) & 0x0F0F0F0F0F0F0F0FULL;
+  return static_cast< unsigned int >( ( x * 0x0101010101010101ULL ) >> 56 );
+#endif
+
+} // end HammingDistance()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "PatchRadius: " << this->m_PatchRadius << std::endl;
+  os << indent << "NeighbourhoodDistance: " << this->m_NeighbourhoodDistance << std::endl;
+  os << indent << "NumberOfChannels: " << NumberOfChannels << std::endl;
+  os << indent << "BitsPerChannel: " << BitsPerChannel << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ******************* EvaluateDescriptorDistance *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluateDescriptorDistance(
+  const FixedImagePointType & fixedPoint,
+  const MovingImagePointType & mappedPoint,
+  RealType & distance,
+  MovingImageDerivativeType * gradient ) const
+{
+  typedef typename DescriptorImageType::IndexType  DescriptorIndexType;
+  typedef typename DescriptorImageType::RegionType DescriptorRegionType;
+
+  /** The fixed image descriptor at the nearest voxel. */
+  DescriptorIndexType fixedIndex;
+  if( !this->m_FixedDescriptorImage->TransformPhysicalPointToIndex( fixedPoint, fixedIndex ) )
+  {
+    return false;
+  }
+  const DescriptorValueType fixedDescriptor = this->m_FixedDescriptorImage->GetPixel( fixedIndex );
+
+  /** The voxel below the mapped point, and the interpolation weights. */
+  MovingImageContinuousIndexType cindex;
+  this->m_MovingDescriptorImage->TransformPhysicalPointToContinuousIndex( mappedPoint, cindex );
+
+  const DescriptorRegionType & region = this->m_MovingDescriptorImage->GetBufferedRegion();
+  DescriptorIndexType          baseIndex;
+  DescriptorIndexType          lastIndex;
+  double                       weights[ MovingImageDimension ];
+  for( unsigned int d = 0; d < MovingImageDimension; ++d )
+  {
+    const double first = static_cast< double >( region.GetIndex()[ d ] );
+    lastIndex[ d ] = region.GetIndex()[ d ] + static_cast< IndexValueType >( region.GetSize()[ d ] ) - 1;
+    if( !( cindex[ d ] >= first && cindex[ d ] <= static_cast< double >( lastIndex[ d ] ) ) )
+    {
+      return false;
+    }
+    baseIndex[ d ] = static_cast< IndexValueType >( std::floor( cindex[ d ] ) );
+    weights[ d ]   = cindex[ d ] - static_cast< double >( baseIndex[ d ] );
+  }
+
+  /** Linearly interpolate the Hamming distances to the surrounding voxels. */
+  double                    interpolated = 0.0;
+  MovingImageDerivativeType indexGradient;
+  indexGradient.Fill( 0.0 );
+  for( unsigned int corner = 0; corner < ( 1u << MovingImageDimension ); ++corner )
+  {
+    DescriptorIndexType index;
+    double              weight = 1.0;
+    for( unsigned int d = 0; d < MovingImageDimension; ++d )
+    {
+      const unsigned int bit = ( corner >> d ) & 1;
+      index[ d ] = std::min( baseIndex[ d ] + static_cast< IndexValueType >( bit ), lastIndex[ d ] );
+      weight    *= bit ? weights[ d ] : 1.0 - weights[ d ];
+    }
+
+    const double hamming = static_cast< double >( Self::HammingDistance(
+      fixedDescriptor, this->m_MovingDescriptorImage->GetPixel( index ) ) );
+    interpolated += weight * hamming;
+
+    if( gradient )
+    {
+      for( unsigned int d = 0; d < MovingImageDimension; ++d )
+      {
+        double dweight = ( ( corner >> d ) & 1 ) ? 1.0 : -1.0;
+        for( unsigned int e = 0; e < MovingImageDimension; ++e )
+        {
+          if( e != d )
+          {
+            dweight *= ( ( corner >> e ) & 1 ) ? weights[ e ] : 1.0 - weights[ e ];
+          }
+        }
+        indexGradient[ d ] += dweight * hamming;
+      }
+    }
+  }
+
+  /** Normalize by the number of bits, and convert the gradient to physical space. */
+  const double normalization = 1.0 / static_cast< double >( NumberOfChannels * BitsPerChannel );
+  distance = static_cast< RealType >( interpolated * normalization );
+  if( gradient )
+  {
+    for( unsigned int i = 0; i < MovingImageDimension; ++i )
+    {
+      double sum = 0.0;
+      for( unsigned int j = 0; j < MovingImageDimension; ++j )
+      {
+        sum += this->m_IndexToPhysicalGradient[ i ][ j ] * indexGradient[ j ];
+      }
+      ( *gradient )[ i ] = sum * normalization;
+    }
+  }
+
+  return true;
+
+} // end EvaluateDescriptorDistance()
+
+
+/**
+ * ******************* ComputeValueAndDerivativeOfSamples *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeValueAndDerivativeOfSamples(
+  const unsigned long begin, const unsigned long end,
+  MeasureType & measure, DerivativeType * derivative,
+  unsigned long & numberOfPixelsCounted ) const
+{
+  /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType   nzji  = NonZeroJacobianIndicesType( nnzji );
+  DerivativeType               imageJacobian( nnzji );
+
+  /** Create iterator over the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  typename ImageSampleContainerType::ConstIterator fiter;
+  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->Begin();
+  fbegin += (int)begin;
+  fend   += (int)end;
+
+  /** Loop over the samples to calculate the descriptor distances. */
+  for( fiter = fbegin; fiter != fend; ++fiter )
+  {
+    /** Read fixed coordinates and initialize some variables. */
+    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    RealType                    distance;
+    MovingImagePointType        mappedPoint;
+    MovingImageDerivativeType   distanceGradient;
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+
+    /** Check if point is inside mask. */
+    if( sampleOk )
+    {
+      sampleOk = this->IsInsideMovingMask( mappedPoint );
+    }
+
+    /** Compute the descriptor distance and its spatial derivative, and
+     * check if the point is inside the descriptor images.
+     */
+    if( sampleOk )
+    {
+      sampleOk = this->EvaluateDescriptorDistance( fixedPoint, mappedPoint,
+        distance, derivative ? &distanceGradient : 0 );
+    }
+
+    if( sampleOk )
+    {
+      numberOfPixelsCounted++;
+      measure += distance;
+
+      if( derivative )
+      {
+        /** Compute the inner product of the transform Jacobian dT/dmu and the distance gradient. */
+        this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+          fixedPoint, distanceGradient, imageJacobian, nzji );
+
+        for( unsigned int i = 0; i < imageJacobian.GetSize(); ++i )
+        {
+          ( *derivative )[ nzji[ i ] ] += imageJacobian[ i ];
+        }
+      }
+    } // end if sampleOk
+
+  } // end for loop over the image sample container
+
+} // end ComputeValueAndDerivativeOfSamples()
+
+
+/**
+ * ******************* GetValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::GetValue( const TransformParametersType & parameters ) const
+{
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  if( this->m_UseMultiThread )
+  {
+    /** Launch multi-threading metric */
+    this->LaunchGetValueThreaderCallback();
+
+    /** Gather the metric values from all threads. */
+    this->AfterThreadedGetValue( value );
+    return value;
+  }
+
+  /** Single-threaded: evaluate all samples at once. */
+  const unsigned long numberOfSamples = this->GetImageSampler()->GetOutput()->Size();
+  unsigned long       numberOfPixelsCounted = 0;
+  this->ComputeValueAndDerivativeOfSamples( 0, numberOfSamples, value, NULL, numberOfPixelsCounted );
+
+  /** Check if enough samples were valid. */
+  this->m_NumberOfPixelsCounted = numberOfPixelsCounted;
+  this->CheckNumberOfSamples( numberOfSamples, this->m_NumberOfPixelsCounted );
+
+  return value / static_cast< MeasureType >( this->m_NumberOfPixelsCounted );
+
+} // end GetValue()
+
+
+/**
+ * ******************* ThreadedGetValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValue( ThreadIdType threadId )
+{
+  /** Get the samples for this thread. */
+  const unsigned long sampleContainerSize = this->GetImageSampler()->GetOutput()->Size();
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( Self::GetNumberOfThreads() ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
+
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+  MeasureType   measure               = NumericTraits< MeasureType >::Zero;
+  this->ComputeValueAndDerivativeOfSamples( pos_begin, pos_end, measure, NULL, numberOfPixelsCounted );
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value                 = measure;
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ******************* AfterThreadedGetValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::AfterThreadedGetValue( MeasureType & value ) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfThreads();
+
+  /** Accumulate the number of pixels and the values. */
+  this->m_NumberOfPixelsCounted = 0;
+  value                         = NumericTraits< MeasureType >::Zero;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    this->m_NumberOfPixelsCounted += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted;
+    value                         += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
+
+    /** Reset these variables for the next iteration. */
+    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = 0;
+    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value                 = NumericTraits< MeasureType >::Zero;
+  }
+
+  /** Check if enough samples were valid. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->CheckNumberOfSamples(
+    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+
+  value /= static_cast< MeasureType >( this->m_NumberOfPixelsCounted );
+
+} // end AfterThreadedGetValue()
+
+
+/**
+ * ******************* GetDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::GetDerivative(
+  const TransformParametersType & parameters,
+  DerivativeType & derivative ) const
+{
+  /** When the derivative is calculated, all information for calculating
+   * the metric value is available. It does not cost anything to calculate
+   * the metric value now. Therefore, we have chosen to only implement the
+   * GetValueAndDerivative(), supplying it with a dummy value variable.
+   */
+  MeasureType dummyvalue = NumericTraits< MeasureType >::Zero;
+  this->GetValueAndDerivative( parameters, dummyvalue, derivative );
+
+} // end GetDerivative()
+
+
+/**
+ * ******************* GetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueAndDerivative(
+  const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * Because of these calls GetValueAndDerivative itself is not thread-safe,
+   * so cannot be called multiple times simultaneously.
+   * This is however needed in the CombinationImageToImageMetric.
+   * In that case, you need to:
+   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
+   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
+   *   calling GetValueAndDerivative
+   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
+   * - Now you can call GetValueAndDerivative multi-threaded.
+   */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+
+  derivative.SetSize( this->GetNumberOfParameters() );
+  if( this->m_UseMultiThread )
+  {
+    /** Launch multi-threading metric */
+    this->LaunchGetValueAndDerivativeThreaderCallback();
+
+    /** Gather the metric values and derivatives from all threads. */
+    this->AfterThreadedGetValueAndDerivative( value, derivative );
+    return;
+  }
+
+  /** Single-threaded: evaluate all samples at once. */
+  const unsigned long numberOfSamples       = this->GetImageSampler()->GetOutput()->Size();
+  unsigned long       numberOfPixelsCounted = 0;
+  value = NumericTraits< MeasureType >::Zero;
+  derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+  this->ComputeValueAndDerivativeOfSamples( 0, numberOfSamples, value, &derivative, numberOfPixelsCounted );
+
+  /** Check if enough samples were valid. */
+  this->m_NumberOfPixelsCounted = numberOfPixelsCounted;
+  this->CheckNumberOfSamples( numberOfSamples, this->m_NumberOfPixelsCounted );
+
+  const DerivativeValueType normal_sum
+    = 1.0 / static_cast< DerivativeValueType >( this->m_NumberOfPixelsCounted );
+  value      *= normal_sum;
+  derivative *= normal_sum;
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueAndDerivative( ThreadIdType threadId )
+{
+  /** Get a handle to the pre-allocated derivative for the current thread.
+   * The initialization is performed at the beginning of each resolution in
+   * InitializeThreadingParameters(), and at the end of each iteration in
+   * AfterThreadedGetValueAndDerivative() and the accumulate functions.
+   */
+  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
+
+  /** Get the samples for this thread. */
+  const unsigned long sampleContainerSize = this->GetImageSampler()->GetOutput()->Size();
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( Self::GetNumberOfThreads() ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
+
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+  MeasureType   measure               = NumericTraits< MeasureType >::Zero;
+  this->ComputeValueAndDerivativeOfSamples( pos_begin, pos_end, measure, &derivative, numberOfPixelsCounted );
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value                 = measure;
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SelfSimilarityContextImageToImageMetric< TFixedImage, TMovingImage >
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Gather the values and the number of pixels. */
+  this->AfterThreadedGetValue( value );
+
+  /** Accumulate derivatives multi-threadedly with itk threads. */
+  this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor
+    = static_cast< DerivativeValueType >( this->m_NumberOfPixelsCounted );
+
+  this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkSelfSimilarityContextImageToImageMetric_hxx
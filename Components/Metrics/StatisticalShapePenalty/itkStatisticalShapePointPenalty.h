@@ -35,6 +35,7 @@
 #include <vnl/algo/vnl_svd_economy.h>
 
 #include <string>
+#include <vector>
 
 namespace itk
 {
@@ -49,6 +50,15 @@ namespace itk
  * application to organ segmentation in cervical MR, Comput. Vis. Image Understand. (2013),
  * http://dx.doi.org/10.1016/j.cviu.2012.12.006
  *
+ * The landmarks are transformed, together with their transform Jacobians,
+ * in parallel. The derivative is computed in reverse mode: the gradient of
+ * the Mahalanobis distance with respect to the proposal vector is propagated
+ * back through the size normalization and centroid alignment to the mapped
+ * landmarks, and then multiplied with the (sparse) transform Jacobians. For
+ * the decomposed shape models this only needs products with the eigenvector
+ * matrix, instead of one product per transform parameter. All intermediate
+ * vectors are kept between iterations.
+ *
  * \ingroup RegistrationMetrics
  */
 
@@ -101,6 +111,9 @@ public:
   //typedef typename vnl_vector<VnlVectorType *> ProposalDerivativeType; //Cannot be linked
   typedef vnl_svd_economy< CoordRepType > PCACovarianceType;
 
+  /** Typedefs for multi-threading. */
+  typedef typename Superclass::ThreadInfoType ThreadInfoType;
+
   /** Initialization. */
   void Initialize( void ) override;
 
@@ -183,30 +196,38 @@ private:
   StatisticalShapePointPenalty( const Self & );  // purposely not implemented
   void operator=( const Self & );                // purposely not implemented
 
-  void FillProposalVector( const OutputPointType & fixedPoint,
-    const unsigned int vertexindex ) const;
+  /** Transform the landmarks, and compute their Jacobians if requested.
+   * This fills the first part of the proposal vector.
+   */
+  void FillProposalVectorAndJacobians( const bool computeJacobians ) const;
 
-  void FillProposalDerivative( const OutputPointType & fixedPoint,
-    const unsigned int vertexindex ) const;
+  /** Transform the landmarks in the range [ begin, end [. */
+  void FillProposalVectorAndJacobians( const unsigned int begin,
+    const unsigned int end, const bool computeJacobians ) const;
 
-  void UpdateCentroidAndAlignProposalVector(
-    const unsigned int shapeLength ) const;
+  /** The threader callback for FillProposalVectorAndJacobians(). */
+  static ITK_THREAD_RETURN_TYPE FillProposalVectorAndJacobiansThreaderCallback( void * arg );
 
-  void UpdateCentroidAndAlignProposalDerivative(
+  void UpdateCentroidAndAlignProposalVector(
     const unsigned int shapeLength ) const;
 
   void UpdateL2( const unsigned int shapeLength ) const;
 
   void NormalizeProposalVector( const unsigned int shapeLength ) const;
 
-  void UpdateL2AndNormalizeProposalDerivative( const unsigned int shapeLength ) const;
+  /** Compute the value from the proposal vector; also fills the difference
+   * vector and, for the decomposed models, its projections on the eigenvectors.
+   */
+  void CalculateValue( MeasureType & value ) const;
+
+  /** Compute the gradient of the value with respect to the proposal vector. */
+  void CalculateProposalGradient( const MeasureType & value ) const;
 
-  void CalculateValue( MeasureType & value, VnlVectorType & differenceVector,
-    VnlVectorType & centerrotated, VnlVectorType & eigrot ) const;
+  /** Propagate the proposal gradient back to the mapped landmark coordinates. */
+  void CalculatePointGradient( const unsigned int shapeLength ) const;
 
-  void CalculateDerivative( DerivativeType & derivative, const MeasureType & value,
-    const VnlVectorType & differenceVector, const VnlVectorType & centerrotated,
-    const VnlVectorType & eigrot, const unsigned int shapeLength ) const;
+  /** Multiply the landmark gradient with the transform Jacobians. */
+  void CalculateDerivative( DerivativeType & derivative ) const;
 
   void CalculateCutOffValue( MeasureType & value ) const;
 
@@ -214,6 +235,12 @@ private:
   typename DerivativeType::element_type & derivativeElement,
   const MeasureType &value ) const;
 
+  struct FillProposalThreaderParameterType
+  {
+    const Self * st_Metric;
+    bool         st_ComputeJacobians;
+  };
+
   const VnlVectorType * m_MeanVector;
   const VnlMatrixType * m_CovarianceMatrix;
   const VnlMatrixType * m_EigenVectors;
@@ -236,7 +263,6 @@ private:
 
   VnlVectorType * m_EigenValuesRegularized;
 
-  mutable ProposalDerivativeType * m_ProposalDerivative;
   unsigned int                     m_ProposalLength;
   bool                             m_NormalizedShapeModel;
   int                              m_ShapeModelCalculation;
@@ -249,6 +275,20 @@ private:
   double m_CutOffValue;
   double m_CutOffSharpness;
 
+  /** Workspace, allocated in Initialize() and reused in every iteration. */
+  std::vector< InputPointType >                     m_FixedPoints;
+  mutable std::vector< TransformJacobianType >      m_Jacobians;
+  mutable std::vector< NonZeroJacobianIndicesType > m_NonZeroJacobianIndices;
+  mutable VnlVectorType                             m_AlignedShape;
+  mutable VnlVectorType                             m_DifferenceVector;
+  mutable VnlVectorType                             m_CenterRotated;
+  mutable VnlVectorType                             m_EigRot;
+  mutable VnlVectorType                             m_ProposalGradient;
+  mutable VnlVectorType                             m_PointGradient;
+
+  /** Variables for multi-threading, using the threader of the superclass. */
+  mutable FillProposalThreaderParameterType m_FillProposalThreaderParameters;
+
 };
 
 } // end namespace itk
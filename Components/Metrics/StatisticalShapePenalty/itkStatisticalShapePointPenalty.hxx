@@ -35,13 +35,15 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   this->m_EigenVectors            = NULL;
   this->m_EigenValues             = NULL;
   this->m_EigenValuesRegularized  = NULL;
-  this->m_ProposalDerivative      = NULL;
   this->m_InverseCovarianceMatrix = NULL;
 
   this->m_ShrinkageIntensityNeedsUpdate = true;
   this->m_BaseVarianceNeedsUpdate       = true;
   this->m_VariancesNeedsUpdate          = true;
 
+  this->m_FillProposalThreaderParameters.st_Metric           = this;
+  this->m_FillProposalThreaderParameters.st_ComputeJacobians = false;
+
 } // end Constructor
 
 
@@ -78,11 +80,6 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
     delete this->m_EigenValuesRegularized;
     this->m_EigenValuesRegularized = NULL;
   }
-  if( this->m_ProposalDerivative != NULL )
-  {
-    delete this->m_ProposalDerivative;
-    this->m_ProposalDerivative = NULL;
-  }
   if( this->m_InverseCovarianceMatrix != NULL )
   {
     delete this->m_InverseCovarianceMatrix;
@@ -344,6 +341,24 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
       this->m_EigenValuesRegularized  = NULL;
   }
 
+  /** Allocate the workspace that is reused in every iteration. */
+  const unsigned int numberOfPoints = this->GetFixedPointSet()->GetNumberOfPoints();
+  this->m_FixedPoints.resize( numberOfPoints );
+  PointIterator pointItFixed = this->GetFixedPointSet()->GetPoints()->Begin();
+  for( unsigned int i = 0; i < numberOfPoints; ++i, ++pointItFixed )
+  {
+    this->m_FixedPoints[ i ] = pointItFixed.Value();
+  }
+  this->m_Jacobians.resize( numberOfPoints );
+  this->m_NonZeroJacobianIndices.assign( numberOfPoints, NonZeroJacobianIndicesType(
+    this->m_Transform->GetNumberOfNonZeroJacobianIndices() ) );
+
+  this->m_ProposalVector.set_size( this->m_ProposalLength );
+  this->m_DifferenceVector.set_size( this->m_ProposalLength );
+  this->m_ProposalGradient.set_size( this->m_ProposalLength );
+  this->m_AlignedShape.set_size( shapeLength );
+  this->m_PointGradient.set_size( shapeLength );
+
 } // end Initialize()
 
 
@@ -367,9 +382,6 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   //this->m_NumberOfPointsCounted = 0;
   MeasureType value = NumericTraits< MeasureType >::Zero;
 
-  //InputPointType movingPoint;
-  OutputPointType fixedPoint;
-
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
@@ -380,22 +392,8 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   /** Part 1:
    * - Copy point positions in proposal vector
    */
-
-  /** Create iterators. */
-  PointIterator pointItFixed = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointEnd     = fixedPointSet->GetPoints()->End();
-
-  unsigned int vertexindex = 0;
-  /** Loop over the corresponding points. */
-  while( pointItFixed != pointEnd )
-  {
-    fixedPoint = pointItFixed.Value();
-    this->FillProposalVector( fixedPoint, vertexindex );
-
-    this->m_NumberOfPointsCounted++;
-    ++pointItFixed;
-    vertexindex += Self::FixedPointSetDimension;
-  } // end loop over all corresponding points
+  this->FillProposalVectorAndJacobians( false );
+  this->m_NumberOfPointsCounted += fixedPointSet->GetNumberOfPoints();
 
   if( this->m_NormalizedShapeModel )
   {
@@ -415,11 +413,8 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
     this->NormalizeProposalVector( shapeLength );
   }
 
-  VnlVectorType differenceVector;
-  VnlVectorType centerrotated;
-  VnlVectorType eigrot;
-
-  this->CalculateValue( value, differenceVector, centerrotated, eigrot );
+  this->CalculateValue( value );
+  this->CalculateCutOffValue( value );
 
   return value;
 
@@ -470,39 +465,19 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   derivative = DerivativeType( this->GetNumberOfParameters() );
   derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
 
-  //InputPointType movingPoint;
-  OutputPointType fixedPoint;
-
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
   const unsigned int shapeLength = Self::FixedPointSetDimension
     * fixedPointSet->GetNumberOfPoints();
-
   this->m_ProposalVector.set_size( this->m_ProposalLength );
-  this->m_ProposalDerivative = new ProposalDerivativeType( this->GetNumberOfParameters(), NULL );
 
   /** Part 1:
    * - Copy point positions in proposal vector
-   * - Copy point derivatives in proposal derivative vector
+   * - Compute the transform Jacobians of all points
    */
-
-  /** Create iterators. */
-  PointIterator pointItFixed = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointEnd     = fixedPointSet->GetPoints()->End();
-
-  unsigned int vertexindex = 0;
-  /** Loop over the corresponding points. */
-  while( pointItFixed != pointEnd )
-  {
-    fixedPoint = pointItFixed.Value();
-    this->FillProposalVector( fixedPoint, vertexindex );
-    this->FillProposalDerivative( fixedPoint, vertexindex );
-
-    this->m_NumberOfPointsCounted++;
-    ++pointItFixed;
-    vertexindex += Self::FixedPointSetDimension;
-  } // end loop over all corresponding points
+  this->FillProposalVectorAndJacobians( true );
+  this->m_NumberOfPointsCounted += fixedPointSet->GetNumberOfPoints();
 
   if( this->m_NormalizedShapeModel )
   {
@@ -510,52 +485,38 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
      * - Calculate shape centroid
      * - put centroid values in proposal
      * - update proposal vector with aligned shape
-     * - Calculate centroid derivatives and update proposal derivative vectors
-     * - put centroid derivatives values in proposal derivatives
-     * - update proposal derivatives
      */
     this->UpdateCentroidAndAlignProposalVector( shapeLength );
-    this->UpdateCentroidAndAlignProposalDerivative( shapeLength );
 
     /** Part 3:
      * - Calculate l2-norm from aligned shapes
      * - put l2-norm value in proposal vector
+     * - keep the aligned shape for the derivative
      * - update proposal vector with size normalized shape
-     * - Calculate l2-norm derivatice from updated proposal vector
-     * - put l2-norm derivative value in proposal derivative vectors
-     * - update proposal derivatives
      */
     this->UpdateL2( shapeLength );
-    this->UpdateL2AndNormalizeProposalDerivative( shapeLength );
+    this->m_AlignedShape.set_size( shapeLength );
+    for( unsigned int index = 0; index < shapeLength; ++index )
+    {
+      this->m_AlignedShape[ index ] = this->m_ProposalVector[ index ];
+    }
     this->NormalizeProposalVector( shapeLength );
 
   } // end if(m_NormalizedShapeModel)
 
-  // TODO this declaration instantiates a zero sized vector, but it will be reassigned anyways.
-  VnlVectorType differenceVector;
-  VnlVectorType centerrotated;
-  VnlVectorType eigrot;
-
-  this->CalculateValue( value, differenceVector, centerrotated, eigrot );
+  this->CalculateValue( value );
 
+  /** Part 4:
+   * - Calculate the gradient of the value with respect to the proposal vector
+   * - propagate it back to the mapped points
+   * - multiply with the transform Jacobians
+   */
   if( value != 0.0 )
   {
-    this->CalculateDerivative( derivative, value, differenceVector, centerrotated, eigrot, shapeLength );
-  }
-  else
-  {
-    typename ProposalDerivativeType::iterator proposalDerivativeIt  = this->m_ProposalDerivative->begin();
-    typename ProposalDerivativeType::iterator proposalDerivativeEnd = this->m_ProposalDerivative->end();
-    for(; proposalDerivativeIt != proposalDerivativeEnd; ++proposalDerivativeIt )
-    {
-      if( *proposalDerivativeIt != NULL )
-      {
-        delete ( *proposalDerivativeIt );
-      }
-    }
+    this->CalculateProposalGradient( value );
+    this->CalculatePointGradient( shapeLength );
+    this->CalculateDerivative( derivative );
   }
-  delete this->m_ProposalDerivative;
-  this->m_ProposalDerivative = NULL;
 
   this->CalculateCutOffValue( value );
 
@@ -563,75 +524,105 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
 
 
 /**
- * ******************* FillProposalVector *******************
+ * ******************* FillProposalVectorAndJacobians *******************
  */
 
 template< class TFixedPointSet, class TMovingPointSet >
 void
 StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
-::FillProposalVector( const OutputPointType & fixedPoint,
-  const unsigned int vertexindex ) const
+::FillProposalVectorAndJacobians( const bool computeJacobians ) const
 {
-  OutputPointType mappedPoint;
-  /** Get the current corresponding points. */
-  mappedPoint = this->m_Transform->TransformPoint( fixedPoint );
-
-  /** Copy n-D coordinates into big Shape vector. Aligning the centroids is done later. */
-  for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
+  const unsigned int numberOfPoints = this->m_FixedPoints.size();
+  if( !this->m_UseMultiThread )
   {
-    this->m_ProposalVector[ vertexindex + d ] = mappedPoint[ d ];
+    this->FillProposalVectorAndJacobians( 0, numberOfPoints, computeJacobians );
+    return;
   }
-} // end FillProposalVector()
+
+  /** Setup threader and launch. */
+  this->m_FillProposalThreaderParameters.st_Metric           = this;
+  this->m_FillProposalThreaderParameters.st_ComputeJacobians = computeJacobians;
+  this->m_Threader->SetSingleMethod( this->FillProposalVectorAndJacobiansThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_FillProposalThreaderParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+} // end FillProposalVectorAndJacobians()
 
 
 /**
- * ******************* FillProposalDerivative *******************
+ * ************ FillProposalVectorAndJacobiansThreaderCallback ****************************
  */
 
 template< class TFixedPointSet, class TMovingPointSet >
-void
+ITK_THREAD_RETURN_TYPE
 StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
-::FillProposalDerivative( const OutputPointType & fixedPoint,
-  const unsigned int vertexindex ) const
+::FillProposalVectorAndJacobiansThreaderCallback( void * arg )
 {
-  /**
-   * A (column) vector is constructed for each mu, only if that mu affects the shape penalty.
-   * I.e. if there is at least one point of the mesh with non-zero derivatives,
-   * a full column vector is instantiated (which can contain zeros for many other points)
-   *
-   * m_ProposalDerivative is a container with either full shape-vector-sized derivative vectors or NULL-s. Example:
-   *
-   * mu1: [ [ dx1/dmu1 , dy1/dmu1 , dz1/dmu1 ] , [ 0 , 0 , 0 ] , [ dx3/dmu1 , dy3/dmu1 , dz3/dmu1 ] , [...] ]^T
-   * mu2: Null
-   * mu3: [ [ 0 , 0 , 0 ] , [ dx2/dmu3 , dy2/dmu3 , dz2/dmu3 ] , [ dx3/dmu3 , dy3/dmu3 , dz3/dmu3 ] , [...] ]^T
-   *
-   */
+  /** Get the current thread id and user data. */
+  ThreadInfoType *                    infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType                        threadID    = infoStruct->ThreadID;
+  ThreadIdType                        nrOfThreads = infoStruct->NumberOfThreads;
+  FillProposalThreaderParameterType * temp
+    = static_cast< FillProposalThreaderParameterType * >( infoStruct->UserData );
+
+  /** Get the points for this thread. */
+  const unsigned int numberOfPoints = temp->st_Metric->m_FixedPoints.size();
+  const unsigned int nrOfPointsPerThread = static_cast< unsigned int >( std::ceil(
+    static_cast< double >( numberOfPoints ) / static_cast< double >( nrOfThreads ) ) );
+  unsigned int pos_begin = nrOfPointsPerThread * threadID;
+  unsigned int pos_end   = nrOfPointsPerThread * ( threadID + 1 );
+  pos_begin = ( pos_begin > numberOfPoints ) ? numberOfPoints : pos_begin;
+  pos_end   = ( pos_end > numberOfPoints ) ? numberOfPoints : pos_end;
+
+  temp->st_Metric->FillProposalVectorAndJacobians( pos_begin, pos_end, temp->st_ComputeJacobians );
+
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end FillProposalVectorAndJacobiansThreaderCallback()
 
-  NonZeroJacobianIndicesType nzji(
-  this->m_Transform->GetNumberOfNonZeroJacobianIndices() );
 
-  /** Get the TransformJacobian dT/dmu. */
-  TransformJacobianType jacobian;
-  this->m_Transform->GetJacobian( fixedPoint, jacobian, nzji );
+/**
+ * ******************* FillProposalVectorAndJacobians *******************
+ */
 
-  for( unsigned int i = 0; i < nzji.size(); ++i )
+template< class TFixedPointSet, class TMovingPointSet >
+void
+StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
+::FillProposalVectorAndJacobians( const unsigned int begin,
+  const unsigned int end, const bool computeJacobians ) const
+{
+  const unsigned long numberOfNonZeroJacobianIndices
+    = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+
+  for( unsigned int i = begin; i < end; ++i )
   {
-    const unsigned int mu = nzji[ i ];
-    if( ( *this->m_ProposalDerivative )[ mu ] == NULL )
+    const InputPointType & fixedPoint  = this->m_FixedPoints[ i ];
+    const OutputPointType  mappedPoint = this->m_Transform->TransformPoint( fixedPoint );
+
+    /** Copy n-D coordinates into big Shape vector. Aligning the centroids is done later. */
+    const unsigned int vertexindex = i * Self::FixedPointSetDimension;
+    for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
     {
-      /** Create the big column vector if it does not yet exist for this mu*/
-      ( *this->m_ProposalDerivative )[ mu ] = new VnlVectorType( this->m_ProposalLength, 0.0 );
-      // memory will be freed in CalculateDerivative()
+      this->m_ProposalVector[ vertexindex + d ] = mappedPoint[ d ];
     }
 
-    /** The column vector exists for this mu, so copy the jacobians for this point into the big vector. */
-    for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
+    /** Get the TransformJacobian dT/dmu. The Jacobian buffers are reused. */
+    if( computeJacobians )
     {
-      ( *( *this->m_ProposalDerivative )[ mu ] )[ vertexindex + d ] = jacobian.get_column( i )[ d ];
+      NonZeroJacobianIndicesType & nzji = this->m_NonZeroJacobianIndices[ i ];
+      if( nzji.size() != numberOfNonZeroJacobianIndices )
+      {
+        nzji.resize( numberOfNonZeroJacobianIndices );
+      }
+      this->m_Transform->GetJacobian( fixedPoint, this->m_Jacobians[ i ], nzji );
     }
   }
 
-} // end FillProposalVector()
+} // end FillProposalVectorAndJacobians()
 
 
 /**
@@ -670,44 +661,6 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
 } // end UpdateCentroidAndAlignProposalVector()
 
 
-/**
- * ******************* UpdateCentroidAndAlignProposalDerivative *******************
- */
-
-template< class TFixedPointSet, class TMovingPointSet >
-void
-StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
-::UpdateCentroidAndAlignProposalDerivative( const unsigned int shapeLength ) const
-{
-  typename ProposalDerivativeType::iterator proposalDerivativeIt  = m_ProposalDerivative->begin();
-  typename ProposalDerivativeType::iterator proposalDerivativeEnd = m_ProposalDerivative->end();
-  while( proposalDerivativeIt != proposalDerivativeEnd )
-  {
-    if( *proposalDerivativeIt != NULL )
-    {
-      for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
-      {
-        double & centroid_dDerivative = ( **proposalDerivativeIt )[ shapeLength + d ];
-        centroid_dDerivative = 0; // initialize accumulators to zero
-
-        for( unsigned int index = 0; index < shapeLength; index += Self::FixedPointSetDimension )
-        {
-          centroid_dDerivative += ( **proposalDerivativeIt )[ index + d ]; // sum all x derivatives
-        }
-
-        centroid_dDerivative /= this->GetFixedPointSet()->GetNumberOfPoints(); // divide sum to get average
-
-        for( unsigned int index = 0; index < shapeLength; index += Self::FixedPointSetDimension )
-        {
-          ( **proposalDerivativeIt )[ index + d ] -= centroid_dDerivative; // subtract average
-        }
-      }
-    }
-    ++proposalDerivativeIt;
-  }
-} // end UpdateCentroidAndAlignProposalDerivative()
-
-
 /**
  * ******************* UpdateL2 *******************
  */
@@ -753,213 +706,264 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
 
 
 /**
- * ******************* UpdateL2AndNormalizeProposalDerivative *******************
+ * ******************* CalculateValue *******************
  */
 
 template< class TFixedPointSet, class TMovingPointSet >
 void
 StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
-::UpdateL2AndNormalizeProposalDerivative( const unsigned int shapeLength ) const
+::CalculateValue( MeasureType & value ) const
 {
-  double & l2norm = this->m_ProposalVector[ shapeLength + Self::FixedPointSetDimension ];
+  const unsigned int proposalLength = this->m_ProposalLength;
+  VnlVectorType &    differenceVector = this->m_DifferenceVector;
 
-  typename ProposalDerivativeType::iterator proposalDerivativeIt  = this->m_ProposalDerivative->begin();
-  typename ProposalDerivativeType::iterator proposalDerivativeEnd = this->m_ProposalDerivative->end();
+  differenceVector.set_size( proposalLength );
+  for( unsigned int i = 0; i < proposalLength; ++i )
+  {
+    differenceVector[ i ] = this->m_ProposalVector[ i ] - ( *this->m_MeanVector )[ i ];
+  }
 
-  while( proposalDerivativeIt != proposalDerivativeEnd )
+  switch( this->m_ShapeModelCalculation )
   {
-    if( *proposalDerivativeIt != NULL )
+    case 0: // full covariance
     {
-      double & l2normDerivative = ( **proposalDerivativeIt )[ shapeLength + Self::FixedPointSetDimension ];
-      l2normDerivative = 0; // initialize to zero
-      // loop over all shape coordinates of the aligned shape
-      for( unsigned int index = 0; index < shapeLength; index++ )
+      /** diff^T * Sigma^-1, which is kept for the derivative. */
+      VnlVectorType & weightedDifference = this->m_ProposalGradient;
+      weightedDifference.set_size( proposalLength );
+      weightedDifference.fill( 0.0 );
+      for( unsigned int i = 0; i < proposalLength; ++i )
+      {
+        const double   diff_i = differenceVector[ i ];
+        const double * row    = ( *this->m_InverseCovarianceMatrix )[ i ];
+        for( unsigned int j = 0; j < proposalLength; ++j )
+        {
+          weightedDifference[ j ] += diff_i * row[ j ];
+        }
+      }
+      value = sqrt( dot_product( weightedDifference, differenceVector ) );
+      break;
+    }
+    case 1: // decomposed covariance (uniform regularization)
+    case 2: // decomposed scaled covariance (element specific regularization)
+    {
+      double regularization = this->m_ShrinkageIntensity * this->m_BaseVariance;
+      if( this->m_ShapeModelCalculation == 2 )
+      {
+        const unsigned int shapeLength = this->m_ProposalLength - Self::FixedPointSetDimension - 1;
+        for( unsigned int i = 0; i < shapeLength; ++i )
+        {
+          differenceVector[ i ] /= this->m_BaseStd;
+        }
+        differenceVector[ shapeLength     ] /= this->m_CentroidXStd;
+        differenceVector[ shapeLength + 1 ] /= this->m_CentroidYStd;
+        differenceVector[ shapeLength + 2 ] /= this->m_CentroidZStd;
+        differenceVector[ shapeLength + 3 ] /= this->m_SizeStd;
+        regularization = this->m_ShrinkageIntensity;
+      }
+
+      /** diff^T * V and diff^T * V * Lambda^-1 */
+      const unsigned int numberOfModes = this->m_EigenVectors->cols();
+      this->m_CenterRotated.set_size( numberOfModes );
+      this->m_CenterRotated.fill( 0.0 );
+      for( unsigned int i = 0; i < proposalLength; ++i )
+      {
+        const double   diff_i = differenceVector[ i ];
+        const double * row    = ( *this->m_EigenVectors )[ i ];
+        for( unsigned int j = 0; j < numberOfModes; ++j )
+        {
+          this->m_CenterRotated[ j ] += diff_i * row[ j ];
+        }
+      }
+      this->m_EigRot.set_size( numberOfModes );
+      for( unsigned int j = 0; j < numberOfModes; ++j )
       {
-        l2normDerivative += this->m_ProposalVector[ index ] * ( **proposalDerivativeIt )[ index ];
+        this->m_EigRot[ j ] = this->m_CenterRotated[ j ] / ( *this->m_EigenValuesRegularized )[ j ];
       }
-      l2normDerivative /= ( l2norm * sqrt( (double)( this->GetFixedPointSet()->GetNumberOfPoints() ) ) );
 
-      // loop over all shape coordinates of the aligned shape
-      for( unsigned int index = 0; index < shapeLength; index++ )
+      if( this->m_ShrinkageIntensity != 0 )
+      {
+        /** innerproduct diff^T * V * Lambda^-1 * V^T * diff  +  1/(sigma_0*Beta)* diff^T*diff*/
+        value = sqrt( dot_product( this->m_EigRot, this->m_CenterRotated )
+          + differenceVector.squared_magnitude() / regularization );
+      }
+      else
       {
-        // update normalized shape derivatives
-        ( **proposalDerivativeIt )[ index ] = ( **proposalDerivativeIt )[ index ]
-          / l2norm - this->m_ProposalVector[ index ] * l2normDerivative / ( l2norm * l2norm );
+        /** innerproduct diff^T * V * Lambda^-1 * V^T * diff*/
+        value = sqrt( dot_product( this->m_EigRot, this->m_CenterRotated ) );
       }
+      break;
     }
-    ++proposalDerivativeIt;
+    default:
+      break;
   }
 
-} //end UpdateL2AndNormalizeProposalDerivative()
+} //end CalculateValue()
 
 
 /**
- * ******************* CalculateValue *******************
+ * ******************* CalculateProposalGradient *******************
  */
 
 template< class TFixedPointSet, class TMovingPointSet >
 void
 StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
-::CalculateValue( MeasureType & value,
-  VnlVectorType & differenceVector,
-  VnlVectorType & centerrotated,
-  VnlVectorType & eigrot ) const
+::CalculateProposalGradient( const MeasureType & value ) const
 {
-  differenceVector = this->m_ProposalVector - *m_MeanVector;
+  const unsigned int proposalLength = this->m_ProposalLength;
+  VnlVectorType &    gradient       = this->m_ProposalGradient;
+
+  /** d/dp sqrt( f(p) ) = 1/(2 value) d/dp f(p), including the cut-off. */
+  typename DerivativeType::element_type scale = 1.0 / value;
+  this->CalculateCutOffDerivative( scale, value );
 
   switch( this->m_ShapeModelCalculation )
   {
     case 0: // full covariance
     {
-      value = sqrt( bracket( differenceVector, *this->m_InverseCovarianceMatrix, differenceVector ) );
+      /** Sigma^-T * diff was computed in CalculateValue(). */
+      gradient *= scale;
       break;
     }
     case 1: // decomposed covariance (uniform regularization)
-    {
-      centerrotated = differenceVector * ( *m_EigenVectors );                       /** diff^T * V */
-      eigrot        = element_quotient( centerrotated, *m_EigenValuesRegularized ); /** diff^T * V * Lambda^-1 */
-      if( this->m_ShrinkageIntensity != 0 )
-      {
-        /** innerproduct diff^T * V * Lambda^-1 * V^T * diff  +  1/(sigma_0*Beta)* diff^T*diff*/
-        value = sqrt( dot_product( eigrot, centerrotated )
-          + dot_product( differenceVector, differenceVector )
-          / ( this->m_ShrinkageIntensity * this->m_BaseVariance ) );
-      }
-      else
-      {
-        /** innerproduct diff^T * V * Lambda^-1 * V^T * diff*/
-        value = sqrt( dot_product( eigrot, centerrotated ) );
-      }
-      break;
-    }
     case 2: // decomposed scaled covariance (element specific regularization)
     {
-      const unsigned int shapeLength = this->m_ProposalLength - Self::FixedPointSetDimension - 1;
-      typename VnlVectorType::iterator diffElementIt = differenceVector.begin();
-      for( unsigned int diffElementIndex = 0; diffElementIndex < shapeLength; ++diffElementIndex, ++diffElementIt )
+      /** V * Lambda^-1 * V^T * diff, using only the eigenvector basis,
+       * + 1/(Beta*sigma_0^2) * diff.
+       */
+      const double regularization = this->m_ShapeModelCalculation == 1
+        ? this->m_ShrinkageIntensity * this->m_BaseVariance : this->m_ShrinkageIntensity;
+      const unsigned int numberOfModes = this->m_EigenVectors->cols();
+      gradient.set_size( proposalLength );
+      for( unsigned int i = 0; i < proposalLength; ++i )
       {
-        *diffElementIt /= this->m_BaseStd;
+        const double * row = ( *this->m_EigenVectors )[ i ];
+        double         sum = 0.0;
+        for( unsigned int j = 0; j < numberOfModes; ++j )
+        {
+          sum += row[ j ] * this->m_EigRot[ j ];
+        }
+        if( this->m_ShrinkageIntensity != 0 )
+        {
+          sum += this->m_DifferenceVector[ i ] / regularization;
+        }
+        gradient[ i ] = sum * scale;
       }
-      differenceVector[ shapeLength     ] /= this->m_CentroidXStd;
-      differenceVector[ shapeLength + 1 ] /= this->m_CentroidYStd;
-      differenceVector[ shapeLength + 2 ] /= this->m_CentroidZStd;
-      differenceVector[ shapeLength + 3 ] /= this->m_SizeStd;
 
-      centerrotated = differenceVector * ( *this->m_EigenVectors );                       /** diff^T * V */
-      eigrot        = element_quotient( centerrotated, *this->m_EigenValuesRegularized ); /** diff^T * V * Lambda^-1 */
-      if( this->m_ShrinkageIntensity != 0 )
+      /** The scaled model is evaluated on the scaled proposal. */
+      if( this->m_ShapeModelCalculation == 2 )
       {
-        /** innerproduct diff^T * ~V * I * ~V^T * diff  +  1/(Beta)* diff^T*diff*/
-        value = sqrt( dot_product( eigrot, centerrotated )
-          + differenceVector.squared_magnitude() / this->m_ShrinkageIntensity );
-      }
-      else
-      {
-        /** innerproduct diff^T * V * I * V^T * diff*/
-        value = sqrt( dot_product( eigrot, centerrotated ) );
+        const unsigned int shapeLength = proposalLength - Self::FixedPointSetDimension - 1;
+        for( unsigned int i = 0; i < shapeLength; ++i )
+        {
+          gradient[ i ] /= this->m_BaseStd;
+        }
+        gradient[ shapeLength     ] /= this->m_CentroidXStd;
+        gradient[ shapeLength + 1 ] /= this->m_CentroidYStd;
+        gradient[ shapeLength + 2 ] /= this->m_CentroidZStd;
+        gradient[ shapeLength + 3 ] /= this->m_SizeStd;
       }
-
       break;
     }
     default:
+      gradient.set_size( proposalLength );
+      gradient.fill( 0.0 );
       break;
   }
 
-} //end CalculateValue()
+} // end CalculateProposalGradient()
 
 
 /**
- * ******************* CalculateDerivative *******************
+ * ******************* CalculatePointGradient *******************
  */
 
 template< class TFixedPointSet, class TMovingPointSet >
 void
 StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
-::CalculateDerivative( DerivativeType & derivative,
-  const MeasureType & value,
-  const VnlVectorType & differenceVector,
-  const VnlVectorType & centerrotated,
-  const VnlVectorType & eigrot,
-  const unsigned int shapeLength ) const
+::CalculatePointGradient( const unsigned int shapeLength ) const
 {
-  typename ProposalDerivativeType::iterator proposalDerivativeIt  = this->m_ProposalDerivative->begin();
-  typename ProposalDerivativeType::iterator proposalDerivativeEnd = this->m_ProposalDerivative->end();
+  const VnlVectorType & gradient      = this->m_ProposalGradient;
+  VnlVectorType &       pointGradient = this->m_PointGradient;
+  pointGradient.set_size( shapeLength );
 
-  typename DerivativeType::iterator derivativeIt = derivative.begin();
+  if( !this->m_NormalizedShapeModel )
+  {
+    for( unsigned int index = 0; index < shapeLength; ++index )
+    {
+      pointGradient[ index ] = gradient[ index ];
+    }
+    return;
+  }
 
-  for(; proposalDerivativeIt != proposalDerivativeEnd; ++proposalDerivativeIt, ++derivativeIt )
+  /** Reverse the size normalization. The derivative of the proposal
+   * with respect to the aligned shape a is
+   *   d/dmu (a/l) = da/dmu / l - a dl/dmu / l^2,
+   *   dl/dmu      = a^T da/dmu / ( l sqrt(n) ),
+   * and the l2-norm itself is part of the proposal.
+   */
+  const VnlVectorType & aligned        = this->m_AlignedShape;
+  const double          numberOfPoints = static_cast< double >( this->GetFixedPointSet()->GetNumberOfPoints() );
+  const double          l2norm         = this->m_ProposalVector[ shapeLength + Self::FixedPointSetDimension ];
+
+  double gradientDotAligned = 0.0;
+  for( unsigned int index = 0; index < shapeLength; ++index )
+  {
+    gradientDotAligned += gradient[ index ] * aligned[ index ];
+  }
+  const double l2normGradient = ( gradient[ shapeLength + Self::FixedPointSetDimension ]
+    - gradientDotAligned / ( l2norm * l2norm ) ) / ( l2norm * sqrt( numberOfPoints ) );
+
+  for( unsigned int index = 0; index < shapeLength; ++index )
+  {
+    pointGradient[ index ] = gradient[ index ] / l2norm + l2normGradient * aligned[ index ];
+  }
+
+  /** Reverse the centroid alignment: a = x - mean(x), and the centroid
+   * itself is part of the proposal.
+   */
+  for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
   {
-    if( *proposalDerivativeIt != NULL )
+    double sum = 0.0;
+    for( unsigned int index = d; index < shapeLength; index += Self::FixedPointSetDimension )
     {
-      switch( this->m_ShapeModelCalculation )
-      {
-        case 0: // full covariance
-        {
-          /**innerproduct diff^T * Sigma^-1 * d/dmu (diff), where iterated over mu-s*/
-          *derivativeIt = bracket( differenceVector, *m_InverseCovarianceMatrix, ( **proposalDerivativeIt ) ) / value;
-          this->CalculateCutOffDerivative( *derivativeIt, value );
-          break;
-        }
-        case 1: // decomposed covariance (uniform regularization)
-        {
-          if( this->m_ShrinkageIntensity != 0 )
-          {
-            /** Innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu(diff)
-             * + 1/(Beta*sigma_0^2)*diff^T* d/dmu(diff), where iterated over mu-s
-             */
-            *derivativeIt = ( dot_product( eigrot, this->m_EigenVectors->transpose() * ( **proposalDerivativeIt ) )
-              + dot_product( differenceVector, **proposalDerivativeIt )
-              / ( this->m_ShrinkageIntensity * this->m_BaseVariance ) ) / value;
-            this->CalculateCutOffDerivative( *derivativeIt, value );
-          }
-          else //m_ShrinkageIntensity==0
-          {
-            /**innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu (diff), where iterated over mu-s*/
-            *derivativeIt = ( dot_product( eigrot, this->m_EigenVectors->transpose()
-              * ( **proposalDerivativeIt ) ) ) / value;
-            this->CalculateCutOffDerivative( *derivativeIt, value );
-          }
-          break;
-        }
-        case 2: // decomposed scaled covariance (element specific regularization)
-        {
-          // first scale proposalDerivatives with their sigma's in order to evaluate
-          // with the EigenValues and EigenVectors of the scaled CovarianceMatrix
-          typename VnlVectorType::iterator propDerivElementIt = ( *proposalDerivativeIt )->begin();
-          for( unsigned int propDerivElementIndex = 0; propDerivElementIndex < shapeLength;
-            ++propDerivElementIndex, ++propDerivElementIt )
-          {
-            ( *propDerivElementIt ) /= this->m_BaseStd;
-          }
-          ( **proposalDerivativeIt )[ shapeLength     ] /= this->m_CentroidXStd;
-          ( **proposalDerivativeIt )[ shapeLength + 1 ] /= this->m_CentroidYStd;
-          ( **proposalDerivativeIt )[ shapeLength + 2 ] /= this->m_CentroidZStd;
-          ( **proposalDerivativeIt )[ shapeLength + 3 ] /= this->m_SizeStd;
-          if( this->m_ShrinkageIntensity != 0 )
-          {
-            /** innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu(diff)
-             * + 1/(Beta*sigma_0^2)*diff^T* d/dmu(diff), where iterated over mu-s
-             */
-            *derivativeIt = ( dot_product( eigrot, this->m_EigenVectors->transpose() * ( **proposalDerivativeIt ) )
-              + dot_product( differenceVector, **proposalDerivativeIt )
-              / this->m_ShrinkageIntensity ) / value;
-            this->CalculateCutOffDerivative( *derivativeIt, value );
-          }
-          else //m_ShrinkageIntensity==0
-          {
-            /**innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu (diff), where iterated over mu-s*/
-            *derivativeIt = ( dot_product( eigrot, this->m_EigenVectors->transpose()
-              * ( **proposalDerivativeIt ) ) ) / value;
-            this->CalculateCutOffDerivative( *derivativeIt, value );
-          }
-          break;
-        }
-        default:
-        {}
+      sum += pointGradient[ index ];
+    }
+    const double shift = ( gradient[ shapeLength + d ] - sum ) / numberOfPoints;
+    for( unsigned int index = d; index < shapeLength; index += Self::FixedPointSetDimension )
+    {
+      pointGradient[ index ] += shift;
+    }
+  }
+
+} // end CalculatePointGradient()
 
-          delete ( *proposalDerivativeIt );
-          // nzjacs++;
+
+/**
+ * ******************* CalculateDerivative *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
+::CalculateDerivative( DerivativeType & derivative ) const
+{
+  /** derivative = sum over the points of dT/dmu^T * d value / dT. */
+  const unsigned int numberOfPoints = this->m_FixedPoints.size();
+  for( unsigned int i = 0; i < numberOfPoints; ++i )
+  {
+    const TransformJacobianType &      jacobian = this->m_Jacobians[ i ];
+    const NonZeroJacobianIndicesType & nzji     = this->m_NonZeroJacobianIndices[ i ];
+    const double *                     pointGradient
+      = this->m_PointGradient.data_block() + i * Self::FixedPointSetDimension;
+
+    for( unsigned int mu = 0; mu < nzji.size(); ++mu )
+    {
+      double sum = 0.0;
+      for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
+      {
+        sum += jacobian( d, mu ) * pointGradient[ d ];
       }
+      derivative[ nzji[ mu ] ] += sum;
     }
   }
 
@@ -115,6 +115,7 @@ public:
   /** Some typedefs for computing the SelfHessian */
   typedef typename Superclass1::PreconditionValueType     PreconditionValueType;
   typedef typename Superclass1::PreconditionType          PreconditionType;
+  typedef typename Superclass1::CompressedPreconditionType CompressedPreconditionType;
   //typedef typename Superclass1::EigenSystemType           EigenSystemType;
 
   /** Methods invoked by elastix, in which parameters can be set and
@@ -25,7 +25,7 @@
 #include "itkExceptionObject.h"
 #include "vnl/vnl_math.h"
 #include "vnl/vnl_vector.h"
-#include "vnl/algo/vnl_sparse_symmetric_eigensystem.h"
+#include <cmath>
 
 namespace itk
 {
@@ -372,69 +372,52 @@ void
 PreconditionedGradientDescentOptimizer
 ::SetPreconditionMatrix( PreconditionType & precondition )
 {
-  /** Compute and modify eigensystem of preconditioning matrix.
-   * Does not take into account scales (yet)!
-   */
-  itkDebugMacro("SetPreconditionMatrix");
+  /** Convert to compressed row format; this releases the input matrix. */
+  CompressedPreconditionType compressedPrecondition;
+  compressedPrecondition.CopyFromAndRelease( precondition );
+  this->SetPreconditionMatrix( compressedPrecondition );
 
-  typedef PreconditionType::row             RowType;
-  typedef RowType::const_iterator           RowIteratorType;
-  typedef vnl_vector<PreconditionValueType> DiagonalType;
+} // end SetPreconditionMatrix()
 
-  const size_t spaceDimension = static_cast<size_t>( precondition.cols() );
 
-  /** Count the number of nonzero elements. */
-  size_t nnz = 0;
+/**
+ * ************ SetPreconditionMatrix ****************************
+ */
 
-  /** Estimates largest eigenvalue. */
-  double maxDiag = 0;
+void
+PreconditionedGradientDescentOptimizer
+::SetPreconditionMatrix( CompressedPreconditionType & precondition )
+{
+  /** Modify the preconditioning matrix and compute its Cholesky decomposition.
+   * Does not take into account scales (yet)!
+   */
+  itkDebugMacro("SetPreconditionMatrix");
 
-  /** estimate of largest eigenvalue, not very accurate */
-  //DiagonalType diagP( spaceDimension );
-  //precondition.diag_AtA( diagP );
-  //const double frobnormP = std::sqrt( diagP.sum() );
+  typedef CompressedPreconditionType::IndexContainerType IndexContainerType;
+  typedef CompressedPreconditionType::ValueContainerType ValueContainerType;
 
-  /** Check range of eigenvalues */
-  for( unsigned int r = 0; r < spaceDimension; ++r )
-  {
-    PreconditionValueType & prr = precondition( r, r );
-    maxDiag = vnl_math_max( maxDiag, prr );
-  }
+  const size_t spaceDimension = static_cast<size_t>( precondition.GetNumberOfRows() );
+  IndexContainerType & rowPointers = precondition.GetRowPointers();
+  IndexContainerType & columnIndices = precondition.GetColumnIndices();
+  ValueContainerType & values = precondition.GetValues();
 
-  /** make positive definite by adding a small negligible fraction of maxDiag.
-   * This does not really affect the maximum eigen value, but seems to make
-   * the eig routine a bit more robust.
+  /** The diagonal element is the first element of a row, if present.
+   * Rows without diagonal element get one, with value zero.
    */
-  const double diagTemp = maxDiag * 1e-3;
-  for( unsigned int r = 0; r < spaceDimension; ++r )
-  {
-    PreconditionValueType & prr = precondition( r, r );
-    prr += diagTemp;
-  }
-
-  /** Estimate largest eigenvalue to 1 decimal digit precision
-   * If eig fails (which it does quite regularly) use the maxDiag value.
-   */
-  const long ndigits = 1;
-  vnl_sparse_symmetric_eigensystem eig;
-  int errorCode = eig.CalculateNPairs( precondition, 1, false, ndigits );
-  double & largestEig = this->m_LargestEigenValue;
-  if( errorCode == 0 )
-  {
-    largestEig = eig.get_eigenvalue( 0 );
-  }
-  else
-  {
-    largestEig = maxDiag;
-  }
-
-  /** Subtract diagTemp and add diagWeight * largestEig */
-  const double diagDef = this->m_DiagonalWeight * largestEig - diagTemp;
-  for( unsigned int r = 0; r < spaceDimension; ++r )
+  double maxDiag = 0;
+  size_t nnz = values.size();
+  for( size_t r = 0; r < spaceDimension; ++r )
   {
-    PreconditionValueType & prr = precondition( r, r );
-    prr += diagDef;
-    nnz += precondition.get_row(r).size();
+    const CInt rowBegin = rowPointers[ r ];
+    if( rowBegin < rowPointers[ r + 1 ]
+      && static_cast<size_t>( columnIndices[ rowBegin ] ) == r )
+    {
+      maxDiag = vnl_math_max( maxDiag, values[ rowBegin ] );
+    }
+    else
+    {
+      ++nnz;
+    }
   }
 
   /** Store some information for the user: */
@@ -461,41 +444,101 @@ PreconditionedGradientDescentOptimizer
   /** size spaceDimension+1 */
   CInt * cCol = reinterpret_cast<CInt *>( cPrecondition->p );
 
-  /** Loop over rows of input matrix */
-  const CInt * cRowBegin = cRow;
-  for( unsigned int r = 0; r < spaceDimension; ++r )
+  /** Copy the rows of the input matrix. */
+  CInt pos = 0;
+  for( size_t r = 0; r < spaceDimension; ++r )
   {
-    RowType & rowVector = precondition.get_row( r );
-    (*cCol) = static_cast<int>( cRow - cRowBegin );
-    ++cCol;
-
-    /** Iterate over each row */
-    for( RowIteratorType rowIt = rowVector.begin(); rowIt != rowVector.end(); ++rowIt )
+    cCol[ r ] = pos;
+    CInt rowBegin = rowPointers[ r ];
+    const CInt rowEnd = rowPointers[ r + 1 ];
+    if( rowBegin == rowEnd || static_cast<size_t>( columnIndices[ rowBegin ] ) != r )
+    {
+      cRow[ pos ] = static_cast<CInt>( r );
+      cVal[ pos ] = 0.0;
+      ++pos;
+    }
+    for( ; rowBegin < rowEnd; ++rowBegin, ++pos )
     {
-      (*cRow) = rowIt->first;
-      (*cVal) = rowIt->second;
-      ++cRow;
-      ++cVal;
+      cRow[ pos ] = columnIndices[ rowBegin ];
+      cVal[ pos ] = values[ rowBegin ];
     }
   }
-  (*cCol) = static_cast<int>(cRow - cRowBegin);
+  cCol[ spaceDimension ] = pos;
 
-  /** Sanity check */
-  if( static_cast<size_t>(*cCol) != nnz )
+  /** Destroy precondition input, to save memory */
+  IndexContainerType().swap( rowPointers );
+  IndexContainerType().swap( columnIndices );
+  ValueContainerType().swap( values );
+
+  /** Estimate largest eigenvalue to 1 decimal digit precision, with
+   * power iterations. If this fails, use the maxDiag value.
+   */
+  double & largestEig = this->m_LargestEigenValue;
+  largestEig = 0.0;
+  cholmod_dense * x = cholmod_ones( spaceDimension, 1, CHOLMOD_REAL, this->m_CholmodCommon );
+  cholmod_dense * y = cholmod_zeros( spaceDimension, 1, CHOLMOD_REAL, this->m_CholmodCommon );
+  double * xVal = reinterpret_cast<double *>( x->x );
+  double * yVal = reinterpret_cast<double *>( y->x );
+  double alpha[2] = { 1.0, 0.0 };
+  double beta[2] = { 0.0, 0.0 };
+  const double xScale = 1.0 / std::sqrt( static_cast<double>( spaceDimension ) );
+  for( size_t i = 0; i < spaceDimension; ++i )
+  {
+    xVal[ i ] = xScale;
+  }
+  for( unsigned int iteration = 0; iteration < 100; ++iteration )
+  {
+    /** y = P x, and the Rayleigh quotient x' P x, since |x| = 1. */
+    cholmod_sdmult( cPrecondition, 0, alpha, beta, x, y, this->m_CholmodCommon );
+    double xy = 0.0;
+    double yy = 0.0;
+    for( size_t i = 0; i < spaceDimension; ++i )
+    {
+      xy += xVal[ i ] * yVal[ i ];
+      yy += yVal[ i ] * yVal[ i ];
+    }
+    const double previousEig = largestEig;
+    largestEig = xy;
+    if( !( yy > 0.0 ) )
+    {
+      break;
+    }
+    const double yScale = 1.0 / std::sqrt( yy );
+    for( size_t i = 0; i < spaceDimension; ++i )
+    {
+      xVal[ i ] = yVal[ i ] * yScale;
+    }
+    if( iteration > 0 && std::abs( largestEig - previousEig ) < 1e-2 * std::abs( largestEig ) )
+    {
+      break;
+    }
+  }
+  cholmod_free_dense( &x, this->m_CholmodCommon );
+  cholmod_free_dense( &y, this->m_CholmodCommon );
+  if( !( largestEig > 0.0 ) || !std::isfinite( largestEig ) )
   {
-    /** Release memory */
-    cholmod_free_sparse( &cPrecondition, this->m_CholmodCommon );
-    itkExceptionMacro( "ERROR: unexpected error during conversion to cholmod format");
+    largestEig = maxDiag;
   }
 
-  /** Destroy precondition input, to save memory */
-  precondition.set_size( 0, 0 );
+  /** Add diagWeight * largestEig to the diagonal, which is the first
+   * element of every column.
+   */
+  const double diagDef = this->m_DiagonalWeight * largestEig;
+  cCol = reinterpret_cast<CInt *>( cPrecondition->p );
+  cVal = reinterpret_cast<double *>( cPrecondition->x );
+  for( size_t r = 0; r < spaceDimension; ++r )
+  {
+    cVal[ cCol[ r ] ] += diagDef;
+  }
 
   /** Prepare for factorization */
+  if( this->m_CholmodFactor )
+  {
+    cholmod_free_factor( &this->m_CholmodFactor, this->m_CholmodCommon );
+  }
   this->m_CholmodFactor = cholmod_analyze( cPrecondition, this->m_CholmodCommon );
 
   /** Factorize cPrediction + diagonalWeight * largestEig * Identity */
-  double beta[2];
   beta[0] = 0.0; // this->GetDiagonalWeight() * largestEig; but we already did that above
   beta[1] = 0.0; // this is for potential imaginary part of complex number.
   cholmod_factorize_p( cPrecondition, beta, NULL, 0,
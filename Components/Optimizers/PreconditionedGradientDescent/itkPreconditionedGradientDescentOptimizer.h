@@ -21,6 +21,7 @@
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
 #include "itkArray2D.h"
 #include "vnl/vnl_sparse_matrix.h"
+#include "itkCompressedRowSymmetricMatrix.h"
 #include "cholmod.h"
 
 namespace itk
@@ -83,6 +84,8 @@ public:
   //typedef vnl_symmetric_eigensystem<
   //  PreconditionValueType >                               EigenSystemType;
   typedef vnl_sparse_matrix< PreconditionValueType >      PreconditionType;
+  typedef CompressedRowSymmetricMatrix<
+    PreconditionValueType >                               CompressedPreconditionType;
 
   /** Codes of stopping conditions
    * The MinimumStepSize stopcondition never occurs, but may
@@ -139,13 +142,21 @@ public:
   itkGetConstReferenceMacro( SearchDirection, DerivativeType );
 
   /** Set the preconditioning matrix, whose inverse actually will be used to precondition.
-   * On setting the precondition matrix, an eigensystem is computed immediately, the
-   * eigenvalues/vectors are modified and only the modified eigenvectors/values are stored
-   * (in the EigenSystem).
+   * On setting the precondition matrix, the diagonal is increased by DiagonalWeight times
+   * the largest eigenvalue, and the Cholesky decomposition is computed immediately.
+   * The upper triangular part of the matrix is used, which is converted to compressed
+   * row format first.
    * NB: this function destroys the input matrix, to save memory.
    */
   virtual void SetPreconditionMatrix( PreconditionType & precondition );
 
+  /** Set the preconditioning matrix, given in compressed row format. The arrays
+   * are copied to cholmod without further conversion. The largest eigenvalue
+   * is estimated by power iterations.
+   * NB: this function destroys the input matrix, to save memory.
+   */
+  virtual void SetPreconditionMatrix( CompressedPreconditionType & precondition );
+
   /** Temporary functions, for debugging */
   const cholmod_common * GetCholmodCommon( void ) const
   {
@@ -84,6 +84,7 @@ public:
   /** Some typedefs for computing the SelfHessian */
   typedef Superclass::PreconditionValueType     PreconditionValueType;
   typedef Superclass::PreconditionType          PreconditionType;
+  typedef Superclass::CompressedPreconditionType CompressedPreconditionType;
   //typedef Superclass::EigenSystemType           EigenSystemType;
 
   /** Set/Get a. */
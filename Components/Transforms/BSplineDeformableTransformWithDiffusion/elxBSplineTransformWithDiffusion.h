@@ -100,6 +100,15 @@ namespace elastix
  *    the adaptive filtering is performed. \n
  *    example: <tt>(NumberOfDiffusionIterations 10)</tt>
  *    The default is 1.
+ * \parameter DiffusionUpdateThreshold: before each filtering step, only the B-spline
+ *    coefficients that are larger (in absolute value) than this threshold, in mm, are
+ *    added to the deformation field, and the field is only recomputed where they have
+ *    influence. The other coefficients are kept for the next filtering step, instead of
+ *    being reset to zero, so no part of the deformation is lost; it is only filtered
+ *    later. 0 filters all coefficients, like a full recomputation, but then hardly any
+ *    voxels are skipped; a negative value always recomputes the whole field. \n
+ *    example: <tt>(DiffusionUpdateThreshold 0.001)</tt>
+ *    The default is 0.
  * \parameter Radius: defines the radius of the filter. \n
  *    example: <tt>(Radius 1)</tt>
  *    The default is 1.
@@ -336,6 +345,12 @@ public:
   /** Diffuse the deformation field. */
   void DiffuseDeformationField( void );
 
+  /** Compute the current deformation field in m_DeformationField. After
+   * a diffusion, only the voxels influenced by significant B-spline
+   * coefficients are recomputed.
+   */
+  void ComputeDeformationField( void );
+
   /** Method to transform a point.
    * This method just calls the implementation from the
    * GenericDeformationFieldRegulizer. This is necessary, since:
@@ -394,6 +409,9 @@ private:
   RegionType                  m_DeformationRegion;
   OriginType                  m_DeformationOrigin;
   SpacingType                 m_DeformationSpacing;
+  double                      m_DiffusionUpdateThreshold;
+  bool                        m_DiffusedFieldIsValid;
+  ParametersType              m_RemainingParameters;
 
   /** Member variables for writing diffusion files. */
   bool               m_WriteDiffusionFiles;
@@ -21,8 +21,8 @@
 
 #include "elxBSplineTransformWithDiffusion.h"
 
-#include "itkBSplineResampleImageFunction.h"
-#include "itkBSplineDecompositionImageFilter.h"
+#include "itkUpsampleBSplineParametersFilter.h"
+#include "itkBSplineDisplacementFieldUpdater.h"
 
 #include <cmath>
 
@@ -65,6 +65,8 @@ BSplineTransformWithDiffusion< TElastix >
   this->m_ThresholdHU                = static_cast< GrayValuePixelType >( 150 );
   this->m_UseMovingSegmentation      = false;
   this->m_UseFixedSegmentation       = false;
+  this->m_DiffusionUpdateThreshold   = 0.0;
+  this->m_DiffusedFieldIsValid       = false;
 
   /** Make sure that the TransformBase::WriteToFile() does
    * not write the transformParameters in the file.
@@ -225,6 +227,13 @@ BSplineTransformWithDiffusion< TElastix >
   this->m_DeformationRegion.SetSize( this->m_Elastix->GetElxResamplerBase()
     ->GetAsITKBaseType()->GetSize() );
 
+  /** Get diffusion information: the threshold on the B-spline coefficients
+   * for recomputing the deformation field.
+   */
+  this->m_DiffusionUpdateThreshold = 0.0;
+  this->m_Configuration->ReadParameter( this->m_DiffusionUpdateThreshold,
+    "DiffusionUpdateThreshold", 0, false );
+
   /** Set it in the DeformationFieldRegulizer class. */
   this->SetDeformationFieldRegion( this->m_DeformationRegion );
   this->SetDeformationFieldOrigin( this->m_DeformationOrigin );
@@ -248,6 +257,7 @@ BSplineTransformWithDiffusion< TElastix >
   this->m_DiffusedField->SetOrigin( this->m_DeformationOrigin );
   this->m_DiffusedField->SetSpacing( this->m_DeformationSpacing );
   this->m_DiffusedField->Allocate();
+  this->m_DiffusedFieldIsValid = false;
 
   /** Create the GrayValueImages and allocate memory. */
   if( this->m_UseMovingSegmentation && !this->m_ThresholdBool )
@@ -586,6 +596,7 @@ BSplineTransformWithDiffusion< TElastix >
    */
   this->m_DeformationField = 0;
   this->m_DiffusedField    = 0;
+  this->m_DiffusedFieldIsValid = false;
 
 } // end AfterRegistration()
 
@@ -695,16 +706,8 @@ BSplineTransformWithDiffusion< TElastix >
 ::IncreaseScale( void )
 {
   /** Typedefs. */
-  typedef itk::ResampleImageFilter< ImageType, ImageType >
-    UpsampleFilterType;
-  typedef itk::IdentityTransform< CoordRepType, SpaceDimension >
-    IdentityTransformType;
-  typedef itk::BSplineResampleImageFunction< ImageType, CoordRepType >
-    CoefficientUpsampleFunctionType;
-  typedef itk::BSplineDecompositionImageFilter< ImageType, ImageType >
-    DecompositionFilterType;
-  typedef itk::ImageRegionConstIterator< ImageType >
-    IteratorType;
+  typedef itk::UpsampleBSplineParametersFilter<
+    ParametersType, ImageType >                   GridUpsamplerType;
 
   /** The current region/spacing settings of the grid. */
   RegionType gridregionLow = this->m_BSplineTransform->GetGridRegion();
@@ -745,106 +748,35 @@ BSplineTransformWithDiffusion< TElastix >
   ParametersType latestParameters
     = this->m_Registration->GetAsITKBaseType()->GetLastTransformParameters();
 
-  /** Get the pointer to the data in latestParameters. */
-  PixelType * dataPointer = static_cast< PixelType * >( latestParameters.data_block() );
-  /** Get the number of pixels that should go into one coefficient image. */
-  unsigned int numberOfPixels
-    = ( this->m_BSplineTransform->GetGridRegion() ).GetNumberOfPixels();
-
-  /** Set the correct region/size info of the coefficient image
-   * that will be filled with the current parameters.
-   */
-  ImagePointer coeffs1 = ImageType::New();
-  coeffs1->SetRegions( this->m_BSplineTransform->GetGridRegion() );
-  coeffs1->SetOrigin( ( this->m_BSplineTransform->GetGridOrigin() ).GetDataPointer() );
-  coeffs1->SetSpacing( ( this->m_BSplineTransform->GetGridSpacing() ).GetDataPointer() );
-  //coeffs1->Allocate() not needed because the data is set by directly pointing
-  // to an existing piece of memory.
-
-  /**
-   * Create the new vector of parameters, with the
-   * correct size (which is now approx 2^dim as big as the
-   * size in the previous resolution!).
+  /** Compute the parameters on the denser grid. The grid spacing is
+   * halved, so this is typically done exactly by the two-scale relation.
    */
-  ParametersType parameters_out(
-  gridregionHigh.GetNumberOfPixels() * SpaceDimension );
-
-  /** Initialize iterator in the parameters_out. */
-  unsigned int i = 0;
-
-  /** Loop over dimension. */
-  for( unsigned int j = 0; j < SpaceDimension; j++ )
+  typename GridUpsamplerType::Pointer upsampler = GridUpsamplerType::New();
+  upsampler->SetBSplineOrder( SplineOrder );
+  upsampler->SetCurrentGridOrigin( this->m_BSplineTransform->GetGridOrigin() );
+  upsampler->SetCurrentGridSpacing( this->m_BSplineTransform->GetGridSpacing() );
+  upsampler->SetCurrentGridDirection( this->m_BSplineTransform->GetGridDirection() );
+  upsampler->SetCurrentGridRegion( this->m_BSplineTransform->GetGridRegion() );
+  upsampler->SetRequiredGridOrigin( gridoriginHigh );
+  upsampler->SetRequiredGridSpacing( gridspacingHigh );
+  upsampler->SetRequiredGridDirection( this->m_BSplineTransform->GetGridDirection() );
+  upsampler->SetRequiredGridRegion( gridregionHigh );
+
+  ParametersType parameters_out;
+  try
   {
-    /** Fill the coefficient image with parameter data (displacements
-     * of the control points in the direction of dimension j).
-     */
-    coeffs1->GetPixelContainer()->
-    SetImportPointer( dataPointer, numberOfPixels );
-    dataPointer += numberOfPixels;
-
-    /*
-     * Set this image as the input of the upsampler filter. The
-     * upsampler samples the deformation field at the locations
-     * of the new control points (note: it does not just interpolate
-     * the coefficient image, which would be wrong). The B-spline
-     * coefficients that describe the resulting image are computed
-     * by the decomposition filter.
-     *
-     * This code is copied from the itk-example
-     * DeformableRegistration6.cxx .
-     */
-
-    typename UpsampleFilterType::Pointer upsampler
-      = UpsampleFilterType::New();
-    typename IdentityTransformType::Pointer identity
-      = IdentityTransformType::New();
-    typename CoefficientUpsampleFunctionType::Pointer coeffUpsampleFunction
-      = CoefficientUpsampleFunctionType::New();
-    typename DecompositionFilterType::Pointer decompositionFilter
-      = DecompositionFilterType::New();
-
-    upsampler->SetInterpolator( coeffUpsampleFunction );
-    upsampler->SetTransform( identity );
-    upsampler->SetSize( gridsizeHigh );
-    upsampler->SetOutputStartIndex( gridindexHigh );
-    upsampler->SetOutputSpacing( gridspacingHigh );
-    upsampler->SetOutputOrigin( gridoriginHigh );
-    upsampler->SetInput( coeffs1 );
-
-    decompositionFilter->SetSplineOrder( SplineOrder );
-    decompositionFilter->SetInput( upsampler->GetOutput() );
-
-    /** Do the upsampling. */
-    try
-    {
-      decompositionFilter->UpdateLargestPossibleRegion();
-    }
-    catch( itk::ExceptionObject & excp )
-    {
-      /** Add information to the exception. */
-      excp.SetLocation( "BSplineTransform - IncreaseScale()" );
-      std::string err_str = excp.GetDescription();
-      err_str += "\nError occurred while using decompositionFilter.\n";
-      excp.SetDescription( err_str );
-      /** Pass the exception to an higher level. */
-      throw excp;
-    }
-
-    /** Create an upsampled image. */
-    ImagePointer coeffs2 = decompositionFilter->GetOutput();
-
-    /** Create an iterator on the new coefficient image. */
-    IteratorType iterator( coeffs2, gridregionHigh );
-    iterator.GoToBegin();
-    while( !iterator.IsAtEnd() )
-    {
-      /** Copy the contents of coeffs2 in a ParametersType array. */
-      parameters_out[ i ] = iterator.Get();
-      ++iterator;
-      ++i;
-    } // end while coeff2 iterator loop
-
-  } // end for dimension loop
+    upsampler->UpsampleParameters( latestParameters, parameters_out );
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    /** Add information to the exception. */
+    excp.SetLocation( "BSplineTransform - IncreaseScale()" );
+    std::string err_str = excp.GetDescription();
+    err_str += "\nError occurred while upsampling the B-spline parameters.\n";
+    excp.SetDescription( err_str );
+    /** Pass the exception to an higher level. */
+    throw excp;
+  }
 
   /** Set the initial parameters for the next resolution level. */
   this->m_BSplineTransform->SetGridRegion( gridregionHigh );
@@ -1138,43 +1070,7 @@ BSplineTransformWithDiffusion< TElastix >
 
   /** ------------- 1: Create deformationField. ------------- */
 
-  /** First, create a dummyImage with the right region info, so
-   * that the TransformIndexToPhysicalPoint-functions will be right.
-   */
-  typename DummyImageType::Pointer dummyImage = DummyImageType::New();
-  dummyImage->SetRegions( this->m_DeformationRegion );
-  dummyImage->SetOrigin( this->m_DeformationOrigin );
-  dummyImage->SetSpacing( this->m_DeformationSpacing );
-
-  /** Setup an iterator over dummyImage and outputImage. */
-  DummyIteratorType       iter( dummyImage, this->m_DeformationRegion );
-  VectorImageIteratorType iterout( this->m_DeformationField, this->m_DeformationRegion );
-
-  /** Declare stuff. */
-  InputPointType  inputPoint;
-  OutputPointType outputPoint;
-  VectorType      diff_point;
-  IndexType       inputIndex;
-
-  /** Calculate the TransformPoint of all voxels of the image. */
-  iter.GoToBegin();
-  iterout.GoToBegin();
-  while( !iter.IsAtEnd() )
-  {
-    inputIndex = iter.GetIndex();
-    /** Transform the points to physical space. */
-    dummyImage->TransformIndexToPhysicalPoint( inputIndex, inputPoint );
-    /** Call TransformPoint. */
-    outputPoint = this->TransformPoint( inputPoint );
-    /** Calculate the difference. */
-    for( unsigned int i = 0; i < this->FixedImageDimension; i++ )
-    {
-      diff_point[ i ] = outputPoint[ i ] - inputPoint[ i ];
-    }
-    iterout.Set( diff_point );
-    ++iter;
-    ++iterout;
-  }
+  this->ComputeDeformationField();
 
   /** ------------- 2: Update the intermediary deformationFieldTransform. ------------- */
 
@@ -1328,19 +1224,22 @@ BSplineTransformWithDiffusion< TElastix >
   /** ------------- 5: Update the intermediary transform. ------------- */
 
   this->UpdateIntermediaryDeformationFieldTransform( this->m_DiffusedField );
+  this->m_DiffusedFieldIsValid = true;
 
   /** ------------- 6: Reset the current transform parameters of the optimizer. ------------- */
 
-  /** Create a vector of zeros in order to reset the B-spline transform. */
-  ParametersType dummyParameters( this->GetNumberOfParameters() );
-  dummyParameters.Fill( 0.0 );
-  this->SetParameters( dummyParameters );
+  /** Reset the B-spline transform to the coefficients that were not added
+   * to the deformation field, which are zero unless a DiffusionUpdateThreshold
+   * larger than zero is used.
+   */
+  const ParametersType remainingParameters = this->m_RemainingParameters;
+  this->SetParameters( remainingParameters );
 
   /** Reset the optimizer.
    * We had to create the SetCurrentPositionPublic-function, because
    * SetCurrentPosition() is protected.
    */
-  this->m_Elastix->GetElxOptimizerBase()->SetCurrentPositionPublic( dummyParameters );
+  this->m_Elastix->GetElxOptimizerBase()->SetCurrentPositionPublic( remainingParameters );
 
   /** Get rid of the initial transform, because this is now captured
    * within the DeformationFieldTransform.
@@ -1444,6 +1343,87 @@ BSplineTransformWithDiffusion< TElastix >
 } // end DiffuseDeformationField()
 
 
+/**
+ * ******************* ComputeDeformationField ******************
+ */
+
+template< class TElastix >
+void
+BSplineTransformWithDiffusion< TElastix >
+::ComputeDeformationField( void )
+{
+  /** After a diffusion, the intermediary deformation field transform holds
+   * the diffused field, sampled on the voxels of the deformation field, and
+   * the initial transform is removed. The deformation field is then the
+   * diffused field plus the displacement of the B-spline transform, which
+   * is small where all B-spline coefficients of the support are small.
+   */
+  const bool incremental = this->m_DiffusionUpdateThreshold >= 0.0
+    && this->m_DiffusedFieldIsValid
+    && this->m_DiffusedField->GetBufferedRegion() == this->m_DeformationRegion
+    && this->Superclass2::GetInitialTransform() == 0;
+
+  if( !incremental )
+  {
+    /** All coefficients are added to the deformation field. */
+    this->m_RemainingParameters.SetSize( this->GetNumberOfParameters() );
+    this->m_RemainingParameters.Fill( 0.0 );
+
+    /** First, create a dummyImage with the right region info, so
+     * that the TransformIndexToPhysicalPoint-functions will be right.
+     */
+    typename DummyImageType::Pointer dummyImage = DummyImageType::New();
+    dummyImage->SetRegions( this->m_DeformationRegion );
+    dummyImage->SetOrigin( this->m_DeformationOrigin );
+    dummyImage->SetSpacing( this->m_DeformationSpacing );
+
+    /** Setup an iterator over dummyImage and outputImage. */
+    DummyIteratorType       iter( dummyImage, this->m_DeformationRegion );
+    VectorImageIteratorType iterout( this->m_DeformationField, this->m_DeformationRegion );
+
+    /** Declare stuff. */
+    InputPointType  inputPoint;
+    OutputPointType outputPoint;
+    VectorType      diff_point;
+    IndexType       inputIndex;
+
+    /** Calculate the TransformPoint of all voxels of the image. */
+    for( iter.GoToBegin(), iterout.GoToBegin(); !iter.IsAtEnd(); ++iter, ++iterout )
+    {
+      inputIndex = iter.GetIndex();
+      /** Transform the points to physical space. */
+      dummyImage->TransformIndexToPhysicalPoint( inputIndex, inputPoint );
+      /** Call TransformPoint. */
+      outputPoint = this->TransformPoint( inputPoint );
+      /** Calculate the difference. */
+      for( unsigned int i = 0; i < this->FixedImageDimension; i++ )
+      {
+        diff_point[ i ] = outputPoint[ i ] - inputPoint[ i ];
+      }
+      iterout.Set( diff_point );
+    }
+    return;
+  }
+
+  /** Add the displacement of the significant B-spline coefficients, and keep
+   * the other coefficients for the next diffusion.
+   */
+  typedef itk::BSplineDisplacementFieldUpdater<
+    BSplineTransformType, VectorImageType >         UpdaterType;
+  typename UpdaterType::Pointer updater = UpdaterType::New();
+  updater->SetTransform( this->m_BSplineTransform );
+  updater->SetThreshold( this->m_DiffusionUpdateThreshold );
+  const itk::SizeValueType numberOfRecomputedVoxels
+    = updater->ComputeUpdatedField( this->m_DiffusedField, this->m_DeformationField );
+  this->m_RemainingParameters = updater->GetRemainingParameters();
+
+  elxout << "  Recomputed the deformation field in "
+         << numberOfRecomputedVoxels << " of "
+         << this->m_DeformationRegion.GetNumberOfPixels() << " voxels." << std::endl;
+
+} // end ComputeDeformationField()
+
+
 /**
  * ******************* TransformPoint ******************
  */
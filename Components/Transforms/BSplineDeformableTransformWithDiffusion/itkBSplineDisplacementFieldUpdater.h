@@ -0,0 +1,123 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBSplineDisplacementFieldUpdater_h
+#define __itkBSplineDisplacementFieldUpdater_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+
+namespace itk
+{
+
+/**
+ * \class BSplineDisplacementFieldUpdater
+ * \brief Adds the displacements of the significant coefficients of a B-spline
+ * transform to a displacement field, and returns the other coefficients.
+ *
+ * The coefficients of a grid node are significant if one of them is larger
+ * (in absolute value) than the Threshold. The output field is the previous
+ * field plus the displacement of the B-spline transform with only the
+ * significant coefficients, on the voxels of the output. This displacement
+ * is only evaluated at voxels whose B-spline support contains a significant
+ * coefficient; elsewhere it is zero, so the previous field is copied. The
+ * coefficients that are not significant are returned by
+ * GetRemainingParameters(), so that they can be carried over to a next
+ * update: the output field plus the displacement of the remaining
+ * coefficients equals the previous field plus the displacement of the full
+ * transform. A Threshold of 0 leaves no remaining coefficients; a negative
+ * Threshold evaluates the displacement everywhere.
+ *
+ * The grid direction of the B-spline transform should be orthonormal.
+ *
+ * \ingroup Transforms
+ */
+
+template< class TBSplineTransform, class TVectorImage >
+class BSplineDisplacementFieldUpdater :
+  public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef BSplineDisplacementFieldUpdater Self;
+  typedef Object                          Superclass;
+  typedef SmartPointer< Self >            Pointer;
+  typedef SmartPointer< const Self >      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( BSplineDisplacementFieldUpdater, Object );
+
+  /** Typedefs. */
+  typedef TBSplineTransform                             BSplineTransformType;
+  typedef typename BSplineTransformType::Pointer        BSplineTransformPointer;
+  typedef typename BSplineTransformType::ConstPointer   BSplineTransformConstPointer;
+  typedef typename BSplineTransformType::ParametersType ParametersType;
+  typedef TVectorImage                                  VectorImageType;
+  typedef typename VectorImageType::PixelType           VectorType;
+
+  itkStaticConstMacro( SpaceDimension, unsigned int, BSplineTransformType::SpaceDimension );
+  itkStaticConstMacro( SplineOrder, unsigned int, BSplineTransformType::SplineOrder );
+
+  /** Set/Get the B-spline transform. */
+  itkSetConstObjectMacro( Transform, BSplineTransformType );
+  itkGetConstObjectMacro( Transform, BSplineTransformType );
+
+  /** Set/Get the threshold on the B-spline coefficients. Default: 0. */
+  itkSetMacro( Threshold, double );
+  itkGetConstMacro( Threshold, double );
+
+  /** Compute the output field from the previous field, which should have the
+   * same buffered region. Returns the number of voxels at which the
+   * displacement of the B-spline transform was evaluated.
+   */
+  SizeValueType ComputeUpdatedField( const VectorImageType * previous,
+    VectorImageType * output );
+
+  /** Get the coefficients that were not added by ComputeUpdatedField(),
+   * with zeros at the significant coefficients.
+   */
+  itkGetConstReferenceMacro( RemainingParameters, ParametersType );
+
+protected:
+
+  BSplineDisplacementFieldUpdater();
+  ~BSplineDisplacementFieldUpdater() override {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+
+  BSplineDisplacementFieldUpdater( const Self & ); // purposely not implemented
+  void operator=( const Self & );                  // purposely not implemented
+
+  BSplineTransformConstPointer m_Transform;
+  double                       m_Threshold;
+  ParametersType               m_RemainingParameters;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBSplineDisplacementFieldUpdater.hxx"
+#endif
+
+#endif // end #ifndef __itkBSplineDisplacementFieldUpdater_h
@@ -0,0 +1,206 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBSplineDisplacementFieldUpdater_hxx
+#define __itkBSplineDisplacementFieldUpdater_hxx
+
+#include "itkBSplineDisplacementFieldUpdater.h"
+
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+
+#include <cmath>
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template< class TBSplineTransform, class TVectorImage >
+BSplineDisplacementFieldUpdater< TBSplineTransform, TVectorImage >
+::BSplineDisplacementFieldUpdater()
+{
+  this->m_Threshold = 0.0;
+
+} // end Constructor
+
+
+/**
+ * ********************* ComputeUpdatedField ****************************
+ */
+
+template< class TBSplineTransform, class TVectorImage >
+SizeValueType
+BSplineDisplacementFieldUpdater< TBSplineTransform, TVectorImage >
+::ComputeUpdatedField( const VectorImageType * previous, VectorImageType * output )
+{
+  if( this->m_Transform.IsNull() )
+  {
+    itkExceptionMacro( << "Transform not set" );
+  }
+  const typename VectorImageType::RegionType & region = output->GetBufferedRegion();
+  if( previous->GetBufferedRegion() != region )
+  {
+    itkExceptionMacro( << "The previous and the output field should have the same buffered region" );
+  }
+
+  /** Mark the B-spline grid nodes with a significant coefficient. */
+  typedef typename BSplineTransformType::RegionType RegionType;
+  const RegionType    gridRegion    = this->m_Transform->GetGridRegion();
+  const unsigned long numberOfNodes = gridRegion.GetNumberOfPixels();
+  const ParametersType & parameters = this->m_Transform->GetParameters();
+  std::vector< bool > significant( numberOfNodes, this->m_Threshold < 0.0 );
+  for( unsigned long n = 0; n < numberOfNodes; ++n )
+  {
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      significant[ n ] = significant[ n ]
+        || std::abs( parameters[ i * numberOfNodes + n ] ) > this->m_Threshold;
+    }
+  }
+
+  /** Split the coefficients into the significant ones, which are added
+   * to the field now, and the remaining ones.
+   */
+  ParametersType significantParameters( parameters.GetSize() );
+  this->m_RemainingParameters.SetSize( parameters.GetSize() );
+  for( unsigned long n = 0; n < numberOfNodes; ++n )
+  {
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      const unsigned long j = i * numberOfNodes + n;
+      significantParameters[ j ]       = significant[ n ] ? parameters[ j ] : 0.0;
+      this->m_RemainingParameters[ j ] = significant[ n ] ? 0.0 : parameters[ j ];
+    }
+  }
+
+  /** The grid direction is orthonormal, so its transpose is its inverse. */
+  const typename BSplineTransformType::OriginType    gridOrigin    = this->m_Transform->GetGridOrigin();
+  const typename BSplineTransformType::SpacingType   gridSpacing   = this->m_Transform->GetGridSpacing();
+  const typename BSplineTransformType::DirectionType gridDirection = this->m_Transform->GetGridDirection();
+
+  BSplineTransformPointer significantTransform = BSplineTransformType::New();
+  significantTransform->SetGridRegion( gridRegion );
+  significantTransform->SetGridSpacing( gridSpacing );
+  significantTransform->SetGridOrigin( gridOrigin );
+  significantTransform->SetGridDirection( gridDirection );
+  significantTransform->SetParameters( significantParameters );
+
+  /** Mark the grid nodes that are the first node of a support region
+   * containing a significant coefficient.
+   */
+
+  /** Dilate along each dimension: a support region starting at node s
+   * covers the nodes s, ..., s + SplineOrder.
+   */
+  unsigned long stride = 1;
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    const unsigned long gridSize = gridRegion.GetSize()[ i ];
+    std::vector< bool > dilated( numberOfNodes, false );
+    for( unsigned long n = 0; n < numberOfNodes; ++n )
+    {
+      const unsigned long position = ( n / stride ) % gridSize;
+      for( unsigned long k = 0; k <= SplineOrder && position + k < gridSize; ++k )
+      {
+        if( significant[ n + k * stride ] )
+        {
+          dilated[ n ] = true;
+          break;
+        }
+      }
+    }
+    significant.swap( dilated );
+    stride *= gridSize;
+  }
+
+  ImageRegionConstIteratorWithIndex< VectorImageType > previousIt( previous, region );
+  ImageRegionIterator< VectorImageType >               outputIt( output, region );
+  typename BSplineTransformType::InputPointType        inputPoint;
+  SizeValueType                                        numberOfRecomputedVoxels = 0;
+  for( ; !previousIt.IsAtEnd(); ++previousIt, ++outputIt )
+  {
+    output->TransformIndexToPhysicalPoint( previousIt.GetIndex(), inputPoint );
+
+    /** Find the first node of the support region of this voxel. Voxels
+     * outside the grid are recomputed, to be safe.
+     */
+    bool          recompute = false;
+    unsigned long node      = 0;
+    stride = 1;
+    for( unsigned int i = 0; i < SpaceDimension && !recompute; ++i )
+    {
+      double projection = 0.0;
+      for( unsigned int j = 0; j < SpaceDimension; ++j )
+      {
+        projection += gridDirection[ j ][ i ] * ( inputPoint[ j ] - gridOrigin[ j ] );
+      }
+      const double cindex = projection / gridSpacing[ i ] - gridRegion.GetIndex()[ i ];
+      const long   start  = static_cast< long >(
+        std::floor( cindex - static_cast< double >( SplineOrder - 1 ) / 2.0 ) );
+      if( start < 0 || start >= static_cast< long >( gridRegion.GetSize()[ i ] ) )
+      {
+        recompute = true;
+      }
+      node   += static_cast< unsigned long >( start ) * stride;
+      stride *= gridRegion.GetSize()[ i ];
+    }
+    recompute = recompute || significant[ node ];
+
+    VectorType displacement = previousIt.Get();
+    if( recompute )
+    {
+      /** Add the displacement of the significant coefficients. */
+      const typename BSplineTransformType::OutputPointType outputPoint
+        = significantTransform->TransformPoint( inputPoint );
+      for( unsigned int i = 0; i < SpaceDimension; ++i )
+      {
+        displacement[ i ] += outputPoint[ i ] - inputPoint[ i ];
+      }
+      ++numberOfRecomputedVoxels;
+    }
+    outputIt.Set( displacement );
+  }
+
+  return numberOfRecomputedVoxels;
+
+} // end ComputeUpdatedField()
+
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+template< class TBSplineTransform, class TVectorImage >
+void
+BSplineDisplacementFieldUpdater< TBSplineTransform, TVectorImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << indent << "Threshold: " << this->m_Threshold << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBSplineDisplacementFieldUpdater_hxx
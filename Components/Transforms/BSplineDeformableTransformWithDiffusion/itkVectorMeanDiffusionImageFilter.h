@@ -25,6 +25,8 @@
 #include "itkNumericTraits.h"
 
 #include "itkRescaleIntensityImageFilter.h"
+#include "itkMultiThreader.h"
+#include <vector>
 
 namespace itk
 {
@@ -37,6 +39,9 @@ namespace itk
  *
  * A mean filter is one of the family of linear filters.
  *
+ * The iterations alternate between the output image and one temporary
+ * image, and each iteration is computed multi-threaded.
+ *
  * \sa Image
  * \sa Neighborhood
  * \sa NeighborhoodOperator
@@ -140,6 +145,26 @@ protected:
    */
   void GenerateData( void ) override;
 
+  /** Typedefs for multi-threading. */
+  typedef itk::MultiThreader             ThreaderType;
+  typedef ThreaderType::ThreadInfoStruct ThreadInfoType;
+
+  /** Struct to pass one diffusion iteration to the threads. */
+  struct DiffusionThreadStruct
+  {
+    const Self *                                st_Self;
+    const InputImageType *                      st_Input;
+    InputImageType *                            st_Output;
+    const std::vector< InputImageRegionType > * st_Regions;
+  };
+
+  /** Compute one diffusion iteration from input to output, on a region. */
+  void ThreadedDiffusion( const InputImageType * input, InputImageType * output,
+    const InputImageRegionType & region ) const;
+
+  /** Callback that calls ThreadedDiffusion() on the region of a thread. */
+  static ITK_THREAD_RETURN_TYPE DiffusionThreaderCallback( void * arg );
+
 private:
 
   VectorMeanDiffusionImageFilter( const Self & );  // purposely not implemented
@@ -21,11 +21,11 @@
 
 #include "itkVectorMeanDiffusionImageFilter.h"
 
-#include "itkNeighborhoodIterator.h"
+#include "itkConstNeighborhoodIterator.h"
 #include "itkImageRegionIterator.h"
 #include "itkImageRegionConstIterator.h"
 #include "itkZeroFluxNeumannBoundaryCondition.h"
-#include "itkProgressReporter.h"
+#include "itkImageRegionSplitterSlowDimension.h"
 
 namespace itk
 {
@@ -115,31 +115,14 @@ void
 VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
 ::GenerateData( void )
 {
-  // \todo to avoid all the copying we can create a vector of
-  // outputs of size this->GetNumberOfIterations(). The last
-  // output should point to this->GetOutput(). In order to avoid
-  // a big memory footprint, at some iteration k, memory of the
-  // former iteration should be released: output[ k - 1 ] = 0,
-  // and memory of the current iteration should only now be created:
-  // output[ k ] = InputImageType::New(); ...; output[ k ]->Allocate().
-  // Only for the last iteration: output[ k ]( this->GetOutput() ).
-
   /** Create feature image. */
   this->FilterGrayValueImage();
 
-  /** Declare things. */
-  unsigned int                                        i, j;
-  ZeroFluxNeumannBoundaryCondition< InputImageType >  nbc;
-  ZeroFluxNeumannBoundaryCondition< DoubleImageType > nbc2;
-  NeighborhoodIterator< InputImageType >              nit;
-  NeighborhoodIterator< DoubleImageType >             nit2;
-  VectorRealType                                      sum;
-
   /** Allocate output. */
   typename InputImageType::ConstPointer input( this->GetInput() );
   typename InputImageType::Pointer      output( this->GetOutput() );
-  typename InputImageType::Pointer outputtmp = InputImageType::New();
-  output->SetRegions( input->GetLargestPossibleRegion() );
+  const InputImageRegionType region = input->GetLargestPossibleRegion();
+  output->SetRegions( region );
 
   try
   {
@@ -155,151 +138,193 @@ VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
     throw excp;
   }
 
-  /** Allocate a temporary output image. */
-  outputtmp->SetSpacing( input->GetSpacing() );
-  outputtmp->SetOrigin( input->GetOrigin() );
-  outputtmp->SetRegions( input->GetLargestPossibleRegion() );
+  /** Without iterations, the output is a copy of the input. */
+  const unsigned int numberOfIterations = this->GetNumberOfIterations();
+  if( numberOfIterations == 0 )
+  {
+    ImageRegionConstIterator< InputImageType > in_it( input, region );
+    ImageRegionIterator< InputImageType >      out_it( output, region );
+    for( in_it.GoToBegin(), out_it.GoToBegin(); !in_it.IsAtEnd(); ++in_it, ++out_it )
+    {
+      out_it.Set( in_it.Get() );
+    }
+    return;
+  }
 
-  try
+  /** The iterations alternate between the output and a temporary image,
+   * which is only needed for more than one iteration. The first iteration
+   * reads the input, and the order is chosen such that the last iteration
+   * writes the output.
+   */
+  typename InputImageType::Pointer outputtmp = InputImageType::New();
+  if( numberOfIterations > 1 )
   {
-    outputtmp->Allocate();
+    outputtmp->CopyInformation( input );
+    outputtmp->SetRegions( region );
+
+    try
+    {
+      outputtmp->Allocate();
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      /** Add information to the exception and throw again. */
+      excp.SetLocation( "VectorMeanDiffusionImageFilter - GenerateData()" );
+      std::string err_str = excp.GetDescription();
+      err_str += "\nError occurred while allocating a temporary copy.\n";
+      excp.SetDescription( err_str );
+      throw excp;
+    }
   }
-  catch( itk::ExceptionObject & excp )
+  InputImageType * buffers[ 2 ] = { output.GetPointer(), outputtmp.GetPointer() };
+
+  /** Split the image in a region for each thread. */
+  ThreaderType::Pointer threader = ThreaderType::New();
+  ImageRegionSplitterSlowDimension::Pointer splitter
+    = ImageRegionSplitterSlowDimension::New();
+  const unsigned int numberOfPieces = splitter->GetNumberOfSplits(
+    region, threader->GetNumberOfThreads() );
+  std::vector< InputImageRegionType > regions( numberOfPieces, region );
+  for( unsigned int piece = 0; piece < numberOfPieces; ++piece )
   {
-    /** Add information to the exception and throw again. */
-    excp.SetLocation( "VectorMeanDiffusionImageFilter - GenerateData()" );
-    std::string err_str = excp.GetDescription();
-    err_str += "\nError occurred while allocating a temporary copy.\n";
-    excp.SetDescription( err_str );
-    throw excp;
+    splitter->GetSplit( piece, numberOfPieces, regions[ piece ] );
   }
+  threader->SetNumberOfThreads( numberOfPieces );
+
+  DiffusionThreadStruct diffusionStruct;
+  diffusionStruct.st_Self    = this;
+  diffusionStruct.st_Regions = &regions;
+
+  /** Loop over the number of iterations. */
+  for( unsigned int k = 0; k < numberOfIterations; ++k )
+  {
+    diffusionStruct.st_Input
+      = ( k == 0 ) ? input.GetPointer() : buffers[ ( numberOfIterations - k ) % 2 ];
+    diffusionStruct.st_Output = buffers[ ( numberOfIterations - 1 - k ) % 2 ];
+
+    threader->SetSingleMethod( Self::DiffusionThreaderCallback, &diffusionStruct );
+    threader->SingleMethodExecute();
+  }
+
+} // end GenerateData()
+
+
+/**
+ * ******************* DiffusionThreaderCallback *******************
+ */
+
+template< class TInputImage, class TGrayValueImage >
+ITK_THREAD_RETURN_TYPE
+VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
+::DiffusionThreaderCallback( void * arg )
+{
+  ThreadInfoType *              infoStruct      = static_cast< ThreadInfoType * >( arg );
+  const ThreadIdType            threadId        = infoStruct->ThreadID;
+  const DiffusionThreadStruct * diffusionStruct = static_cast< DiffusionThreadStruct * >( infoStruct->UserData );
 
-  // support progress methods/callbacks
-  //ProgressReporter progress( this, threadId, outputRegionForThread.GetNumberOfPixels() );
-
-  /** Copy input to output. */
-  ImageRegionConstIterator< InputImageType > in_it(
-  input, input->GetLargestPossibleRegion() );
-  ImageRegionIterator< InputImageType > out_it(
-  output, input->GetLargestPossibleRegion() );
-  in_it.GoToBegin();
-  out_it.GoToBegin();
-  while( !in_it.IsAtEnd() )
+  if( threadId < diffusionStruct->st_Regions->size() )
   {
-    out_it.Set( in_it.Get() );
-    ++in_it;
-    ++out_it;
+    diffusionStruct->st_Self->ThreadedDiffusion( diffusionStruct->st_Input,
+      diffusionStruct->st_Output, ( *diffusionStruct->st_Regions )[ threadId ] );
   }
 
-  /** Setup neighborhood iterator for the output deformation image. */
-  nit = NeighborhoodIterator< InputImageType >(
-    this->m_Radius, output, output->GetLargestPossibleRegion() );
-  unsigned int neighborhoodSize = nit.Size();
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end DiffusionThreaderCallback()
+
+
+/**
+ * ********************** ThreadedDiffusion **************************
+ */
+
+template< class TInputImage, class TGrayValueImage >
+void
+VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
+::ThreadedDiffusion( const InputImageType * input, InputImageType * output,
+  const InputImageRegionType & region ) const
+{
+  /** Declare things. */
+  unsigned int                                        i, j;
+  ZeroFluxNeumannBoundaryCondition< InputImageType >  nbc;
+  ZeroFluxNeumannBoundaryCondition< DoubleImageType > nbc2;
+  VectorRealType                                      sum;
+
+  /** Setup neighborhood iterator for the input deformation image. */
+  ConstNeighborhoodIterator< InputImageType > nit( this->m_Radius, input, region );
+  const unsigned int                          neighborhoodSize = nit.Size();
   nit.OverrideBoundaryCondition( &nbc );
 
   /** Setup neighborhood iterator for the "stiffness coefficient" image. */
-  nit2 = NeighborhoodIterator< DoubleImageType >(
-    this->m_Radius, this->m_Cx, this->m_Cx->GetLargestPossibleRegion() );
+  ConstNeighborhoodIterator< DoubleImageType > nit2( this->m_Radius, this->m_Cx, region );
   nit2.OverrideBoundaryCondition( &nbc2 );
 
-  /** Setup iterator over outputtmp. */
-  ImageRegionIterator< InputImageType > oit(
-  outputtmp, input->GetLargestPossibleRegion() );
+  /** Setup iterator over the output. */
+  ImageRegionIterator< InputImageType > oit( output, region );
 
   /** Initialize c and ci. */
   double c  = 0.0;
   double ci = 0.0;
 
-  /** Loop over the number of iterations. */
-  for( unsigned int k = 0; k < this->GetNumberOfIterations(); k++ )
+  /** The actual work. */
+  for( nit.GoToBegin(), nit2.GoToBegin(), oit.GoToBegin(); !nit.IsAtEnd(); ++nit, ++nit2, ++oit )
   {
-    /** Reset the iterators. */
-    nit.GoToBegin();
-    nit2.GoToBegin();
-    oit.GoToBegin();
+    /** Speed up: do not filter locations where c(x) = 0. */
+    if( nit2.GetCenterPixel() < 0.000001 )
+    {
+      /** Just copy input to output. */
+      oit.Set( nit.GetCenterPixel() );
+      continue;
+    }
 
-    /** The actual work. */
-    while( !nit.IsAtEnd() )
+    /** Initialize the sum to 0. */
+    for( j = 0; j < InputImageDimension; j++ )
     {
-      /** Speed up: do not filter locations where c(x) = 0. */
-      if( nit2.GetCenterPixel() < 0.000001 )
-      {
-        /** Just copy input to output. */
-        oit.Set( nit.GetCenterPixel() );
-      }
-      else
-      {
-        /** Initialize the sum to 0. */
-        for( j = 0; j < InputImageDimension; j++ )
-        {
-          sum[ j ] = NumericTraits< double >::Zero;
-        }
-
-        /** Initialize sumc. */
-        double sumc = 0.0;
-
-        /** Calculate the weighted mean over the neighborhood.
-         * mean = SUthis->m_i{ ci * x_i } / SUthis->m_i{ ci }
-         */
-        for( i = 0; i < neighborhoodSize; ++i )
-        {
-          /** Get current pixel in this neighborhood. */
-          InputPixelType pix = nit.GetPixel( i );
-
-          /** Get ci-value on current index. */
-          ci = nit2.GetPixel( i );
-
-          /** Calculate SUthis->m_i{ ci } and SUthis->m_i{ ci * x_i }. */
-          sumc += ci;
-          for( j = 0; j < InputImageDimension; j++ )
-          {
-            sum[ j ] += ci * static_cast< double >( pix[ j ] );
-          }
-        }
-
-        /** Get the mean value by dividing by sumc. */
-        InputPixelType mean;
-        for( j = 0; j < InputImageDimension; j++ )
-        {
-          if( sumc < 0.00001 ) { mean[ j ] = 0.0; }
-          else { mean[ j ] = static_cast< ValueType >( sum[ j ] / sumc ); }
-        }
-
-        /** Get c. */
-        c = nit2.GetCenterPixel();
-
-        /** Set 'y = (1 - c) * x + c * mean' to the temporary output. */
-        InputPixelType value = nit.GetCenterPixel() * ( 1.0 - c ) + mean * c;
-
-        /** Set it. */
-        oit.Set( value );
-
-      } // end if c < 0.000001
-
-      /** Increase all iterators. */
-      ++nit;
-      ++nit2;
-      ++oit;
-      //progress.CompletedPixel();
-
-    } // end while
-
-    /** Copy outputtmp to output. */
-    if( this->GetNumberOfIterations() > 0 )
+      sum[ j ] = NumericTraits< double >::Zero;
+    }
+
+    /** Initialize sumc. */
+    double sumc = 0.0;
+
+    /** Calculate the weighted mean over the neighborhood.
+     * mean = SUM_i{ ci * x_i } / SUM_i{ ci }
+     */
+    for( i = 0; i < neighborhoodSize; ++i )
     {
-      out_it.GoToBegin();
-      oit.GoToBegin();
-      while( !out_it.IsAtEnd() )
+      /** Get current pixel in this neighborhood. */
+      const InputPixelType pix = nit.GetPixel( i );
+
+      /** Get ci-value on current index. */
+      ci = nit2.GetPixel( i );
+
+      /** Calculate SUM_i{ ci } and SUM_i{ ci * x_i }. */
+      sumc += ci;
+      for( j = 0; j < InputImageDimension; j++ )
       {
-        out_it.Set( oit.Get() );
-        ++out_it;
-        ++oit;
+        sum[ j ] += ci * static_cast< double >( pix[ j ] );
       }
-    } // end if GetNumberOfIterations() > 0
+    }
+
+    /** Get the mean value by dividing by sumc. */
+    InputPixelType mean;
+    for( j = 0; j < InputImageDimension; j++ )
+    {
+      if( sumc < 0.00001 ) { mean[ j ] = 0.0; }
+      else { mean[ j ] = static_cast< ValueType >( sum[ j ] / sumc ); }
+    }
 
-  } // end for NumberOfIterations
+    /** Get c. */
+    c = nit2.GetCenterPixel();
 
-} // end GenerateData()
+    /** Set 'y = (1 - c) * x + c * mean' to the output. */
+    oit.Set( nit.GetCenterPixel() * ( 1.0 - c ) + mean * c );
+
+  } // end for
+
+} // end ThreadedDiffusion()
 
 
 /**
@@ -21,6 +21,7 @@
 #include "elxIncludes.h" // include first to avoid MSVS warning
 #include "itkDeformationFieldInterpolatingTransform.h"
 #include "itkAdvancedCombinationTransform.h"
+#include "itkMemoryMappedImageFileReader.h"
 
 namespace elastix
 {
@@ -43,6 +44,13 @@ namespace elastix
  * \transformparameter DeformationFieldInterpolationOrder: The interpolation order used for interpolating the deformation field:\n
  *    example: <tt>(DeformationFieldInterpolationOrder 0)</tt>\n
  *    The default value is 0. Choose from the allowed values 0 or 1.
+ *    With order 1 the transform uses a dedicated trilinear kernel on the raw buffer.
+ * \transformparameter UseMemoryMappedDeformationField: Whether to map the deformation field file into
+ *    memory, instead of reading it. The pages of the file are then loaded on demand, so very large
+ *    fields do not have to fit in RAM twice. Only uncompressed MetaImage files with float vectors in the
+ *    native byte order can be mapped; other files are read as usual.\n
+ *    example: <tt>(UseMemoryMappedDeformationField "false")</tt>\n
+ *    The default value is "true".
  *
  *
  * \sa DeformationFieldInterpolatingTransform
@@ -142,6 +150,12 @@ protected:
   /** The destructor. */
   ~DeformationFieldTransform() override {}
 
+  /** Map the deformation field file into memory, see MemoryMappedImageFileReader.
+   * Returns a null pointer if the file cannot be mapped.
+   */
+  typename DeformationFieldType::Pointer ReadMemoryMappedDeformationField(
+    const std::string & fileName );
+
 private:
 
   /** The private constructor. */
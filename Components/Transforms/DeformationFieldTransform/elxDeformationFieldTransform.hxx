@@ -71,11 +71,6 @@ DeformationFieldTransform< TElastix >::ReadFromFile( void )
   typedef itk::ChangeInformationImageFilter< DeformationFieldType > ChangeInfoFilterType;
   typedef typename ChangeInfoFilterType::Pointer                    ChangeInfoFilterPointer;
 
-  /** Setup VectorImageReader. */
-  typedef itk::ImageFileReader< DeformationFieldType > VectorReaderType;
-  typename VectorReaderType::Pointer vectorReader
-    = VectorReaderType::New();
-
   /** Read deformationFieldImage-name from parameter-file. */
   std::string fileName = "";
   this->m_Configuration->ReadParameter( fileName,
@@ -86,40 +81,60 @@ DeformationFieldTransform< TElastix >::ReadFromFile( void )
     itkExceptionMacro( << "Error while reading transform parameter file!" );
   }
 
-  /** Possibly overrule the direction cosines. */
-  ChangeInfoFilterPointer infoChanger = ChangeInfoFilterType::New();
-  DirectionType           direction;
-  direction.SetIdentity();
-  infoChanger->SetOutputDirection( direction );
-  infoChanger->SetChangeDirection( !this->GetElastix()->GetUseDirectionCosines() );
-  infoChanger->SetInput( vectorReader->GetOutput() );
-
-  /** Read deformationFieldImage from file. */
-  vectorReader->SetFileName( fileName.c_str() );
-  try
+  /** Map the deformationFieldImage into memory, if possible. */
+  bool useMemoryMapping = true;
+  this->m_Configuration->ReadParameter( useMemoryMapping,
+    "UseMemoryMappedDeformationField", 0, false );
+  typename DeformationFieldType::Pointer deformationField;
+  if( useMemoryMapping )
   {
-    infoChanger->Update();
+    deformationField = this->ReadMemoryMappedDeformationField( fileName );
   }
-  catch( itk::ExceptionObject & excp )
+
+  /** Otherwise read deformationFieldImage from file. */
+  if( deformationField.IsNull() )
   {
-    /** Add information to the exception. */
-    excp.SetLocation( "DeformationFieldTransform - ReadFromFile()" );
-    std::string err_str = excp.GetDescription();
-    err_str += "\nError occured while reading the deformationField image.\n";
-    excp.SetDescription( err_str );
-    /** Pass the exception to an higher level. */
-    throw excp;
+    /** Setup VectorImageReader. */
+    typedef itk::ImageFileReader< DeformationFieldType > VectorReaderType;
+    typename VectorReaderType::Pointer vectorReader
+      = VectorReaderType::New();
+
+    /** Possibly overrule the direction cosines. */
+    ChangeInfoFilterPointer infoChanger = ChangeInfoFilterType::New();
+    DirectionType           direction;
+    direction.SetIdentity();
+    infoChanger->SetOutputDirection( direction );
+    infoChanger->SetChangeDirection( !this->GetElastix()->GetUseDirectionCosines() );
+    infoChanger->SetInput( vectorReader->GetOutput() );
+
+    vectorReader->SetFileName( fileName.c_str() );
+    try
+    {
+      infoChanger->Update();
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      /** Add information to the exception. */
+      excp.SetLocation( "DeformationFieldTransform - ReadFromFile()" );
+      std::string err_str = excp.GetDescription();
+      err_str += "\nError occured while reading the deformationField image.\n";
+      excp.SetDescription( err_str );
+      /** Pass the exception to an higher level. */
+      throw excp;
+    }
+
+    /** Store the original direction for later use */
+    this->m_OriginalDeformationFieldDirection
+      = vectorReader->GetOutput()->GetDirection();
+
+    deformationField = infoChanger->GetOutput();
   }
 
-  /** Store the original direction for later use */
-  this->m_OriginalDeformationFieldDirection
-    = vectorReader->GetOutput()->GetDirection();
-
   /** Set the deformationFieldImage in the
    * itkDeformationFieldInterpolatingTransform.
    */
   this->m_DeformationFieldInterpolatingTransform->
-  SetDeformationField( infoChanger->GetOutput() );
+  SetDeformationField( deformationField );
 
   typedef typename DeformationFieldInterpolatingTransformType::
     DeformationFieldInterpolatorType InterpolatorType;
@@ -152,6 +167,45 @@ DeformationFieldTransform< TElastix >::ReadFromFile( void )
 } // end ReadFromFile()
 
 
+/**
+ * ************************* ReadMemoryMappedDeformationField ************************
+ */
+
+template< class TElastix >
+typename DeformationFieldTransform< TElastix >::DeformationFieldType::Pointer
+DeformationFieldTransform< TElastix >
+::ReadMemoryMappedDeformationField( const std::string & fileName )
+{
+  typedef itk::MemoryMappedImageFileReader< DeformationFieldType > MappedReaderType;
+
+  /** Map the file; a null pointer means that it cannot be mapped. */
+  typename MappedReaderType::Pointer mappedReader = MappedReaderType::New();
+  mappedReader->SetFileName( fileName );
+  typename DeformationFieldType::Pointer deformationField = mappedReader->Map();
+  if( deformationField.IsNull() )
+  {
+    return deformationField;
+  }
+
+  /** Store the original direction for later use */
+  this->m_OriginalDeformationFieldDirection = deformationField->GetDirection();
+
+  /** Possibly overrule the direction cosines. */
+  if( !this->GetElastix()->GetUseDirectionCosines() )
+  {
+    DirectionType direction;
+    direction.SetIdentity();
+    deformationField->SetDirection( direction );
+  }
+
+  elxout << "  The deformation field is mapped into memory from "
+         << mappedReader->GetDataFileName() << std::endl;
+
+  return deformationField;
+
+} // end ReadMemoryMappedDeformationField()
+
+
 /**
  * ************************* WriteToFile ************************
  *
@@ -24,6 +24,7 @@
 #include "itkImage.h"
 #include "itkVectorInterpolateImageFunction.h"
 #include "itkVectorNearestNeighborInterpolateImageFunction.h"
+#include "itkVectorLinearInterpolateImageFunction.h"
 
 namespace itk
 {
@@ -36,6 +37,13 @@ namespace itk
 * is not implemented. DO NOT USE IT FOR REGISTRATION.
 * You may set your own interpolator!
 *
+* When the interpolator is a VectorLinearInterpolateImageFunction, the
+* interpolation is done by a specialized kernel, which reads the
+* displacements directly from the buffer of the deformation field. The
+* result is identical to that of the interpolator. Call
+* SetDeformationField() again after changing the geometry or the buffer
+* of the deformation field.
+*
 * \ingroup Transforms
 */
 
@@ -85,6 +93,9 @@ public:
   typedef typename Superclass::JacobianOfSpatialJacobianType JacobianOfSpatialJacobianType;
 
   typedef typename Superclass::InternalMatrixType InternalMatrixType;
+  typedef typename Superclass::InputCoordinateArraysType  InputCoordinateArraysType;
+  typedef typename Superclass::OutputCoordinateArraysType OutputCoordinateArraysType;
+  typedef typename Superclass::ValidMaskValueType         ValidMaskValueType;
 
   typedef TComponentType DeformationFieldComponentType;
   typedef Vector< DeformationFieldComponentType,
@@ -98,6 +109,8 @@ public:
   typedef typename DeformationFieldInterpolatorType::Pointer DeformationFieldInterpolatorPointer;
   typedef VectorNearestNeighborInterpolateImageFunction<
     DeformationFieldType, ScalarType >                DefaultDeformationFieldInterpolatorType;
+  typedef VectorLinearInterpolateImageFunction<
+    DeformationFieldType, ScalarType >                LinearDeformationFieldInterpolatorType;
 
   /** Set the transformation parameters is not supported.
    * Use SetDeformationField() instead
@@ -132,6 +145,15 @@ public:
    */
   OutputPointType TransformPoint( const InputPointType & point ) const override;
 
+  /** Transform a batch of points. A point outside the deformation field
+   * is mapped onto itself, and is marked invalid in the mask.
+   */
+  void TransformPoints(
+    const InputCoordinateArraysType & inputCoordinates,
+    const OutputCoordinateArraysType & outputCoordinates,
+    const SizeValueType numberOfPoints,
+    ValidMaskValueType * validMask ) const override;
+
   /** These vector transforms are not implemented for this transform. */
   OutputVectorType TransformVector( const InputVectorType & ) const override
   {
@@ -247,6 +269,24 @@ protected:
   DeformationFieldPointer             m_ZeroDeformationField;
   DeformationFieldInterpolatorPointer m_DeformationFieldInterpolator;
 
+  /** Compute the displacement at a point with the linear interpolation kernel.
+   * Returns false if the point is outside the deformation field.
+   */
+  inline bool EvaluateLinearDisplacement( const ScalarType point[], ScalarType displacement[] ) const;
+
+  /** Update the cached geometry of the deformation field, which is
+   * used by the linear interpolation kernel.
+   */
+  virtual void UpdateLinearInterpolationKernel( void );
+
+  /** Cached geometry and buffer of the deformation field. */
+  bool                                  m_UseLinearInterpolationKernel;
+  const DeformationFieldComponentType * m_DeformationFieldBuffer;
+  double                                m_PointToIndexMatrix[ NDimensions ][ NDimensions ];
+  double                                m_DeformationFieldOrigin[ NDimensions ];
+  OffsetValueType                       m_DeformationFieldSize[ NDimensions ];
+  OffsetValueType                       m_DeformationFieldOffsetTable[ NDimensions ];
+
 private:
 
   DeformationFieldInterpolatingTransform( const Self & ); // purposely not implemented
@@ -20,6 +20,9 @@
 
 #include "itkDeformationFieldInterpolatingTransform.h"
 
+#include <algorithm> // std::fill
+#include <cmath>     // std::floor
+
 namespace itk
 {
 
@@ -28,8 +31,10 @@ template< class TScalarType, unsigned int NDimensions, class TComponentType >
 DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >::DeformationFieldInterpolatingTransform() :
   Superclass( OutputSpaceDimension )
 {
-  this->m_DeformationField     = 0;
-  this->m_ZeroDeformationField = DeformationFieldType::New();
+  this->m_UseLinearInterpolationKernel = false;
+  this->m_DeformationFieldBuffer       = 0;
+  this->m_DeformationField             = 0;
+  this->m_ZeroDeformationField         = DeformationFieldType::New();
   typename DeformationFieldType::SizeType dummySize;
   dummySize.Fill( 0 );
   this->m_ZeroDeformationField->SetRegions( dummySize );
@@ -51,6 +56,21 @@ OutputPointType
 DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >
 ::TransformPoint( const InputPointType & point ) const
 {
+  if( this->m_UseLinearInterpolationKernel )
+  {
+    ScalarType displacement[ NDimensions ];
+    if( !this->EvaluateLinearDisplacement( point.GetDataPointer(), displacement ) )
+    {
+      return point;
+    }
+    OutputPointType outpoint;
+    for( unsigned int i = 0; i < InputSpaceDimension; ++i )
+    {
+      outpoint[ i ] = point[ i ] + displacement[ i ];
+    }
+    return outpoint;
+  }
+
   InputContinuousIndexType cindex;
   this->m_DeformationFieldInterpolator->ConvertPointToContinuousIndex(
     point, cindex );
@@ -74,6 +94,164 @@ DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentTyp
 }
 
 
+// Transform a batch of points
+template< class TScalarType, unsigned int NDimensions, class TComponentType >
+void
+DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >
+::TransformPoints(
+  const InputCoordinateArraysType & inputCoordinates,
+  const OutputCoordinateArraysType & outputCoordinates,
+  const SizeValueType numberOfPoints,
+  ValidMaskValueType * validMask ) const
+{
+  if( !this->m_UseLinearInterpolationKernel )
+  {
+    this->Superclass::TransformPoints( inputCoordinates, outputCoordinates, numberOfPoints, validMask );
+    return;
+  }
+
+  ScalarType point[ NDimensions ];
+  ScalarType displacement[ NDimensions ];
+  for( SizeValueType n = 0; n < numberOfPoints; ++n )
+  {
+    for( unsigned int i = 0; i < InputSpaceDimension; ++i )
+    {
+      point[ i ] = inputCoordinates[ i ][ n ];
+    }
+
+    const bool inside = this->EvaluateLinearDisplacement( point, displacement );
+    for( unsigned int i = 0; i < InputSpaceDimension; ++i )
+    {
+      outputCoordinates[ i ][ n ] = inside ? point[ i ] + displacement[ i ] : point[ i ];
+    }
+    if( validMask )
+    {
+      validMask[ n ] = inside ? 1 : 0;
+    }
+  }
+
+} // end TransformPoints()
+
+
+// Compute the displacement with the linear interpolation kernel
+template< class TScalarType, unsigned int NDimensions, class TComponentType >
+bool
+DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >
+::EvaluateLinearDisplacement( const ScalarType point[], ScalarType displacement[] ) const
+{
+  /** Compute the continuous index relative to the buffer, and the offsets
+   * of the two neighbours in each dimension. The neighbours are clamped to
+   * the buffer, like the VectorLinearInterpolateImageFunction does.
+   */
+  double          fraction[ NDimensions ];
+  OffsetValueType step[ NDimensions ];
+  OffsetValueType baseOffset = 0;
+  for( unsigned int i = 0; i < NDimensions; ++i )
+  {
+    double cindex = 0.0;
+    for( unsigned int j = 0; j < NDimensions; ++j )
+    {
+      cindex += this->m_PointToIndexMatrix[ i ][ j ]
+        * ( point[ j ] - this->m_DeformationFieldOrigin[ j ] );
+    }
+
+    /** The same test as ImageFunction::IsInsideBuffer(). */
+    const OffsetValueType size = this->m_DeformationFieldSize[ i ];
+    if( !( cindex >= -0.5 && cindex < size - 0.5 ) )
+    {
+      return false;
+    }
+
+    const double          floored = std::floor( cindex );
+    const OffsetValueType index   = static_cast< OffsetValueType >( floored );
+    const OffsetValueType index0  = index < 0 ? 0 : index;
+    const OffsetValueType index1  = index + 1 < size ? index + 1 : size - 1;
+    fraction[ i ] = cindex - floored;
+    baseOffset   += index0 * this->m_DeformationFieldOffsetTable[ i ];
+    step[ i ]     = ( index1 - index0 ) * this->m_DeformationFieldOffsetTable[ i ];
+  }
+
+  /** Accumulate the weighted displacements of the 2^N corners. */
+  double accumulated[ NDimensions ];
+  std::fill( accumulated, accumulated + NDimensions, 0.0 );
+  for( unsigned int corner = 0; corner < ( 1u << NDimensions ); ++corner )
+  {
+    double          weight = 1.0;
+    OffsetValueType offset = baseOffset;
+    for( unsigned int i = 0; i < NDimensions; ++i )
+    {
+      if( corner & ( 1u << i ) )
+      {
+        weight *= fraction[ i ];
+        offset += step[ i ];
+      }
+      else
+      {
+        weight *= 1.0 - fraction[ i ];
+      }
+    }
+
+    const DeformationFieldComponentType * vector
+      = this->m_DeformationFieldBuffer + offset * NDimensions;
+    for( unsigned int k = 0; k < NDimensions; ++k )
+    {
+      accumulated[ k ] += weight * vector[ k ];
+    }
+  }
+
+  for( unsigned int k = 0; k < NDimensions; ++k )
+  {
+    displacement[ k ] = static_cast< ScalarType >( accumulated[ k ] );
+  }
+  return true;
+
+} // end EvaluateLinearDisplacement()
+
+
+// Update the cached geometry of the deformation field
+template< class TScalarType, unsigned int NDimensions, class TComponentType >
+void
+DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >
+::UpdateLinearInterpolationKernel( void )
+{
+  this->m_UseLinearInterpolationKernel = false;
+  this->m_DeformationFieldBuffer       = 0;
+
+  /** The kernel replaces the linear interpolator only. */
+  const LinearDeformationFieldInterpolatorType * linearInterpolator
+    = dynamic_cast< const LinearDeformationFieldInterpolatorType * >(
+    this->m_DeformationFieldInterpolator.GetPointer() );
+  const DeformationFieldType * field = this->m_DeformationField.GetPointer();
+  if( linearInterpolator == 0 || field == 0 || field->GetBufferPointer() == 0 )
+  {
+    return;
+  }
+
+  /** The origin of the buffer, and the matrix mapping points to indices. */
+  const typename DeformationFieldType::RegionType & region = field->GetBufferedRegion();
+  typename DeformationFieldType::PointType bufferOrigin;
+  field->TransformIndexToPhysicalPoint( region.GetIndex(), bufferOrigin );
+  const typename DeformationFieldType::DirectionType & pointToIndex
+    = field->GetPhysicalPointToIndexMatrix();
+  const OffsetValueType * offsetTable = field->GetOffsetTable();
+  for( unsigned int i = 0; i < NDimensions; ++i )
+  {
+    for( unsigned int j = 0; j < NDimensions; ++j )
+    {
+      this->m_PointToIndexMatrix[ i ][ j ] = pointToIndex[ i ][ j ];
+    }
+    this->m_DeformationFieldOrigin[ i ]      = bufferOrigin[ i ];
+    this->m_DeformationFieldSize[ i ]        = static_cast< OffsetValueType >( region.GetSize()[ i ] );
+    this->m_DeformationFieldOffsetTable[ i ] = offsetTable[ i ];
+  }
+
+  this->m_DeformationFieldBuffer = reinterpret_cast< const DeformationFieldComponentType * >(
+    field->GetBufferPointer() );
+  this->m_UseLinearInterpolationKernel = true;
+
+} // end UpdateLinearInterpolationKernel()
+
+
 // Set the deformation field
 template< class TScalarType, unsigned int NDimensions, class TComponentType >
 void
@@ -91,6 +269,7 @@ DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentTyp
     this->m_DeformationFieldInterpolator->SetInputImage(
       this->m_DeformationField );
   }
+  this->UpdateLinearInterpolationKernel();
 }
 
 
@@ -111,6 +290,7 @@ DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentTyp
     this->m_DeformationFieldInterpolator->SetInputImage(
       this->m_DeformationField );
   }
+  this->UpdateLinearInterpolationKernel();
 }
 
 
@@ -124,6 +304,7 @@ DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentTyp
   os << indent << "DeformationField: " << this->m_DeformationField << std::endl;
   os << indent << "ZeroDeformationField: " << this->m_ZeroDeformationField << std::endl;
   os << indent << "DeformationFieldInterpolator: " << this->m_DeformationFieldInterpolator << std::endl;
+  os << indent << "UseLinearInterpolationKernel: " << this->m_UseLinearInterpolationKernel << std::endl;
 }
 
 
@@ -0,0 +1,188 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#if defined( _WIN32 ) && !defined( __CYGWIN__ )
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "itkMemoryMappedFile.h"
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+MemoryMappedFile::MemoryMappedFile()
+{
+  this->m_View          = 0;
+  this->m_ViewLength    = 0;
+  this->m_Data          = 0;
+  this->m_Length        = 0;
+  this->m_FileHandle    = 0;
+  this->m_MappingHandle = 0;
+
+} // end Constructor
+
+
+/**
+ * ********************* Destructor ****************************
+ */
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+  this->Unmap();
+
+} // end Destructor
+
+
+/**
+ * ********************* Map ****************************
+ */
+
+bool
+MemoryMappedFile::Map( const std::string & fileName, std::size_t offset, std::size_t length )
+{
+  this->Unmap();
+  if( length == 0 )
+  {
+    return false;
+  }
+
+#if defined( _WIN32 ) && !defined( __CYGWIN__ )
+  /** The view must start at a multiple of the allocation granularity. */
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo( &systemInfo );
+  const std::size_t granularity = systemInfo.dwAllocationGranularity;
+  const std::size_t viewOffset  = offset - offset % granularity;
+  const std::size_t viewLength  = length + ( offset - viewOffset );
+
+  HANDLE file = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ,
+    NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+  if( file == INVALID_HANDLE_VALUE )
+  {
+    return false;
+  }
+
+  LARGE_INTEGER fileSize;
+  if( !GetFileSizeEx( file, &fileSize )
+    || static_cast< unsigned long long >( fileSize.QuadPart ) < offset + length )
+  {
+    CloseHandle( file );
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+  if( mapping == NULL )
+  {
+    CloseHandle( file );
+    return false;
+  }
+
+  const unsigned long long viewOffset64 = viewOffset;
+  void * view = MapViewOfFile( mapping, FILE_MAP_COPY,
+    static_cast< DWORD >( viewOffset64 >> 32 ),
+    static_cast< DWORD >( viewOffset64 & 0xFFFFFFFFULL ), viewLength );
+  if( view == NULL )
+  {
+    CloseHandle( mapping );
+    CloseHandle( file );
+    return false;
+  }
+
+  this->m_FileHandle    = file;
+  this->m_MappingHandle = mapping;
+#else
+  /** The view must start at a multiple of the page size. */
+  const std::size_t granularity = static_cast< std::size_t >( sysconf( _SC_PAGESIZE ) );
+  const std::size_t viewOffset  = offset - offset % granularity;
+  const std::size_t viewLength  = length + ( offset - viewOffset );
+
+  const int file = open( fileName.c_str(), O_RDONLY );
+  if( file == -1 )
+  {
+    return false;
+  }
+
+  struct stat fileStatus;
+  if( fstat( file, &fileStatus ) != 0
+    || static_cast< std::size_t >( fileStatus.st_size ) < offset + length )
+  {
+    close( file );
+    return false;
+  }
+
+  /** A private writable mapping is copy-on-write, so the file is never modified. */
+  void * view = mmap( 0, viewLength, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+    file, static_cast< off_t >( viewOffset ) );
+
+  /** The mapping stays valid after closing the file. */
+  close( file );
+  if( view == MAP_FAILED )
+  {
+    return false;
+  }
+#endif
+
+  this->m_View       = view;
+  this->m_ViewLength = viewLength;
+  this->m_Data       = static_cast< char * >( view ) + ( offset - viewOffset );
+  this->m_Length     = length;
+
+  return true;
+
+} // end Map()
+
+
+/**
+ * ********************* Unmap ****************************
+ */
+
+void
+MemoryMappedFile::Unmap( void )
+{
+  if( this->m_View == 0 )
+  {
+    return;
+  }
+
+#if defined( _WIN32 ) && !defined( __CYGWIN__ )
+  UnmapViewOfFile( this->m_View );
+  CloseHandle( static_cast< HANDLE >( this->m_MappingHandle ) );
+  CloseHandle( static_cast< HANDLE >( this->m_FileHandle ) );
+#else
+  munmap( this->m_View, this->m_ViewLength );
+#endif
+
+  this->m_View          = 0;
+  this->m_ViewLength    = 0;
+  this->m_Data          = 0;
+  this->m_Length        = 0;
+  this->m_FileHandle    = 0;
+  this->m_MappingHandle = 0;
+
+} // end Unmap()
+
+
+} // end namespace itk
@@ -0,0 +1,156 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMemoryMappedFile_h
+#define __itkMemoryMappedFile_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImportImageContainer.h"
+
+#include <string>
+
+namespace itk
+{
+
+/**
+ * \class MemoryMappedFile
+ * \brief Maps a part of a file into memory, without reading it.
+ *
+ * The pages of the file are loaded by the operating system when they are
+ * accessed, and may be evicted again under memory pressure, so files larger
+ * than the available RAM can be used. The mapping is private (copy-on-write):
+ * writing to the mapped memory never modifies the file.
+ *
+ * \ingroup ITKSystemObjects
+ */
+
+class MemoryMappedFile :
+  public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef MemoryMappedFile           Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( MemoryMappedFile, Object );
+
+  /** Map length bytes of the file, starting at byte offset. Returns false
+   * if the file could not be mapped. A previous mapping is released first.
+   */
+  bool Map( const std::string & fileName, std::size_t offset, std::size_t length );
+
+  /** Release the mapping. */
+  void Unmap( void );
+
+  /** Get a pointer to the mapped data, i.e. to the byte at the requested
+   * offset in the file, or null if nothing is mapped.
+   */
+  void * GetData( void ) const { return this->m_Data; }
+
+  /** Get the number of mapped bytes, as requested. */
+  std::size_t GetLength( void ) const { return this->m_Length; }
+
+protected:
+
+  MemoryMappedFile();
+  ~MemoryMappedFile() override;
+
+private:
+
+  MemoryMappedFile( const Self & ); // purposely not implemented
+  void operator=( const Self & );   // purposely not implemented
+
+  /** The mapped view starts at an offset that is a multiple of the
+   * allocation granularity, so it may start before m_Data.
+   */
+  void *      m_View;
+  std::size_t m_ViewLength;
+  void *      m_Data;
+  std::size_t m_Length;
+
+  /** Platform specific handles. */
+  void * m_FileHandle;
+  void * m_MappingHandle;
+
+};
+
+/**
+ * \class MemoryMappedImportImageContainer
+ * \brief An ImportImageContainer whose elements are stored in a MemoryMappedFile.
+ *
+ * The container keeps the mapping alive for as long as it is used, for example
+ * as the pixel container of an image. The container does not own the memory, so
+ * it cannot be resized.
+ *
+ * \ingroup ITKSystemObjects
+ */
+
+template< typename TElementIdentifier, typename TElement >
+class MemoryMappedImportImageContainer :
+  public ImportImageContainer< TElementIdentifier, TElement >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef MemoryMappedImportImageContainer                    Self;
+  typedef ImportImageContainer< TElementIdentifier, TElement > Superclass;
+  typedef SmartPointer< Self >                                Pointer;
+  typedef SmartPointer< const Self >                          ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( MemoryMappedImportImageContainer, ImportImageContainer );
+
+  typedef typename Superclass::ElementIdentifier ElementIdentifier;
+  typedef typename Superclass::Element           Element;
+
+  /** Use the mapped data of the file as the elements of this container. */
+  void SetMappedFile( MemoryMappedFile * mappedFile, ElementIdentifier numberOfElements )
+  {
+    this->m_MappedFile = mappedFile;
+    this->SetImportPointer( static_cast< Element * >( mappedFile->GetData() ),
+      numberOfElements, false );
+  }
+
+
+protected:
+
+  MemoryMappedImportImageContainer() {}
+  ~MemoryMappedImportImageContainer() override {}
+
+private:
+
+  MemoryMappedImportImageContainer( const Self & ); // purposely not implemented
+  void operator=( const Self & );                   // purposely not implemented
+
+  MemoryMappedFile::Pointer m_MappedFile;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkMemoryMappedFile_h
@@ -0,0 +1,108 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMemoryMappedImageFileReader_h
+#define __itkMemoryMappedImageFileReader_h
+
+#include "itkMemoryMappedFile.h"
+
+#include <string>
+
+namespace itk
+{
+
+/**
+ * \class MemoryMappedImageFileReader
+ * \brief Maps the pixels of a MetaImage file into memory, instead of reading them.
+ *
+ * Only uncompressed MetaImage files (.mhd or .mha) whose pixels are stored
+ * exactly as in memory can be mapped: with the component type of the pixels
+ * of TImage, in the native byte order, and in a single data file. For other
+ * files Map() returns a null pointer, and the file should be read with an
+ * ImageFileReader.
+ *
+ * The returned image keeps the mapping alive through its pixel container,
+ * see MemoryMappedImportImageContainer. Writing to its pixels never
+ * modifies the file.
+ *
+ * \ingroup IOFilters
+ */
+
+template< class TImage >
+class MemoryMappedImageFileReader :
+  public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef MemoryMappedImageFileReader Self;
+  typedef Object                      Superclass;
+  typedef SmartPointer< Self >        Pointer;
+  typedef SmartPointer< const Self >  ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( MemoryMappedImageFileReader, Object );
+
+  /** Typedefs. */
+  typedef TImage                                                ImageType;
+  typedef typename ImageType::Pointer                           ImagePointer;
+  typedef typename ImageType::PixelType                         PixelType;
+  typedef typename NumericTraits< PixelType >::ValueType        ComponentType;
+  typedef typename ImageType::PixelContainer::ElementIdentifier ElementIdentifier;
+  typedef MemoryMappedImportImageContainer<
+    ElementIdentifier, PixelType >                              PixelContainerType;
+
+  itkStaticConstMacro( ImageDimension, unsigned int, ImageType::ImageDimension );
+
+  /** Set/Get the name of the MetaImage header file. */
+  itkSetStringMacro( FileName );
+  itkGetStringMacro( FileName );
+
+  /** Map the pixels of the file into memory, and return an image around
+   * them, with the geometry stored in the file. Returns a null pointer if
+   * the file cannot be mapped.
+   */
+  ImagePointer Map( void );
+
+  /** Get the name of the file that contains the pixels, after a successful Map(). */
+  itkGetStringMacro( DataFileName );
+
+protected:
+
+  MemoryMappedImageFileReader() {}
+  ~MemoryMappedImageFileReader() override {}
+
+private:
+
+  MemoryMappedImageFileReader( const Self & ); // purposely not implemented
+  void operator=( const Self & );              // purposely not implemented
+
+  std::string m_FileName;
+  std::string m_DataFileName;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkMemoryMappedImageFileReader.hxx"
+#endif
+
+#endif // end #ifndef __itkMemoryMappedImageFileReader_h
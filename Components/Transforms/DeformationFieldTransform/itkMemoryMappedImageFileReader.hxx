@@ -0,0 +1,146 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMemoryMappedImageFileReader_hxx
+#define __itkMemoryMappedImageFileReader_hxx
+
+#include "itkMemoryMappedImageFileReader.h"
+
+#include "itkMetaImageIO.h"
+#include "itkByteSwapper.h"
+#include "itksys/SystemTools.hxx"
+
+namespace itk
+{
+
+/**
+ * ********************* Map ****************************
+ */
+
+template< class TImage >
+typename MemoryMappedImageFileReader< TImage >::ImagePointer
+MemoryMappedImageFileReader< TImage >
+::Map( void )
+{
+  this->m_DataFileName = "";
+
+  /** Only MetaImage files can be mapped. */
+  MetaImageIO::Pointer metaImageIO = MetaImageIO::New();
+  if( !metaImageIO->CanReadFile( this->m_FileName.c_str() ) )
+  {
+    return ImagePointer();
+  }
+  metaImageIO->SetFileName( this->m_FileName.c_str() );
+  try
+  {
+    metaImageIO->ReadImageInformation();
+  }
+  catch( ExceptionObject & )
+  {
+    return ImagePointer();
+  }
+
+  /** The data should be stored exactly as in memory: uncompressed pixels
+   * in the native byte order, in a single data file.
+   */
+  const unsigned int numberOfComponents = sizeof( PixelType ) / sizeof( ComponentType );
+  const MetaImage *  metaImage          = metaImageIO->GetMetaImagePointer();
+  const std::string  dataFile           = metaImage->ElementDataFileName();
+  if( metaImageIO->GetComponentType() != ImageIOBase::MapPixelType< ComponentType >::CType
+    || metaImageIO->GetNumberOfComponents() != numberOfComponents
+    || metaImageIO->GetNumberOfDimensions() != ImageDimension
+    || metaImage->CompressedData()
+    || metaImage->BinaryDataByteOrderMSB() != ByteSwapper< ComponentType >::SystemIsBigEndian()
+    || dataFile == "LIST" || dataFile.find( '%' ) != std::string::npos )
+  {
+    return ImagePointer();
+  }
+
+  /** Find the file and the offset of the data. */
+  typename ImageType::RegionType region;
+  ElementIdentifier numberOfPixels = 1;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    region.SetSize( i, metaImageIO->GetDimensions( i ) );
+    numberOfPixels *= metaImageIO->GetDimensions( i );
+  }
+  const std::size_t dataSize = numberOfPixels * sizeof( PixelType );
+
+  std::string dataFileName = this->m_FileName;
+  if( dataFile != "LOCAL" )
+  {
+    dataFileName = dataFile;
+    if( !itksys::SystemTools::FileIsFullPath( dataFile.c_str() ) )
+    {
+      dataFileName = itksys::SystemTools::GetFilenamePath( this->m_FileName ) + "/" + dataFile;
+    }
+  }
+  const std::size_t fileSize = itksys::SystemTools::FileLength( dataFileName );
+  std::size_t       offset   = static_cast< std::size_t >( metaImage->HeaderSize() );
+  if( dataFile == "LOCAL" || metaImage->HeaderSize() < 0 )
+  {
+    if( fileSize < dataSize )
+    {
+      return ImagePointer();
+    }
+    offset = fileSize - dataSize;
+  }
+  if( offset % sizeof( ComponentType ) != 0 || offset + dataSize > fileSize )
+  {
+    return ImagePointer();
+  }
+
+  /** Map the data. */
+  MemoryMappedFile::Pointer mappedFile = MemoryMappedFile::New();
+  if( !mappedFile->Map( dataFileName, offset, dataSize ) )
+  {
+    return ImagePointer();
+  }
+  typename PixelContainerType::Pointer pixelContainer = PixelContainerType::New();
+  pixelContainer->SetMappedFile( mappedFile, numberOfPixels );
+
+  /** Setup the image around the mapped pixels. */
+  typename ImageType::SpacingType   spacing;
+  typename ImageType::PointType     origin;
+  typename ImageType::DirectionType direction;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    spacing[ i ] = metaImageIO->GetSpacing( i );
+    origin[ i ]  = metaImageIO->GetOrigin( i );
+    const std::vector< double > axis = metaImageIO->GetDirection( i );
+    for( unsigned int j = 0; j < ImageDimension; ++j )
+    {
+      direction[ j ][ i ] = axis[ j ];
+    }
+  }
+
+  ImagePointer image = ImageType::New();
+  image->SetRegions( region );
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+  image->SetDirection( direction );
+  image->SetPixelContainer( pixelContainer );
+
+  this->m_DataFileName = dataFileName;
+  return image;
+
+} // end Map()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkMemoryMappedImageFileReader_hxx
@@ -62,6 +62,11 @@ namespace elastix
  *    For convenience, you may also specify only one value for each resolution:\n
  *    example: <tt>(GridSpacingSchedule 4.0 2.0 1.0 )</tt> \n
  *    which is equivalent to the example above.
+ * \parameter UseNestedGrids: whether a grid with half the grid spacing of the previous
+ *    resolution gets a node at every node of that grid. One grid node is added when needed,
+ *    so that the B-spline parameters can be upsampled exactly. \n
+ *    example: <tt>(UseNestedGrids "true")</tt> \n
+ *    The default is "false", which keeps the grid of each resolution as it was.
  *
  *
  * The transform parameters necessary for transformix, additionally defined by this class, are:
@@ -483,6 +483,10 @@ protected:
     itkGetStaticConstMacro( SpaceDimension ),
     itkGetStaticConstMacro( SplineOrder ) >          TransformType;
 
+  /** Sub transforms, indexed by label + 1. m_Trans[ 0 ] holds the normal
+   * component; m_Trans[ l ] holds the normal component plus the tangential
+   * components of label l - 1, so a point is mapped by one B-spline evaluation.
+   */
   unsigned char                                  m_NbLabels;
   ImageLabelPointer                              m_Labels;
   ImageLabelInterpolatorPointer                  m_LabelsInterpolator;
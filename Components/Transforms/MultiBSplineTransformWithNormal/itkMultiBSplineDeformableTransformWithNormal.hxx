@@ -492,34 +492,33 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     m_Para[ i ].SetSize( m_Trans[ i ]->GetNumberOfParameters() );
   }
 
+  /** The transform of label l - 1 holds the normal component plus the
+   * tangential components of that label, so that transforming a point
+   * takes a single B-spline evaluation.
+   */
   typedef typename ImageBaseType::PixelContainer BaseContainer;
   const BaseContainer & bases                  = *m_LocalBases->GetPixelContainer();
-  unsigned              ParametersPerDimension = m_Trans[ 0 ]->GetNumberOfParametersPerDimension();
+  const unsigned        ParametersPerDimension = m_Trans[ 0 ]->GetNumberOfParametersPerDimension();
   for( unsigned i = 0; i < ParametersPerDimension; ++i )
   {
-    VectorType tmp = bases[ i ][ 0 ] * parameters.GetElement( i );
-    for( unsigned d = 0; d < itkGetStaticConstMacro( SpaceDimension ); ++d )
+    const BaseType & base   = bases[ i ];
+    const VectorType normal = base[ 0 ] * parameters[ i ];
+    for( unsigned d = 0; d < SpaceDimension; ++d )
     {
-      m_Para[ 0 ].SetElement( i + d * ParametersPerDimension, tmp[ d ] );
+      m_Para[ 0 ][ i + d * ParametersPerDimension ] = normal[ d ];
     }
 
     for( unsigned l = 1; l <= m_NbLabels; ++l )
     {
-      for( unsigned d = 0; d < itkGetStaticConstMacro( SpaceDimension ); ++d )
-      {
-        tmp[ d ] = 0;
-      }
-
-      for( unsigned d = 1; d < itkGetStaticConstMacro( SpaceDimension ); ++d )
+      VectorType tmp = normal;
+      for( unsigned d = 1; d < SpaceDimension; ++d )
       {
-        tmp += bases[ i ][ d ] * parameters.GetElement( i + ( ( itkGetStaticConstMacro( SpaceDimension ) - 1 )
-          * ( l - 1 ) + d )
-          * ParametersPerDimension );
+        tmp += base[ d ] * parameters[ i + ( ( SpaceDimension - 1 ) * ( l - 1 ) + d ) * ParametersPerDimension ];
       }
 
-      for( unsigned d = 0; d < itkGetStaticConstMacro( SpaceDimension ); ++d )
+      for( unsigned d = 0; d < SpaceDimension; ++d )
       {
-        m_Para[ l ].SetElement( i + d * ParametersPerDimension, tmp[ d ] );
+        m_Para[ l ][ i + d * ParametersPerDimension ] = tmp[ d ];
       }
     }
   }
@@ -659,13 +658,13 @@ inline void
 MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrder >
 ::PointToLabel( const InputPointType & p, int & l ) const
 {
+  /** Nearest neighbor lookup, directly in the label buffer. */
   l = 0;
   assert( this->m_Labels );
-  typename ImageLabelInterpolator::IndexType idx;
-  this->m_LabelsInterpolator->ConvertPointToNearestIndex( p, idx );
-  if( this->m_LabelsInterpolator->IsInsideBuffer( idx ) )
+  typename ImageLabelType::IndexType idx;
+  if( this->m_Labels->TransformPhysicalPointToIndex( p, idx ) )
   {
-    l = static_cast< int >( this->m_LabelsInterpolator->EvaluateAtIndex( idx ) ) + 1;
+    l = static_cast< int >( this->m_Labels->GetPixel( idx ) ) + 1;
   }
 }
 
@@ -682,8 +681,8 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     return point;
   }
 
-  OutputPointType res = m_Trans[ 0 ]->TransformPoint( point ) + ( m_Trans[ lidx ]->TransformPoint( point ) - point );
-  return res;
+  /** The label transform includes the normal component. */
+  return m_Trans[ lidx ]->TransformPoint( point );
 }
 
 
@@ -728,7 +727,6 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
   {
     jacobian.SetSize( SpaceDimension, nnzji );
   }
-  jacobian.Fill( 0.0 );
 
   // This implements a sparse version of the Jacobian.
   // Can only compute Jacobian if parameters are set via
@@ -741,61 +739,54 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
   int lidx = 0;
   PointToLabel( ipp, lidx );
 
-  if( lidx == 0 )
-  {
-    // Return some dummy
-    nonZeroJacobianIndices.resize( this->GetNumberOfNonZeroJacobianIndices() );
-    for( unsigned int i = 0; i < this->GetNumberOfNonZeroJacobianIndices(); ++i )
-    {
-      nonZeroJacobianIndices[ i ] = i;
-    }
-    return;
-  }
-
-  JacobianType njac, ljac;
-  njac.SetSize( SpaceDimension, nnzji );
-  ljac.SetSize( SpaceDimension, nnzji );
-
-  // nzji should be the same so keep only one
-  m_Trans[ 0 ]->GetJacobian( ipp, njac, nonZeroJacobianIndices );
-  m_Trans[ lidx ]->GetJacobian( ipp, ljac, nonZeroJacobianIndices );
-
   // Convert the physical point to a continuous index, which
   // is needed for the 'Evaluate()' functions below.
+  // All sub transforms share the grid, so use the first one.
+  const TransformType & trans = *m_Trans[ 0 ];
   typename TransformType::ContinuousIndexType cindex;
-  m_Trans[ lidx ]->TransformPointToContinuousGridIndex( ipp, cindex );
+  trans.TransformPointToContinuousGridIndex( ipp, cindex );
 
   // NOTE: if the support region does not lie totally within the grid
   // we assume zero displacement and zero Jacobian
-  if( !m_Trans[ lidx ]->InsideValidRegion( cindex ) )
+  if( lidx == 0 || !trans.InsideValidRegion( cindex ) )
   {
     // Return some dummy
-    nonZeroJacobianIndices.resize( m_Trans[ lidx ]->GetNumberOfNonZeroJacobianIndices() );
-    for( unsigned int i = 0; i < m_Trans[ lidx ]->GetNumberOfNonZeroJacobianIndices(); ++i )
+    jacobian.Fill( 0.0 );
+    nonZeroJacobianIndices.resize( nnzji );
+    for( unsigned int i = 0; i < nnzji; ++i )
     {
       nonZeroJacobianIndices[ i ] = i;
     }
     return;
   }
 
+  // The Jacobian of all sub transforms only depends on the B-spline
+  // weights, which are the same for all labels: compute them once,
+  // on the stack, and fill the Jacobian with them and the local bases.
+  const unsigned nweights = TransformType::WeightsFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray[ TransformType::WeightsFunctionType::NumberOfWeights ];
+  WeightsType weights( weightsArray, nweights, false );
+
+  IndexType supportIndex;
+  trans.m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
+  trans.m_WeightsFunction->Evaluate( cindex, supportIndex, weights );
+
+  RegionType supportRegion;
+  supportRegion.SetSize( trans.m_SupportSize );
+  supportRegion.SetIndex( supportIndex );
+  trans.ComputeNonZeroJacobianIndices( nonZeroJacobianIndices, supportRegion );
+
   typedef typename ImageBaseType::PixelContainer BaseContainer;
   const BaseContainer & bases = *m_LocalBases->GetPixelContainer();
 
-  const unsigned nweights = this->GetNumberOfWeights();
   for( unsigned i = 0; i < nweights; ++i )
   {
-    VectorType tmp = bases[ nonZeroJacobianIndices[ i ] ][ 0 ];
-    for( unsigned j = 0; j < SpaceDimension; ++j )
+    const BaseType & base = bases[ nonZeroJacobianIndices[ i ] ];
+    for( unsigned d = 0; d < SpaceDimension; ++d )
     {
-      jacobian[ j ][ i ] = tmp[ j ] * njac[ j ][ i + j * nweights ];
-    }
-
-    for( unsigned d = 1; d < SpaceDimension; ++d )
-    {
-      tmp = bases[ nonZeroJacobianIndices[ i ] ][ d ];
       for( unsigned j = 0; j < SpaceDimension; ++j )
       {
-        jacobian[ j ][ i + d * nweights ] = tmp[ j ] * ljac[ j ][ i + j * nweights ];
+        jacobian[ j ][ i + d * nweights ] = base[ d ][ j ] * weightsArray[ i ];
       }
     }
   }
@@ -841,10 +832,8 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     sj.SetIdentity();
     return;
   }
-  SpatialJacobianType nsj;
-  m_Trans[ 0 ]->GetSpatialJacobian( ipp, nsj );
+  // The label transform includes the normal component.
   m_Trans[ lidx ]->GetSpatialJacobian( ipp, sj );
-  sj += nsj;
 }
 
 
@@ -881,19 +870,8 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     return;
   }
 
-  SpatialHessianType nsh, lsh;
-  m_Trans[ 0 ]->GetSpatialHessian( ipp, nsh );
-  m_Trans[ lidx ]->GetSpatialHessian( ipp, lsh );
-  for( unsigned i = 0; i < SpaceDimension; ++i )
-  {
-    for( unsigned j = 0; j < SpaceDimension; ++j )
-    {
-      for( unsigned k = 0; k < SpaceDimension; ++k )
-      {
-        sh[ i ][ j ][ k ] = lsh[ i ][ j ][ k ] + nsh[ i ][ j ][ k ];
-      }
-    }
-  }
+  // The label transform includes the normal component.
+  m_Trans[ lidx ]->GetSpatialHessian( ipp, sh );
 }
 
 
@@ -961,12 +939,10 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     return;
   }
 
-  SpatialJacobianType           nsj, lsj;
-  JacobianOfSpatialJacobianType njsj, ljsj;
-
-  // nzji should be the same so keep only one
-  m_Trans[ 0 ]->GetJacobianOfSpatialJacobian( ipp, nsj, njsj, nonZeroJacobianIndices );
-  m_Trans[ lidx ]->GetJacobianOfSpatialJacobian( ipp, lsj, ljsj, nonZeroJacobianIndices );
+  // The label transform includes the normal component, and its Jacobian
+  // only depends on the B-spline weights, which are the same for all labels.
+  JacobianOfSpatialJacobianType ljsj;
+  m_Trans[ lidx ]->GetJacobianOfSpatialJacobian( ipp, sj, ljsj, nonZeroJacobianIndices );
 
   typedef typename ImageBaseType::PixelContainer BaseContainer;
   const BaseContainer & bases = *m_LocalBases->GetPixelContainer();
@@ -979,7 +955,7 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     {
       for( unsigned k = 0; k < SpaceDimension; ++k )
       {
-        jsj[ j ][ i ][ k ] = tmp[ j ] * njsj[ j ][ i + j * nweights ][ k ];
+        jsj[ j ][ i ][ k ] = tmp[ j ] * ljsj[ j ][ i + j * nweights ][ k ];
       }
     }
 
@@ -994,7 +970,6 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
         }
       }
     }
-    sj = nsj + lsj;
   }
 
   // move non zero indices to match label positions
@@ -1070,12 +1045,10 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     return;
   }
 
-  SpatialHessianType           nsh, lsh;
-  JacobianOfSpatialHessianType njsh, ljsh;
-
-  // nzji should be the same so keep only one
-  m_Trans[ 0 ]->GetJacobianOfSpatialHessian( ipp, nsh, njsh, nonZeroJacobianIndices );
-  m_Trans[ lidx ]->GetJacobianOfSpatialHessian( ipp, lsh, ljsh, nonZeroJacobianIndices );
+  // The label transform includes the normal component, and its Jacobian
+  // only depends on the B-spline weights, which are the same for all labels.
+  JacobianOfSpatialHessianType ljsh;
+  m_Trans[ lidx ]->GetJacobianOfSpatialHessian( ipp, sh, ljsh, nonZeroJacobianIndices );
 
   typedef typename ImageBaseType::PixelContainer BaseContainer;
   const BaseContainer & bases = *m_LocalBases->GetPixelContainer();
@@ -1090,7 +1063,7 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
       {
         for( unsigned l = 0; l < SpaceDimension; ++l )
         {
-          jsh[ j ][ i ][ k ][ l ] = tmp[ j ] * njsh[ j ][ i + j * nweights ][ k ][ l ];
+          jsh[ j ][ i ][ k ][ l ] = tmp[ j ] * ljsh[ j ][ i + j * nweights ][ k ][ l ];
         }
       }
     }
@@ -1111,17 +1084,6 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     }
   }
 
-  for( unsigned i = 0; i < SpaceDimension; ++i )
-  {
-    for( unsigned j = 0; j < SpaceDimension; ++j )
-    {
-      for( unsigned k = 0; k < SpaceDimension; ++k )
-      {
-        sh[ i ][ j ][ k ] = lsh[ i ][ j ][ k ] + nsh[ i ][ j ][ k ];
-      }
-    }
-  }
-
   // move non zero indices to match label positions
   if( lidx > 1 )
   {
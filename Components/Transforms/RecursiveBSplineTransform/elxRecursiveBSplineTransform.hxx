@@ -379,6 +379,12 @@ RecursiveBSplineTransform< TElastix >
     finalGridSpacingInPhysicalUnits );
   this->m_GridScheduleComputer->SetSchedule( gridSchedule );
 
+  /** Check if the grids should nest when the grid spacing halves. */
+  bool useNestedGrids = false;
+  this->m_Configuration->ReadParameter( useNestedGrids,
+    "UseNestedGrids", this->GetComponentLabel(), 0, 0 );
+  this->m_GridScheduleComputer->SetUseNestedGrids( useNestedGrids );
+
   /** Compute the necessary information. */
   this->m_GridScheduleComputer->ComputeBSplineGrid();
 
@@ -25,6 +25,7 @@
 #include "itkThinPlateSplineKernelTransform2.h"
 #include "itkThinPlateR2LogRSplineKernelTransform2.h"
 #include "itkVolumeSplineKernelTransform2.h"
+#include "itkAdvancedIdentityTransform.h"
 
 namespace elastix
 {
@@ -70,6 +71,11 @@ namespace elastix
  * Default: 0.3. You cannot specify this parameter for each resolution differently.\n
  * Valid values are withing -1.0 and 0.5. 0.5 means incompressible.
  * Negative values are a bit odd, but possible. See Wikipedia on PoissonRatio.
+ * \parameter TPSMatrixInversionMethod: The method used to invert the kernel
+ * system matrix, one of { SVD, QR }. The "Iterative" method of the transform
+ * parameter file cannot be used for registration.\n
+ *   example: <tt>(TPSMatrixInversionMethod "QR")</tt>\n
+ * Default: SVD.
  *
  * \commandlinearg -fp: a file specifying a set of points that will serve
  * as fixed image landmarks.\n
@@ -107,6 +113,47 @@ namespace elastix
  * \transformparameter FixedImageLandmarks: The landmark positions in the
  * fixed image, in world coordinates. Positions written as x1 y1 [z1] x2 y2 [z2] etc.\n
  *   example: <tt>(FixedImageLandmarks 10.0 11.0 12.0 4.0 4.0 4.0 6.0 6.0 6.0 )</tt>
+ * \transformparameter TPSMatrixInversionMethod: The method used to solve for
+ * the spline coefficients, one of { SVD, QR, Iterative }. SVD and QR build the
+ * dense inverse of the system matrix, which is infeasible for tens of thousands
+ * of landmarks. "Iterative" solves the system with a multi-threaded matrix-free
+ * MINRES solver, which needs only linear memory.\n
+ *   example: <tt>(TPSMatrixInversionMethod "Iterative")</tt>\n
+ * Default: SVD.
+ * \transformparameter TPSIterativeSolverMaximumNumberOfIterations: The maximum
+ * number of MINRES iterations.\n
+ *   example: <tt>(TPSIterativeSolverMaximumNumberOfIterations 10000)</tt>\n
+ * Default: 5000.
+ * \transformparameter TPSIterativeSolverTolerance: MINRES stops when the
+ * residual relative to the right-hand side, both in the norm of the
+ * preconditioner, drops below this value.\n
+ *   example: <tt>(TPSIterativeSolverTolerance 1e-8)</tt>\n
+ * Default: 1e-10.
+ * \transformparameter TPSIterativeSolverPreconditionerBlockSize: MINRES is
+ * preconditioned by inverting the kernel matrix on blocks of at most this many
+ * nearby landmarks. Larger blocks take more memory and fewer iterations;
+ * 0 disables the preconditioner.\n
+ *   example: <tt>(TPSIterativeSolverPreconditionerBlockSize 128)</tt>\n
+ * Default: 64.
+ * \transformparameter BakeSplineKernelTransform: Replace the kernel transform
+ * by a B-spline approximation on the output image domain given by Size, Index,
+ * Spacing, Origin and Direction. Every kernel transform evaluation costs time
+ * linear in the number of landmarks; the B-spline evaluation does not.\n
+ *   example: <tt>(BakeSplineKernelTransform "true")</tt>\n
+ * Default: "false".
+ * \transformparameter BakeSplineKernelTransformGridSpacingInVoxels: The control
+ * point spacing of the baked B-spline, in voxels of the output image. Can be
+ * given for each dimension.\n
+ *   example: <tt>(BakeSplineKernelTransformGridSpacingInVoxels 2.0)</tt>\n
+ * Default: 2.0.
+ * \transformparameter BakeSplineKernelTransformMaximumErrorInVoxels: The largest
+ * accepted distance between the baked and the exact kernel transform, in units of
+ * the smallest voxel spacing of the output image. The distance is measured at the
+ * centres of the grid cells; if it exceeds this value, a warning is given and the
+ * kernel transform is used. Outside the output image domain, the kernel transform
+ * is always used.\n
+ *   example: <tt>(BakeSplineKernelTransformMaximumErrorInVoxels 0.05)</tt>\n
+ * Default: 0.1.
  *
  * \ingroup Transforms
  */
@@ -242,6 +289,11 @@ protected:
     PointSetPointer & landmarkPointSet,
     const bool & landmarksInFixedImage );
 
+  /** Replace the kernel transform by a B-spline approximation, if the
+   * BakeSplineKernelTransform parameter is "true".
+   */
+  virtual void BakeSplineKernelTransform( void );
+
   /** The itk kernel transform. */
   KernelTransformPointer m_KernelTransform;
 
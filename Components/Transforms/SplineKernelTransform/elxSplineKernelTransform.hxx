@@ -22,6 +22,7 @@
 #include "itkTransformixInputPointFileReader.h"
 #include "vnl/vnl_math.h"
 #include "itkTimeProbe.h"
+#include "itkBakedBSplineTransformComputer.h"
 
 namespace elastix
 {
@@ -195,10 +196,20 @@ SplineKernelTransform< TElastix >
     this->m_KernelTransform->SetPoissonRatio( poissonRatio );
   }
 
-  /** Set the matrix inversion method (one of {SVD, QR}). */
+  /** Set the matrix inversion method (one of {SVD, QR}). The iterative
+   * method does not provide the Jacobian needed for registration.
+   */
   std::string matrixInversionMethod = "SVD";
   this->GetConfiguration()->ReadParameter(
     matrixInversionMethod, "TPSMatrixInversionMethod", 0, true );
+  if( matrixInversionMethod == "Iterative" )
+  {
+    xl::xout[ "error" ] << "ERROR: the TPSMatrixInversionMethod \"Iterative\" "
+                        << "can only be used for applying a transform, not for "
+                        << "registration." << std::endl;
+    itkExceptionMacro( << "ERROR: unable to configure "
+                       << this->GetComponentLabel() );
+  }
   this->m_KernelTransform->SetMatrixInversionMethod( matrixInversionMethod );
 
   /** Load fixed image (source) landmark positions. */
@@ -432,6 +443,31 @@ SplineKernelTransform< TElastix >
     poissonRatio, "SplinePoissonRatio", this->GetComponentLabel(), 0, -1 );
   this->m_KernelTransform->SetPoissonRatio( poissonRatio );
 
+  /** Set the matrix inversion method (one of {SVD, QR, Iterative}). */
+  std::string matrixInversionMethod = "SVD";
+  this->GetConfiguration()->ReadParameter(
+    matrixInversionMethod, "TPSMatrixInversionMethod", 0, false );
+  this->m_KernelTransform->SetMatrixInversionMethod( matrixInversionMethod );
+  if( matrixInversionMethod == "Iterative" )
+  {
+    unsigned int maximumNumberOfIterations
+      = this->m_KernelTransform->GetIterativeSolverMaximumNumberOfIterations();
+    this->GetConfiguration()->ReadParameter( maximumNumberOfIterations,
+      "TPSIterativeSolverMaximumNumberOfIterations", 0, false );
+    this->m_KernelTransform->SetIterativeSolverMaximumNumberOfIterations(
+      maximumNumberOfIterations );
+
+    double tolerance = this->m_KernelTransform->GetIterativeSolverTolerance();
+    this->GetConfiguration()->ReadParameter( tolerance,
+      "TPSIterativeSolverTolerance", 0, false );
+    this->m_KernelTransform->SetIterativeSolverTolerance( tolerance );
+
+    unsigned int blockSize = this->m_KernelTransform->GetIterativeSolverPreconditionerBlockSize();
+    this->GetConfiguration()->ReadParameter( blockSize,
+      "TPSIterativeSolverPreconditionerBlockSize", 0, false );
+    this->m_KernelTransform->SetIterativeSolverPreconditionerBlockSize( blockSize );
+  }
+
   /** Read number of parameters. */
   unsigned int numberOfParameters = 0;
   this->GetConfiguration()->ReadParameter(
@@ -462,11 +498,122 @@ SplineKernelTransform< TElastix >
    * splinekerneltype, because later the ReadFromFile from
    * TransformBase calls SetParameters.
    */
+  itk::TimeProbe timer;
+  timer.Start();
   this->Superclass2::ReadFromFile();
+  timer.Stop();
+
+  if( matrixInversionMethod == "Iterative" )
+  {
+    elxout << "  Setting the transform parameters took: "
+           << this->ConvertSecondsToDHMS( timer.GetMean(), 6 ) << "\n"
+           << "  Number of iterations: "
+           << this->m_KernelTransform->GetIterativeSolverNumberOfIterations() << "\n"
+           << "  Relative residual: "
+           << this->m_KernelTransform->GetIterativeSolverRelativeResidual() << std::endl;
+    if( this->m_KernelTransform->GetIterativeSolverRelativeResidual()
+      > this->m_KernelTransform->GetIterativeSolverTolerance() )
+    {
+      xl::xout[ "warning" ] << "WARNING: the iterative solver did not reach "
+                            << "the requested tolerance." << std::endl;
+    }
+  }
+
+  /** Optionally replace the kernel transform by a B-spline approximation
+   * on the output image domain, for fast evaluation.
+   */
+  this->BakeSplineKernelTransform();
 
 } // ReadFromFile()
 
 
+/**
+ * ************************* BakeSplineKernelTransform ************************
+ */
+
+template< class TElastix >
+void
+SplineKernelTransform< TElastix >
+::BakeSplineKernelTransform( void )
+{
+  /** Check if baking is requested. */
+  bool bakeSplineKernelTransform = false;
+  this->GetConfiguration()->ReadParameter( bakeSplineKernelTransform,
+    "BakeSplineKernelTransform", 0, false );
+  if( !bakeSplineKernelTransform )
+  {
+    return;
+  }
+
+  /** Get the output image domain. */
+  typename FixedImageType::PointType     origin;
+  typename FixedImageType::SpacingType   spacing;
+  typename FixedImageType::DirectionType direction;
+  typename FixedImageType::RegionType    region;
+  this->ReadOutputImageDomain( origin, spacing, direction, region );
+  if( region.GetNumberOfPixels() == 0 )
+  {
+    xl::xout[ "warning" ] << "WARNING: BakeSplineKernelTransform is ignored, "
+                          << "since no output image domain is given." << std::endl;
+    return;
+  }
+
+  /** Read the grid spacing. */
+  typename FixedImageType::SpacingType gridSpacing;
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    double gridSpacingInVoxels = 2.0;
+    this->GetConfiguration()->ReadParameter( gridSpacingInVoxels,
+      "BakeSplineKernelTransformGridSpacingInVoxels", i, false );
+    gridSpacing[ i ] = gridSpacingInVoxels * spacing[ i ];
+  }
+
+  /** Sample the kernel transform and compute the B-spline transform. */
+  typedef itk::BakedBSplineTransformComputer<
+    CoordRepType, itkGetStaticConstMacro( SpaceDimension ) > BakedTransformComputerType;
+  typename BakedTransformComputerType::Pointer computer = BakedTransformComputerType::New();
+  computer->SetTransform( this->m_KernelTransform );
+  computer->SetImageOrigin( origin );
+  computer->SetImageSpacing( spacing );
+  computer->SetImageDirection( direction );
+  computer->SetImageRegion( region );
+  computer->SetGridSpacing( gridSpacing );
+
+  elxout << "Baking the spline kernel transform ..." << std::endl;
+  itk::TimeProbe timer;
+  timer.Start();
+  computer->Compute();
+  timer.Stop();
+  elxout << "  Baking the spline kernel transform took: "
+         << this->ConvertSecondsToDHMS( timer.GetMean(), 2 ) << std::endl;
+
+  /** Keep the kernel transform if the approximation is too coarse. */
+  if( !this->CheckBakingError( "BakeSplineKernelTransformMaximumErrorInVoxels",
+    computer->GetMaximumError(), computer->GetRMSError(),
+    computer->GetNumberOfErrorSamples(), spacing ) )
+  {
+    xl::xout[ "warning" ] << "WARNING: the spline kernel transform is not baked." << std::endl;
+    return;
+  }
+
+  /** The baked transform is only used inside the output image domain: it is
+   * the baked initial transform of a combination of the kernel transform with
+   * an identity transform. The kernel transform is kept in m_KernelTransform
+   * for WriteToFile.
+   */
+  typedef itk::AdvancedIdentityTransform<
+    CoordRepType, itkGetStaticConstMacro( SpaceDimension ) > IdentityTransformType;
+  typename CombinationTransformType::Pointer bakedTransform = CombinationTransformType::New();
+  bakedTransform->SetUseComposition( true );
+  bakedTransform->SetInitialTransform( this->m_KernelTransform );
+  bakedTransform->SetCurrentTransform( IdentityTransformType::New() );
+  bakedTransform->SetBakedInitialTransform( computer->GetModifiableOutput(),
+    computer->GetModifiableImageDomain() );
+  this->SetCurrentTransform( bakedTransform );
+
+} // end BakeSplineKernelTransform()
+
+
 /**
  * ************************* WriteToFile ************************
  * Save the kernel type and the source landmarks
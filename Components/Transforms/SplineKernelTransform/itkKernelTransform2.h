@@ -48,6 +48,9 @@ PURPOSE.  See the above copyright notices for more information.
 #include "vnl/vnl_sample.h"
 #include "vnl/algo/vnl_svd.h"
 #include "vnl/algo/vnl_qr.h"
+#include "vnl/algo/vnl_symmetric_eigensystem.h"
+#include "itkMultiThreader.h"
+#include <vector>
 
 namespace itk
 {
@@ -85,6 +88,11 @@ namespace itk
  * - make it threadsafe, like was done in the itk as well.
  * - Support for matrix inversion by QR decomposition, instead of SVD.
  *   QR is much faster. Used in SetParameters() and SetFixedParameters().
+ * - Support for large landmark sets, by solving for the weights with the
+ *   matrix-free iterative MINRES method ("Iterative" matrix inversion
+ *   method), which never stores the L matrix. The inverse of L is then not
+ *   available, so the Jacobian can not be computed in this mode. MINRES is
+ *   preconditioned by a block-Jacobi preconditioner on nearby landmarks.
  * - Much faster Jacobian computation for some of the derived kernel transforms.
  *
  * \ingroup Transforms
@@ -292,10 +300,36 @@ public:
   }
 
 
-  /** Matrix inversion by SVD or QR decomposition. */
+  /** Matrix inversion by SVD or QR decomposition, or "Iterative" to solve
+   * for the weights without storing the L matrix, for large numbers of landmarks.
+   */
   itkSetMacro( MatrixInversionMethod, std::string );
   itkGetConstReferenceMacro( MatrixInversionMethod, std::string );
 
+  /** Settings of the iterative method: the maximum number of iterations
+   * (default 5000) and the tolerance on the residual relative to the
+   * landmark displacements (default 1e-10).
+   */
+  itkSetMacro( IterativeSolverMaximumNumberOfIterations, unsigned int );
+  itkGetConstMacro( IterativeSolverMaximumNumberOfIterations, unsigned int );
+  itkSetMacro( IterativeSolverTolerance, double );
+  itkGetConstMacro( IterativeSolverTolerance, double );
+
+  /** The iterative method is preconditioned by a block-Jacobi preconditioner
+   * on groups of nearby landmarks, of at most this size (default 64).
+   * Memory use grows linearly with the block size, the number of iterations
+   * decreases. Set to 0 to disable the preconditioner.
+   */
+  itkSetMacro( IterativeSolverPreconditionerBlockSize, unsigned int );
+  itkGetConstMacro( IterativeSolverPreconditionerBlockSize, unsigned int );
+
+  /** Get the number of iterations and the relative residual of the last
+   * iterative solve. With the preconditioner, the residual is measured in
+   * the norm induced by its inverse.
+   */
+  itkGetConstMacro( IterativeSolverNumberOfIterations, unsigned int );
+  itkGetConstMacro( IterativeSolverRelativeResidual, double );
+
   /** Must be provided. */
   void GetSpatialJacobian(
     const InputPointType & ipp, SpatialJacobianType & sj ) const override
@@ -435,6 +469,67 @@ protected:
   /** Compute displacements \f$ q_i - p_i \f$. */
   void ComputeD( void );
 
+  /** Compute W by the MINRES method, using products with L that are computed
+   * on the fly with multiple threads, without storing L.
+   */
+  void ComputeWMatrixIteratively( void );
+
+  /** Typedefs for multi-threading of the products with L. */
+  typedef itk::MultiThreader             ThreaderType;
+  typedef ThreaderType::ThreadInfoStruct ThreadInfoType;
+
+  /** The data of a product with L, shared by the threads. The columns of
+   * the affine part (P) are computed from the normalized landmarks.
+   */
+  struct LMatrixProductType
+  {
+    const Self *                          st_Self;
+    const std::vector< InputPointType > * st_Landmarks;
+    const std::vector< InputPointType > * st_NormalizedLandmarks;
+    const std::vector< GMatrixType > *    st_ReflexiveG;
+    const TScalarType *                   st_Input;
+    TScalarType *                         st_Output;
+  };
+
+  /** The block-Jacobi preconditioner of the iterative method. The landmarks
+   * are split into blocks of nearby landmarks. Per block the inverse of the
+   * corresponding diagonal block of K is stored, with the absolute values of
+   * its eigenvalues, so that the preconditioner is positive definite while K
+   * is not. The affine rows are preconditioned by the inverse of the Schur
+   * complement P^T M_K^{-1} P.
+   */
+  struct BlockJacobiPreconditionerType
+  {
+    std::vector< std::vector< unsigned long > > m_Blocks;
+    std::vector< vnl_matrix< TScalarType > >    m_BlockInverses;
+    vnl_matrix< TScalarType >                   m_AffineInverse;
+  };
+
+  /** Split the landmarks [ begin, end ) of indices into blocks of at most
+   * blockSize landmarks, by recursive bisection of the longest axis.
+   */
+  static void PartitionLandmarks( const std::vector< InputPointType > & landmarks,
+    std::vector< unsigned long > & indices, const unsigned long begin, const unsigned long end,
+    const unsigned int blockSize, std::vector< std::vector< unsigned long > > & blocks );
+
+  /** Compute the block-Jacobi preconditioner. */
+  void ComputeBlockJacobiPreconditioner( const std::vector< InputPointType > & landmarks,
+    const std::vector< InputPointType > & normalizedLandmarks,
+    const std::vector< GMatrixType > & reflexiveG,
+    BlockJacobiPreconditionerType & preconditioner ) const;
+
+  /** Compute output = M^{-1} input. Only the landmark rows when landmarkRowsOnly. */
+  void ApplyBlockJacobiPreconditioner( const BlockJacobiPreconditionerType & preconditioner,
+    const vnl_vector< TScalarType > & input, vnl_vector< TScalarType > & output,
+    const bool landmarkRowsOnly = false ) const;
+
+  /** Compute output = L input, for the landmark rows of L in parallel. */
+  void ComputeLMatrixProduct( ThreaderType * threader, LMatrixProductType & product,
+    const vnl_vector< TScalarType > & input, vnl_vector< TScalarType > & output ) const;
+
+  /** The thread callback of ComputeLMatrixProduct. */
+  static ITK_THREAD_RETURN_TYPE LMatrixProductThreaderCallback( void * arg );
+
   /** Reorganize the components of W into D (deformable), A (rotation part
    * of affine) and B (translational part of affine ) components.
    * \warning This method release the memory of the W Matrix.
@@ -529,9 +624,16 @@ private:
 
   TScalarType m_PoissonRatio;
 
-  /** Using SVD or QR decomposition. */
+  /** Using SVD or QR decomposition, or the iterative method. */
   std::string m_MatrixInversionMethod;
 
+  /** Settings and results of the iterative method. */
+  unsigned int m_IterativeSolverMaximumNumberOfIterations;
+  double       m_IterativeSolverTolerance;
+  unsigned int m_IterativeSolverPreconditionerBlockSize;
+  unsigned int m_IterativeSolverNumberOfIterations;
+  double       m_IterativeSolverRelativeResidual;
+
 };
 
 } // end namespace itk
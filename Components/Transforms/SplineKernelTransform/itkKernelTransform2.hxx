@@ -35,6 +35,8 @@ PURPOSE.  See the above copyright notices for more information.
 #define _itkKernelTransform2_hxx
 
 #include "itkKernelTransform2.h"
+#include <algorithm>
+#include <cmath>
 
 namespace itk
 {
@@ -71,6 +73,12 @@ KernelTransform2< TScalarType, NDimensions >
   this->m_MatrixInversionMethod   = "SVD";
   this->m_FastComputationPossible = false;
 
+  this->m_IterativeSolverMaximumNumberOfIterations = 5000;
+  this->m_IterativeSolverTolerance                 = 1e-10;
+  this->m_IterativeSolverPreconditionerBlockSize   = 64;
+  this->m_IterativeSolverNumberOfIterations        = 0;
+  this->m_IterativeSolverRelativeResidual          = 0.0;
+
   this->m_HasNonZeroSpatialHessian           = true;
   this->m_HasNonZeroJacobianOfSpatialHessian = true;
 
@@ -113,8 +121,12 @@ KernelTransform2< TScalarType, NDimensions >
     this->m_LInverseComputed             = false;
     this->m_LMatrixDecompositionComputed = false;
 
-    // you must recompute L and Linv - this does not require the targ landmarks
-    this->ComputeLInverse();
+    // you must recompute L and Linv - this does not require the targ landmarks.
+    // The iterative method never forms L.
+    if( this->m_MatrixInversionMethod != "Iterative" )
+    {
+      this->ComputeLInverse();
+    }
 
     // Precompute the nonzerojacobianindices vector
     const NumberOfParametersType nrParams = this->GetNumberOfParameters();
@@ -251,6 +263,13 @@ void
 KernelTransform2< TScalarType, NDimensions >
 ::ComputeWMatrix( void )
 {
+  /** The iterative method does not need L itself. */
+  if( this->m_MatrixInversionMethod == "Iterative" )
+  {
+    this->ComputeWMatrixIteratively();
+    return;
+  }
+
   /** Compute L and Y. */
   if( !this->m_LMatrixComputed )
   {
@@ -336,6 +355,550 @@ KernelTransform2< TScalarType, NDimensions >
 
 } // end ComputeLInverse()
 
+/**
+ * ******************* ComputeWMatrixIteratively *******************
+ *
+ * Solve L W = Y by the preconditioned MINRES method for symmetric
+ * indefinite systems, see Elman, Silvester and Wathen, "Finite elements
+ * and fast iterative solvers", 2005, Algorithm 4.1. Only products with L
+ * are needed, which are computed on the fly, so that the memory use is
+ * linear in the number of landmarks. Each product costs O(N^2), so the
+ * block-Jacobi preconditioner, which costs O(N) per iteration, pays off
+ * by reducing the number of iterations.
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::ComputeWMatrixIteratively( void )
+{
+  const unsigned long numberOfLandmarks = this->m_SourceLandmarks->GetNumberOfPoints();
+  const unsigned long numberOfRows      = NDimensions * ( numberOfLandmarks + NDimensions + 1 );
+  const unsigned long affineStart       = numberOfLandmarks * NDimensions;
+  const unsigned long translationStart  = affineStart + NDimensions * NDimensions;
+
+  /** Cache the landmarks and the block diagonal of K. */
+  std::vector< InputPointType > landmarks( numberOfLandmarks );
+  std::vector< GMatrixType >    reflexiveG( numberOfLandmarks );
+  InputVectorType               centre; centre.Fill( 0.0 );
+  PointsIterator                sp = this->m_SourceLandmarks->GetPoints()->Begin();
+  for( unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd, ++sp )
+  {
+    landmarks[ lnd ] = sp.Value();
+    this->ComputeReflexiveG( sp, reflexiveG[ lnd ] );
+    for( unsigned int dim = 0; dim < NDimensions; ++dim )
+    {
+      centre[ dim ] += landmarks[ lnd ][ dim ];
+    }
+  }
+  if( numberOfLandmarks > 0 )
+  {
+    centre /= static_cast< TScalarType >( numberOfLandmarks );
+  }
+
+  /** The affine part is solved for in landmark coordinates that are centred
+   * and scaled to [-1, 1], which improves the conditioning of L a lot.
+   */
+  TScalarType scale = 0.0;
+  for( unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd )
+  {
+    for( unsigned int dim = 0; dim < NDimensions; ++dim )
+    {
+      scale = std::max( scale, std::abs( landmarks[ lnd ][ dim ] - centre[ dim ] ) );
+    }
+  }
+  if( scale == 0.0 )
+  {
+    scale = 1.0;
+  }
+  std::vector< InputPointType > normalizedLandmarks( numberOfLandmarks );
+  for( unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd )
+  {
+    for( unsigned int dim = 0; dim < NDimensions; ++dim )
+    {
+      normalizedLandmarks[ lnd ][ dim ] = ( landmarks[ lnd ][ dim ] - centre[ dim ] ) / scale;
+    }
+  }
+
+  LMatrixProductType product;
+  product.st_Self                = this;
+  product.st_Landmarks           = &landmarks;
+  product.st_NormalizedLandmarks = &normalizedLandmarks;
+  product.st_ReflexiveG          = &reflexiveG;
+  ThreaderType::Pointer threader = ThreaderType::New();
+
+  /** The right hand side. */
+  this->ComputeY();
+  const vnl_vector< TScalarType > b = this->m_YMatrix.get_column( 0 );
+  this->m_YMatrix = YMatrixType( 1, 1 );
+
+  /** The preconditioner. */
+  const bool                    usePreconditioner = this->m_IterativeSolverPreconditionerBlockSize > 0;
+  BlockJacobiPreconditionerType preconditioner;
+  if( usePreconditioner )
+  {
+    this->ComputeBlockJacobiPreconditioner( landmarks, normalizedLandmarks, reflexiveG, preconditioner );
+  }
+
+  /** Preconditioned MINRES iterations, starting from x = 0. The Lanczos
+   * vectors v are not normalized; z = M^{-1} v.
+   */
+  vnl_vector< TScalarType > x( numberOfRows, 0.0 );
+  vnl_vector< TScalarType > v0( numberOfRows, 0.0 );
+  vnl_vector< TScalarType > v1( b );
+  vnl_vector< TScalarType > v2( numberOfRows );
+  vnl_vector< TScalarType > z1( b );
+  vnl_vector< TScalarType > z2( numberOfRows );
+  vnl_vector< TScalarType > w0( numberOfRows, 0.0 );
+  vnl_vector< TScalarType > w1( numberOfRows, 0.0 );
+  vnl_vector< TScalarType > w2( numberOfRows );
+  vnl_vector< TScalarType > Az( numberOfRows );
+  if( usePreconditioner )
+  {
+    this->ApplyBlockJacobiPreconditioner( preconditioner, v1, z1 );
+  }
+  TScalarType  gamma0    = 1.0;
+  TScalarType  gamma1    = std::sqrt( std::max( dot_product( z1, v1 ), NumericTraits< TScalarType >::ZeroValue() ) );
+  TScalarType  eta       = gamma1;
+  TScalarType  c0        = 1.0;
+  TScalarType  c1        = 1.0;
+  TScalarType  s0        = 0.0;
+  TScalarType  s1        = 0.0;
+  unsigned int iteration = 0;
+  const TScalarType initialResidual = gamma1;
+  const TScalarType tolerance       = this->m_IterativeSolverTolerance * initialResidual;
+  while( std::abs( eta ) > tolerance
+    && iteration < this->m_IterativeSolverMaximumNumberOfIterations )
+  {
+    /** Lanczos step. */
+    z1 /= gamma1;
+    this->ComputeLMatrixProduct( threader, product, z1, Az );
+    const TScalarType delta = dot_product( Az, z1 );
+    v2 = Az - ( delta / gamma1 ) * v1 - ( gamma1 / gamma0 ) * v0;
+    if( usePreconditioner )
+    {
+      this->ApplyBlockJacobiPreconditioner( preconditioner, v2, z2 );
+    }
+    else
+    {
+      z2 = v2;
+    }
+    const TScalarType gamma2 = std::sqrt( std::max( dot_product( z2, v2 ), NumericTraits< TScalarType >::ZeroValue() ) );
+
+    /** Givens rotations. */
+    const TScalarType alpha0 = c1 * delta - c0 * s1 * gamma1;
+    const TScalarType alpha1 = std::sqrt( alpha0 * alpha0 + gamma2 * gamma2 );
+    const TScalarType alpha2 = s1 * delta + c0 * c1 * gamma1;
+    const TScalarType alpha3 = s0 * gamma1;
+    if( alpha1 == 0.0 )
+    {
+      break; // L is singular on the Krylov space
+    }
+    const TScalarType c2 = alpha0 / alpha1;
+    const TScalarType s2 = gamma2 / alpha1;
+
+    /** Update the solution. */
+    w2  = ( z1 - alpha3 * w0 - alpha2 * w1 ) / alpha1;
+    x  += ( c2 * eta ) * w2;
+    eta = -s2 * eta;
+    ++iteration;
+    if( gamma2 == 0.0 )
+    {
+      break; // the Krylov space is invariant, x is exact
+    }
+
+    v0.swap( v1 ); v1.swap( v2 );
+    z1.swap( z2 );
+    w0.swap( w1 ); w1.swap( w2 );
+    gamma0 = gamma1; gamma1 = gamma2;
+    c0 = c1; c1 = c2;
+    s0 = s1; s1 = s2;
+  }
+  this->m_IterativeSolverNumberOfIterations = iteration;
+  this->m_IterativeSolverRelativeResidual   = initialResidual > 0.0 ? std::abs( eta ) / initialResidual : 0.0;
+
+  /** Undo the normalization of the affine part: with p' = ( p - c ) / s,
+   * sum_j p'_j a'_j + b' = sum_j p_j ( a'_j / s ) + b' - sum_j c_j a'_j / s.
+   */
+  this->m_WMatrix.set_size( numberOfRows, 1 );
+  for( unsigned long i = 0; i < translationStart; ++i )
+  {
+    this->m_WMatrix( i, 0 ) = x[ i ];
+  }
+  for( unsigned int odim = 0; odim < NDimensions; ++odim )
+  {
+    this->m_WMatrix( translationStart + odim, 0 ) = x[ translationStart + odim ];
+  }
+  for( unsigned int j = 0; j < NDimensions; ++j )
+  {
+    for( unsigned int odim = 0; odim < NDimensions; ++odim )
+    {
+      const TScalarType a = x[ affineStart + j * NDimensions + odim ] / scale;
+      this->m_WMatrix( affineStart + j * NDimensions + odim, 0 ) = a;
+      this->m_WMatrix( translationStart + odim, 0 )            -= centre[ j ] * a;
+    }
+  }
+
+  /** Reorganize W. */
+  this->ReorganizeW();
+
+} // end ComputeWMatrixIteratively()
+
+
+/**
+ * ******************* PartitionLandmarks *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::PartitionLandmarks( const std::vector< InputPointType > & landmarks,
+  std::vector< unsigned long > & indices, const unsigned long begin, const unsigned long end,
+  const unsigned int blockSize, std::vector< std::vector< unsigned long > > & blocks )
+{
+  if( end - begin <= blockSize )
+  {
+    blocks.push_back( std::vector< unsigned long >( indices.begin() + begin, indices.begin() + end ) );
+    return;
+  }
+
+  /** Split at the median along the longest axis of the bounding box. */
+  InputPointType lower = landmarks[ indices[ begin ] ];
+  InputPointType upper = lower;
+  for( unsigned long i = begin; i < end; ++i )
+  {
+    for( unsigned int dim = 0; dim < NDimensions; ++dim )
+    {
+      lower[ dim ] = std::min( lower[ dim ], landmarks[ indices[ i ] ][ dim ] );
+      upper[ dim ] = std::max( upper[ dim ], landmarks[ indices[ i ] ][ dim ] );
+    }
+  }
+  unsigned int axis = 0;
+  for( unsigned int dim = 1; dim < NDimensions; ++dim )
+  {
+    if( upper[ dim ] - lower[ dim ] > upper[ axis ] - lower[ axis ] )
+    {
+      axis = dim;
+    }
+  }
+
+  /** Compare the landmarks along that axis. */
+  struct AxisCompare
+  {
+    const std::vector< InputPointType > * m_Landmarks;
+    unsigned int                          m_Axis;
+    bool operator()( const unsigned long a, const unsigned long b ) const
+    {
+      return ( *this->m_Landmarks )[ a ][ this->m_Axis ] < ( *this->m_Landmarks )[ b ][ this->m_Axis ];
+    }
+  };
+  AxisCompare compare;
+  compare.m_Landmarks = &landmarks;
+  compare.m_Axis      = axis;
+
+  const unsigned long middle = begin + ( end - begin ) / 2;
+  std::nth_element( indices.begin() + begin, indices.begin() + middle, indices.begin() + end, compare );
+  PartitionLandmarks( landmarks, indices, begin, middle, blockSize, blocks );
+  PartitionLandmarks( landmarks, indices, middle, end, blockSize, blocks );
+
+} // end PartitionLandmarks()
+
+
+/**
+ * ******************* ComputeBlockJacobiPreconditioner *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::ComputeBlockJacobiPreconditioner( const std::vector< InputPointType > & landmarks,
+  const std::vector< InputPointType > & normalizedLandmarks,
+  const std::vector< GMatrixType > & reflexiveG,
+  BlockJacobiPreconditionerType & preconditioner ) const
+{
+  const unsigned long numberOfLandmarks = landmarks.size();
+  const unsigned long numberOfRows      = NDimensions * ( numberOfLandmarks + NDimensions + 1 );
+  const unsigned long affineStart       = numberOfLandmarks * NDimensions;
+  const unsigned int  affineSize        = NDimensions * ( NDimensions + 1 );
+
+  /** Group nearby landmarks. */
+  std::vector< unsigned long > indices( numberOfLandmarks );
+  for( unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd )
+  {
+    indices[ lnd ] = lnd;
+  }
+  preconditioner.m_Blocks.clear();
+  if( numberOfLandmarks > 0 )
+  {
+    PartitionLandmarks( landmarks, indices, 0, numberOfLandmarks,
+      this->m_IterativeSolverPreconditionerBlockSize, preconditioner.m_Blocks );
+  }
+
+  /** Invert the diagonal blocks of K, with the absolute values of their
+   * eigenvalues. Tiny eigenvalues are clamped, and a zero block, e.g. of a
+   * single landmark without stiffness, is replaced by the identity.
+   */
+  preconditioner.m_BlockInverses.resize( preconditioner.m_Blocks.size() );
+  GMatrixType G;
+  for( std::size_t block = 0; block < preconditioner.m_Blocks.size(); ++block )
+  {
+    const std::vector< unsigned long > & members = preconditioner.m_Blocks[ block ];
+    const unsigned int                   size    = members.size() * NDimensions;
+    vnl_matrix< TScalarType >            KBlock( size, size );
+    for( unsigned int i = 0; i < members.size(); ++i )
+    {
+      for( unsigned int j = 0; j < members.size(); ++j )
+      {
+        if( i == j )
+        {
+          G = reflexiveG[ members[ i ] ];
+        }
+        else
+        {
+          this->ComputeG( landmarks[ members[ i ] ] - landmarks[ members[ j ] ], G );
+        }
+        for( unsigned int dim = 0; dim < NDimensions; ++dim )
+        {
+          for( unsigned int odim = 0; odim < NDimensions; ++odim )
+          {
+            KBlock( i * NDimensions + dim, j * NDimensions + odim ) = G( dim, odim );
+          }
+        }
+      }
+    }
+
+    vnl_symmetric_eigensystem< TScalarType > eigenSystem( KBlock );
+    const TScalarType largest = eigenSystem.D.diagonal().inf_norm();
+    for( unsigned int k = 0; k < size; ++k )
+    {
+      eigenSystem.D( k, k ) = largest > 0.0
+        ? 1.0 / std::max( std::abs( eigenSystem.D( k, k ) ), static_cast< TScalarType >( 1e-8 * largest ) )
+        : 1.0;
+    }
+    preconditioner.m_BlockInverses[ block ] = eigenSystem.recompose();
+  }
+
+  /** The Schur complement S = P^T M_K^{-1} P of the affine rows. Column c
+   * of P is the landmark part of L applied to the unit vector of affine
+   * row c, computed with a product like in ComputeLMatrixProduct().
+   */
+  std::vector< vnl_vector< TScalarType > > columns( affineSize );
+  std::vector< vnl_vector< TScalarType > > preconditionedColumns( affineSize );
+  for( unsigned int c = 0; c < affineSize; ++c )
+  {
+    const unsigned int odim = c % NDimensions;
+    const unsigned int j    = c / NDimensions;
+    columns[ c ].set_size( numberOfRows );
+    columns[ c ].fill( 0.0 );
+    for( unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd )
+    {
+      columns[ c ][ lnd * NDimensions + odim ] = j < NDimensions ? normalizedLandmarks[ lnd ][ j ] : 1.0;
+    }
+    this->ApplyBlockJacobiPreconditioner( preconditioner, columns[ c ], preconditionedColumns[ c ], true );
+  }
+  vnl_matrix< TScalarType > S( affineSize, affineSize );
+  for( unsigned int c1 = 0; c1 < affineSize; ++c1 )
+  {
+    for( unsigned int c2 = 0; c2 < affineSize; ++c2 )
+    {
+      TScalarType sum = 0.0;
+      for( unsigned long i = 0; i < affineStart; ++i )
+      {
+        sum += columns[ c1 ][ i ] * preconditionedColumns[ c2 ][ i ];
+      }
+      S( c1, c2 ) = sum;
+    }
+  }
+
+  /** S is singular when the landmarks are e.g. coplanar; clamp as above. */
+  vnl_symmetric_eigensystem< TScalarType > eigenSystem( S );
+  const TScalarType largest = eigenSystem.D.diagonal().inf_norm();
+  for( unsigned int k = 0; k < affineSize; ++k )
+  {
+    eigenSystem.D( k, k ) = largest > 0.0
+      ? 1.0 / std::max( std::abs( eigenSystem.D( k, k ) ), static_cast< TScalarType >( 1e-12 * largest ) )
+      : 1.0;
+  }
+  preconditioner.m_AffineInverse = eigenSystem.recompose();
+
+} // end ComputeBlockJacobiPreconditioner()
+
+
+/**
+ * ******************* ApplyBlockJacobiPreconditioner *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::ApplyBlockJacobiPreconditioner( const BlockJacobiPreconditionerType & preconditioner,
+  const vnl_vector< TScalarType > & input, vnl_vector< TScalarType > & output,
+  const bool landmarkRowsOnly ) const
+{
+  output.set_size( input.size() );
+  output.fill( 0.0 );
+
+  /** The landmark rows, block by block. */
+  for( std::size_t block = 0; block < preconditioner.m_Blocks.size(); ++block )
+  {
+    const std::vector< unsigned long > & members = preconditioner.m_Blocks[ block ];
+    const vnl_matrix< TScalarType > &    inverse = preconditioner.m_BlockInverses[ block ];
+    for( unsigned int i = 0; i < members.size(); ++i )
+    {
+      for( unsigned int dim = 0; dim < NDimensions; ++dim )
+      {
+        const TScalarType * inverseRow = inverse[ i * NDimensions + dim ];
+        TScalarType         sum        = 0.0;
+        for( unsigned int j = 0; j < members.size(); ++j )
+        {
+          const TScalarType * inputj = input.data_block() + members[ j ] * NDimensions;
+          for( unsigned int odim = 0; odim < NDimensions; ++odim )
+          {
+            sum += inverseRow[ j * NDimensions + odim ] * inputj[ odim ];
+          }
+        }
+        output[ members[ i ] * NDimensions + dim ] = sum;
+      }
+    }
+  }
+  if( landmarkRowsOnly )
+  {
+    return;
+  }
+
+  /** The affine rows. */
+  const unsigned long affineStart = input.size() - NDimensions * ( NDimensions + 1 );
+  const vnl_matrix< TScalarType > & affineInverse = preconditioner.m_AffineInverse;
+  for( unsigned int c1 = 0; c1 < affineInverse.rows(); ++c1 )
+  {
+    TScalarType sum = 0.0;
+    for( unsigned int c2 = 0; c2 < affineInverse.cols(); ++c2 )
+    {
+      sum += affineInverse( c1, c2 ) * input[ affineStart + c2 ];
+    }
+    output[ affineStart + c1 ] = sum;
+  }
+
+} // end ApplyBlockJacobiPreconditioner()
+
+
+/**
+ * ******************* ComputeLMatrixProduct *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::ComputeLMatrixProduct( ThreaderType * threader, LMatrixProductType & product,
+  const vnl_vector< TScalarType > & input, vnl_vector< TScalarType > & output ) const
+{
+  const std::vector< InputPointType > & normalizedLandmarks = *product.st_NormalizedLandmarks;
+  const unsigned long numberOfLandmarks = normalizedLandmarks.size();
+  const unsigned long affineStart       = numberOfLandmarks * NDimensions;
+  const unsigned long translationStart  = affineStart + NDimensions * NDimensions;
+
+  /** The landmark rows, K input_K + P input_P, in parallel. */
+  product.st_Input  = input.data_block();
+  product.st_Output = output.data_block();
+  threader->SetSingleMethod( Self::LMatrixProductThreaderCallback, &product );
+  threader->SingleMethodExecute();
+
+  /** The affine rows, P^T input_K. */
+  for( unsigned long i = affineStart; i < output.size(); ++i )
+  {
+    output[ i ] = 0.0;
+  }
+  for( unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd )
+  {
+    for( unsigned int odim = 0; odim < NDimensions; ++odim )
+    {
+      const TScalarType value = input[ lnd * NDimensions + odim ];
+      for( unsigned int j = 0; j < NDimensions; ++j )
+      {
+        output[ affineStart + j * NDimensions + odim ] += normalizedLandmarks[ lnd ][ j ] * value;
+      }
+      output[ translationStart + odim ] += value;
+    }
+  }
+
+} // end ComputeLMatrixProduct()
+
+
+/**
+ * ******************* LMatrixProductThreaderCallback *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+ITK_THREAD_RETURN_TYPE
+KernelTransform2< TScalarType, NDimensions >
+::LMatrixProductThreaderCallback( void * arg )
+{
+  ThreadInfoType *           infoStruct  = static_cast< ThreadInfoType * >( arg );
+  const ThreadIdType         threadId    = infoStruct->ThreadID;
+  const ThreadIdType         nrOfThreads = infoStruct->NumberOfThreads;
+  const LMatrixProductType * product     = static_cast< LMatrixProductType * >( infoStruct->UserData );
+
+  const std::vector< InputPointType > & landmarks           = *product->st_Landmarks;
+  const std::vector< InputPointType > & normalizedLandmarks = *product->st_NormalizedLandmarks;
+  const std::vector< GMatrixType > &    reflexiveG          = *product->st_ReflexiveG;
+  const TScalarType *                   input               = product->st_Input;
+  TScalarType *                         output              = product->st_Output;
+
+  /** Each thread computes a contiguous block of landmark rows. */
+  const unsigned long numberOfLandmarks = landmarks.size();
+  const unsigned long chunk             = ( numberOfLandmarks + nrOfThreads - 1 ) / nrOfThreads;
+  const unsigned long begin             = std::min( numberOfLandmarks, threadId * chunk );
+  const unsigned long end               = std::min( numberOfLandmarks, begin + chunk );
+  const TScalarType * affineInput       = input + numberOfLandmarks * NDimensions;
+
+  GMatrixType G;
+  for( unsigned long i = begin; i < end; ++i )
+  {
+    vnl_vector_fixed< TScalarType, NDimensions > sum( 0.0 );
+
+    /** The block row of K. */
+    for( unsigned long j = 0; j < numberOfLandmarks; ++j )
+    {
+      if( j == i )
+      {
+        G = reflexiveG[ i ];
+      }
+      else
+      {
+        product->st_Self->ComputeG( landmarks[ i ] - landmarks[ j ], G );
+      }
+      const TScalarType * inputj = input + j * NDimensions;
+      for( unsigned int dim = 0; dim < NDimensions; ++dim )
+      {
+        for( unsigned int odim = 0; odim < NDimensions; ++odim )
+        {
+          sum[ dim ] += G( dim, odim ) * inputj[ odim ];
+        }
+      }
+    }
+
+    /** The block row of P. */
+    for( unsigned int j = 0; j < NDimensions; ++j )
+    {
+      for( unsigned int dim = 0; dim < NDimensions; ++dim )
+      {
+        sum[ dim ] += normalizedLandmarks[ i ][ j ] * affineInput[ j * NDimensions + dim ];
+      }
+    }
+    for( unsigned int dim = 0; dim < NDimensions; ++dim )
+    {
+      output[ i * NDimensions + dim ] = sum[ dim ] + affineInput[ NDimensions * NDimensions + dim ];
+    }
+  }
+
+#if ITK_VERSION_MAJOR >= 5
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+#else
+  return ITK_THREAD_RETURN_VALUE;
+#endif
+
+} // end LMatrixProductThreaderCallback()
+
 
 /**
  * ******************* ComputeL *******************
@@ -666,8 +1229,12 @@ KernelTransform2< TScalarType, NDimensions >
   this->m_LInverseComputed             = false;
   this->m_LMatrixDecompositionComputed = false;
 
-  // you must recompute L and Linv - this does not require the targ lms
-  this->ComputeLInverse();
+  // you must recompute L and Linv - this does not require the targ lms.
+  // The iterative method never forms L.
+  if( this->m_MatrixInversionMethod != "Iterative" )
+  {
+    this->ComputeLInverse();
+  }
 
 } // end SetFixedParameters()
 
@@ -754,6 +1321,12 @@ KernelTransform2< TScalarType, NDimensions >
 ::GetJacobian( const InputPointType & p, JacobianType & jac,
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
 {
+  if( this->m_MatrixInversionMethod == "Iterative" )
+  {
+    itkExceptionMacro( << "The Jacobian requires the inverse of the L matrix, "
+                       << "which is not computed by the Iterative matrix inversion method." );
+  }
+
   const unsigned long numberOfLandmarks = this->m_SourceLandmarks->GetNumberOfPoints();
   jac.SetSize( NDimensions, numberOfLandmarks * NDimensions );
   jac.Fill( 0.0 );
@@ -923,6 +1496,16 @@ KernelTransform2< TScalarType, NDimensions >
      << this->m_PoissonRatio << std::endl;
   os << indent << "MatrixInversionMethod: "
      << this->m_MatrixInversionMethod << std::endl;
+  os << indent << "IterativeSolverMaximumNumberOfIterations: "
+     << this->m_IterativeSolverMaximumNumberOfIterations << std::endl;
+  os << indent << "IterativeSolverTolerance: "
+     << this->m_IterativeSolverTolerance << std::endl;
+  os << indent << "IterativeSolverPreconditionerBlockSize: "
+     << this->m_IterativeSolverPreconditionerBlockSize << std::endl;
+  os << indent << "IterativeSolverNumberOfIterations: "
+     << this->m_IterativeSolverNumberOfIterations << std::endl;
+  os << indent << "IterativeSolverRelativeResidual: "
+     << this->m_IterativeSolverRelativeResidual << std::endl;
 
   /** Just print the sizes of these matrices, not their contents. */
   os << indent << "LMatrix: " << this->m_LMatrix.rows()
@@ -23,6 +23,7 @@
 
 #include "elxBaseComponentSE.h"
 #include "itkAdvancedImageToImageMetric.h"
+#include "itkSingleValuedPointSetToPointSetMetric.h"
 #include "itkImageGridSampler.h"
 #include "itkPointSet.h"
 
@@ -63,6 +64,11 @@ namespace elastix
  *    CheckNumberOfSamples. \n
  *    example: <tt>(RequiredRatioOfValidSamples 0.1)</tt> \n
  *    The default is 0.25.
+ * \parameter UseMultiThreadingForMetrics: Whether the metric evaluates its samples
+ *    or points multi-threaded. Applies to the advanced image metrics and the
+ *    point-set metrics. Can be given for each resolution. \n
+ *    example: <tt>(UseMultiThreadingForMetrics "false")</tt> \n
+ *    The default is true.
  *
  * \ingroup Metrics
  * \ingroup ComponentBaseClasses
@@ -123,6 +129,8 @@ public:
     MovingImageDimension, MovingImageDimension,
     CoordinateRepresentationType, CoordinateRepresentationType,
     CoordinateRepresentationType > >                MovingPointSetType;
+  typedef itk::SingleValuedPointSetToPointSetMetric<
+    FixedPointSetType, MovingPointSetType >          PointSetMetricType;
 
   /** Typedefs for sampler support. */
   typedef typename AdvancedMetricType::ImageSamplerType ImageSamplerBaseType;
@@ -213,6 +221,14 @@ protected:
 
   /** \todo the method GetExactDerivative could as well be added here. */
 
+  /** Read UseMultiThreadingForMetrics and the -threads command line argument,
+   * and pass them to a metric that supports multi-threading, such as the
+   * AdvancedMetricType and the PointSetMetricType.
+   */
+  template< class TMultiThreadedMetric >
+  void SetMultiThreadingParameters(
+    TMultiThreadedMetric * metric, const unsigned int level ) const;
+
   bool                             m_ShowExactMetricValue;
   ExactMetricImageSamplerPointer   m_ExactMetricSampler;
   MeasureType                      m_CurrentExactMetricValue;
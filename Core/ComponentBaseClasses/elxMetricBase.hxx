@@ -165,26 +165,53 @@ MetricBase< TElastix >
     }
 
     /** Should the metric use multi-threading? */
-    bool useMultiThreading = true;
-    this->GetConfiguration()->ReadParameter( useMultiThreading,
-      "UseMultiThreadingForMetrics", this->GetComponentLabel(), level, 0 );
-
-    thisAsAdvanced->SetUseMultiThread( useMultiThreading );
-    if( useMultiThreading )
-    {
-      std::string tmp = this->m_Configuration->GetCommandLineArgument( "-threads" );
-      if( tmp != "" )
-      {
-        const unsigned int nrOfThreads = atoi( tmp.c_str() );
-        thisAsAdvanced->SetNumberOfThreads( nrOfThreads );
-      }
-    }
+    this->SetMultiThreadingParameters( thisAsAdvanced, level );
 
   } // end advanced metric
 
+  /** Cast this to PointSetMetricType. */
+  PointSetMetricType * thisAsPointSetMetric
+    = dynamic_cast< PointSetMetricType * >( this );
+
+  /** Point-set metrics can evaluate their points multi-threaded. */
+  if( thisAsPointSetMetric != 0 )
+  {
+    /** Should the metric use multi-threading? */
+    this->SetMultiThreadingParameters( thisAsPointSetMetric, level );
+
+  } // end point-set metric
+
 } // end BeforeEachResolutionBase()
 
 
+/**
+ * ******************* SetMultiThreadingParameters ******************
+ */
+
+template< class TElastix >
+template< class TMultiThreadedMetric >
+void
+MetricBase< TElastix >
+::SetMultiThreadingParameters( TMultiThreadedMetric * metric, const unsigned int level ) const
+{
+  bool useMultiThreading = true;
+  this->GetConfiguration()->ReadParameter( useMultiThreading,
+    "UseMultiThreadingForMetrics", this->GetComponentLabel(), level, 0 );
+
+  metric->SetUseMultiThread( useMultiThreading );
+  if( useMultiThreading )
+  {
+    std::string tmp = this->m_Configuration->GetCommandLineArgument( "-threads" );
+    if( tmp != "" )
+    {
+      const unsigned int nrOfThreads = atoi( tmp.c_str() );
+      metric->SetNumberOfThreads( nrOfThreads );
+    }
+  }
+
+} // end SetMultiThreadingParameters()
+
+
 /**
  * ******************* AfterEachIterationBase ******************
  */
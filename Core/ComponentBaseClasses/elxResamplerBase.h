@@ -23,8 +23,13 @@
 
 #include "elxBaseComponentSE.h"
 #include "itkResampleImageFilter.h"
+#include "itkMultiInputResampleImageFilter.h"
 #include "elxProgressCommand.h"
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 namespace elastix
 {
 /**
@@ -59,12 +64,29 @@ namespace elastix
  *    or from float to char).\n
  *    Choose from (unsigned) char, (unsigned) short, float, double, etc.\n
  *    example: <tt>(ResultImagePixelType "unsigned short")</tt> \n
- *    The default is "short".
+ *    The default is "short". When transformix is given several input images
+ *    (-in0, -in1, ...), entry i gives the pixel type of result image i, and
+ *    entry 0 is used for images without an entry of their own.\n
+ *    example: <tt>(ResultImagePixelType "short" "float" "unsigned char")</tt> \n
+ * \parameter FinalBSplineInterpolationOrder: when transformix is given several
+ *    input images, input image 0 is interpolated by the ResampleInterpolator;
+ *    input image i > 0 is interpolated with the B-spline order given by
+ *    entry i of this parameter (0: nearest neighbour, 1: linear).\n
+ *    example: <tt>(FinalBSplineInterpolationOrder 3 1 0 0)</tt> \n
+ *    Without an entry i, input image i is interpolated like input image 0:
+ *    nearest neighbour, linear, or B-spline of the same order, depending on
+ *    the ResampleInterpolator. So a label image given as -in1 is only
+ *    interpolated with a B-spline when input image 0 is. The chosen
+ *    interpolator of each image is written to the log.
  * \parameter CompressResultImage: parameter to set if (lossless) compression
  *    of the written image is desired.\n
  *    example: <tt>(CompressResultImage "true")</tt> \n
  *    The default is "false".
  *
+ * Several input images are resampled in a single pass over the output
+ * grid, see ResampleAndWriteResultImages(): each output point is mapped
+ * by the transform once, and the mapped point is used for all images.
+ *
  * \ingroup Resamplers
  * \ingroup ComponentBaseClasses
  */
@@ -110,6 +132,11 @@ public:
   typedef typename ITKBaseType::OriginPointType  OriginPointType;
   typedef typename ITKBaseType::PixelType        OutputPixelType;
 
+  /** Typedef for resampling several input images in one pass. */
+  typedef itk::MultiInputResampleImageFilter<
+    InputImageType, OutputImageType, CoordRepType >  MultiInputResamplerType;
+  typedef typename MultiInputResamplerType::Pointer MultiInputResamplerPointer;
+
   /** Typedef that is used in the elastix dll version. */
   typedef typename ElastixType::ParameterMapType ParameterMapType;
 
@@ -174,13 +201,27 @@ public:
   /** Function to perform resample and write the result output image to a file. */
   virtual void ResampleAndWriteResultImage( const char * filename, const bool & showProgress = true );
 
-  /** Function to write the result output image to a file. */
+  /** Function to resample all input images in one pass, and write result
+   * image i to filenames[ i ].
+   */
+  virtual void ResampleAndWriteResultImages(
+    const std::vector< std::string > & filenames, const bool & showProgress = true );
+
+  /** Function to write the result output image to a file. The
+   * resultImageIndex selects the entry of the ResultImagePixelType.
+   */
   virtual void WriteResultImage( OutputImageType * imageimage,
-    const char * filename, const bool & showProgress = true );
+    const char * filename, const bool & showProgress = true,
+    const unsigned int resultImageIndex = 0 );
 
   /** Function to create the result image in the format of an itk::Image. */
   virtual void CreateItkResultImage( void );
 
+  /** Function to create the result images of all input images, resampled
+   * in one pass, in the format of itk::Images.
+   */
+  virtual void CreateItkResultImages( void );
+
 protected:
 
   /** The constructor. */
@@ -191,6 +232,26 @@ protected:
   /** Method that sets the transform, the interpolator and the inputImage. */
   virtual void SetComponents( void );
 
+  /** Resample all input images in one pass. */
+  virtual MultiInputResamplerPointer ResampleResultImages( const bool & showProgress );
+
+  /** Create the interpolator of input image idx > 0, with the order of the
+   * idx-th entry of FinalBSplineInterpolationOrder, or else the order of the
+   * ResampleInterpolator.
+   */
+  virtual typename InterpolatorType::Pointer CreateResultImageInterpolator(
+    const unsigned int idx ) const;
+
+  /** Cast a result image to the ResultImagePixelType of result image idx. */
+  virtual itk::DataObject::Pointer CastResultImage(
+    OutputImageType * image, const unsigned int idx ) const;
+
+  /** Get the default pixel value of result image idx: the idx-th entry of
+   * DefaultPixelValue, or else the first, clamped to the range of both the
+   * ResultImagePixelType of result image idx and the OutputPixelType.
+   */
+  virtual OutputPixelType GetResultImageDefaultPixelValue( const unsigned int idx ) const;
+
   /** Variable that defines to print the progress or not. */
   bool m_ShowProgress;
 
@@ -204,6 +265,15 @@ private:
   /** Release memory. */
   void ReleaseMemory( void );
 
+  /** Clamp a value to the range of TPixel. */
+  template< class TPixel >
+  static double ClampToPixelTypeRange( const double value )
+  {
+    return std::min( std::max( value,
+      static_cast< double >( itk::NumericTraits< TPixel >::NonpositiveMin() ) ),
+      static_cast< double >( itk::NumericTraits< TPixel >::max() ) );
+  }
+
 };
 
 } // end namespace elastix
@@ -23,6 +23,9 @@
 #include "itkImageFileCastWriter.h"
 #include "itkChangeInformationImageFilter.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
 #include "itkTimeProbe.h"
 
 namespace elastix
@@ -376,7 +379,8 @@ template< class TElastix >
 void
 ResamplerBase< TElastix >
 ::WriteResultImage( OutputImageType * image,
-  const char * filename, const bool & showProgress )
+  const char * filename, const bool & showProgress,
+  const unsigned int resultImageIndex )
 {
   /** Check if ResampleInterpolator is the RayCastResampleInterpolator  */
   typedef itk::AdvancedRayCastInterpolateImageFunction<  InputImageType,
@@ -397,7 +401,7 @@ ResamplerBase< TElastix >
   /** Read output pixeltype from parameter the file. Replace possible " " with "_". */
   std::string resultImagePixelType = "short";
   this->m_Configuration->ReadParameter( resultImagePixelType,
-    "ResultImagePixelType", 0, false );
+    "ResultImagePixelType", "", resultImageIndex, 0, false );
   std::basic_string< char >::size_type       pos  = resultImagePixelType.find( " " );
   const std::basic_string< char >::size_type npos = std::basic_string< char >::npos;
   if( pos != npos ) { resultImagePixelType.replace( pos, 1, "_" ); }
@@ -513,10 +517,34 @@ ResamplerBase< TElastix >
       ( const_cast< RayCastInterpolatorType * >( testptr ) )->GetTransform() );
   }
 
-  /** Read output pixeltype from parameter the file. Replace possible " " with "_". */
+  /** Cast the result image to the desired pixel type. */
+  resultImage = this->CastResultImage( this->GetAsITKBaseType()->GetOutput(), 0 );
+
+  //put image in container
+  this->m_Elastix->SetResultImage( resultImage );
+
+#ifndef _ELASTIX_BUILD_LIBRARY
+  /** Disconnect from the resampler. */
+  progressObserver->DisconnectObserver( this->GetAsITKBaseType() );
+#endif
+} // end CreateItkResultImage()
+
+
+/*
+ * ******************* CastResultImage ********************
+ */
+
+template< class TElastix >
+itk::DataObject::Pointer
+ResamplerBase< TElastix >
+::CastResultImage( OutputImageType * image, const unsigned int idx ) const
+{
+  itk::DataObject::Pointer resultImage;
+
+  /** Read output pixeltype from parameter the file. */
   std::string resultImagePixelType = "short";
   this->m_Configuration->ReadParameter( resultImagePixelType,
-    "ResultImagePixelType", 0, false );
+    "ResultImagePixelType", "", idx, 0, false );
 
   /** Typedef's for writing the output image. */
   typedef itk::ChangeInformationImageFilter<
@@ -531,7 +559,7 @@ ResamplerBase< TElastix >
   bool          retdc = this->GetElastix()->GetOriginalFixedImageDirection( originalDirection );
   infoChanger->SetOutputDirection( originalDirection );
   infoChanger->SetChangeDirection( retdc & !this->GetElastix()->GetUseDirectionCosines() );
-  infoChanger->SetInput( this->GetAsITKBaseType()->GetOutput() );
+  infoChanger->SetInput( image );
 
   typedef itk::CastImageFilter< InputImageType,
     itk::Image< char, InputImageType::ImageDimension > >            CastFilterChar;
@@ -634,14 +662,302 @@ ResamplerBase< TElastix >
       << "\"." );
   }
 
-  //put image in container
-  this->m_Elastix->SetResultImage( resultImage );
+  return resultImage;
+
+} // end CastResultImage()
+
+
+/**
+ * ******************* ResampleResultImages ********************
+ */
+
+template< class TElastix >
+typename ResamplerBase< TElastix >::MultiInputResamplerPointer
+ResamplerBase< TElastix >
+::ResampleResultImages( const bool & showProgress )
+{
+  /** The ray cast interpolator maps the points itself, so its
+   * mapping cannot be shared with other images.
+   */
+  typedef itk::AdvancedRayCastInterpolateImageFunction<  InputImageType,
+    CoordRepType > RayCastInterpolatorType;
+  if( dynamic_cast< const RayCastInterpolatorType * >(
+    this->GetAsITKBaseType()->GetInterpolator() ) )
+  {
+    itkExceptionMacro( << "The RayCastResampleInterpolator does not support "
+                       << "resampling several input images at once." );
+  }
+
+  /** Resample onto the same grid as the single image resampler. */
+  const ITKBaseType *        resampler      = this->GetAsITKBaseType();
+  MultiInputResamplerPointer multiResampler = MultiInputResamplerType::New();
+  multiResampler->SetTransform( resampler->GetTransform() );
+  multiResampler->SetSize( resampler->GetSize() );
+  multiResampler->SetOutputStartIndex( resampler->GetOutputStartIndex() );
+  multiResampler->SetOutputSpacing( resampler->GetOutputSpacing() );
+  multiResampler->SetOutputOrigin( resampler->GetOutputOrigin() );
+  multiResampler->SetOutputDirection( resampler->GetOutputDirection() );
+  multiResampler->SetDefaultPixelValue( resampler->GetDefaultPixelValue() );
+
+  /** Input image 0 uses the ResampleInterpolator, the others their own.
+   * Each image gets the default pixel value of its own result image.
+   */
+  const unsigned int numberOfImages = this->m_Elastix->GetNumberOfMovingImages();
+  for( unsigned int i = 0; i < numberOfImages; ++i )
+  {
+    multiResampler->SetInput( i, this->m_Elastix->GetMovingImage( i ) );
+    multiResampler->SetDefaultPixelValue( i, this->GetResultImageDefaultPixelValue( i ) );
+    if( i == 0 )
+    {
+      multiResampler->SetInterpolator( i, dynamic_cast< InterpolatorType * >(
+          this->m_Elastix->GetElxResampleInterpolatorBase() ) );
+      elxout << "  Input image 0 is interpolated by the ResampleInterpolator "
+             << this->m_Elastix->GetElxResampleInterpolatorBase()->elxGetClassName() << "." << std::endl;
+    }
+    else
+    {
+      multiResampler->SetInterpolator( i, this->CreateResultImageInterpolator( i ) );
+    }
+  }
 
+  /** Add a progress observer to the resampler. */
 #ifndef _ELASTIX_BUILD_LIBRARY
+  typename ProgressCommandType::Pointer progressObserver = ProgressCommandType::New();
+  if( showProgress )
+  {
+    progressObserver->ConnectObserver( multiResampler );
+    progressObserver->SetStartString( "  Progress: " );
+    progressObserver->SetEndString( "%" );
+  }
+#endif
+
+  /** Do the resampling. */
+  try
+  {
+    multiResampler->Update();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    /** Add information to the exception. */
+    excp.SetLocation( "ResamplerBase - ResampleResultImages()" );
+    std::string err_str = excp.GetDescription();
+    err_str += "\nError occurred while resampling the images.\n";
+    excp.SetDescription( err_str );
+
+    /** Pass the exception to an higher level. */
+    throw excp;
+  }
+
   /** Disconnect from the resampler. */
-  progressObserver->DisconnectObserver( this->GetAsITKBaseType() );
+#ifndef _ELASTIX_BUILD_LIBRARY
+  if( showProgress )
+  {
+    progressObserver->DisconnectObserver( multiResampler );
+  }
 #endif
-} // end CreateItkResultImage()
+
+  return multiResampler;
+
+} // end ResampleResultImages()
+
+
+/**
+ * ******************* CreateResultImageInterpolator ********************
+ */
+
+template< class TElastix >
+typename ResamplerBase< TElastix >::InterpolatorType::Pointer
+ResamplerBase< TElastix >
+::CreateResultImageInterpolator( const unsigned int idx ) const
+{
+  typedef itk::NearestNeighborInterpolateImageFunction<
+    InputImageType, CoordRepType >                     NearestNeighborInterpolatorType;
+  typedef itk::LinearInterpolateImageFunction<
+    InputImageType, CoordRepType >                     LinearInterpolatorType;
+  typedef itk::BSplineInterpolateImageFunction<
+    InputImageType, CoordRepType, double >             BSplineInterpolatorType;
+  typedef itk::BSplineInterpolateImageFunction<
+    InputImageType, CoordRepType, float >              BSplineInterpolatorFloatType;
+
+  /** By default, interpolate like input image 0, with the order of the
+   * ResampleInterpolator. Only for other interpolators the first entry of
+   * FinalBSplineInterpolationOrder is used.
+   */
+  const InterpolatorType * resampleInterpolator = this->GetAsITKBaseType()->GetInterpolator();
+  unsigned int             splineOrder          = 3;
+  if( dynamic_cast< const NearestNeighborInterpolatorType * >( resampleInterpolator ) )
+  {
+    splineOrder = 0;
+  }
+  else if( dynamic_cast< const LinearInterpolatorType * >( resampleInterpolator ) )
+  {
+    splineOrder = 1;
+  }
+  else if( const BSplineInterpolatorType * bspline
+    = dynamic_cast< const BSplineInterpolatorType * >( resampleInterpolator ) )
+  {
+    splineOrder = bspline->GetSplineOrder();
+  }
+  else if( const BSplineInterpolatorFloatType * bsplineFloat
+    = dynamic_cast< const BSplineInterpolatorFloatType * >( resampleInterpolator ) )
+  {
+    splineOrder = bsplineFloat->GetSplineOrder();
+  }
+  else
+  {
+    this->m_Configuration->ReadParameter( splineOrder,
+      "FinalBSplineInterpolationOrder", "", 0, -1, false );
+  }
+
+  /** An entry of this image itself overrides the default. */
+  const bool hasOwnEntry = this->m_Configuration->ReadParameter( splineOrder,
+    "FinalBSplineInterpolationOrder", "", idx, -1, false );
+
+  typename InterpolatorType::Pointer interpolator;
+  if( splineOrder == 0 )
+  {
+    interpolator = NearestNeighborInterpolatorType::New().GetPointer();
+  }
+  else if( splineOrder == 1 )
+  {
+    interpolator = LinearInterpolatorType::New().GetPointer();
+  }
+  else
+  {
+    typename BSplineInterpolatorType::Pointer bsplineInterpolator = BSplineInterpolatorType::New();
+    bsplineInterpolator->SetSplineOrder( splineOrder );
+    interpolator = bsplineInterpolator.GetPointer();
+  }
+
+  /** Report the choice. */
+  elxout << "  Input image " << idx << " is interpolated by a "
+         << interpolator->GetNameOfClass() << " of order " << splineOrder
+         << ( hasOwnEntry ? ", from FinalBSplineInterpolationOrder." : ", like input image 0." )
+         << std::endl;
+
+  return interpolator;
+
+} // end CreateResultImageInterpolator()
+
+
+/**
+ * ******************* GetResultImageDefaultPixelValue ********************
+ */
+
+template< class TElastix >
+typename ResamplerBase< TElastix >::OutputPixelType
+ResamplerBase< TElastix >
+::GetResultImageDefaultPixelValue( const unsigned int idx ) const
+{
+  /** Read the entry of this image, falling back to the first entry. */
+  double defaultPixelValue = itk::NumericTraits< double >::Zero;
+  this->m_Configuration->ReadParameter( defaultPixelValue,
+    "DefaultPixelValue", "", idx, 0, false );
+
+  /** Clamp it to the range of the pixel type the result image is cast to. */
+  std::string resultImagePixelType = "short";
+  this->m_Configuration->ReadParameter( resultImagePixelType,
+    "ResultImagePixelType", "", idx, 0, false );
+  std::replace( resultImagePixelType.begin(), resultImagePixelType.end(), '_', ' ' );
+
+  double clampedValue = defaultPixelValue;
+  if( resultImagePixelType.compare( "char" ) == 0 )
+  {
+    clampedValue = ClampToPixelTypeRange< char >( defaultPixelValue );
+  }
+  else if( resultImagePixelType.compare( "unsigned char" ) == 0 )
+  {
+    clampedValue = ClampToPixelTypeRange< unsigned char >( defaultPixelValue );
+  }
+  else if( resultImagePixelType.compare( "short" ) == 0 )
+  {
+    clampedValue = ClampToPixelTypeRange< short >( defaultPixelValue );
+  }
+  else if( resultImagePixelType.compare( "ushort" ) == 0 || resultImagePixelType.compare( "unsigned short" ) == 0 )
+  {
+    clampedValue = ClampToPixelTypeRange< unsigned short >( defaultPixelValue );
+  }
+  else if( resultImagePixelType.compare( "int" ) == 0 )
+  {
+    clampedValue = ClampToPixelTypeRange< int >( defaultPixelValue );
+  }
+  else if( resultImagePixelType.compare( "unsigned int" ) == 0 )
+  {
+    clampedValue = ClampToPixelTypeRange< unsigned int >( defaultPixelValue );
+  }
+  else if( resultImagePixelType.compare( "long" ) == 0 )
+  {
+    clampedValue = ClampToPixelTypeRange< long >( defaultPixelValue );
+  }
+  else if( resultImagePixelType.compare( "unsigned long" ) == 0 )
+  {
+    clampedValue = ClampToPixelTypeRange< unsigned long >( defaultPixelValue );
+  }
+  else if( resultImagePixelType.compare( "float" ) == 0 )
+  {
+    clampedValue = ClampToPixelTypeRange< float >( defaultPixelValue );
+  }
+
+  /** The value is stored in the internal pixel type first. */
+  clampedValue = ClampToPixelTypeRange< OutputPixelType >( clampedValue );
+  if( clampedValue != defaultPixelValue )
+  {
+    xl::xout[ "warning" ] << "WARNING: DefaultPixelValue " << defaultPixelValue
+                          << " of result image " << idx << " is out of the range of its pixel type "
+                          << resultImagePixelType << ", and is clamped to " << clampedValue << "." << std::endl;
+  }
+
+  return static_cast< OutputPixelType >( clampedValue );
+
+} // end GetResultImageDefaultPixelValue()
+
+
+/**
+ * ******************* ResampleAndWriteResultImages ********************
+ */
+
+template< class TElastix >
+void
+ResamplerBase< TElastix >
+::ResampleAndWriteResultImages(
+  const std::vector< std::string > & filenames, const bool & showProgress )
+{
+  MultiInputResamplerPointer multiResampler = this->ResampleResultImages( showProgress );
+
+  /** Write each result image, with its own pixel type. */
+  const unsigned int numberOfImages
+    = std::min< unsigned int >( filenames.size(), multiResampler->GetNumberOfIndexedOutputs() );
+  for( unsigned int i = 0; i < numberOfImages; ++i )
+  {
+    this->WriteResultImage( multiResampler->GetOutput( i ),
+      filenames[ i ].c_str(), showProgress, i );
+  }
+
+} // end ResampleAndWriteResultImages()
+
+
+/**
+ * ******************* CreateItkResultImages ********************
+ */
+
+template< class TElastix >
+void
+ResamplerBase< TElastix >
+::CreateItkResultImages( void )
+{
+  MultiInputResamplerPointer multiResampler = this->ResampleResultImages( true );
+
+  /** Cast each result image to its own pixel type, and put it in the container. */
+  typedef typename ElastixType::DataObjectContainerType DataObjectContainerType;
+  typename DataObjectContainerType::Pointer resultImageContainer = DataObjectContainerType::New();
+  for( unsigned int i = 0; i < multiResampler->GetNumberOfIndexedOutputs(); ++i )
+  {
+    resultImageContainer->CreateElementAt( i )
+      = this->CastResultImage( multiResampler->GetOutput( i ), i );
+  }
+  this->m_Elastix->SetResultImageContainer( resultImageContainer );
+
+} // end CreateItkResultImages()
 
 
 /*
@@ -51,6 +51,25 @@ namespace elastix
  *   "Compose" by composition: \f$T(x) = T_1 ( T_0(x) )\f$.\n
  *   example: <tt>(HowToCombineTransforms "Add")</tt>\n
  *   Default: "Add".
+ * \parameter BakeInitialTransform: Whether to replace a nonlinear initial transform, for
+ *   example the result of previous B-spline registrations, by a single B-spline transform
+ *   that interpolates it on a grid covering the fixed image. This makes the evaluation of
+ *   the transform during the optimization and the resampling much cheaper, at the cost of
+ *   a small interpolation error, which is controlled by BakeInitialTransformGridSpacingInVoxels.
+ *   The transform parameter files still refer to the exact initial transforms.\n
+ *   example: <tt>(BakeInitialTransform "true")</tt>\n
+ *   Default: "false".
+ * \parameter BakeInitialTransformGridSpacingInVoxels: The grid spacing of the baked initial
+ *   transform, in voxels of the fixed image, for each dimension.\n
+ *   example: <tt>(BakeInitialTransformGridSpacingInVoxels 2.0 2.0 2.0)</tt>\n
+ *   Default: 4.0 for each dimension.
+ * \parameter BakeInitialTransformMaximumErrorInVoxels: The largest accepted distance between
+ *   the baked and the exact initial transform, in units of the smallest voxel spacing. The
+ *   distance is measured at the centres of the grid cells; if it exceeds this value, a warning
+ *   is given and the exact initial transform is used. Outside the fixed image domain, the exact
+ *   initial transform is always used.\n
+ *   example: <tt>(BakeInitialTransformMaximumErrorInVoxels 0.05)</tt>\n
+ *   Default: 0.1.
  *
  * \transformparameter UseDirectionCosines: Controls whether to use or ignore the
  * direction cosines (world matrix, transform matrix) set in the images.
@@ -108,6 +127,59 @@ namespace elastix
  * Default: "NoInitialTransform", which (obviously) means that there is no initial transform
  * to be loaded.
  *
+ * When the initial transforms form a chain of linear transforms (for example translation,
+ * rigid and affine), this chain is folded into a single matrix and offset before the
+ * registration and after reading a transform parameter file, such that each point is
+ * mapped by one matrix-vector product instead of one call per stage.
+ *
+ * \transformparameter BakeInitialTransform: Whether transformix should replace a nonlinear
+ * initial transform by a single B-spline transform that interpolates it on a grid covering the
+ * output image domain given by Size, Index, Spacing, Origin and Direction. See the
+ * corresponding elastix parameter.\n
+ * example: <tt>(BakeInitialTransform "true")</tt>\n
+ * Default: "false".
+ * \transformparameter BakeInitialTransformGridSpacingInVoxels: The grid spacing of the baked
+ * initial transform, in voxels of the output image, for each dimension.\n
+ * example: <tt>(BakeInitialTransformGridSpacingInVoxels 2.0 2.0 2.0)</tt>\n
+ * Default: 4.0 for each dimension.
+ * \transformparameter BakeInitialTransformMaximumErrorInVoxels: The largest accepted distance
+ * between the baked and the exact initial transform, in units of the smallest voxel spacing of
+ * the output image. See the corresponding elastix parameter.\n
+ * example: <tt>(BakeInitialTransformMaximumErrorInVoxels 0.05)</tt>\n
+ * Default: 0.1.
+ * \transformparameter InverseMaximumNumberOfIterations: The maximum number of Newton iterations
+ * per voxel when transformix computes the inverse displacement field (-inv all). Linear transforms
+ * are inverted exactly.\n
+ * example: <tt>(InverseMaximumNumberOfIterations 30)</tt>\n
+ * Default: 20.
+ * \transformparameter InverseTolerance: The inverse-consistency error |T(x) - y|, in physical
+ * units, at which the iteration for a voxel stops.\n
+ * example: <tt>(InverseTolerance 0.001)</tt>\n
+ * Default: 0.01.
+ * \transformparameter InverseCoarseningFactor: The inverse is first computed on a grid that is
+ * this many times coarser, to obtain the initial guess on the output grid. 1 disables this.\n
+ * example: <tt>(InverseCoarseningFactor 8)</tt>\n
+ * Default: 4.
+ * \transformparameter JacobianNumberOfStreamDivisions: The number of slabs in which transformix
+ * computes the spatial Jacobian determinant (-jac) and the spatial Jacobian (-jacmat), such that
+ * only one slab is held in memory at a time. The images are written slab by slab if the
+ * ResultImageFormat supports streamed writing (such as mhd), and at once otherwise.\n
+ * example: <tt>(JacobianNumberOfStreamDivisions 16)</tt>\n
+ * Default: 1.
+ * \transformparameter JacobianHistogramMinimum: The lower bound of the histogram of the spatial
+ * Jacobian determinant that is reported in the log for -jac. Smaller values are counted in the
+ * first bin.\n
+ * example: <tt>(JacobianHistogramMinimum -1.0)</tt>\n
+ * Default: 0.0.
+ * \transformparameter JacobianHistogramMaximum: The upper bound of this histogram. Larger values
+ * are counted in the last bin.\n
+ * example: <tt>(JacobianHistogramMaximum 4.0)</tt>\n
+ * Default: 2.0.
+ * \transformparameter JacobianNumberOfHistogramBins: The number of bins of this histogram.
+ * 0 disables the histogram.\n
+ * example: <tt>(JacobianNumberOfHistogramBins 40)</tt>\n
+ * Default: 20.
+ *
  * The command line arguments used by this class are:
  * \commandlinearg -t0: optional argument for elastix for specifying an initial transform
  *    parameter file. \n
@@ -122,6 +194,20 @@ namespace elastix
  *    It is also possible to deform all points, thereby generating a deformation field
  *    image. This is done by:\n
  *    example: <tt>-def all</tt> \n
+ * \commandlinearg -inv: optional argument for transformix for computing the displacement
+ *    field of the inverse transform, on the output image domain given by Size, Index,
+ *    Spacing, Origin and Direction. The mean and maximum inverse-consistency errors are
+ *    reported in the log.\n
+ *    example: <tt>-inv all</tt> \n
+ * \commandlinearg -jac: optional argument for transformix for computing the determinant of
+ *    the spatial Jacobian on the output image domain. With "all" the determinant image is
+ *    written, with "stats" only its statistics are reported in the log: the number of
+ *    voxels, minimum, maximum, mean, standard deviation, the fraction of voxels with a
+ *    determinant <= 0, and a histogram. The statistics are also reported with "all".\n
+ *    example: <tt>-jac stats</tt> \n
+ * \commandlinearg -jacmask: optional argument for transformix for restricting the
+ *    statistics of -jac to the voxels inside a mask image.\n
+ *    example: <tt>-jacmask mask.mhd</tt> \n
  *
  * \ingroup Transforms
  * \ingroup ComponentBaseClasses
@@ -319,6 +405,12 @@ public:
   /** Function to compute the determinant of the spatial Jacobian. */
   virtual void ComputeSpatialJacobian( void ) const;
 
+  /** Function to compute the displacement field of the inverse transform. */
+  typename DeformationFieldImageType::Pointer GenerateInverseDeformationFieldImage( void ) const;
+
+  /** Function to compute and write the displacement field of the inverse transform. */
+  virtual void ComputeInverseDeformationField( void ) const;
+
   /** Makes sure that the final parameters from the registration components
    * are copied, set, and stored.
    */
@@ -349,6 +441,34 @@ protected:
   void AutomaticScalesEstimationStackTransform(
     const unsigned int & numSubTransforms, ScalesType & scales ) const;
 
+  /** Replace a nonlinear initial transform by a B-spline approximation on
+   * the given image domain, if the BakeInitialTransform parameter is "true".
+   */
+  virtual void BakeInitialTransform(
+    const typename FixedImageType::PointType & origin,
+    const typename FixedImageType::SpacingType & spacing,
+    const typename FixedImageType::DirectionType & direction,
+    const typename FixedImageType::RegionType & region );
+
+  /** Report the approximation error of a baked transform, measured at
+   * numberOfSamples points, and compare the maximum error with the tolerance
+   * read from the parameter toleranceParameterName, which is given in units of
+   * the smallest voxel spacing. Returns false if the tolerance is exceeded.
+   */
+  bool CheckBakingError( const std::string & toleranceParameterName,
+    const double maximumError, const double rmsError,
+    const unsigned long numberOfSamples,
+    const typename FixedImageType::SpacingType & spacing ) const;
+
+  /** Read the output image domain from the Size, Index, Spacing, Origin and
+   * Direction in the transform parameter file.
+   */
+  void ReadOutputImageDomain(
+    typename FixedImageType::PointType & origin,
+    typename FixedImageType::SpacingType & spacing,
+    typename FixedImageType::DirectionType & direction,
+    typename FixedImageType::RegionType & region ) const;
+
   /** Member variables. */
   ParametersType * m_TransformParametersPointer;
   std::string      m_TransformParametersFileName;
@@ -26,9 +26,13 @@
 #include "vnl/vnl_math.h"
 #include <itksys/SystemTools.hxx>
 #include "itkVector.h"
-#include "itkTransformToDisplacementFieldFilter.h"
+#include "itkAdvancedTransformToDisplacementFieldSource.h"
 #include "itkTransformToDeterminantOfSpatialJacobianSource.h"
 #include "itkTransformToSpatialJacobianSource.h"
+#include "itkTransformToInverseDisplacementFieldSource.h"
+#include "itkStreamingImageStatisticsFilter.h"
+#include "itkImageMaskSpatialObject2.h"
+#include "itkImageFileReader.h"
 #include "itkImageFileWriter.h"
 #include "itkImageGridSampler.h"
 #include "itkContinuousIndex.h"
@@ -37,6 +41,8 @@
 #include "itkMeshFileReader.h"
 #include "itkMeshFileWriter.h"
 #include "itkTransformMeshFilter.h"
+#include "itkBakedBSplineTransformComputer.h"
+#include "itkTimeProbe.h"
 
 namespace itk
 {
@@ -218,6 +224,13 @@ TransformBase< TElastix >
     elxout << "-jac      " << check << std::endl;
   }
 
+  /** Check for appearance of "-jacmask". */
+  check = this->m_Configuration->GetCommandLineArgument( "-jacmask" );
+  if( check != "" )
+  {
+    elxout << "-jacmask  " << check << std::endl;
+  }
+
   /** Check for appearance of "-jacmat". */
   check = this->m_Configuration->GetCommandLineArgument( "-jacmat" );
   if( check == "" )
@@ -229,6 +242,17 @@ TransformBase< TElastix >
     elxout << "-jacmat   " << check << std::endl;
   }
 
+  /** Check for appearance of "-inv". */
+  check = this->m_Configuration->GetCommandLineArgument( "-inv" );
+  if( check == "" )
+  {
+    elxout << "-inv      unspecified, so no inverse deformation field computed" << std::endl;
+  }
+  else
+  {
+    elxout << "-inv      " << check << std::endl;
+  }
+
   /** Return a value. */
   return returndummy;
 
@@ -296,6 +320,19 @@ TransformBase< TElastix >
     }
   }
 
+  /** The initial transform is constant during the registration, so
+   * linear chains of initial transforms can be folded, or nonlinear ones
+   * baked, once.
+   */
+  if( thisAsGrouper )
+  {
+    thisAsGrouper->CollapseLinearInitialTransform();
+
+    const FixedImageType * fixedImage = this->m_Elastix->GetFixedImage();
+    this->BakeInitialTransform( fixedImage->GetOrigin(), fixedImage->GetSpacing(),
+      fixedImage->GetDirection(), fixedImage->GetLargestPossibleRegion() );
+  }
+
 } // end BeforeRegistrationBase()
 
 
@@ -534,6 +571,19 @@ TransformBase< TElastix >
     {
       thisAsGrouper->SetUseComposition( false );
     }
+
+    /** The initial transform has been read completely, so a linear
+     * chain of initial transforms can be folded now.
+     */
+    thisAsGrouper->CollapseLinearInitialTransform();
+
+    /** Bake a nonlinear initial transform on the output image domain. */
+    typename FixedImageType::PointType     origin;
+    typename FixedImageType::SpacingType   spacing;
+    typename FixedImageType::DirectionType direction;
+    typename FixedImageType::RegionType    region;
+    this->ReadOutputImageDomain( origin, spacing, direction, region );
+    this->BakeInitialTransform( origin, spacing, direction, region );
   }
 
   /** Task 4 - Remember the name of the TransformParametersFileName.
@@ -594,6 +644,173 @@ TransformBase< TElastix >
 } // end ReadInitialTransformFromVector()
 
 
+/**
+ * ******************* BakeInitialTransform *****************************
+ */
+
+template< class TElastix >
+void
+TransformBase< TElastix >
+::BakeInitialTransform(
+  const typename FixedImageType::PointType & origin,
+  const typename FixedImageType::SpacingType & spacing,
+  const typename FixedImageType::DirectionType & direction,
+  const typename FixedImageType::RegionType & region )
+{
+  /** Check if baking is requested. */
+  bool bakeInitialTransform = false;
+  this->m_Configuration->ReadParameter( bakeInitialTransform,
+    "BakeInitialTransform", 0, false );
+  CombinationTransformType * thisAsGrouper = this->GetAsCombinationTransform();
+  if( !bakeInitialTransform || !thisAsGrouper )
+  {
+    return;
+  }
+
+  /** Only a nonlinear initial transform is baked. A linear one
+   * is folded exactly by CollapseLinearInitialTransform().
+   */
+  InitialTransformType * initialTransform = thisAsGrouper->GetModifiableInitialTransform();
+  if( !initialTransform || initialTransform->IsLinear() )
+  {
+    return;
+  }
+
+  /** When read from file, the output image domain may be absent. */
+  if( region.GetNumberOfPixels() == 0 )
+  {
+    xl::xout[ "warning" ] << "WARNING: BakeInitialTransform is ignored, "
+                          << "since no output image domain is given." << std::endl;
+    return;
+  }
+
+  /** Read the grid spacing. */
+  typename FixedImageType::SpacingType gridSpacing;
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
+  {
+    double gridSpacingInVoxels = 4.0;
+    this->m_Configuration->ReadParameter( gridSpacingInVoxels,
+      "BakeInitialTransformGridSpacingInVoxels", i, false );
+    gridSpacing[ i ] = gridSpacingInVoxels * spacing[ i ];
+  }
+
+  /** Sample the initial transform and compute the B-spline transform. */
+  typedef itk::BakedBSplineTransformComputer<
+    CoordRepType,
+    itkGetStaticConstMacro( FixedImageDimension ) > BakedTransformComputerType;
+  typename BakedTransformComputerType::Pointer computer = BakedTransformComputerType::New();
+  computer->SetTransform( initialTransform );
+  computer->SetImageOrigin( origin );
+  computer->SetImageSpacing( spacing );
+  computer->SetImageDirection( direction );
+  computer->SetImageRegion( region );
+  computer->SetGridSpacing( gridSpacing );
+
+  elxout << "Baking the initial transform ..." << std::endl;
+  itk::TimeProbe timer;
+  timer.Start();
+  computer->Compute();
+  timer.Stop();
+  elxout << "  Baking the initial transform took: "
+         << this->ConvertSecondsToDHMS( timer.GetMean(), 2 ) << std::endl;
+
+  /** Keep the exact initial transform if the approximation is too coarse. */
+  if( !this->CheckBakingError( "BakeInitialTransformMaximumErrorInVoxels",
+    computer->GetMaximumError(), computer->GetRMSError(),
+    computer->GetNumberOfErrorSamples(), spacing ) )
+  {
+    xl::xout[ "warning" ] << "WARNING: the initial transform is not baked." << std::endl;
+    return;
+  }
+
+  /** Outside the image domain the exact initial transform is used. */
+  thisAsGrouper->SetBakedInitialTransform( computer->GetModifiableOutput(),
+    computer->GetModifiableImageDomain() );
+
+} // end BakeInitialTransform()
+
+
+/**
+ * ******************* CheckBakingError *****************************
+ */
+
+template< class TElastix >
+bool
+TransformBase< TElastix >
+::CheckBakingError( const std::string & toleranceParameterName,
+  const double maximumError, const double rmsError,
+  const unsigned long numberOfSamples,
+  const typename FixedImageType::SpacingType & spacing ) const
+{
+  double maximumErrorInVoxels = 0.1;
+  this->m_Configuration->ReadParameter( maximumErrorInVoxels,
+    toleranceParameterName, 0, false );
+  double minimumSpacing = spacing[ 0 ];
+  for( unsigned int i = 1; i < FixedImageDimension; ++i )
+  {
+    minimumSpacing = std::min( minimumSpacing, static_cast< double >( spacing[ i ] ) );
+  }
+  const double tolerance = maximumErrorInVoxels * minimumSpacing;
+
+  elxout << "  Approximation error at " << numberOfSamples << " points:\n"
+         << "    maximum: " << maximumError << "\n"
+         << "    RMS: " << rmsError << "\n"
+         << "    tolerance: " << tolerance << std::endl;
+
+  if( maximumError > tolerance )
+  {
+    xl::xout[ "warning" ] << "WARNING: the maximum approximation error ("
+                          << maximumError << ") exceeds " << toleranceParameterName
+                          << " (" << tolerance << ")." << std::endl;
+    return false;
+  }
+  return true;
+
+} // end CheckBakingError()
+
+
+/**
+ * ******************* ReadOutputImageDomain *****************************
+ */
+
+template< class TElastix >
+void
+TransformBase< TElastix >
+::ReadOutputImageDomain(
+  typename FixedImageType::PointType & origin,
+  typename FixedImageType::SpacingType & spacing,
+  typename FixedImageType::DirectionType & direction,
+  typename FixedImageType::RegionType & region ) const
+{
+  typename FixedImageType::SizeType  size;
+  typename FixedImageType::IndexType index;
+  direction.SetIdentity();
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
+  {
+    size[ i ] = 0;
+    this->m_Configuration->ReadParameter( size[ i ], "Size", i, false );
+    index[ i ] = 0;
+    this->m_Configuration->ReadParameter( index[ i ], "Index", i, false );
+    spacing[ i ] = 1.0;
+    this->m_Configuration->ReadParameter( spacing[ i ], "Spacing", i, false );
+    origin[ i ] = 0.0;
+    this->m_Configuration->ReadParameter( origin[ i ], "Origin", i, false );
+    for( unsigned int j = 0; j < FixedImageDimension; ++j )
+    {
+      this->m_Configuration->ReadParameter( direction( j, i ),
+        "Direction", i * FixedImageDimension + j, false );
+    }
+  }
+  if( !this->GetElastix()->GetUseDirectionCosines() )
+  {
+    direction.SetIdentity();
+  }
+  region.SetSize( size );
+  region.SetIndex( index );
+
+} // end ReadOutputImageDomain()
+
+
 /**
  * ******************* ReadInitialTransformFromFile *************
  */
@@ -1275,12 +1492,35 @@ TransformBase< TElastix >
     }
   }
 
-  /** Apply the transform. */
+  /** Apply the transform. All points are transformed at once, by the
+   * batched TransformPoints(), which expects one array per dimension.
+   */
   elxout << "  The input points are transformed." << std::endl;
+  std::vector< CoordRepType > inputcoordinates( FixedImageDimension * nrofpoints );
+  std::vector< CoordRepType > outputcoordinates( MovingImageDimension * nrofpoints );
+  typename ITKBaseType::InputCoordinateArraysType  inputcoordinatearrays;
+  typename ITKBaseType::OutputCoordinateArraysType outputcoordinatearrays;
+  for( unsigned int i = 0; i < FixedImageDimension; i++ )
+  {
+    inputcoordinatearrays[ i ] = inputcoordinates.data() + i * nrofpoints;
+    for( unsigned int j = 0; j < nrofpoints; j++ )
+    {
+      inputcoordinates[ i * nrofpoints + j ] = inputpointvec[ j ][ i ];
+    }
+  }
+  for( unsigned int i = 0; i < MovingImageDimension; i++ )
+  {
+    outputcoordinatearrays[ i ] = outputcoordinates.data() + i * nrofpoints;
+  }
+  this->GetAsITKBaseType()->TransformPoints(
+    inputcoordinatearrays, outputcoordinatearrays, nrofpoints, nullptr );
+
   for( unsigned int j = 0; j < nrofpoints; j++ )
   {
-    /** Call TransformPoint. */
-    outputpointvec[ j ] = this->GetAsITKBaseType()->TransformPoint( inputpointvec[ j ] );
+    for( unsigned int i = 0; i < MovingImageDimension; i++ )
+    {
+      outputpointvec[ j ][ i ] = outputcoordinates[ i * nrofpoints + j ];
+    }
 
     /** Transform back to index in fixed image domain. */
     dummyImage->TransformPhysicalPointToContinuousIndex(
@@ -1495,21 +1735,23 @@ TransformBase< TElastix >
 {
   /** Typedef's. */
   typedef typename FixedImageType::DirectionType FixedImageDirectionType;
-  typedef itk::TransformToDisplacementFieldFilter<
+  typedef itk::AdvancedTransformToDisplacementFieldSource<
     DeformationFieldImageType, CoordRepType >         DeformationFieldGeneratorType;
   typedef itk::ChangeInformationImageFilter<
     DeformationFieldImageType >                       ChangeInfoFilterType;
 
-  /** Create an setup deformation field generator. */
+  /** Create an setup deformation field generator. B-spline transforms
+   * are evaluated row by row by this generator.
+   */
   typename DeformationFieldGeneratorType::Pointer defGenerator
     = DeformationFieldGeneratorType::New();
-  defGenerator->SetSize(
+  defGenerator->SetOutputSize(
     this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetSize() );
   defGenerator->SetOutputSpacing(
     this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputSpacing() );
   defGenerator->SetOutputOrigin(
     this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputOrigin() );
-  defGenerator->SetOutputStartIndex(
+  defGenerator->SetOutputIndex(
     this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputStartIndex() );
   defGenerator->SetOutputDirection(
     this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputDirection() );
@@ -1618,13 +1860,14 @@ TransformBase< TElastix >
            << "so no det(dT/dx) computed." << std::endl;
     return;
   }
-  else if( jac != "all" )
+  else if( jac != "all" && jac != "stats" )
   {
-    elxout << "  WARNING: The command-line option \"-jac\" should be used as \"-jac all\",\n"
-           << "    but is specified as \"-jac " << jac << "\"\n"
+    elxout << "  WARNING: The command-line option \"-jac\" should be used as \"-jac all\"\n"
+           << "    or \"-jac stats\", but is specified as \"-jac " << jac << "\"\n"
            << "    Therefore det(dT/dx) is not computed." << std::endl;
     return;
   }
+  const bool writeJacobianImage = ( jac == "all" );
 
   /** Typedef's. */
   typedef itk::Image< float, FixedImageDimension > JacobianImageType;
@@ -1633,8 +1876,29 @@ TransformBase< TElastix >
   typedef itk::ImageFileWriter< JacobianImageType > JacobianWriterType;
   typedef itk::ChangeInformationImageFilter<
     JacobianImageType >                               ChangeInfoFilterType;
+  typedef itk::StreamingImageStatisticsFilter<
+    JacobianImageType >                               StatisticsFilterType;
+  typedef itk::ImageMaskSpatialObject2<
+    FixedImageDimension >                             MaskSpatialObjectType;
+  typedef typename MaskSpatialObjectType::ImageType MaskImageType;
+  typedef itk::ImageFileReader< MaskImageType >     MaskReaderType;
   typedef typename FixedImageType::DirectionType FixedImageDirectionType;
 
+  /** Read the settings of the streaming and of the statistics. */
+  unsigned int numberOfStreamDivisions = 1;
+  this->m_Configuration->ReadParameter( numberOfStreamDivisions,
+    "JacobianNumberOfStreamDivisions", 0, false );
+  numberOfStreamDivisions = std::max( numberOfStreamDivisions, 1u );
+  double       histogramMinimum      = 0.0;
+  double       histogramMaximum      = 2.0;
+  unsigned int numberOfHistogramBins = 20;
+  this->m_Configuration->ReadParameter( histogramMinimum,
+    "JacobianHistogramMinimum", 0, false );
+  this->m_Configuration->ReadParameter( histogramMaximum,
+    "JacobianHistogramMaximum", 0, false );
+  this->m_Configuration->ReadParameter( numberOfHistogramBins,
+    "JacobianNumberOfHistogramBins", 0, false );
+
   /** Create an setup Jacobian generator. */
   typename JacobianGeneratorType::Pointer jacGenerator = JacobianGeneratorType::New();
   jacGenerator->SetTransform( const_cast< const ITKBaseType * >(
@@ -1662,13 +1926,44 @@ TransformBase< TElastix >
   infoChanger->SetOutputDirection( originalDirection );
   infoChanger->SetChangeDirection( retdc & !this->GetElastix()->GetUseDirectionCosines() );
   infoChanger->SetInput( jacGenerator->GetOutput() );
-#ifndef _ELASTIX_BUILD_LIBRARY
-  /** Track the progress of the generation of the deformation field. */
-  typename ProgressCommandType::Pointer progressObserver = ProgressCommandType::New();
-  progressObserver->ConnectObserver( jacGenerator );
-  progressObserver->SetStartString( "  Progress: " );
-  progressObserver->SetEndString( "%" );
-#endif
+
+  /** Accumulate the statistics of the determinant, possibly within a mask,
+   * while the slabs pass by. The mask is compared in world coordinates
+   * with the original direction cosines. */
+  typename StatisticsFilterType::Pointer statistics = StatisticsFilterType::New();
+  statistics->SetHistogramMinimum( histogramMinimum );
+  statistics->SetHistogramMaximum( histogramMaximum );
+  statistics->SetNumberOfHistogramBins( numberOfHistogramBins );
+  statistics->SetNumberOfStreamDivisions( numberOfStreamDivisions );
+  statistics->SetInput( infoChanger->GetOutput() );
+
+  const std::string maskFileName
+    = this->m_Configuration->GetCommandLineArgument( "-jacmask" );
+  if( !maskFileName.empty() )
+  {
+    typename MaskReaderType::Pointer maskReader = MaskReaderType::New();
+    maskReader->SetFileName( maskFileName );
+    try
+    {
+      maskReader->Update();
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      /** Add information to the exception. */
+      excp.SetLocation( "TransformBase - ComputeDeterminantOfSpatialJacobian()" );
+      std::string err_str = excp.GetDescription();
+      err_str += "\nError occurred while reading the mask for the spatial Jacobian statistics.\n";
+      excp.SetDescription( err_str );
+
+      /** Pass the exception to an higher level. */
+      throw excp;
+    }
+
+    typename MaskSpatialObjectType::Pointer mask = MaskSpatialObjectType::New();
+    mask->SetImage( maskReader->GetOutput() );
+    statistics->SetMask( mask );
+  }
+
   /** Create a name for the deformation field file. */
   std::string resultImageFormat = "mhd";
   this->m_Configuration->ReadParameter( resultImageFormat, "ResultImageFormat", 0, false );
@@ -1676,29 +1971,91 @@ TransformBase< TElastix >
   makeFileName << this->m_Configuration->GetCommandLineArgument( "-out" )
                << "spatialJacobian." << resultImageFormat;
 
-  /** Write outputImage to disk. */
+  /** Write outputImage to disk, slab by slab if requested. */
   typename JacobianWriterType::Pointer jacWriter = JacobianWriterType::New();
-  jacWriter->SetInput( infoChanger->GetOutput() );
+  jacWriter->SetInput( statistics->GetOutput() );
   jacWriter->SetFileName( makeFileName.str().c_str() );
+  jacWriter->SetNumberOfStreamDivisions( numberOfStreamDivisions );
 
-  /** Do the writing. */
-  elxout << "  Computing and writing the spatial Jacobian determinant..." << std::endl;
+#ifndef _ELASTIX_BUILD_LIBRARY
+  /** Track the progress of the generation of the determinant. When streaming,
+   * the generator restarts for every slab, so the writer is tracked instead. */
+  typename ProgressCommandType::Pointer progressObserver = ProgressCommandType::New();
+  if( numberOfStreamDivisions == 1 )
+  {
+    progressObserver->ConnectObserver( jacGenerator );
+  }
+  else if( writeJacobianImage )
+  {
+    progressObserver->ConnectObserver( jacWriter );
+  }
+  progressObserver->SetStartString( "  Progress: " );
+  progressObserver->SetEndString( "%" );
+#endif
+
+  /** Do the computation, and the writing. */
+  if( writeJacobianImage )
+  {
+    elxout << "  Computing and writing the spatial Jacobian determinant..." << std::endl;
+  }
+  else
+  {
+    elxout << "  Computing the statistics of the spatial Jacobian determinant..." << std::endl;
+  }
   try
   {
-    jacWriter->Update();
+    if( writeJacobianImage )
+    {
+      statistics->ResetStatistics();
+      jacWriter->Update();
+    }
+    else
+    {
+      statistics->StreamStatistics();
+    }
   }
   catch( itk::ExceptionObject & excp )
   {
     /** Add information to the exception. */
     excp.SetLocation( "TransformBase - ComputeDeterminantOfSpatialJacobian()" );
     std::string err_str = excp.GetDescription();
-    err_str += "\nError occurred while writing spatial Jacobian determinant image.\n";
+    err_str += "\nError occurred while computing spatial Jacobian determinant image.\n";
     excp.SetDescription( err_str );
 
     /** Pass the exception to an higher level. */
     throw excp;
   }
 
+  /** Report the statistics. */
+  elxout << "  Statistics of the spatial Jacobian determinant";
+  if( !maskFileName.empty() )
+  {
+    elxout << " inside the mask " << maskFileName;
+  }
+  elxout << ":\n"
+         << "    number of voxels:    " << statistics->GetCount() << "\n";
+  if( statistics->GetCount() > 0 )
+  {
+    elxout << "    minimum:             " << statistics->GetMinimum() << "\n"
+           << "    maximum:             " << statistics->GetMaximum() << "\n"
+           << "    mean:                " << statistics->GetMean() << "\n"
+           << "    standard deviation:  " << statistics->GetSigma() << "\n"
+           << "    fraction <= 0:       " << statistics->GetFractionOfNonPositiveValues()
+           << " (" << statistics->GetNumberOfNonPositiveValues() << " voxels)\n";
+    if( numberOfHistogramBins > 0 )
+    {
+      elxout << "    histogram:\n";
+      const double binWidth = ( histogramMaximum - histogramMinimum ) / numberOfHistogramBins;
+      for( unsigned int b = 0; b < numberOfHistogramBins; ++b )
+      {
+        elxout << "      [" << histogramMinimum + b * binWidth
+               << ", " << histogramMinimum + ( b + 1 ) * binWidth << ")\t"
+               << statistics->GetHistogram()[ b ] << "\n";
+      }
+    }
+  }
+  elxout << std::flush;
+
 } // end ComputeDeterminantOfSpatialJacobian()
 
 
@@ -1737,6 +2094,12 @@ TransformBase< TElastix >
   typedef itk::PixelTypeChangeCommand<
     JacobianWriterType >                              PixelTypeChangeCommandType;
 
+  /** Read the number of slabs in which the spatial Jacobian is computed. */
+  unsigned int numberOfStreamDivisions = 1;
+  this->m_Configuration->ReadParameter( numberOfStreamDivisions,
+    "JacobianNumberOfStreamDivisions", 0, false );
+  numberOfStreamDivisions = std::max( numberOfStreamDivisions, 1u );
+
   /** Create an setup Jacobian generator. */
   typename JacobianGeneratorType::Pointer jacGenerator = JacobianGeneratorType::New();
   jacGenerator->SetTransform( const_cast< const ITKBaseType * >(
@@ -1765,13 +2128,6 @@ TransformBase< TElastix >
   infoChanger->SetOutputDirection( originalDirection );
   infoChanger->SetChangeDirection( retdc & !this->GetElastix()->GetUseDirectionCosines() );
   infoChanger->SetInput( jacGenerator->GetOutput() );
-#ifndef _ELASTIX_BUILD_LIBRARY
-  /** Track the progress of the generation of the deformation field. */
-  typename ProgressCommandType::Pointer progressObserver = ProgressCommandType::New();
-  progressObserver->ConnectObserver( jacGenerator );
-  progressObserver->SetStartString( "  Progress: " );
-  progressObserver->SetEndString( "%" );
-#endif
   /** Create a name for the deformation field file. */
   std::string resultImageFormat = "mhd";
   this->m_Configuration->ReadParameter( resultImageFormat, "ResultImageFormat", 0, false );
@@ -1783,6 +2139,23 @@ TransformBase< TElastix >
   typename JacobianWriterType::Pointer jacWriter = JacobianWriterType::New();
   jacWriter->SetInput( infoChanger->GetOutput() );
   jacWriter->SetFileName( makeFileName.str().c_str() );
+  jacWriter->SetNumberOfStreamDivisions( numberOfStreamDivisions );
+#ifndef _ELASTIX_BUILD_LIBRARY
+  /** Track the progress of the generation of the spatial Jacobian. When
+   * streaming, the generator restarts for every slab, so the writer is
+   * tracked instead. */
+  typename ProgressCommandType::Pointer progressObserver = ProgressCommandType::New();
+  if( numberOfStreamDivisions == 1 )
+  {
+    progressObserver->ConnectObserver( jacGenerator );
+  }
+  else
+  {
+    progressObserver->ConnectObserver( jacWriter );
+  }
+  progressObserver->SetStartString( "  Progress: " );
+  progressObserver->SetEndString( "%" );
+#endif
   /** Hack to change the pixel type to vector. Not necessary for mhd. */
   typename PixelTypeChangeCommandType::Pointer jacStartWriteCommand
     = PixelTypeChangeCommandType::New();
@@ -1812,6 +2185,178 @@ TransformBase< TElastix >
 } // end ComputeSpatialJacobian()
 
 
+/**
+ * ************** GenerateInverseDeformationFieldImage **********************
+ *
+ * This function computes, for all indexes, the point that is mapped
+ * onto it by the transform. The difference vector (= the deformation of
+ * the inverse at that index) is stored in an image of vectors (of floats).
+ */
+
+template< class TElastix >
+typename TransformBase< TElastix >::DeformationFieldImageType::Pointer
+TransformBase< TElastix >
+::GenerateInverseDeformationFieldImage( void ) const
+{
+  /** Typedef's. */
+  typedef typename FixedImageType::DirectionType FixedImageDirectionType;
+  typedef itk::TransformToInverseDisplacementFieldSource<
+    DeformationFieldImageType, CoordRepType >         InverseGeneratorType;
+  typedef itk::ChangeInformationImageFilter<
+    DeformationFieldImageType >                       ChangeInfoFilterType;
+
+  /** Read the settings of the iteration. */
+  unsigned int maximumNumberOfIterations = 20;
+  double       tolerance                 = 0.01;
+  unsigned int coarseningFactor          = 4;
+  this->m_Configuration->ReadParameter( maximumNumberOfIterations,
+    "InverseMaximumNumberOfIterations", 0, false );
+  this->m_Configuration->ReadParameter( tolerance,
+    "InverseTolerance", 0, false );
+  this->m_Configuration->ReadParameter( coarseningFactor,
+    "InverseCoarseningFactor", 0, false );
+
+  /** Create an setup inverse deformation field generator. */
+  typename InverseGeneratorType::Pointer invGenerator = InverseGeneratorType::New();
+  invGenerator->SetTransform( const_cast< const ITKBaseType * >(
+      this->GetAsITKBaseType() ) );
+  invGenerator->SetOutputSize(
+    this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetSize() );
+  invGenerator->SetOutputSpacing(
+    this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputSpacing() );
+  invGenerator->SetOutputOrigin(
+    this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputOrigin() );
+  invGenerator->SetOutputIndex(
+    this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputStartIndex() );
+  invGenerator->SetOutputDirection(
+    this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputDirection() );
+  invGenerator->SetMaximumNumberOfIterations( maximumNumberOfIterations );
+  invGenerator->SetTolerance( tolerance );
+  invGenerator->SetCoarseningFactor( coarseningFactor );
+
+  /** Possibly change direction cosines to their original value, as specified
+   * in the tp-file, or by the fixed image. This is only necessary when
+   * the UseDirectionCosines flag was set to false. */
+  typename ChangeInfoFilterType::Pointer infoChanger = ChangeInfoFilterType::New();
+  FixedImageDirectionType originalDirection;
+  bool                    retdc = this->GetElastix()->GetOriginalFixedImageDirection( originalDirection );
+  infoChanger->SetOutputDirection( originalDirection );
+  infoChanger->SetChangeDirection( retdc & !this->GetElastix()->GetUseDirectionCosines() );
+  infoChanger->SetInput( invGenerator->GetOutput() );
+
+  /** Track the progress of the generation of the inverse deformation field. */
+#ifndef _ELASTIX_BUILD_LIBRARY
+  typename ProgressCommandType::Pointer progressObserver = ProgressCommandType::New();
+  progressObserver->ConnectObserver( invGenerator );
+  progressObserver->SetStartString( "  Progress: " );
+  progressObserver->SetEndString( "%" );
+#endif
+
+  try
+  {
+    infoChanger->Update();
+  }
+  catch ( itk::ExceptionObject & excp )
+  {
+    /** Add information to the exception. */
+    excp.SetLocation( "TransformBase - GenerateInverseDeformationFieldImage()" );
+    std::string err_str = excp.GetDescription();
+    err_str += "\nError occurred while generating inverse deformation field image.\n";
+    excp.SetDescription( err_str );
+
+    /** Pass the exception to an higher level. */
+    throw excp;
+  }
+
+  /** Report the inverse-consistency error. */
+  elxout << "  Inverse-consistency error |T(x) - y|: mean "
+         << invGenerator->GetMeanInverseConsistencyError()
+         << ", maximum " << invGenerator->GetMaximumInverseConsistencyError() << std::endl;
+  if( invGenerator->GetNumberOfNonConvergedPoints() > 0 )
+  {
+    typedef typename InverseGeneratorType::IndexType IndexType;
+    const std::vector< IndexType > & indices = invGenerator->GetNonConvergedIndices();
+    xl::xout[ "warning" ] << "WARNING: the inverse did not reach the InverseTolerance of "
+                          << tolerance << " at " << invGenerator->GetNumberOfNonConvergedPoints()
+                          << " voxels, for example at the indices";
+    for( std::size_t i = 0; i < std::min< std::size_t >( indices.size(), 10 ); ++i )
+    {
+      xl::xout[ "warning" ] << " " << indices[ i ];
+    }
+    xl::xout[ "warning" ] << "." << std::endl;
+  }
+
+  return infoChanger->GetOutput();
+
+} // end GenerateInverseDeformationFieldImage()
+
+
+/**
+ * ************** ComputeInverseDeformationField **********************
+ */
+
+template< class TElastix >
+void
+TransformBase< TElastix >
+::ComputeInverseDeformationField( void ) const
+{
+  /** If the optional command "-inv" is given in the command line arguments,
+   * then and only then we continue.
+   */
+  std::string inv = this->GetConfiguration()->GetCommandLineArgument( "-inv" );
+  if( inv == "" )
+  {
+    elxout << "  The command-line option \"-inv\" is not used, "
+           << "so no inverse deformation field computed." << std::endl;
+    return;
+  }
+  else if( inv != "all" )
+  {
+    elxout << "  WARNING: The command-line option \"-inv\" should be used as \"-inv all\",\n"
+           << "    but is specified as \"-inv " << inv << "\"\n"
+           << "    Therefore the inverse deformation field is not computed." << std::endl;
+    return;
+  }
+
+  elxout << "  Computing the inverse deformation field ..." << std::endl;
+  typename DeformationFieldImageType::Pointer inverseField
+    = this->GenerateInverseDeformationFieldImage();
+
+  /** Create a name for the inverse deformation field file. */
+  typedef itk::ImageFileWriter< DeformationFieldImageType > DeformationFieldWriterType;
+  std::string resultImageFormat = "mhd";
+  this->m_Configuration->ReadParameter( resultImageFormat, "ResultImageFormat", 0, false );
+  std::ostringstream makeFileName( "" );
+  makeFileName << this->m_Configuration->GetCommandLineArgument( "-out" )
+               << "inverseDeformationField." << resultImageFormat;
+
+  /** Write outputImage to disk. */
+  typename DeformationFieldWriterType::Pointer defWriter
+    = DeformationFieldWriterType::New();
+  defWriter->SetInput( inverseField );
+  defWriter->SetFileName( makeFileName.str().c_str() );
+
+  /** Do the writing. */
+  elxout << "  Writing the inverse deformation field ..." << std::endl;
+  try
+  {
+    defWriter->Update();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    /** Add information to the exception. */
+    excp.SetLocation( "TransformBase - ComputeInverseDeformationField()" );
+    std::string err_str = excp.GetDescription();
+    err_str += "\nError occurred while writing inverse deformation field image.\n";
+    excp.SetDescription( err_str );
+
+    /** Pass the exception to an higher level. */
+    throw excp;
+  }
+
+} // end ComputeInverseDeformationField()
+
+
 /**
  * ************** SetTransformParametersFileName ****************
  */
@@ -484,6 +484,26 @@ ElastixTemplate< TFixedImage, TMovingImage >
   elxout << "  Computing spatial Jacobian done, it took "
          << this->ConvertSecondsToDHMS( timer.GetMean(), 2 ) << std::endl;
 
+  /** Call ComputeInverseDeformationField.
+   * Actually we could loop over all transforms.
+   * But for now, there seems to be no use yet for that.
+   */
+  timer.Reset();
+  timer.Start();
+  elxout << "Compute inverse deformation field ..." << std::endl;
+  try
+  {
+    this->GetElxTransformBase()->ComputeInverseDeformationField();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    xout[ "error" ] << excp << std::endl;
+    xout[ "error" ] << "However, transformix continues anyway." << std::endl;
+  }
+  timer.Stop();
+  elxout << "  Computing inverse deformation field done, it took "
+         << this->ConvertSecondsToDHMS( timer.GetMean(), 2 ) << std::endl;
+
   /** Resample the image. */
   if( this->GetMovingImage() != 0 )
   {
@@ -502,11 +522,37 @@ ElastixTemplate< TFixedImage, TMovingImage >
     /** Write the resampled image to disk.
      * Actually we could loop over all resamplers.
      * But for now, there seems to be no use yet for that.
+     * Several input images are resampled in one pass, so that the
+     * transform is evaluated only once per output voxel.
      */
+    const unsigned int numberOfInputImages = this->GetNumberOfMovingImages();
 #ifndef _ELASTIX_BUILD_LIBRARY
-    this->GetElxResamplerBase()->ResampleAndWriteResultImage( makeFileName.str().c_str() );
+    if( numberOfInputImages > 1 )
+    {
+      std::vector< std::string > resultImageFileNames( numberOfInputImages );
+      resultImageFileNames[ 0 ] = makeFileName.str();
+      for( unsigned int i = 1; i < numberOfInputImages; ++i )
+      {
+        std::ostringstream makeFileName_i( "" );
+        makeFileName_i << this->GetConfiguration()->GetCommandLineArgument( "-out" )
+                       << "result." << i << "." << resultImageFormat;
+        resultImageFileNames[ i ] = makeFileName_i.str();
+      }
+      this->GetElxResamplerBase()->ResampleAndWriteResultImages( resultImageFileNames );
+    }
+    else
+    {
+      this->GetElxResamplerBase()->ResampleAndWriteResultImage( makeFileName.str().c_str() );
+    }
 #else
-    this->GetElxResamplerBase()->CreateItkResultImage();
+    if( numberOfInputImages > 1 )
+    {
+      this->GetElxResamplerBase()->CreateItkResultImages();
+    }
+    else
+    {
+      this->GetElxResamplerBase()->CreateItkResultImage();
+    }
 #endif
 
     /** Print the elapsed time for the resampling. */
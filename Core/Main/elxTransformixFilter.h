@@ -81,6 +81,16 @@ public:
   InputImageConstPointer GetMovingImage( void );
   virtual void RemoveMovingImage( void );
 
+  /** Add another moving image. All moving images are resampled in one pass,
+   * sharing the transform evaluations. The result of moving image i is
+   * available via GetResultImage( i ).
+   */
+  virtual void AddMovingImage( TMovingImage * inputImage );
+  unsigned int GetNumberOfMovingImages( void ) const;
+
+  /** Get the result image of moving image idx. Result image 0 is the primary output. */
+  OutputImageType * GetResultImage( const unsigned int idx );
+
   /** Set/Get/Remove moving point set filename. */
   itkSetMacro( FixedPointSetFileName, std::string );
   itkGetMacro( FixedPointSetFileName, std::string );
@@ -155,12 +165,17 @@ private:
   /** IsEmpty. */
   static bool IsEmpty( const InputImagePointer inputImage );
 
+  /** The name of moving image idx and its result image. */
+  static std::string GetMovingImageName( const unsigned int idx );
+  static std::string GetResultImageName( const unsigned int idx );
+
   /** Tell the compiler we want all definitions of Get/Set/Remove
    *  from ProcessObject and TransformixFilter.
    */
   using itk::ProcessObject::SetInput;
   using itk::ProcessObject::GetInput;
   using itk::ProcessObject::RemoveInput;
+  using itk::ProcessObject::RemoveOutput;
 
   std::string m_FixedPointSetFileName;
   bool        m_ComputeSpatialJacobian;
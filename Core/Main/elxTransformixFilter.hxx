@@ -167,7 +167,10 @@ TransformixFilter< TMovingImage >
   DataObjectContainerPointer inputImageContainer = nullptr;
   if( !this->IsEmpty( itkDynamicCastInDebugMode< TMovingImage* >( this->GetInput( "InputImage" ) ) ) ) {
     inputImageContainer = DataObjectContainerType::New();
-    inputImageContainer->CreateElementAt( 0 ) = this->GetInput( "InputImage" );
+    for( unsigned int i = 0; i < this->GetNumberOfMovingImages(); ++i )
+    {
+      inputImageContainer->CreateElementAt( i ) = this->GetInput( this->GetMovingImageName( i ) );
+    }
     transformix->SetInputImageContainer( inputImageContainer );
   }
 
@@ -214,11 +217,17 @@ TransformixFilter< TMovingImage >
     itkExceptionMacro( "Internal transformix error: See transformix log (use LogToConsoleOn() or LogToFileOn())" );
   }
 
-  // Save result image
+  // Save result images
   DataObjectContainerPointer resultImageContainer = transformix->GetResultImageContainer();
-  if( resultImageContainer.IsNotNull() && resultImageContainer->Size() > 0 && resultImageContainer->ElementAt( 0 ).IsNotNull()  )
+  if( resultImageContainer.IsNotNull() )
   {
-    this->GraftOutput( "ResultImage", resultImageContainer->ElementAt( 0 ) );
+    for( unsigned int i = 0; i < resultImageContainer->Size(); ++i )
+    {
+      if( resultImageContainer->ElementAt( i ).IsNotNull() && this->HasOutput( this->GetResultImageName( i ) ) )
+      {
+        this->GraftOutput( this->GetResultImageName( i ), resultImageContainer->ElementAt( i ) );
+      }
+    }
   }
   // Optionally, save result deformation field
   DataObjectContainerPointer resultDeformationFieldContainer = transformix->GetResultDeformationFieldContainer();
@@ -353,6 +362,14 @@ TransformixFilter< TMovingImage >
 
   outputPtr->SetNumberOfComponentsPerPixel( 1 );
   outputOutputDeformationFieldPtr->SetNumberOfComponentsPerPixel( TMovingImage::ImageDimension );
+
+  // The result images of additional moving images share the output grid
+  for( unsigned int i = 1; i < this->GetNumberOfMovingImages(); ++i )
+  {
+    OutputImageType * resultImagePtr = this->GetResultImage( i );
+    resultImagePtr->CopyInformation( outputPtr );
+    resultImagePtr->SetLargestPossibleRegion( outputLargestPossibleRegion );
+  }
 } // end GenerateOutputInformation()
 
 
@@ -391,10 +408,68 @@ void
 TransformixFilter< TMovingImage >
 ::RemoveMovingImage( void )
 {
+  for( unsigned int i = this->GetNumberOfMovingImages(); i > 1; --i )
+  {
+    this->RemoveInput( this->GetMovingImageName( i - 1 ) );
+    this->RemoveOutput( this->GetResultImageName( i - 1 ) );
+  }
   this->RemoveInput( "InputImage" );
 } // end RemoveMovingImage
 
 
+/**
+ * ********************* AddMovingImage *********************
+ */
+
+template< typename TMovingImage >
+void
+TransformixFilter< TMovingImage >
+::AddMovingImage( TMovingImage * inputImage )
+{
+  if( this->GetInput( "InputImage" ) == nullptr )
+  {
+    this->SetMovingImage( inputImage );
+    return;
+  }
+
+  const unsigned int idx = this->GetNumberOfMovingImages();
+  this->SetInput( this->GetMovingImageName( idx ), inputImage );
+  this->SetOutput( this->GetResultImageName( idx ), this->MakeOutput( this->GetResultImageName( idx ) ) );
+} // end AddMovingImage()
+
+
+/**
+ * ********************* GetNumberOfMovingImages *********************
+ */
+
+template< typename TMovingImage >
+unsigned int
+TransformixFilter< TMovingImage >
+::GetNumberOfMovingImages( void ) const
+{
+  unsigned int numberOfMovingImages = 0;
+  while( this->GetInput( this->GetMovingImageName( numberOfMovingImages ) ) != nullptr )
+  {
+    ++numberOfMovingImages;
+  }
+  return numberOfMovingImages;
+} // end GetNumberOfMovingImages()
+
+
+/**
+ * ********************* GetResultImage *********************
+ */
+
+template< typename TMovingImage >
+typename TransformixFilter< TMovingImage >::OutputImageType *
+TransformixFilter< TMovingImage >
+::GetResultImage( const unsigned int idx )
+{
+  return itkDynamicCastInDebugMode< OutputImageType * >(
+    this->itk::ProcessObject::GetOutput( this->GetResultImageName( idx ) ) );
+} // end GetResultImage()
+
+
 /**
  * ********************* SetTransformParameterObject *********************
  */
@@ -461,6 +536,32 @@ TransformixFilter< TMovingImage >
 } // end GetOutputDeformationField
 
 
+/**
+* ********************* GetMovingImageName ****************************
+*/
+
+template< typename TMovingImage >
+std::string
+TransformixFilter< TMovingImage >
+::GetMovingImageName( const unsigned int idx )
+{
+  return idx == 0 ? std::string( "InputImage" ) : "InputImage" + std::to_string( idx );
+} // end GetMovingImageName()
+
+
+/**
+* ********************* GetResultImageName ****************************
+*/
+
+template< typename TMovingImage >
+std::string
+TransformixFilter< TMovingImage >
+::GetResultImageName( const unsigned int idx )
+{
+  return idx == 0 ? std::string( "ResultImage" ) : "ResultImage" + std::to_string( idx );
+} // end GetResultImageName()
+
+
 /**
 * ********************* IsEmpty ****************************
 */
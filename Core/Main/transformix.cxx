@@ -126,13 +126,15 @@ main( int argc, char ** argv )
 
   /** Check that at least one of the following options is given. */
   if( argMap.count( "-in" ) == 0
+    && argMap.count( "-in0" ) == 0
     && argMap.count( "-ipp" ) == 0
     && argMap.count( "-def" ) == 0
     && argMap.count( "-jac" ) == 0
-    && argMap.count( "-jacmat" ) == 0 )
+    && argMap.count( "-jacmat" ) == 0
+    && argMap.count( "-inv" ) == 0 )
   {
     std::cerr << "ERROR: At least one of the CommandLine options \"-in\", "
-              << "\"-def\", \"-jac\", or \"-jacmat\" should be given!" << std::endl;
+              << "\"-def\", \"-jac\", \"-jacmat\", or \"-inv\" should be given!" << std::endl;
     returndummy |= -1;
   }
 
@@ -258,18 +260,24 @@ PrintHelp( void )
   /** Optional arguments. */
   std::cout << "Optional extra commands:\n";
   std::cout << "  -in       input image to deform\n";
+  std::cout << "            or -in0, -in1, ... for several input images, which are\n"
+            << "            resampled in one pass; result.<i>.mhd holds input i\n";
   std::cout << "  -def      file containing input-image points; the point are transformed\n"
             << "            according to the specified transform-parameter file\n";
   std::cout << "            use \"-def all\" to transform all points from the input-image, which\n"
             << "            effectively generates a deformation field.\n";
   std::cout << "  -jac      use \"-jac all\" to generate an image with the determinant of the\n"
-            << "            spatial Jacobian\n";
+            << "            spatial Jacobian, or \"-jac stats\" to only report its statistics\n";
+  std::cout << "  -jacmask  mask image within which the statistics of \"-jac\" are computed\n";
   std::cout << "  -jacmat   use \"-jacmat all\" to generate an image with the spatial Jacobian\n"
             << "            matrix at each voxel\n";
+  std::cout << "  -inv      use \"-inv all\" to generate the deformation field of the inverse\n"
+            << "            transform\n";
   std::cout << "  -priority set the process priority to high, abovenormal, normal (default),\n"
             << "            belownormal, or idle (Windows only option)\n";
   std::cout << "  -threads  set the maximum number of threads of transformix\n";
-  std::cout << "\nAt least one of the options \"-in\", \"-def\", \"-jac\", or \"-jacmat\" should be given.\n"
+  std::cout << "\nAt least one of the options \"-in\", \"-def\", \"-jac\", \"-jacmat\", or \"-inv\"\n"
+            << "should be given.\n"
             << std::endl;
 
   /** The parameter file. */
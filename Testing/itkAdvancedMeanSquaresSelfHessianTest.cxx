@@ -0,0 +1,261 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "itkImageGridSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkSmoothingRecursiveGaussianImageFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Test the SelfHessian of the AdvancedMeanSquaresImageToImageMetric. It is compared
+// with a dense reference, which adds the outer products of the image Jacobians
+// sample by sample, drawing the noise in the order of the samples. The compressed
+// Hessian should not depend on the number of threads, and GetSelfHessian() should
+// give the same elements.
+
+const unsigned int Dimension = 2;
+typedef itk::Image< float, Dimension >                         ImageType;
+typedef itk::AdvancedMeanSquaresImageToImageMetric<
+  ImageType, ImageType >                                       MetricType;
+typedef MetricType::CompressedHessianType                      CompressedHessianType;
+typedef MetricType::HessianType                                HessianType;
+typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 > TransformType;
+typedef TransformType::ParametersType                          ParametersType;
+typedef TransformType::NonZeroJacobianIndicesType              NonZeroJacobianIndicesType;
+typedef itk::BSplineInterpolateImageFunction<
+  ImageType, double, double >                                  InterpolatorType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+/** The SelfHessian as computed sample by sample, in a dense matrix. */
+std::vector< double >
+ComputeReferenceSelfHessian( const MetricType * metric, TransformType * transform )
+{
+  const unsigned int numberOfParameters = transform->GetNumberOfParameters();
+  std::vector< double > H( numberOfParameters * numberOfParameters, 0.0 );
+
+  /** The smoothed fixed image, and its interpolator. */
+  typedef itk::SmoothingRecursiveGaussianImageFilter< ImageType, ImageType > SmootherType;
+  SmootherType::Pointer smoother = SmootherType::New();
+  smoother->SetInput( metric->GetFixedImage() );
+  smoother->SetSigma( metric->GetSelfHessianSmoothingSigma() );
+  smoother->Update();
+  InterpolatorType::Pointer fixedInterpolator = InterpolatorType::New();
+  fixedInterpolator->SetSplineOrder( 3 );
+  fixedInterpolator->SetInputImage( smoother->GetOutput() );
+
+  /** The same samples as used by the metric. */
+  typedef itk::ImageGridSampler< ImageType > SamplerType;
+  SamplerType::Pointer sampler = SamplerType::New();
+  sampler->SetInputImageRegion( metric->GetImageSampler()->GetInputImageRegion() );
+  sampler->SetInput( metric->GetFixedImage() );
+  sampler->SetNumberOfSamples( metric->GetNumberOfSamplesForSelfHessian() );
+  sampler->Update();
+  SamplerType::ImageSampleContainerPointer samples = sampler->GetOutput();
+
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->Initialize();
+  const double noiseRange = metric->GetSelfHessianNoiseRange();
+
+  NonZeroJacobianIndicesType nzji( transform->GetNumberOfNonZeroJacobianIndices() );
+  MetricType::DerivativeType imageJacobian( nzji.size() );
+  for( unsigned long i = 0; i < samples->Size(); ++i )
+  {
+    const ImageType::PointType & fixedPoint = samples->ElementAt( i ).m_ImageCoordinates;
+    TransformType::MovingImageGradientType gradient;
+    const InterpolatorType::CovariantVectorType derivative = fixedInterpolator->EvaluateDerivative( fixedPoint );
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      gradient[ d ] = derivative[ d ]
+        + randomGenerator->GetVariateWithClosedRange( noiseRange ) - noiseRange / 2.0;
+    }
+    transform->EvaluateJacobianWithImageGradientProduct( fixedPoint, gradient, imageJacobian, nzji );
+    for( unsigned int a = 0; a < nzji.size(); ++a )
+    {
+      for( unsigned int b = a; b < nzji.size(); ++b )
+      {
+        H[ nzji[ a ] * numberOfParameters + nzji[ b ] ] += imageJacobian[ a ] * imageJacobian[ b ];
+      }
+    }
+  }
+
+  const double normalization = 2.0 / static_cast< double >( samples->Size() );
+  for( unsigned int k = 0; k < H.size(); ++k )
+  {
+    H[ k ] *= normalization;
+  }
+  return H;
+
+} // end ComputeReferenceSelfHessian()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** A smooth fixed image, which is also used as moving image. */
+  ImageType::RegionType region;
+  region.SetSize( 0, 40 ); region.SetSize( 1, 36 );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, region );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    const double x = it.GetIndex()[ 0 ];
+    const double y = it.GetIndex()[ 1 ];
+    it.Set( static_cast< float >( 10.0 * std::sin( x / 5.0 ) * std::cos( y / 7.0 ) + 0.1 * x * y ) );
+  }
+
+  /** A B-spline transform whose valid region contains the whole image. */
+  TransformType::Pointer          transform = TransformType::New();
+  TransformType::OriginType       gridOrigin;
+  TransformType::SpacingType      gridSpacing;
+  TransformType::RegionType       gridRegion;
+  TransformType::RegionType::SizeType gridSize;
+  gridOrigin.Fill( -12.0 );
+  gridSpacing.Fill( 8.0 );
+  gridSize.Fill( 10 );
+  gridRegion.SetSize( gridSize );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->Initialize( 1234 );
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = randomGenerator->GetUniformVariate( -0.5, 0.5 );
+  }
+  transform->SetParameters( parameters );
+
+  /** The fixed image region keeps the mapped samples inside the moving image. */
+  ImageType::RegionType fixedImageRegion;
+  fixedImageRegion.SetIndex( 0, 3 ); fixedImageRegion.SetIndex( 1, 3 );
+  fixedImageRegion.SetSize( 0, 34 ); fixedImageRegion.SetSize( 1, 30 );
+
+  /** Setup the metric. */
+  MetricType::Pointer metric = MetricType::New();
+  metric->SetFixedImage( image );
+  metric->SetMovingImage( image );
+  metric->SetFixedImageRegion( fixedImageRegion );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( InterpolatorType::New() );
+  metric->SetImageSampler( itk::ImageFullSampler< ImageType >::New() );
+  metric->SetNumberOfSamplesForSelfHessian( 1000 );
+
+  /** The dense reference. */
+  metric->Initialize();
+  const std::vector< double > referenceH = ComputeReferenceSelfHessian( metric, transform );
+  const unsigned int          numberOfParameters = transform->GetNumberOfParameters();
+  double                      scale = 0.0;
+  for( unsigned int k = 0; k < referenceH.size(); ++k )
+  {
+    scale = std::max( scale, std::abs( referenceH[ k ] ) );
+  }
+  if( scale == 0.0 )
+  {
+    std::cerr << "ERROR: the reference SelfHessian is zero, so the test is void." << std::endl;
+    return 1;
+  }
+
+  /** Compare the compressed SelfHessian with the reference, for several numbers of threads. */
+  CompressedHessianType firstH;
+  const unsigned int    numbersOfThreads[ 4 ] = { 1, 2, 3, 8 };
+  for( unsigned int t = 0; t < 4; ++t )
+  {
+    metric->SetUseMultiThread( numbersOfThreads[ t ] > 1 );
+    metric->SetNumberOfThreads( numbersOfThreads[ t ] );
+    metric->Initialize();
+    CompressedHessianType H;
+    metric->GetCompressedSelfHessian( parameters, H );
+
+    if( H.GetNumberOfRows() != static_cast< CompressedHessianType::IndexType >( numberOfParameters ) )
+    {
+      std::cerr << "ERROR: the SelfHessian has " << H.GetNumberOfRows() << " rows, instead of "
+                << numberOfParameters << "." << std::endl;
+      return 1;
+    }
+
+    /** All elements of the upper triangular part should match, and the
+     * compressed columns should be sorted and not below the diagonal.
+     */
+    std::vector< double > denseH( referenceH.size(), 0.0 );
+    for( CompressedHessianType::IndexType r = 0; r < H.GetNumberOfRows(); ++r )
+    {
+      for( CompressedHessianType::IndexType p = H.GetRowPointers()[ r ]; p < H.GetRowPointers()[ r + 1 ]; ++p )
+      {
+        const CompressedHessianType::IndexType c = H.GetColumnIndices()[ p ];
+        if( c < r || ( p > H.GetRowPointers()[ r ] && c <= H.GetColumnIndices()[ p - 1 ] ) )
+        {
+          std::cerr << "ERROR: the columns of row " << r << " are not sorted or below the diagonal." << std::endl;
+          return 1;
+        }
+        denseH[ r * numberOfParameters + c ] = H.GetValues()[ p ];
+      }
+    }
+    for( unsigned int k = 0; k < referenceH.size(); ++k )
+    {
+      if( std::abs( denseH[ k ] - referenceH[ k ] ) > 1e-10 * scale )
+      {
+        std::cerr << "ERROR: with " << numbersOfThreads[ t ] << " threads, SelfHessian element ("
+                  << k / numberOfParameters << "," << k % numberOfParameters << ") is " << denseH[ k ]
+                  << " instead of " << referenceH[ k ] << "." << std::endl;
+        return 1;
+      }
+    }
+
+    /** The result should not depend on the number of threads at all. */
+    if( t == 0 )
+    {
+      firstH = H;
+    }
+    else if( H.GetColumnIndices() != firstH.GetColumnIndices() || H.GetValues() != firstH.GetValues() )
+    {
+      std::cerr << "ERROR: the SelfHessian with " << numbersOfThreads[ t ]
+                << " threads differs from the one with a single thread." << std::endl;
+      return 1;
+    }
+  }
+
+  /** GetSelfHessian() should give the same elements in a vnl sparse matrix. */
+  HessianType sparseH;
+  metric->GetSelfHessian( parameters, sparseH );
+  for( CompressedHessianType::IndexType r = 0; r < firstH.GetNumberOfRows(); ++r )
+  {
+    for( CompressedHessianType::IndexType p = firstH.GetRowPointers()[ r ]; p < firstH.GetRowPointers()[ r + 1 ]; ++p )
+    {
+      if( sparseH( r, firstH.GetColumnIndices()[ p ] ) != firstH.GetValues()[ p ] )
+      {
+        std::cerr << "ERROR: GetSelfHessian() differs from GetCompressedSelfHessian()." << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  std::cout << "The SelfHessian has " << firstH.GetNumberOfNonZeros() << " stored elements." << std::endl;
+  return 0;
+
+} // end main
@@ -25,6 +25,8 @@
 #include "itkTimeProbe.h"
 #include "itkTimeProbesCollectorBase.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iomanip>
 
@@ -434,6 +436,16 @@ main( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  /** NonZeroJacobianIndices without the Jacobian. */
+  NonZeroJacobianIndicesType nzjiOnly, nzjiOnlyRecursive;
+  transform->GetNonZeroJacobianIndices( inputPoint, nzjiOnly );
+  recursiveTransform->GetNonZeroJacobianIndices( inputPoint, nzjiOnlyRecursive );
+  if( nzjiOnly != nzjiElastix || nzjiOnlyRecursive != nzjiRecursive )
+  {
+    std::cerr << "ERROR: B-spline GetNonZeroJacobianIndices() differs from the indices of GetJacobian()." << std::endl;
+    return EXIT_FAILURE;
+  }
+
   /** Spatial Jacobian. */
   transform->GetSpatialJacobian( inputPoint, sj );
   recursiveTransform->GetSpatialJacobian( inputPoint, sjRecursive );
@@ -498,6 +510,65 @@ main( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  /** Grid aligned weights: points on a lattice with a quarter of the grid
+   * spacing must give the same results with and without precomputed weights.
+   */
+  SpacingType latticeSpacing;
+  SizeType    latticeSize;
+  for( unsigned int j = 0; j < Dimension; ++j )
+  {
+    latticeSpacing[ j ] = gridSpacing[ j ] / 4.0;
+    latticeSize[ j ]    = 4 * ( gridSize[ j ] - 3 ) + 1;
+  }
+  std::vector< InputPointType > latticePointList( N );
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    itk::Vector< double, Dimension > k;
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      k[ j ] = latticeSpacing[ j ] * static_cast< unsigned int >(
+        mersenneTwister->GetUniformVariate( 8.0, 4.0 * ( gridSize[ j ] - 3 ) ) );
+    }
+    latticePointList[ i ] = gridOrigin + gridDirection * k;
+  }
+
+  std::vector< OutputPointType >     latticeOutput( N );
+  std::vector< SpatialHessianType >  latticeHessian( N );
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    latticeOutput[ i ] = recursiveTransform->TransformPoint( latticePointList[ i ] );
+    transform->GetSpatialHessian( latticePointList[ i ], latticeHessian[ i ] );
+  }
+
+  if( !recursiveTransform->SetGridAlignedSampleLattice( gridOrigin, latticeSpacing, gridDirection, latticeSize )
+    || !transform->SetGridAlignedSampleLattice( gridOrigin, latticeSpacing, gridDirection, latticeSize ) )
+  {
+    std::cerr << "ERROR: SetGridAlignedSampleLattice() did not detect the lattice." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  double latticeDifference = 0.0;
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    opp1 = recursiveTransform->TransformPoint( latticePointList[ i ] );
+    transform->GetSpatialHessian( latticePointList[ i ], sh );
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      latticeDifference = std::max( latticeDifference, std::abs( opp1[ j ] - latticeOutput[ i ][ j ] ) );
+      latticeDifference = std::max( latticeDifference,
+        ( sh[ j ] - latticeHessian[ i ][ j ] ).GetVnlMatrix().frobenius_norm() );
+    }
+  }
+  recursiveTransform->ClearGridAlignedSampleLattice();
+  transform->ClearGridAlignedSampleLattice();
+
+  std::cerr << "The grid aligned weights difference is " << latticeDifference << std::endl;
+  if( latticeDifference > 1e-10 )
+  {
+    std::cerr << "ERROR: Grid aligned weights give an incorrect result." << std::endl;
+    return EXIT_FAILURE;
+  }
+
   /** Exercise PrintSelf(). */
   std::cerr << std::endl;
   recursiveTransform->Print( std::cerr );
@@ -0,0 +1,200 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkAdvancedTransformToDisplacementFieldSource.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// Test that the row by row evaluation of a B-spline transform, combined with a
+// linear initial transform, gives the same displacement field as calling
+// TransformPoint() for each voxel. Both the AdvancedBSplineDeformableTransform and
+// the RecursiveBSplineTransform are tested, with composition and with addition of
+// the transforms, on an aligned grid, where every row should be evaluated along the
+// B-spline grid, and on a rotated grid, where no row should be.
+
+const unsigned int Dimension = 3;
+typedef double ScalarType;
+
+typedef itk::AdvancedMatrixOffsetTransformBase<
+  ScalarType, Dimension, Dimension >                AffineTransformType;
+typedef itk::AdvancedCombinationTransform<
+  ScalarType, Dimension >                           CombinationTransformType;
+typedef itk::Vector< float, Dimension >             VectorType;
+typedef itk::Image< VectorType, Dimension >         DeformationFieldType;
+typedef itk::AdvancedTransformToDisplacementFieldSource<
+  DeformationFieldType, ScalarType >                DeformationFieldSourceType;
+
+/** Compare the displacement field of a B-spline transform, combined with a
+ * linear initial transform, with TransformPoint().
+ */
+template< class TBSplineTransform >
+int
+TestDisplacementField( const bool useComposition, const char * name )
+{
+  /** Setup a B-spline transform on a grid with 8 mm spacing. */
+  typename TBSplineTransform::Pointer       bspline = TBSplineTransform::New();
+  typename TBSplineTransform::OriginType    gridOrigin;
+  typename TBSplineTransform::SpacingType   gridSpacing;
+  typename TBSplineTransform::RegionType    gridRegion;
+  typename TBSplineTransform::SizeType      gridSize;
+  typename TBSplineTransform::DirectionType gridDirection;
+  gridOrigin.Fill( -16.0 );
+  gridSpacing.Fill( 8.0 );
+  gridSize.Fill( 10 );
+  gridRegion.SetSize( gridSize );
+  gridDirection.SetIdentity();
+  bspline->SetGridOrigin( gridOrigin );
+  bspline->SetGridSpacing( gridSpacing );
+  bspline->SetGridRegion( gridRegion );
+  bspline->SetGridDirection( gridDirection );
+
+  typename TBSplineTransform::ParametersType parameters( bspline->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 2.0 * std::sin( 0.37 * i );
+  }
+  bspline->SetParameters( parameters );
+
+  /** Setup a linear initial transform, which scales along the axes. */
+  AffineTransformType::Pointer          affine = AffineTransformType::New();
+  AffineTransformType::MatrixType       matrix;
+  AffineTransformType::OutputVectorType offset;
+  matrix.SetIdentity();
+  matrix[ 0 ][ 0 ] = 1.1;
+  matrix[ 1 ][ 1 ] = 0.9;
+  offset[ 0 ] = 1.5;
+  offset[ 1 ] = -2.0;
+  offset[ 2 ] = 0.5;
+  affine->SetMatrix( matrix );
+  affine->SetOffset( offset );
+
+  CombinationTransformType::Pointer combination = CombinationTransformType::New();
+  combination->SetCurrentTransform( bspline );
+  combination->SetInitialTransform( affine );
+  combination->SetUseComposition( useComposition );
+
+  /** Compare on an aligned and on a rotated output grid. */
+  for( unsigned int test = 0; test < 2; ++test )
+  {
+    DeformationFieldSourceType::SizeType      size;
+    DeformationFieldSourceType::SpacingType   spacing;
+    DeformationFieldSourceType::OriginType    origin;
+    DeformationFieldSourceType::DirectionType direction;
+    size.Fill( 40 );
+    spacing.Fill( 1.25 );
+    origin.Fill( -5.0 );
+    direction.SetIdentity();
+    if( test == 1 )
+    {
+      const double angle = 0.2;
+      direction[ 0 ][ 0 ] = std::cos( angle );
+      direction[ 0 ][ 1 ] = -std::sin( angle );
+      direction[ 1 ][ 0 ] = std::sin( angle );
+      direction[ 1 ][ 1 ] = std::cos( angle );
+    }
+
+    DeformationFieldSourceType::Pointer source = DeformationFieldSourceType::New();
+    source->SetTransform( combination.GetPointer() );
+    source->SetOutputSize( size );
+    source->SetOutputSpacing( spacing );
+    source->SetOutputOrigin( origin );
+    source->SetOutputDirection( direction );
+
+    try
+    {
+      source->Update();
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << excp << std::endl;
+      return 1;
+    }
+
+    DeformationFieldType::Pointer field = source->GetOutput();
+    typedef itk::ImageRegionConstIteratorWithIndex< DeformationFieldType > IteratorType;
+    IteratorType it( field, field->GetLargestPossibleRegion() );
+    double       maximumDifference = 0.0;
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+      CombinationTransformType::InputPointType point;
+      field->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+      const CombinationTransformType::OutputPointType transformedPoint
+        = combination->TransformPoint( point );
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        maximumDifference = std::max( maximumDifference,
+          std::abs( ( transformedPoint[ i ] - point[ i ] ) - it.Get()[ i ] ) );
+      }
+    }
+
+    const itk::SizeValueType numberOfRows  = size[ 1 ] * size[ 2 ];
+    const itk::SizeValueType expectedRows  = test == 0 ? numberOfRows : 0;
+    std::cerr << name << ( useComposition ? ", composition" : ", addition" )
+              << ( test == 0 ? ", aligned" : ", rotated" ) << " grid: "
+              << source->GetNumberOfRowsAlongGrid() << " of " << numberOfRows
+              << " rows along the B-spline grid, maximum difference with TransformPoint() "
+              << maximumDifference << std::endl;
+
+    /** Allow for the rounding of the displacements to float. */
+    if( maximumDifference > 1e-4 )
+    {
+      std::cerr << "ERROR: the displacement field differs from TransformPoint()." << std::endl;
+      return 1;
+    }
+    if( source->GetNumberOfRowsAlongGrid() != expectedRows )
+    {
+      std::cerr << "ERROR: expected " << expectedRows
+                << " rows to be evaluated along the B-spline grid." << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+
+} // end TestDisplacementField()
+
+
+int
+main( int argc, char * argv[] )
+{
+  typedef itk::AdvancedBSplineDeformableTransform< ScalarType, Dimension, 3 > BSplineTransformType;
+  typedef itk::RecursiveBSplineTransform< ScalarType, Dimension, 3 >          RecursiveBSplineTransformType;
+
+  for( unsigned int c = 0; c < 2; ++c )
+  {
+    const bool useComposition = c == 0;
+    if( TestDisplacementField< BSplineTransformType >(
+      useComposition, "AdvancedBSplineDeformableTransform" ) != 0
+      || TestDisplacementField< RecursiveBSplineTransformType >(
+      useComposition, "RecursiveBSplineTransform" ) != 0 )
+    {
+      return 1;
+    }
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
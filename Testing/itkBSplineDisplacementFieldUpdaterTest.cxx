@@ -0,0 +1,215 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "BSplineDeformableTransformWithDiffusion/itkBSplineDisplacementFieldUpdater.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// Test that the incremental update of a displacement field by the
+// BSplineDisplacementFieldUpdater equals a serial full recomputation for a
+// threshold of 0 or less, and that otherwise the updated field plus the
+// displacement of the remaining coefficients equals the full recomputation.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension = 2;
+  typedef double ScalarType;
+
+  typedef itk::AdvancedBSplineDeformableTransform<
+    ScalarType, Dimension, 3 >                                  TransformType;
+  typedef itk::Vector< float, Dimension >                       VectorType;
+  typedef itk::Image< VectorType, Dimension >                   VectorImageType;
+  typedef itk::BSplineDisplacementFieldUpdater<
+    TransformType, VectorImageType >                            UpdaterType;
+
+  /** A B-spline transform on a grid with 4 mm spacing, covering the
+   * 40 x 32 image with unit spacing. Most coefficients are zero; some are
+   * large, and some are small.
+   */
+  TransformType::Pointer       transform = TransformType::New();
+  TransformType::OriginType    gridOrigin;
+  TransformType::SpacingType   gridSpacing;
+  TransformType::RegionType    gridRegion;
+  TransformType::SizeType      gridSize;
+  TransformType::DirectionType gridDirection;
+  gridOrigin.Fill( -12.0 );
+  gridSpacing.Fill( 4.0 );
+  gridSize[ 0 ] = 16; gridSize[ 1 ] = 14;
+  gridRegion.SetSize( gridSize );
+  gridDirection.SetIdentity();
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridDirection( gridDirection );
+
+  const double                  smallCoefficient = 0.004;
+  TransformType::ParametersType parameters( transform->GetNumberOfParameters() );
+  parameters.Fill( 0.0 );
+  const unsigned int numberOfNodes = parameters.GetSize() / Dimension;
+  for( unsigned int n = 0; n < numberOfNodes; ++n )
+  {
+    if( n % 37 == 5 )
+    {
+      parameters[ n ] = 0.8; parameters[ n + numberOfNodes ] = -0.6;
+    }
+    else if( n % 23 == 7 )
+    {
+      parameters[ n + numberOfNodes ] = ( n % 2 == 0 ) ? smallCoefficient : -smallCoefficient;
+    }
+  }
+  transform->SetParameters( parameters );
+
+  /** The previous field. */
+  VectorImageType::SizeType    size;
+  VectorImageType::SpacingType spacing;
+  VectorImageType::PointType   origin;
+  size[ 0 ] = 40; size[ 1 ] = 32;
+  spacing.Fill( 1.0 );
+  origin.Fill( 0.0 );
+  VectorImageType::Pointer previous = VectorImageType::New();
+  previous->SetRegions( size );
+  previous->SetSpacing( spacing );
+  previous->SetOrigin( origin );
+  previous->Allocate();
+  itk::ImageRegionIterator< VectorImageType > it( previous, previous->GetBufferedRegion() );
+  for( unsigned int n = 0; !it.IsAtEnd(); ++it, ++n )
+  {
+    VectorType vector;
+    vector[ 0 ] = static_cast< float >( std::sin( 0.3 * n ) );
+    vector[ 1 ] = static_cast< float >( std::cos( 0.2 * n ) );
+    it.Set( vector );
+  }
+
+  /** The serial full recomputation: the previous field plus the displacement. */
+  VectorImageType::Pointer reference = VectorImageType::New();
+  reference->CopyInformation( previous );
+  reference->SetRegions( previous->GetBufferedRegion() );
+  reference->Allocate();
+  itk::ImageRegionConstIteratorWithIndex< VectorImageType > pit( previous, previous->GetBufferedRegion() );
+  itk::ImageRegionIterator< VectorImageType >               rit( reference, reference->GetBufferedRegion() );
+  for( ; !pit.IsAtEnd(); ++pit, ++rit )
+  {
+    TransformType::InputPointType point;
+    previous->TransformIndexToPhysicalPoint( pit.GetIndex(), point );
+    const TransformType::OutputPointType mapped = transform->TransformPoint( point );
+    VectorType                           vector = pit.Get();
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      vector[ i ] += mapped[ i ] - point[ i ];
+    }
+    rit.Set( vector );
+  }
+
+  /** Compare the incremental update with the reference, for thresholds of 0,
+   * of less than 0, and of more than the small coefficients.
+   */
+  const double        thresholds[ 3 ] = { 0.0, -1.0, 0.01 };
+  const itk::SizeValueType numberOfVoxels  = previous->GetBufferedRegion().GetNumberOfPixels();
+  itk::SizeValueType       numberOfRecomputedVoxels[ 3 ];
+  for( unsigned int t = 0; t < 3; ++t )
+  {
+    VectorImageType::Pointer output = VectorImageType::New();
+    output->CopyInformation( previous );
+    output->SetRegions( previous->GetBufferedRegion() );
+    output->Allocate();
+
+    UpdaterType::Pointer updater = UpdaterType::New();
+    updater->SetTransform( transform );
+    updater->SetThreshold( thresholds[ t ] );
+    numberOfRecomputedVoxels[ t ] = updater->ComputeUpdatedField( previous, output );
+
+    /** The coefficients that were not added should be carried over. */
+    const TransformType::ParametersType & remainingParameters = updater->GetRemainingParameters();
+    TransformType::Pointer remainingTransform = TransformType::New();
+    remainingTransform->SetGridOrigin( gridOrigin );
+    remainingTransform->SetGridSpacing( gridSpacing );
+    remainingTransform->SetGridRegion( gridRegion );
+    remainingTransform->SetGridDirection( gridDirection );
+    remainingTransform->SetParameters( remainingParameters );
+
+    unsigned int numberOfRemainingCoefficients = 0;
+    for( unsigned int j = 0; j < remainingParameters.GetSize(); ++j )
+    {
+      if( remainingParameters[ j ] != 0.0 )
+      {
+        ++numberOfRemainingCoefficients;
+        if( remainingParameters[ j ] != parameters[ j ] )
+        {
+          std::cerr << "ERROR: remaining coefficient " << j << " is " << remainingParameters[ j ]
+                    << " instead of " << parameters[ j ] << std::endl;
+          return 1;
+        }
+      }
+    }
+
+    double maximumDifference = 0.0;
+    itk::ImageRegionConstIteratorWithIndex< VectorImageType > oit( output, output->GetBufferedRegion() );
+    for( rit.GoToBegin(); !oit.IsAtEnd(); ++oit, ++rit )
+    {
+      TransformType::InputPointType point;
+      output->TransformIndexToPhysicalPoint( oit.GetIndex(), point );
+      const TransformType::OutputPointType mapped = remainingTransform->TransformPoint( point );
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        const double carried = oit.Get()[ i ] + ( mapped[ i ] - point[ i ] );
+        maximumDifference = std::max( maximumDifference,
+          std::abs( carried - static_cast< double >( rit.Get()[ i ] ) ) );
+      }
+    }
+
+    std::cerr << "Threshold " << thresholds[ t ] << ": recomputed "
+              << numberOfRecomputedVoxels[ t ] << " of " << numberOfVoxels
+              << " voxels, " << numberOfRemainingCoefficients
+              << " remaining coefficients, maximum difference " << maximumDifference << std::endl;
+
+    if( maximumDifference > 1e-5 )
+    {
+      std::cerr << "ERROR: the updated field plus the remaining coefficients differs "
+                << "from the full recomputation." << std::endl;
+      return 1;
+    }
+
+    /** Only a positive threshold leaves coefficients, namely the small ones. */
+    if( ( thresholds[ t ] <= 0.0 ) != ( numberOfRemainingCoefficients == 0 ) )
+    {
+      std::cerr << "ERROR: unexpected number of remaining coefficients." << std::endl;
+      return 1;
+    }
+  }
+
+  /** A threshold of 0 skips the voxels with only zero coefficients, a
+   * negative threshold skips nothing, and a larger threshold skips more.
+   */
+  if( !( numberOfRecomputedVoxels[ 2 ] < numberOfRecomputedVoxels[ 0 ]
+    && numberOfRecomputedVoxels[ 0 ] < numberOfRecomputedVoxels[ 1 ]
+    && numberOfRecomputedVoxels[ 1 ] == numberOfVoxels ) )
+  {
+    std::cerr << "ERROR: unexpected numbers of recomputed voxels." << std::endl;
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
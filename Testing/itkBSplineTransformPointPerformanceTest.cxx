@@ -16,14 +16,20 @@
  *
  *=========================================================================*/
 #include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
 
 #include "itkImageRegionIterator.h"
 
 // Report timings
 #include "itkTimeProbe.h"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iomanip>
+#include <vector>
 
 //-------------------------------------------------------------------------------------
 // Create a class that inherits from the B-spline transform,
@@ -298,6 +304,139 @@ main( int argc, char * argv[] )
   std::cerr << "Time NEW = " << newTime << " " << timeProbeNEW.GetUnit() << std::endl;
   std::cerr << "Speedup factor = " << oldTime / newTime << std::endl;
 
+  /** Compare the batched TransformPoints() with repeated TransformPoint()
+   * calls, for the recursive B-spline transform and an affine transform.
+   */
+  typedef itk::RecursiveBSplineTransform<
+    CoordinateRepresentationType, Dimension, SplineOrder >    RecursiveTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase<
+    CoordinateRepresentationType, Dimension, Dimension >      AffineTransformType;
+  typedef RecursiveTransformType::InputCoordinateArraysType  InputCoordinateArraysType;
+  typedef RecursiveTransformType::OutputCoordinateArraysType OutputCoordinateArraysType;
+  typedef RecursiveTransformType::ValidMaskValueType         ValidMaskValueType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator MersenneTwisterType;
+
+  RecursiveTransformType::Pointer recursiveTransform = RecursiveTransformType::New();
+  recursiveTransform->SetGridOrigin( gridOrigin );
+  recursiveTransform->SetGridSpacing( gridSpacing );
+  recursiveTransform->SetGridRegion( gridRegion );
+  recursiveTransform->SetGridDirection( gridDirection );
+  recursiveTransform->SetParameters( parameters );
+
+  AffineTransformType::Pointer affineTransform = AffineTransformType::New();
+  AffineTransformType::ParametersType affineParameters( affineTransform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < affineParameters.GetSize(); ++i )
+  {
+    affineParameters[ i ] = 0.01 * i + ( ( i % ( Dimension + 1 ) ) == 0 ? 1.0 : 0.0 );
+  }
+  affineTransform->SetParameters( affineParameters );
+
+  /** Generate random points in the grid, some of them outside the valid region. */
+  MersenneTwisterType::Pointer mersenneTwister = MersenneTwisterType::New();
+  mersenneTwister->Initialize( 140377 );
+  std::vector< InputPointType > pointList( N );
+  std::vector< CoordinateRepresentationType > inputBuffer( Dimension * N );
+  std::vector< CoordinateRepresentationType > outputBuffer( Dimension * N );
+  std::vector< ValidMaskValueType >           validMask( N );
+  InputCoordinateArraysType                   inputCoordinates;
+  OutputCoordinateArraysType                  outputCoordinates;
+  for( unsigned int j = 0; j < Dimension; ++j )
+  {
+    inputCoordinates[ j ]  = &inputBuffer[ j * N ];
+    outputCoordinates[ j ] = &outputBuffer[ j * N ];
+  }
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      pointList[ i ][ j ] = gridOrigin[ j ]
+        + gridSpacing[ j ] * mersenneTwister->GetUniformVariate( 0.0, gridSize[ j ] - 1.0 );
+      inputBuffer[ j * N + i ] = pointList[ i ][ j ];
+    }
+  }
+
+  itk::TimeProbe timeProbeSingle, timeProbeBatch, timeProbeAffineSingle, timeProbeAffineBatch;
+  std::vector< OutputPointType > singleOutput( N );
+
+  timeProbeSingle.Start();
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    singleOutput[ i ] = recursiveTransform->TransformPoint( pointList[ i ] );
+  }
+  timeProbeSingle.Stop();
+
+  timeProbeBatch.Start();
+  recursiveTransform->TransformPoints( inputCoordinates, outputCoordinates, N, &validMask[ 0 ] );
+  timeProbeBatch.Stop();
+
+  double       maxError = 0.0;
+  unsigned int numberOfValidPoints = 0;
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      maxError = std::max( maxError, std::abs( outputBuffer[ j * N + i ] - singleOutput[ i ][ j ] ) );
+    }
+    numberOfValidPoints += validMask[ i ];
+  }
+  std::cerr << "Batched B-spline: " << numberOfValidPoints << " of " << N
+            << " points valid, max error = " << maxError << std::endl;
+  if( maxError > 1e-10 || numberOfValidPoints == 0 || numberOfValidPoints == N )
+  {
+    std::cerr << "ERROR: batched B-spline TransformPoints() differs from TransformPoint()." << std::endl;
+    return 1;
+  }
+
+  /** The default TransformPoints() of the B-spline transform, which calls
+   * TransformPoint() and IsDefinedAt() per point, gives the same valid mask.
+   */
+  std::vector< ValidMaskValueType > defaultValidMask( N );
+  transform->TransformPoints( inputCoordinates, outputCoordinates, N, &defaultValidMask[ 0 ] );
+  unsigned int numberOfMaskDifferences = 0;
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    numberOfMaskDifferences += defaultValidMask[ i ] != validMask[ i ];
+  }
+  if( numberOfMaskDifferences > 0 )
+  {
+    std::cerr << "ERROR: the default TransformPoints() reports a different valid mask in "
+              << numberOfMaskDifferences << " points." << std::endl;
+    return 1;
+  }
+
+  timeProbeAffineSingle.Start();
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    singleOutput[ i ] = affineTransform->TransformPoint( pointList[ i ] );
+  }
+  timeProbeAffineSingle.Stop();
+
+  timeProbeAffineBatch.Start();
+  affineTransform->TransformPoints( inputCoordinates, outputCoordinates, N, &validMask[ 0 ] );
+  timeProbeAffineBatch.Stop();
+
+  maxError = 0.0;
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      maxError = std::max( maxError, std::abs( outputBuffer[ j * N + i ] - singleOutput[ i ][ j ] ) );
+    }
+  }
+  std::cerr << "Batched affine: max error = " << maxError << std::endl;
+  if( maxError > 1e-10 )
+  {
+    std::cerr << "ERROR: batched affine TransformPoints() differs from TransformPoint()." << std::endl;
+    return 1;
+  }
+
+  std::cerr << "Time B-spline single = " << timeProbeSingle.GetMean() << " " << timeProbeSingle.GetUnit() << std::endl;
+  std::cerr << "Time B-spline batch  = " << timeProbeBatch.GetMean() << " " << timeProbeBatch.GetUnit() << std::endl;
+  std::cerr << "Speedup factor = " << timeProbeSingle.GetMean() / timeProbeBatch.GetMean() << std::endl;
+  std::cerr << "Time affine single = " << timeProbeAffineSingle.GetMean() << " " << timeProbeAffineSingle.GetUnit() << std::endl;
+  std::cerr << "Time affine batch  = " << timeProbeAffineBatch.GetMean() << " " << timeProbeAffineBatch.GetUnit() << std::endl;
+  std::cerr << "Speedup factor = " << timeProbeAffineSingle.GetMean() / timeProbeAffineBatch.GetMean() << std::endl;
+
   /** Return a value. */
   return 0;
 
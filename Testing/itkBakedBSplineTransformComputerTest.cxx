@@ -0,0 +1,246 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkBakedBSplineTransformComputer.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Test that a combination transform with a baked initial transform approximates
+// the combination with the exact initial transform inside the baked image domain,
+// equals it outside that domain, and that the reported errors are correct.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension = 2;
+  typedef double ScalarType;
+
+  typedef itk::AdvancedBSplineDeformableTransform<
+    ScalarType, Dimension, 3 >                                  BSplineTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase<
+    ScalarType, Dimension, Dimension >                          AffineTransformType;
+  typedef itk::AdvancedCombinationTransform< ScalarType, Dimension > CombinationTransformType;
+  typedef CombinationTransformType::InputPointType              PointType;
+  typedef CombinationTransformType::SpatialJacobianType         SpatialJacobianType;
+  typedef itk::BakedBSplineTransformComputer< ScalarType, Dimension > ComputerType;
+
+  /** A smooth B-spline transform with displacements of at most 3 mm, on a
+   * grid with 8 mm spacing that covers [-40, 104) x [-40, 104).
+   */
+  BSplineTransformType::Pointer bspline = BSplineTransformType::New();
+  BSplineTransformType::OriginType    gridOrigin;
+  BSplineTransformType::SpacingType   gridSpacing;
+  BSplineTransformType::RegionType    gridRegion;
+  BSplineTransformType::SizeType      gridSize;
+  BSplineTransformType::DirectionType gridDirection;
+  gridOrigin.Fill( -40.0 );
+  gridSpacing.Fill( 8.0 );
+  gridSize.Fill( 18 );
+  gridRegion.SetSize( gridSize );
+  gridDirection.SetIdentity();
+  bspline->SetGridOrigin( gridOrigin );
+  bspline->SetGridSpacing( gridSpacing );
+  bspline->SetGridRegion( gridRegion );
+  bspline->SetGridDirection( gridDirection );
+
+  BSplineTransformType::ParametersType parameters( bspline->GetNumberOfParameters() );
+  const unsigned int                   numberOfNodes = parameters.GetSize() / Dimension;
+  for( unsigned int n = 0; n < numberOfNodes; ++n )
+  {
+    const double x = static_cast< double >( n % gridSize[ 0 ] );
+    const double y = static_cast< double >( n / gridSize[ 0 ] );
+    parameters[ n ]                 = 3.0 * std::sin( 0.7 * x ) * std::cos( 0.4 * y );
+    parameters[ n + numberOfNodes ] = 3.0 * std::cos( 0.5 * x + 0.3 * y );
+  }
+  bspline->SetParameters( parameters );
+
+  /** The current transform: a small rotation and translation. */
+  AffineTransformType::Pointer affine = AffineTransformType::New();
+  AffineTransformType::MatrixType matrix;
+  AffineTransformType::OutputVectorType offset;
+  const double angle = 0.1;
+  matrix( 0, 0 ) = std::cos( angle ); matrix( 0, 1 ) = -std::sin( angle );
+  matrix( 1, 0 ) = std::sin( angle ); matrix( 1, 1 ) = std::cos( angle );
+  offset[ 0 ] = 2.0; offset[ 1 ] = -1.5;
+  affine->SetMatrix( matrix );
+  affine->SetOffset( offset );
+
+  /** Bake the B-spline transform on a 64 x 64 image with unit spacing and a
+   * grid spacing of 2 voxels.
+   */
+  ComputerType::OriginType    imageOrigin;
+  ComputerType::SpacingType   imageSpacing;
+  ComputerType::DirectionType imageDirection;
+  ComputerType::SizeType      imageSize;
+  ComputerType::RegionType    imageRegion;
+  ComputerType::SpacingType   bakedGridSpacing;
+  imageOrigin.Fill( 0.0 );
+  imageSpacing.Fill( 1.0 );
+  imageDirection.SetIdentity();
+  imageSize.Fill( 64 );
+  imageRegion.SetSize( imageSize );
+  bakedGridSpacing.Fill( 2.0 );
+
+  ComputerType::Pointer computer = ComputerType::New();
+  computer->SetTransform( bspline );
+  computer->SetImageOrigin( imageOrigin );
+  computer->SetImageSpacing( imageSpacing );
+  computer->SetImageDirection( imageDirection );
+  computer->SetImageRegion( imageRegion );
+  computer->SetGridSpacing( bakedGridSpacing );
+  try
+  {
+    computer->Compute();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  /** The exact and the baked combination. */
+  CombinationTransformType::Pointer exact = CombinationTransformType::New();
+  exact->SetUseComposition( true );
+  exact->SetInitialTransform( bspline );
+  exact->SetCurrentTransform( affine );
+
+  CombinationTransformType::Pointer baked = CombinationTransformType::New();
+  baked->SetUseComposition( true );
+  baked->SetInitialTransform( bspline );
+  baked->SetCurrentTransform( affine );
+  baked->SetBakedInitialTransform( computer->GetModifiableOutput(),
+    computer->GetModifiableImageDomain() );
+
+  /** Compare both on a grid of points with a non-integer spacing, which
+   * covers the image domain and a border of 16 mm around it.
+   */
+  std::vector< PointType > points;
+  std::vector< bool >      inside;
+  for( double y = -16.0; y <= 79.0; y += 0.7 )
+  {
+    for( double x = -16.0; x <= 79.0; x += 0.7 )
+    {
+      PointType p;
+      p[ 0 ] = x; p[ 1 ] = y;
+      points.push_back( p );
+      inside.push_back( x >= -0.5 && x <= 63.5 && y >= -0.5 && y <= 63.5 );
+    }
+  }
+
+  double maximumInsideError  = 0.0;
+  double maximumOutsideError = 0.0;
+  for( std::size_t n = 0; n < points.size(); ++n )
+  {
+    const double error = exact->TransformPoint( points[ n ] ).EuclideanDistanceTo(
+      baked->TransformPoint( points[ n ] ) );
+    if( inside[ n ] )
+    {
+      maximumInsideError = std::max( maximumInsideError, error );
+    }
+    else
+    {
+      SpatialJacobianType sjExact;
+      SpatialJacobianType sjBaked;
+      exact->GetSpatialJacobian( points[ n ], sjExact );
+      baked->GetSpatialJacobian( points[ n ], sjBaked );
+      maximumOutsideError = std::max( maximumOutsideError, error );
+      maximumOutsideError = std::max( maximumOutsideError,
+        ( sjExact - sjBaked ).GetVnlMatrix().absolute_value_max() );
+    }
+  }
+
+  std::cerr << "Reported maximum error: " << computer->GetMaximumError() << "\n"
+            << "Reported RMS error: " << computer->GetRMSError() << "\n"
+            << "Number of error samples: " << computer->GetNumberOfErrorSamples() << "\n"
+            << "Maximum error inside the domain: " << maximumInsideError << "\n"
+            << "Maximum error outside the domain: " << maximumOutsideError << std::endl;
+
+  /** Inside the domain the error is small; the rotation preserves distances. */
+  if( maximumInsideError > 0.05 )
+  {
+    std::cerr << "ERROR: the baked transform does not approximate the exact one." << std::endl;
+    return 1;
+  }
+
+  /** Outside the domain the exact initial transform is used. */
+  if( maximumOutsideError > 1e-10 )
+  {
+    std::cerr << "ERROR: the baked transform is used outside its domain." << std::endl;
+    return 1;
+  }
+
+  /** The reported errors are measured at the cell centres inside the image,
+   * where the error of an interpolating B-spline is largest.
+   */
+  if( computer->GetNumberOfErrorSamples() == 0
+    || computer->GetRMSError() > computer->GetMaximumError()
+    || computer->GetMaximumError() <= 0.0
+    || computer->GetMaximumError() > 0.05 )
+  {
+    std::cerr << "ERROR: the reported errors are not consistent." << std::endl;
+    return 1;
+  }
+
+  /** The batched evaluation equals the pointwise evaluation, on both sides
+   * of the domain boundary.
+   */
+  const std::size_t         numberOfPoints = points.size();
+  std::vector< ScalarType > input[ Dimension ];
+  std::vector< ScalarType > output[ Dimension ];
+  CombinationTransformType::InputCoordinateArraysType  inputArrays;
+  CombinationTransformType::OutputCoordinateArraysType outputArrays;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    input[ d ].resize( numberOfPoints );
+    output[ d ].resize( numberOfPoints );
+    for( std::size_t n = 0; n < numberOfPoints; ++n )
+    {
+      input[ d ][ n ] = points[ n ][ d ];
+    }
+    inputArrays[ d ]  = &input[ d ][ 0 ];
+    outputArrays[ d ] = &output[ d ][ 0 ];
+  }
+  std::vector< CombinationTransformType::ValidMaskValueType > mask( numberOfPoints );
+  baked->TransformPoints( inputArrays, outputArrays, numberOfPoints, &mask[ 0 ] );
+
+  double maximumBatchError = 0.0;
+  for( std::size_t n = 0; n < numberOfPoints; ++n )
+  {
+    const CombinationTransformType::OutputPointType p = baked->TransformPoint( points[ n ] );
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      maximumBatchError = std::max( maximumBatchError, std::abs( p[ d ] - output[ d ][ n ] ) );
+    }
+  }
+  if( maximumBatchError > 1e-10 )
+  {
+    std::cerr << "ERROR: TransformPoints differs from TransformPoint by "
+              << maximumBatchError << std::endl;
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
@@ -27,6 +27,7 @@
 #include "itkAdvancedBSplineDeformableTransform.h"
 #include "itkAdvancedCombinationTransform.h"
 
+#include <cmath>
 #include <iomanip>
 
 //-------------------------------------------------------------------------------------
@@ -229,6 +230,83 @@ main( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  // Checks for CollapseLinearInitialTransform: a nonlinear chain is not collapsed
+  if( advancedComposite->CollapseLinearInitialTransform()
+    || advancedComposite->GetCollapsedInitialTransform() != 0 )
+  {
+    std::cerr << "Error: a nonlinear initial transform should not be collapsed." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Define a linear chain: affine( translation( affine( x ) ) )
+  AdvancedAffineTransformType::Pointer      linearAffine0      = AdvancedAffineTransformType::New();
+  AdvancedTranslationTransformType::Pointer linearTranslation1 = AdvancedTranslationTransformType::New();
+  AdvancedAffineTransformType::Pointer      linearAffine2      = AdvancedAffineTransformType::New();
+
+  AdvancedAffineTransformType::ParametersType affineParameters( linearAffine0->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < affineParameters.GetSize(); ++i )
+  {
+    affineParameters[ i ] = ( i % ( Dimension + 1 ) == 0 ? 1.0 : 0.0 ) + 0.05 * ( i + 1 );
+  }
+  linearAffine0->SetParameters( affineParameters );
+  affineParameters[ 1 ] = -0.1;
+  linearAffine2->SetParameters( affineParameters );
+  AdvancedTranslationTransformType::ParametersType translationParameters( Dimension );
+  translationParameters[ 0 ] = 3.0; translationParameters[ 1 ] = -2.0; translationParameters[ 2 ] = 1.5;
+  linearTranslation1->SetParameters( translationParameters );
+
+  AdvancedCombinationTransformType::Pointer linearComposite0 = AdvancedCombinationTransformType::New();
+  AdvancedCombinationTransformType::Pointer linearComposite1 = AdvancedCombinationTransformType::New();
+  AdvancedCombinationTransformType::Pointer linearComposite2 = AdvancedCombinationTransformType::New();
+  linearComposite0->SetCurrentTransform( linearAffine0 );
+  linearComposite1->SetCurrentTransform( linearTranslation1 );
+  linearComposite1->SetInitialTransform( linearComposite0 );
+  linearComposite2->SetCurrentTransform( linearAffine2 );
+  linearComposite2->SetInitialTransform( linearComposite1 );
+
+  AdvancedCombinationTransformType::InputPointType point;
+  point[ 0 ] = 10.0; point[ 1 ] = -4.0; point[ 2 ] = 7.5;
+  const AdvancedCombinationTransformType::OutputPointType chained
+    = linearComposite2->TransformPoint( point );
+  AdvancedCombinationTransformType::JacobianType               chainedJacobian;
+  AdvancedCombinationTransformType::NonZeroJacobianIndicesType nzji;
+  linearComposite2->GetJacobian( point, chainedJacobian, nzji );
+
+  if( !linearComposite2->CollapseLinearInitialTransform()
+    || linearComposite2->GetCollapsedInitialTransform() == 0
+    || linearComposite2->GetNumberOfTransforms() != 3 )
+  {
+    std::cerr << "Error: the linear initial transform should be collapsed." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const AdvancedCombinationTransformType::OutputPointType collapsed
+    = linearComposite2->TransformPoint( point );
+  AdvancedCombinationTransformType::JacobianType collapsedJacobian;
+  linearComposite2->GetJacobian( point, collapsedJacobian, nzji );
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    if( std::abs( chained[ i ] - collapsed[ i ] ) > 1e-4 )
+    {
+      std::cerr << "Error: the collapsed initial transform maps " << point
+                << " to " << collapsed << " instead of " << chained << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if( ( chainedJacobian - collapsedJacobian ).absolute_value_max() > 1e-4 )
+  {
+    std::cerr << "Error: the collapsed initial transform changes the Jacobian." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Setting a new initial transform discards the collapsed transform
+  linearComposite2->SetInitialTransform( linearComposite0 );
+  if( linearComposite2->GetCollapsedInitialTransform() != 0 )
+  {
+    std::cerr << "Error: the collapsed initial transform should be discarded." << std::endl;
+    return EXIT_FAILURE;
+  }
+
   /** Return a value. */
   return EXIT_SUCCESS;
 } // end main
@@ -0,0 +1,208 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "DeformationFieldTransform/itkDeformationFieldInterpolatingTransform.h"
+
+#include "itkVectorLinearInterpolateImageFunction.h"
+#include "itkImageRegionIterator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Test that the linear interpolation kernel of the DeformationFieldInterpolatingTransform
+// gives the same result as the VectorLinearInterpolateImageFunction, inside the
+// deformation field, at its borders, and outside it.
+
+template< unsigned int Dimension >
+int
+TestLinearInterpolationKernel( void )
+{
+  typedef double ScalarType;
+  typedef itk::DeformationFieldInterpolatingTransform<
+    ScalarType, Dimension, float >                            TransformType;
+  typedef typename TransformType::DeformationFieldType        DeformationFieldType;
+  typedef typename TransformType::DeformationFieldVectorType  VectorType;
+  typedef typename TransformType::InputPointType              PointType;
+  typedef itk::VectorLinearInterpolateImageFunction<
+    DeformationFieldType, ScalarType >                        InterpolatorType;
+  typedef typename InterpolatorType::ContinuousIndexType      ContinuousIndexType;
+
+  /** A deformation field with an anisotropic spacing, an oblique direction
+   * and a buffered region that does not start at index 0.
+   */
+  typename DeformationFieldType::RegionType    region;
+  typename DeformationFieldType::SpacingType   spacing;
+  typename DeformationFieldType::PointType     origin;
+  typename DeformationFieldType::DirectionType direction;
+  direction.SetIdentity();
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    region.SetIndex( i, 2 - 3 * static_cast< int >( i ) );
+    region.SetSize( i, 6 - i );
+    spacing[ i ] = 0.5 + 0.75 * i;
+    origin[ i ]  = 1.0 - 2.5 * i;
+  }
+  const double angle = 0.3;
+  direction[ 0 ][ 0 ] = std::cos( angle ); direction[ 0 ][ 1 ] = -std::sin( angle );
+  direction[ 1 ][ 0 ] = std::sin( angle ); direction[ 1 ][ 1 ] = std::cos( angle );
+
+  typename DeformationFieldType::Pointer field = DeformationFieldType::New();
+  field->SetRegions( region );
+  field->SetSpacing( spacing );
+  field->SetOrigin( origin );
+  field->SetDirection( direction );
+  field->Allocate();
+  itk::ImageRegionIterator< DeformationFieldType > it( field, region );
+  for( unsigned int n = 0; !it.IsAtEnd(); ++it, ++n )
+  {
+    VectorType vector;
+    for( unsigned int k = 0; k < Dimension; ++k )
+    {
+      vector[ k ] = static_cast< float >( 2.0 * std::sin( 1.3 * n + 0.7 * k ) );
+    }
+    it.Set( vector );
+  }
+
+  typename TransformType::Pointer transform = TransformType::New();
+  transform->SetDeformationFieldInterpolator( InterpolatorType::New() );
+  transform->SetDeformationField( field );
+
+  /** The reference: a separate interpolator. */
+  typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetInputImage( field );
+
+  /** Continuous indices relative to the start of the buffered region: outside,
+   * just inside and on the borders, and in between the voxels.
+   */
+  std::vector< std::vector< double > > indices( Dimension );
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    const double size   = static_cast< double >( region.GetSize( i ) );
+    const double list[] = { -0.75, -0.5 + 1e-7, -0.3, 0.0, 0.6, 1.0, 2.25,
+                            size - 1.0, size - 0.8, size - 0.5 - 1e-7, size - 0.2 };
+    indices[ i ].assign( list, list + sizeof( list ) / sizeof( double ) );
+  }
+
+  std::vector< PointType > points;
+  std::vector< bool >      inside;
+  std::vector< PointType > expected;
+  std::vector< unsigned int > counter( Dimension, 0 );
+  while( counter[ Dimension - 1 ] < indices[ Dimension - 1 ].size() )
+  {
+    ContinuousIndexType cindex;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      cindex[ i ] = region.GetIndex( i ) + indices[ i ][ counter[ i ] ];
+    }
+    PointType point;
+    field->TransformContinuousIndexToPhysicalPoint( cindex, point );
+
+    /** Same as the transform does with a general interpolator. */
+    ContinuousIndexType recomputed;
+    interpolator->ConvertPointToContinuousIndex( point, recomputed );
+    PointType expectedPoint = point;
+    const bool isInside = interpolator->IsInsideBuffer( recomputed );
+    if( isInside )
+    {
+      const typename InterpolatorType::OutputType displacement
+        = interpolator->EvaluateAtContinuousIndex( recomputed );
+      for( unsigned int k = 0; k < Dimension; ++k )
+      {
+        expectedPoint[ k ] += displacement[ k ];
+      }
+    }
+    points.push_back( point );
+    inside.push_back( isInside );
+    expected.push_back( expectedPoint );
+
+    /** Next combination. */
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      if( ++counter[ i ] < indices[ i ].size() || i == Dimension - 1 )
+      {
+        break;
+      }
+      counter[ i ] = 0;
+    }
+  }
+
+  /** Compare TransformPoint and TransformPoints with the reference. */
+  const std::size_t N = points.size();
+  std::vector< ScalarType > inputs( Dimension * N );
+  std::vector< ScalarType > outputs( Dimension * N );
+  std::vector< unsigned char > mask( N );
+  typename TransformType::InputCoordinateArraysType  inputArrays;
+  typename TransformType::OutputCoordinateArraysType outputArrays;
+  for( unsigned int k = 0; k < Dimension; ++k )
+  {
+    inputArrays[ k ]  = &inputs[ k * N ];
+    outputArrays[ k ] = &outputs[ k * N ];
+    for( std::size_t n = 0; n < N; ++n )
+    {
+      inputs[ k * N + n ] = points[ n ][ k ];
+    }
+  }
+  transform->TransformPoints( inputArrays, outputArrays, N, &mask[ 0 ] );
+
+  unsigned int numberOfInside = 0;
+  for( std::size_t n = 0; n < N; ++n )
+  {
+    const PointType result = transform->TransformPoint( points[ n ] );
+    double          maximumDifference = 0.0;
+    for( unsigned int k = 0; k < Dimension; ++k )
+    {
+      maximumDifference = std::max( maximumDifference, std::abs( result[ k ] - expected[ n ][ k ] ) );
+      maximumDifference = std::max( maximumDifference, std::abs( outputs[ k * N + n ] - expected[ n ][ k ] ) );
+    }
+    if( maximumDifference > 1e-10 || ( mask[ n ] != 0 ) != inside[ n ] )
+    {
+      std::cerr << "ERROR: the linear kernel differs from the interpolator in " << Dimension
+                << "D at " << points[ n ] << ": " << result << " instead of " << expected[ n ]
+                << ", valid " << static_cast< int >( mask[ n ] ) << " instead of " << inside[ n ] << std::endl;
+      return EXIT_FAILURE;
+    }
+    numberOfInside += inside[ n ] ? 1 : 0;
+  }
+
+  /** Both the inside and the outside have been tested. */
+  if( numberOfInside == 0 || numberOfInside == N )
+  {
+    std::cerr << "ERROR: the test points are not both inside and outside the field." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+
+} // end TestLinearInterpolationKernel()
+
+
+int
+main( int argc, char * argv[] )
+{
+  if( TestLinearInterpolationKernel< 2 >() != EXIT_SUCCESS
+    || TestLinearInterpolationKernel< 3 >() != EXIT_SUCCESS )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,262 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "DistancePreservingRigidityPenalty/itkDistancePreservingRigidityPenaltyTerm.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Test the DistancePreservingRigidityPenaltyTerm, which precomputes the pairs of
+// neighbouring penalty grid points. The value is compared with a direct evaluation
+// that visits the 26-neighbourhood of every penalty grid point, like the penalty term
+// did before the pairs were precomputed. The derivative is compared with central
+// differences, and the results should not depend on multi-threading.
+
+const unsigned int Dimension = 3;
+
+typedef itk::Image< short, Dimension >                                      ImageType;
+typedef itk::DistancePreservingRigidityPenaltyTerm< ImageType, double >     MetricType;
+typedef MetricType::SegmentedImageType                                      SegmentedImageType;
+typedef MetricType::MeasureType                                             MeasureType;
+typedef MetricType::DerivativeType                                          DerivativeType;
+typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 >     TransformType;
+typedef TransformType::ParametersType                                       ParametersType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator              RandomGeneratorType;
+
+/** The penalty term evaluated directly on the neighbourhoods of the penalty grid. */
+double
+ComputeReferenceValue( const SegmentedImageType * segmentation, const TransformType * transform )
+{
+  typedef itk::ImageRegionConstIteratorWithIndex< SegmentedImageType > IteratorType;
+  const SegmentedImageType::RegionType region = segmentation->GetBufferedRegion();
+
+  unsigned int numberOfRigidGrids = 0;
+  IteratorType it( segmentation, region );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    if( it.Get() > 0 ) { ++numberOfRigidGrids; }
+  }
+
+  double value = 0.0;
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const short label = it.Get();
+    if( label <= 0 || label >= 6 ) { continue; }
+
+    const SegmentedImageType::IndexType index = it.GetIndex();
+    std::vector< SegmentedImageType::IndexType > neighbors;
+    for( unsigned int kk = 0; kk < 27; ++kk )
+    {
+      SegmentedImageType::IndexType neighbor = index;
+      neighbor[ 0 ] += static_cast< long >( kk % 3 ) - 1;
+      neighbor[ 1 ] += static_cast< long >( ( kk / 3 ) % 3 ) - 1;
+      neighbor[ 2 ] += static_cast< long >( kk / 9 ) - 1;
+      if( region.IsInside( neighbor ) && segmentation->GetPixel( neighbor ) == label )
+      {
+        neighbors.push_back( neighbor );
+      }
+    }
+    if( neighbors.size() < 2 ) { continue; }
+
+    SegmentedImageType::PointType point, neighborPoint;
+    segmentation->TransformIndexToPhysicalPoint( index, point );
+    const TransformType::OutputPointType xf = transform->TransformPoint( point );
+    for( std::size_t kk = 0; kk < neighbors.size(); ++kk )
+    {
+      segmentation->TransformIndexToPhysicalPoint( neighbors[ kk ], neighborPoint );
+      const TransformType::OutputPointType xn = transform->TransformPoint( neighborPoint );
+      const double dX = point.SquaredEuclideanDistanceTo( neighborPoint );
+      const double dx = xf.SquaredEuclideanDistanceTo( xn );
+      value += ( dx - dX ) * ( dx - dX ) / neighbors.size() / numberOfRigidGrids;
+    }
+  }
+
+  return value;
+
+} // end ComputeReferenceValue()
+
+
+int
+main( int argc, char * argv[] )
+{
+  RandomGeneratorType::GetInstance()->Initialize( 1234 );
+
+  /** The fixed and moving image. */
+  ImageType::Pointer  image = ImageType::New();
+  ImageType::SizeType imageSize;
+  imageSize.Fill( 12 );
+  image->SetRegions( imageSize );
+  image->Allocate();
+  image->FillBuffer( 0 );
+
+  /** The penalty grid, with two rigid regions and an isolated rigid point,
+   * which does not contribute to the penalty term, but does count as a
+   * rigid point. The regions do not touch the border of the grid.
+   */
+  SegmentedImageType::Pointer     segmentation = SegmentedImageType::New();
+  SegmentedImageType::SizeType    segmentationSize;
+  SegmentedImageType::PointType   segmentationOrigin;
+  SegmentedImageType::SpacingType segmentationSpacing;
+  segmentationSize[ 0 ]    = 10; segmentationSize[ 1 ] = 10; segmentationSize[ 2 ] = 8;
+  segmentationOrigin.Fill( 1.0 );
+  segmentationSpacing[ 0 ] = 1.0; segmentationSpacing[ 1 ] = 1.0; segmentationSpacing[ 2 ] = 1.5;
+  segmentation->SetRegions( segmentationSize );
+  segmentation->SetOrigin( segmentationOrigin );
+  segmentation->SetSpacing( segmentationSpacing );
+  segmentation->Allocate();
+  segmentation->FillBuffer( 0 );
+
+  itk::ImageRegionIteratorWithIndex< SegmentedImageType > it( segmentation, segmentation->GetBufferedRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const SegmentedImageType::IndexType index = it.GetIndex();
+    if( index[ 0 ] >= 1 && index[ 0 ] <= 4 && index[ 1 ] >= 1 && index[ 1 ] <= 5 && index[ 2 ] >= 2 && index[ 2 ] <= 4 )
+    {
+      it.Set( 1 );
+    }
+    else if( index[ 0 ] >= 5 && index[ 0 ] <= 8 && index[ 1 ] >= 3 && index[ 1 ] <= 7 && index[ 2 ] >= 1 && index[ 2 ] <= 6 )
+    {
+      it.Set( 2 );
+    }
+  }
+  SegmentedImageType::IndexType isolatedIndex;
+  isolatedIndex[ 0 ] = 2; isolatedIndex[ 1 ] = 8; isolatedIndex[ 2 ] = 6;
+  segmentation->SetPixel( isolatedIndex, 1 );
+
+  /** A B-spline transform whose valid region [ 0, 20 [^3 contains the penalty grid. */
+  TransformType::Pointer              transform = TransformType::New();
+  TransformType::OriginType           gridOrigin;
+  TransformType::SpacingType          gridSpacing;
+  TransformType::RegionType           gridRegion;
+  TransformType::RegionType::SizeType gridSize;
+  gridOrigin.Fill( -4.0 );
+  gridSpacing.Fill( 4.0 );
+  gridSize.Fill( 8 );
+  gridRegion.SetSize( gridSize );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+
+  const unsigned int numberOfParameters = transform->GetNumberOfParameters();
+  ParametersType     parameters( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    parameters[ i ] = RandomGeneratorType::GetInstance()->GetUniformVariate( -0.5, 0.5 );
+  }
+  transform->SetParameters( parameters );
+
+  /** Setup the metric. */
+  MetricType::Pointer metric = MetricType::New();
+  metric->SetFixedImage( image );
+  metric->SetMovingImage( image );
+  metric->SetFixedImageRegion( image->GetBufferedRegion() );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( itk::LinearInterpolateImageFunction< ImageType, double >::New() );
+  metric->SetSegmentedImage( segmentation );
+  metric->SetSampledSegmentedImage( segmentation );
+  metric->SetNumberOfThreads( 3 );
+
+  MeasureType    values[ 2 ], getValues[ 2 ];
+  DerivativeType derivatives[ 2 ];
+  double         reference = 0.0;
+  try
+  {
+    metric->Initialize();
+
+    /** The value and derivative, single- and multi-threaded. */
+    for( unsigned int t = 0; t < 2; ++t )
+    {
+      metric->SetUseMultiThread( t == 1 );
+      metric->GetValueAndDerivative( parameters, values[ t ], derivatives[ t ] );
+      getValues[ t ] = metric->GetValue( parameters );
+    }
+
+    transform->SetParameters( parameters );
+    reference = ComputeReferenceValue( segmentation, transform );
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  /** Central differences. */
+  metric->SetUseMultiThread( false );
+  const double   delta               = 1e-4;
+  double         maxDerivative       = 0.0;
+  double         maxError            = 0.0;
+  double         maxThreadDifference = 0.0;
+  ParametersType testPoint( parameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    testPoint[ i ] = parameters[ i ] + delta;
+    const double valuep1 = metric->GetValue( testPoint );
+    testPoint[ i ] = parameters[ i ] - delta;
+    const double valuep0 = metric->GetValue( testPoint );
+    testPoint[ i ] = parameters[ i ];
+
+    const double finiteDifference = ( valuep1 - valuep0 ) / ( 2.0 * delta );
+    maxDerivative       = std::max( maxDerivative, std::abs( finiteDifference ) );
+    maxError            = std::max( maxError, std::abs( derivatives[ 0 ][ i ] - finiteDifference ) );
+    maxThreadDifference = std::max( maxThreadDifference,
+      std::abs( derivatives[ 0 ][ i ] - derivatives[ 1 ][ i ] ) );
+  }
+
+  std::cerr << std::setprecision( 12 ) << "Number of rigid grid points: " << metric->GetNumberOfRigidGrids()
+            << "\nValue: " << values[ 0 ] << " (single-threaded), " << values[ 1 ]
+            << " (multi-threaded), " << getValues[ 0 ] << ", " << getValues[ 1 ]
+            << " (GetValue), reference " << reference
+            << "\nDerivative: max finite difference " << maxDerivative << ", max error "
+            << maxError << ", max difference between threads " << maxThreadDifference << std::endl;
+
+  if( metric->GetNumberOfRigidGrids() != 4 * 5 * 3 + 4 * 5 * 6 + 1 )
+  {
+    std::cerr << "ERROR: wrong number of rigid grid points." << std::endl;
+    return 1;
+  }
+  if( !( reference > 0.0 ) )
+  {
+    std::cerr << "ERROR: the reference value should be positive." << std::endl;
+    return 1;
+  }
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    if( !( std::abs( values[ t ] - reference ) <= 1e-12 * reference )
+      || !( std::abs( getValues[ t ] - reference ) <= 1e-12 * reference ) )
+    {
+      std::cerr << "ERROR: the value differs from the direct evaluation." << std::endl;
+      return 1;
+    }
+  }
+  if( !( maxDerivative > 0.0 ) || !( maxError <= 1e-6 * maxDerivative )
+    || !( maxThreadDifference <= 1e-12 * maxDerivative ) )
+  {
+    std::cerr << "ERROR: the derivative differs from the finite differences." << std::endl;
+    return 1;
+  }
+
+  return 0;
+
+} // end main
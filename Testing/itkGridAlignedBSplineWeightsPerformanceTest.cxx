@@ -0,0 +1,198 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkRecursiveBSplineTransform.h"
+
+// Report timings
+#include "itkTimeProbe.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Benchmark the GridAlignedBSplineWeightsTable: evaluate a B-spline transform in
+// all voxel centres of an image whose voxel lattice is aligned with the control
+// point grid, as the metrics do with a full or grid sampler, with and without the
+// precomputed weights, and check that both give the same results.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension   = 3;
+  const unsigned int SplineOrder = 3;
+  typedef double ScalarType;
+
+  /** The number of voxels per dimension. Distinguish between Debug and
+   * Release mode.
+   */
+#ifndef NDEBUG
+  const unsigned int imageSize = 8;
+#else
+  const unsigned int imageSize = 64;
+#endif
+
+  typedef itk::RecursiveBSplineTransform<
+    ScalarType, Dimension, SplineOrder >                  TransformType;
+  typedef TransformType::InputPointType                  InputPointType;
+  typedef TransformType::OutputPointType                 OutputPointType;
+  typedef TransformType::ParametersType                  ParametersType;
+  typedef TransformType::JacobianType                    JacobianType;
+  typedef TransformType::NonZeroJacobianIndicesType      NonZeroJacobianIndicesType;
+  typedef TransformType::SpatialJacobianType             SpatialJacobianType;
+  typedef TransformType::SpatialHessianType              SpatialHessianType;
+
+  /** A grid with a spacing of 16 voxels of 1 mm, which covers the voxels
+   * [ 8, 8 + imageSize ) in each dimension.
+   */
+  TransformType::OriginType    gridOrigin;
+  TransformType::SpacingType   gridSpacing;
+  TransformType::SizeType      gridSize;
+  TransformType::RegionType    gridRegion;
+  TransformType::DirectionType gridDirection;
+  gridOrigin.Fill( -48.0 );
+  gridSpacing.Fill( 16.0 );
+  gridSize.Fill( 13 );
+  gridRegion.SetSize( gridSize );
+  gridDirection.SetIdentity();
+
+  TransformType::Pointer transform = TransformType::New();
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridDirection( gridDirection );
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 4.0 * std::sin( 0.37 * i ) * std::cos( 0.11 * i );
+  }
+  transform->SetParameters( parameters );
+
+  /** The voxel centres, and the voxel lattice of the image. */
+  std::vector< InputPointType > points;
+  points.reserve( imageSize * imageSize * imageSize );
+  for( unsigned int z = 0; z < imageSize; ++z )
+  {
+    for( unsigned int y = 0; y < imageSize; ++y )
+    {
+      for( unsigned int x = 0; x < imageSize; ++x )
+      {
+        InputPointType p;
+        p[ 0 ] = 8.0 + x; p[ 1 ] = 8.0 + y; p[ 2 ] = 8.0 + z;
+        points.push_back( p );
+      }
+    }
+  }
+  const std::size_t          N = points.size();
+  TransformType::OriginType  latticeOrigin;
+  TransformType::SpacingType latticeSpacing;
+  TransformType::SizeType    latticeSize;
+  latticeOrigin.Fill( 0.0 );
+  latticeSpacing.Fill( 1.0 );
+  latticeSize.Fill( 8 + imageSize );
+
+  /** Time the functions that the metrics call per sample, without (run 0)
+   * and with (run 1) the precomputed weights.
+   */
+  const unsigned int numberOfFunctions = 4;
+  const char *       functionNames[ numberOfFunctions ] = {
+    "TransformPoint", "GetJacobian", "GetSpatialJacobian", "GetSpatialHessian" };
+  double                          times[ 2 ][ numberOfFunctions ];
+  double                          checksums[ 2 ][ numberOfFunctions ];
+  std::vector< OutputPointType >  outputs[ 2 ];
+  JacobianType                    jacobian;
+  NonZeroJacobianIndicesType      nzji( transform->GetNumberOfNonZeroJacobianIndices() );
+  SpatialJacobianType             sj;
+  SpatialHessianType              sh;
+  for( unsigned int run = 0; run < 2; ++run )
+  {
+    if( run == 1 && !transform->SetGridAlignedSampleLattice(
+      latticeOrigin, latticeSpacing, gridDirection, latticeSize ) )
+    {
+      std::cerr << "ERROR: SetGridAlignedSampleLattice() did not detect the lattice." << std::endl;
+      return 1;
+    }
+
+    outputs[ run ].resize( N );
+    for( unsigned int f = 0; f < numberOfFunctions; ++f )
+    {
+      double         checksum = 0.0;
+      itk::TimeProbe timer;
+      timer.Start();
+      for( std::size_t n = 0; n < N; ++n )
+      {
+        switch( f )
+        {
+          case 0:
+            outputs[ run ][ n ] = transform->TransformPoint( points[ n ] );
+            checksum += outputs[ run ][ n ][ 0 ];
+            break;
+          case 1:
+            transform->GetJacobian( points[ n ], jacobian, nzji );
+            checksum += jacobian[ 0 ][ n % jacobian.cols() ];
+            break;
+          case 2:
+            transform->GetSpatialJacobian( points[ n ], sj );
+            checksum += sj( 0, 1 );
+            break;
+          default:
+            transform->GetSpatialHessian( points[ n ], sh );
+            checksum += sh[ 0 ]( 1, 2 );
+            break;
+        }
+      }
+      timer.Stop();
+      times[ run ][ f ]     = timer.GetMean();
+      checksums[ run ][ f ] = checksum;
+    }
+  }
+
+  /** Report the timings. */
+  std::cerr << "Number of points: " << N << "\n" << std::setprecision( 4 );
+  for( unsigned int f = 0; f < numberOfFunctions; ++f )
+  {
+    std::cerr << std::setw( 20 ) << functionNames[ f ]
+              << ": kernels " << times[ 0 ][ f ] << " s"
+              << ", table " << times[ 1 ][ f ] << " s"
+              << ", speedup " << times[ 0 ][ f ] / times[ 1 ][ f ] << std::endl;
+  }
+
+  /** The precomputed weights give the same results. */
+  double maximumDifference = 0.0;
+  for( std::size_t n = 0; n < N; ++n )
+  {
+    maximumDifference = std::max( maximumDifference,
+      outputs[ 0 ][ n ].EuclideanDistanceTo( outputs[ 1 ][ n ] ) );
+  }
+  for( unsigned int f = 1; f < numberOfFunctions; ++f )
+  {
+    maximumDifference = std::max( maximumDifference,
+      std::abs( checksums[ 0 ][ f ] - checksums[ 1 ][ f ] ) / N );
+  }
+  if( maximumDifference > 1e-9 )
+  {
+    std::cerr << "ERROR: the precomputed weights give different results, "
+              << "maximum difference " << maximumDifference << std::endl;
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
@@ -0,0 +1,267 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "LocalNormalizedCorrelation/itkLocalNormalizedCorrelationImageToImageMetric.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+// Report timings
+#include "itkTimeProbe.h"
+#include "itkTimeProbesCollectorBase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+int
+main( int, char *[] )
+{
+  /** Some basic type definitions. */
+  const unsigned int Dimension = 3;
+  const unsigned int Radius    = 3;
+
+  typedef itk::Image< float, Dimension > ImageType;
+  typedef itk::LocalNormalizedCorrelationImageToImageMetric<
+    ImageType, ImageType >                                MetricType;
+  typedef itk::AdvancedTranslationTransform< double, Dimension > TransformType;
+  typedef itk::BSplineInterpolateImageFunction<
+    ImageType, double, double >                           InterpolatorType;
+
+  typedef MetricType::ParametersType  ParametersType;
+  typedef MetricType::DerivativeType  DerivativeType;
+  typedef MetricType::MeasureType     MeasureType;
+  typedef ImageType::RegionType       RegionType;
+  typedef ImageType::SizeType         SizeType;
+  typedef ImageType::IndexType        IndexType;
+  typedef ImageType::PointType        PointType;
+  typedef InterpolatorType::ContinuousIndexType ContinuousIndexType;
+
+  /** Create smooth test images. The moving image is a shifted copy of the
+   * fixed image, with a multiplicative bias field and an intensity offset,
+   * which the local correlation should be insensitive to.
+   */
+  SizeType imageSize;
+  imageSize.Fill( 48 );
+  RegionType imageRegion;
+  imageRegion.SetSize( imageSize );
+
+  ImageType::Pointer fixedImage  = ImageType::New();
+  ImageType::Pointer movingImage = ImageType::New();
+  fixedImage->SetRegions( imageRegion );
+  fixedImage->Allocate();
+  movingImage->SetRegions( imageRegion );
+  movingImage->Allocate();
+
+  typedef itk::ImageRegionIteratorWithIndex< ImageType > IteratorType;
+  IteratorType fixedIt( fixedImage, imageRegion );
+  IteratorType movingIt( movingImage, imageRegion );
+  for( ; !fixedIt.IsAtEnd(); ++fixedIt, ++movingIt )
+  {
+    const IndexType & index = fixedIt.GetIndex();
+    const double      x     = index[ 0 ];
+    const double      y     = index[ 1 ];
+    const double      z     = index[ 2 ];
+    fixedIt.Set( static_cast< float >(
+      100.0 * std::sin( x / 5.0 ) * std::cos( y / 7.0 ) + 50.0 * std::sin( ( z + x ) / 4.0 ) ) );
+    const double xs = x - 0.6;
+    const double ys = y + 0.3;
+    movingIt.Set( static_cast< float >( ( 1.0 + 0.02 * x ) * (
+      100.0 * std::sin( xs / 5.0 ) * std::cos( ys / 7.0 ) + 50.0 * std::sin( ( z + xs ) / 4.0 ) ) + 20.0 ) );
+  }
+
+  /** Only use the center of the fixed image, so that all mapped points
+   * remain inside the moving image.
+   */
+  RegionType fixedImageRegion;
+  IndexType  fixedImageRegionIndex;
+  SizeType   fixedImageRegionSize;
+  fixedImageRegionIndex.Fill( 8 );
+  fixedImageRegionSize.Fill( 32 );
+  fixedImageRegion.SetIndex( fixedImageRegionIndex );
+  fixedImageRegion.SetSize( fixedImageRegionSize );
+
+  /** Setup the metric. */
+  TransformType::Pointer    transform    = TransformType::New();
+  InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  MetricType::Pointer       metric       = MetricType::New();
+  MetricType::RadiusType    radius;
+  radius.Fill( Radius );
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( fixedImageRegion );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( interpolator );
+  metric->SetRadius( radius );
+  metric->SetUseMultiThread( true );
+  metric->Initialize();
+
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  parameters[ 0 ] = 0.4; parameters[ 1 ] = -0.2; parameters[ 2 ] = 0.1;
+
+  itk::TimeProbesCollectorBase timeCollector;
+
+  /** Time the metric value. */
+  MeasureType value = 0.0;
+  timeCollector.Start( "LNCC running sums" );
+  value = metric->GetValue( parameters );
+  timeCollector.Stop( "LNCC running sums" );
+
+  /** Time the metric value and derivative, single- and multi-threaded. */
+  MeasureType    valueMT = 0.0;
+  DerivativeType derivativeMT;
+  timeCollector.Start( "LNCC value and derivative MT" );
+  metric->GetValueAndDerivative( parameters, valueMT, derivativeMT );
+  timeCollector.Stop( "LNCC value and derivative MT" );
+
+  MeasureType    valueST = 0.0;
+  DerivativeType derivativeST;
+  metric->SetUseMultiThread( false );
+  timeCollector.Start( "LNCC value and derivative ST" );
+  metric->GetValueAndDerivative( parameters, valueST, derivativeST );
+  timeCollector.Stop( "LNCC value and derivative ST" );
+
+  /** Time a naive implementation, summing over every window explicitly. */
+  timeCollector.Start( "LNCC naive windows" );
+  transform->SetParameters( parameters );
+  interpolator->SetInputImage( movingImage );
+
+  const unsigned int    numberOfVoxels = fixedImageRegion.GetNumberOfPixels();
+  std::vector< double > fixedValues( numberOfVoxels );
+  std::vector< double > movingValues( numberOfVoxels );
+  std::vector< bool >   isValid( numberOfVoxels );
+  itk::ImageRegionConstIteratorWithIndex< ImageType > it( fixedImage, fixedImageRegion );
+  for( unsigned int k = 0; !it.IsAtEnd(); ++it, ++k )
+  {
+    PointType fixedPoint;
+    fixedImage->TransformIndexToPhysicalPoint( it.GetIndex(), fixedPoint );
+    const PointType     mappedPoint = transform->TransformPoint( fixedPoint );
+    ContinuousIndexType cindex;
+    movingImage->TransformPhysicalPointToContinuousIndex( mappedPoint, cindex );
+    isValid[ k ]      = interpolator->IsInsideBuffer( cindex );
+    fixedValues[ k ]  = it.Get();
+    movingValues[ k ] = isValid[ k ] ? interpolator->EvaluateAtContinuousIndex( cindex ) : 0.0;
+  }
+
+  double       naiveValue = 0.0;
+  unsigned int naiveCount = 0;
+  const int    size       = static_cast< int >( fixedImageRegionSize[ 0 ] );
+  for( int cz = 0; cz < size; ++cz )
+  {
+    for( int cy = 0; cy < size; ++cy )
+    {
+      for( int cx = 0; cx < size; ++cx )
+      {
+        if( !isValid[ ( cz * size + cy ) * size + cx ] )
+        {
+          continue;
+        }
+
+        double n = 0.0, sf = 0.0, sm = 0.0, sff = 0.0, smm = 0.0, sfm = 0.0;
+        for( int z = std::max( cz - (int)Radius, 0 ); z <= std::min( cz + (int)Radius, size - 1 ); ++z )
+        {
+          for( int y = std::max( cy - (int)Radius, 0 ); y <= std::min( cy + (int)Radius, size - 1 ); ++y )
+          {
+            for( int x = std::max( cx - (int)Radius, 0 ); x <= std::min( cx + (int)Radius, size - 1 ); ++x )
+            {
+              const unsigned int k = ( z * size + y ) * size + x;
+              if( !isValid[ k ] )
+              {
+                continue;
+              }
+              const double f = fixedValues[ k ];
+              const double m = movingValues[ k ];
+              n += 1.0; sf += f; sm += m; sff += f * f; smm += m * m; sfm += f * m;
+            }
+          }
+        }
+
+        const double varF  = sff - sf * sf / n;
+        const double varM  = smm - sm * sm / n;
+        const double cross = sfm - sf * sm / n;
+        if( n > 1.5 && varF > 1e-10 * sff && varM > 1e-10 * smm )
+        {
+          naiveValue -= cross * cross / ( varF * varM );
+          ++naiveCount;
+        }
+      }
+    }
+  }
+  naiveValue /= static_cast< double >( naiveCount );
+  timeCollector.Stop( "LNCC naive windows" );
+
+  /** Report timings. */
+  timeCollector.Report();
+
+  /**
+   *
+   * Test accuracy
+   *
+   */
+
+  std::cerr << std::setprecision( 10 );
+  std::cerr << "LNCC value: " << value << ", naive value: " << naiveValue << std::endl;
+  if( std::abs( value - naiveValue ) > 1e-6 * std::abs( naiveValue ) )
+  {
+    std::cerr << "ERROR: LNCC value differs from the naive implementation." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( std::abs( valueMT - value ) > 1e-10 * std::abs( value )
+    || std::abs( valueST - value ) > 1e-10 * std::abs( value ) )
+  {
+    std::cerr << "ERROR: LNCC GetValue() and GetValueAndDerivative() differ." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const double diffMT = ( derivativeMT - derivativeST ).magnitude();
+  std::cerr << "Derivative MT: " << derivativeMT << ", ST: " << derivativeST << std::endl;
+  if( diffMT > 1e-8 * derivativeST.magnitude() )
+  {
+    std::cerr << "ERROR: multi-threaded LNCC derivative differs from the single-threaded one." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Compare the analytic derivative to central finite differences. */
+  const double   delta = 1e-4;
+  DerivativeType finiteDifferences( parameters.GetSize() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    ParametersType parametersPlus  = parameters;
+    ParametersType parametersMinus = parameters;
+    parametersPlus[ i ]  += delta;
+    parametersMinus[ i ] -= delta;
+    finiteDifferences[ i ] = ( metric->GetValue( parametersPlus )
+      - metric->GetValue( parametersMinus ) ) / ( 2.0 * delta );
+  }
+
+  const double diffFD = ( finiteDifferences - derivativeST ).magnitude();
+  std::cerr << "Finite differences: " << finiteDifferences << std::endl;
+  if( diffFD > 1e-3 * finiteDifferences.magnitude() )
+  {
+    std::cerr << "ERROR: LNCC derivative differs from the finite differences." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,209 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "DeformationFieldTransform/itkMemoryMappedImageFileReader.h"
+#include "DeformationFieldTransform/itkDeformationFieldInterpolatingTransform.h"
+
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkVectorLinearInterpolateImageFunction.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+//-------------------------------------------------------------------------------------
+// Test that a deformation field that is mapped into memory by the
+// MemoryMappedImageFileReader equals the field in memory from which the file
+// was written, both as an image and as the field of a transform, and that
+// files that cannot be mapped are rejected.
+
+int
+main( int argc, char * argv[] )
+{
+  /** Check. */
+  if( argc != 2 )
+  {
+    std::cerr << "ERROR: You should specify the base name of the output files." << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string baseName = argv[ 1 ];
+
+  const unsigned int Dimension = 3;
+  typedef double ScalarType;
+  typedef itk::DeformationFieldInterpolatingTransform<
+    ScalarType, Dimension, float >                            TransformType;
+  typedef TransformType::DeformationFieldType                 DeformationFieldType;
+  typedef TransformType::DeformationFieldVectorType           VectorType;
+  typedef TransformType::InputPointType                       PointType;
+  typedef itk::VectorLinearInterpolateImageFunction<
+    DeformationFieldType, ScalarType >                        InterpolatorType;
+  typedef itk::MemoryMappedImageFileReader< DeformationFieldType > MappedReaderType;
+  typedef itk::ImageFileReader< DeformationFieldType >        ReaderType;
+  typedef itk::ImageFileWriter< DeformationFieldType >        WriterType;
+
+  /** A deformation field with an anisotropic spacing and an oblique direction. */
+  DeformationFieldType::SizeType      size;
+  DeformationFieldType::SpacingType   spacing;
+  DeformationFieldType::PointType     origin;
+  DeformationFieldType::DirectionType direction;
+  size[ 0 ]    = 13; size[ 1 ] = 7; size[ 2 ] = 5;
+  spacing[ 0 ] = 0.5; spacing[ 1 ] = 1.25; spacing[ 2 ] = 2.0;
+  origin[ 0 ]  = -3.0; origin[ 1 ] = 1.5; origin[ 2 ] = 10.0;
+  direction.SetIdentity();
+  direction[ 0 ][ 0 ] = std::cos( 0.2 ); direction[ 0 ][ 2 ] = -std::sin( 0.2 );
+  direction[ 2 ][ 0 ] = std::sin( 0.2 ); direction[ 2 ][ 2 ] = std::cos( 0.2 );
+
+  DeformationFieldType::Pointer field = DeformationFieldType::New();
+  field->SetRegions( size );
+  field->SetSpacing( spacing );
+  field->SetOrigin( origin );
+  field->SetDirection( direction );
+  field->Allocate();
+  VectorType * buffer = field->GetBufferPointer();
+  const std::size_t numberOfPixels = field->GetBufferedRegion().GetNumberOfPixels();
+  for( std::size_t n = 0; n < numberOfPixels; ++n )
+  {
+    for( unsigned int k = 0; k < Dimension; ++k )
+    {
+      buffer[ n ][ k ] = static_cast< float >( 3.0 * std::sin( 0.37 * n + 1.1 * k ) );
+    }
+  }
+
+  /** Write the field with a separate data file, with the data in the
+   * header file, and compressed.
+   */
+  const std::string mappableFileNames[] = { baseName + ".mhd", baseName + ".mha" };
+  const std::string compressedFileName  = baseName + "_compressed.mha";
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput( field );
+  try
+  {
+    for( unsigned int f = 0; f < 2; ++f )
+    {
+      writer->SetFileName( mappableFileNames[ f ] );
+      writer->SetUseCompression( false );
+      writer->Update();
+    }
+    writer->SetFileName( compressedFileName );
+    writer->SetUseCompression( true );
+    writer->Update();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** A compressed file cannot be mapped. */
+  MappedReaderType::Pointer mappedReader = MappedReaderType::New();
+  mappedReader->SetFileName( compressedFileName );
+  if( mappedReader->Map().IsNotNull() )
+  {
+    std::cerr << "ERROR: a compressed file was mapped." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** The transform with the field in memory, evaluated at points inside
+   * and around the field.
+   */
+  TransformType::Pointer transform = TransformType::New();
+  transform->SetDeformationFieldInterpolator( InterpolatorType::New() );
+  transform->SetDeformationField( field );
+
+  for( unsigned int f = 0; f < 2; ++f )
+  {
+    mappedReader->SetFileName( mappableFileNames[ f ] );
+    DeformationFieldType::Pointer mapped = mappedReader->Map();
+    if( mapped.IsNull() )
+    {
+      std::cerr << "ERROR: " << mappableFileNames[ f ] << " was not mapped." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    /** The same geometry, within the precision of the header. */
+    bool sameGeometry = mapped->GetLargestPossibleRegion() == field->GetLargestPossibleRegion();
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      sameGeometry &= std::abs( mapped->GetSpacing()[ i ] - spacing[ i ] ) < 1e-6;
+      sameGeometry &= std::abs( mapped->GetOrigin()[ i ] - origin[ i ] ) < 1e-6;
+      for( unsigned int j = 0; j < Dimension; ++j )
+      {
+        sameGeometry &= std::abs( mapped->GetDirection()[ i ][ j ] - direction[ i ][ j ] ) < 1e-6;
+      }
+    }
+    if( !sameGeometry )
+    {
+      std::cerr << "ERROR: the geometry of " << mappableFileNames[ f ] << " differs." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    /** Exactly the same pixels. */
+    if( std::memcmp( mapped->GetBufferPointer(), buffer, numberOfPixels * sizeof( VectorType ) ) != 0 )
+    {
+      std::cerr << "ERROR: the pixels of " << mappableFileNames[ f ] << " differ." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    /** The same transformation. Use the geometry of the field in memory,
+     * so that only the pixels are compared.
+     */
+    mapped->CopyInformation( field );
+    TransformType::Pointer mappedTransform = TransformType::New();
+    mappedTransform->SetDeformationFieldInterpolator( InterpolatorType::New() );
+    mappedTransform->SetDeformationField( mapped );
+    for( unsigned int n = 0; n < 1000; ++n )
+    {
+      itk::ContinuousIndex< double, Dimension > cindex;
+      PointType                                 point;
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        cindex[ i ] = -1.0 + ( size[ i ] + 1.0 ) * std::abs( std::sin( 2.3 * n + 0.9 * i ) );
+      }
+      field->TransformContinuousIndexToPhysicalPoint( cindex, point );
+      if( mappedTransform->TransformPoint( point ) != transform->TransformPoint( point ) )
+      {
+        std::cerr << "ERROR: the mapped field transforms " << point << " differently." << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+
+    /** The mapping is copy-on-write: writing to the pixels does not modify the file. */
+    mapped->GetBufferPointer()[ 0 ][ 0 ] += 1.0f;
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( mappableFileNames[ f ] );
+    try
+    {
+      reader->Update();
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+    }
+    if( reader->GetOutput()->GetBufferPointer()[ 0 ] != buffer[ 0 ] )
+    {
+      std::cerr << "ERROR: writing to the mapped pixels modified " << mappableFileNames[ f ] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,291 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "MultiBSplineTransformWithNormal/itkMultiBSplineDeformableTransformWithNormal.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Test that the MultiBSplineDeformableTransformWithNormal, which evaluates a single
+// B-spline per point, equals the sum of the normal and the tangential B-spline
+// transforms, and that its Jacobian and spatial Jacobian equal finite differences.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension   = 2;
+  const unsigned int SplineOrder = 3;
+  typedef double ScalarType;
+
+  typedef itk::MultiBSplineDeformableTransformWithNormal<
+    ScalarType, Dimension, SplineOrder >                   TransformType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    ScalarType, Dimension, SplineOrder >                   BSplineTransformType;
+  typedef TransformType::ImageLabelType                    LabelImageType;
+  typedef TransformType::ImageBaseType                     BasesImageType;
+  typedef TransformType::BaseType                          BaseType;
+  typedef TransformType::ParametersType                    ParametersType;
+  typedef TransformType::InputPointType                    PointType;
+  typedef TransformType::OutputPointType                   OutputPointType;
+  typedef TransformType::JacobianType                      JacobianType;
+  typedef TransformType::NonZeroJacobianIndicesType        NonZeroJacobianIndicesType;
+  typedef TransformType::SpatialJacobianType               SpatialJacobianType;
+
+  /** A 32 x 32 label image with two labels, separated by an oblique
+   * interface, so that the local bases are not aligned with the axes.
+   */
+  LabelImageType::Pointer   labels = LabelImageType::New();
+  LabelImageType::SizeType  labelSize;
+  labelSize.Fill( 32 );
+  labels->SetRegions( labelSize );
+  labels->Allocate();
+  typedef itk::ImageRegionIteratorWithIndex< LabelImageType > LabelIteratorType;
+  LabelIteratorType lit( labels, labels->GetLargestPossibleRegion() );
+  for( lit.GoToBegin(); !lit.IsAtEnd(); ++lit )
+  {
+    const LabelImageType::IndexType & index = lit.GetIndex();
+    lit.Set( index[ 0 ] + index[ 1 ] / 2 < 24 ? 0 : 1 );
+  }
+
+  /** A grid with 4 mm spacing that covers the label image. */
+  TransformType::RegionType    gridRegion;
+  TransformType::SizeType      gridSize;
+  TransformType::SpacingType   gridSpacing;
+  TransformType::OriginType    gridOrigin;
+  TransformType::DirectionType gridDirection;
+  gridSize.Fill( 16 );
+  gridRegion.SetSize( gridSize );
+  gridSpacing.Fill( 4.0 );
+  gridOrigin.Fill( -12.0 );
+  gridDirection.SetIdentity();
+
+  TransformType::Pointer transform = TransformType::New();
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridDirection( gridDirection );
+  transform->SetLabels( labels );
+  transform->UpdateLocalBases();
+
+  const unsigned int numberOfLabels = transform->GetNbLabels();
+  const unsigned int P              = transform->GetNumberOfParametersPerDimension();
+  if( numberOfLabels != 2 || transform->GetNumberOfParameters() != ( 1 + numberOfLabels ) * P )
+  {
+    std::cerr << "ERROR: unexpected number of labels or parameters." << std::endl;
+    return 1;
+  }
+
+  /** A smooth deformation: one normal and, per label, one tangential coefficient per node. */
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int k = 0; k < parameters.GetSize(); ++k )
+  {
+    const double x = static_cast< double >( k % gridSize[ 0 ] );
+    const double y = static_cast< double >( ( k % P ) / gridSize[ 0 ] );
+    const double c = static_cast< double >( k / P );
+    parameters[ k ] = 1.5 * std::sin( 0.6 * x + 0.9 * c ) * std::cos( 0.35 * y - 0.4 * c );
+  }
+  transform->SetParameters( parameters );
+
+  /** The reference: the old evaluation, as the sum of a transform with the
+   * normal components and a transform with the tangential components of a label.
+   */
+  const BasesImageType::PixelContainer & bases = *transform->GetLocalBases()->GetPixelContainer();
+  std::vector< BSplineTransformType::Pointer > reference( numberOfLabels + 1 );
+  std::vector< ParametersType >                referenceParameters( numberOfLabels + 1 );
+  for( unsigned int l = 0; l <= numberOfLabels; ++l )
+  {
+    reference[ l ] = BSplineTransformType::New();
+    reference[ l ]->SetGridRegion( gridRegion );
+    reference[ l ]->SetGridSpacing( gridSpacing );
+    reference[ l ]->SetGridOrigin( gridOrigin );
+    reference[ l ]->SetGridDirection( gridDirection );
+    referenceParameters[ l ].SetSize( Dimension * P );
+    referenceParameters[ l ].Fill( 0.0 );
+  }
+  for( unsigned int i = 0; i < P; ++i )
+  {
+    const BaseType & base = bases[ i ];
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      referenceParameters[ 0 ][ i + d * P ] = base[ 0 ][ d ] * parameters[ i ];
+    }
+    for( unsigned int l = 1; l <= numberOfLabels; ++l )
+    {
+      for( unsigned int b = 1; b < Dimension; ++b )
+      {
+        const double p = parameters[ i + ( ( Dimension - 1 ) * ( l - 1 ) + b ) * P ];
+        for( unsigned int d = 0; d < Dimension; ++d )
+        {
+          referenceParameters[ l ][ i + d * P ] += base[ b ][ d ] * p;
+        }
+      }
+    }
+  }
+  for( unsigned int l = 0; l <= numberOfLabels; ++l )
+  {
+    reference[ l ]->SetParameters( referenceParameters[ l ] );
+  }
+
+  /** Test points inside the label image, away from the label interface. */
+  std::vector< PointType > points;
+  std::vector< unsigned >  pointLabels;
+  for( double y = 0.7; y < 31.0; y += 3.1 )
+  {
+    for( double x = 0.3; x < 31.0; x += 2.9 )
+    {
+      PointType p;
+      p[ 0 ] = x; p[ 1 ] = y;
+      LabelImageType::IndexType index;
+      labels->TransformPhysicalPointToIndex( p, index );
+      const double distance = ( index[ 0 ] + index[ 1 ] / 2 ) - 23.5;
+      if( std::abs( distance ) < 1.5 ) { continue; }
+      points.push_back( p );
+      pointLabels.push_back( labels->GetPixel( index ) + 1 );
+    }
+  }
+
+  double maximumPointError    = 0.0;
+  double maximumJacobianError = 0.0;
+  double maximumSJError       = 0.0;
+  double maximumFDJacobianError = 0.0;
+  double maximumFDSJError       = 0.0;
+  const double h = 1e-4;
+  for( std::size_t n = 0; n < points.size(); ++n )
+  {
+    const PointType & p = points[ n ];
+    const unsigned    l = pointLabels[ n ];
+
+    /** TransformPoint: the normal and the tangential displacement. */
+    const OutputPointType tp = transform->TransformPoint( p );
+    OutputPointType       rp = reference[ 0 ]->TransformPoint( p );
+    rp += reference[ l ]->TransformPoint( p ) - p;
+    maximumPointError = std::max( maximumPointError, tp.EuclideanDistanceTo( rp ) );
+
+    /** GetSpatialJacobian: the sum of both, minus the doubly counted identity. */
+    SpatialJacobianType sj, sj0, sjl;
+    transform->GetSpatialJacobian( p, sj );
+    reference[ 0 ]->GetSpatialJacobian( p, sj0 );
+    reference[ l ]->GetSpatialJacobian( p, sjl );
+    SpatialJacobianType identity;
+    identity.SetIdentity();
+    const SpatialJacobianType rsj = sj0 + sjl - identity;
+    maximumSJError = std::max( maximumSJError,
+      ( sj - rsj ).GetVnlMatrix().absolute_value_max() );
+
+    /** GetSpatialJacobian against central differences of TransformPoint. */
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      PointType pPlus  = p;
+      PointType pMinus = p;
+      pPlus[ j ]  += h;
+      pMinus[ j ] -= h;
+      const OutputPointType tPlus  = transform->TransformPoint( pPlus );
+      const OutputPointType tMinus = transform->TransformPoint( pMinus );
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        const double fd = ( tPlus[ i ] - tMinus[ i ] ) / ( 2.0 * h );
+        maximumFDSJError = std::max( maximumFDSJError, std::abs( fd - sj( i, j ) ) );
+      }
+    }
+
+    /** GetJacobian, scattered into a dense Jacobian. */
+    JacobianType               jacobian;
+    NonZeroJacobianIndicesType nzji;
+    transform->GetJacobian( p, jacobian, nzji );
+    vnl_matrix< double > dense( Dimension, parameters.GetSize(), 0.0 );
+    for( unsigned int k = 0; k < nzji.size(); ++k )
+    {
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        dense( i, nzji[ k ] ) += jacobian[ i ][ k ];
+      }
+    }
+
+    /** The reference Jacobian, from the weights of the normal transform. */
+    JacobianType               jacobian0;
+    NonZeroJacobianIndicesType nzji0;
+    reference[ 0 ]->GetJacobian( p, jacobian0, nzji0 );
+    const unsigned int   nweights = nzji0.size() / Dimension;
+    vnl_matrix< double > referenceDense( Dimension, parameters.GetSize(), 0.0 );
+    for( unsigned int k = 0; k < nweights; ++k )
+    {
+      const unsigned int node   = nzji0[ k ];
+      const double       weight = jacobian0[ 0 ][ k ];
+      const BaseType &   base   = bases[ node ];
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        referenceDense( i, node ) += weight * base[ 0 ][ i ];
+        for( unsigned int b = 1; b < Dimension; ++b )
+        {
+          referenceDense( i, node + ( ( Dimension - 1 ) * ( l - 1 ) + b ) * P ) += weight * base[ b ][ i ];
+        }
+      }
+    }
+    maximumJacobianError = std::max( maximumJacobianError,
+      ( dense - referenceDense ).absolute_value_max() );
+
+    /** GetJacobian against differences of TransformPoint with respect to the
+     * parameters; the transform is linear in the parameters.
+     */
+    for( unsigned int k = 0; k < parameters.GetSize(); ++k )
+    {
+      ParametersType perturbed = parameters;
+      perturbed[ k ] += 1.0;
+      transform->SetParameters( perturbed );
+      const OutputPointType tk = transform->TransformPoint( p );
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        maximumFDJacobianError = std::max( maximumFDJacobianError,
+          std::abs( ( tk[ i ] - tp[ i ] ) - dense( i, k ) ) );
+      }
+    }
+    transform->SetParameters( parameters );
+  }
+
+  std::cerr << "Number of test points: " << points.size() << "\n"
+            << "Maximum TransformPoint error: " << maximumPointError << "\n"
+            << "Maximum GetSpatialJacobian error: " << maximumSJError << "\n"
+            << "Maximum GetJacobian error: " << maximumJacobianError << "\n"
+            << "Maximum GetSpatialJacobian finite difference error: " << maximumFDSJError << "\n"
+            << "Maximum GetJacobian finite difference error: " << maximumFDJacobianError << std::endl;
+
+  if( points.empty() )
+  {
+    std::cerr << "ERROR: no test points." << std::endl;
+    return 1;
+  }
+  if( maximumPointError > 1e-10 || maximumSJError > 1e-10 || maximumJacobianError > 1e-10 )
+  {
+    std::cerr << "ERROR: the transform differs from the sum of the normal "
+              << "and the tangential transform." << std::endl;
+    return 1;
+  }
+  if( maximumFDSJError > 1e-5 || maximumFDJacobianError > 1e-8 )
+  {
+    std::cerr << "ERROR: the derivatives differ from finite differences." << std::endl;
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
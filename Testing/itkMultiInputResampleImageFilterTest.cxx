@@ -0,0 +1,231 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkMultiInputResampleImageFilter.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAffineTransform.h"
+#include "itkResampleImageFilter.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Test that resampling several images in one pass gives the same result as
+// resampling each image with its own itk::ResampleImageFilter, for an
+// AdvancedTransform, which maps the points in batches, and for a plain
+// itk::Transform, which maps them one by one. One input has its own default
+// pixel value.
+
+const unsigned int Dimension = 2;
+typedef float                                    PixelType;
+typedef itk::Image< PixelType, Dimension >       ImageType;
+typedef itk::InterpolateImageFunction<
+  ImageType, double >                            InterpolatorType;
+typedef itk::Transform< double, Dimension, Dimension > TransformType;
+typedef itk::MultiInputResampleImageFilter<
+  ImageType, ImageType, double >                 MultiResamplerType;
+typedef itk::ResampleImageFilter<
+  ImageType, ImageType, double >                 ResamplerType;
+
+/** Create the interpolator for input i. */
+InterpolatorType::Pointer
+CreateInterpolator( const unsigned int i )
+{
+  if( i == 0 )
+  {
+    typedef itk::BSplineInterpolateImageFunction< ImageType, double, double > BSplineInterpolatorType;
+    BSplineInterpolatorType::Pointer interpolator = BSplineInterpolatorType::New();
+    interpolator->SetSplineOrder( 3 );
+    return interpolator.GetPointer();
+  }
+  else if( i == 1 )
+  {
+    return itk::LinearInterpolateImageFunction< ImageType, double >::New().GetPointer();
+  }
+  return itk::NearestNeighborInterpolateImageFunction< ImageType, double >::New().GetPointer();
+} // end CreateInterpolator()
+
+
+/** Resample the inputs in one pass and compare with the separate resamplers. */
+int
+TestResampling( const TransformType * transform,
+  const std::vector< ImageType::Pointer > & inputs,
+  const ImageType::SizeType & outputSize,
+  const ImageType::SpacingType & outputSpacing,
+  const ImageType::PointType & outputOrigin,
+  const char * name )
+{
+  /** Input 1 has its own default pixel value, the others use the common one. */
+  const PixelType defaultPixelValue  = -1.0f;
+  const PixelType defaultPixelValue1 = 7.0f;
+
+  MultiResamplerType::Pointer multiResampler = MultiResamplerType::New();
+  multiResampler->SetTransform( transform );
+  multiResampler->SetSize( outputSize );
+  multiResampler->SetOutputSpacing( outputSpacing );
+  multiResampler->SetOutputOrigin( outputOrigin );
+  multiResampler->SetDefaultPixelValue( defaultPixelValue );
+  for( unsigned int i = 0; i < inputs.size(); ++i )
+  {
+    multiResampler->SetInput( i, inputs[ i ] );
+    multiResampler->SetInterpolator( i, CreateInterpolator( i ) );
+  }
+  multiResampler->SetDefaultPixelValue( 1, defaultPixelValue1 );
+
+  try
+  {
+    multiResampler->Update();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  for( unsigned int i = 0; i < inputs.size(); ++i )
+  {
+    ResamplerType::Pointer resampler = ResamplerType::New();
+    resampler->SetInput( inputs[ i ] );
+    resampler->SetTransform( transform );
+    resampler->SetInterpolator( CreateInterpolator( i ) );
+    resampler->SetSize( outputSize );
+    resampler->SetOutputSpacing( outputSpacing );
+    resampler->SetOutputOrigin( outputOrigin );
+    resampler->SetDefaultPixelValue( i == 1 ? defaultPixelValue1 : defaultPixelValue );
+    try
+    {
+      resampler->Update();
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << excp << std::endl;
+      return 1;
+    }
+
+    /** Compare the outputs. */
+    itk::ImageRegionConstIterator< ImageType > it( resampler->GetOutput(),
+      resampler->GetOutput()->GetLargestPossibleRegion() );
+    itk::ImageRegionConstIterator< ImageType > mit( multiResampler->GetOutput( i ),
+      multiResampler->GetOutput( i )->GetLargestPossibleRegion() );
+    double maximumDifference = 0.0;
+    for( it.GoToBegin(), mit.GoToBegin(); !it.IsAtEnd(); ++it, ++mit )
+    {
+      maximumDifference = std::max( maximumDifference,
+        static_cast< double >( std::abs( it.Get() - mit.Get() ) ) );
+    }
+
+    std::cerr << name << ", input " << i << ": maximum difference "
+              << maximumDifference << std::endl;
+    if( maximumDifference > 1e-3 )
+    {
+      std::cerr << "ERROR: the one-pass result differs from itk::ResampleImageFilter." << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+
+} // end TestResampling()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Create three smooth input images with different content. */
+  ImageType::SizeType inputSize;
+  inputSize[ 0 ] = 40;
+  inputSize[ 1 ] = 30;
+  ImageType::RegionType inputRegion;
+  inputRegion.SetSize( inputSize );
+  std::vector< ImageType::Pointer > inputs( 3 );
+  for( unsigned int i = 0; i < inputs.size(); ++i )
+  {
+    inputs[ i ] = ImageType::New();
+    inputs[ i ]->SetRegions( inputRegion );
+    inputs[ i ]->Allocate();
+    itk::ImageRegionIterator< ImageType > it( inputs[ i ], inputRegion );
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+      const ImageType::IndexType index = it.GetIndex();
+      it.Set( 100.0f * std::sin( 0.2 * ( i + 1 ) * index[ 0 ] ) * std::cos( 0.15 * index[ 1 ] ) );
+    }
+  }
+
+  /** The output grid partly maps outside the inputs. */
+  ImageType::SizeType outputSize;
+  outputSize[ 0 ] = 37;
+  outputSize[ 1 ] = 33;
+  ImageType::SpacingType outputSpacing;
+  outputSpacing[ 0 ] = 1.1;
+  outputSpacing[ 1 ] = 0.9;
+  ImageType::PointType outputOrigin;
+  outputOrigin[ 0 ] = -2.5;
+  outputOrigin[ 1 ] = 1.3;
+
+  /** A B-spline transform, which is an AdvancedTransform. */
+  typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 > BSplineTransformType;
+  BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  BSplineTransformType::OriginType  gridOrigin;
+  BSplineTransformType::SpacingType gridSpacing;
+  BSplineTransformType::SizeType    gridSize;
+  gridOrigin.Fill( -12.0 );
+  gridSpacing.Fill( 8.0 );
+  gridSize.Fill( 10 );
+  BSplineTransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  bsplineTransform->SetGridOrigin( gridOrigin );
+  bsplineTransform->SetGridSpacing( gridSpacing );
+  bsplineTransform->SetGridRegion( gridRegion );
+  BSplineTransformType::ParametersType parameters( bsplineTransform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 2.0 * std::sin( 0.37 * i );
+  }
+  bsplineTransform->SetParameters( parameters );
+
+  if( TestResampling( bsplineTransform, inputs,
+    outputSize, outputSpacing, outputOrigin, "B-spline transform" ) )
+  {
+    return 1;
+  }
+
+  /** An affine transform, which is mapped point by point. */
+  typedef itk::AffineTransform< double, Dimension > AffineTransformType;
+  AffineTransformType::Pointer affineTransform = AffineTransformType::New();
+  affineTransform->Rotate2D( 0.2 );
+  AffineTransformType::OutputVectorType translation;
+  translation[ 0 ] = 1.7;
+  translation[ 1 ] = -0.6;
+  affineTransform->Translate( translation );
+
+  if( TestResampling( affineTransform, inputs,
+    outputSize, outputSpacing, outputOrigin, "Affine transform" ) )
+  {
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
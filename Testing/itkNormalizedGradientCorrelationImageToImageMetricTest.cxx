@@ -0,0 +1,397 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "NormalizedGradientCorrelation/itkNormalizedGradientCorrelationImageToImageMetric.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkCastImageFilter.h"
+#include "itkImage.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkNeighborhoodOperatorImageFilter.h"
+#include "itkResampleImageFilter.h"
+#include "itkSobelOperator.h"
+#include "itkZeroFluxNeumannBoundaryCondition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// Pin the value of the NormalizedGradientCorrelationImageToImageMetric on a small
+// 2D-3D image pair to the original computation: the moving image is projected on
+// the complete fixed image grid, after which Sobel filters with zero flux Neumann
+// boundary conditions give the gradients of both images. The fixed image region
+// touches the border of the fixed image, so that the boundary handling is tested.
+// For a 3D-3D registration with a B-spline transform, compare the analytic
+// derivative with finite differences.
+
+const unsigned int Dimension = 3;
+typedef itk::Image< float, Dimension >                   ImageType;
+typedef itk::Image< double, Dimension >                  GradientImageType;
+typedef itk::NormalizedGradientCorrelationImageToImageMetric<
+  ImageType, ImageType >                                 MetricType;
+typedef itk::AdvancedTranslationTransform< double, Dimension > TransformType;
+typedef itk::AdvancedRayCastInterpolateImageFunction<
+  ImageType, double >                                    RayCastInterpolatorType;
+typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 > BSplineTransformType;
+typedef itk::BSplineInterpolateImageFunction<
+  ImageType, double, double >                            BSplineInterpolatorType;
+
+/** The metric value as computed by the original implementation. */
+double
+ComputeReferenceValue( const ImageType * fixedImage, const ImageType * movingImage,
+  RayCastInterpolatorType * rayCaster, const ImageType::RegionType & fixedImageRegion )
+{
+  /** Project the moving image on the fixed image grid. */
+  typedef itk::ResampleImageFilter< ImageType, ImageType, double > ResamplerType;
+  ResamplerType::Pointer resampler = ResamplerType::New();
+  resampler->SetInput( movingImage );
+  resampler->SetTransform( rayCaster->GetTransform() );
+  resampler->SetInterpolator( rayCaster );
+  resampler->SetDefaultPixelValue( 0 );
+  resampler->SetSize( fixedImage->GetLargestPossibleRegion().GetSize() );
+  resampler->SetOutputOrigin( fixedImage->GetOrigin() );
+  resampler->SetOutputSpacing( fixedImage->GetSpacing() );
+  resampler->SetOutputDirection( fixedImage->GetDirection() );
+  resampler->Update();
+
+  /** The Sobel gradients of both images. */
+  const ImageType * images[ 2 ] = { fixedImage, resampler->GetOutput() };
+  typedef itk::CastImageFilter< ImageType, GradientImageType > CasterType;
+  typedef itk::NeighborhoodOperatorImageFilter<
+    GradientImageType, GradientImageType >                     SobelFilterType;
+  itk::ZeroFluxNeumannBoundaryCondition< GradientImageType > boundaryCondition;
+  GradientImageType::Pointer                                 gradients[ 2 ][ Dimension ];
+  for( unsigned int k = 0; k < 2; ++k )
+  {
+    CasterType::Pointer caster = CasterType::New();
+    caster->SetInput( images[ k ] );
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      itk::SobelOperator< double, Dimension > sobelOperator;
+      sobelOperator.SetDirection( d );
+      sobelOperator.CreateDirectional();
+      SobelFilterType::Pointer sobelFilter = SobelFilterType::New();
+      sobelFilter->OverrideBoundaryCondition( &boundaryCondition );
+      sobelFilter->SetOperator( sobelOperator );
+      sobelFilter->SetInput( caster->GetOutput() );
+      sobelFilter->Update();
+      gradients[ k ][ d ] = sobelFilter->GetOutput();
+    }
+  }
+
+  /** The mean gradients over the fixed image region. */
+  double mean[ 2 ][ Dimension ] = { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+  for( unsigned int k = 0; k < 2; ++k )
+  {
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      itk::ImageRegionConstIteratorWithIndex< GradientImageType > it( gradients[ k ][ d ], fixedImageRegion );
+      for( ; !it.IsAtEnd(); ++it )
+      {
+        mean[ k ][ d ] += it.Get();
+      }
+      mean[ k ][ d ] /= static_cast< double >( fixedImageRegion.GetNumberOfPixels() );
+    }
+  }
+
+  /** The normalized cross correlation of the gradients. */
+  double sfm = 0.0, sff = 0.0, smm = 0.0;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    itk::ImageRegionConstIteratorWithIndex< GradientImageType > fit( gradients[ 0 ][ d ], fixedImageRegion );
+    itk::ImageRegionConstIteratorWithIndex< GradientImageType > mit( gradients[ 1 ][ d ], fixedImageRegion );
+    for( ; !fit.IsAtEnd(); ++fit, ++mit )
+    {
+      const double f = fit.Get() - mean[ 0 ][ d ];
+      const double m = mit.Get() - mean[ 1 ][ d ];
+      sfm += f * m;
+      sff += f * f;
+      smm += m * m;
+    }
+  }
+
+  return -1.0 * sfm / ( std::sqrt( sff ) * std::sqrt( smm ) );
+
+} // end ComputeReferenceValue()
+
+
+/** Compare the analytic derivative of a 3D-3D registration with central
+ * differences, single- and multi-threaded.
+ */
+int
+TestVolumeDerivative( void )
+{
+  /** Two smooth volumes, the fixed one a shifted version of the moving one. */
+  ImageType::RegionType region;
+  region.SetSize( 0, 12 ); region.SetSize( 1, 12 ); region.SetSize( 2, 12 );
+  ImageType::Pointer images[ 2 ];
+  for( unsigned int k = 0; k < 2; ++k )
+  {
+    images[ k ] = ImageType::New();
+    images[ k ]->SetRegions( region );
+    images[ k ]->Allocate();
+    itk::ImageRegionIteratorWithIndex< ImageType > it( images[ k ], region );
+    for( ; !it.IsAtEnd(); ++it )
+    {
+      const double x = it.GetIndex()[ 0 ] + ( k == 0 ? 0.4 : 0.0 );
+      const double y = it.GetIndex()[ 1 ] - ( k == 0 ? 0.3 : 0.0 );
+      const double z = it.GetIndex()[ 2 ];
+      it.Set( static_cast< float >( 10.0 * std::sin( x / 3.0 ) * std::cos( y / 4.0 )
+        + 5.0 * std::sin( ( y + z ) / 5.0 ) + 0.2 * x * z ) );
+    }
+  }
+
+  /** A B-spline transform whose control points surround the stencils. */
+  BSplineTransformType::Pointer           transform = BSplineTransformType::New();
+  BSplineTransformType::OriginType        gridOrigin;
+  BSplineTransformType::SpacingType       gridSpacing;
+  BSplineTransformType::RegionType        gridRegion;
+  BSplineTransformType::RegionType::SizeType gridSize;
+  gridOrigin.Fill( -8.0 );
+  gridSpacing.Fill( 4.0 );
+  gridSize.Fill( 7 );
+  gridRegion.SetSize( gridSize );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+
+  const unsigned int                  numberOfParameters = transform->GetNumberOfParameters();
+  BSplineTransformType::ParametersType parameters( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    parameters[ i ] = 0.3 * std::sin( 0.7 * i + 0.2 );
+  }
+  transform->SetParameters( parameters );
+
+  /** The fixed image region keeps the stencils away from the image border. */
+  ImageType::RegionType fixedImageRegion;
+  fixedImageRegion.SetIndex( 0, 2 ); fixedImageRegion.SetIndex( 1, 2 ); fixedImageRegion.SetIndex( 2, 2 );
+  fixedImageRegion.SetSize( 0, 8 ); fixedImageRegion.SetSize( 1, 8 ); fixedImageRegion.SetSize( 2, 8 );
+
+  /** Setup the metric. */
+  MetricType::Pointer metric = MetricType::New();
+  metric->SetFixedImage( images[ 0 ] );
+  metric->SetMovingImage( images[ 1 ] );
+  metric->SetFixedImageRegion( fixedImageRegion );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( BSplineInterpolatorType::New() );
+  metric->SetUseMultiThread( true );
+  try
+  {
+    metric->Initialize();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  /** The analytic value and derivative, single- and multi-threaded. */
+  MetricType::MeasureType    values[ 2 ];
+  MetricType::DerivativeType derivatives[ 2 ];
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    metric->SetUseMultiThread( t == 1 );
+    metric->GetValueAndDerivative( parameters, values[ t ], derivatives[ t ] );
+  }
+  const double value = metric->GetValue( parameters );
+
+  /** The derivative by central differences. */
+  const double delta = 1e-4;
+  double       maxDerivative = 0.0;
+  double       maxError      = 0.0;
+  double       maxThreadDifference = 0.0;
+  BSplineTransformType::ParametersType testPoint( parameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    testPoint[ i ] = parameters[ i ] + delta;
+    const double valuep1 = metric->GetValue( testPoint );
+    testPoint[ i ] = parameters[ i ] - delta;
+    const double valuep0 = metric->GetValue( testPoint );
+    testPoint[ i ] = parameters[ i ];
+
+    const double finiteDifference = ( valuep1 - valuep0 ) / ( 2.0 * delta );
+    maxDerivative       = std::max( maxDerivative, std::abs( finiteDifference ) );
+    maxError            = std::max( maxError, std::abs( derivatives[ 0 ][ i ] - finiteDifference ) );
+    maxThreadDifference = std::max( maxThreadDifference,
+      std::abs( derivatives[ 0 ][ i ] - derivatives[ 1 ][ i ] ) );
+  }
+
+  std::cerr << std::setprecision( 10 ) << "Volume registration: value " << values[ 0 ]
+            << " (single-threaded), " << values[ 1 ] << " (multi-threaded), " << value
+            << " (GetValue); derivative: max finite difference " << maxDerivative
+            << ", max error " << maxError << ", max difference between threads "
+            << maxThreadDifference << std::endl;
+
+  if( !( std::abs( values[ 0 ] - value ) < 1e-10 ) || !( std::abs( values[ 1 ] - value ) < 1e-10 ) )
+  {
+    std::cerr << "ERROR: GetValueAndDerivative and GetValue give different values." << std::endl;
+    return 1;
+  }
+  if( !( maxDerivative > 0.0 ) || !( maxError < 1e-4 * maxDerivative ) )
+  {
+    std::cerr << "ERROR: the analytic derivative differs from the finite differences." << std::endl;
+    return 1;
+  }
+  if( !( maxThreadDifference < 1e-10 * maxDerivative ) )
+  {
+    std::cerr << "ERROR: the single- and multi-threaded derivatives differ." << std::endl;
+    return 1;
+  }
+
+  return 0;
+
+} // end TestVolumeDerivative()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** A moving volume with a textured ellipsoid around the origin. */
+  ImageType::RegionType movingRegion;
+  movingRegion.SetSize( 0, 20 ); movingRegion.SetSize( 1, 20 ); movingRegion.SetSize( 2, 20 );
+  ImageType::PointType movingOrigin;
+  movingOrigin.Fill( -9.5 );
+  ImageType::Pointer movingImage = ImageType::New();
+  movingImage->SetRegions( movingRegion );
+  movingImage->SetOrigin( movingOrigin );
+  movingImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > mit( movingImage, movingRegion );
+  for( ; !mit.IsAtEnd(); ++mit )
+  {
+    ImageType::PointType point;
+    movingImage->TransformIndexToPhysicalPoint( mit.GetIndex(), point );
+    const double r2 = point[ 0 ] * point[ 0 ] / 64.0 + point[ 1 ] * point[ 1 ] / 36.0 + point[ 2 ] * point[ 2 ] / 49.0;
+    const double value = 1.0 + 0.5 * std::sin( point[ 0 ] / 3.0 ) * std::cos( point[ 1 ] / 4.0 ) + 0.02 * point[ 2 ];
+    mit.Set( r2 < 1.0 ? static_cast< float >( value ) : 0.0f );
+  }
+
+  /** A detector plane of one slice below the volume. */
+  ImageType::RegionType fixedLargestRegion;
+  fixedLargestRegion.SetSize( 0, 24 ); fixedLargestRegion.SetSize( 1, 20 ); fixedLargestRegion.SetSize( 2, 1 );
+  ImageType::SpacingType fixedSpacing;
+  fixedSpacing[ 0 ] = 1.5; fixedSpacing[ 1 ] = 1.5; fixedSpacing[ 2 ] = 1.0;
+  ImageType::PointType fixedOrigin;
+  fixedOrigin[ 0 ] = -17.25; fixedOrigin[ 1 ] = -14.25; fixedOrigin[ 2 ] = -40.0;
+
+  /** The ray caster, and the transform that is optimized. */
+  TransformType::Pointer           transform = TransformType::New();
+  RayCastInterpolatorType::Pointer rayCaster = RayCastInterpolatorType::New();
+  RayCastInterpolatorType::InputPointType focalPoint;
+  focalPoint[ 0 ] = 0.0; focalPoint[ 1 ] = 0.0; focalPoint[ 2 ] = 60.0;
+  rayCaster->SetTransform( transform );
+  rayCaster->SetFocalPoint( focalPoint );
+  rayCaster->SetThreshold( 0.0 );
+
+  /** The fixed image is the projection at a small translation, plus a ramp. */
+  TransformType::ParametersType fixedParameters( Dimension );
+  fixedParameters[ 0 ] = 0.3; fixedParameters[ 1 ] = 0.2; fixedParameters[ 2 ] = 0.0;
+  transform->SetParameters( fixedParameters );
+  typedef itk::ResampleImageFilter< ImageType, ImageType, double > ResamplerType;
+  ResamplerType::Pointer projector = ResamplerType::New();
+  projector->SetInput( movingImage );
+  projector->SetTransform( transform );
+  projector->SetInterpolator( rayCaster );
+  projector->SetSize( fixedLargestRegion.GetSize() );
+  projector->SetOutputOrigin( fixedOrigin );
+  projector->SetOutputSpacing( fixedSpacing );
+  projector->Update();
+  ImageType::Pointer fixedImage = projector->GetOutput();
+  fixedImage->DisconnectPipeline();
+  itk::ImageRegionIteratorWithIndex< ImageType > fit( fixedImage, fixedLargestRegion );
+  for( ; !fit.IsAtEnd(); ++fit )
+  {
+    fit.Set( fit.Get() + 0.05f * static_cast< float >( fit.GetIndex()[ 0 ] ) );
+  }
+
+  /** The fixed image region touches the first column of the fixed image,
+   * but not its first and last rows.
+   */
+  ImageType::RegionType fixedImageRegion;
+  fixedImageRegion.SetIndex( 0, 0 ); fixedImageRegion.SetIndex( 1, 2 ); fixedImageRegion.SetIndex( 2, 0 );
+  fixedImageRegion.SetSize( 0, 20 ); fixedImageRegion.SetSize( 1, 16 ); fixedImageRegion.SetSize( 2, 1 );
+
+  /** Setup the metric. */
+  MetricType::Pointer metric = MetricType::New();
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( fixedImageRegion );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( rayCaster );
+  metric->SetUseMultiThread( true );
+  try
+  {
+    metric->Initialize();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  /** Compare the metric with the reference, single- and multi-threaded. */
+  TransformType::ParametersType parameters( Dimension );
+  const double                  translations[ 3 ][ Dimension ] = {
+    { 0.0, 0.0, 0.0 }, { 0.3, 0.2, 0.0 }, { 1.1, -0.7, 2.0 }
+  };
+  for( unsigned int p = 0; p < 3; ++p )
+  {
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      parameters[ d ] = translations[ p ][ d ];
+    }
+
+    double values[ 2 ] = { 0.0, 0.0 };
+    for( unsigned int t = 0; t < 2; ++t )
+    {
+      metric->SetUseMultiThread( t == 1 );
+      values[ t ] = metric->GetValue( parameters );
+    }
+
+    transform->SetParameters( parameters );
+    const double referenceValue = ComputeReferenceValue(
+      fixedImage, movingImage, rayCaster, fixedImageRegion );
+
+    std::cerr << std::setprecision( 10 ) << "Translation " << parameters
+              << ": metric " << values[ 0 ] << " (single-threaded), " << values[ 1 ]
+              << " (multi-threaded), reference " << referenceValue << std::endl;
+    for( unsigned int t = 0; t < 2; ++t )
+    {
+      if( !( std::abs( values[ t ] - referenceValue ) < 1e-5 ) )
+      {
+        std::cerr << "ERROR: the metric value differs from the reference value." << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  /** The analytic derivative for 3D-3D registration. */
+  if( TestVolumeDerivative() != 0 )
+  {
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
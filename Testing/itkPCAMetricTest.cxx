@@ -0,0 +1,312 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "PCAMetric/itkPCAMetric_F_multithreaded.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include <vnl/algo/vnl_symmetric_eigensystem.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// Test the partial eigensolver of the PCAMetric. The subspace iteration is compared
+// with the full eigendecomposition, for a cold and a warm start. Then the value and
+// derivative of the metric with the partial eigensolver are compared with those of
+// the full eigendecomposition, single- and multi-threaded, for two consecutive
+// evaluations, so that the second one is warm-started.
+
+const unsigned int Dimension = 3;
+typedef itk::Image< float, Dimension >                                  ImageType;
+typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 > TransformType;
+typedef TransformType::ParametersType                                   ParametersType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator          RandomGeneratorType;
+
+/** Exposes the partial eigensolver of the PCAMetric. */
+class PCAMetricTestHelper : public itk::PCAMetric< ImageType, ImageType >
+{
+public:
+
+  typedef PCAMetricTestHelper                    Self;
+  typedef itk::PCAMetric< ImageType, ImageType > Superclass;
+  typedef itk::SmartPointer< Self >              Pointer;
+  typedef Superclass::MatrixType                 MatrixType;
+  typedef Superclass::RealType                   RealType;
+
+  itkNewMacro( Self );
+
+  bool ComputePartial( const MatrixType & K,
+    vnl_vector< RealType > & eigenValues, MatrixType & eigenVectors ) const
+  {
+    return this->ComputeLargestEigenPairsPartial( K, eigenValues, eigenVectors );
+  }
+
+protected:
+
+  PCAMetricTestHelper() {}
+
+};
+
+typedef PCAMetricTestHelper::MatrixType MatrixType;
+typedef PCAMetricTestHelper::RealType   RealType;
+
+/** Compare eigenpairs with the largest ones of the full eigendecomposition.
+ * The eigenvectors are compared up to their sign.
+ */
+bool
+CompareEigenPairs( const MatrixType & K, const vnl_vector< RealType > & eigenValues,
+  const MatrixType & eigenVectors, const double tolerance )
+{
+  const unsigned int                    G = K.rows();
+  vnl_symmetric_eigensystem< RealType > eig( K );
+  for( unsigned int j = 0; j < eigenValues.size(); ++j )
+  {
+    const RealType               expectedValue  = eig.get_eigenvalue( G - 1 - j );
+    const vnl_vector< RealType > expectedVector = eig.get_eigenvector( G - 1 - j ).normalize();
+    const RealType               dot = dot_product( expectedVector, eigenVectors.get_column( j ) );
+    if( !( std::abs( eigenValues[ j ] - expectedValue ) <= tolerance * std::abs( expectedValue ) )
+      || !( std::abs( std::abs( dot ) - 1.0 ) <= tolerance ) )
+    {
+      std::cerr << "ERROR: eigenpair " << j << " has eigenvalue " << eigenValues[ j ]
+                << " instead of " << expectedValue << ", and |v.v_expected| = " << std::abs( dot )
+                << "." << std::endl;
+      return false;
+    }
+  }
+  return true;
+
+} // end CompareEigenPairs()
+
+
+/** A stack of slices that are random combinations of three smooth patterns, plus noise. */
+ImageType::Pointer
+CreateStack( const ImageType::SizeType & size )
+{
+  const unsigned int    G = size[ Dimension - 1 ];
+  std::vector< double > weights( 3 * G );
+  for( unsigned int i = 0; i < weights.size(); ++i )
+  {
+    weights[ i ] = RandomGeneratorType::GetInstance()->GetUniformVariate( -1.0, 1.0 );
+  }
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    const double       x = it.GetIndex()[ 0 ];
+    const double       y = it.GetIndex()[ 1 ];
+    const unsigned int t = it.GetIndex()[ Dimension - 1 ];
+    const double       value = 100.0 * weights[ 3 * t ] * std::sin( x / 3.0 ) * std::cos( y / 4.0 )
+      + 100.0 * weights[ 3 * t + 1 ] * std::cos( x / 5.0 + y / 2.0 )
+      + 100.0 * weights[ 3 * t + 2 ] * std::sin( x * y / 40.0 )
+      + RandomGeneratorType::GetInstance()->GetUniformVariate( 0.0, 5.0 );
+    it.Set( static_cast< float >( value ) );
+  }
+  return image;
+
+} // end CreateStack()
+
+
+int
+main( int argc, char * argv[] )
+{
+  RandomGeneratorType::GetInstance()->Initialize( 1234 );
+
+  /** A stack of G = 14 slices, and a B-spline transform whose grid surrounds it. */
+  ImageType::SizeType size;
+  size[ 0 ] = 16; size[ 1 ] = 16; size[ 2 ] = 14;
+  const unsigned int G     = size[ Dimension - 1 ];
+  const unsigned int numEV = 3;
+  ImageType::Pointer image = CreateStack( size );
+
+  TransformType::Pointer              transform = TransformType::New();
+  TransformType::OriginType           gridOrigin;
+  TransformType::SpacingType          gridSpacing;
+  TransformType::RegionType           gridRegion;
+  TransformType::RegionType::SizeType gridSize;
+  gridOrigin.Fill( -8.0 );
+  gridSpacing.Fill( 4.0 );
+  gridSize.Fill( 8 );
+  gridRegion.SetSize( gridSize );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+
+  const unsigned int numberOfParameters = transform->GetNumberOfParameters();
+  ParametersType     parameters( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    parameters[ i ] = RandomGeneratorType::GetInstance()->GetUniformVariate( -0.3, 0.3 );
+  }
+  transform->SetParameters( parameters );
+
+  /** The samples are taken in the first slice, and the metric loops over the others. */
+  ImageType::RegionType fixedImageRegion;
+  fixedImageRegion.SetIndex( 0, 2 ); fixedImageRegion.SetIndex( 1, 2 ); fixedImageRegion.SetIndex( 2, 0 );
+  fixedImageRegion.SetSize( 0, 12 ); fixedImageRegion.SetSize( 1, 12 ); fixedImageRegion.SetSize( 2, 1 );
+
+  /** Two metrics: with the partial eigensolver, and with the full eigendecomposition. */
+  PCAMetricTestHelper::Pointer metrics[ 2 ];
+  for( unsigned int m = 0; m < 2; ++m )
+  {
+    metrics[ m ] = PCAMetricTestHelper::New();
+    metrics[ m ]->SetFixedImage( image );
+    metrics[ m ]->SetMovingImage( image );
+    metrics[ m ]->SetFixedImageRegion( fixedImageRegion );
+    metrics[ m ]->SetTransform( transform );
+    metrics[ m ]->SetInterpolator( itk::LinearInterpolateImageFunction< ImageType, double >::New() );
+    metrics[ m ]->SetImageSampler( itk::ImageFullSampler< ImageType >::New() );
+    metrics[ m ]->SetNumEigenValues( numEV );
+    metrics[ m ]->SetUsePartialEigenSolver( m == 0 );
+    metrics[ m ]->SetEigenSolverTolerance( 1e-10 );
+    metrics[ m ]->SetMaximumNumberOfEigenSolverIterations( 500 );
+    metrics[ m ]->SetUseMultiThread( true );
+    metrics[ m ]->SetNumberOfThreads( 2 );
+    try
+    {
+      metrics[ m ]->Initialize();
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << excp << std::endl;
+      return 1;
+    }
+  }
+
+  /** A correlation-like matrix with known eigenvalues: 8, 5, 3, 1, 0.5, ... */
+  MatrixType randomMatrix( G, G );
+  for( unsigned int i = 0; i < G; ++i )
+  {
+    for( unsigned int j = 0; j <= i; ++j )
+    {
+      randomMatrix( i, j ) = randomMatrix( j, i )
+        = RandomGeneratorType::GetInstance()->GetUniformVariate( -1.0, 1.0 );
+    }
+  }
+  vnl_symmetric_eigensystem< RealType > basis( randomMatrix );
+  MatrixType                            K( G, G, 0.0 );
+  for( unsigned int j = 0; j < G; ++j )
+  {
+    const RealType eigenValue = j == 0 ? 8.0 : j == 1 ? 5.0 : j == 2 ? 3.0 : 1.0 / ( j - 2 );
+    K += eigenValue * outer_product( basis.get_eigenvector( j ), basis.get_eigenvector( j ) );
+  }
+
+  /** The cold start of the subspace iteration. */
+  vnl_vector< RealType > eigenValues;
+  MatrixType             eigenVectors;
+  if( !metrics[ 0 ]->ComputePartial( K, eigenValues, eigenVectors )
+    || !CompareEigenPairs( K, eigenValues, eigenVectors, 1e-8 ) )
+  {
+    std::cerr << "ERROR: the cold-started subspace iteration failed." << std::endl;
+    return 1;
+  }
+
+  /** The warm start: after a small perturbation a single iteration suffices. */
+  MatrixType perturbedK( K );
+  for( unsigned int i = 0; i < G; ++i )
+  {
+    for( unsigned int j = 0; j <= i; ++j )
+    {
+      const RealType perturbation = 1e-9 * RandomGeneratorType::GetInstance()->GetUniformVariate( -1.0, 1.0 );
+      perturbedK( i, j ) += perturbation;
+      if( i != j )
+      {
+        perturbedK( j, i ) += perturbation;
+      }
+    }
+  }
+  metrics[ 0 ]->SetEigenSolverTolerance( 1e-6 );
+  metrics[ 0 ]->SetMaximumNumberOfEigenSolverIterations( 1 );
+  if( !metrics[ 0 ]->ComputePartial( perturbedK, eigenValues, eigenVectors )
+    || !CompareEigenPairs( perturbedK, eigenValues, eigenVectors, 1e-6 ) )
+  {
+    std::cerr << "ERROR: the warm-started subspace iteration failed." << std::endl;
+    return 1;
+  }
+
+  /** Without iterations the subspace iteration reports failure. */
+  metrics[ 0 ]->SetMaximumNumberOfEigenSolverIterations( 0 );
+  if( metrics[ 0 ]->ComputePartial( K, eigenValues, eigenVectors ) )
+  {
+    std::cerr << "ERROR: the subspace iteration converged without iterations." << std::endl;
+    return 1;
+  }
+  metrics[ 0 ]->SetEigenSolverTolerance( 1e-10 );
+  metrics[ 0 ]->SetMaximumNumberOfEigenSolverIterations( 500 );
+  metrics[ 0 ]->Initialize();
+
+  /** Compare the value and derivative of the metrics, for two consecutive
+   * parameter vectors, single- and multi-threaded.
+   */
+  for( unsigned int evaluation = 0; evaluation < 2; ++evaluation )
+  {
+    if( evaluation == 1 )
+    {
+      for( unsigned int i = 0; i < numberOfParameters; ++i )
+      {
+        parameters[ i ] += RandomGeneratorType::GetInstance()->GetUniformVariate( -0.01, 0.01 );
+      }
+    }
+
+    for( unsigned int t = 0; t < 2; ++t )
+    {
+      PCAMetricTestHelper::MeasureType    values[ 2 ];
+      PCAMetricTestHelper::DerivativeType derivatives[ 2 ];
+      for( unsigned int m = 0; m < 2; ++m )
+      {
+        metrics[ m ]->SetUseMultiThread( t == 1 );
+        metrics[ m ]->GetValueAndDerivative( parameters, values[ m ], derivatives[ m ] );
+      }
+      const double valueOnly = metrics[ 0 ]->GetValue( parameters );
+
+      double maxDerivative = 0.0;
+      double maxDifference = 0.0;
+      for( unsigned int i = 0; i < numberOfParameters; ++i )
+      {
+        maxDerivative = std::max( maxDerivative, std::abs( derivatives[ 1 ][ i ] ) );
+        maxDifference = std::max( maxDifference, std::abs( derivatives[ 0 ][ i ] - derivatives[ 1 ][ i ] ) );
+      }
+
+      std::cerr << std::setprecision( 12 ) << "Evaluation " << evaluation
+                << ( t == 1 ? " (multi-threaded)" : " (single-threaded)" ) << ": value "
+                << values[ 0 ] << " (partial), " << values[ 1 ] << " (full); derivative: max "
+                << maxDerivative << ", max difference " << maxDifference << std::endl;
+
+      if( !( std::abs( values[ 0 ] - values[ 1 ] ) <= 1e-8 * std::max( 1.0, std::abs( values[ 1 ] ) ) )
+        || !( std::abs( valueOnly - values[ 1 ] ) <= 1e-8 * std::max( 1.0, std::abs( values[ 1 ] ) ) ) )
+      {
+        std::cerr << "ERROR: the value with the partial eigensolver differs from the full one." << std::endl;
+        return 1;
+      }
+      if( !( maxDerivative > 0.0 ) || !( maxDifference <= 1e-6 * maxDerivative ) )
+      {
+        std::cerr << "ERROR: the derivative with the partial eigensolver differs from the full one." << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+
+} // end main
@@ -0,0 +1,270 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "CorrespondingPointsEuclideanDistanceMetric/itkCorrespondingPointsEuclideanDistancePointMetric.h"
+#include "MissingStructurePenalty/itkMissingStructurePenalty.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTriangleCell.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// Test that the threaded evaluation of the point-set metrics gives the same value
+// and derivative as the serial evaluation, and that the corresponding points
+// metric notices points that are changed after its initialization.
+
+const unsigned int Dimension = 3;
+typedef double CoordinateRepresentationType;
+typedef itk::PointSet<
+  CoordinateRepresentationType, Dimension,
+  itk::DefaultStaticMeshTraits<
+  CoordinateRepresentationType,
+  Dimension, Dimension,
+  CoordinateRepresentationType, CoordinateRepresentationType,
+  CoordinateRepresentationType > >                         PointSetType;
+typedef itk::SingleValuedPointSetToPointSetMetric<
+  PointSetType, PointSetType >                             MetricBaseType;
+typedef itk::CorrespondingPointsEuclideanDistancePointMetric<
+  PointSetType, PointSetType >                             CorrespondingPointsMetricType;
+typedef itk::MissingVolumeMeshPenalty<
+  PointSetType, PointSetType >                             MissingVolumeMetricType;
+typedef itk::AdvancedBSplineDeformableTransform<
+  CoordinateRepresentationType, Dimension, 3 >             TransformType;
+typedef TransformType::ParametersType                      ParametersType;
+typedef MetricBaseType::MeasureType                        MeasureType;
+typedef MetricBaseType::DerivativeType                     DerivativeType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+/** Compare the serial evaluation of a metric with the evaluation using several
+ * numbers of threads. The summation order differs per number of threads, so the
+ * results are compared with a small relative tolerance.
+ */
+bool
+CompareThreadedWithSerial( MetricBaseType * metric, const ParametersType & parameters,
+  const char * name )
+{
+  MeasureType    serialValue = 0.0;
+  DerivativeType serialDerivative;
+  metric->SetUseMultiThread( false );
+  metric->GetValueAndDerivative( parameters, serialValue, serialDerivative );
+  const MeasureType serialValueOnly = metric->GetValue( parameters );
+
+  double derivativeScale = 0.0;
+  for( unsigned int i = 0; i < serialDerivative.GetSize(); ++i )
+  {
+    derivativeScale = std::max( derivativeScale, std::abs( serialDerivative[ i ] ) );
+  }
+  if( derivativeScale == 0.0 )
+  {
+    std::cerr << "ERROR: " << name << " has a zero derivative, so the test is void." << std::endl;
+    return false;
+  }
+
+  const double tolerance = 1e-10;
+  if( std::abs( serialValueOnly - serialValue ) > tolerance * std::abs( serialValue ) )
+  {
+    std::cerr << "ERROR: " << name << " GetValue() gives " << serialValueOnly
+              << ", GetValueAndDerivative() gives " << serialValue << std::endl;
+    return false;
+  }
+
+  const unsigned int numberOfThreadsList[] = { 1, 2, 3, 8 };
+  for( unsigned int t = 0; t < 4; ++t )
+  {
+    metric->SetUseMultiThread( true );
+    metric->SetNumberOfThreads( numberOfThreadsList[ t ] );
+
+    MeasureType    value = 0.0;
+    DerivativeType derivative;
+    metric->GetValueAndDerivative( parameters, value, derivative );
+    const MeasureType valueOnly = metric->GetValue( parameters );
+
+    double maximumDifference = 0.0;
+    for( unsigned int i = 0; i < derivative.GetSize(); ++i )
+    {
+      maximumDifference = std::max( maximumDifference,
+        std::abs( derivative[ i ] - serialDerivative[ i ] ) );
+    }
+
+    std::cerr << name << " with " << numberOfThreadsList[ t ] << " threads: value "
+              << value << " (serial " << serialValue << "), maximum derivative difference "
+              << maximumDifference << std::endl;
+
+    if( std::abs( value - serialValue ) > tolerance * std::abs( serialValue )
+      || std::abs( valueOnly - serialValue ) > tolerance * std::abs( serialValue )
+      || maximumDifference > tolerance * derivativeScale )
+    {
+      std::cerr << "ERROR: the threaded evaluation of " << name
+                << " differs from the serial evaluation." << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+
+} // end CompareThreadedWithSerial()
+
+
+int
+main( int argc, char * argv[] )
+{
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->SetSeed( 1234 );
+
+  /** A B-spline transform with a grid around [ -1.5, 1.5 ]^3 and random coefficients. */
+  TransformType::Pointer transform = TransformType::New();
+  TransformType::OriginType gridOrigin;
+  gridOrigin.Fill( -3.0 );
+  TransformType::SpacingType gridSpacing;
+  gridSpacing.Fill( 1.0 );
+  TransformType::RegionType::SizeType gridSize;
+  gridSize.Fill( 7 );
+  TransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  TransformType::DirectionType gridDirection;
+  gridDirection.SetIdentity();
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridDirection( gridDirection );
+
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = randomGenerator->GetUniformVariate( -0.1, 0.1 );
+  }
+  transform->SetParameters( parameters );
+
+  /** Random corresponding points. */
+  PointSetType::Pointer fixedPointSet  = PointSetType::New();
+  PointSetType::Pointer movingPointSet = PointSetType::New();
+  const unsigned int    numberOfPoints = 501;
+  for( unsigned int i = 0; i < numberOfPoints; ++i )
+  {
+    PointSetType::PointType fixedPoint;
+    PointSetType::PointType movingPoint;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      fixedPoint[ d ]  = randomGenerator->GetUniformVariate( -1.4, 1.4 );
+      movingPoint[ d ] = fixedPoint[ d ] + randomGenerator->GetUniformVariate( -0.3, 0.3 );
+    }
+    fixedPointSet->SetPoint( i, fixedPoint );
+    movingPointSet->SetPoint( i, movingPoint );
+  }
+
+  /** A closed triangle mesh: an octahedron with a perturbed top. */
+  typedef MissingVolumeMetricType::FixedMeshType FixedMeshType;
+  typedef FixedMeshType::CellType                CellType;
+  typedef itk::TriangleCell< CellType >          TriangleType;
+  FixedMeshType::Pointer mesh = FixedMeshType::New();
+  const double vertices[ 6 ][ 3 ] = {
+    { 1.1, 0.0, 0.0 }, { -1.2, 0.0, 0.0 }, { 0.0, 1.3, 0.0 },
+    { 0.0, -1.0, 0.0 }, { 0.1, 0.2, 1.4 }, { 0.0, 0.0, -1.1 }
+  };
+  for( unsigned int i = 0; i < 6; ++i )
+  {
+    FixedMeshType::PointType vertex;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      vertex[ d ] = vertices[ i ][ d ];
+    }
+    mesh->SetPoint( i, vertex );
+  }
+  const unsigned int triangles[ 8 ][ 3 ] = {
+    { 0, 2, 4 }, { 2, 1, 4 }, { 1, 3, 4 }, { 3, 0, 4 },
+    { 2, 0, 5 }, { 1, 2, 5 }, { 3, 1, 5 }, { 0, 3, 5 }
+  };
+  for( unsigned int c = 0; c < 8; ++c )
+  {
+    CellType::CellAutoPointer cell;
+    cell.TakeOwnership( new TriangleType );
+    for( unsigned int j = 0; j < 3; ++j )
+    {
+      cell->SetPointId( j, triangles[ c ][ j ] );
+    }
+    mesh->SetCell( c, cell );
+  }
+  MissingVolumeMetricType::FixedMeshContainerPointer meshContainer
+    = MissingVolumeMetricType::FixedMeshContainerType::New();
+  meshContainer->InsertElement( 0, mesh.GetPointer() );
+
+  /** Compare the threaded and serial evaluation of both metrics. */
+  CorrespondingPointsMetricType::Pointer correspondingPointsMetric
+    = CorrespondingPointsMetricType::New();
+  correspondingPointsMetric->SetFixedPointSet( fixedPointSet );
+  correspondingPointsMetric->SetMovingPointSet( movingPointSet );
+  correspondingPointsMetric->SetTransform( transform );
+
+  MissingVolumeMetricType::Pointer missingVolumeMetric = MissingVolumeMetricType::New();
+  missingVolumeMetric->SetFixedPointSet( fixedPointSet );
+  missingVolumeMetric->SetMovingPointSet( movingPointSet );
+  missingVolumeMetric->SetFixedMeshContainer( meshContainer );
+  missingVolumeMetric->SetTransform( transform );
+
+  try
+  {
+    correspondingPointsMetric->Initialize();
+    missingVolumeMetric->Initialize();
+
+    if( !CompareThreadedWithSerial( correspondingPointsMetric, parameters,
+      "CorrespondingPointsEuclideanDistancePointMetric" ) )
+    {
+      return 1;
+    }
+    if( !CompareThreadedWithSerial( missingVolumeMetric, parameters,
+      "MissingVolumeMeshPenalty" ) )
+    {
+      return 1;
+    }
+
+    /** Move one point after the initialization. The corresponding points
+     * metric should use it, like a newly initialized metric does.
+     */
+    PointSetType::PointType movedPoint = movingPointSet->GetPoint( 0 );
+    movedPoint[ 0 ] += 0.5;
+    movingPointSet->SetPoint( 0, movedPoint );
+
+    correspondingPointsMetric->SetUseMultiThread( false );
+    const MeasureType value = correspondingPointsMetric->GetValue( parameters );
+
+    CorrespondingPointsMetricType::Pointer freshMetric = CorrespondingPointsMetricType::New();
+    freshMetric->SetFixedPointSet( fixedPointSet );
+    freshMetric->SetMovingPointSet( movingPointSet );
+    freshMetric->SetTransform( transform );
+    freshMetric->Initialize();
+    const MeasureType freshValue = freshMetric->GetValue( parameters );
+
+    std::cerr << "After moving a point: value " << value
+              << ", value of a new metric " << freshValue << std::endl;
+    if( std::abs( value - freshValue ) > 1e-12 * std::abs( freshValue ) )
+    {
+      std::cerr << "ERROR: the changed point is not used by the metric." << std::endl;
+      return 1;
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  return 0;
+
+} // end main
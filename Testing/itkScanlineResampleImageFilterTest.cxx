@@ -0,0 +1,462 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkScanlineResampleImageFilter.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkResampleImageFilter.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkTimeProbe.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// Test that the scanline fast path of the ScanlineResampleImageFilter gives
+// the same result as the itk::ResampleImageFilter, for linear and nearest
+// neighbour interpolation, and report the timings of both.
+//
+// The geometries cover oblique image directions, partial overlap, negative
+// steps along the scanline, half integer ties of the nearest neighbour
+// interpolator, and dimensions of size 1. The transform is a combination of
+// two linear transforms, as in elastix.
+
+template< unsigned int VDimension >
+class ScanlineResampleTester
+{
+public:
+
+  typedef float                                                PixelType;
+  typedef itk::Image< PixelType, VDimension >                  ImageType;
+  typedef itk::AdvancedMatrixOffsetTransformBase< double, VDimension, VDimension > LinearTransformType;
+  typedef itk::AdvancedCombinationTransform< double, VDimension > CombinationTransformType;
+  typedef itk::ScanlineResampleImageFilter< ImageType, ImageType, double > ScanlineResamplerType;
+  typedef itk::ResampleImageFilter< ImageType, ImageType, double > ResamplerType;
+  typedef itk::InterpolateImageFunction< ImageType, double >   InterpolatorType;
+  typedef itk::LinearInterpolateImageFunction< ImageType, double > LinearInterpolatorType;
+  typedef itk::NearestNeighborInterpolateImageFunction< ImageType, double > NearestNeighborInterpolatorType;
+  typedef typename ImageType::SizeType      SizeType;
+  typedef typename ImageType::SpacingType   SpacingType;
+  typedef typename ImageType::PointType     PointType;
+  typedef typename ImageType::DirectionType DirectionType;
+  typedef typename LinearTransformType::MatrixType       MatrixType;
+  typedef typename LinearTransformType::OutputVectorType VectorType;
+
+  /** A rotation in the plane of the first two dimensions. */
+  static DirectionType Rotation( const double angle )
+  {
+    DirectionType rotation;
+    rotation.SetIdentity();
+    rotation[ 0 ][ 0 ] = std::cos( angle );
+    rotation[ 0 ][ 1 ] = -std::sin( angle );
+    rotation[ 1 ][ 0 ] = std::sin( angle );
+    rotation[ 1 ][ 1 ] = std::cos( angle );
+    return rotation;
+  }
+
+
+  /** An input image with distinct, non-smooth values. */
+  static typename ImageType::Pointer CreateInput( const SizeType & size,
+    const SpacingType & spacing, const PointType & origin, const DirectionType & direction )
+  {
+    typename ImageType::Pointer image = ImageType::New();
+    typename ImageType::RegionType region;
+    region.SetSize( size );
+    image->SetRegions( region );
+    image->SetSpacing( spacing );
+    image->SetOrigin( origin );
+    image->SetDirection( direction );
+    image->Allocate();
+    itk::ImageRegionIterator< ImageType > it( image, region );
+    unsigned int i = 0;
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it, ++i )
+    {
+      it.Set( static_cast< PixelType >( ( i * 37 ) % 101 ) + 0.25f * std::sin( 0.1 * i ) );
+    }
+    return image;
+  }
+
+
+  /** A combination of two linear transforms, mapping p to A2 (A1 p + t1) + t2. */
+  static typename CombinationTransformType::Pointer CreateTransform(
+    const MatrixType & matrix1, const VectorType & offset1,
+    const MatrixType & matrix2, const VectorType & offset2 )
+  {
+    typename LinearTransformType::Pointer initial = LinearTransformType::New();
+    initial->SetMatrix( matrix1 );
+    initial->SetOffset( offset1 );
+    typename LinearTransformType::Pointer current = LinearTransformType::New();
+    current->SetMatrix( matrix2 );
+    current->SetOffset( offset2 );
+    typename CombinationTransformType::Pointer combination = CombinationTransformType::New();
+    combination->SetCurrentTransform( current );
+    combination->SetInitialTransform( initial );
+    combination->SetUseComposition( true );
+    return combination;
+  }
+
+
+  /** Resample with both filters and both interpolators, and compare. */
+  static int Compare( const char * name, const ImageType * input,
+    const typename CombinationTransformType::Pointer & transform,
+    const SizeType & outputSize, const SpacingType & outputSpacing,
+    const PointType & outputOrigin, const DirectionType & outputDirection,
+    const unsigned int numberOfRuns = 1 )
+  {
+    for( unsigned int nn = 0; nn < 2; ++nn )
+    {
+      typename InterpolatorType::Pointer interpolator1, interpolator2;
+      if( nn == 0 )
+      {
+        interpolator1 = LinearInterpolatorType::New().GetPointer();
+        interpolator2 = LinearInterpolatorType::New().GetPointer();
+      }
+      else
+      {
+        interpolator1 = NearestNeighborInterpolatorType::New().GetPointer();
+        interpolator2 = NearestNeighborInterpolatorType::New().GetPointer();
+      }
+
+      typename ScanlineResamplerType::Pointer scanlineResampler = ScanlineResamplerType::New();
+      typename ResamplerType::Pointer         resampler         = ResamplerType::New();
+      scanlineResampler->SetInput( input );
+      scanlineResampler->SetTransform( transform );
+      scanlineResampler->SetInterpolator( interpolator1 );
+      scanlineResampler->SetSize( outputSize );
+      scanlineResampler->SetOutputSpacing( outputSpacing );
+      scanlineResampler->SetOutputOrigin( outputOrigin );
+      scanlineResampler->SetOutputDirection( outputDirection );
+      scanlineResampler->SetDefaultPixelValue( -1000.0f );
+      resampler->SetInput( input );
+      resampler->SetTransform( transform );
+      resampler->SetInterpolator( interpolator2 );
+      resampler->SetSize( outputSize );
+      resampler->SetOutputSpacing( outputSpacing );
+      resampler->SetOutputOrigin( outputOrigin );
+      resampler->SetOutputDirection( outputDirection );
+      resampler->SetDefaultPixelValue( -1000.0f );
+
+      itk::TimeProbe timeProbeScanline, timeProbeITK;
+      try
+      {
+        for( unsigned int run = 0; run < numberOfRuns; ++run )
+        {
+          scanlineResampler->Modified();
+          timeProbeScanline.Start();
+          scanlineResampler->Update();
+          timeProbeScanline.Stop();
+          resampler->Modified();
+          timeProbeITK.Start();
+          resampler->Update();
+          timeProbeITK.Stop();
+        }
+      }
+      catch( itk::ExceptionObject & excp )
+      {
+        std::cerr << excp << std::endl;
+        return 1;
+      }
+
+      const char * interpolatorName = nn == 0 ? "linear" : "nearest neighbour";
+      const typename ScanlineResamplerType::FastPathType expectedFastPath = nn == 0
+        ? ScanlineResamplerType::LinearFastPath : ScanlineResamplerType::NearestNeighborFastPath;
+      if( scanlineResampler->GetFastPath() != expectedFastPath )
+      {
+        std::cerr << "ERROR: " << name << ", " << interpolatorName
+                  << ": the fast path was not selected." << std::endl;
+        return 1;
+      }
+
+      /** Compare all pixels; nearest neighbour must match exactly. */
+      itk::ImageRegionConstIterator< ImageType > it( resampler->GetOutput(),
+        resampler->GetOutput()->GetLargestPossibleRegion() );
+      itk::ImageRegionConstIterator< ImageType > sit( scanlineResampler->GetOutput(),
+        scanlineResampler->GetOutput()->GetLargestPossibleRegion() );
+      double        maximumDifference = 0.0;
+      unsigned long numberOfInside    = 0;
+      for( it.GoToBegin(), sit.GoToBegin(); !it.IsAtEnd(); ++it, ++sit )
+      {
+        maximumDifference = std::max( maximumDifference,
+          static_cast< double >( std::abs( it.Get() - sit.Get() ) ) );
+        numberOfInside += it.Get() != -1000.0f;
+      }
+
+      std::cerr << std::setprecision( 4 )
+                << name << ", " << interpolatorName << ": " << numberOfInside
+                << " of " << resampler->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels()
+                << " pixels inside, maximum difference " << maximumDifference
+                << ", time ITK " << timeProbeITK.GetMean()
+                << ", time scanline " << timeProbeScanline.GetMean()
+                << " " << timeProbeITK.GetUnit()
+                << ", speedup factor " << timeProbeITK.GetMean() / timeProbeScanline.GetMean()
+                << std::endl;
+
+      const double tolerance = nn == 0 ? 1e-3 : 0.0;
+      if( maximumDifference > tolerance || numberOfInside == 0 )
+      {
+        std::cerr << "ERROR: the scanline fast path differs from itk::ResampleImageFilter." << std::endl;
+        return 1;
+      }
+    }
+
+    return 0;
+  }
+
+
+};
+
+
+/** A line that only touches the buffer at its inclusive start boundary,
+ * with a negative step, must keep that one point.
+ */
+int
+TestInsideRange( void )
+{
+  typedef ScanlineResampleTester< 2 >                 TesterType;
+  typedef TesterType::ScanlineResamplerType           ScanlineResamplerType;
+  typedef ScanlineResamplerType::ContinuousIndexType ContinuousIndexType;
+
+  TesterType::SizeType    size;
+  TesterType::SpacingType spacing;
+  TesterType::PointType   origin;
+  size.Fill( 10 );
+  spacing.Fill( 1.0 );
+  origin.Fill( 0.0 );
+  TesterType::DirectionType direction;
+  direction.SetIdentity();
+  TesterType::ImageType::Pointer image = TesterType::CreateInput( size, spacing, origin, direction );
+  TesterType::LinearInterpolatorType::Pointer interpolator = TesterType::LinearInterpolatorType::New();
+  interpolator->SetInputImage( image );
+
+  /** Dimension 0 leaves the buffer after k = 2, dimension 1 enters it at k = 2. */
+  ContinuousIndexType first, step;
+  first[ 0 ] = 1.5;
+  step[ 0 ]  = -1.0;
+  first[ 1 ] = -2.5;
+  step[ 1 ]  = 1.0;
+  itk::SizeValueType kBegin = 0;
+  itk::SizeValueType kEnd   = 0;
+  ScanlineResamplerType::ComputeScanlineInsideRange( interpolator, first, step, 5, kBegin, kEnd );
+  if( kBegin != 2 || kEnd != 3 )
+  {
+    std::cerr << "ERROR: inside range [" << kBegin << ", " << kEnd
+              << ") of a touching line, expected [2, 3)." << std::endl;
+    return 1;
+  }
+
+  /** A line that misses the buffer. */
+  first[ 1 ] = -3.5;
+  ScanlineResamplerType::ComputeScanlineInsideRange( interpolator, first, step, 5, kBegin, kEnd );
+  if( kBegin != kEnd )
+  {
+    std::cerr << "ERROR: inside range [" << kBegin << ", " << kEnd
+              << ") of a missing line, expected empty." << std::endl;
+    return 1;
+  }
+
+  return 0;
+
+} // end TestInsideRange()
+
+
+int
+main( int argc, char * argv[] )
+{
+  if( TestInsideRange() ) { return 1; }
+
+  typedef ScanlineResampleTester< 2 > Tester2DType;
+  typedef ScanlineResampleTester< 3 > Tester3DType;
+
+  /** 2D: oblique input and output directions, partial overlap. */
+  {
+    Tester2DType::SizeType size;
+    size[ 0 ] = 60;
+    size[ 1 ] = 45;
+    Tester2DType::SpacingType spacing;
+    spacing[ 0 ] = 0.8;
+    spacing[ 1 ] = 1.3;
+    Tester2DType::PointType origin;
+    origin[ 0 ] = 3.0;
+    origin[ 1 ] = -4.0;
+    Tester2DType::ImageType::Pointer input
+      = Tester2DType::CreateInput( size, spacing, origin, Tester2DType::Rotation( 0.2 ) );
+
+    Tester2DType::MatrixType matrix1 = Tester2DType::Rotation( 0.5 );
+    matrix1 *= 1.1;
+    Tester2DType::MatrixType matrix2;
+    matrix2.SetIdentity();
+    matrix2[ 0 ][ 1 ] = 0.15;
+    Tester2DType::VectorType offset1, offset2;
+    offset1[ 0 ] = 4.3;
+    offset1[ 1 ] = -2.1;
+    offset2[ 0 ] = -1.7;
+    offset2[ 1 ] = 0.6;
+
+    Tester2DType::SizeType outputSize;
+    outputSize[ 0 ] = 71;
+    outputSize[ 1 ] = 53;
+    Tester2DType::SpacingType outputSpacing;
+    outputSpacing[ 0 ] = 0.9;
+    outputSpacing[ 1 ] = 0.7;
+    Tester2DType::PointType outputOrigin;
+    outputOrigin[ 0 ] = -10.0;
+    outputOrigin[ 1 ] = 5.0;
+    if( Tester2DType::Compare( "2D oblique", input,
+      Tester2DType::CreateTransform( matrix1, offset1, matrix2, offset2 ),
+      outputSize, outputSpacing, outputOrigin, Tester2DType::Rotation( -0.3 ) ) )
+    {
+      return 1;
+    }
+
+    /** Negative steps: a flipped output direction and a transform that
+     * turns by more than 90 degrees.
+     */
+    Tester2DType::DirectionType flip;
+    flip.SetIdentity();
+    flip[ 0 ][ 0 ] = -1.0;
+    flip[ 1 ][ 1 ] = -1.0;
+    outputOrigin[ 0 ] = 40.0;
+    outputOrigin[ 1 ] = 30.0;
+    if( Tester2DType::Compare( "2D negative steps", input,
+      Tester2DType::CreateTransform( Tester2DType::Rotation( 2.3 ), offset1, matrix2, offset2 ),
+      outputSize, outputSpacing, outputOrigin, flip ) )
+    {
+      return 1;
+    }
+  }
+
+  /** 2D: half integer ties for the nearest neighbour interpolator. */
+  {
+    Tester2DType::SizeType size;
+    size.Fill( 20 );
+    Tester2DType::SpacingType spacing;
+    spacing.Fill( 1.0 );
+    Tester2DType::PointType origin;
+    origin.Fill( 0.0 );
+    Tester2DType::DirectionType identity;
+    identity.SetIdentity();
+    Tester2DType::ImageType::Pointer input = Tester2DType::CreateInput( size, spacing, origin, identity );
+
+    Tester2DType::MatrixType matrix;
+    matrix.SetIdentity();
+    Tester2DType::VectorType offset1, offset2;
+    offset1[ 0 ] = 0.5;
+    offset1[ 1 ] = -0.25;
+    offset2[ 0 ] = 0.0;
+    offset2[ 1 ] = -0.25;
+
+    Tester2DType::SizeType outputSize;
+    outputSize.Fill( 24 );
+    Tester2DType::PointType outputOrigin;
+    outputOrigin.Fill( -2.0 );
+    if( Tester2DType::Compare( "2D half integer ties", input,
+      Tester2DType::CreateTransform( matrix, offset1, matrix, offset2 ),
+      outputSize, spacing, outputOrigin, identity ) )
+    {
+      return 1;
+    }
+  }
+
+  /** 3D: dimensions of size 1, in the input and in the output. */
+  {
+    Tester3DType::SizeType size;
+    size[ 0 ] = 16;
+    size[ 1 ] = 12;
+    size[ 2 ] = 1;
+    Tester3DType::SpacingType spacing;
+    spacing.Fill( 1.0 );
+    Tester3DType::PointType origin;
+    origin.Fill( 0.0 );
+    Tester3DType::ImageType::Pointer input
+      = Tester3DType::CreateInput( size, spacing, origin, Tester3DType::Rotation( 0.1 ) );
+
+    Tester3DType::MatrixType matrix1 = Tester3DType::Rotation( 0.3 );
+    Tester3DType::MatrixType matrix2;
+    matrix2.SetIdentity();
+    Tester3DType::VectorType offset1, offset2;
+    offset1[ 0 ] = 0.4;
+    offset1[ 1 ] = 1.3;
+    offset1[ 2 ] = 0.2;
+    offset2.Fill( 0.0 );
+
+    Tester3DType::SizeType outputSize;
+    outputSize[ 0 ] = 20;
+    outputSize[ 1 ] = 1;
+    outputSize[ 2 ] = 1;
+    Tester3DType::PointType outputOrigin;
+    outputOrigin[ 0 ] = -2.0;
+    outputOrigin[ 1 ] = 5.0;
+    outputOrigin[ 2 ] = 0.0;
+    const Tester3DType::CombinationTransformType::Pointer transform
+      = Tester3DType::CreateTransform( matrix1, offset1, matrix2, offset2 );
+    if( Tester3DType::Compare( "3D size 1 output lines", input, transform,
+      outputSize, spacing, outputOrigin, Tester3DType::Rotation( -0.2 ) ) )
+    {
+      return 1;
+    }
+
+    outputSize[ 0 ] = 1;
+    outputSize[ 1 ] = 15;
+    outputSize[ 2 ] = 1;
+    outputOrigin[ 0 ] = 6.0;
+    outputOrigin[ 1 ] = -2.0;
+    if( Tester3DType::Compare( "3D size 1 scanlines", input, transform,
+      outputSize, spacing, outputOrigin, Tester3DType::Rotation( -0.2 ) ) )
+    {
+      return 1;
+    }
+  }
+
+  /** 3D timing: an oblique affine resampling of a larger image. */
+  {
+    Tester3DType::SizeType size;
+    size.Fill( 128 );
+    Tester3DType::SpacingType spacing;
+    spacing.Fill( 1.0 );
+    Tester3DType::PointType origin;
+    origin.Fill( 0.0 );
+    Tester3DType::DirectionType identity;
+    identity.SetIdentity();
+    Tester3DType::ImageType::Pointer input = Tester3DType::CreateInput( size, spacing, origin, identity );
+
+    Tester3DType::MatrixType matrix1 = Tester3DType::Rotation( 0.25 );
+    Tester3DType::MatrixType matrix2;
+    matrix2.SetIdentity();
+    matrix2[ 2 ][ 0 ] = 0.1;
+    Tester3DType::VectorType offset1, offset2;
+    offset1.Fill( 3.3 );
+    offset2.Fill( -1.2 );
+
+    Tester3DType::SpacingType outputSpacing;
+    outputSpacing.Fill( 1.1 );
+    if( Tester3DType::Compare( "3D timing", input,
+      Tester3DType::CreateTransform( matrix1, offset1, matrix2, offset2 ),
+      size, outputSpacing, origin, identity, 3 ) )
+    {
+      return 1;
+    }
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
@@ -0,0 +1,410 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "SelfSimilarityContext/itkSelfSimilarityContextImageToImageMetric.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Test the SelfSimilarityContextImageToImageMetric. The descriptors are compared
+// with a direct computation voxel by voxel, and should not depend on the number of
+// threads. The derivative of the measure for a B-spline transform is compared with
+// central differences.
+
+const unsigned int Dimension = 3;
+typedef itk::Image< float, Dimension >                         ImageType;
+typedef itk::SelfSimilarityContextImageToImageMetric<
+  ImageType, ImageType >                                       MetricType;
+typedef MetricType::DescriptorImageType                        DescriptorImageType;
+typedef MetricType::DescriptorValueType                        DescriptorValueType;
+typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 > TransformType;
+typedef TransformType::ParametersType                          ParametersType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+const unsigned int NumberOfChannels = MetricType::NumberOfChannels;
+const unsigned int BitsPerChannel   = MetricType::BitsPerChannel;
+
+/** An image with uniformly distributed random intensities. */
+ImageType::Pointer
+CreateRandomImage( const ImageType::SizeType & size )
+{
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    it.Set( static_cast< float >( RandomGeneratorType::GetInstance()->GetUniformVariate( 0.0, 100.0 ) ) );
+  }
+  return image;
+
+} // end CreateRandomImage()
+
+
+/** Compare the descriptors with a direct computation: per voxel and channel
+ * the sum over the patch of the squared differences between the clamped
+ * neighbours, normalized as described in the class documentation. Returns
+ * the number of errors. A quantization level may only differ when the
+ * reference lies within 1e-3 of a rounding boundary, because the metric
+ * uses single precision.
+ */
+unsigned int
+CompareWithReference( const ImageType * image, const DescriptorImageType * descriptors,
+  const unsigned int patchRadius, const unsigned int neighbourhoodDistance )
+{
+  typedef ImageType::IndexType IndexType;
+  const ImageType::RegionType region = image->GetLargestPossibleRegion();
+  const ImageType::SizeType   size   = region.GetSize();
+
+  /** The channels: pairs of six-neighbourhood offsets that are not opposite. */
+  std::vector< std::vector< itk::IndexValueType > > neighbours;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    for( int sign = -1; sign <= 1; sign += 2 )
+    {
+      std::vector< itk::IndexValueType > offset( Dimension, 0 );
+      offset[ d ] = sign * static_cast< itk::IndexValueType >( neighbourhoodDistance );
+      neighbours.push_back( offset );
+    }
+  }
+  std::vector< std::pair< unsigned int, unsigned int > > channels;
+  for( unsigned int a = 0; a < neighbours.size(); ++a )
+  {
+    for( unsigned int b = a + 1; b < neighbours.size(); ++b )
+    {
+      if( !( a % 2 == 0 && b == a + 1 ) )
+      {
+        channels.push_back( std::make_pair( a, b ) );
+      }
+    }
+  }
+  if( channels.size() != NumberOfChannels )
+  {
+    std::cerr << "ERROR: expected " << NumberOfChannels << " channels." << std::endl;
+    return 1;
+  }
+
+  /** The patch distances of all voxels and channels. */
+  const unsigned long   numberOfVoxels = region.GetNumberOfPixels();
+  std::vector< double > distances( numberOfVoxels * NumberOfChannels, 0.0 );
+  std::vector< double > minimum( numberOfVoxels );
+  std::vector< double > variance( numberOfVoxels );
+  double                meanVariance = 0.0;
+  itk::ImageRegionConstIteratorWithIndex< ImageType > it( image, region );
+  for( unsigned long k = 0; !it.IsAtEnd(); ++it, ++k )
+  {
+    const IndexType index = it.GetIndex();
+    for( unsigned int c = 0; c < NumberOfChannels; ++c )
+    {
+      const itk::IndexValueType radius = static_cast< itk::IndexValueType >( patchRadius );
+      for( itk::IndexValueType p0 = -radius; p0 <= radius; ++p0 )
+      {
+        for( itk::IndexValueType p1 = -radius; p1 <= radius; ++p1 )
+        {
+          for( itk::IndexValueType p2 = -radius; p2 <= radius; ++p2 )
+          {
+            const itk::IndexValueType p[ Dimension ] = { p0, p1, p2 };
+            IndexType                 y;
+            bool                      inside = true;
+            for( unsigned int d = 0; d < Dimension; ++d )
+            {
+              y[ d ]  = index[ d ] + p[ d ];
+              inside &= y[ d ] >= 0 && y[ d ] < static_cast< itk::IndexValueType >( size[ d ] );
+            }
+            if( !inside )
+            {
+              continue;
+            }
+
+            IndexType ya, yb;
+            for( unsigned int d = 0; d < Dimension; ++d )
+            {
+              const itk::IndexValueType zero = 0;
+              const itk::IndexValueType last = static_cast< itk::IndexValueType >( size[ d ] ) - 1;
+              ya[ d ] = std::min( std::max( y[ d ] + neighbours[ channels[ c ].first ][ d ], zero ), last );
+              yb[ d ] = std::min( std::max( y[ d ] + neighbours[ channels[ c ].second ][ d ], zero ), last );
+            }
+            const double diff = image->GetPixel( ya ) - image->GetPixel( yb );
+            distances[ k * NumberOfChannels + c ] += diff * diff;
+          }
+        }
+      }
+    }
+
+    minimum[ k ]  = *std::min_element( distances.begin() + k * NumberOfChannels,
+      distances.begin() + ( k + 1 ) * NumberOfChannels );
+    variance[ k ] = 0.0;
+    for( unsigned int c = 0; c < NumberOfChannels; ++c )
+    {
+      variance[ k ] += distances[ k * NumberOfChannels + c ];
+    }
+    variance[ k ]  = variance[ k ] / NumberOfChannels - minimum[ k ];
+    meanVariance  += variance[ k ];
+  }
+  meanVariance /= static_cast< double >( numberOfVoxels );
+
+  /** Compare the quantized descriptors. */
+  unsigned int numberOfErrors = 0;
+  const DescriptorValueType channelMask = ( DescriptorValueType( 1 ) << BitsPerChannel ) - 1;
+  itk::ImageRegionConstIteratorWithIndex< DescriptorImageType > dit( descriptors, region );
+  for( unsigned long k = 0; !dit.IsAtEnd(); ++dit, ++k )
+  {
+    const double v = std::min( std::max( variance[ k ], 0.001 * meanVariance ), 1000.0 * meanVariance );
+    for( unsigned int c = 0; c < NumberOfChannels; ++c )
+    {
+      const double       scaled   = std::exp( -( distances[ k * NumberOfChannels + c ] - minimum[ k ] ) / v )
+        * BitsPerChannel + 0.5;
+      const unsigned int level    = static_cast< unsigned int >( scaled );
+      const bool         boundary = std::abs( scaled - std::floor( scaled + 0.5 ) ) < 1e-3;
+
+      /** The bits of the channel should be a thermometer code. */
+      const DescriptorValueType code = ( dit.Get() >> ( c * BitsPerChannel ) ) & channelMask;
+      if( ( code & ( code + 1 ) ) != 0 )
+      {
+        std::cerr << "ERROR: channel " << c << " of voxel " << dit.GetIndex()
+                  << " is not a thermometer code." << std::endl;
+        ++numberOfErrors;
+        continue;
+      }
+      unsigned int codeLevel = 0;
+      while( ( code >> codeLevel ) & 1 )
+      {
+        ++codeLevel;
+      }
+      if( codeLevel != level && !boundary )
+      {
+        std::cerr << "ERROR: channel " << c << " of voxel " << dit.GetIndex() << " has level "
+                  << codeLevel << " instead of " << level << "." << std::endl;
+        ++numberOfErrors;
+      }
+    }
+  }
+  return numberOfErrors;
+
+} // end CompareWithReference()
+
+
+int
+main( int argc, char * argv[] )
+{
+  RandomGeneratorType::GetInstance()->Initialize( 1234 );
+
+  /** The Hamming distance. */
+  const DescriptorValueType a = 0x0123456789ABCDEFULL;
+  const DescriptorValueType b = 0xFEDCBA9876543210ULL;
+  unsigned int              bitCount = 0;
+  for( unsigned int i = 0; i < 64; ++i )
+  {
+    bitCount += ( ( a ^ b ) >> i ) & 1;
+  }
+  if( MetricType::HammingDistance( a, b ) != bitCount || MetricType::HammingDistance( a, a ) != 0 )
+  {
+    std::cerr << "ERROR: the Hamming distance is wrong." << std::endl;
+    return 1;
+  }
+
+  /** The descriptors, for two settings and several numbers of threads. The
+   * number of slices is not a multiple of all numbers of threads.
+   */
+  ImageType::SizeType descriptorTestSize;
+  descriptorTestSize[ 0 ] = 10; descriptorTestSize[ 1 ] = 9; descriptorTestSize[ 2 ] = 8;
+  ImageType::Pointer  descriptorTestImage = CreateRandomImage( descriptorTestSize );
+  MetricType::Pointer metric              = MetricType::New();
+  const unsigned int  settings[ 2 ][ 2 ]  = { { 1, 2 }, { 2, 1 } };
+  const unsigned int  numbersOfThreads[ 4 ] = { 1, 2, 3, 5 };
+  for( unsigned int s = 0; s < 2; ++s )
+  {
+    DescriptorImageType::Pointer firstDescriptors;
+    for( unsigned int t = 0; t < 4; ++t )
+    {
+      metric->SetUseMultiThread( numbersOfThreads[ t ] > 1 );
+      metric->SetNumberOfThreads( numbersOfThreads[ t ] );
+      DescriptorImageType::Pointer descriptors = DescriptorImageType::New();
+      metric->ComputeDescriptorImage( descriptorTestImage.GetPointer(),
+        settings[ s ][ 0 ], settings[ s ][ 1 ], descriptors.GetPointer() );
+
+      if( t == 0 )
+      {
+        const unsigned int numberOfErrors = CompareWithReference(
+          descriptorTestImage, descriptors, settings[ s ][ 0 ], settings[ s ][ 1 ] );
+        if( numberOfErrors > 0 )
+        {
+          std::cerr << "ERROR: " << numberOfErrors << " descriptor channels differ from the reference, "
+                    << "for patch radius " << settings[ s ][ 0 ] << " and neighbourhood distance "
+                    << settings[ s ][ 1 ] << "." << std::endl;
+          return 1;
+        }
+        firstDescriptors = descriptors;
+        continue;
+      }
+
+      itk::ImageRegionConstIterator< DescriptorImageType > it0( firstDescriptors, firstDescriptors->GetBufferedRegion() );
+      itk::ImageRegionConstIterator< DescriptorImageType > it1( descriptors, descriptors->GetBufferedRegion() );
+      for( ; !it0.IsAtEnd(); ++it0, ++it1 )
+      {
+        if( it0.Get() != it1.Get() )
+        {
+          std::cerr << "ERROR: the descriptors computed with " << numbersOfThreads[ t ]
+                    << " threads differ from the single-threaded ones." << std::endl;
+          return 1;
+        }
+      }
+    }
+  }
+  std::cerr << "The descriptors match the reference, for all numbers of threads." << std::endl;
+
+  /** Two random volumes and a B-spline transform whose control points surround them. */
+  ImageType::SizeType size;
+  size.Fill( 12 );
+  ImageType::Pointer fixedImage  = CreateRandomImage( size );
+  ImageType::Pointer movingImage = CreateRandomImage( size );
+
+  TransformType::Pointer              transform = TransformType::New();
+  TransformType::OriginType           gridOrigin;
+  TransformType::SpacingType          gridSpacing;
+  TransformType::RegionType           gridRegion;
+  TransformType::RegionType::SizeType gridSize;
+  gridOrigin.Fill( -8.0 );
+  gridSpacing.Fill( 4.0 );
+  gridSize.Fill( 7 );
+  gridRegion.SetSize( gridSize );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+
+  const unsigned int numberOfParameters = transform->GetNumberOfParameters();
+  ParametersType     parameters( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    parameters[ i ] = RandomGeneratorType::GetInstance()->GetUniformVariate( -0.5, 0.5 );
+  }
+  transform->SetParameters( parameters );
+
+  /** The fixed image region keeps the mapped samples inside the moving image. */
+  ImageType::RegionType fixedImageRegion;
+  fixedImageRegion.SetIndex( 0, 2 ); fixedImageRegion.SetIndex( 1, 2 ); fixedImageRegion.SetIndex( 2, 2 );
+  fixedImageRegion.SetSize( 0, 8 ); fixedImageRegion.SetSize( 1, 8 ); fixedImageRegion.SetSize( 2, 8 );
+
+  /** The measure interpolates linearly between the moving descriptors, so it
+   * is only differentiable inside the voxels. The finite difference step is
+   * chosen such that no mapped sample crosses a voxel border; a B-spline
+   * transform moves a point by at most the parameter step.
+   */
+  double minimumDistanceToBorder = 1.0;
+  itk::ImageRegionConstIteratorWithIndex< ImageType > fit( fixedImage, fixedImageRegion );
+  for( ; !fit.IsAtEnd(); ++fit )
+  {
+    ImageType::PointType fixedPoint;
+    fixedImage->TransformIndexToPhysicalPoint( fit.GetIndex(), fixedPoint );
+    const TransformType::OutputPointType mappedPoint = transform->TransformPoint( fixedPoint );
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double fraction = mappedPoint[ d ] - std::floor( mappedPoint[ d ] );
+      minimumDistanceToBorder = std::min( minimumDistanceToBorder, std::min( fraction, 1.0 - fraction ) );
+    }
+  }
+  const double delta = std::min( 1e-7, 0.5 * minimumDistanceToBorder );
+  if( !( delta > 1e-10 ) )
+  {
+    std::cerr << "ERROR: a mapped sample lies on a voxel border, so the test is void." << std::endl;
+    return 1;
+  }
+
+  /** Setup the metric. */
+  metric = MetricType::New();
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( fixedImageRegion );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( itk::LinearInterpolateImageFunction< ImageType, double >::New() );
+  metric->SetImageSampler( itk::ImageFullSampler< ImageType >::New() );
+  metric->SetUseMultiThread( true );
+  try
+  {
+    metric->Initialize();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  /** The analytic value and derivative, single- and multi-threaded. */
+  MetricType::MeasureType    values[ 2 ];
+  MetricType::DerivativeType derivatives[ 2 ];
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    metric->SetUseMultiThread( t == 1 );
+    metric->GetValueAndDerivative( parameters, values[ t ], derivatives[ t ] );
+  }
+  const double value = metric->GetValue( parameters );
+
+  /** The derivative by central differences. */
+  double         maxDerivative       = 0.0;
+  double         maxError            = 0.0;
+  double         maxThreadDifference = 0.0;
+  ParametersType testPoint( parameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    testPoint[ i ] = parameters[ i ] + delta;
+    const double valuep1 = metric->GetValue( testPoint );
+    testPoint[ i ] = parameters[ i ] - delta;
+    const double valuep0 = metric->GetValue( testPoint );
+    testPoint[ i ] = parameters[ i ];
+
+    const double finiteDifference = ( valuep1 - valuep0 ) / ( 2.0 * delta );
+    maxDerivative       = std::max( maxDerivative, std::abs( finiteDifference ) );
+    maxError            = std::max( maxError, std::abs( derivatives[ 0 ][ i ] - finiteDifference ) );
+    maxThreadDifference = std::max( maxThreadDifference,
+      std::abs( derivatives[ 0 ][ i ] - derivatives[ 1 ][ i ] ) );
+  }
+
+  std::cerr << std::setprecision( 10 ) << "Value " << values[ 0 ] << " (single-threaded), "
+            << values[ 1 ] << " (multi-threaded), " << value << " (GetValue); derivative: "
+            << "max finite difference " << maxDerivative << " (step " << delta << "), max error "
+            << maxError << ", max difference between threads " << maxThreadDifference << std::endl;
+
+  if( !( std::abs( values[ 0 ] - value ) < 1e-12 ) || !( std::abs( values[ 1 ] - value ) < 1e-12 ) )
+  {
+    std::cerr << "ERROR: GetValueAndDerivative and GetValue give different values." << std::endl;
+    return 1;
+  }
+  if( !( maxDerivative > 0.0 ) || !( maxError < 1e-3 * maxDerivative ) )
+  {
+    std::cerr << "ERROR: the analytic derivative differs from the finite differences." << std::endl;
+    return 1;
+  }
+  if( !( maxThreadDifference < 1e-10 * maxDerivative ) )
+  {
+    std::cerr << "ERROR: the single- and multi-threaded derivatives differ." << std::endl;
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
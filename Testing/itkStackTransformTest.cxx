@@ -0,0 +1,175 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkStackTransform.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// Test that the sub transforms of a stack transform share the parameter
+// buffer of the stack, that GetParameters() returns the set parameters,
+// also when the sub transforms copy their parameters, and that
+// TransformPoint() and GetJacobian() use the right sub transform.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension = 3;
+  typedef double ScalarType;
+  const unsigned int numberOfSubTransforms = 5;
+
+  typedef itk::StackTransform< ScalarType, Dimension, Dimension > StackTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    ScalarType, Dimension - 1, 3 >                              BSplineTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase<
+    ScalarType, Dimension - 1, Dimension - 1 >                  AffineTransformType;
+  typedef StackTransformType::ParametersType ParametersType;
+
+  /** Setup a 2D B-spline transform on a grid with 8 mm spacing. */
+  BSplineTransformType::Pointer       bspline = BSplineTransformType::New();
+  BSplineTransformType::OriginType    gridOrigin;
+  BSplineTransformType::SpacingType   gridSpacing;
+  BSplineTransformType::RegionType    gridRegion;
+  BSplineTransformType::SizeType      gridSize;
+  BSplineTransformType::DirectionType gridDirection;
+  gridOrigin.Fill( -16.0 );
+  gridSpacing.Fill( 8.0 );
+  gridSize.Fill( 10 );
+  gridRegion.SetSize( gridSize );
+  gridDirection.SetIdentity();
+  bspline->SetGridOrigin( gridOrigin );
+  bspline->SetGridSpacing( gridSpacing );
+  bspline->SetGridRegion( gridRegion );
+  bspline->SetGridDirection( gridDirection );
+  bspline->SetIdentity();
+
+  AffineTransformType::Pointer affine = AffineTransformType::New();
+
+  for( unsigned int test = 0; test < 2; ++test )
+  {
+    StackTransformType::Pointer stack = StackTransformType::New();
+    stack->SetNumberOfSubTransforms( numberOfSubTransforms );
+    stack->SetStackOrigin( 0.0 );
+    stack->SetStackSpacing( 2.0 );
+    if( test == 0 )
+    {
+      stack->SetAllSubTransforms( bspline );
+    }
+    else
+    {
+      stack->SetAllSubTransforms( affine );
+    }
+
+    ParametersType parameters( stack->GetNumberOfParameters() );
+    for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+    {
+      parameters[ i ] = 1.0 + 0.1 * std::sin( 0.37 * i );
+    }
+    stack->SetParameters( parameters );
+
+    /** The B-spline sub transforms refer to the buffer of the stack. */
+    const ParametersType & stackParameters = stack->GetParameters();
+    const StackTransformType::NumberOfParametersType numSubTransformParameters
+      = parameters.GetSize() / numberOfSubTransforms;
+    if( test == 0 )
+    {
+      for( unsigned int t = 0; t < numberOfSubTransforms; ++t )
+      {
+        if( stack->GetSubTransform( t )->GetParameters().data_block()
+          != stackParameters.data_block() + t * numSubTransformParameters )
+        {
+          std::cerr << "ERROR: sub transform " << t
+                    << " does not share the parameter buffer." << std::endl;
+          return 1;
+        }
+      }
+    }
+
+    /** GetParameters() returns the parameters that were set. */
+    for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+    {
+      if( stackParameters[ i ] != parameters[ i ] )
+      {
+        std::cerr << "ERROR: GetParameters() differs from SetParameters()." << std::endl;
+        return 1;
+      }
+    }
+
+    /** Setting the parameters of a sub transform directly is reflected. */
+    ParametersType subParameters = stack->GetSubTransform( 2 )->GetParameters();
+    subParameters[ 0 ] += 0.5;
+    stack->GetSubTransform( 2 )->SetParametersByValue( subParameters );
+    if( stack->GetParameters()[ 2 * numSubTransformParameters ] != subParameters[ 0 ] )
+    {
+      std::cerr << "ERROR: GetParameters() does not reflect a changed sub transform." << std::endl;
+      return 1;
+    }
+    stack->SetParameters( parameters );
+
+    /** TransformPoint() and GetJacobian() use the sub transform of the time point. */
+    StackTransformType::InputPointType point;
+    point[ 0 ] = 3.3;
+    point[ 1 ] = -1.7;
+    point[ 2 ] = 6.2; // time point 3
+    const unsigned int subt = 3;
+
+    StackTransformType::SubTransformInputPointType reducedPoint;
+    reducedPoint[ 0 ] = point[ 0 ];
+    reducedPoint[ 1 ] = point[ 1 ];
+    const StackTransformType::SubTransformOutputPointType reducedTransformedPoint
+      = stack->GetSubTransform( subt )->TransformPoint( reducedPoint );
+    const StackTransformType::OutputPointType transformedPoint = stack->TransformPoint( point );
+    if( transformedPoint[ 0 ] != reducedTransformedPoint[ 0 ]
+      || transformedPoint[ 1 ] != reducedTransformedPoint[ 1 ]
+      || transformedPoint[ 2 ] != point[ 2 ] )
+    {
+      std::cerr << "ERROR: TransformPoint() does not use the right sub transform." << std::endl;
+      return 1;
+    }
+
+    StackTransformType::JacobianType               jac;
+    StackTransformType::NonZeroJacobianIndicesType nzji;
+    StackTransformType::SubTransformJacobianType   subjac;
+    StackTransformType::NonZeroJacobianIndicesType subnzji;
+    stack->GetJacobian( point, jac, nzji );
+    stack->GetSubTransform( subt )->GetJacobian( reducedPoint, subjac, subnzji );
+    if( jac.rows() != Dimension || jac.cols() != subjac.cols() || nzji.size() != subnzji.size() )
+    {
+      std::cerr << "ERROR: the Jacobian has the wrong size." << std::endl;
+      return 1;
+    }
+    for( unsigned int n = 0; n < nzji.size(); ++n )
+    {
+      if( nzji[ n ] != subnzji[ n ] + subt * numSubTransformParameters
+        || jac[ 0 ][ n ] != subjac[ 0 ][ n ] || jac[ 1 ][ n ] != subjac[ 1 ][ n ]
+        || jac[ 2 ][ n ] != 0.0 )
+      {
+        std::cerr << "ERROR: the Jacobian differs from the sub transform Jacobian." << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  std::cerr << "Test passed." << std::endl;
+
+  /** Return a value. */
+  return 0;
+
+} // end main
@@ -0,0 +1,283 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "StatisticalShapePenalty/itkStatisticalShapePointPenalty.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// Test the derivative of the StatisticalShapePointPenalty, which is computed in reverse
+// mode, against central differences of the value. All shape model calculations are
+// tested, with and without size normalization, regularization and cut-off. The threaded
+// evaluation should give the same value and derivative as the serial evaluation.
+
+const unsigned int Dimension = 3;
+typedef double CoordinateRepresentationType;
+typedef itk::PointSet<
+  CoordinateRepresentationType, Dimension,
+  itk::DefaultStaticMeshTraits<
+  CoordinateRepresentationType,
+  Dimension, Dimension,
+  CoordinateRepresentationType, CoordinateRepresentationType,
+  CoordinateRepresentationType > >                         PointSetType;
+typedef itk::StatisticalShapePointPenalty<
+  PointSetType, PointSetType >                             MetricType;
+typedef itk::AdvancedBSplineDeformableTransform<
+  CoordinateRepresentationType, Dimension, 3 >             TransformType;
+typedef TransformType::ParametersType                      ParametersType;
+typedef MetricType::MeasureType                            MeasureType;
+typedef MetricType::DerivativeType                         DerivativeType;
+typedef vnl_vector< double >                               VectorType;
+typedef vnl_matrix< double >                               MatrixType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+/** The settings of the shape model for one test case. */
+struct ShapeModelSettings
+{
+  const char * st_Name;
+  int          st_ShapeModelCalculation;
+  bool         st_NormalizedShapeModel;
+  double       st_ShrinkageIntensity;
+  double       st_CutOffValue;
+};
+
+/** The proposal vector of a shape: the coordinates, and for the normalized
+ * model the aligned and size normalized coordinates, the centroid and the size.
+ */
+VectorType
+ComputeProposalVector( const PointSetType * pointSet, const bool normalized )
+{
+  const unsigned int numberOfPoints = pointSet->GetNumberOfPoints();
+  const unsigned int shapeLength    = Dimension * numberOfPoints;
+  VectorType         proposal( normalized ? shapeLength + Dimension + 1 : shapeLength, 0.0 );
+  for( unsigned int i = 0; i < numberOfPoints; ++i )
+  {
+    const PointSetType::PointType point = pointSet->GetPoint( i );
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      proposal[ i * Dimension + d ] = point[ d ];
+    }
+  }
+  if( !normalized ) { return proposal; }
+
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    double centroid = 0.0;
+    for( unsigned int i = 0; i < numberOfPoints; ++i )
+    {
+      centroid += proposal[ i * Dimension + d ];
+    }
+    centroid /= numberOfPoints;
+    for( unsigned int i = 0; i < numberOfPoints; ++i )
+    {
+      proposal[ i * Dimension + d ] -= centroid;
+    }
+    proposal[ shapeLength + d ] = centroid;
+  }
+  double size = 0.0;
+  for( unsigned int i = 0; i < shapeLength; ++i )
+  {
+    size += proposal[ i ] * proposal[ i ];
+  }
+  size = std::sqrt( size / numberOfPoints );
+  for( unsigned int i = 0; i < shapeLength; ++i )
+  {
+    proposal[ i ] /= size;
+  }
+  proposal[ shapeLength + Dimension ] = size;
+
+  return proposal;
+
+} // end ComputeProposalVector()
+
+
+/** Compare the derivative with central differences, and the threaded with the
+ * serial evaluation, for one shape model.
+ */
+bool
+TestShapeModel( const ShapeModelSettings & settings, const PointSetType * pointSet,
+  TransformType * transform, const ParametersType & parameters )
+{
+  /** A mean shape near the fixed shape, and a rank deficient covariance. */
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  const VectorType   fixedProposal  = ComputeProposalVector( pointSet, settings.st_NormalizedShapeModel );
+  const unsigned int proposalLength = fixedProposal.size();
+  const unsigned int numberOfModes  = 6;
+
+  VectorType * meanVector = new VectorType( fixedProposal );
+  MatrixType   modes( proposalLength, numberOfModes );
+  for( unsigned int i = 0; i < proposalLength; ++i )
+  {
+    ( *meanVector )[ i ] += randomGenerator->GetUniformVariate( -0.05, 0.05 );
+    for( unsigned int j = 0; j < numberOfModes; ++j )
+    {
+      modes( i, j ) = randomGenerator->GetUniformVariate( -0.1, 0.1 );
+    }
+  }
+  MatrixType * covarianceMatrix = new MatrixType( modes * modes.transpose() );
+
+  /** The metric takes ownership of the mean vector and the covariance. */
+  MetricType::Pointer metric = MetricType::New();
+  metric->SetFixedPointSet( pointSet );
+  metric->SetMovingPointSet( pointSet );
+  metric->SetTransform( transform );
+  metric->SetMeanVector( meanVector );
+  metric->SetCovarianceMatrix( covarianceMatrix );
+  metric->SetShapeModelCalculation( settings.st_ShapeModelCalculation );
+  metric->SetNormalizedShapeModel( settings.st_NormalizedShapeModel );
+  metric->SetShrinkageIntensity( settings.st_ShrinkageIntensity );
+  metric->SetBaseVariance( -1.0 );
+  metric->SetCentroidXVariance( -1.0 );
+  metric->SetCentroidYVariance( -1.0 );
+  metric->SetCentroidZVariance( -1.0 );
+  metric->SetSizeVariance( -1.0 );
+  metric->SetCutOffValue( settings.st_CutOffValue );
+  metric->SetCutOffSharpness( 2.0 );
+  metric->Initialize();
+
+  /** The serial and the threaded evaluation. */
+  MeasureType    values[ 2 ];
+  DerivativeType derivatives[ 2 ];
+  metric->SetUseMultiThread( false );
+  metric->GetValueAndDerivative( parameters, values[ 0 ], derivatives[ 0 ] );
+  const MeasureType valueOnly = metric->GetValue( parameters );
+  metric->SetUseMultiThread( true );
+  metric->SetNumberOfThreads( 3 );
+  metric->GetValueAndDerivative( parameters, values[ 1 ], derivatives[ 1 ] );
+  metric->SetUseMultiThread( false );
+
+  /** Central differences. */
+  const double   delta               = 1e-6;
+  double         maxDerivative       = 0.0;
+  double         maxError            = 0.0;
+  double         maxThreadDifference = 0.0;
+  ParametersType testPoint( parameters );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    testPoint[ i ] = parameters[ i ] + delta;
+    const double valuep1 = metric->GetValue( testPoint );
+    testPoint[ i ] = parameters[ i ] - delta;
+    const double valuep0 = metric->GetValue( testPoint );
+    testPoint[ i ] = parameters[ i ];
+
+    const double finiteDifference = ( valuep1 - valuep0 ) / ( 2.0 * delta );
+    maxDerivative       = std::max( maxDerivative, std::abs( finiteDifference ) );
+    maxError            = std::max( maxError, std::abs( derivatives[ 0 ][ i ] - finiteDifference ) );
+    maxThreadDifference = std::max( maxThreadDifference,
+      std::abs( derivatives[ 0 ][ i ] - derivatives[ 1 ][ i ] ) );
+  }
+
+  std::cerr << std::setprecision( 12 ) << settings.st_Name << ": value " << values[ 0 ]
+            << " (serial), " << values[ 1 ] << " (threaded), " << valueOnly
+            << " (GetValue); derivative: max finite difference " << maxDerivative
+            << ", max error " << maxError << ", max difference between threads "
+            << maxThreadDifference << std::endl;
+
+  if( !( values[ 0 ] > 0.0 )
+    || !( std::abs( values[ 1 ] - values[ 0 ] ) <= 1e-12 * values[ 0 ] )
+    || !( std::abs( valueOnly - values[ 0 ] ) <= 1e-12 * values[ 0 ] ) )
+  {
+    std::cerr << "ERROR: the values of " << settings.st_Name << " differ." << std::endl;
+    return false;
+  }
+  if( !( maxDerivative > 0.0 ) || !( maxError <= 1e-6 * maxDerivative )
+    || !( maxThreadDifference <= 1e-12 * maxDerivative ) )
+  {
+    std::cerr << "ERROR: the derivative of " << settings.st_Name
+              << " differs from the finite differences." << std::endl;
+    return false;
+  }
+
+  return true;
+
+} // end TestShapeModel()
+
+
+int
+main( int argc, char * argv[] )
+{
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->SetSeed( 1234 );
+
+  /** A B-spline transform with a grid around [ -1.5, 1.5 ]^3 and random coefficients. */
+  TransformType::Pointer transform = TransformType::New();
+  TransformType::OriginType gridOrigin;
+  gridOrigin.Fill( -3.0 );
+  TransformType::SpacingType gridSpacing;
+  gridSpacing.Fill( 1.0 );
+  TransformType::RegionType::SizeType gridSize;
+  gridSize.Fill( 7 );
+  TransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = randomGenerator->GetUniformVariate( -0.1, 0.1 );
+  }
+  transform->SetParameters( parameters );
+
+  /** Random landmarks. */
+  PointSetType::Pointer pointSet       = PointSetType::New();
+  const unsigned int    numberOfPoints = 25;
+  for( unsigned int i = 0; i < numberOfPoints; ++i )
+  {
+    PointSetType::PointType point;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      point[ d ] = randomGenerator->GetUniformVariate( -1.4, 1.4 );
+    }
+    pointSet->SetPoint( i, point );
+  }
+
+  /** Name, ShapeModelCalculation, NormalizedShapeModel, ShrinkageIntensity, CutOffValue. */
+  const ShapeModelSettings settings[] = {
+    { "full covariance", 0, false, 0.2, 0.0 },
+    { "full covariance, normalized, cut-off", 0, true, 0.2, 0.5 },
+    { "decomposed covariance", 1, false, 0.2, 0.0 },
+    { "decomposed covariance, pseudo inverse", 1, false, 0.0, 0.0 },
+    { "decomposed scaled covariance, normalized", 2, true, 0.3, 0.0 },
+    { "decomposed scaled covariance, normalized, cut-off", 2, true, 0.1, 0.5 }
+  };
+
+  try
+  {
+    for( unsigned int s = 0; s < sizeof( settings ) / sizeof( settings[ 0 ] ); ++s )
+    {
+      if( !TestShapeModel( settings[ s ], pointSet, transform, parameters ) )
+      {
+        return 1;
+      }
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  return 0;
+
+} // end main
@@ -0,0 +1,213 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkStreamingImageStatisticsFilter.h"
+#include "itkTransformToDeterminantOfSpatialJacobianSource.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageMaskSpatialObject2.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Test that the statistics of the spatial Jacobian determinant, accumulated over
+// streamed slabs within a mask, equal those of the fully computed image, and that
+// the determinant image is never generated as a whole.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension = 3;
+  typedef double ScalarType;
+
+  typedef itk::AdvancedBSplineDeformableTransform<
+    ScalarType, Dimension, 3 >                        TransformType;
+  typedef itk::Image< float, Dimension >              JacobianImageType;
+  typedef itk::TransformToDeterminantOfSpatialJacobianSource<
+    JacobianImageType, ScalarType >                   JacobianSourceType;
+  typedef itk::StreamingImageStatisticsFilter<
+    JacobianImageType >                               StatisticsFilterType;
+  typedef itk::ImageMaskSpatialObject2< Dimension >   MaskSpatialObjectType;
+  typedef MaskSpatialObjectType::ImageType            MaskImageType;
+
+  /** Setup a B-spline transform with a deformation that folds in places,
+   * on a grid with 8 mm spacing, that covers [0, 40)^3.
+   */
+  TransformType::Pointer transform = TransformType::New();
+  TransformType::OriginType    gridOrigin;
+  TransformType::SpacingType   gridSpacing;
+  TransformType::RegionType    gridRegion;
+  TransformType::SizeType      gridSize;
+  TransformType::DirectionType gridDirection;
+  gridOrigin.Fill( -16.0 );
+  gridSpacing.Fill( 8.0 );
+  gridSize.Fill( 9 );
+  gridRegion.SetSize( gridSize );
+  gridDirection.SetIdentity();
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridDirection( gridDirection );
+
+  TransformType::ParametersType parameters( transform->GetNumberOfParameters() );
+  const unsigned int            numberOfNodes = parameters.GetSize() / Dimension;
+  for( unsigned int n = 0; n < numberOfNodes; ++n )
+  {
+    const double x = static_cast< double >( n % gridSize[ 0 ] );
+    const double y = static_cast< double >( ( n / gridSize[ 0 ] ) % gridSize[ 1 ] );
+    const double z = static_cast< double >( n / ( gridSize[ 0 ] * gridSize[ 1 ] ) );
+    parameters[ n ]                     = 9.0 * std::sin( 1.3 * x ) * std::cos( 0.4 * y );
+    parameters[ n + numberOfNodes ]     = 6.0 * std::cos( 0.5 * x + 0.9 * y );
+    parameters[ n + 2 * numberOfNodes ] = 4.0 * std::sin( 0.7 * z - 0.2 * x );
+  }
+  transform->SetParameters( parameters );
+
+  /** The output grid. */
+  JacobianSourceType::SizeType size;
+  size[ 0 ] = 40; size[ 1 ] = 36; size[ 2 ] = 30;
+  JacobianImageType::RegionType region;
+  region.SetSize( size );
+
+  /** A mask covering a ball in the middle of the grid. */
+  MaskImageType::Pointer maskImage = MaskImageType::New();
+  maskImage->SetRegions( region );
+  maskImage->Allocate();
+  itk::ImageRegionIteratorWithIndex< MaskImageType > mit( maskImage, region );
+  for( mit.GoToBegin(); !mit.IsAtEnd(); ++mit )
+  {
+    double r2 = 0.0;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      const double d = mit.GetIndex()[ i ] - 0.5 * size[ i ];
+      r2 += d * d;
+    }
+    mit.Set( r2 < 14.0 * 14.0 ? 1 : 0 );
+  }
+  MaskSpatialObjectType::Pointer mask = MaskSpatialObjectType::New();
+  mask->SetImage( maskImage );
+
+  /** Compute the reference statistics from the full determinant image. */
+  const double       histogramMinimum      = -0.5;
+  const double       histogramMaximum      = 2.5;
+  const unsigned int numberOfHistogramBins = 12;
+
+  JacobianSourceType::Pointer fullSource = JacobianSourceType::New();
+  fullSource->SetTransform( transform.GetPointer() );
+  fullSource->SetOutputSize( size );
+  try
+  {
+    fullSource->Update();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  itk::SizeValueType                count       = 0;
+  itk::SizeValueType                nonPositive = 0;
+  double                            sum         = 0.0;
+  double                            minimum     = itk::NumericTraits< double >::max();
+  double                            maximum     = itk::NumericTraits< double >::NonpositiveMin();
+  std::vector< itk::SizeValueType > histogram( numberOfHistogramBins, 0 );
+  itk::ImageRegionConstIteratorWithIndex< JacobianImageType > it(
+    fullSource->GetOutput(), region );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    if( maskImage->GetPixel( it.GetIndex() ) == 0 )
+    {
+      continue;
+    }
+    const double value = it.Get();
+    ++count;
+    sum    += value;
+    minimum = std::min( minimum, value );
+    maximum = std::max( maximum, value );
+    if( value <= 0.0 ) { ++nonPositive; }
+    const double bin = std::floor( ( value - histogramMinimum )
+      * numberOfHistogramBins / ( histogramMaximum - histogramMinimum ) );
+    const int b = static_cast< int >( std::max( 0.0,
+      std::min( bin, static_cast< double >( numberOfHistogramBins - 1 ) ) ) );
+    ++histogram[ b ];
+  }
+
+  if( nonPositive == 0 )
+  {
+    std::cerr << "ERROR: the test transform should fold." << std::endl;
+    return 1;
+  }
+
+  /** Compute the statistics in streamed slabs. */
+  JacobianSourceType::Pointer streamedSource = JacobianSourceType::New();
+  streamedSource->SetTransform( transform.GetPointer() );
+  streamedSource->SetOutputSize( size );
+
+  StatisticsFilterType::Pointer statistics = StatisticsFilterType::New();
+  statistics->SetInput( streamedSource->GetOutput() );
+  statistics->SetMask( mask );
+  statistics->SetHistogramMinimum( histogramMinimum );
+  statistics->SetHistogramMaximum( histogramMaximum );
+  statistics->SetNumberOfHistogramBins( numberOfHistogramBins );
+  statistics->SetNumberOfStreamDivisions( 7 );
+  try
+  {
+    statistics->StreamStatistics();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  std::cerr << "Number of voxels: " << statistics->GetCount() << std::endl;
+  std::cerr << "Minimum: " << statistics->GetMinimum() << std::endl;
+  std::cerr << "Maximum: " << statistics->GetMaximum() << std::endl;
+  std::cerr << "Mean: " << statistics->GetMean() << std::endl;
+  std::cerr << "Fraction <= 0: " << statistics->GetFractionOfNonPositiveValues() << std::endl;
+
+  /** The streamed source should only have buffered the last slab. */
+  if( streamedSource->GetOutput()->GetBufferedRegion().GetNumberOfPixels()
+    >= region.GetNumberOfPixels() )
+  {
+    std::cerr << "ERROR: the determinant image was generated as a whole." << std::endl;
+    return 1;
+  }
+
+  /** Compare. */
+  bool success = statistics->GetCount() == count
+    && statistics->GetNumberOfNonPositiveValues() == nonPositive
+    && statistics->GetMinimum() == minimum
+    && statistics->GetMaximum() == maximum
+    && std::abs( statistics->GetMean() - sum / count ) < 1e-6
+    && statistics->GetHistogram() == histogram;
+  if( !success )
+  {
+    std::cerr << "ERROR: the streamed statistics differ from the reference:\n"
+              << "  count " << count << ", minimum " << minimum
+              << ", maximum " << maximum << ", mean " << sum / count
+              << ", number <= 0 " << nonPositive << std::endl;
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
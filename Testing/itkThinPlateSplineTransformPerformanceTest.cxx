@@ -22,6 +22,8 @@
 #include "itkTimeProbe.h"
 #include "itkTimeProbesCollectorBase.h"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iomanip>
 
@@ -363,12 +365,165 @@ main( int argc, char * argv[] )
       return 1;
     }
 
+    //
+    // Test the iterative solver against the direct (QR) solution
+
+    /** Displace the landmarks with a smooth deformation. */
+    PointsContainerPointer targetLandmarkPoints = PointsContainerType::New();
+    PointSetType::Pointer  targetLandmarks      = PointSetType::New();
+    for( unsigned long j = 0; j < numberOfLandmarks; j++ )
+    {
+      PointType tmp = ( *usedLandmarkPoints )[ j ];
+      tmp[ 0 ] += 2.0 * std::sin( 0.05 * tmp[ 1 ] );
+      tmp[ 1 ] += 1.5 * std::cos( 0.04 * tmp[ 2 ] );
+      tmp[ 2 ] += 0.01 * tmp[ 0 ];
+      targetLandmarkPoints->push_back( tmp );
+    }
+    targetLandmarks->SetPoints( targetLandmarkPoints );
+
+    typedef itk::ThinPlateSplineKernelTransform2< ScalarType, Dimension > TPSTransformType;
+    TPSTransformType::Pointer directTransform = TPSTransformType::New();
+    directTransform->SetStiffness( 0.0 );
+    directTransform->SetMatrixInversionMethod( "QR" );
+    timeCollector.Start( "SolveDirect" );
+    directTransform->SetSourceLandmarks( usedLandmarks );
+    directTransform->SetTargetLandmarks( targetLandmarks );
+    timeCollector.Stop( "SolveDirect" );
+
+    TPSTransformType::Pointer iterativeTransform = TPSTransformType::New();
+    iterativeTransform->SetStiffness( 0.0 );
+    iterativeTransform->SetMatrixInversionMethod( "Iterative" );
+    iterativeTransform->SetIterativeSolverTolerance( 1e-12 );
+    timeCollector.Start( "SolveIterative" );
+    iterativeTransform->SetSourceLandmarks( usedLandmarks );
+    iterativeTransform->SetTargetLandmarks( targetLandmarks );
+    timeCollector.Stop( "SolveIterative" );
+    std::cerr << "Iterative solver: "
+              << iterativeTransform->GetIterativeSolverNumberOfIterations()
+              << " iterations, relative residual "
+              << iterativeTransform->GetIterativeSolverRelativeResidual() << std::endl;
+
+    TPSTransformType::Pointer unpreconditionedTransform = TPSTransformType::New();
+    unpreconditionedTransform->SetStiffness( 0.0 );
+    unpreconditionedTransform->SetMatrixInversionMethod( "Iterative" );
+    unpreconditionedTransform->SetIterativeSolverTolerance( 1e-12 );
+    unpreconditionedTransform->SetIterativeSolverPreconditionerBlockSize( 0 );
+    timeCollector.Start( "SolveIterativeUnpreconditioned" );
+    unpreconditionedTransform->SetSourceLandmarks( usedLandmarks );
+    unpreconditionedTransform->SetTargetLandmarks( targetLandmarks );
+    timeCollector.Stop( "SolveIterativeUnpreconditioned" );
+    std::cerr << "Iterative solver without preconditioner: "
+              << unpreconditionedTransform->GetIterativeSolverNumberOfIterations()
+              << " iterations, relative residual "
+              << unpreconditionedTransform->GetIterativeSolverRelativeResidual() << std::endl;
+
+    /** Compare the transformed landmarks and points in between. */
+    double maxPointDifference = 0.0;
+    for( unsigned long j = 0; j + 1 < numberOfLandmarks; j++ )
+    {
+      PointType q = ( *usedLandmarkPoints )[ j ];
+      q += ( ( *usedLandmarkPoints )[ j + 1 ] - q ) * 0.5;
+      const double diff = directTransform->TransformPoint( q ).EuclideanDistanceTo(
+        iterativeTransform->TransformPoint( q ) );
+      maxPointDifference = std::max( maxPointDifference, diff );
+    }
+    std::cerr << "Maximum difference of iterative and direct solution: "
+              << maxPointDifference << std::endl;
+    if( maxPointDifference > 1e-4 )
+    {
+      std::cerr << "ERROR: iterative solution differs too much from the direct solution: "
+                << maxPointDifference << std::endl;
+      return 1;
+    }
+    if( iterativeTransform->GetIterativeSolverNumberOfIterations()
+      >= unpreconditionedTransform->GetIterativeSolverNumberOfIterations() )
+    {
+      std::cerr << "ERROR: the preconditioner does not reduce the number of iterations." << std::endl;
+      return 1;
+    }
+
     // Report timings
     timeCollector.Report();
     std::cout << std::endl;
 
   } // end loop
 
+  //
+  // Compare the iterative solver with and without preconditioner on a
+  // landmark set for which the direct solution takes too long
+
+  const unsigned long numberOfLandmarks = std::min( 1000ul,
+    static_cast< unsigned long >( sourceLandmarks->GetNumberOfPoints() ) );
+  std::cerr << "----------------------------------------\n";
+  std::cerr << "Iterative solvers, number of landmarks: " << numberOfLandmarks << std::endl;
+
+  PointsContainerPointer largeSourcePoints = PointsContainerType::New();
+  PointsContainerPointer largeTargetPoints = PointsContainerType::New();
+  for( unsigned long j = 0; j < numberOfLandmarks; j++ )
+  {
+    PointType tmp = ( *sourceLandmarks->GetPoints() )[ j ];
+    largeSourcePoints->push_back( tmp );
+    tmp[ 0 ] += 2.0 * std::sin( 0.05 * tmp[ 1 ] );
+    tmp[ 1 ] += 1.5 * std::cos( 0.04 * tmp[ 2 ] );
+    tmp[ 2 ] += 0.01 * tmp[ 0 ];
+    largeTargetPoints->push_back( tmp );
+  }
+  PointSetType::Pointer largeSourceLandmarks = PointSetType::New();
+  PointSetType::Pointer largeTargetLandmarks = PointSetType::New();
+  largeSourceLandmarks->SetPoints( largeSourcePoints );
+  largeTargetLandmarks->SetPoints( largeTargetPoints );
+
+  typedef itk::ThinPlateSplineKernelTransform2< ScalarType, Dimension > TPSTransformType;
+  const unsigned int        blockSizes[ 3 ] = { 0, 64, 128 };
+  TPSTransformType::Pointer largeTransforms[ 3 ];
+  itk::TimeProbesCollectorBase timeCollector;
+  for( unsigned int k = 0; k < 3; ++k )
+  {
+    std::ostringstream probeName( "" );
+    probeName << "SolveIterativeBlockSize" << blockSizes[ k ];
+
+    largeTransforms[ k ] = TPSTransformType::New();
+    largeTransforms[ k ]->SetStiffness( 0.0 );
+    largeTransforms[ k ]->SetMatrixInversionMethod( "Iterative" );
+    largeTransforms[ k ]->SetIterativeSolverMaximumNumberOfIterations( 20000 );
+    largeTransforms[ k ]->SetIterativeSolverPreconditionerBlockSize( blockSizes[ k ] );
+    timeCollector.Start( probeName.str().c_str() );
+    largeTransforms[ k ]->SetSourceLandmarks( largeSourceLandmarks );
+    largeTransforms[ k ]->SetTargetLandmarks( largeTargetLandmarks );
+    timeCollector.Stop( probeName.str().c_str() );
+    std::cerr << "Preconditioner block size " << blockSizes[ k ] << ": "
+              << largeTransforms[ k ]->GetIterativeSolverNumberOfIterations()
+              << " iterations, relative residual "
+              << largeTransforms[ k ]->GetIterativeSolverRelativeResidual() << std::endl;
+  }
+
+  /** The solutions must agree in the landmarks, which they interpolate. */
+  double maxLandmarkError = 0.0;
+  for( unsigned long j = 0; j < numberOfLandmarks; j++ )
+  {
+    for( unsigned int k = 0; k < 3; ++k )
+    {
+      maxLandmarkError = std::max( maxLandmarkError,
+        largeTransforms[ k ]->TransformPoint( ( *largeSourcePoints )[ j ] ).EuclideanDistanceTo(
+        ( *largeTargetPoints )[ j ] ) );
+    }
+  }
+  std::cerr << "Maximum landmark error of the iterative solutions: " << maxLandmarkError << std::endl;
+  if( maxLandmarkError > 1e-4 )
+  {
+    std::cerr << "ERROR: the iterative solutions do not interpolate the landmarks." << std::endl;
+    return 1;
+  }
+  if( largeTransforms[ 1 ]->GetIterativeSolverNumberOfIterations()
+    >= largeTransforms[ 0 ]->GetIterativeSolverNumberOfIterations()
+    || largeTransforms[ 2 ]->GetIterativeSolverNumberOfIterations()
+    > largeTransforms[ 1 ]->GetIterativeSolverNumberOfIterations() )
+  {
+    std::cerr << "ERROR: the preconditioner does not reduce the number of iterations." << std::endl;
+    return 1;
+  }
+  timeCollector.Report();
+
   /** Return a value. */
   return 0;
 
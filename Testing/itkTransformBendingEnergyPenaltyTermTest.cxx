@@ -0,0 +1,233 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "BendingEnergyPenalty/itkTransformBendingEnergyPenaltyTerm.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageFullSampler.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// Test the exact bending energy of the TransformBendingEnergyPenaltyTerm. The value is
+// compared with Gauss-Legendre quadrature of the spatial Hessians of the transform over
+// the valid grid cells, which is exact for the piecewise polynomial B-spline, and with
+// the sampled estimate at the cell centres of a fine image. The energy is quadratic in
+// the parameters, so central differences give the exact derivative. The results should
+// not depend on multi-threading.
+
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+template< unsigned int Dimension >
+int
+TestExactBendingEnergy( void )
+{
+  typedef itk::Image< short, Dimension >                                  ImageType;
+  typedef itk::TransformBendingEnergyPenaltyTerm< ImageType, double >     MetricType;
+  typedef typename MetricType::MeasureType                                MeasureType;
+  typedef typename MetricType::DerivativeType                             DerivativeType;
+  typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 > TransformType;
+  typedef typename TransformType::ParametersType                          ParametersType;
+
+  /** A B-spline grid with 7 control points, so 4 valid cells, per dimension.
+   * The valid region is [ 0, 16 [ x [ 0, 20 [ ( x [ 0, 16 [ ).
+   */
+  typename TransformType::Pointer              transform = TransformType::New();
+  typename TransformType::OriginType           gridOrigin;
+  typename TransformType::SpacingType          gridSpacing;
+  typename TransformType::RegionType           gridRegion;
+  typename TransformType::RegionType::SizeType gridSize;
+  gridOrigin.Fill( -4.0 );
+  gridSpacing.Fill( 4.0 );
+  gridOrigin[ 1 ]  = -5.0;
+  gridSpacing[ 1 ] = 5.0;
+  gridSize.Fill( 7 );
+  gridRegion.SetSize( gridSize );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+
+  const unsigned int numberOfParameters = transform->GetNumberOfParameters();
+  ParametersType     parameters( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    parameters[ i ] = RandomGeneratorType::GetInstance()->GetUniformVariate( -1.0, 1.0 );
+  }
+  transform->SetParameters( parameters );
+
+  /** An image whose voxel centres are the centres of a fine partition of the valid region. */
+  typename ImageType::Pointer   image = ImageType::New();
+  typename ImageType::SizeType  imageSize;
+  typename ImageType::PointType imageOrigin;
+  typename ImageType::SpacingType imageSpacing;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    imageSize[ d ]    = 32;
+    imageSpacing[ d ] = 4.0 * gridSpacing[ d ] / 32.0;
+    imageOrigin[ d ]  = 0.5 * imageSpacing[ d ];
+  }
+  image->SetRegions( imageSize );
+  image->SetOrigin( imageOrigin );
+  image->SetSpacing( imageSpacing );
+  image->Allocate();
+  image->FillBuffer( 0 );
+
+  /** The reference: four point Gauss-Legendre quadrature in every valid cell. */
+  const double nodes[ 4 ] = {
+    0.5 - 0.5 * 0.8611363115940526, 0.5 - 0.5 * 0.3399810435848563,
+    0.5 + 0.5 * 0.3399810435848563, 0.5 + 0.5 * 0.8611363115940526
+  };
+  const double weights[ 4 ] = {
+    0.5 * 0.3478548451374538, 0.5 * 0.6521451548625461,
+    0.5 * 0.6521451548625461, 0.5 * 0.3478548451374538
+  };
+  unsigned int numberOfCells = 1;
+  unsigned int numberOfNodes = 1;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    numberOfCells *= gridSize[ d ] - 3;
+    numberOfNodes *= 4 * ( gridSize[ d ] - 3 );
+  }
+  double reference = 0.0;
+  for( unsigned int n = 0; n < numberOfNodes; ++n )
+  {
+    typename TransformType::InputPointType point;
+    double                                 weight = 1.0;
+    unsigned int                           rest   = n;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const unsigned int numberOfNodesAlongAxis = 4 * ( gridSize[ d ] - 3 );
+      const unsigned int cell = ( rest % numberOfNodesAlongAxis ) / 4;
+      const unsigned int node = ( rest % numberOfNodesAlongAxis ) % 4;
+      rest /= numberOfNodesAlongAxis;
+      point[ d ] = gridOrigin[ d ] + ( 1.0 + cell + nodes[ node ] ) * gridSpacing[ d ];
+      weight    *= weights[ node ];
+    }
+    typename TransformType::SpatialHessianType spatialHessian;
+    transform->GetSpatialHessian( point, spatialHessian );
+    for( unsigned int k = 0; k < Dimension; ++k )
+    {
+      reference += weight * spatialHessian[ k ].GetVnlMatrix().frobenius_norm()
+        * spatialHessian[ k ].GetVnlMatrix().frobenius_norm();
+    }
+  }
+  reference /= static_cast< double >( numberOfCells );
+
+  /** Setup the metric. */
+  typename MetricType::Pointer metric = MetricType::New();
+  metric->SetFixedImage( image );
+  metric->SetMovingImage( image );
+  metric->SetFixedImageRegion( image->GetBufferedRegion() );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( itk::LinearInterpolateImageFunction< ImageType, double >::New() );
+  metric->SetImageSampler( itk::ImageFullSampler< ImageType >::New() );
+  metric->SetComputeGradient( false );
+  metric->SetUseMultiThread( true );
+  metric->SetNumberOfThreads( 3 );
+  metric->Initialize();
+
+  /** The sampled estimate is the midpoint rule. */
+  metric->SetUseExactBendingEnergy( false );
+  const MeasureType sampledValue = metric->GetValue( parameters );
+
+  /** The exact value and derivative, single- and multi-threaded. */
+  metric->SetUseExactBendingEnergy( true );
+  MeasureType    values[ 2 ];
+  DerivativeType derivatives[ 2 ];
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    metric->SetUseMultiThread( t == 1 );
+    metric->GetValueAndDerivative( parameters, values[ t ], derivatives[ t ] );
+  }
+  const MeasureType value = metric->GetValue( parameters );
+
+  /** Central differences; the bending energy is quadratic in the parameters. */
+  const double   delta               = 1e-2;
+  double         maxDerivative       = 0.0;
+  double         maxError            = 0.0;
+  double         maxThreadDifference = 0.0;
+  ParametersType testPoint( parameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    testPoint[ i ] = parameters[ i ] + delta;
+    const double valuep1 = metric->GetValue( testPoint );
+    testPoint[ i ] = parameters[ i ] - delta;
+    const double valuep0 = metric->GetValue( testPoint );
+    testPoint[ i ] = parameters[ i ];
+
+    const double finiteDifference = ( valuep1 - valuep0 ) / ( 2.0 * delta );
+    maxDerivative       = std::max( maxDerivative, std::abs( finiteDifference ) );
+    maxError            = std::max( maxError, std::abs( derivatives[ 0 ][ i ] - finiteDifference ) );
+    maxThreadDifference = std::max( maxThreadDifference,
+      std::abs( derivatives[ 0 ][ i ] - derivatives[ 1 ][ i ] ) );
+  }
+
+  std::cerr << std::setprecision( 12 ) << Dimension << "D: exact value " << values[ 0 ]
+            << " (single-threaded), " << values[ 1 ] << " (multi-threaded), " << value
+            << " (GetValue), reference " << reference << ", sampled estimate " << sampledValue
+            << "; derivative: max finite difference " << maxDerivative << ", max error "
+            << maxError << ", max difference between threads " << maxThreadDifference << std::endl;
+
+  if( !( std::abs( values[ 0 ] - reference ) <= 1e-10 * reference )
+    || !( std::abs( values[ 1 ] - reference ) <= 1e-10 * reference )
+    || !( std::abs( value - reference ) <= 1e-10 * reference ) )
+  {
+    std::cerr << "ERROR: the exact bending energy differs from the quadrature." << std::endl;
+    return 1;
+  }
+  if( !( std::abs( sampledValue - reference ) <= 1e-2 * reference ) )
+  {
+    std::cerr << "ERROR: the exact bending energy differs from the sampled estimate." << std::endl;
+    return 1;
+  }
+  if( !( maxDerivative > 0.0 ) || !( maxError <= 1e-7 * maxDerivative )
+    || !( maxThreadDifference <= 1e-12 * maxDerivative ) )
+  {
+    std::cerr << "ERROR: the exact derivative differs from the finite differences." << std::endl;
+    return 1;
+  }
+
+  return 0;
+
+} // end TestExactBendingEnergy()
+
+
+int
+main( int argc, char * argv[] )
+{
+  RandomGeneratorType::GetInstance()->Initialize( 1234 );
+
+  try
+  {
+    if( TestExactBendingEnergy< 2 >() != 0 || TestExactBendingEnergy< 3 >() != 0 )
+    {
+      return 1;
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  return 0;
+
+} // end main
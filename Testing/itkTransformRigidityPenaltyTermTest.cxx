@@ -0,0 +1,348 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "RigidityPenalty/itkTransformRigidityPenaltyTerm.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// Test the TransformRigidityPenaltyTerm. The penalty term is only evaluated in the
+// bounding box of the rigid region, with the separable filters fused and all passes
+// multi-threaded. The numerator of the penalty term and of its derivative, i.e. the
+// value times the sum of the rigidity coefficients, is linear in the rigidity
+// coefficients c. So the restricted evaluation for a small rigid region c is
+// compared with two evaluations on the full B-spline grid: U( c ) = U( c + 1 ) - U( 1 ).
+// The results should not depend on the number of threads, and for an affine
+// deformation the conditions are known analytically.
+
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+template< unsigned int Dimension >
+class RigidityPenaltyTermTester
+{
+public:
+
+  typedef itk::Image< short, Dimension >                          ImageType;
+  typedef itk::TransformRigidityPenaltyTerm< ImageType, double >  MetricType;
+  typedef typename MetricType::RigidityImageType                  RigidityImageType;
+  typedef typename MetricType::MeasureType                        MeasureType;
+  typedef typename MetricType::DerivativeType                     DerivativeType;
+  typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 > TransformType;
+  typedef typename TransformType::ParametersType                  ParametersType;
+  typedef itk::ImageRegionIteratorWithIndex< RigidityImageType >  RigidityIteratorType;
+
+  RigidityPenaltyTermTester()
+  {
+    /** A small image, and a B-spline grid with exactly representable geometry. */
+    typename ImageType::SizeType imageSize;
+    imageSize.Fill( 8 );
+    this->m_Image = ImageType::New();
+    this->m_Image->SetRegions( imageSize );
+    this->m_Image->Allocate();
+    this->m_Image->FillBuffer( 0 );
+
+    typename TransformType::OriginType          gridOrigin;
+    typename TransformType::SpacingType         gridSpacing;
+    typename TransformType::RegionType::SizeType gridSize;
+    gridOrigin.Fill( -4.0 );
+    gridSpacing.Fill( 2.0 );
+    gridSize.Fill( 9 );
+    this->m_GridRegion.SetSize( gridSize );
+    this->m_Transform = TransformType::New();
+    this->m_Transform->SetGridOrigin( gridOrigin );
+    this->m_Transform->SetGridSpacing( gridSpacing );
+    this->m_Transform->SetGridRegion( this->m_GridRegion );
+
+    /** The rigidity images have the geometry of the grid, so that the rigidity
+     * coefficients are copied exactly.
+     */
+    this->m_RigidityImage = RigidityImageType::New();
+    this->m_RigidityImage->SetRegions( this->m_GridRegion );
+    this->m_RigidityImage->SetOrigin( gridOrigin );
+    this->m_RigidityImage->SetSpacing( gridSpacing );
+    this->m_RigidityImage->Allocate();
+  }
+
+
+  /** Fill the rigidity image with a constant, plus random coefficients in the
+   * box [ begin, end ] along all axes, except along the first axis, where it
+   * starts at the border of the grid.
+   */
+  void FillRigidityImage( const double constant, const bool random,
+    const itk::IndexValueType begin, const itk::IndexValueType end )
+  {
+    RigidityIteratorType it( this->m_RigidityImage, this->m_GridRegion );
+    for( ; !it.IsAtEnd(); ++it )
+    {
+      bool inside = random;
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        const itk::IndexValueType first = d == 0 ? 0 : begin;
+        inside &= it.GetIndex()[ d ] >= first && it.GetIndex()[ d ] <= end;
+      }
+      double coefficient = constant;
+      if( inside )
+      {
+        coefficient += RandomGeneratorType::GetInstance()->GetUniformVariate( 0.5, 1.0 );
+      }
+      it.Set( coefficient );
+    }
+  }
+
+
+  /** Compute the value and derivative, multiplied by the sum of the rigidity
+   * coefficients. Returns false if GetValue() disagrees with GetValueAndDerivative().
+   */
+  bool Evaluate( const ParametersType & parameters, const unsigned int numberOfThreads,
+    MeasureType & value, DerivativeType & derivative, MeasureType & conditions ) const
+  {
+    typename MetricType::Pointer metric = MetricType::New();
+    metric->SetFixedImage( this->m_Image );
+    metric->SetMovingImage( this->m_Image );
+    metric->SetFixedImageRegion( this->m_Image->GetBufferedRegion() );
+    metric->SetTransform( this->m_Transform );
+    metric->SetInterpolator( itk::LinearInterpolateImageFunction< ImageType, double >::New() );
+    metric->SetComputeGradient( false );
+    metric->SetFixedRigidityImage( this->m_RigidityImage );
+    metric->SetUseFixedRigidityImage( true );
+    metric->SetUseMovingRigidityImage( false );
+    metric->SetDilateRigidityImages( false );
+    metric->SetLinearityConditionWeight( 0.5 );
+    metric->SetOrthonormalityConditionWeight( 2.0 );
+    metric->SetPropernessConditionWeight( 3.0 );
+    metric->SetUseMultiThread( numberOfThreads > 1 );
+    metric->SetNumberOfThreads( numberOfThreads );
+    metric->Initialize();
+
+    metric->GetValueAndDerivative( parameters, value, derivative );
+    conditions = metric->GetLinearityConditionValue()
+      + 10.0 * metric->GetOrthonormalityConditionValue()
+      + 100.0 * metric->GetPropernessConditionValue();
+    const MeasureType valueOnly = metric->GetValue( parameters );
+
+    double sum = 0.0;
+    RigidityIteratorType it( this->m_RigidityImage, this->m_GridRegion );
+    for( ; !it.IsAtEnd(); ++it )
+    {
+      sum += it.Get();
+    }
+    value      *= sum;
+    derivative *= sum;
+    conditions *= sum;
+
+    if( !( std::abs( valueOnly * sum - value ) <= 1e-12 * std::abs( value ) ) )
+    {
+      std::cerr << "ERROR: GetValue() gives " << valueOnly << ", while GetValueAndDerivative() gives "
+                << value / sum << "." << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+
+  /** Maximum absolute difference between two derivatives, and maximum magnitude. */
+  static void CompareDerivatives( const DerivativeType & a, const DerivativeType & b,
+    double & maxDifference, double & maxMagnitude )
+  {
+    maxDifference = 0.0;
+    maxMagnitude  = 0.0;
+    for( unsigned int i = 0; i < a.GetSize(); ++i )
+    {
+      maxDifference = std::max( maxDifference, std::abs( a[ i ] - b[ i ] ) );
+      maxMagnitude  = std::max( maxMagnitude, std::abs( b[ i ] ) );
+    }
+  }
+
+
+  int Run( void )
+  {
+    const unsigned int numberOfParameters = this->m_Transform->GetNumberOfParameters();
+    const unsigned int numberOfParametersPerDimension = numberOfParameters / Dimension;
+
+    /** A random deformation. */
+    ParametersType parameters( numberOfParameters );
+    for( unsigned int i = 0; i < numberOfParameters; ++i )
+    {
+      parameters[ i ] = RandomGeneratorType::GetInstance()->GetUniformVariate( -0.4, 0.4 );
+    }
+    this->m_Transform->SetParameters( parameters );
+
+    /** The full evaluations: the rigid region plus one, and one everywhere. */
+    MeasureType    value1, valueC, valueCPlus1, conditions1, conditionsC, conditionsCPlus1;
+    DerivativeType derivative1, derivativeC, derivativeCPlus1;
+    RandomGeneratorType::GetInstance()->Initialize( 1234 );
+    this->FillRigidityImage( 1.0, true, 3, 6 );
+    if( !this->Evaluate( parameters, 1, valueCPlus1, derivativeCPlus1, conditionsCPlus1 ) ) { return 1; }
+    this->FillRigidityImage( 1.0, false, 3, 6 );
+    if( !this->Evaluate( parameters, 1, value1, derivative1, conditions1 ) ) { return 1; }
+
+    /** The restricted evaluation, for several numbers of threads. The number
+     * of slices of the evaluation region is not a multiple of all of them.
+     */
+    RandomGeneratorType::GetInstance()->Initialize( 1234 );
+    this->FillRigidityImage( 0.0, true, 3, 6 );
+    const unsigned int numbersOfThreads[ 4 ] = { 1, 2, 3, 5 };
+    DerivativeType     derivativeSerial;
+    MeasureType        valueSerial = 0.0;
+    for( unsigned int t = 0; t < 4; ++t )
+    {
+      if( !this->Evaluate( parameters, numbersOfThreads[ t ], valueC, derivativeC, conditionsC ) )
+      {
+        return 1;
+      }
+
+      if( t == 0 )
+      {
+        /** Compare with the full evaluations. */
+        const MeasureType fullValue      = valueCPlus1 - value1;
+        const MeasureType fullConditions = conditionsCPlus1 - conditions1;
+        DerivativeType    fullDerivative( numberOfParameters );
+        for( unsigned int i = 0; i < numberOfParameters; ++i )
+        {
+          fullDerivative[ i ] = derivativeCPlus1[ i ] - derivative1[ i ];
+        }
+        double            maxDifference, maxMagnitude;
+        CompareDerivatives( derivativeC, fullDerivative, maxDifference, maxMagnitude );
+
+        std::cerr << std::setprecision( 10 ) << Dimension << "D: restricted value " << valueC
+                  << ", full value " << fullValue << "; derivative: max " << maxMagnitude
+                  << ", max difference " << maxDifference << std::endl;
+
+        const double tolerance = 1e-10 * std::max( std::abs( valueCPlus1 ), std::abs( value1 ) );
+        const double conditionsTolerance
+          = 1e-10 * std::max( std::abs( conditionsCPlus1 ), std::abs( conditions1 ) );
+        if( !( std::abs( valueC - fullValue ) <= tolerance )
+          || !( std::abs( conditionsC - fullConditions ) <= conditionsTolerance ) )
+        {
+          std::cerr << "ERROR: the restricted value differs from the full evaluation." << std::endl;
+          return 1;
+        }
+        if( !( maxMagnitude > 0.0 ) || !( maxDifference <= 1e-10 * maxMagnitude ) )
+        {
+          std::cerr << "ERROR: the restricted derivative differs from the full evaluation." << std::endl;
+          return 1;
+        }
+
+        valueSerial      = valueC;
+        derivativeSerial = derivativeC;
+        continue;
+      }
+
+      /** Compare with the single-threaded evaluation. */
+      double maxDifference, maxMagnitude;
+      CompareDerivatives( derivativeC, derivativeSerial, maxDifference, maxMagnitude );
+      if( !( std::abs( valueC - valueSerial ) <= 1e-12 * std::abs( valueSerial ) )
+        || !( maxDifference <= 1e-12 * maxMagnitude ) )
+      {
+        std::cerr << "ERROR: the evaluation with " << numbersOfThreads[ t ]
+                  << " threads differs from the single-threaded one." << std::endl;
+        return 1;
+      }
+    }
+
+    /** A scaling by s: the B-spline derivative operators are exact for the
+     * affine coefficients, so in the interior the orthonormality condition is
+     * Dimension * ( s^2 - 1 )^2 per voxel, the properness condition is
+     * ( s^Dimension - 1 )^2 and the linearity condition vanishes.
+     */
+    const double scale = 1.1;
+    ParametersType affineParameters( numberOfParameters );
+    itk::ImageRegionConstIteratorWithIndex< RigidityImageType > git( this->m_RigidityImage, this->m_GridRegion );
+    for( unsigned int k = 0; !git.IsAtEnd(); ++git, ++k )
+    {
+      typename RigidityImageType::PointType point;
+      this->m_RigidityImage->TransformIndexToPhysicalPoint( git.GetIndex(), point );
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        affineParameters[ d * numberOfParametersPerDimension + k ] = ( scale - 1.0 ) * point[ d ];
+      }
+    }
+    this->m_Transform->SetParameters( affineParameters );
+    RigidityIteratorType it( this->m_RigidityImage, this->m_GridRegion );
+    for( ; !it.IsAtEnd(); ++it )
+    {
+      bool inside = true;
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        inside &= it.GetIndex()[ d ] >= 2 && it.GetIndex()[ d ] <= 6;
+      }
+      it.Set( inside ? 1.0 : 0.0 );
+    }
+    MeasureType    affineValue, affineConditions;
+    DerivativeType affineDerivative;
+    if( !this->Evaluate( affineParameters, 3, affineValue, affineDerivative, affineConditions ) )
+    {
+      return 1;
+    }
+    const double numberOfRigidVoxels = std::pow( 5.0, static_cast< double >( Dimension ) );
+    const double orthonormality      = Dimension * std::pow( scale * scale - 1.0, 2.0 );
+    const double properness          = std::pow( std::pow( scale, static_cast< double >( Dimension ) ) - 1.0, 2.0 );
+    const double expectedConditions  = numberOfRigidVoxels * ( 10.0 * orthonormality + 100.0 * properness );
+    if( !( std::abs( affineConditions - expectedConditions ) <= 1e-10 * expectedConditions ) )
+    {
+      std::cerr << "ERROR: for a scaling the conditions are " << affineConditions
+                << " instead of " << expectedConditions << "." << std::endl;
+      return 1;
+    }
+
+    return 0;
+  }
+
+private:
+
+  typename ImageType::Pointer         m_Image;
+  typename TransformType::Pointer     m_Transform;
+  typename TransformType::RegionType  m_GridRegion;
+  typename RigidityImageType::Pointer m_RigidityImage;
+
+};
+
+
+int
+main( int argc, char * argv[] )
+{
+  try
+  {
+    RigidityPenaltyTermTester< 2 > tester2D;
+    if( tester2D.Run() != 0 )
+    {
+      return 1;
+    }
+    RigidityPenaltyTermTester< 3 > tester3D;
+    if( tester3D.Run() != 0 )
+    {
+      return 1;
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  std::cerr << "The restricted evaluation equals the full evaluation." << std::endl;
+  return 0;
+
+} // end main
@@ -0,0 +1,209 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkTransformToInverseDisplacementFieldSource.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+//-------------------------------------------------------------------------------------
+// Test that the displacement field of the inverse of a transform maps each point
+// of the grid onto a point that the transform maps back: for a smooth B-spline
+// transform, for an affine transform, which is inverted exactly, and for a
+// B-spline transform composed with a large rotation, which is far from the
+// identity. Also test that the non-converged voxels are reported.
+
+const unsigned int Dimension = 2;
+typedef double ScalarType;
+
+typedef itk::AdvancedTransform< ScalarType, Dimension, Dimension > TransformType;
+typedef itk::AdvancedBSplineDeformableTransform<
+  ScalarType, Dimension, 3 >                                       BSplineTransformType;
+typedef itk::AdvancedMatrixOffsetTransformBase<
+  ScalarType, Dimension, Dimension >                               AffineTransformType;
+typedef itk::AdvancedCombinationTransform< ScalarType, Dimension > CombinationTransformType;
+typedef itk::Vector< float, Dimension >                            VectorType;
+typedef itk::Image< VectorType, Dimension >                        DeformationFieldType;
+typedef itk::TransformToInverseDisplacementFieldSource<
+  DeformationFieldType, ScalarType >                               InverseSourceType;
+
+/** Compute the inverse of a transform on a 64 x 64 grid with unit spacing, and
+ * check the reported number of non-converged points and the errors.
+ */
+bool
+TestInverse( const std::string & name, const TransformType * transform,
+  const double tolerance, const unsigned int maximumNumberOfIterations,
+  const unsigned int coarseningFactor, const bool expectConvergence )
+{
+  InverseSourceType::SizeType size;
+  size.Fill( 64 );
+  InverseSourceType::Pointer inverseSource = InverseSourceType::New();
+  inverseSource->SetTransform( transform );
+  inverseSource->SetOutputSize( size );
+  inverseSource->SetTolerance( tolerance );
+  inverseSource->SetMaximumNumberOfIterations( maximumNumberOfIterations );
+  inverseSource->SetCoarseningFactor( coarseningFactor );
+
+  try
+  {
+    inverseSource->Update();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return false;
+  }
+
+  std::cerr << name << ":\n"
+            << "  Mean inverse-consistency error: "
+            << inverseSource->GetMeanInverseConsistencyError() << "\n"
+            << "  Maximum inverse-consistency error: "
+            << inverseSource->GetMaximumInverseConsistencyError() << "\n"
+            << "  Number of non-converged points: "
+            << inverseSource->GetNumberOfNonConvergedPoints() << std::endl;
+
+  const std::vector< InverseSourceType::IndexType > & nonConverged
+    = inverseSource->GetNonConvergedIndices();
+  if( nonConverged.size() != inverseSource->GetNumberOfNonConvergedPoints() )
+  {
+    std::cerr << "ERROR: the number of non-converged indices is " << nonConverged.size()
+              << " instead of " << inverseSource->GetNumberOfNonConvergedPoints() << std::endl;
+    return false;
+  }
+  if( expectConvergence != nonConverged.empty() )
+  {
+    std::cerr << "ERROR: the inverse " << ( expectConvergence ? "did not converge" : "converged" )
+              << " everywhere." << std::endl;
+    return false;
+  }
+
+  /** Check the reported errors independently. */
+  DeformationFieldType::Pointer inverseField = inverseSource->GetOutput();
+  typedef itk::ImageRegionConstIteratorWithIndex< DeformationFieldType > IteratorType;
+  IteratorType  it( inverseField, inverseField->GetLargestPossibleRegion() );
+  double        maximumError               = 0.0;
+  unsigned long numberOfNonConvergedPoints = 0;
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    DeformationFieldType::PointType target;
+    inverseField->TransformIndexToPhysicalPoint( it.GetIndex(), target );
+    TransformType::InputPointType x;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      x[ i ] = target[ i ] + it.Get()[ i ];
+    }
+    const double error = transform->TransformPoint( x ).EuclideanDistanceTo( target );
+    maximumError = std::max( maximumError, error );
+
+    /** Allow for the rounding of the displacements to float. */
+    const bool reported = std::find( nonConverged.begin(), nonConverged.end(), it.GetIndex() ) != nonConverged.end();
+    if( ( reported && error < tolerance - 1e-4 ) || ( !reported && error > tolerance + 1e-4 ) )
+    {
+      std::cerr << "ERROR: the error " << error << " at " << it.GetIndex()
+                << " does not match the reported convergence." << std::endl;
+      return false;
+    }
+  }
+
+  if( std::abs( maximumError - inverseSource->GetMaximumInverseConsistencyError() ) > 1e-4 )
+  {
+    std::cerr << "ERROR: the maximum inverse-consistency error is " << maximumError
+              << " instead of " << inverseSource->GetMaximumInverseConsistencyError() << std::endl;
+    return false;
+  }
+
+  return true;
+
+} // end TestInverse()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Setup a B-spline transform with a smooth deformation of at most 3 mm,
+   * on a grid with 8 mm spacing. Its valid region [-8, 80) x [-8, 80) covers
+   * the 64 x 64 grid of the inverse with a margin.
+   */
+  BSplineTransformType::Pointer bspline = BSplineTransformType::New();
+  BSplineTransformType::OriginType    gridOrigin;
+  BSplineTransformType::SpacingType   gridSpacing;
+  BSplineTransformType::RegionType    gridRegion;
+  BSplineTransformType::SizeType      gridSize;
+  BSplineTransformType::DirectionType gridDirection;
+  gridOrigin.Fill( -16.0 );
+  gridSpacing.Fill( 8.0 );
+  gridSize.Fill( 14 );
+  gridRegion.SetSize( gridSize );
+  gridDirection.SetIdentity();
+  bspline->SetGridOrigin( gridOrigin );
+  bspline->SetGridSpacing( gridSpacing );
+  bspline->SetGridRegion( gridRegion );
+  bspline->SetGridDirection( gridDirection );
+
+  BSplineTransformType::ParametersType parameters( bspline->GetNumberOfParameters() );
+  const unsigned int                   numberOfNodes = parameters.GetSize() / Dimension;
+  for( unsigned int n = 0; n < numberOfNodes; ++n )
+  {
+    const double x = static_cast< double >( n % gridSize[ 0 ] );
+    const double y = static_cast< double >( n / gridSize[ 0 ] );
+    parameters[ n ]                 = 3.0 * std::sin( 0.7 * x ) * std::cos( 0.4 * y );
+    parameters[ n + numberOfNodes ] = 3.0 * std::cos( 0.5 * x + 0.3 * y );
+  }
+  bspline->SetParameters( parameters );
+
+  /** An affine transform: a rotation of 100 degrees and a scaling by 1.25
+   * around the centre of the grid.
+   */
+  AffineTransformType::Pointer          affine = AffineTransformType::New();
+  AffineTransformType::MatrixType       matrix;
+  AffineTransformType::OutputVectorType offset;
+  const double                          angle = 100.0 * std::atan( 1.0 ) / 45.0;
+  matrix( 0, 0 ) = 1.25 * std::cos( angle ); matrix( 0, 1 ) = -1.25 * std::sin( angle );
+  matrix( 1, 0 ) = 1.25 * std::sin( angle ); matrix( 1, 1 ) = 1.25 * std::cos( angle );
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    offset[ i ] = 31.5 - matrix( i, 0 ) * 31.5 - matrix( i, 1 ) * 31.5;
+  }
+  affine->SetMatrix( matrix );
+  affine->SetOffset( offset );
+
+  /** The B-spline transform after the affine transform. A fixed-point
+   * iteration x <- x - ( T(x) - y ) diverges for this transform.
+   */
+  CombinationTransformType::Pointer combination = CombinationTransformType::New();
+  combination->SetUseComposition( true );
+  combination->SetInitialTransform( affine.GetPointer() );
+  combination->SetCurrentTransform( bspline.GetPointer() );
+
+  if( !TestInverse( "B-spline", bspline.GetPointer(), 1e-3, 50, 4, true )
+    || !TestInverse( "Affine", affine.GetPointer(), 1e-6, 0, 4, true )
+    || !TestInverse( "Affine and B-spline", combination.GetPointer(), 1e-3, 20, 4, true )
+    || !TestInverse( "B-spline, no iterations", bspline.GetPointer(), 1e-3, 0, 1, false ) )
+  {
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
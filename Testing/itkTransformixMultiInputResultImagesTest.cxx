@@ -0,0 +1,132 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageIOBase.h"
+#include "itkImageIOFactory.h"
+#include "itkImageRegionConstIterator.h"
+
+#include <iostream>
+#include <set>
+#include <string>
+
+//-------------------------------------------------------------------------------------
+// Check the result of transformix with two input images, -in0 and -in1, and a
+// transform parameter file with (ResultImagePixelType "float" "unsigned char")
+// and (FinalBSplineInterpolationOrder 3 0): input i is written to result.<i>.mhd,
+// except input 0 which is written to result.mhd, each with its own pixel type,
+// and the label image given as -in1 keeps its labels.
+
+int
+main( int argc, char * argv[] )
+{
+  /** Check number of arguments. */
+  if( argc != 3 )
+  {
+    std::cerr << "ERROR: You should specify the transformix output directory and the label image." << std::endl;
+    return 1;
+  }
+  const std::string outputDirectory = std::string( argv[ 1 ] ) + "/";
+  const std::string labelImageFileName( argv[ 2 ] );
+
+  /** The file names and pixel types of the result images. */
+  const std::string                         resultImageFileNames[ 2 ] = {
+    outputDirectory + "result.mhd", outputDirectory + "result.1.mhd"
+  };
+  const itk::ImageIOBase::IOComponentType componentTypes[ 2 ] = {
+    itk::ImageIOBase::FLOAT, itk::ImageIOBase::UCHAR
+  };
+
+  itk::ImageIOBase::Pointer imageIOs[ 2 ];
+  for( unsigned int i = 0; i < 2; ++i )
+  {
+    imageIOs[ i ] = itk::ImageIOFactory::CreateImageIO(
+      resultImageFileNames[ i ].c_str(), itk::ImageIOFactory::ReadMode );
+    if( imageIOs[ i ].IsNull() )
+    {
+      std::cerr << "ERROR: result image " << i << " was not written to "
+                << resultImageFileNames[ i ] << "." << std::endl;
+      return 1;
+    }
+    imageIOs[ i ]->SetFileName( resultImageFileNames[ i ] );
+    imageIOs[ i ]->ReadImageInformation();
+
+    std::cerr << resultImageFileNames[ i ] << ": "
+              << itk::ImageIOBase::GetComponentTypeAsString( imageIOs[ i ]->GetComponentType() ) << std::endl;
+    if( imageIOs[ i ]->GetComponentType() != componentTypes[ i ] )
+    {
+      std::cerr << "ERROR: result image " << i << " has pixel type "
+                << itk::ImageIOBase::GetComponentTypeAsString( imageIOs[ i ]->GetComponentType() )
+                << " instead of " << itk::ImageIOBase::GetComponentTypeAsString( componentTypes[ i ] )
+                << "." << std::endl;
+      return 1;
+    }
+  }
+
+  /** Both result images are on the same grid. */
+  for( unsigned int d = 0; d < 3; ++d )
+  {
+    if( imageIOs[ 0 ]->GetDimensions( d ) != imageIOs[ 1 ]->GetDimensions( d ) )
+    {
+      std::cerr << "ERROR: the result images have different sizes." << std::endl;
+      return 1;
+    }
+  }
+
+  /** The nearest neighbour interpolation of the label image only gives labels. */
+  typedef itk::Image< unsigned char, 3 >           LabelImageType;
+  typedef itk::ImageFileReader< LabelImageType >   ReaderType;
+  typedef itk::ImageRegionConstIterator< LabelImageType > IteratorType;
+  ReaderType::Pointer labelReader  = ReaderType::New();
+  ReaderType::Pointer resultReader = ReaderType::New();
+  labelReader->SetFileName( labelImageFileName );
+  resultReader->SetFileName( resultImageFileNames[ 1 ] );
+  try
+  {
+    labelReader->Update();
+    resultReader->Update();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  std::set< unsigned char > labels;
+  labels.insert( 0 ); // the DefaultPixelValue
+  IteratorType lit( labelReader->GetOutput(), labelReader->GetOutput()->GetLargestPossibleRegion() );
+  for( ; !lit.IsAtEnd(); ++lit )
+  {
+    labels.insert( lit.Get() );
+  }
+
+  IteratorType rit( resultReader->GetOutput(), resultReader->GetOutput()->GetLargestPossibleRegion() );
+  for( ; !rit.IsAtEnd(); ++rit )
+  {
+    if( labels.count( rit.Get() ) == 0 )
+    {
+      std::cerr << "ERROR: the resampled label image contains the value "
+                << static_cast< unsigned int >( rit.Get() ) << ", which is not a label." << std::endl;
+      return 1;
+    }
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
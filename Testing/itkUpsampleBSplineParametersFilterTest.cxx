@@ -0,0 +1,325 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkUpsampleBSplineParametersFilter.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkGridScheduleComputer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// Test that upsampling the B-spline parameters to a grid with half the spacing
+// reproduces the transform exactly, for a rotated grid and for all supported
+// spline orders, and that a grid that is not a dyadic refinement is still
+// handled by the resample and decomposition fallback. Also test that the grids
+// of the GridScheduleComputer are dyadic refinements when the spacing halves,
+// for any image size, if nested grids are requested, and unchanged otherwise.
+
+template< unsigned int VSplineOrder >
+int
+TestUpsampling( void )
+{
+  const unsigned int Dimension = 2;
+  typedef double ScalarType;
+
+  typedef itk::AdvancedBSplineDeformableTransform<
+    ScalarType, Dimension, VSplineOrder >             TransformType;
+  typedef typename TransformType::ParametersType ParametersType;
+  typedef typename TransformType::ImageType      ImageType;
+  typedef itk::UpsampleBSplineParametersFilter<
+    ParametersType, ImageType >                       UpsamplerType;
+
+  /** Setup the current grid, which is rotated. */
+  typename TransformType::OriginType    gridOrigin;
+  typename TransformType::SpacingType   gridSpacing;
+  typename TransformType::RegionType    gridRegion;
+  typename TransformType::SizeType      gridSize;
+  typename TransformType::DirectionType gridDirection;
+  gridOrigin[ 0 ] = -10.0;
+  gridOrigin[ 1 ] = -7.0;
+  gridSpacing[ 0 ] = 8.0;
+  gridSpacing[ 1 ] = 6.0;
+  gridSize.Fill( 10 );
+  gridRegion.SetSize( gridSize );
+  const double angle = 0.3;
+  gridDirection[ 0 ][ 0 ] = std::cos( angle );
+  gridDirection[ 0 ][ 1 ] = -std::sin( angle );
+  gridDirection[ 1 ][ 0 ] = std::sin( angle );
+  gridDirection[ 1 ][ 1 ] = std::cos( angle );
+
+  typename TransformType::Pointer current = TransformType::New();
+  current->SetGridOrigin( gridOrigin );
+  current->SetGridSpacing( gridSpacing );
+  current->SetGridRegion( gridRegion );
+  current->SetGridDirection( gridDirection );
+  ParametersType parameters( current->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 3.0 * std::sin( 0.71 * i );
+  }
+  current->SetParameters( parameters );
+
+  /** Two required grids: a dyadic refinement, which starts one refined
+   * node before the current grid, and a shifted one.
+   */
+  for( unsigned int test = 0; test < 2; ++test )
+  {
+    typename TransformType::SpacingType requiredSpacing = gridSpacing / 2.0;
+    typename TransformType::SizeType    requiredSize;
+    requiredSize.Fill( 2 * gridSize[ 0 ] + 2 );
+    typename TransformType::RegionType requiredRegion;
+    requiredRegion.SetSize( requiredSize );
+    typename TransformType::OriginType::VectorType offset;
+    offset[ 0 ] = -requiredSpacing[ 0 ];
+    offset[ 1 ] = -requiredSpacing[ 1 ];
+    if( VSplineOrder % 2 == 0 )
+    {
+      /** The refined lattice of even orders is shifted by a quarter spacing. */
+      offset[ 0 ] += 0.5 * requiredSpacing[ 0 ];
+      offset[ 1 ] += 0.5 * requiredSpacing[ 1 ];
+    }
+    if( test == 1 )
+    {
+      offset[ 0 ] += 0.3 * requiredSpacing[ 0 ];
+    }
+    typename TransformType::OriginType requiredOrigin = gridOrigin + gridDirection * offset;
+
+    typename UpsamplerType::Pointer upsampler = UpsamplerType::New();
+    upsampler->SetBSplineOrder( VSplineOrder );
+    upsampler->SetCurrentGridOrigin( gridOrigin );
+    upsampler->SetCurrentGridSpacing( gridSpacing );
+    upsampler->SetCurrentGridDirection( gridDirection );
+    upsampler->SetCurrentGridRegion( gridRegion );
+    upsampler->SetRequiredGridOrigin( requiredOrigin );
+    upsampler->SetRequiredGridSpacing( requiredSpacing );
+    upsampler->SetRequiredGridDirection( gridDirection );
+    upsampler->SetRequiredGridRegion( requiredRegion );
+
+    ParametersType upsampledParameters;
+    try
+    {
+      upsampler->UpsampleParameters( parameters, upsampledParameters );
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << excp << std::endl;
+      return 1;
+    }
+
+    typename TransformType::Pointer refined = TransformType::New();
+    refined->SetGridOrigin( requiredOrigin );
+    refined->SetGridSpacing( requiredSpacing );
+    refined->SetGridRegion( requiredRegion );
+    refined->SetGridDirection( gridDirection );
+    refined->SetParameters( upsampledParameters );
+
+    /** Compare in the inner part of the current grid. */
+    double maximumDifference = 0.0;
+    for( unsigned int i = 0; i <= 20; ++i )
+    {
+      for( unsigned int j = 0; j <= 20; ++j )
+      {
+        typename TransformType::OriginType::VectorType position;
+        position[ 0 ] = ( 2.0 + 0.25 * i ) * gridSpacing[ 0 ];
+        position[ 1 ] = ( 2.0 + 0.25 * j ) * gridSpacing[ 1 ];
+        const typename TransformType::InputPointType point = gridOrigin + gridDirection * position;
+        maximumDifference = std::max( maximumDifference,
+          current->TransformPoint( point ).EuclideanDistanceTo( refined->TransformPoint( point ) ) );
+      }
+    }
+
+    std::cerr << "Spline order " << VSplineOrder << ", "
+              << ( test == 0 ? "dyadic" : "shifted" ) << " grid: maximum difference "
+              << maximumDifference << std::endl;
+
+    /** The dyadic refinement is exact; the fallback is approximate. */
+    const double tolerance = test == 0 ? 1e-10 : 1.0;
+    if( maximumDifference > tolerance )
+    {
+      std::cerr << "ERROR: the upsampled transform differs too much." << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+
+} // end TestUpsampling()
+
+
+template< unsigned int VSplineOrder >
+int
+TestGridSchedule( void )
+{
+  const unsigned int Dimension = 2;
+  typedef double ScalarType;
+
+  typedef itk::AdvancedBSplineDeformableTransform<
+    ScalarType, Dimension, VSplineOrder >             TransformType;
+  typedef typename TransformType::ParametersType ParametersType;
+  typedef typename TransformType::ImageType      ImageType;
+  typedef itk::UpsampleBSplineParametersFilter<
+    ParametersType, ImageType >                       UpsamplerType;
+  typedef itk::GridScheduleComputer< ScalarType, Dimension > GridScheduleComputerType;
+
+  /** Images of several sizes, so that the bare grid sizes have either parity. */
+  for( unsigned int imageSize = 20; imageSize < 28; ++imageSize )
+  {
+    typename GridScheduleComputerType::OriginType    imageOrigin;
+    typename GridScheduleComputerType::SpacingType   imageSpacing;
+    typename GridScheduleComputerType::DirectionType imageDirection;
+    typename GridScheduleComputerType::SizeType      size;
+    typename GridScheduleComputerType::SpacingType   finalGridSpacing;
+    imageOrigin[ 0 ]  = 3.0;
+    imageOrigin[ 1 ]  = -5.0;
+    imageSpacing[ 0 ] = 1.0;
+    imageSpacing[ 1 ] = 0.7;
+    imageDirection.SetIdentity();
+    size[ 0 ] = imageSize;
+    size[ 1 ] = imageSize + 3;
+    finalGridSpacing.Fill( 1.9 );
+
+    typename GridScheduleComputerType::Pointer schedule = GridScheduleComputerType::New();
+    schedule->SetImageOrigin( imageOrigin );
+    schedule->SetImageSpacing( imageSpacing );
+    schedule->SetImageDirection( imageDirection );
+    schedule->SetImageRegion( typename GridScheduleComputerType::RegionType( size ) );
+    schedule->SetBSplineOrder( VSplineOrder );
+    schedule->SetFinalGridSpacing( finalGridSpacing );
+    schedule->SetDefaultSchedule( 3, 2.0 );
+    schedule->ComputeBSplineGrid();
+
+    /** By default the grid sizes are not changed to nest the grids. */
+    for( unsigned int level = 0; level < 3; ++level )
+    {
+      typename TransformType::RegionType    gridRegion;
+      typename TransformType::SpacingType   gridSpacing;
+      typename TransformType::OriginType    gridOrigin;
+      typename TransformType::DirectionType gridDirection;
+      schedule->GetBSplineGrid( level, gridRegion, gridSpacing, gridOrigin, gridDirection );
+      for( unsigned int dim = 0; dim < Dimension; ++dim )
+      {
+        const unsigned int expectedGridSize = VSplineOrder + static_cast< unsigned int >(
+          std::ceil( size[ dim ] * imageSpacing[ dim ] / gridSpacing[ dim ] ) );
+        if( gridRegion.GetSize()[ dim ] != expectedGridSize )
+        {
+          std::cerr << "ERROR: spline order " << VSplineOrder << ", image size " << imageSize
+                    << ", level " << level << ": the default grid size is "
+                    << gridRegion.GetSize()[ dim ] << " instead of " << expectedGridSize << std::endl;
+          return 1;
+        }
+      }
+    }
+
+    schedule->SetUseNestedGrids( true );
+    schedule->ComputeBSplineGrid();
+
+    for( unsigned int level = 1; level < 3; ++level )
+    {
+      typename TransformType::RegionType    gridRegion[ 2 ];
+      typename TransformType::SpacingType   gridSpacing[ 2 ];
+      typename TransformType::OriginType    gridOrigin[ 2 ];
+      typename TransformType::DirectionType gridDirection[ 2 ];
+      typename TransformType::Pointer       transform[ 2 ];
+      for( unsigned int k = 0; k < 2; ++k )
+      {
+        schedule->GetBSplineGrid( level - 1 + k,
+          gridRegion[ k ], gridSpacing[ k ], gridOrigin[ k ], gridDirection[ k ] );
+        transform[ k ] = TransformType::New();
+        transform[ k ]->SetGridRegion( gridRegion[ k ] );
+        transform[ k ]->SetGridSpacing( gridSpacing[ k ] );
+        transform[ k ]->SetGridOrigin( gridOrigin[ k ] );
+        transform[ k ]->SetGridDirection( gridDirection[ k ] );
+      }
+
+      ParametersType parameters( transform[ 0 ]->GetNumberOfParameters() );
+      for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+      {
+        parameters[ i ] = 2.0 * std::sin( 0.53 * i );
+      }
+      transform[ 0 ]->SetParameters( parameters );
+
+      typename UpsamplerType::Pointer upsampler = UpsamplerType::New();
+      upsampler->SetBSplineOrder( VSplineOrder );
+      upsampler->SetCurrentGridOrigin( gridOrigin[ 0 ] );
+      upsampler->SetCurrentGridSpacing( gridSpacing[ 0 ] );
+      upsampler->SetCurrentGridDirection( gridDirection[ 0 ] );
+      upsampler->SetCurrentGridRegion( gridRegion[ 0 ] );
+      upsampler->SetRequiredGridOrigin( gridOrigin[ 1 ] );
+      upsampler->SetRequiredGridSpacing( gridSpacing[ 1 ] );
+      upsampler->SetRequiredGridDirection( gridDirection[ 1 ] );
+      upsampler->SetRequiredGridRegion( gridRegion[ 1 ] );
+
+      ParametersType upsampledParameters;
+      try
+      {
+        upsampler->UpsampleParameters( parameters, upsampledParameters );
+      }
+      catch( itk::ExceptionObject & excp )
+      {
+        std::cerr << excp << std::endl;
+        return 1;
+      }
+      transform[ 1 ]->SetParameters( upsampledParameters );
+
+      /** Only the dyadic refinement is exact on the whole image. */
+      double maximumDifference = 0.0;
+      for( unsigned int i = 0; i < size[ 0 ]; ++i )
+      {
+        for( unsigned int j = 0; j < size[ 1 ]; ++j )
+        {
+          typename TransformType::InputPointType point;
+          point[ 0 ] = imageOrigin[ 0 ] + ( i + 0.37 ) * imageSpacing[ 0 ];
+          point[ 1 ] = imageOrigin[ 1 ] + ( j + 0.61 ) * imageSpacing[ 1 ];
+          maximumDifference = std::max( maximumDifference,
+            transform[ 0 ]->TransformPoint( point ).EuclideanDistanceTo(
+            transform[ 1 ]->TransformPoint( point ) ) );
+        }
+      }
+      if( maximumDifference > 1e-10 )
+      {
+        std::cerr << "ERROR: spline order " << VSplineOrder << ", image size " << imageSize
+                  << ", level " << level << ": the grid is not a dyadic refinement, "
+                  << "maximum difference " << maximumDifference << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+
+} // end TestGridSchedule()
+
+
+int
+main( int argc, char * argv[] )
+{
+  if( TestUpsampling< 1 >() || TestUpsampling< 2 >() || TestUpsampling< 3 >() )
+  {
+    return 1;
+  }
+
+  if( TestGridSchedule< 1 >() || TestGridSchedule< 2 >() || TestGridSchedule< 3 >() )
+  {
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
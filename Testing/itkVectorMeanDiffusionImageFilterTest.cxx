@@ -0,0 +1,216 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "BSplineDeformableTransformWithDiffusion/itkVectorMeanDiffusionImageFilter.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMultiThreader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// Test that the multi-threaded VectorMeanDiffusionImageFilter gives the same result
+// as a serial computation of the diffusion, for several numbers of iterations, and
+// that the result does not depend on the number of threads.
+
+const unsigned int Dimension = 2;
+typedef itk::Vector< float, Dimension >                  VectorType;
+typedef itk::Image< VectorType, Dimension >              VectorImageType;
+typedef itk::Image< short, Dimension >                   GrayValueImageType;
+typedef itk::Image< double, Dimension >                  DoubleImageType;
+typedef itk::VectorMeanDiffusionImageFilter<
+  VectorImageType, GrayValueImageType >                  DiffusionFilterType;
+
+/** The serial diffusion: in each iteration y = ( 1 - c ) x + c mean, with the
+ * mean weighted by c over the neighbourhood, and with the neighbours outside
+ * the image replaced by the nearest voxel inside.
+ */
+VectorImageType::Pointer
+SerialDiffusion( const VectorImageType * input, const DoubleImageType * cx,
+  const unsigned int radius, const unsigned int numberOfIterations )
+{
+  const VectorImageType::RegionType region = input->GetBufferedRegion();
+  const VectorImageType::SizeType   size   = region.GetSize();
+
+  VectorImageType::Pointer current = VectorImageType::New();
+  current->CopyInformation( input );
+  current->SetRegions( region );
+  current->Allocate();
+  std::memcpy( current->GetBufferPointer(), input->GetBufferPointer(),
+    region.GetNumberOfPixels() * sizeof( VectorType ) );
+
+  for( unsigned int k = 0; k < numberOfIterations; ++k )
+  {
+    VectorImageType::Pointer next = VectorImageType::New();
+    next->CopyInformation( input );
+    next->SetRegions( region );
+    next->Allocate();
+
+    itk::ImageRegionIteratorWithIndex< VectorImageType > it( next, region );
+    for( ; !it.IsAtEnd(); ++it )
+    {
+      const VectorImageType::IndexType index = it.GetIndex();
+      const double                     c     = cx->GetPixel( index );
+      const VectorType                 x     = current->GetPixel( index );
+      if( c < 0.000001 )
+      {
+        it.Set( x );
+        continue;
+      }
+
+      double sum[ Dimension ] = { 0.0, 0.0 };
+      double sumc             = 0.0;
+      for( int dy = -static_cast< int >( radius ); dy <= static_cast< int >( radius ); ++dy )
+      {
+        for( int dx = -static_cast< int >( radius ); dx <= static_cast< int >( radius ); ++dx )
+        {
+          VectorImageType::IndexType neighbour;
+          const itk::IndexValueType offset[ Dimension ] = { dx, dy };
+          for( unsigned int j = 0; j < Dimension; ++j )
+          {
+            const itk::IndexValueType last = static_cast< itk::IndexValueType >( size[ j ] ) - 1;
+            neighbour[ j ] = std::min( std::max( index[ j ] + offset[ j ], itk::IndexValueType( 0 ) ), last );
+          }
+          const double ci = cx->GetPixel( neighbour );
+          sumc += ci;
+          for( unsigned int j = 0; j < Dimension; ++j )
+          {
+            sum[ j ] += ci * current->GetPixel( neighbour )[ j ];
+          }
+        }
+      }
+
+      VectorType y;
+      for( unsigned int j = 0; j < Dimension; ++j )
+      {
+        const double mean = sumc < 0.00001 ? 0.0 : sum[ j ] / sumc;
+        y[ j ] = static_cast< float >( ( 1.0 - c ) * x[ j ] + c * mean );
+      }
+      it.Set( y );
+    }
+    current = next;
+  }
+
+  return current;
+
+} // end SerialDiffusion()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** A vector image and a gray value image, with a structure in the
+   * gray values. The sizes are odd, so that the threads get unequal pieces.
+   */
+  VectorImageType::RegionType region;
+  region.SetIndex( 0, 0 ); region.SetIndex( 1, 0 );
+  region.SetSize( 0, 23 ); region.SetSize( 1, 37 );
+
+  VectorImageType::Pointer input = VectorImageType::New();
+  input->SetRegions( region );
+  input->Allocate();
+  GrayValueImageType::Pointer grayValues = GrayValueImageType::New();
+  grayValues->SetRegions( region );
+  grayValues->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< VectorImageType >    vit( input, region );
+  itk::ImageRegionIteratorWithIndex< GrayValueImageType > git( grayValues, region );
+  for( ; !vit.IsAtEnd(); ++vit, ++git )
+  {
+    const VectorImageType::IndexType index = vit.GetIndex();
+    VectorType                       vector;
+    vector[ 0 ] = static_cast< float >( std::sin( 0.7 * index[ 0 ] + 0.3 * index[ 1 ] ) );
+    vector[ 1 ] = static_cast< float >( std::cos( 0.5 * index[ 0 ] * index[ 1 ] ) );
+    vit.Set( vector );
+    git.Set( static_cast< short >( index[ 0 ] < 11 ? 100 + 7 * index[ 1 ] : 1000 - 13 * index[ 0 ] ) );
+  }
+
+  /** The stiffness coefficients, as computed by the filter. */
+  typedef itk::RescaleIntensityImageFilter< GrayValueImageType, DoubleImageType > RescalerType;
+  RescalerType::Pointer rescaler = RescalerType::New();
+  rescaler->SetOutputMinimum( 0.000001 );
+  rescaler->SetOutputMaximum( 0.999999 );
+  rescaler->SetInput( grayValues );
+  rescaler->Update();
+
+  const unsigned int radius = 1;
+  VectorImageType::SizeType radiusSize;
+  radiusSize.Fill( radius );
+  const unsigned int numberOfThreads[ 2 ] = { 1, 4 };
+  for( unsigned int numberOfIterations = 0; numberOfIterations <= 3; ++numberOfIterations )
+  {
+    VectorImageType::Pointer reference = SerialDiffusion(
+      input, rescaler->GetOutput(), radius, numberOfIterations );
+
+    VectorImageType::Pointer outputs[ 2 ];
+    for( unsigned int t = 0; t < 2; ++t )
+    {
+      itk::MultiThreader::SetGlobalDefaultNumberOfThreads( numberOfThreads[ t ] );
+      DiffusionFilterType::Pointer diffusion = DiffusionFilterType::New();
+      diffusion->SetInput( input );
+      diffusion->SetGrayValueImage( grayValues );
+      diffusion->SetRadius( radiusSize );
+      diffusion->SetNumberOfIterations( numberOfIterations );
+      try
+      {
+        diffusion->Update();
+      }
+      catch( itk::ExceptionObject & excp )
+      {
+        std::cerr << excp << std::endl;
+        return 1;
+      }
+      outputs[ t ] = diffusion->GetOutput();
+    }
+
+    /** The number of threads does not change the result. */
+    if( std::memcmp( outputs[ 0 ]->GetBufferPointer(), outputs[ 1 ]->GetBufferPointer(),
+      region.GetNumberOfPixels() * sizeof( VectorType ) ) != 0 )
+    {
+      std::cerr << "ERROR: the result of " << numberOfIterations
+                << " iterations depends on the number of threads." << std::endl;
+      return 1;
+    }
+
+    /** The result equals the serial computation. */
+    double maximumDifference = 0.0;
+    itk::ImageRegionIterator< VectorImageType > oit( outputs[ 1 ], region );
+    itk::ImageRegionIterator< VectorImageType > rit( reference, region );
+    for( ; !oit.IsAtEnd(); ++oit, ++rit )
+    {
+      for( unsigned int j = 0; j < Dimension; ++j )
+      {
+        maximumDifference = std::max( maximumDifference,
+          static_cast< double >( std::abs( oit.Get()[ j ] - rit.Get()[ j ] ) ) );
+      }
+    }
+    std::cerr << numberOfIterations << " iterations: maximum difference with the serial diffusion "
+              << maximumDifference << std::endl;
+    if( maximumDifference > 1e-5 )
+    {
+      std::cerr << "ERROR: the diffusion differs from the serial computation." << std::endl;
+      return 1;
+    }
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main